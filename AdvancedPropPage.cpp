@@ -41,6 +41,7 @@ CAdvancedPropPage::CAdvancedPropPage() : CPropertyPageWithHelp(CAdvancedPropPage
 	m_bConfirmMeasures = TRUE;
 	m_comPort = _T("");
 	m_bUseOnlyPrimaries = FALSE;
+	m_bUseMultiPatchMatrix = FALSE;
 	m_bUseImperialUnits = FALSE;
 	m_nLuminanceCurveMode = 0;
 	m_bPreferLuxmeter = FALSE;
@@ -70,6 +71,7 @@ void CAdvancedPropPage::DoDataExchange(CDataExchange* pDX)
 	DDX_CBIndex(pDX, IDC_COMBO_dE_GRAY, m_dE_gray);
 	DDX_CBIndex(pDX, IDC_COMBO_dE_WEIGHT, gw_Weight);
 	DDX_Check(pDX, IDC_CHECK_CALIBRATION_OLD, m_bUseOnlyPrimaries);
+	DDX_Check(pDX, IDC_CHECK_CALIBRATION_MULTIPATCH, m_bUseMultiPatchMatrix);
 	DDX_Check(pDX, IDC_HIGHLIGHT, doHighlight);
 	DDX_Check(pDX, IDC_CHECK_IMPERIAL, m_bUseImperialUnits);
 	DDX_Radio(pDX, IDC_RADIO1, m_nLuminanceCurveMode);
@@ -85,6 +87,7 @@ BEGIN_MESSAGE_MAP(CAdvancedPropPage, CPropertyPageWithHelp)
     ON_CONTROL_RANGE(BN_CLICKED, IDC_CHECK_DELTAE_GRAY_LUMA, IDC_CHECK_DELTAE_GRAY_LUMA, OnControlClicked)
     ON_CONTROL_RANGE(BN_CLICKED, IDC_RADIO1, IDC_RADIO3, OnControlClicked)
     ON_CONTROL_RANGE(BN_CLICKED, IDC_HIGHLIGHT, IDC_HIGHLIGHT, OnControlClicked)
+    ON_CONTROL_RANGE(BN_CLICKED, IDC_CHECK_CALIBRATION_MULTIPATCH, IDC_CHECK_CALIBRATION_MULTIPATCH, OnControlClicked)
 
 	//{{AFX_MSG_MAP(CAdvancedPropPage)
 	ON_CBN_SELCHANGE(IDC_LUXMETER_COM_COMBO, OnSelchangeLuxmeterComCombo)
@@ -53,6 +53,7 @@ public:
 	int 		m_dE_gray;
 	int 		gw_Weight;
 	BOOL		m_bUseOnlyPrimaries;
+	BOOL		m_bUseMultiPatchMatrix;
 	BOOL		m_bUseImperialUnits;
 	int 		m_nLuminanceCurveMode;
 	BOOL		m_bPreferLuxmeter;
@@ -40,12 +40,15 @@
 #include "Hyperlink.h"
 #include "Tools/MainWndPlacement.h"
 #include "DocEnumerator.h"	//Ki
+#include "Tools/GoogleCastWrapper/GoogleCastWrapper.h"
 
 #include "EyeOneSensor.h"
 #include "SerialCom.h"
 #include "VersionInfoFromFile.h"
 #include "ximage.h"
 #include "CWebUpdate.h"
+#include "TraceLog.h"
+#include <fstream>
 
 #ifdef USE_NON_FREE_CODE
 // Include for device interface (this device interface is outside GNU GPL license)
@@ -88,6 +91,7 @@ END_MESSAGE_MAP()
 // CColorHCFRApp construction
 
 CColorHCFRApp::CColorHCFRApp()
+	: m_LuxReader ( m_LuxSamples )
 {
 #ifdef _DEBUG
     // uncomment to put on full memory checking which we still have lots of mem leaks/issues
@@ -104,13 +108,14 @@ CColorHCFRApp::CColorHCFRApp()
 	m_hCIEThread = NULL;
 	m_hCIEEvent = CreateEvent ( NULL, TRUE, FALSE, NULL );	// Manual event starting non-signaled
     ResetEvent(m_hCIEEvent);
+	m_nCIEBitmapsVersion = 0;
 	m_hCursorMeasure = NULL;
 	m_hSavedCursor = NULL;
 	m_pPatternWnd = NULL;
-	m_hLuxThread = NULL;
-	m_bStopLuxThread = FALSE;
+	m_bLuxMatchWindow = TRUE;
+	m_LuxIntegrationTime = 500.0;
+	m_LuxWindowStart = 0.0;
 	InitializeCriticalSection ( & m_LuxCritSec );
-	memcpy ( m_RefLuxParams, "\0\0", 2 );
 	m_CurrentLuxValue = 0.0;
 	m_bLowLuxValue = FALSE;
 	m_bHighLuxValue = FALSE;
@@ -145,16 +150,7 @@ CColorHCFRApp::~CColorHCFRApp()
 	CloseHandle ( m_hCIEEvent );
 	m_hCIEEvent = NULL;
 
-	if ( m_hLuxThread )
-	{
-		m_bStopLuxThread = TRUE;
-		
-		if ( WaitForSingleObject ( m_hLuxThread, 10000 ) == WAIT_TIMEOUT )
-			TerminateThread ( m_hLuxThread, 0 );
-		
-		CloseHandle ( m_hLuxThread );
-		m_hLuxThread = NULL;
-	}
+	m_LuxReader.Stop ();
 
     if(m_pColorReference)
     {
@@ -291,6 +287,10 @@ BOOL CColorHCFRApp::InitInstance()
 
 	LoadStdProfileSettings();  // Load standard INI file options (including MRU)
 
+	// TraceFile in the [Debug] section records timing spans, written on exit
+	if (!m_pConfig->GetProfileString("Debug", "TraceFile", "").IsEmpty())
+		CTraceLog::Start();
+
 	if( !CHWinAppEx::InitInstance( _T("{B7C56C2E-F858-4f2b-9054-2F5626377F03}") ) )
 		if(!m_pConfig->m_doMultipleInstance)
 			return FALSE;
@@ -298,6 +298,10 @@ BOOL CColorHCFRApp::InitInstance()
 	AfxEnableControlContainer();
 
 	CreateCIEBitmaps ( TRUE );
+
+	// Find Chromecasts while the application starts, when one is the display
+	if ( m_pConfig -> GetProfileInt ( "GDIGenerator", "DisplayMode", DISPLAY_DEFAULT_MODE ) == DISPLAY_ccast )
+		CGoogleCastWrapper::StartDiscovery ();
 	
 	// Standard initialization
 	// If you are not using these features and wish to reduce the size
@@ -361,9 +365,13 @@ BOOL CColorHCFRApp::InitInstance()
 	m_hSavedCursor = NULL;
 
 	m_LuxPort = GetConfig () -> GetProfileString ( "Defaults", "Luxmeter", "" );
+	m_bLuxMatchWindow = GetConfig () -> GetProfileInt ( "Defaults", "LuxmeterMatchWindow", 1 );
+	m_LuxIntegrationTime = GetConfig () -> GetProfileInt ( "Defaults", "LuxmeterIntegrationTime", 500 );
 	if ( ! m_LuxPort.IsEmpty () )
 		StartLuxMeasures ();
 
+	RecoverMeasurementJournals ();
+
 	//check for updates
 	if (m_pConfig->m_doUpdateCheck)
 	{
@@ -558,6 +566,18 @@ int CColorHCFRApp::ExitInstance()
 	DisconnectDevice3();
 #endif
 
+	CGoogleCastWrapper::StopDiscovery();
+
+    if(m_pConfig && CTraceLog::IsEnabled())
+    {
+        // Chrome trace events, and the summary per span next to them
+        CTraceLog::Stop();
+        std::string tracePath = (LPCSTR) m_pConfig->GetProfileString("Debug", "TraceFile", "");
+        CTraceLog::WriteChromeTrace(tracePath);
+        std::ofstream summary((tracePath + ".txt").c_str());
+        CTraceLog::WriteSummary(summary);
+    }
+
     if(m_pConfig)
     {
         delete m_pConfig;
@@ -711,6 +731,9 @@ DWORD WINAPI CreateCIEBitmapsThreadFunc ( LPVOID )
 	    BmpDC.DeleteDC ();
 	    WhiteBmpDC.DeleteDC ();
 
+	    // Views rebuild their stretched copies on next update
+	    pApp -> m_nCIEBitmapsVersion ++;
+
 	    Sleep ( 0 );
 	    SetEvent ( pApp -> m_hCIEEvent );
     	
@@ -809,120 +832,12 @@ void CColorHCFRApp::CreateCIEBitmaps ( BOOL bBackGround )
 	}
 }
 	
-DWORD WINAPI LuxMeterThreadFunc ( LPVOID lParam )
-{	
-    CrashDump useInThisThread;
+// Called on the luxmeter reader thread for each reading
+void LuxSampleReceived ( void * pContext, const LuxSample & sample )
+{
     try
     {
-	    int				i;
-	    BOOL			bRecord = FALSE;
-	    BOOL			bEndPacket = FALSE;
-	    BYTE			data = 0;
-	    DWORD			dwBytesTransferred;
-	    DWORD			dwStartTick;
-	    CColorHCFRApp *	pApp = (CColorHCFRApp *) lParam;
-	    char			szBuf [ 256 ];
-	    HANDLE			hCom;
-	    COMMCONFIG		cc;
-	    COMMTIMEOUTS	ct;
-
-	    hCom = CreateFile ( pApp -> m_LuxPort, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL );
-
-	    if ( hCom == INVALID_HANDLE_VALUE )
-	    {
-		    // Error, exit with error code 1
-		    return 1;
-	    } 
-
-	    memset ( & cc, 0, sizeof(cc) );
-	    cc.dwSize = sizeof(cc);
-	    cc.dcb.DCBlength = sizeof(cc.dcb);
-    	
-	    dwBytesTransferred = sizeof(cc);
-	    GetDefaultCommConfig ( pApp -> m_LuxPort, & cc, & dwBytesTransferred );
-
-	    cc.dcb.BaudRate = CBR_9600;
-	    cc.dcb.fBinary = TRUE;
-	    cc.dcb.ByteSize = 8;
-	    cc.dcb.Parity = NOPARITY;
-	    cc.dcb.StopBits = ONESTOPBIT;
-
-	    if ( ! SetCommConfig ( hCom, & cc, sizeof(cc) ) )
-	    {
-		    CloseHandle ( hCom );
-    		
-		    // Exit with error code 2
-		    return 2;
-	    } 
-
-	    if ( ! SetCommMask ( hCom, 0 ) )
-	    {
-		    CloseHandle ( hCom );
-
-		    // Exit with error code 3
-		    return 3;
-	    } 
-
-	    if ( ! PurgeComm ( hCom, PURGE_RXCLEAR ) )
-	    {
-		    CloseHandle ( hCom );
-
-		    // Exit with error code 4
-		    return 4;
-	    }
-
-	    ct.ReadIntervalTimeout = 0;
-	    ct.ReadTotalTimeoutConstant = 1000;
-	    ct.ReadTotalTimeoutMultiplier = 0;
-	    ct.WriteTotalTimeoutConstant = 0;
-	    ct.WriteTotalTimeoutMultiplier = 0;
-
-	    if ( ! SetCommTimeouts ( hCom, & ct ) )
-	    {
-		    CloseHandle ( hCom );
-
-		    // Exit with error code 3
-		    return 3;
-	    } 
-
-	    do
-	    {
-		    if ( ReadFile ( hCom, & data, 1, & dwBytesTransferred, NULL ) )
-		    {
-			    if ( dwBytesTransferred > 0 )
-			    {
-				    if ( data == 0x02 )
-				    {
-					    dwStartTick = GetTickCount ();
-					    bRecord = TRUE;
-					    i = 0;
-				    }
-
-				    if ( bRecord )
-				    {
-					    szBuf [ i ++ ] = (char) data;
-
-					    if ( data == 0x0D )
-					    {
-						    bRecord = FALSE;
-						    szBuf [ i ] = '\0';
-
-						    // Interpret data
-						    pApp -> SetLuxmeterValue ( szBuf, dwStartTick );
-
-						    bEndPacket = TRUE;
-					    }
-				    }
-			    }
-		    }
-		    if ( bEndPacket )
-		    {
-			    bEndPacket = FALSE;
-			    Sleep ( 10 );
-		    }
-	    } while ( ! pApp -> m_bStopLuxThread );
-
-	    CloseHandle ( hCom );
+		( (CColorHCFRApp *) pContext ) -> SetLuxmeterValue ( sample );
     }
     catch(std::exception& e)
     {
@@ -932,7 +847,6 @@ DWORD WINAPI LuxMeterThreadFunc ( LPVOID lParam )
     {
         std::cerr << "Unexpected Exception in lux meter thread" << std::endl;
     }
-	return 0;
 }
 
 void CColorHCFRApp::SetPatternWindow ( CWnd * pWnd )
@@ -1087,255 +1001,166 @@ int CColorHCFRApp::InMeasureMessageBox(LPCSTR lpText, LPCSTR lpCaption, UINT uTy
 
 void CColorHCFRApp::StartLuxMeasures ()
 {
-	// Test is thread is already running
-	if ( m_hLuxThread )
-	{
-		// Stop it
-		m_bStopLuxThread = TRUE;
-		
-		if ( WaitForSingleObject ( m_hLuxThread, 10000 ) == WAIT_TIMEOUT )
-			TerminateThread ( m_hLuxThread, 0 );
-		
-		CloseHandle ( m_hLuxThread );
-		m_hLuxThread = NULL;
-	}
+	// Stop the reader if it is already running
+	m_LuxReader.Stop ();
+	m_LuxSamples.Clear ();
 
 	// Start a new thread
 	if ( ! m_LuxPort.IsEmpty () )
 	{
-		m_bStopLuxThread = FALSE;
-		m_hLuxThread = ::CreateThread ( NULL, 65536, LuxMeterThreadFunc, this, 0, NULL );
-		:: SetThreadPriority ( m_hLuxThread, THREAD_PRIORITY_ABOVE_NORMAL );
+		m_LuxReader.SetCallback ( LuxSampleReceived, this );
+		m_LuxReader.Start ( (LPCSTR) m_LuxPort );
 	}
 }
 
 BOOL CColorHCFRApp::IsLuxmeterRunning ()
 {
-	return ( m_hLuxThread != NULL && ! m_bStopLuxThread && m_dwLuxValueTime != 0 && m_dwLuxValueTime + 10000 > GetTickCount () );
+	return ( m_LuxReader.IsRunning () && m_dwLuxValueTime != 0 && m_dwLuxValueTime + 10000 > GetTickCount () );
 }
 
 
-void CColorHCFRApp::SetLuxmeterValue ( LPCSTR lpszString, DWORD dwStartTick )
+void CColorHCFRApp::SetLuxmeterValue ( const LuxSample & sample )
 {
-	int		n = strlen ( lpszString );
-	double	d = 0.0;
-	double	dmul = 1.0;
-	BOOL	bLow = FALSE;
-	BOOL	bHigh = FALSE;
-	BOOL	bFtCd = FALSE;
-	BOOL	bLowestScale = FALSE;
-	BOOL	bHighestScale = FALSE;
-
-	if ( strncmp ( lpszString, "\002411", 4 ) == 0 
-		&& ( lpszString [ 4 ] == '5' || lpszString [ 4 ] == '6' ) 
-		&& ( lpszString [ 5 ] == '0' || lpszString [ 5 ] == '1' ) 
-		&& ( strchr ( "012378", lpszString [ 6 ] ) != NULL ) 
-		&& ( strncmp ( lpszString + 7, "0000", 4 ) == 0 )
-		&& lpszString [ n - 1 ] == 0x0D )
+	// Save data
+	EnterCriticalSection ( & m_LuxCritSec );
+	m_CurrentLuxValue = sample.lux;
+	m_bLowLuxValue = sample.bLow;
+	m_bHighLuxValue = sample.bHigh;
+	m_bLowestLuxScale = sample.bLowestScale;
+	m_bHighestLuxScale = sample.bHighestScale;
+	m_dwPreviousLuxValueTime = m_dwLuxValueTime;
+	m_dwLuxValueTime = GetTickCount () - (DWORD) ( CTraceLog::GetClockUs () / 1000.0 - sample.timeMs );
+	
+	// Readings are matched to the colorimeter reading in GetLuxMeasure
+	if ( m_bInsideMeasure && ! m_bLuxMatchWindow )
 	{
-		if ( lpszString [ 4 ] == '6' )
-			bFtCd = TRUE;
-
-		switch ( lpszString [ 6 ] )
+		// Ignore obsolete measures
+		if ( m_dwPreviousLuxValueTime >= m_dwMeasureStartTime )
 		{
-			case '0':	
-				 dmul = 1.0;
-				 break;
-
-			case '1':
-				 dmul = 0.1;
-				 break;
-
-			case '2':
-				 dmul = 0.01;
-				 if ( ! bFtCd )
-					bLowestScale = TRUE;
-				 break;
-
-			case '3':
-				 dmul = 0.001;
-				 bLowestScale = TRUE;
-				 break;
-
-			case '7':
-				 dmul = 10.0;
-				 break;
-
-			case '8':
-				 dmul = 100.0;
-				 bHighestScale = TRUE;
-				 break;
-		}
-
-		if ( lpszString [ 5 ] == '1' )
-			dmul = -dmul;
-
-		if ( isdigit ( lpszString [ 11 ] ) )
-		{
-			d = ( (double) atoi ( lpszString + 11 ) ) * dmul;
-
-			if ( bFtCd )
+			if ( ! m_bLowLuxValue && ! m_bHighLuxValue )
 			{
-				// Convert Ft-cd in Lux
-				d = d / 0.0929;
-			}
-		}
-		else if ( lpszString [ 11 ] == 0x18 )
-		{
-			bHigh = TRUE;
-		}
-		else if ( lpszString [ 11 ] == 0x19 )
-		{
-			bLow = TRUE;
-		}
-
-		if ( m_RefLuxParams [ 0 ] != lpszString [ 4 ] || m_RefLuxParams [ 1 ] != lpszString [ 6 ] )
-		{
-			// Save new luxmeter configuration, but ignore measure (it is incoherent)
-			m_RefLuxParams [ 0 ] = lpszString [ 4 ];
-			m_RefLuxParams [ 1 ] = lpszString [ 6 ];
-		}
-		else
-		{
-			// Save data
-			EnterCriticalSection ( & m_LuxCritSec );
-			m_CurrentLuxValue = d;
-			m_bLowLuxValue = bLow;
-			m_bHighLuxValue = bHigh;
-			m_bLowestLuxScale = bLowestScale;
-			m_bHighestLuxScale = bHighestScale;
-			m_dwPreviousLuxValueTime = m_dwLuxValueTime;
-			m_dwLuxValueTime = dwStartTick;
-			
-			if ( m_bInsideMeasure )
-			{
-				// Ignore obsolete measures
-				if ( m_dwPreviousLuxValueTime >= m_dwMeasureStartTime )
+				if ( m_bLastMeasureOutOfRange )
+				{
+					// We were is "out of scale range" mode, advisor dialog is certainly displayed
+					// Indicate measures are now valid, but do no reset m_bLastMeasureOutOfRange flag:
+					// it will be reset by the main thread
+					m_bFirstMeasureWithNewScaleOk = TRUE;
+					m_NbMeasures = 0;
+				}
+				else
 				{
-					if ( ! m_bLowLuxValue && ! m_bHighLuxValue )
+					// Store actual measure in measure list
+					if ( m_NbMeasures >= sizeof ( m_LastLuxValues ) / sizeof ( m_LastLuxValues [ 0 ] ) )
 					{
-						if ( m_bLastMeasureOutOfRange )
-						{
-							// We were is "out of scale range" mode, advisor dialog is certainly displayed
-							// Indicate measures are now valid, but do no reset m_bLastMeasureOutOfRange flag:
-							// it will be reset by the main thread
-							m_bFirstMeasureWithNewScaleOk = TRUE;
-							m_NbMeasures = 0;
-						}
-						else
-						{
-							// Store actual measure in measure list
-							if ( m_NbMeasures >= sizeof ( m_LastLuxValues ) / sizeof ( m_LastLuxValues [ 0 ] ) )
-							{
-								// Shift values to keep only the last ones
-								memmove ( m_LastLuxValues, m_LastLuxValues + 1, sizeof ( m_LastLuxValues ) - sizeof ( m_LastLuxValues [ 0 ] ) );
-								m_NbMeasures --;
+						// Shift values to keep only the last ones
+						memmove ( m_LastLuxValues, m_LastLuxValues + 1, sizeof ( m_LastLuxValues ) - sizeof ( m_LastLuxValues [ 0 ] ) );
+						m_NbMeasures --;
 
-								if ( m_nFirstValidMeasure > 0 )
-									m_nFirstValidMeasure --;
-							}
-							m_LastLuxValues [ m_NbMeasures ++ ] = m_CurrentLuxValue;
+						if ( m_nFirstValidMeasure > 0 )
+							m_nFirstValidMeasure --;
+					}
+					m_LastLuxValues [ m_NbMeasures ++ ] = m_CurrentLuxValue;
 
-							if ( m_bLuxMeasureValid )
-							{
-								int		i, NbValues;
-								int		nNbGrow, nNbDec;
-								double	d;
-								double	dValues [ sizeof ( m_LastLuxValues ) / sizeof ( m_LastLuxValues [ 0 ] ) ]; 
-								
-								// Retrieve last values since first valid value. 
-								// Only values which are in a 0.5% interval around last two measures average are taken into account.
-								dValues [ 0 ] = m_LastLuxValues [ m_NbMeasures - 1 ];
-								dValues [ 1 ] = m_LastLuxValues [ m_NbMeasures - 2 ];
-								NbValues = 2;
-								d = ( dValues [ 0 ] + dValues [ 1 ] ) / 2.0;
-								for ( i = m_NbMeasures - 3; i >= m_nFirstValidMeasure; i -- )
-								{
-									if ( NbValues == 0 || ( ( fabs ( m_LastLuxValues [ i ] - d ) / d ) < 0.005 ) )
-										dValues [ NbValues ++ ] = m_LastLuxValues [ i ];
-								}
+					if ( m_bLuxMeasureValid )
+					{
+						int		i, NbValues;
+						int		nNbGrow, nNbDec;
+						double	d;
+						double	dValues [ sizeof ( m_LastLuxValues ) / sizeof ( m_LastLuxValues [ 0 ] ) ]; 
+						
+						// Retrieve last values since first valid value. 
+						// Only values which are in a 0.5% interval around last two measures average are taken into account.
+						dValues [ 0 ] = m_LastLuxValues [ m_NbMeasures - 1 ];
+						dValues [ 1 ] = m_LastLuxValues [ m_NbMeasures - 2 ];
+						NbValues = 2;
+						d = ( dValues [ 0 ] + dValues [ 1 ] ) / 2.0;
+						for ( i = m_NbMeasures - 3; i >= m_nFirstValidMeasure; i -- )
+						{
+							if ( NbValues == 0 || ( ( fabs ( m_LastLuxValues [ i ] - d ) / d ) < 0.005 ) )
+								dValues [ NbValues ++ ] = m_LastLuxValues [ i ];
+						}
 
-								// Analyze those values
-								d = dValues [ 0 ];
-								nNbGrow = 0;
-								nNbDec = 0;
-								for ( i = 1; i < NbValues ; i ++ )
-								{
-									d += dValues [ i ];
-									if ( dValues [ i ] > dValues [ i - 1 ] )
-										nNbGrow ++;
+						// Analyze those values
+						d = dValues [ 0 ];
+						nNbGrow = 0;
+						nNbDec = 0;
+						for ( i = 1; i < NbValues ; i ++ )
+						{
+							d += dValues [ i ];
+							if ( dValues [ i ] > dValues [ i - 1 ] )
+								nNbGrow ++;
 
-									if ( dValues [ i ] < dValues [ i - 1 ] )
-										nNbDec ++;
-								}
+							if ( dValues [ i ] < dValues [ i - 1 ] )
+								nNbDec ++;
+						}
 
-								if ( nNbGrow == 0 || nNbDec == 0 )
-								{
-									// Asymptotic case: use last value
-									m_MeasuredLuxValue = dValues [ 0 ];
-								}
-								else
-								{
-									// Alternance case: use averaging
-									m_MeasuredLuxValue = ( d / (double) NbValues );
-								}
-								
+						if ( nNbGrow == 0 || nNbDec == 0 )
+						{
+							// Asymptotic case: use last value
+							m_MeasuredLuxValue = dValues [ 0 ];
+						}
+						else
+						{
+							// Alternance case: use averaging
+							m_MeasuredLuxValue = ( d / (double) NbValues );
+						}
+						
 #ifdef _DEBUG
 {
 	char	szBuf [ 256 ];
 	if ( ( fabs ( m_MeasuredLuxValue_Initial - m_MeasuredLuxValue ) / m_MeasuredLuxValue ) > 0.0001 )
 	{
-		sprintf_s ( szBuf, "Luxmeter approximation: %6f (actual) instead of %6f (initial) : %.1f %%\n", m_MeasuredLuxValue, m_MeasuredLuxValue_Initial, ( fabs ( m_MeasuredLuxValue_Initial - m_MeasuredLuxValue ) / m_MeasuredLuxValue ) * 100.0 );
-		OutputDebugString ( szBuf );
+sprintf_s ( szBuf, "Luxmeter approximation: %6f (actual) instead of %6f (initial) : %.1f %%\n", m_MeasuredLuxValue, m_MeasuredLuxValue_Initial, ( fabs ( m_MeasuredLuxValue_Initial - m_MeasuredLuxValue ) / m_MeasuredLuxValue ) * 100.0 );
+OutputDebugString ( szBuf );
 	}
 }
 #endif
-							}
-							else
+					}
+					else
+					{
+						// Analyze list of values to check if current measure is valid
+						if ( m_NbMeasures >= 3 )
+						{
+							// We have at least 3 values, we can check validity
+							double d0 = m_LastLuxValues [ m_NbMeasures - 3 ];
+							double d1 = m_LastLuxValues [ m_NbMeasures - 2 ];
+							double d2 = m_LastLuxValues [ m_NbMeasures - 1 ];
+							
+							// Test if values n and n-2 are within a 2% range
+							if ( ( fabs ( d2 - d0 ) / d0 ) < 0.02 )
 							{
-								// Analyze list of values to check if current measure is valid
-								if ( m_NbMeasures >= 3 )
+								// Check if value n-1 is outside [n-2,n] interval, and value n-1 and n within a 0.5% range
+								// This is the case of "alternance", eg grow first, then decrease a little to stabilize
+								if ( d1 >= max ( d0, d2 ) || d1 <= min ( d0, d2 ) && ( fabs ( d1 - d2 ) / d2 ) < 0.005 )
+								{
+									// Ok: use average between the two last measures
+									m_MeasuredLuxValue = ( d2 + d1 ) / 2.0;
+									m_MeasuredLuxValue_Initial = m_MeasuredLuxValue;
+									m_bLuxMeasureValid = TRUE;
+									m_nFirstValidMeasure = m_NbMeasures - 2;
+								}
+								else 
 								{
-									// We have at least 3 values, we can check validity
-									double d0 = m_LastLuxValues [ m_NbMeasures - 3 ];
-									double d1 = m_LastLuxValues [ m_NbMeasures - 2 ];
-									double d2 = m_LastLuxValues [ m_NbMeasures - 1 ];
-									
-									// Test if values n and n-2 are within a 2% range
-									if ( ( fabs ( d2 - d0 ) / d0 ) < 0.02 )
+									// Check if value n-1 is between values n-2 and n, with value n-1 very near value n (0.2%)
+									// This is the case of asymptotic stabilization.
+									if ( d1 >= min ( d0, d2 ) || d1 <= max ( d0, d2 ) && ( fabs ( d1 - d2 ) / d2 ) < 0.002 )
 									{
-										// Check if value n-1 is outside [n-2,n] interval, and value n-1 and n within a 0.5% range
-										// This is the case of "alternance", eg grow first, then decrease a little to stabilize
-										if ( d1 >= max ( d0, d2 ) || d1 <= min ( d0, d2 ) && ( fabs ( d1 - d2 ) / d2 ) < 0.005 )
+										// This value looks good: perform special checking to increase black measure sensitivity
+										// Test if values are increasing, or if values are not too near black, or if value is decreasing to black with a very small decrease
+										if ( d2 >= d1 || d2 >= 10.0 || ( ( d0 - d2 ) / d2 ) < 0.0001 )
 										{
-											// Ok: use average between the two last measures
-											m_MeasuredLuxValue = ( d2 + d1 ) / 2.0;
+											// Ok: use the last measured value
+											m_MeasuredLuxValue = d2;
 											m_MeasuredLuxValue_Initial = m_MeasuredLuxValue;
 											m_bLuxMeasureValid = TRUE;
-											m_nFirstValidMeasure = m_NbMeasures - 2;
-										}
-										else 
-										{
-											// Check if value n-1 is between values n-2 and n, with value n-1 very near value n (0.2%)
-											// This is the case of asymptotic stabilization.
-											if ( d1 >= min ( d0, d2 ) || d1 <= max ( d0, d2 ) && ( fabs ( d1 - d2 ) / d2 ) < 0.002 )
-											{
-												// This value looks good: perform special checking to increase black measure sensitivity
-												// Test if values are increasing, or if values are not too near black, or if value is decreasing to black with a very small decrease
-												if ( d2 >= d1 || d2 >= 10.0 || ( ( d0 - d2 ) / d2 ) < 0.0001 )
-												{
-													// Ok: use the last measured value
-													m_MeasuredLuxValue = d2;
-													m_MeasuredLuxValue_Initial = m_MeasuredLuxValue;
-													m_bLuxMeasureValid = TRUE;
-													m_nFirstValidMeasure = m_NbMeasures - 1;
-												}
-											}
+											m_nFirstValidMeasure = m_NbMeasures - 1;
 										}
 									}
 								}
 							}
 						}
+					}
+				}
 
 #ifdef _DEBUG
 char	szBuf [ 256 ];
@@ -1345,23 +1170,76 @@ else
 	sprintf_s ( szBuf, "Luxmeter value: %6f\n", m_CurrentLuxValue );
 OutputDebugString ( szBuf );
 #endif
-					}
-					else
+			}
+			else
+			{
+				m_bLastMeasureOutOfRange = TRUE;
+				m_bFirstMeasureWithNewScaleOk = FALSE;
+				m_NbMeasures = 0;
+				m_bLuxMeasureValid = FALSE;
+			}
+		}
+	}
+
+	LeaveCriticalSection ( & m_LuxCritSec );
+	if ( m_pMainWnd )
+		m_pMainWnd -> PostMessage ( WM_COMMAND, IDM_REFRESH_LUX );
+}
+
+// Measurement journals left by a session that did not end: reopen their last snapshot and replay
+// the readings taken after it
+void CColorHCFRApp::RecoverMeasurementJournals ()
+{
+	CString			strDir, strPath, Msg;
+	HANDLE			hFind;
+	WIN32_FIND_DATA	wfd;
+
+	strDir = GetConfig () -> m_ApplicationPath;
+	strDir += "Recovery\\";
+
+	hFind = FindFirstFile ( strDir + "*.hcj", & wfd );
+	if ( hFind == INVALID_HANDLE_VALUE )
+		return;
+
+	do
+	{
+		std::string					documentPath, snapshotPath, error;
+		std::vector<JournalRecord>	records;
+
+		strPath = strDir + wfd.cFileName;
+		if ( CMeasurementJournal::Read ( (LPCSTR) strPath, documentPath, snapshotPath, records, error )
+			&& GetFileAttributes ( snapshotPath.c_str () ) != INVALID_FILE_ATTRIBUTES )
+		{
+			Msg.Format ( "Measures of %s were not saved before HCFR stopped.\nRecover them?", documentPath.empty () ? "an untitled document" : documentPath.c_str () );
+			if ( AfxMessageBox ( Msg, MB_YESNO | MB_ICONQUESTION ) == IDYES )
+			{
+				CDataSetDoc * pDoc = (CDataSetDoc *) OpenDocumentFile ( snapshotPath.c_str (), FALSE );
+
+				if ( pDoc )
+				{
+					for ( size_t i = 0; i < records.size (); i ++ )
+						pDoc -> m_measure.ApplyJournalRecord ( records [ i ] );
+
+					if ( documentPath.empty () )
 					{
-						m_bLastMeasureOutOfRange = TRUE;
-						m_bFirstMeasureWithNewScaleOk = FALSE;
-						m_NbMeasures = 0;
-						m_bLuxMeasureValid = FALSE;
+						pDoc -> ClearPathName ();
+						pDoc -> SetTitle ( "Recovered" );
 					}
+					else
+						pDoc -> SetPathName ( documentPath.c_str (), FALSE );
+
+					pDoc -> SetModifiedFlag ( TRUE );
+					pDoc -> UpdateAllViews ( NULL, UPD_EVERYTHING );
 				}
 			}
-
-			LeaveCriticalSection ( & m_LuxCritSec );
-			if ( m_pMainWnd )
-				m_pMainWnd -> PostMessage ( WM_COMMAND, IDM_REFRESH_LUX );
 		}
-	}
 
+		DeleteFile ( strPath );
+		if ( ! snapshotPath.empty () )
+			DeleteFile ( snapshotPath.c_str () );
+	} while ( FindNextFile ( hFind, & wfd ) );
+
+	FindClose ( hFind );
 }
 
 void CColorHCFRApp::BeginLuxMeasure ()
@@ -1372,6 +1250,7 @@ void CColorHCFRApp::BeginLuxMeasure ()
 
 		m_bInsideMeasure = TRUE;
 		m_dwMeasureStartTime = GetTickCount ();
+		m_LuxWindowStart = CTraceLog::GetClockUs () / 1000.0;
 
 		m_NbMeasures = 0;
 		m_bLastMeasureOutOfRange = FALSE;
@@ -1393,6 +1272,9 @@ UINT CColorHCFRApp::GetLuxMeasure ( double * pLuxValue )
 	UINT	nReturnCode;
 	BOOL	bContinue;
 
+	if ( m_bInsideMeasure && m_bLuxMatchWindow )
+		return GetMatchedLuxMeasure ( pLuxValue );
+
 	if ( m_bInsideMeasure )
 	{
 		do
@@ -1488,6 +1370,102 @@ UINT CColorHCFRApp::GetLuxMeasure ( double * pLuxValue )
 	return nReturnCode;
 }
 
+// Luxmeter value for the colorimeter reading that began with BeginLuxMeasure and ends now:
+// the average of the luxmeter readings taken during it, or the first one after it began
+// when it was shorter than a luxmeter reading
+UINT CColorHCFRApp::GetMatchedLuxMeasure ( double * pLuxValue )
+{
+	UINT		nReturnCode = LUXMETER_NOT_RUNNING;
+	BOOL		bContinue;
+	LuxSample	sample;
+	double		dWindowEnd = CTraceLog::GetClockUs () / 1000.0;
+
+	* pLuxValue = 0.0;
+
+	do
+	{
+		bContinue = FALSE;
+
+		if ( m_bLastMeasureOutOfRange )
+		{
+			// Advisor dialog is displayed: wait for a reading within range, the reader drops
+			// the stale one sent just after a scale change
+			if ( ! m_LuxSamples.GetLatest ( sample ) )
+				sample.timeMs = 0.0;
+
+			if ( sample.timeMs > m_LuxWindowStart && ! sample.bLow && ! sample.bHigh )
+			{
+				nReturnCode = LUXMETER_NEW_SCALE_OK;
+				m_bInsideMeasure = FALSE;
+				m_bLastMeasureOutOfRange = FALSE;
+			}
+			else if ( ! IsLuxmeterRunning () )
+			{
+				nReturnCode = LUXMETER_NOT_RUNNING;
+				m_bInsideMeasure = FALSE;
+			}
+			else if ( sample.bLow )
+				nReturnCode = ( sample.bLowestScale ? LUXMETER_SCALE_TOO_HIGH_MIN : LUXMETER_SCALE_TOO_HIGH );
+			else
+				nReturnCode = ( sample.bHighestScale ? LUXMETER_SCALE_TOO_LOW_MAX : LUXMETER_SCALE_TOO_LOW );
+		}
+		else
+		{
+			switch ( m_LuxSamples.Match ( m_LuxWindowStart, dWindowEnd, m_LuxIntegrationTime, sample ) )
+			{
+				case CLuxSampleBuffer::MATCH_OK:
+					 * pLuxValue = sample.lux;
+					 nReturnCode = LUXMETER_OK;
+					 m_bInsideMeasure = FALSE;
+					 break;
+
+				case CLuxSampleBuffer::MATCH_PENDING:
+					 if ( IsLuxmeterRunning () )
+					 {
+						// The first reading after the window began is still on its way
+						bContinue = TRUE;
+					 }
+					 else
+					 {
+						nReturnCode = LUXMETER_NOT_RUNNING;
+						m_bInsideMeasure = FALSE;
+					 }
+					 break;
+
+				case CLuxSampleBuffer::MATCH_UNDER_RANGE:
+					 nReturnCode = ( sample.bLowestScale ? LUXMETER_SCALE_TOO_HIGH_MIN : LUXMETER_SCALE_TOO_HIGH );
+					 m_bLastMeasureOutOfRange = TRUE;
+					 m_LuxWindowStart = sample.timeMs;
+					 break;
+
+				case CLuxSampleBuffer::MATCH_OVER_RANGE:
+					 nReturnCode = ( sample.bHighestScale ? LUXMETER_SCALE_TOO_LOW_MAX : LUXMETER_SCALE_TOO_LOW );
+					 m_bLastMeasureOutOfRange = TRUE;
+					 m_LuxWindowStart = sample.timeMs;
+					 break;
+			}
+
+			// Stop measuring when totally out of range
+			if ( nReturnCode == LUXMETER_SCALE_TOO_LOW_MAX || nReturnCode == LUXMETER_SCALE_TOO_HIGH_MIN )
+				m_bInsideMeasure = FALSE;
+		}
+
+		if ( bContinue )
+		{
+			// Sleep 20 ms while dispatching messages
+			MSG	Msg;
+			Sleep(20);
+			while(PeekMessage(& Msg, NULL, NULL, NULL, PM_REMOVE))
+			{
+				TranslateMessage ( & Msg );
+				DispatchMessage ( & Msg );
+			}
+		}
+	} while ( bContinue );
+
+	return nReturnCode;
+}
+
 BOOL CAboutDlg::OnInitDialog() 
 {
 	CDialog::OnInitDialog();
@@ -38,6 +38,7 @@
 #include "HelpID.h"
 #include "Color.h"
 #include "CrashDump.h"
+#include "LuxMeter.h"
 
 // Return codes for CColorHCFRApp::GetLuxMeasure
 
@@ -116,6 +117,7 @@ public:
 	// CIE Bitmaps handling
 	HANDLE	m_hCIEThread;	// Background thread creating bitmaps
 	HANDLE	m_hCIEEvent;	// Event set when bitmaps are created
+	UINT	m_nCIEBitmapsVersion;	// Changes each time the bitmaps are created
 
 	// CIE Bitmaps (xy)
 	CBitmap m_chartBitmap;
@@ -148,20 +150,28 @@ public:
 	// LX-1108 luxmeter handling
 	void StartLuxMeasures ();
 	BOOL IsLuxmeterRunning ();
-	void SetLuxmeterValue ( LPCSTR lpszString, DWORD dwStartTick );
+	void SetLuxmeterValue ( const LuxSample & sample );
+
+	void RecoverMeasurementJournals ();
 
 	void BeginLuxMeasure ();
 	UINT GetLuxMeasure ( double * pLuxValue );
+	UINT GetMatchedLuxMeasure ( double * pLuxValue );
 	virtual int Run();
 
 	// Luxmeter connection handling
-	HANDLE	m_hLuxThread;		// Background thread handling luxmeter
-	BOOL	m_bStopLuxThread;	// Flag used to stop background thread
+	CLuxSampleBuffer	m_LuxSamples;	// Timestamped readings, filled by the reader thread
+	CLuxMeterReader		m_LuxReader;	// Background thread handling luxmeter
 	CString	m_LuxPort;			// COM port, empty when no luxmeter to handle
 
+	// Readings matched to the colorimeter reading time instead of waiting
+	// for the luxmeter to stabilize
+	BOOL				m_bLuxMatchWindow;
+	double				m_LuxIntegrationTime;	// ms covered by one luxmeter reading
+	double				m_LuxWindowStart;		// CTraceLog clock, ms
+
 	// Luxmeter values
 	CRITICAL_SECTION	m_LuxCritSec;
-	char				m_RefLuxParams [ 2 ];
 	double				m_CurrentLuxValue;
 	BOOL				m_bLowLuxValue;
 	BOOL				m_bHighLuxValue;
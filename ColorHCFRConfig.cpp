@@ -29,8 +29,10 @@
 #include "DocEnumerator.h"
 #include "LangSelection.h"
 #include "HtmlHelp.h"
+#include "PatchSetFile.h"
 #include <io.h>
 #include <sstream>
+#include <set>
 
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -247,6 +249,7 @@ void CColorHCFRConfig::InitDefaults()
 	m_whiteTarget=D65;
 	m_bDisplayTestColors=TRUE;
 	m_bContinuousMeasures=TRUE;
+	m_bLiveAdjust=FALSE;
 	m_bDetectPrimaries=FALSE;
 	m_isSettling=FALSE;
 	m_useHSV=FALSE;
@@ -322,6 +325,7 @@ void CColorHCFRConfig::InitDefaults()
 	m_TBViewsMiddleClickMode = 1;
 	m_bConfirmMeasures = TRUE;
 	m_bUseOnlyPrimaries = FALSE;
+	m_bUseMultiPatchMatrix = FALSE;
 	m_bUseImperialUnits = FALSE;
 	m_nLuminanceCurveMode = 0;
 	m_bPreferLuxmeter = FALSE;
@@ -348,6 +352,7 @@ BOOL CColorHCFRConfig::LoadSettings()
 	m_whiteTarget=(WhiteTarget)GetProfileInt("References","WhiteTarget",D65);
 	m_bDisplayTestColors=GetProfileInt("References","DisplayTestColors",1);
 	m_bContinuousMeasures=GetProfileInt("References","ContinuousMeasures",1);
+	m_bLiveAdjust=GetProfileInt("References","LiveAdjust",0);
 	m_isSettling=GetProfileInt("References","isSettling",0);
 	m_bDetectPrimaries=GetProfileInt("References","DetectPrimaries",1);
 	m_useHSV=GetProfileInt("References","UseHSV",0);
@@ -416,6 +421,7 @@ BOOL CColorHCFRConfig::LoadSettings()
 	m_TBViewsMiddleClickMode = GetProfileInt("Advanced","TBViewsMiddleClickMode",1);
 	m_bConfirmMeasures = GetProfileInt("Advanced","ConfirmMeasures",1);
 	m_bUseOnlyPrimaries = GetProfileInt("Advanced","UseOnlyPrimaries",0);
+	m_bUseMultiPatchMatrix = GetProfileInt("Advanced","UseMultiPatchMatrix",0);
 	doHighlight = GetProfileInt("Advanced","Highlight",1);
 	m_bUseImperialUnits = GetProfileInt("Advanced","UseImperialUnits",0);
 	m_nLuminanceCurveMode = GetProfileInt("Advanced","LuminanceCurveMode",0);
@@ -462,6 +468,7 @@ void CColorHCFRConfig::SaveSettings()
 	WriteProfileInt("References","DisplayTestColors",m_bDisplayTestColors);
 	WriteProfileInt("References","UseHSV",m_useHSV);
 	WriteProfileInt("References","ContinuousMeasures",m_bContinuousMeasures);
+	WriteProfileInt("References","LiveAdjust",m_bLiveAdjust);
 	WriteProfileInt("References","DetectPrimaries",m_bDetectPrimaries);
 	WriteProfileInt("References","isSettling",m_isSettling);
 	WriteProfileInt("References","IrisLatencyTime",m_latencyTime);
@@ -509,6 +516,7 @@ void CColorHCFRConfig::SaveSettings()
 	WriteProfileInt("Advanced","TBViewsMiddleClickMode",m_TBViewsMiddleClickMode);
 	WriteProfileInt("Advanced","ConfirmMeasures",m_bConfirmMeasures);
 	WriteProfileInt("Advanced","UseOnlyPrimaries",m_bUseOnlyPrimaries);
+	WriteProfileInt("Advanced","UseMultiPatchMatrix",m_bUseMultiPatchMatrix);
 	WriteProfileInt("Advanced","Highlight",doHighlight);
 	WriteProfileInt("Advanced","UseImperialUnits",m_bUseImperialUnits);
 	WriteProfileInt("Advanced","LuminanceCurveMode",m_nLuminanceCurveMode);
@@ -623,6 +631,7 @@ void CColorHCFRConfig::SetPropertiesSheetValues()
 	m_advancedPropertiesPage.m_bConfirmMeasures = m_bConfirmMeasures;
 	m_advancedPropertiesPage.m_comPort = GetColorApp() -> m_LuxPort;
 	m_advancedPropertiesPage.m_bUseOnlyPrimaries = m_bUseOnlyPrimaries;
+	m_advancedPropertiesPage.m_bUseMultiPatchMatrix = m_bUseMultiPatchMatrix;
 	m_advancedPropertiesPage.doHighlight = doHighlight;
 	m_advancedPropertiesPage.m_bUseImperialUnits = m_bUseImperialUnits;
 	m_advancedPropertiesPage.m_nLuminanceCurveMode = m_nLuminanceCurveMode;
@@ -747,6 +756,7 @@ BOOL CColorHCFRConfig::GetPropertiesSheetValues()
 	m_TBViewsMiddleClickMode = m_toolbarPropertiesPage.m_TBViewsMiddleClickMode;
 	m_bConfirmMeasures = m_advancedPropertiesPage.m_bConfirmMeasures;
 	m_bUseOnlyPrimaries = m_advancedPropertiesPage.m_bUseOnlyPrimaries;
+	m_bUseMultiPatchMatrix = m_advancedPropertiesPage.m_bUseMultiPatchMatrix;
 	doHighlight = m_advancedPropertiesPage.doHighlight;
 	m_bUseImperialUnits = m_advancedPropertiesPage.m_bUseImperialUnits;
 	m_nLuminanceCurveMode = m_advancedPropertiesPage.m_nLuminanceCurveMode;
@@ -982,12 +992,11 @@ void CColorHCFRConfig::EnsurePathExists ( CString strPath )
 	CreateDirectory ( strPath, NULL );
 }
 
-std::vector<int> cTargetR;
-std::vector<int> cTargetG;
-std::vector<int> cTargetB;
+std::vector<ColorRGBDisplay> cTarget;
 std::vector<std::string> cTargetN;
 std::string nFile;
 int numCC = 0;
+std::set<std::string> badCCFiles;	// reported already
 
 void CColorHCFRConfig::GetCColors() 
 {
@@ -1092,46 +1101,35 @@ void CColorHCFRConfig::GetCColors()
 				fName = strcat(appPath, "\\color\\LG_2021_HDR10_22_Point_Luminance.csv");
 				break;
 			}
-			ifstream colorFile(fName);
-            std::string line;
-            int cnt = 0;
-            int n1,n2,n3;
-			std::string n4;
-			cTargetR.clear();
-			cTargetG.clear();
-			cTargetB.clear();
+			// parsed once and shared with GenerateCC24Colors until the file changes
+			CPatchSetFile patchSet;
+			cTarget.clear();
 			cTargetN.clear();
+			nFile.clear();
+			numCC = 0;
 
-			if (colorFile.good()) 
+			if (CPatchSetFile::ReadCached((LPCSTR)fName, patchSet)) 
 			{
-				while( getline(colorFile, line) && cnt < MAX_USER_CC_PATCH_SIZE)
-		        {
-					std::istringstream s(line);
-					std::string field;
-					s >> n1;
-					getline(s, field,',');
-					s >> n2;
-					getline(s, field,',');
-					s >> n3;
-					getline(s, field,',');
-					getline(s, n4, ',');
-					if (cnt == 0)
-						getline(s, nFile, ',');
-					cTargetR.push_back(n1);
-					cTargetG.push_back(n2);
-					cTargetB.push_back(n3);
-					cTargetN.push_back(n4);
-	                ++cnt;
-		        }
+				badCCFiles.erase((LPCSTR)fName);
+				int cnt = min(patchSet.GetSize(), MAX_USER_CC_PATCH_SIZE);
+				cTarget.assign(patchSet.GetColors().begin(), patchSet.GetColors().begin() + cnt);
+				for (int i = 0; i < cnt; i++)
+					cTargetN.push_back(patchSet.GetName(i));
+				nFile = patchSet.GetDescription();
 				numCC = cnt;
-				colorFile.close();
+			}
+			else if (!patchSet.GetErrors().empty() && patchSet.GetErrors()[0].line > 0 && badCCFiles.insert((LPCSTR)fName).second)
+			{
+				CString Msg;
+				Msg.Format("Can't read patches from %s\n%s", (LPCSTR)fName, patchSet.GetErrorString().c_str());
+				MessageBox(NULL, Msg, "HCFR", MB_ICONERROR | MB_OK);
 			}
 }
 
 ColorRGB CColorHCFRConfig::GetCColorsT(int index) 
 {
-	if (!cTargetR.empty())
-			return ColorRGB(	( (cTargetR[index] -16) / 219.)	, (	(cTargetG[index] - 16) / 219.) , ( (cTargetB[index] - 16) /219. ) );
+	if (index >= 0 && index < (int)cTarget.size())
+			return ColorRGB( cTarget[index][0] / 100., cTarget[index][1] / 100., cTarget[index][2] / 100. );
 	else
 			return ColorRGB( 0.5, 0.5, 0.5 );
 }
@@ -1140,8 +1138,10 @@ std::string CColorHCFRConfig::GetCColorsN(int index)
 {
 			if (index == -1)
 			 return nFile;
-			else
+			else if (index >= 0 && index < (int)cTargetN.size())
 		     return cTargetN[index];
+			else
+			 return "";
 }
 
 int CColorHCFRConfig::GetCColorsSize() 
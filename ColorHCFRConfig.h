@@ -69,6 +69,7 @@ public:
 	WhiteTarget m_whiteTarget;
 	BOOL m_bDisplayTestColors;
 	BOOL m_bContinuousMeasures;
+	BOOL m_bLiveAdjust;
 	BOOL m_bDetectPrimaries;
 	BOOL m_isSettling;
 	BOOL m_useHSV;
@@ -134,6 +135,7 @@ public:
 	int		m_TBViewsMiddleClickMode;
 	BOOL	m_bConfirmMeasures;
 	BOOL	m_bUseOnlyPrimaries;
+	BOOL	m_bUseMultiPatchMatrix;		// Fit the sensor matrix on every patch measured by both documents
 	BOOL	m_bUseImperialUnits;
 	int		m_nLuminanceCurveMode;
 	BOOL	m_bPreferLuxmeter;
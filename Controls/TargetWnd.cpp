@@ -50,6 +50,7 @@ CTargetWnd::CTargetWnd()
 	m_prev_cx = -1; 
 	m_prev_cy = -1; 
 	m_pRefColor = NULL;
+	m_bTargetCached = FALSE;
 	pTooltipText = NULL;
     m_pDocument = NULL;
 	centerXYZ = GetColorReference().GetWhite();
@@ -77,8 +78,18 @@ void CTargetWnd::Refresh(BOOL m_b16_235, int minCol, int nSize, int m_DisplayMod
 			int		y1 = 0, y2 = 0, y3 = 0;
 			double	x1, x2, x3, p1, p2, p3, z1, z2, z3;
 			ColorRGBDisplay	GenColors [MAX_USER_CC_PATCH_SIZE + 10];
+
+			// Live readouts refresh several times per second on the same patch: keep the
+			// target rather than regenerate the pattern tables and references each time.
+			// Detected primaries depend on the reading itself.
+			int		key [ 6 ] = { minCol, nSize, m_DisplayMode, GetConfig()->m_colorStandard, GetConfig()->m_GammaOffsetType, GetConfig()->m_CCMode };
+			BOOL	bCacheable = ! ( m_DisplayMode == 1 && GetConfig()->m_bDetectPrimaries && DVD );
 		
-			if ((m_DisplayMode == 0 || m_DisplayMode == 2 || m_DisplayMode == 3 || m_DisplayMode == 4 ))
+			if ( bCacheable && m_bTargetCached && memcmp ( key, m_targetKey, sizeof ( key ) ) == 0 )
+			{
+				// centerXYZ, nR, nG, nB and m_clr already hold this target
+			}
+			else if ((m_DisplayMode == 0 || m_DisplayMode == 2 || m_DisplayMode == 3 || m_DisplayMode == 4 ))
 			{
 				centerXYZ = GetColorReference().GetWhite();
 	            if (nSize > 0)
@@ -730,6 +741,9 @@ void CTargetWnd::Refresh(BOOL m_b16_235, int minCol, int nSize, int m_DisplayMod
 				}
 			}
 
+			memcpy ( m_targetKey, key, sizeof ( key ) );
+			m_bTargetCached = bCacheable;
+
 		//Update test window for display when selected
 		BOOL		bDisplayColor = GetConfig () -> m_bDisplayTestColors;
 
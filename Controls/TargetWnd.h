@@ -65,11 +65,17 @@ public:
 	enum { TARGET_TESTWINDOW = - 1, TARGET_ALL = 0, TARGET_TARGET = 1 };
 
 	void Refresh(BOOL m_b16_235, int minCol, int nSize, int m_DisplayMode, CDataSetDoc * pDoc, int target);
+	// Measures other than appended ones may move the targets
+	void InvalidateTarget() { m_bTargetCached = FALSE; }
 
 protected:
 	int m_prev_cx; 
 	int m_prev_cy; 
 
+	// Inputs of the target held in centerXYZ, nR, nG, nB and m_clr
+	BOOL m_bTargetCached;
+	int m_targetKey[6];
+
 	void MakeBgBitmap();
 	void UpdateScaledBitmap();
 	double GetZoomFactor();
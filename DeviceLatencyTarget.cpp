@@ -0,0 +1,166 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// DeviceLatencyTarget.cpp: implementation of the CDeviceLatencyTarget class.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "ColorHCFR.h"
+#include "DeviceLatencyTarget.h"
+#include "Sensor.h"
+#include "Generator.h"
+
+#ifdef _DEBUG
+#undef THIS_FILE
+static char THIS_FILE[]=__FILE__;
+#define new DEBUG_NEW
+#endif
+
+CDeviceLatencyTarget::CDeviceLatencyTarget(CSensor * pSensor, CGenerator * pGenerator)
+	: m_pSensor ( pSensor ), m_pGenerator ( pGenerator ), m_level ( 0.0 )
+{
+	QueryPerformanceFrequency ( & m_frequency );
+}
+
+std::string CDeviceLatencyTarget::GetName() const
+{
+	CString	strName = m_pSensor -> GetName () + ", " + m_pGenerator -> GetName ();
+	return (LPCSTR) strName;
+}
+
+bool CDeviceLatencyTarget::ShowLevel(double level)
+{
+	m_level = level;
+	return m_pGenerator -> DisplayRGBColor ( ColorRGBDisplay ( level ), CGenerator::MT_UNKNOWN ) != FALSE;
+}
+
+bool CDeviceLatencyTarget::ReadY(double& Y)
+{
+	CColor	measuredColor = m_pSensor -> MeasureColor ( ColorRGBDisplay ( m_level ) );
+
+	if ( ! m_pSensor -> IsMeasureValid () || ! measuredColor.isValid () )
+		return false;
+	Y = measuredColor.GetY ();
+	return true;
+}
+
+double CDeviceLatencyTarget::GetClockMs()
+{
+	LARGE_INTEGER	now;
+
+	QueryPerformanceCounter ( & now );
+	return (double) now.QuadPart * 1000.0 / (double) m_frequency.QuadPart;
+}
+
+void CDeviceLatencyTarget::WaitMs(double ms)
+{
+	if ( ms > 0.0 )
+		Sleep ( (DWORD) ms );
+}
+
+void CDeviceLatencyTarget::ShowWhite(void * context)
+{
+	( (CDeviceLatencyTarget *) context ) -> ShowLevel ( 100.0 );
+}
+
+bool CDeviceLatencyTarget::MeasureUpdateDelay(int& updateDelayMs, int& instrumentDelayMs)
+{
+	// The probe watches black change to white
+	if ( ! ShowLevel ( 0.0 ) )
+		return false;
+	return m_pSensor -> measureUpdateDelay ( ShowWhite, this, updateDelayMs, instrumentDelayMs );
+}
+
+namespace
+{
+	struct LatencyThreadParams
+	{
+		CDeviceLatencyTarget *					pTarget;
+		const LatencyCharacterisationConfig *	pConfig;
+		CDisplayLatencyProfile *				pProfile;
+		std::string								error;
+		bool									bOk;
+	};
+
+	UINT __cdecl LatencyThreadFunc ( LPVOID lpParameter )
+	{
+		LatencyThreadParams * pParams = (LatencyThreadParams *) lpParameter;
+
+		pParams -> bOk = CharacteriseDisplayLatency ( * pParams -> pTarget, * pParams -> pConfig, * pParams -> pProfile, pParams -> error );
+		return 0;
+	}
+}
+
+bool CharacteriseDeviceLatency(CSensor * pSensor, CGenerator * pGenerator,
+							   const LatencyCharacterisationConfig & config,
+							   CDisplayLatencyProfile & profile, std::string & error)
+{
+	if ( pGenerator -> Init () != TRUE )
+	{
+		error = "can't initialize the generator";
+		return false;
+	}
+	if ( pSensor -> Init ( FALSE ) != TRUE )
+	{
+		pGenerator -> Release ();
+		error = "can't initialize the sensor";
+		return false;
+	}
+	pSensor -> setFastReadings ( true );
+	// Neither the current profile nor the fixed wait may delay the patterns being timed
+	pGenerator -> m_bNoSettleWait = TRUE;
+
+	CDeviceLatencyTarget	target ( pSensor, pGenerator );
+	LatencyThreadParams		params;
+
+	params.pTarget = & target;
+	params.pConfig = & config;
+	params.pProfile = & profile;
+	params.bOk = false;
+
+	CWinThread * pThread = AfxBeginThread ( LatencyThreadFunc, & params, THREAD_PRIORITY_NORMAL, 0, CREATE_SUSPENDED );
+	if ( pThread )
+	{
+		pThread -> m_bAutoDelete = FALSE;
+		pThread -> ResumeThread ();
+
+		// The pattern window belongs to this thread, keep it painting
+		CWnd * pMainWnd = AfxGetMainWnd ();
+		pMainWnd -> EnableWindow ( FALSE );
+		while ( MsgWaitForMultipleObjects ( 1, & pThread -> m_hThread, FALSE, INFINITE, QS_ALLINPUT ) != WAIT_OBJECT_0 )
+		{
+			MSG	Msg;
+			while ( PeekMessage ( & Msg, NULL, 0, 0, PM_REMOVE ) )
+			{
+				TranslateMessage ( & Msg );
+				DispatchMessage ( & Msg );
+			}
+		}
+		pMainWnd -> EnableWindow ( TRUE );
+		delete pThread;
+	}
+	else
+		params.error = "can't start the characterisation thread";
+
+	pGenerator -> m_bNoSettleWait = FALSE;
+	pSensor -> setFastReadings ( false );
+	pSensor -> Release ();
+	pGenerator -> Release ();
+
+	error = params.error;
+	return params.bOk;
+}
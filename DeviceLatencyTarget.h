@@ -0,0 +1,67 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// DeviceLatencyTarget.h: interface for the CDeviceLatencyTarget class.
+//
+// The display latency characterisation of libHCFR driven through a
+// document's generator and sensor, so that the profile used by the full
+// screen generator can be measured on a real display.
+//////////////////////////////////////////////////////////////////////
+
+#if !defined(AFX_DEVICELATENCYTARGET_H__INCLUDED_)
+#define AFX_DEVICELATENCYTARGET_H__INCLUDED_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "DisplayLatency.h"
+
+class CSensor;
+class CGenerator;
+
+// Sensor and generator must be initialized, and the generator set to show
+// patterns without settling ramp nor wait (m_bNoSettleWait), so that the
+// transitions are timed from the pattern change.
+class CDeviceLatencyTarget : public CLatencyTarget
+{
+public:
+	CDeviceLatencyTarget(CSensor * pSensor, CGenerator * pGenerator);
+
+	virtual std::string GetName() const;
+	virtual bool ShowLevel(double level);
+	virtual bool ReadY(double& Y);
+	virtual double GetClockMs();
+	virtual void WaitMs(double ms);
+	virtual bool MeasureUpdateDelay(int& updateDelayMs, int& instrumentDelayMs);
+
+protected:
+	static void ShowWhite(void * context);
+
+	CSensor *		m_pSensor;
+	CGenerator *	m_pGenerator;
+	double			m_level;
+	LARGE_INTEGER	m_frequency;
+};
+
+// Runs the characterisation on a worker thread, as background measures do,
+// while the calling thread keeps dispatching the messages the pattern window
+// needs. Sensor and generator are initialized and released here.
+bool CharacteriseDeviceLatency(CSensor * pSensor, CGenerator * pGenerator,
+							   const LatencyCharacterisationConfig & config,
+							   CDisplayLatencyProfile & profile, std::string & error);
+
+#endif // !defined(AFX_DEVICELATENCYTARGET_H__INCLUDED_)
@@ -0,0 +1,217 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// DocComparison.cpp: implementation of the CDocComparison class.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "ColorHCFR.h"
+#include "DataSetDoc.h"
+#include "DocEnumerator.h"
+#include "DocComparison.h"
+#include "CHCFile.h"
+#include <fstream>
+
+#ifdef _DEBUG
+#undef THIS_FILE
+static char THIS_FILE[]=__FILE__;
+#define new DEBUG_NEW
+#endif
+
+// Tool functions and variables implemented in DataSetDoc.cpp
+void StopBackgroundMeasures ();
+
+namespace
+{
+	int GetSeriesSize(const CMeasure * pMeasure, int nSeries)
+	{
+		switch ( nSeries )
+		{
+			case COMPARE_GRAYSCALE:		return pMeasure->GetGrayScaleSize();
+			case COMPARE_NEARBLACK:		return pMeasure->GetNearBlackScaleSize();
+			case COMPARE_NEARWHITE:		return pMeasure->GetNearWhiteScaleSize();
+			case COMPARE_PRIMARIES:
+			case COMPARE_SECONDARIES:	return 3;
+			default:					return pMeasure->GetSaturationSize();
+		}
+	}
+
+	CColor GetSeriesColor(const CMeasure * pMeasure, int nSeries, int i)
+	{
+		switch ( nSeries )
+		{
+			case COMPARE_GRAYSCALE:		return pMeasure->GetGray(i);
+			case COMPARE_NEARBLACK:		return pMeasure->GetNearBlack(i);
+			case COMPARE_NEARWHITE:		return pMeasure->GetNearWhite(i);
+			case COMPARE_PRIMARIES:		return pMeasure->GetPrimary(i);
+			case COMPARE_SECONDARIES:	return pMeasure->GetSecondary(i);
+			case COMPARE_REDSAT:		return pMeasure->GetRedSat(i);
+			case COMPARE_GREENSAT:		return pMeasure->GetGreenSat(i);
+			case COMPARE_BLUESAT:		return pMeasure->GetBlueSat(i);
+			case COMPARE_YELLOWSAT:		return pMeasure->GetYellowSat(i);
+			case COMPARE_CYANSAT:		return pMeasure->GetCyanSat(i);
+			default:					return pMeasure->GetMagentaSat(i);
+		}
+	}
+
+	// White luminances used to normalize delta E, as the main view does
+	double GetColorWhiteY(const CMeasure * pMeasure)
+	{
+		if ( pMeasure->GetPrimeWhite().isValid() )
+			return pMeasure->GetPrimeWhite().GetY();
+		if ( pMeasure->GetOnOffWhite().isValid() )
+			return pMeasure->GetOnOffWhite().GetY();
+		return 0.0;
+	}
+
+	double GetGrayWhiteY(const CMeasure * pMeasure)
+	{
+		int nGray = pMeasure->GetGrayScaleSize();
+
+		if ( nGray > 0 && pMeasure->GetGray(nGray-1).isValid() )
+			return pMeasure->GetGray(nGray-1).GetY();
+		return GetColorWhiteY(pMeasure);
+	}
+
+	// Runs on the calling thread: the gamma comes from the document's own fit,
+	// which honours the offset type, EOTF and luminance settings of the views
+	ComparedMeasures GetComparedMeasures(CDataSetDoc * pDoc)
+	{
+		ComparedMeasures	measures;
+		const CMeasure *	pMeasure = pDoc -> GetMeasure ();
+		int					nGray = pMeasure -> GetGrayScaleSize ();
+
+		measures.name = (LPCSTR) pDoc -> GetTitle ();
+		for ( int nSeries = 0; nSeries < COMPARE_SERIES_COUNT; nSeries ++ )
+		{
+			int Size = GetSeriesSize ( pMeasure, nSeries );
+			measures.series [ nSeries ].reserve ( Size );
+			for ( int i = 0; i < Size; i ++ )
+				measures.series [ nSeries ].push_back ( GetSeriesColor ( pMeasure, nSeries, i ).GetXYZValue () );
+		}
+		measures.bIREScaleMode = ( pMeasure -> m_bIREScaleMode != FALSE );
+		measures.grayWhiteY = GetGrayWhiteY ( pMeasure );
+		measures.colorWhiteY = GetColorWhiteY ( pMeasure );
+
+		if ( nGray > 2 && pMeasure -> GetGray ( 0 ).isValid () && pMeasure -> GetGray ( nGray - 1 ).isValid () )
+		{
+			double Gamma, Offset;
+			pDoc -> ComputeGammaAndOffset ( & Gamma, & Offset, 1, 1, nGray, false );
+			measures.gamma = Gamma;
+		}
+		return measures;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+CDocComparison::CDocComparison()
+	: m_comparison ( GetColorReference(), GetConfig()->m_dE_form, GetConfig()->gw_Weight )
+{
+}
+
+CDocComparison::~CDocComparison()
+{
+	RemoveAll ();
+}
+
+void CDocComparison::RemoveAll()
+{
+	// Never opened: no view, sensor, generator nor journal to close
+	for ( size_t i = 0; i < m_loadedDocs.size (); i ++ )
+		delete m_loadedDocs [ i ];
+	m_loadedDocs.clear ();
+	m_docs.clear ();
+	m_comparison.RemoveAll ();
+}
+
+int CDocComparison::AddDocument(CDataSetDoc * pDoc)
+{
+	ASSERT ( pDoc );
+	m_docs.push_back ( pDoc );
+	return (int) m_docs.size () - 1;
+}
+
+int CDocComparison::AddOpenDocuments()
+{
+	CDocEnumerator	docEnumerator;
+	CDocument *		pDoc;
+
+	while ( ( pDoc = docEnumerator.Next () ) != NULL )
+	{
+		if ( pDoc -> IsKindOf ( RUNTIME_CLASS ( CDataSetDoc ) ) )
+			AddDocument ( (CDataSetDoc *) pDoc );
+	}
+	return GetDocumentCount ();
+}
+
+int CDocComparison::LoadDocument(LPCTSTR lpszPathName)
+{
+	// Only the measures are read: unlike OnOpenDocument, the preferences and
+	// reference saved in the file are neither applied nor prompted for
+	CHCFile file ( true );
+
+	try
+	{
+		file.readFile ( lpszPathName );
+	}
+	catch ( ... )
+	{
+		return -1;
+	}
+
+	CDataSetDoc * pDoc = (CDataSetDoc *) RUNTIME_CLASS ( CDataSetDoc ) -> CreateObject ();
+	pDoc -> GetMeasure () -> LoadMeasures ( file );
+	pDoc -> SetPathName ( lpszPathName, FALSE );
+	m_loadedDocs.push_back ( pDoc );
+	return AddDocument ( pDoc );
+}
+
+int CDocComparison::FindDocument(CDataSetDoc * pDoc) const
+{
+	for ( size_t i = 0; i < m_docs.size (); i ++ )
+	{
+		if ( m_docs [ i ] == pDoc )
+			return (int) i;
+	}
+	return -1;
+}
+
+void CDocComparison::Compute(int nRefDoc)
+{
+	// Background measures would modify the arrays while they are read
+	StopBackgroundMeasures ();
+
+	m_comparison = CSeriesComparison ( GetColorReference(), GetConfig()->m_dE_form, GetConfig()->gw_Weight );
+	for ( size_t i = 0; i < m_docs.size (); i ++ )
+		m_comparison.Add ( GetComparedMeasures ( m_docs [ i ] ) );
+	m_comparison.Compute ( nRefDoc );
+}
+
+BOOL CDocComparison::SaveTable(LPCSTR lpszFileName, char cSeparator) const
+{
+	std::ofstream	file ( lpszFileName );
+
+	if ( ! file )
+		return FALSE;
+
+	m_comparison.WriteTable ( file, cSeparator );
+	file.close ();
+	return ! file.fail ();
+}
@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// DocComparison.h: interface for the CDocComparison class.
+//
+// Feeds the measures of documents, opened or loaded from .chc files
+// without any view, to the CSeriesComparison engine of libHCFR.
+//////////////////////////////////////////////////////////////////////
+
+#if !defined(AFX_DOCCOMPARISON_H__INCLUDED_)
+#define AFX_DOCCOMPARISON_H__INCLUDED_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "SeriesComparison.h"
+#include <vector>
+
+class CDataSetDoc;
+
+class CDocComparison
+{
+public:
+	CDocComparison();
+	virtual ~CDocComparison();
+
+	// Frees the documents loaded by LoadDocument
+	void RemoveAll();
+	// Documents are referenced, not copied: they must stay open until Compute is done
+	int AddDocument(CDataSetDoc * pDoc);
+	// Add every opened document, returns the number of documents
+	int AddOpenDocuments();
+	// Load the measures of a .chc file without opening it, returns its index or -1.
+	// The preferences saved in the file are not applied and nothing is asked.
+	int LoadDocument(LPCTSTR lpszPathName);
+	int GetDocumentCount() const { return (int)m_docs.size(); }
+	int FindDocument(CDataSetDoc * pDoc) const;
+
+	// Compare every document against nRefDoc
+	void Compute(int nRefDoc = 0);
+
+	const std::vector<SeriesComparisonResult> & GetResults() const { return m_comparison.GetResults(); }
+	const SeriesComparisonResult * GetResult(int nDoc, int nSeries) const { return m_comparison.GetResult(nDoc, nSeries); }
+
+	// Write all results as one table, one row per document and series
+	BOOL SaveTable(LPCSTR lpszFileName, char cSeparator = ',') const;
+
+protected:
+	std::vector<CDataSetDoc *>	m_docs;
+	std::vector<CDataSetDoc *>	m_loadedDocs;
+	CSeriesComparison			m_comparison;
+};
+
+#endif // !defined(AFX_DOCCOMPARISON_H__INCLUDED_)
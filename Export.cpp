@@ -50,6 +50,7 @@
 #include "MultiFrm.h"
 #include "Views\MainView.h"
 #include "libHCFR\Color.h"
+#include "ArgyllMeterWrapper.h"
 jmp_buf env;
 
 void error_handler  (HPDF_STATUS   error_no,
@@ -100,29 +101,20 @@ draw_image (HPDF_Doc     pdf,
 }
 void
 draw_image2 (HPDF_Doc     pdf,
-            const char  *filename,
+            const CGraphImage & graphImage,
             float        x,
             float        y,
             const char  *text)
 {
-#ifdef __WIN32__
-    const char* FILE_SEPARATOR = "\\";
-#else
-    const char* FILE_SEPARATOR = "/";
-#endif
-    char filename1[255];
-
 	int wX = 300 , wY = 200;
 	HPDF_Page page = HPDF_GetCurrentPage (pdf);
     HPDF_Image image;
-	char * path;
-	path = getenv("APPDATA");
 
-	strcpy(filename1, path);
-    strcat(filename1, FILE_SEPARATOR);
-    strcat(filename1, filename);
+	if ( ! graphImage.IsValid () )
+		return;
 
-    image = HPDF_LoadPngImageFromFile (pdf, filename1);
+	/* Graph pictures are rendered in memory, no need for a png round trip */
+    image = HPDF_LoadRawImageFromMem (pdf, & graphImage.m_Pixels [ 0 ], graphImage.m_Width, graphImage.m_Height, HPDF_CS_DEVICE_RGB, 8);
 
     /* Draw image to the canvas. */
     HPDF_Page_DrawImage (page, image, x, y, wX, wY);
@@ -716,8 +708,9 @@ bool CExport::SavePDF()
 	MemDC.SelectObject(&Bmp);
 	MemDC2.SelectObject(&Bmp);
 	pRGB.m_graphCtrl.DrawGraphs(&MemDC, Rect);
-	pRGB.m_graphCtrl.SaveGraphs(&pRGB.m_graphCtrl2, NULL, NULL, FALSE, 1);	
-	draw_image2(pdf, "color\\temp.png", 6, HPDF_Page_GetHeight (page) - 320, "Grayscale/Grayscale dE");
+	CGraphImage graphImage;
+	pRGB.m_graphCtrl.SaveGraphs(&pRGB.m_graphCtrl2, NULL, NULL, FALSE, 1, &graphImage);	
+	draw_image2(pdf, graphImage, 6, HPDF_Page_GetHeight (page) - 320, "Grayscale/Grayscale dE");
 
 	//Gamma-CT graph
 
@@ -742,28 +735,21 @@ bool CExport::SavePDF()
 
 	if (isHDR)
 	{
-		pCT.m_graphCtrl.SaveGraphs(&pLUM.m_graphCtrl, NULL, NULL, FALSE, 4);	
-		draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/EOTF");
+		pCT.m_graphCtrl.SaveGraphs(&pLUM.m_graphCtrl, NULL, NULL, FALSE, 4, &graphImage);	
+		draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/EOTF");
 	}
 	else
 	{
-		pCT.m_graphCtrl.SaveGraphs(&pGAMMA.m_graphCtrl, NULL, NULL, FALSE, 2);	
-		draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/Gamma");
+		pCT.m_graphCtrl.SaveGraphs(&pGAMMA.m_graphCtrl, NULL, NULL, FALSE, 2, &graphImage);	
+		draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/Gamma");
 	}
 
-	char * path;
-	char filename1[255];
-	path = getenv("APPDATA");
-    strcpy(filename1, path);
-    strcat(filename1, "\\");
-    strcat(filename1, "color\\temp.png");
-
 //CIE Chart
 	CCIEChartGrapher pCIE;
-	pCIE.SaveGraphFile(m_pDoc,CSize(dX,dY),filename1,2,95,TRUE);
+	pCIE.RenderGraphImage(m_pDoc,CSize(dX,dY),graphImage,TRUE);
 	CColorReference cRef = GetColorReference();
 	CString sName = cRef.standardName.c_str();
-	draw_image2(pdf, "color\\temp.png", 6, HPDF_Page_GetHeight (page) - 320 - 230, "CIE Diagram "+sName);
+	draw_image2(pdf, graphImage, 6, HPDF_Page_GetHeight (page) - 320 - 230, "CIE Diagram "+sName);
 	
 //SATS/LUM Chart
 
@@ -773,9 +759,9 @@ bool CExport::SavePDF()
 	pShift.UpdateGraph(m_pDoc);	
 	pSat.m_graphCtrl.DrawGraphs(&MemDC, Rect);
 	pShift.m_graphCtrl.DrawGraphs(&MemDC2, Rect);
-	pSat.m_graphCtrl.SaveGraphs(&pShift.m_graphCtrl, &pShift.m_graphCtrl2, NULL, FALSE, 3);	
+	pSat.m_graphCtrl.SaveGraphs(&pShift.m_graphCtrl, &pShift.m_graphCtrl2, NULL, FALSE, 3, &graphImage);	
 
-	draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page) - 320 - 230, "Saturation Sweep Luminance/Shifts");
+	draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page) - 320 - 230, "Saturation Sweep Luminance/Shifts");
 
 //Color comparator
 	CColor aColor, aReference;
@@ -1287,8 +1273,9 @@ bool CExport::SavePDF()
 		MemDC.SelectObject(&Bmp);
 		MemDC2.SelectObject(&Bmp);
 		pRGB.m_graphCtrl.DrawGraphs(&MemDC, Rect);
-		pRGB.m_graphCtrl.SaveGraphs(&pRGB.m_graphCtrl2, NULL, NULL, FALSE, 1);	
-		draw_image2(pdf, "color\\temp.png", 6, HPDF_Page_GetHeight (page2) - 320, "Grayscale/Grayscale dE");
+		CGraphImage graphImage;
+		pRGB.m_graphCtrl.SaveGraphs(&pRGB.m_graphCtrl2, NULL, NULL, FALSE, 1, &graphImage);	
+		draw_image2(pdf, graphImage, 6, HPDF_Page_GetHeight (page2) - 320, "Grayscale/Grayscale dE");
 
 		//Gamma-CT graph
 	
@@ -1312,26 +1299,20 @@ bool CExport::SavePDF()
 
 		if (isHDR)
 		{
-			pCT.m_graphCtrl.SaveGraphs(&pLUM.m_graphCtrl, NULL, NULL, FALSE, 4);	
-			draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/EOTF");
+			pCT.m_graphCtrl.SaveGraphs(&pLUM.m_graphCtrl, NULL, NULL, FALSE, 4, &graphImage);	
+			draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/EOTF");
 		}
 		else
 		{
-			pCT.m_graphCtrl.SaveGraphs(&pGAMMA.m_graphCtrl, NULL, NULL, FALSE, 2);	
-			draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/Gamma");
+			pCT.m_graphCtrl.SaveGraphs(&pGAMMA.m_graphCtrl, NULL, NULL, FALSE, 2, &graphImage);	
+			draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page) - 320, "Correlated Color Temperature/Gamma");
 		}
 
 	//CIE Chart
-		char * path;
-		char filename1[255];
-		path = getenv("APPDATA");
-		strcpy(filename1, path);
-		strcat(filename1, "\\");
-		strcat(filename1, "color\\temp.png");
 		CCIEChartGrapher pCIE;
-		pCIE.SaveGraphFile(pDataRef,CSize(dX,dY),filename1,2,95,TRUE);
+		pCIE.RenderGraphImage(pDataRef,CSize(dX,dY),graphImage,TRUE);
 
-		draw_image2(pdf, "color\\temp.png", 6, HPDF_Page_GetHeight (page2) - 320 - 230, "CIE Diagram "+sName);
+		draw_image2(pdf, graphImage, 6, HPDF_Page_GetHeight (page2) - 320 - 230, "CIE Diagram "+sName);
 	
 	//SATS/LUM Chart
 
@@ -1341,9 +1322,9 @@ bool CExport::SavePDF()
 		pShift.UpdateGraph(pDataRef);	
 		pSat.m_graphCtrl.DrawGraphs(&MemDC, Rect);
 		pShift.m_graphCtrl.DrawGraphs(&MemDC2, Rect);
-		pSat.m_graphCtrl.SaveGraphs(&pShift.m_graphCtrl, &pShift.m_graphCtrl2, NULL, FALSE, 3);	
+		pSat.m_graphCtrl.SaveGraphs(&pShift.m_graphCtrl, &pShift.m_graphCtrl2, NULL, FALSE, 3, &graphImage);	
 
-		draw_image2(pdf, "color\\temp.png", 6 + 300, HPDF_Page_GetHeight (page2) - 320 - 230, "Saturation Sweep Luminance/Shifts");
+		draw_image2(pdf, graphImage, 6 + 300, HPDF_Page_GetHeight (page2) - 320 - 230, "Saturation Sweep Luminance/Shifts");
 	//Color comparator
 		CColor aColor, aReference;
 		ColorRGB aMeasure, aRef, WhiteRGB;
@@ -1528,6 +1509,7 @@ bool CExport::SaveSheets()
 	result&=SavePrimariesSheet();
 	result&=SaveCCSheet();
 	result&=SaveSpectralSheet();
+	result&=SaveObserversSheet();
 
 	if(!result)
 	{
@@ -1931,6 +1913,92 @@ bool CExport::SaveSpectralSheet()
 	return result;
 }
 
+// XYZ of the measured spectra under each standard observer, one row per observer
+bool CExport::SaveObserversSheet()
+{
+	CRowArray Rows;
+	bool result=true;
+	int rowNb=1;
+	int i,j,k;
+	const char * spectraName[4]={"Red","Green","Blue","White"};
+	CColor aColor[4];
+	std::vector<CSpectrum> spectra;
+	std::vector<CString> names;
+	std::vector<ColorXYZ> xyz;
+	std::vector<int> obTypes = ArgyllMeterWrapper::getStandardObTypes();
+
+	aColor[0] = m_pDoc->GetMeasure()->GetRedPrimary();
+	aColor[1] = m_pDoc->GetMeasure()->GetGreenPrimary();
+	aColor[2] = m_pDoc->GetMeasure()->GetBluePrimary();
+	aColor[3] = m_pDoc->GetMeasure()->GetOnOffWhite();
+	for (i=0; i<4; i++)
+	{
+		if (aColor[i].HasSpectrum())
+		{
+			spectra.push_back(aColor[i].GetSpectrum());
+			names.push_back(spectraName[i]);
+		}
+	}
+
+	// Nothing measured by a spectrometer
+	if (spectra.empty())
+		return true;
+
+	// All the spectra under one observer are converted in a single batch
+	if (!ArgyllMeterWrapper::spectraToXYZ(spectra, obTypes, xyz))
+	{
+		m_errorStr="Spectral conversion failed";
+		return false;
+	}
+
+	CString SheetOrSeparator="ObserversSheet";
+	CString aFileName;
+	if(m_type == CSV)
+	{
+		aFileName=m_fileName+"."+SheetOrSeparator+".csv";
+		SheetOrSeparator=m_separator;
+	}
+	else
+		aFileName=m_fileName;
+
+	CSpreadSheet observersSS(aFileName, SheetOrSeparator,m_doBackup);
+	observersSS.BeginTransaction();
+
+	Rows.RemoveAll();
+	Rows.Add("Observer");
+	for (j=0;j<(int)names.size();j++)
+	{
+		Rows.Add(names[j]+" X",CRowArray::floatType);
+		Rows.Add(names[j]+" Y",CRowArray::floatType);
+		Rows.Add(names[j]+" Z",CRowArray::floatType);
+	}
+
+	result&=observersSS.AddHeaders(Rows,true);
+
+	if(m_doReplace)
+		rowNb = (m_numToReplace-1)*(int)obTypes.size()+2;
+	else
+		rowNb=observersSS.GetTotalRows()+1;
+
+	for (i=0; i<(int)obTypes.size(); i++)
+	{
+		Rows.RemoveAll();
+		Rows.Add(ArgyllMeterWrapper::getObTypeText(obTypes[i]));
+		for (j=0;j<(int)spectra.size();j++)
+		{
+			for (k=0;k<3;k++)
+				Rows.Add((float)xyz[i*spectra.size()+j][k]);
+		}
+		result&=observersSS.AddRow(Rows,rowNb,m_doReplace);
+		rowNb++;
+	}
+
+	result&=observersSS.Commit();
+	if(!result)
+		m_errorStr=observersSS.GetLastError();
+	return result;
+}
+
 
 bool CExport::SaveCCSheet()
 {
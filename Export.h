@@ -60,6 +60,7 @@ private:
 	bool SavePDF();
 	bool SaveCCSheet();
 	bool SaveSpectralSheet();
+	bool SaveObserversSheet();
 
 public:
 	CExport(CDataSetDoc *pDoc, ExportType type);
@@ -30,6 +30,7 @@
 #include "FullScreenWindow.h"
 #include <math.h>
 #include "ximage.h"
+#include "TraceLog.h"
 //#include "../libnum/numsup.h"
 //#include "../libconv/conv.h"
 //#include "../libccast/ccmdns.h"
@@ -44,6 +45,9 @@
 
 #define ANSI_CONTRAST_BLOCKS	5
 
+// Timer stepping the settling ramp, distinct from the animated pattern timers
+#define SETTLING_TIMER_ID		2
+
 std::vector<CString> patterns;
 std::vector<int> patternsID;
 
@@ -84,6 +88,27 @@ CFullScreenWindow::CFullScreenWindow(BOOL bTestOverlay)
 	m_IdTimer = 0;
 	m_XCurrent = -1;
 
+	// Settling ramp
+	m_bSettlingRequested = FALSE;
+	m_bSettling = FALSE;
+	m_nSettlingStep = 0;
+	m_nSettlingSteps = 85;
+	m_nSettlingStepTime = 55;
+	m_nSettlingProfile = 0;
+	m_settlingColor = 0;
+	m_hSettlingDone = CreateEvent ( NULL, TRUE, TRUE, NULL );
+
+	// Display latency profile
+	m_lastLevel = -1.0;
+	m_bNoSettling = FALSE;
+	CString strLatencyProfile = GetConfig()->GetProfileString("GDIGenerator","LatencyProfile","");
+	if ( ! strLatencyProfile.IsEmpty () )
+	{
+		std::string error;
+		if ( ! m_latencyProfile.Load ( (LPCSTR) strLatencyProfile, error ) )
+			m_latencyProfile.Clear ();
+	}
+
 	// PatternDisplay
 	m_bPatternMode = FALSE;
 	m_clrPattern = ColorRGBDisplay( 0.0 ).GetColorRef(m_b16_235);
@@ -277,6 +302,7 @@ CFullScreenWindow::~CFullScreenWindow()
 	SetDisplayMode (GetConfig()->GetProfileInt("GDIGenerator","DisplayMode",DISPLAY_DEFAULT_MODE));
 
 	DestroyWindow ();
+	CloseHandle ( m_hSettlingDone );
 
 	ASSERT ( m_lpDD == NULL && m_lpDDPrimarySurface == NULL && m_lpDDOverlay == NULL );
 }
@@ -343,6 +369,35 @@ void CFullScreenWindow::DisplayRGBColor(const ColorRGBDisplay& clr, BOOL bDisabl
 	    DisplayRGBColorInternal(clr.GetColorRef(m_b16_235), bDisableWaiting);
 }
 
+void CFullScreenWindow::DisplayRGBColorNoWait(const ColorRGBDisplay& clr)
+{
+	m_nDisplayMode = GetConfig()->GetProfileInt("GDIGenerator","DisplayMode",DISPLAY_DEFAULT_MODE);
+
+	m_bNoSettling = TRUE;
+	DisplayRGBColorInternal(clr.GetColorRef(m_b16_235), TRUE);
+	m_bNoSettling = FALSE;
+
+	// The next profile lookup must not start from a patch shown here
+	m_lastLevel = -1.0;
+}
+
+int CFullScreenWindow::GetLatencyWaitMs(COLORREF clr)
+{
+	int nProfileWait = -1;
+
+	if ( ! m_latencyProfile.IsEmpty () && ( clr & 0xFF000000 ) == 0 )
+	{
+		// Gray equivalent of the patch, to look its transition up in the profile
+		double level = 0.2126 * GetRValue ( clr ) + 0.7152 * GetGValue ( clr ) + 0.0722 * GetBValue ( clr );
+		level = ( m_b16_235 ? ( level - 16.0 ) / 219.0 : level / 255.0 ) * 100.0;
+		level = min ( max ( level, 0.0 ), 100.0 );
+		if ( m_lastLevel >= 0.0 )
+			nProfileWait = m_latencyProfile.GetWaitMs ( m_lastLevel, level );
+		m_lastLevel = level;
+	}
+	return nProfileWait;
+}
+
 void CFullScreenWindow::DisplayRGBColorInternal(COLORREF clr, BOOL bDisableWaiting)
 {
 	int				nColorFlag;
@@ -356,9 +411,13 @@ void CFullScreenWindow::DisplayRGBColorInternal(COLORREF clr, BOOL bDisableWaiti
 	CRect			rect;
 	char			szError [ 256 ];
 	char			szMsg [ 256 ];
+	int				nProfileWait = -1;
 	
 	m_Color = clr;
 
+	if ( ! m_bNoSettling )
+		nProfileWait = GetLatencyWaitMs ( clr );
+
 	double m_rectAreaPercent;
 
 	m_rectAreaPercent = sqrt (m_rectSizePercent / 100.) * 100;
@@ -515,21 +574,43 @@ void CFullScreenWindow::DisplayRGBColorInternal(COLORREF clr, BOOL bDisableWaiti
 		SetCursor ( NULL );
 	
 	Sleep ( 0 );
+	// The paint starts the settling ramp when it is enabled, a ramp still running for
+	// a previous patch is dropped
+	EndSettling ();
+	m_bSettlingRequested = ! m_bNoSettling;
 	this->Invalidate(TRUE);
 	RedrawWindow ();
+	m_bSettlingRequested = FALSE;
 
 	if ( ! bDisableWaiting )
 	{
 		// Sleep 80 ms while dispatching messages to ensure window is really displayed
 		MSG		Msg;
 		HWND	hEscapeWnd = NULL;
-		DWORD	dwWait = GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 );
+		HCFR_TRACE_SPAN("settle", "generator");
+		DWORD	dwWait = ( nProfileWait >= 0 ? nProfileWait : GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 ) );
 		DWORD	dwStart = GetTickCount();
 		DWORD	dwNow = dwStart;
+		DWORD	dwSettlingEnd = dwStart + 2 * m_nSettlingSteps * m_nSettlingStepTime + 1000;
 		
-		// Wait until dwWait time is expired, but ensures all posted messages are treated even if wait time is zero
-		while((dwNow - dwStart) < dwWait)
+		// Wait for the end of the settling ramp, then until dwWait time is expired, but ensures all posted messages are treated even if wait time is zero
+		while(IsSettling() || (dwNow - dwStart) < dwWait)
 		{
+			if ( IsSettling() )
+			{
+				// Sleep until the next ramp step, the timer message is dispatched below
+				// when this is the window thread, or by the window thread otherwise
+				MsgWaitForMultipleObjects ( 1, & m_hSettlingDone, FALSE, m_nSettlingStepTime, QS_ALLINPUT );
+				if ( (int)(GetTickCount() - dwSettlingEnd) > 0 )
+				{
+					// The window thread is not running the ramp, show the patch now
+					EndSettling ();
+					RedrawWindow ();
+				}
+				// The pattern is only displayed once the ramp ends
+				dwStart = GetTickCount();
+			}
+
 			while(PeekMessage(&Msg, NULL, NULL, NULL, PM_REMOVE))
 			{
 				if ( ( Msg.message == WM_KEYDOWN || Msg.message == WM_KEYUP ) && Msg.wParam == VK_ESCAPE )
@@ -1136,6 +1217,7 @@ void CFullScreenWindow::Hide ()
     DDOVERLAYFX	DDOverlayFX;
 
     KillTimer ( m_IdTimer );
+	EndSettling ();
 
 	if ( m_lpDDOverlay )
 	{
@@ -1387,15 +1469,12 @@ void video_scale (CxImage *inImage)
 			}
 		} else if (m_nDisplayMode == DISPLAY_rPI)
 		{
-				typedef int (__stdcall *RB8PG_send)(SOCKET sock,const char *message);
-				RB8PG_send	 _RB8PG_send;
-				SOCKET sock = GetConfig()->GetProfileInt("GDIGenerator", "rPiSock", 0);
 				int rPi_memSize = GetConfig()->GetProfileInt("GDIGenerator", "rPiGPU", 0);
 				int rPi_x = GetConfig()->GetProfileInt("GDIGenerator", "rPiWidth", 1920);
 				int rPi_y = GetConfig()->GetProfileInt("GDIGenerator", "rPiHeight", 1080);
 				if (rPi_memSize >= 192)
 				{
-					if (sock)
+					if (CGenerator::m_rPiClient.IsConnected())
 					{
 						bool isUser=FALSE;
 						CString x,y;
@@ -1452,20 +1531,12 @@ void video_scale (CxImage *inImage)
 							}
 							else
 							{
-								HINSTANCE hInstLibrary;
-								hInstLibrary = LoadLibrary("RB8PGenerator.dll");
-								_RB8PG_send = (RB8PG_send)GetProcAddress(hInstLibrary, "RB8PG_send@8");
-								_RB8PG_send(sock,(Pat+patterns[index]));
-								FreeLibrary(hInstLibrary);
+								CGenerator::m_rPiClient.Send(Pat+patterns[index]);
 							}
 						}
 						else
 						{
-							HINSTANCE hInstLibrary;
-							hInstLibrary = LoadLibrary("RB8PGenerator.dll");
-							_RB8PG_send = (RB8PG_send)GetProcAddress(hInstLibrary, "RB8PG_send@8");
-							_RB8PG_send(sock,Pat);
-							FreeLibrary(hInstLibrary);
+							CGenerator::m_rPiClient.Send(Pat);
 						}
 					}
 					else
@@ -1650,7 +1721,10 @@ void video_scale (CxImage *inImage)
 				const BYTE lvl = m_b16_235 ? (BYTE)(2.19 * GetConfig()->m_ablLevel + 16) : (BYTE)(2.55 * GetConfig()->m_ablLevel);
 				brush.CreateSolidBrush (RGB(lvl, lvl, lvl));
 				dc.FillRect ( &rect_ABL, &brush );
-				Sleep(GetConfig()->m_ablDuration);
+				{
+					HCFR_TRACE_SPAN("ABL", "generator");
+					Sleep(GetConfig()->m_ablDuration);
+				}
 				brush.DeleteObject();
 				DeleteDC(dc1);
 			}
@@ -1710,35 +1784,17 @@ void video_scale (CxImage *inImage)
 			if (!isSpecial)
 			{
 				patternRect.DeflateRect(dWidth/2,dHeight/2);
-				//Settling pattern
-				if (GetConfig()->m_isSettling && GetConfig()->bDisplayRT)
-				{
-					for (int j=0;j<255;j+=3)
-					{
-						CRect settlingRect=patternRect;
-						brush.CreateSolidBrush ( RGB(j,j,j) );
-						dc.FillRect ( &settlingRect, &brush );
-						brush.DeleteObject ();
-						Sleep(55);
-					}
-				}
+				//Settling pattern, the ramp steps are drawn by the settling timer
+				if (m_bSettlingRequested && GetConfig()->m_isSettling && GetConfig()->bDisplayRT)
+					StartSettling ( patternRect, DisplayColor );
 			}
 
-			brush.CreateSolidBrush ( DisplayColor );
+			brush.CreateSolidBrush ( m_bSettling ? GetSettlingColor ( m_nSettlingStep ) : DisplayColor );
 			dc.FillRect ( &patternRect, &brush );
 			brush.DeleteObject (); 
 
-			if ((!isSpecial || m_bAnimated) && m_bdispTrip)
-			{
-	    		char aBuf[32];
-				R = GetRValue(DisplayColor);
-				G = GetGValue(DisplayColor);
-				B = GetBValue(DisplayColor);
-				sprintf(aBuf,"%d:%d:%d",R,G,B);
-				dc.SetTextColor(RGB(128,128,128));
-				dc.SetBkColor(RGB(40,40,40));
-				dc.DrawText(aBuf,&patternRect, DT_CENTER|DT_BOTTOM|DT_SINGLELINE);
-			}
+			if ((!isSpecial || m_bAnimated) && m_bdispTrip && !m_bSettling)
+				DrawTriplets ( &dc, patternRect, DisplayColor );
 		}
 	
 		// Dot Pattern Display
@@ -1962,6 +2018,91 @@ void video_scale (CxImage *inImage)
 	} //if pattern
 }
 
+void CFullScreenWindow::DrawTriplets ( CDC * pDC, CRect & rect, COLORREF clr )
+{
+	char aBuf[32];
+	sprintf(aBuf,"%d:%d:%d",GetRValue(clr),GetGValue(clr),GetBValue(clr));
+	pDC -> SetTextColor(RGB(128,128,128));
+	pDC -> SetBkColor(RGB(40,40,40));
+	pDC -> DrawText(aBuf,&rect, DT_CENTER|DT_BOTTOM|DT_SINGLELINE);
+}
+
+// Settling ramp profiles:
+//	0	gray, black to white
+//	1	gray, white to black
+//	2	black to the patch color
+COLORREF CFullScreenWindow::GetSettlingColor ( int nStep ) const
+{
+	double	fraction = (double) nStep / m_nSettlingSteps;
+	int		level = (int) ( 255 * fraction );
+
+	switch ( m_nSettlingProfile )
+	{
+		case 1:
+			return RGB ( 255 - level, 255 - level, 255 - level );
+		case 2:
+			return RGB ( (int) ( GetRValue ( m_settlingColor ) * fraction ), (int) ( GetGValue ( m_settlingColor ) * fraction ), (int) ( GetBValue ( m_settlingColor ) * fraction ) );
+		default:
+			return RGB ( level, level, level );
+	}
+}
+
+void CFullScreenWindow::StartSettling ( const CRect & rect, COLORREF clr )
+{
+	// Read at each patch, like the other paint settings
+	m_nSettlingSteps = max ( 1, (int) GetConfig()->GetProfileInt ( "GDIGenerator", "SettlingSteps", 85 ) );
+	m_nSettlingStepTime = max ( 1, (int) GetConfig()->GetProfileInt ( "GDIGenerator", "SettlingStepTime", 55 ) );
+	m_nSettlingProfile = GetConfig()->GetProfileInt ( "GDIGenerator", "SettlingProfile", 0 );
+
+	m_settlingRect = rect;
+	m_settlingColor = clr;
+	m_nSettlingStep = 0;
+	m_bSettling = TRUE;
+	ResetEvent ( m_hSettlingDone );
+	SetTimer ( SETTLING_TIMER_ID, m_nSettlingStepTime, NULL );
+}
+
+void CFullScreenWindow::StepSettling ()
+{
+	if ( ! m_bSettling )
+	{
+		KillTimer ( SETTLING_TIMER_ID );
+		return;
+	}
+
+	CDC *	pDC = GetDC ();
+	CBrush	brush;
+	BOOL	bLastStep = ( ++ m_nSettlingStep >= m_nSettlingSteps );
+
+	// The last step shows the patch itself
+	brush.CreateSolidBrush ( bLastStep ? m_settlingColor : GetSettlingColor ( m_nSettlingStep ) );
+	pDC -> FillRect ( & m_settlingRect, & brush );
+	brush.DeleteObject ();
+
+	if ( bLastStep )
+	{
+		if ( m_bdispTrip )
+			DrawTriplets ( pDC, m_settlingRect, m_settlingColor );
+		EndSettling ();
+	}
+	ReleaseDC ( pDC );
+}
+
+void CFullScreenWindow::EndSettling ()
+{
+	if ( m_bSettling )
+	{
+		KillTimer ( SETTLING_TIMER_ID );
+		m_bSettling = FALSE;
+	}
+	SetEvent ( m_hSettlingDone );
+}
+
+BOOL CFullScreenWindow::IsSettling () const
+{
+	return WaitForSingleObject ( m_hSettlingDone, 0 ) == WAIT_TIMEOUT;
+}
+
 void CFullScreenWindow::OnTimer(UINT nIDEvent) 
 {					
 	BOOL			bOk = TRUE;
@@ -1978,6 +2119,12 @@ void CFullScreenWindow::OnTimer(UINT nIDEvent)
 
 //	m_rectAreaPercent = sqrt (m_rectSizePercent / 100.) * 100;
 
+	if ( nIDEvent == SETTLING_TIMER_ID )
+	{
+		StepSettling ();
+		return;
+	}
+
 	if ( m_IdTimer == nIDEvent )
 	{
 		// Initializations
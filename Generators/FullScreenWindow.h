@@ -30,6 +30,7 @@
 #include "../libccast/ccwin.h"
 #include "../libccast/ccast.h"
 #include "../Tools/GoogleCastWrapper/GoogleCastWrapper.h"
+#include "DisplayLatency.h"
 
 // Display modes
 #define DISPLAY_GDI		0
@@ -102,6 +103,7 @@ public:
 
 protected:
 	void DisplayRGBColorInternal(COLORREF clr, BOOL bDisableWaiting);
+	int GetLatencyWaitMs(COLORREF clr);
 	BOOL					m_bAnimated;
 	BOOL					m_bWhite;
 	UINT					m_IdTimer;
@@ -115,6 +117,32 @@ protected:
 	int						m_YMargin;
 	int						m_iOffset;
 
+	// Settling ramp, drawn one step per settling timer tick so that
+	// painting a patch does not block; m_hSettlingDone is set when the
+	// ramp ends and the patch is shown
+	BOOL					m_bSettlingRequested;
+	BOOL					m_bSettling;
+	int						m_nSettlingStep;
+	int						m_nSettlingSteps;
+	UINT					m_nSettlingStepTime;
+	int						m_nSettlingProfile;
+	CRect					m_settlingRect;
+	COLORREF				m_settlingColor;
+	HANDLE					m_hSettlingDone;
+
+	void DrawTriplets ( CDC * pDC, CRect & rect, COLORREF clr );
+	COLORREF GetSettlingColor ( int nStep ) const;
+	void StartSettling ( const CRect & rect, COLORREF clr );
+	void StepSettling ();
+	void EndSettling ();
+	BOOL IsSettling () const;
+
+	// Gray transition timings of the display, when it was characterised,
+	// used instead of the fixed wait after each pattern
+	CDisplayLatencyProfile	m_latencyProfile;
+	double					m_lastLevel;
+	BOOL					m_bNoSettling;
+
 // Operations
 public:
 	void MoveToMonitor ( HMONITOR hMon );
@@ -129,6 +157,10 @@ public:
 	void SetDisplayMode (UINT nMode = DISPLAY_GDI);
 	void SetRGBScale (BOOL b16_235);
 	void DisplayRGBColor(const ColorRGBDisplay& clr, BOOL bDisableWaiting = FALSE );
+	// No settling ramp, no wait and no latency profile: for timing the display itself
+	void DisplayRGBColorNoWait(const ColorRGBDisplay& clr);
+	// Wait after a patch from the latency profile, -1 when there is none
+	int GetLatencyWaitMs(const ColorRGBDisplay& clr) { return GetLatencyWaitMs ( clr.GetColorRef ( m_b16_235 ) ); }
 	void DisplayAnsiBWRects(BOOL bInvert);
 	void DisplayAnimatedBlack();
 	void DisplayAnimatedWhite();
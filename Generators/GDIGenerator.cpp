@@ -33,6 +33,7 @@
 #include "../libccast/ccwin.h"
 #include "../libccast/ccast.h"
 #include "../MainFrm.h"
+#include "TraceLog.h"
 
 #include <string>
 #include <float.h>
@@ -102,6 +103,8 @@ CGDIGenerator::CGDIGenerator()
     m_madVR_OSD = GetConfig()->GetProfileInt("GDIGenerator","MADVROSD",0);
 	m_displayWindow.SetDisplayMode(m_nDisplayMode);	
 //	m_displayWindow.SetDisplayMode();	
+	if (m_nDisplayMode == DISPLAY_ccast)
+		CGoogleCastWrapper::StartDiscovery();
 	m_bisInited = FALSE;
 
 	CString str;
@@ -140,6 +143,8 @@ CGDIGenerator::CGDIGenerator(int nDisplayMode, BOOL b16_235)
 	m_nDisplayMode = nDisplayMode;
 	m_b16_235 = b16_235;
 	m_displayWindow.SetDisplayMode(nDisplayMode);
+	if (m_nDisplayMode == DISPLAY_ccast)
+		CGoogleCastWrapper::StartDiscovery();
 
 	CString str;
 	str.LoadString(IDS_GDIGENERATOR_PROPERTIES_TITLE);
@@ -559,6 +564,16 @@ BOOL CGDIGenerator::Init(UINT nbMeasure, bool isSpecial)
 	return bOk;
 }
 
+DWORD CGDIGenerator::GetSettleWaitMs( const ColorRGBDisplay& clr )
+{
+	if ( m_bNoSettleWait )
+		return 0;
+
+	// The latency profile of the display when it was characterised, the fixed wait otherwise
+	int nProfileWait = m_displayWindow.GetLatencyWaitMs ( clr );
+	return ( nProfileWait >= 0 ? nProfileWait : GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 ) );
+}
+
 BOOL CGDIGenerator::DisplayRGBColormadVR( const ColorRGBDisplay& clr, bool first, UINT nPattern )
 {
 	//init done in generator.cpp 
@@ -607,7 +622,7 @@ BOOL CGDIGenerator::DisplayRGBColormadVR( const ColorRGBDisplay& clr, bool first
 	  madVR_SetOsdText(CT2CW(s2));
 
 	m_nPat++;
-	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL )
+	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL && !m_bNoSettleWait )
 	{
 		double lvl = m_b16_235 ? 2.19 * GetConfig()->m_ablLevel + 16 : 2.55 * GetConfig()->m_ablLevel;
 		//sleep prevention every 40 patterns for longer sequences
@@ -618,7 +633,10 @@ BOOL CGDIGenerator::DisplayRGBColormadVR( const ColorRGBDisplay& clr, bool first
 			return false;
 		}	 
 //		madVR_ShowRGB(.4, .4 , .4);
-		Sleep(GetConfig()->m_ablDuration);
+		{
+			HCFR_TRACE_SPAN("ABL", "generator");
+			Sleep(GetConfig()->m_ablDuration);
+		}
 		madVR_SetPatternConfig(Cgen.m_rectSizePercent, int (bgstim * 100), -1, 20);
 	}
 
@@ -631,7 +649,8 @@ BOOL CGDIGenerator::DisplayRGBColormadVR( const ColorRGBDisplay& clr, bool first
 	// Sleep 80 ms while dispatching messages to ensure window is really displayed
 		MSG		Msg;
 		HWND	hEscapeWnd = NULL;
-		DWORD	dwWait = GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 );
+		HCFR_TRACE_SPAN("settle", "generator");
+		DWORD	dwWait = GetSettleWaitMs ( clr );
 		DWORD	dwStart = GetTickCount();
 		DWORD	dwNow = dwStart;
 		
@@ -715,7 +734,7 @@ BOOL CGDIGenerator::DisplayRGBCCast( const ColorRGBDisplay& clr, bool first, UIN
 	}
 	
 	m_nPat++;
-	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL)
+	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL && !m_bNoSettleWait)
 	{
 		double lvl = m_b16_235 ? 2.19 * GetConfig()->m_ablLevel + 16 : 2.55 * GetConfig()->m_ablLevel;
 		//sleep prevention
@@ -725,7 +744,10 @@ BOOL CGDIGenerator::DisplayRGBCCast( const ColorRGBDisplay& clr, bool first, UIN
 	        MessageBox(0, "CCast Test pattern failure.", "set_color", MB_ICONERROR);
 			return false;
 		}
-		Sleep(GetConfig()->m_ablDuration);
+		{
+			HCFR_TRACE_SPAN("ABL", "generator");
+			Sleep(GetConfig()->m_ablDuration);
+		}
 
 		ccwin->set_bg(ccwin,bgstim);
 	}
@@ -739,7 +761,8 @@ BOOL CGDIGenerator::DisplayRGBCCast( const ColorRGBDisplay& clr, bool first, UIN
 	// Sleep 80 ms while dispatching messages to ensure window is really displayed
 		MSG		Msg;
 		HWND	hEscapeWnd = NULL;
-		DWORD	dwWait = GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 );
+		HCFR_TRACE_SPAN("settle", "generator");
+		DWORD	dwWait = GetSettleWaitMs ( clr );
 		DWORD	dwStart = GetTickCount();
 		DWORD	dwNow = dwStart;
 		
@@ -826,16 +849,20 @@ BOOL CGDIGenerator::DisplayRGBColorrPI( const ColorRGBDisplay& clr, bool first,
 	else
 		y2 = max(y2, -1*(rPi_yHeight / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_yHeight / 2.) );
 
-	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL)
+	// errors of the pipelined commands are reported with the patch
+	int nErrors = m_rPiClient.GetErrorCount();
+
+	if ( (m_nPat % GetConfig()->m_ablFreq == 0) && GetConfig()->m_bABL && !m_bNoSettleWait)
 	{
 		BYTE lvl = m_b16_235 ? (BYTE)(2.19 * GetConfig()->m_ablLevel + 16) : (BYTE)(2.55 * GetConfig()->m_ablLevel);
 		sprintf_s(CPat,"RGB=RECTANGLE;%d,%d;100;%d,%d,%d;%d,%d,%d;-1,-1", (int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_xWidth),(int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_yHeight),lvl,lvl,lvl,0,0,0);
-		if (CGenerator::_RB8PG_send && CPat)
-			CGenerator::_RB8PG_send(sock,CPat);
-		else
+		if (!m_rPiClient.Send(CPat))
 			GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
 
-		Sleep(GetConfig()->m_ablDuration);
+		{
+			HCFR_TRACE_SPAN("ABL", "generator");
+			Sleep(GetConfig()->m_ablDuration);
+		}
 	}
 
 		if (m_brPi_user) //user background
@@ -847,15 +874,21 @@ BOOL CGDIGenerator::DisplayRGBColorrPI( const ColorRGBDisplay& clr, bool first,
 
 	CString debug=_T(CPat);
 
-		if (CGenerator::_RB8PG_send && CPat)
-			CGenerator::_RB8PG_send(sock,CPat);
-		else
+		// the settle time starts once PGenerator has drawn the patch
+		if (!m_rPiClient.Send(CPat) || !m_rPiClient.WaitForReplies(GetConfig () -> GetProfileInt ( "Debug", "rPIReplyTimeout", 5000 )))
 			GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
+		else if (m_rPiClient.GetErrorCount() > nErrors)
+		{
+			CString Msg = "rPI did not display the pattern: ";
+			Msg += m_rPiClient.GetLastError().c_str();
+			GetColorApp()->InMeasureMessageBox( Msg, "Error", MB_ICONINFORMATION);
+		}
 
 	// Sleep 80 ms while dispatching messages to ensure window is really displayed
 		MSG		Msg;
 		HWND	hEscapeWnd = NULL;
-		DWORD	dwWait = GetConfig () -> GetProfileInt ( "Debug", "WaitAfterDisplayPattern", 80 );
+		HCFR_TRACE_SPAN("settle", "generator");
+		DWORD	dwWait = GetSettleWaitMs ( clr );
 		DWORD	dwStart = GetTickCount();
 		DWORD	dwNow = dwStart;
 		
@@ -891,6 +924,7 @@ return TRUE;
 
 BOOL CGDIGenerator::DisplayRGBColor( const ColorRGBDisplay& clr , MeasureType nPatternType , UINT nPatternInfo , BOOL bChangePattern, BOOL bSilentMode)
 {
+	HCFR_TRACE_FUNCTION("generator");
 	ColorRGBDisplay p_clr;
 	BOOL do_Intensity=false;
 	if ( nPatternType == MT_PRIMARY || nPatternType == MT_SECONDARY || nPatternType == MT_SAT_RED || nPatternType == MT_SAT_GREEN || nPatternType == MT_SAT_BLUE || nPatternType == MT_SAT_YELLOW || nPatternType == MT_SAT_CYAN || nPatternType == MT_SAT_MAGENTA || nPatternType == MT_ACTUAL)
@@ -924,19 +958,25 @@ BOOL CGDIGenerator::DisplayRGBColor( const ColorRGBDisplay& clr , MeasureType nP
 			
 			( (CMainFrame *) ( AfxGetApp () -> m_pMainWnd ) ) -> m_wndTestColorWnd.RedrawWindow ();
 			
-			Sleep(GetConfig()->m_ablDuration);
+			{
+				HCFR_TRACE_SPAN("ABL", "generator");
+				Sleep(GetConfig()->m_ablDuration);
+			}
 			( (CMainFrame *) ( AfxGetApp () -> m_pMainWnd ) ) -> m_wndTestColorWnd.SetWindowPlacement(&wp);			
 		}
 		( (CMainFrame *) ( AfxGetApp () -> m_pMainWnd ) ) -> m_wndTestColorWnd.SetForegroundWindow();
 		( (CMainFrame *) ( AfxGetApp () -> m_pMainWnd ) ) -> m_wndTestColorWnd.RedrawWindow ();
 	} else
 	{
+		BOOL bSettling = GetConfig()->m_isSettling && !m_bNoSettleWait;
 		if ( m_GDIGenePropertiesPage.m_nDisplayMode == DISPLAY_madVR)
-			DisplayRGBColormadVR (do_Intensity?p_clr:clr, GetConfig()->m_isSettling, nPatternInfo);
+			DisplayRGBColormadVR (do_Intensity?p_clr:clr, bSettling, nPatternInfo);
 		else if ( m_GDIGenePropertiesPage.m_nDisplayMode == DISPLAY_ccast)
-			DisplayRGBCCast (do_Intensity?p_clr:clr, GetConfig()->m_isSettling, nPatternInfo );
+			DisplayRGBCCast (do_Intensity?p_clr:clr, bSettling, nPatternInfo );
 		else if ( m_GDIGenePropertiesPage.m_nDisplayMode == DISPLAY_rPI)
-			DisplayRGBColorrPI (do_Intensity?p_clr:clr, GetConfig()->m_isSettling, nPatternInfo );
+			DisplayRGBColorrPI (do_Intensity?p_clr:clr, bSettling, nPatternInfo );
+		else if ( m_bNoSettleWait )
+			m_displayWindow.DisplayRGBColorNoWait(do_Intensity?p_clr:clr);
 		else
 			m_displayWindow.DisplayRGBColor(do_Intensity?p_clr:clr, nPatternInfo);
 	}
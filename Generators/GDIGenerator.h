@@ -149,6 +149,8 @@ public:
 protected:
 	void GetMonitorList();
 	std::string GetMonitorName(const MONITORINFOEX *m) const;
+	// Wait after a pattern sent to madVR, Chromecast or rPI
+	DWORD GetSettleWaitMs(const ColorRGBDisplay& clr);
 };
 
 #endif // !defined(AFX_GDIGENERATOR_H__B88C4ECA_B358_4964_B549_69B51A691C42__INCLUDED_)
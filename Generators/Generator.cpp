@@ -41,18 +41,15 @@ static char THIS_FILE[]=__FILE__;
 
 IMPLEMENT_SERIAL(CGenerator, CObject, 1) ;
 dispwin *dw;
-typedef int (__stdcall *RB8PG_send)(SOCKET sock,const char *message);
-typedef int (__stdcall *RB8PG_close)(SOCKET sock);
-typedef SOCKET (__stdcall *RB8PG_connect)(const char *server_addr);
-typedef char * (__stdcall *RB8PG_discovery)();
+CPGeneratorClient CGenerator::m_rPiClient;
 
 CGenerator::CGenerator()
 {
 	m_isModified=FALSE;
+	m_bNoSettleWait=FALSE;
 	m_doScreenBlanking=GetConfig()->GetProfileInt("Generator","Blanking",0);
 	m_rectSizePercent=GetConfig()->GetProfileInt("GDIGenerator","SizePercent",10);
 	m_ccastIp = 0;
-	sock = NULL;
 	rPi_xWidth = 1980;
 	rPi_yHeight = 1080;
 	rPi_memSize  = 0;
@@ -155,167 +152,138 @@ BOOL CGenerator::Init(UINT nbMeasure, bool isSpecial)
 	CString str;
 	str.LoadString(IDS_MANUALDVDGENERATOR_NAME);
 	BOOL madVR_Found;
-	char *	m_piIP = "";
 	if (m_name != str)
 	{
 		if (Cgen.m_nDisplayMode == DISPLAY_rPI)
 		{
 			int x2 = Cgen.m_offsetx;
 			int y2 = Cgen.m_offsety;
-			if (!sock) //initialization
+			if (!m_rPiClient.IsConnected()) //initialization
 			{
-				hInstLibrary = LoadLibrary("RB8PGenerator.dll");
-				if (hInstLibrary)
+				CString cs;
+				for (int i = 0; i < 10; i++)
 				{
-					_RB8PG_discovery = (RB8PG_discovery)GetProcAddress(hInstLibrary, "RB8PG_discovery@0");
-					_RB8PG_connect = (RB8PG_connect)GetProcAddress(hInstLibrary, "RB8PG_connect@4");
-					_RB8PG_get = (RB8PG_get)GetProcAddress(hInstLibrary, "RB8PG_get@8");
-					_RB8PG_send = (RB8PG_send)GetProcAddress(hInstLibrary, "RB8PG_send@8");
-					_RB8PG_close = (RB8PG_close)GetProcAddress(hInstLibrary, "RB8PG_close@4");
-
-					if (_RB8PG_discovery)
+					cs = CPGeneratorClient::Discover(500).c_str();
+					if (!cs.IsEmpty())
+						break;
+				}
+								
+				if(!cs.IsEmpty())
+				{
+					if (m_rPiClient.Connect(cs))
 					{
-						for (int i = 0; i < 10; i++)
+						std::string reply;
+						m_rPiClient.Get("CMD:GET_RESOLUTION", reply);
+							
+						CString cs1(reply.c_str());
+						CString cs2,cs3,xW,yH;
+						AfxExtractSubString(cs2, cs1, 0, ':');
+						if (cs2 != "OK")
 						{
-							m_piIP = _RB8PG_discovery();
-							if (strlen(m_piIP) > 5)
-								break;
-							else
-								Sleep(200);
+							GetColorApp()->InMeasureMessageBox( "Failed to get rPi resolution", "GET_RESOLUTION", MB_ICONINFORMATION);
+							return false;
 						}
-					}
-								
-					if(strlen(m_piIP) > 5)
-					{
-						CString cs = m_piIP;
-						if (_RB8PG_connect)
-							sock = _RB8PG_connect(m_piIP);
-						else
+						AfxExtractSubString(cs3, cs1, 1, ':');
+						AfxExtractSubString(xW, cs3, 0, 'x');
+					
+						int xsize = xW.GetLength();
+						yH = cs3.Mid(xsize+1);
+
+						rPi_xWidth = atoi(xW);
+						rPi_yHeight = atoi(yH);
+
+						m_rPiClient.Get("CMD:GET_GPU_MEMORY", reply);
+						CString cs4(reply.c_str()),cs5,cs6;
+						AfxExtractSubString(cs5, cs4, 0, ':');
+						if (cs5 != "OK")
 						{
-							GetColorApp()->InMeasureMessageBox( "Error connecting with rPI: "+cs, "Error", MB_ICONINFORMATION);
+							GetColorApp()->InMeasureMessageBox( "Failed to get rPi GPU memory size", "GET_GPU_MEMORY", MB_ICONINFORMATION);
 							return false;
 						}
-
-						if (sock)
+						cs6=cs4.Mid(3);
+						cs6.Remove('M');
+						rPi_memSize = atoi(cs6);
+						GetConfig()->WriteProfileInt("GDIGenerator", "rPiGPU", rPi_memSize);
+						GetConfig()->WriteProfileInt("GDIGenerator", "rPiWidth", rPi_xWidth);
+						GetConfig()->WriteProfileInt("GDIGenerator", "rPiHeight", rPi_yHeight);
+						CString msg;
+						msg.Format("RGB=TEXT;12,0;100;16,128,128;0,0,0;100,300;Initializing PGenerator at: "+cs+" Res [%dx%d], GPU Mem [%dM]",rPi_xWidth, rPi_yHeight,rPi_memSize);
+						m_rPiClient.Send(msg);
+						Sleep(3000);
+						if (rPi_memSize >= 192)
+						{
+							m_rPiClient.Send("RGB=IMAGE;1920,1080;100;255,255,255;0,0,0;-1,-1;/var/lib/PGenerator/images-HCFR/gbramp.png");
+							Sleep(1000);
+						}
+						if (m_bdispTrip)
 						{
-							if (_RB8PG_send)
+							CGDIGenerator Cgen;
+							double bgstim = Cgen.m_bgStimPercent / 100.;
+							int rb,gb,bb;
+
+							if (m_b16_235)
 							{
-								pi_Res = _RB8PG_get(sock,"CMD:GET_RESOLUTION");
-							
-								CString cs1(pi_Res);
-								CString cs2,cs3,xW,yH;
-								AfxExtractSubString(cs2, cs1, 0, ':');
-								if (cs2 != "OK")
-								{
-									GetColorApp()->InMeasureMessageBox( "Failed to get rPi resolution", "GET_RESOLUTION", MB_ICONINFORMATION);
-									return false;
-								}
-								AfxExtractSubString(cs3, cs1, 1, ':');
-								AfxExtractSubString(xW, cs3, 0, 'x');
-							
-								int xsize = xW.GetLength();
-								yH = cs3.Mid(xsize+1);
-
-								rPi_xWidth = atoi(xW);
-								rPi_yHeight = atoi(yH);
-
-								pi_Res = _RB8PG_get(sock,"CMD:GET_GPU_MEMORY");
-								CString cs4(pi_Res),cs5,cs6;
-								AfxExtractSubString(cs5, cs4, 0, ':');
-								if (cs5 != "OK")
-								{
-									GetColorApp()->InMeasureMessageBox( "Failed to get rPi GPU memory size", "GET_GPU_MEMORY", MB_ICONINFORMATION);
-									return false;
-								}
-								cs6=cs4.Mid(3);
-								cs6.Remove('M');
-								rPi_memSize = atoi(cs6);
-								GetConfig()->WriteProfileInt("GDIGenerator", "rPiSock", sock);
-								GetConfig()->WriteProfileInt("GDIGenerator", "rPiGPU", rPi_memSize);
-								GetConfig()->WriteProfileInt("GDIGenerator", "rPiWidth", rPi_xWidth);
-								GetConfig()->WriteProfileInt("GDIGenerator", "rPiHeight", rPi_yHeight);
-								CString msg;
-								msg.Format("RGB=TEXT;12,0;100;16,128,128;0,0,0;100,300;Initializing PGenerator at: "+cs+" Res [%dx%d], GPU Mem [%dM]",rPi_xWidth, rPi_yHeight,rPi_memSize);
-								_RB8PG_send(sock,msg);
-								Sleep(3000);
-								if (rPi_memSize >= 192)
-								{
-									_RB8PG_send(sock,"RGB=IMAGE;1920,1080;100;255,255,255;0,0,0;-1,-1;/var/lib/PGenerator/images-HCFR/gbramp.png");
-									Sleep(1000);
-								}
-								if (m_bdispTrip)
-								{
-									CGDIGenerator Cgen;
-									double bgstim = Cgen.m_bgStimPercent / 100.;
-									int rb,gb,bb;
-
-									if (m_b16_235)
-									{
-										rb = floor(bgstim * 219.0 + 16.5);
-										gb = floor(bgstim * 219.0 + 16.5);
-										bb = floor(bgstim * 219.0 + 16.5);
-										rb=min(max(rb,0),235);
-										gb=min(max(gb,0),235);
-										bb=min(max(bb,0),235);
-									}
-									else
-									{
-										rb = floor(bgstim * 255.0 + 0.5);
-										gb = floor(bgstim * 255.0 + 0.5);
-										bb = floor(bgstim * 255.0 + 0.5);
-										rb=min(max(rb,0),255);
-										gb=min(max(gb,0),255);
-										bb=min(max(bb,0),255);
-									}
-
-									if (x2 > 0)
-										x2 = min(x2, rPi_xWidth / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_xWidth / 2. );
-									else
-										x2 = max(x2, -1*(rPi_xWidth / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_xWidth / 2.) );
-									if (y2 > 0)
-										y2 = min(y2, rPi_yHeight / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_yHeight / 2.);
-									else
-										y2 = max(y2, -1*(rPi_yHeight / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_yHeight / 2.) );
-
-									CString templ;
-									int x1 = (int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_xWidth);
-									int y1 = (int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_yHeight);
-									double t_fact = rPi_xWidth / 1920.; 
-									templ.Format("SETCONF:HCFR:TEMPLATERAMDISK:DRAW=TEXT\nDIM=18,0\nRESOLUTION=100\nRGB=20,128,128\nBG=DYNAMIC\n" \
-										"POSITION=%d,20\nTEXT=RGB Triplet $RGB\nEND=1\n" \
-										"DRAW=RECTANGLE\nDIM=%d,%d\nRESOLUTION=100\n" \
-										"RGB=DYNAMIC\nBG=-1,-1,-1\nPOSITION=-1,-1,%d,%d\nEND=1",rPi_xWidth / 2 - int(175 * t_fact),x1,y1,x2,y2);
-//									templ.Format("SETCONF:HCFR:TEMPLATERAMDISK:DRAW=TEXT\nDIM=18,0\nRESOLUTION=100\nRGB=20,128,128\nBG=20,40,60\n" \
-//										"POSITION=%d,20\nTEXT=RGB Triplet $RGB\nEND=1\n" \
-//										"DRAW=RECTANGLE\nDIM=%d,%d\nRESOLUTION=100\n" \
-//										"RGB=DYNAMIC\nBG=DYNAMIC\nPOSITION=-1,-1,%d,%d\nEND=1",rPi_xWidth / 2 - int(175 * t_fact),x1,y1,x2,y2);
-							
-									CGenerator::_RB8PG_send(sock,templ);
-								}
+								rb = floor(bgstim * 219.0 + 16.5);
+								gb = floor(bgstim * 219.0 + 16.5);
+								bb = floor(bgstim * 219.0 + 16.5);
+								rb=min(max(rb,0),235);
+								gb=min(max(gb,0),235);
+								bb=min(max(bb,0),235);
 							}
 							else
 							{
-								GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
-								return false;
+								rb = floor(bgstim * 255.0 + 0.5);
+								gb = floor(bgstim * 255.0 + 0.5);
+								bb = floor(bgstim * 255.0 + 0.5);
+								rb=min(max(rb,0),255);
+								gb=min(max(gb,0),255);
+								bb=min(max(bb,0),255);
 							}
+
+							if (x2 > 0)
+								x2 = min(x2, rPi_xWidth / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_xWidth / 2. );
+							else
+								x2 = max(x2, -1*(rPi_xWidth / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_xWidth / 2.) );
+							if (y2 > 0)
+								y2 = min(y2, rPi_yHeight / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_yHeight / 2.);
+							else
+								y2 = max(y2, -1*(rPi_yHeight / 2. - pow(Cgen.m_rectSizePercent/100.0,0.5) * rPi_yHeight / 2.) );
+
+							CString templ;
+							int x1 = (int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_xWidth);
+							int y1 = (int)(pow((double)(Cgen.m_rectSizePercent)/100.0,0.5) * rPi_yHeight);
+							double t_fact = rPi_xWidth / 1920.; 
+							templ.Format("SETCONF:HCFR:TEMPLATERAMDISK:DRAW=TEXT\nDIM=18,0\nRESOLUTION=100\nRGB=20,128,128\nBG=DYNAMIC\n" \
+								"POSITION=%d,20\nTEXT=RGB Triplet $RGB\nEND=1\n" \
+								"DRAW=RECTANGLE\nDIM=%d,%d\nRESOLUTION=100\n" \
+								"RGB=DYNAMIC\nBG=-1,-1,-1\nPOSITION=-1,-1,%d,%d\nEND=1",rPi_xWidth / 2 - int(175 * t_fact),x1,y1,x2,y2);
+//							templ.Format("SETCONF:HCFR:TEMPLATERAMDISK:DRAW=TEXT\nDIM=18,0\nRESOLUTION=100\nRGB=20,128,128\nBG=20,40,60\n" \
+//								"POSITION=%d,20\nTEXT=RGB Triplet $RGB\nEND=1\n" \
+//								"DRAW=RECTANGLE\nDIM=%d,%d\nRESOLUTION=100\n" \
+//								"RGB=DYNAMIC\nBG=DYNAMIC\nPOSITION=-1,-1,%d,%d\nEND=1",rPi_xWidth / 2 - int(175 * t_fact),x1,y1,x2,y2);
+					
+							m_rPiClient.Send(templ);
 						}
 					}
 					else
 					{
-						GetColorApp()->InMeasureMessageBox( "    ** Raspberry Pi generator not found **", "Error", MB_ICONERROR);
-						OutputDebugString("    ** RB8PG_discovery failed **");
+						GetColorApp()->InMeasureMessageBox( "Error connecting with rPI: "+cs, "Error", MB_ICONINFORMATION);
 						return false;
-					}			
+					}
 				}
 				else
 				{
-					GetColorApp()->InMeasureMessageBox( "    ** RB8PGenerator.dll not found **", "Error", MB_ICONERROR);
-					OutputDebugString("    ** Load_dll failed **");
+					GetColorApp()->InMeasureMessageBox( "    ** Raspberry Pi generator not found **", "Error", MB_ICONERROR);
+					OutputDebugString("    ** PGenerator discovery failed **");
 					return false;
-				}
+				}			
 			}
 			else //in case template needs updating
 			{
+				// connected by another generator, which saved what it asked the rPi
+				rPi_xWidth = GetConfig()->GetProfileInt("GDIGenerator", "rPiWidth", rPi_xWidth);
+				rPi_yHeight = GetConfig()->GetProfileInt("GDIGenerator", "rPiHeight", rPi_yHeight);
+				rPi_memSize = GetConfig()->GetProfileInt("GDIGenerator", "rPiGPU", rPi_memSize);
 				if (m_bdispTrip || x2 !=0 || y2 != 0)
 				{
 					CGDIGenerator Cgen;
@@ -362,7 +330,7 @@ BOOL CGenerator::Init(UINT nbMeasure, bool isSpecial)
 //						"DRAW=RECTANGLE\nDIM=%d,%d\nRESOLUTION=100\n" \
 //						"RGB=DYNAMIC\nBG=DYNAMIC\nPOSITION=-1,-1,%d,%d\nEND=1",rPi_xWidth / 2 - int(175 * t_fact),x1,y1,x2,y2);
 				
-					CGenerator::_RB8PG_send(sock,templ);
+					m_rPiClient.Send(templ);
 				}
 			}
 		}
@@ -741,46 +709,29 @@ BOOL CGenerator::Release(INT nbNext)
 	} else if (Cgen.m_nDisplayMode == DISPLAY_ccast && dw)
 		dw->del(dw);
 
-	if (sock && Cgen.m_nDisplayMode == DISPLAY_rPI)
+	if (m_rPiClient.IsConnected() && Cgen.m_nDisplayMode == DISPLAY_rPI)
 	{
-			if (_RB8PG_send)
+			CString msg;
+			if (nbNext == -1)
 			{
-				CString msg;
-				if (nbNext == -1)
-				{
-					msg.Format("RGB=TEXT;14,0;100;16,128,128;0,0,0;100,300;End of sequence");
-					_RB8PG_send(sock,msg);
-					Sleep(2000);
-				}
-				_RB8PG_send(sock,"TESTTEMPLATE:PatternDynamic:0,0,0");
+				msg.Format("RGB=TEXT;14,0;100;16,128,128;0,0,0;100,300;End of sequence");
+				m_rPiClient.Send(msg);
+				Sleep(2000);
 			}
-			else
+			if (!m_rPiClient.Send("TESTTEMPLATE:PatternDynamic:0,0,0"))
 				GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
 	}
 
-	if (sock && Cgen.m_nDisplayMode != DISPLAY_rPI && hInstLibrary) //disconnect only after generator change
+	if (m_rPiClient.IsConnected() && Cgen.m_nDisplayMode != DISPLAY_rPI) //disconnect only after generator change
 	{
+			CString msg;
+			msg.Format("RGB=TEXT;14,0;100;16,128,128;0,0,0;100,300;Disconnecting from PGenerator");
+			m_rPiClient.Send(msg);
+			Sleep(3000);
+			m_rPiClient.Send("TESTTEMPLATE:PatternDynamic:0,0,0");
+			m_rPiClient.Close();
 
-			if (_RB8PG_send)
-			{
-				CString msg;
-				msg.Format("RGB=TEXT;14,0;100;16,128,128;0,0,0;100,300;Disconnecting from PGenerator");
-				_RB8PG_send(sock,msg);
-				Sleep(3000);
-				_RB8PG_send(sock,"TESTTEMPLATE:PatternDynamic:0,0,0");
-			}
-			else
-				GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
-
-			if (_RB8PG_close)
-				_RB8PG_close(sock);
-			else
-				GetColorApp()->InMeasureMessageBox( "Error communicating with rPI", "Error", MB_ICONINFORMATION);
-
-			sock = NULL;
-			GetConfig()->WriteProfileInt("GDIGenerator", "rPiSock", 0);
 			GetConfig()->WriteProfileInt("GDIGenerator", "rPiGPU", 0);
-			FreeLibrary(hInstLibrary);
 	}
 
 	if(m_doScreenBlanking)
@@ -36,12 +36,7 @@
 #include "../libccast/ccwin.h"
 #include "../libccast/ccast.h"
 #include "../Tools/GoogleCastWrapper/GoogleCastWrapper.h"
-
-typedef int (__stdcall *RB8PG_send)(SOCKET sock,const char *message);
-typedef int (__stdcall *RB8PG_close)(SOCKET sock);
-typedef SOCKET (__stdcall *RB8PG_connect)(const char *server_addr);
-typedef char * (__stdcall *RB8PG_discovery)();
-typedef char * (__stdcall *RB8PG_get)(SOCKET sock,const char *message);
+#include "PGeneratorClient.h"
 
 class CGenerator: public CObject    
 {
@@ -79,6 +74,7 @@ public:
 
 	UINT nMeasureNumber;
 	BOOL m_doScreenBlanking;
+	BOOL m_bNoSettleWait;		// Patterns are shown without settling ramp, ABL patch nor wait (latency characterisation)
 	UINT m_rectSizePercent;
 	int	 m_offsetx,m_offsety;
 	BOOL m_b16_235;
@@ -90,20 +86,13 @@ public:
     BOOL m_madVR_vLUT, m_madVR_HDR;
 	BOOL m_madVR_OSD;
 	UINT m_ccastIp; 
-	SOCKET sock;
+	static CPGeneratorClient m_rPiClient;	// shared by all generators and the pattern window
 	int rPi_xWidth;
 	int rPi_yHeight;
 	int rPi_memSize;
 	dispwin *ccwin;
-	RB8PG_send _RB8PG_send;
-	RB8PG_close _RB8PG_close;
-	RB8PG_connect _RB8PG_connect;
-	RB8PG_discovery _RB8PG_discovery;
-	RB8PG_get	_RB8PG_get;
-	char * pi_Res;
 
 protected:
-	HINSTANCE hInstLibrary;
 	BOOL m_isModified;
 	CFullScreenWindow m_blankingWindow;
 
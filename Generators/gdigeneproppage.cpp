@@ -206,6 +206,9 @@ void CGDIGenePropPage::OnOK()
 
 BOOL CGDIGenePropPage::OnSetActive() 
 {
+	// Chromecasts are then known by the time that mode is picked
+	CGoogleCastWrapper::StartDiscovery();
+
 	// Init combo box with monitor list stored in array
 	m_monitorComboCtrl.ResetContent();
 	m_cCastComboCtrl.ResetContent();
@@ -0,0 +1,332 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// Headless measurement runner: builds patch series, shows them with a
+// generator, reads them with a sensor and writes the results, without
+// the application. With the simulated sensor and the null generator
+// it runs anywhere libHCFR builds, which is what timing runs use.
+//
+// hcfrrun [options] series...
+//   -s sensor      simulated (default)
+//   -g generator   null (default)
+//   -r standard    colour reference, ColorStandard number (default 2, HDTV)
+//   -G gamma       simulated display gamma (default 2.22)
+//   -w Y           simulated white luminance (default 120)
+//   -b Y           simulated black luminance (default 0)
+//   -e offset,gain simulated sensor errors, as in the application's sensor
+//   -m model       more simulated display settings, such as
+//                  abl=0.1:0.2:0.7,noise=0.002:0.01,latency=50, see
+//                  ParseDisplayModelConfig()
+//   -B count       time count readings of the simulated display alone,
+//                  no series
+//   -d ms          simulated sensor reading time (default 0)
+//   -f format      cgats (default) or csv
+//   -o file        results file (default standard output)
+//   -n runs        repeat the run, for timing (default 1)
+//   -t file        write a Chrome trace of the runs, and its summary
+//                  to standard error
+//   -l file        build a 3D correction LUT from the measures, a .cube
+//                  or .3dl file, with the fit and inversion times
+//   -L size        LUT points per side, 17 to 65 (default 33)
+//   -T gamma       gamma the LUT corrects to (default 2.4)
+//   -j threads     threads building the LUT (default one per processor)
+//   -c file        characterise the gray transition latency of the
+//                  simulated display into a latency profile, no series
+//   -y lat,rise,fall  simulated display latency, rise and fall times in
+//                  ms (default 50,20,40)
+//
+// series are gray:N, sat:N, cc:SET or user:FILE, see BuildMeasurementSeries()
+
+#include "MeasurementRunner.h"
+#include "LutBuilder.h"
+#include "DisplayLatency.h"
+#include "TraceLog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+
+static void usage()
+{
+    fprintf(stderr, "usage: hcfrrun [-s sensor] [-g generator] [-r standard] [-G gamma]\n");
+    fprintf(stderr, "               [-w Y] [-b Y] [-e offset,gain] [-m model] [-d ms]\n");
+    fprintf(stderr, "               [-f cgats|csv] [-o file] [-n runs] [-t trace]\n");
+    fprintf(stderr, "               [-l lut.cube|lut.3dl] [-L size] [-T gamma] [-j threads] series...\n");
+    fprintf(stderr, "       hcfrrun -c profile [-y latency,rise,fall] [-G gamma] [-w Y]\n");
+    fprintf(stderr, "       hcfrrun -B count [-r standard] [-G gamma] [-w Y] [-b Y] [-m model]\n");
+    fprintf(stderr, "series: gray:N sat:N cc:GCD|MCD|SKIN|CMC|CMS|CPS|CCSG user:file.csv\n");
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string sensorName = "simulated";
+    std::string generatorName = "null";
+    std::string format = "cgats";
+    std::string outputPath;
+    std::string tracePath;
+    std::string lutPath;
+    std::string latencyPath;
+    std::string modelSettings;
+    long benchReadings = 0;
+    double latencyMs = 50.0;
+    double riseMs = 20.0;
+    double fallMs = 40.0;
+    int standard = HDTV;
+    double gamma = 2.22;
+    double whiteY = 120.0;
+    double blackY = 0.0;
+    double offsetError = 0.0;
+    double gainError = 0.0;
+    int readDelay = 0;
+    int nRuns = 1;
+    int lutSize = 33;
+    double lutGamma = 2.4;
+    int lutThreads = 0;
+    std::vector<std::string> series;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            series.push_back(argv[i]);
+            continue;
+        }
+        if (argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc)
+        {
+            usage();
+        }
+        const char* value = argv[++i];
+        switch (argv[i - 1][1])
+        {
+        case 's': sensorName = value; break;
+        case 'g': generatorName = value; break;
+        case 'r': standard = atoi(value); break;
+        case 'G': gamma = atof(value); break;
+        case 'w': whiteY = atof(value); break;
+        case 'b': blackY = atof(value); break;
+        case 'e':
+            if (sscanf(value, "%lf,%lf", &offsetError, &gainError) != 2)
+            {
+                usage();
+            }
+            break;
+        case 'm': modelSettings = value; break;
+        case 'B': benchReadings = atol(value); break;
+        case 'd': readDelay = atoi(value); break;
+        case 'f': format = value; break;
+        case 'o': outputPath = value; break;
+        case 'n': nRuns = atoi(value); break;
+        case 't': tracePath = value; break;
+        case 'l': lutPath = value; break;
+        case 'L': lutSize = atoi(value); break;
+        case 'T': lutGamma = atof(value); break;
+        case 'j': lutThreads = atoi(value); break;
+        case 'c': latencyPath = value; break;
+        case 'y':
+            if (sscanf(value, "%lf,%lf,%lf", &latencyMs, &riseMs, &fallMs) != 3)
+            {
+                usage();
+            }
+            break;
+        default: usage();
+        }
+    }
+
+    if (!latencyPath.empty())
+    {
+        CSimulatedLatencyDisplay display(latencyMs, riseMs, fallMs, gamma, whiteY);
+        LatencyCharacterisationConfig latencyConfig;
+        CDisplayLatencyProfile profile;
+        std::string error;
+        if (!CharacteriseDisplayLatency(display, latencyConfig, profile, error))
+        {
+            fprintf(stderr, "hcfrrun: %s\n", error.c_str());
+            return 1;
+        }
+        if (!profile.Save(latencyPath))
+        {
+            fprintf(stderr, "hcfrrun: can't write %s\n", latencyPath.c_str());
+            return 1;
+        }
+        fprintf(stderr, "%d transitions, black to white wait %d ms, white to black wait %d ms\n",
+                (int)profile.GetTransitions().size(), profile.GetWaitMs(0.0, 100.0), profile.GetWaitMs(100.0, 0.0));
+        return 0;
+    }
+
+    if ((series.empty() && benchReadings <= 0) || nRuns < 1 || standard < PALSECAM || standard >= CUSTOM
+        || (format != "cgats" && format != "csv"))
+    {
+        usage();
+    }
+
+    // the other sensors and generators need the application
+    if (sensorName != "simulated")
+    {
+        fprintf(stderr, "hcfrrun: sensor %s is only available in the application\n", sensorName.c_str());
+        return 1;
+    }
+    if (generatorName != "null")
+    {
+        fprintf(stderr, "hcfrrun: generator %s is only available in the application\n", generatorName.c_str());
+        return 1;
+    }
+
+    MeasurementSeriesConfig config;
+    config.colorReference = CColorReference((ColorStandard)standard);
+
+    CSimulatedDisplaySensor sensor(config.colorReference, gamma, whiteY, blackY, config.bUse10bit);
+    sensor.SetErrors(offsetError, gainError);
+    sensor.SetReadDelay(readDelay);
+    if (!modelSettings.empty())
+    {
+        DisplayModelConfig modelConfig = sensor.GetDisplayModel();
+        std::string error;
+        if (!ParseDisplayModelConfig(modelSettings, modelConfig, error))
+        {
+            fprintf(stderr, "hcfrrun: %s\n", error.c_str());
+            return 1;
+        }
+        sensor.SetDisplayModel(modelConfig);
+    }
+
+    if (benchReadings > 0)
+    {
+        // patches stepping through the whole cube in a scattered order
+        CDisplayModel model(sensor.GetDisplayModel());
+        double rgb[3], XYZ[3], sumY = 0.0;
+        double start = GetMeasurementClockMs();
+        for (long i = 0; i < benchReadings; i++)
+        {
+            rgb[0] = (i * 37 % 256) / 2.55;
+            rgb[1] = (i * 101 % 256) / 2.55;
+            rgb[2] = (i * 211 % 256) / 2.55;
+            model.Measure(rgb, XYZ);
+            sumY += XYZ[1];
+        }
+        double elapsedMs = GetMeasurementClockMs() - start;
+        fprintf(stderr, "%ld readings: %.3f ms, %.0f readings per second (mean Y %g)\n",
+                benchReadings, elapsedMs, elapsedMs > 0.0 ? benchReadings * 1000.0 / elapsedMs : 0.0, sumY / benchReadings);
+        return 0;
+    }
+
+    std::vector<MeasurementPatch> patches;
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        std::string error;
+        if (!BuildMeasurementSeries(series[i], config, patches, error))
+        {
+            fprintf(stderr, "hcfrrun: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    CNullGenerator generator;
+    CMeasurementRunner runner(sensor, generator);
+
+    if (!tracePath.empty())
+    {
+        CTraceLog::Start();
+    }
+
+    double totalMs = 0.0;
+    double bestMs = 0.0;
+    for (int run = 0; run < nRuns; run++)
+    {
+        if (!runner.Run(patches))
+        {
+            fprintf(stderr, "hcfrrun: %s\n", runner.GetLastError().c_str());
+            return 1;
+        }
+        totalMs += runner.GetTotalMs();
+        if (run == 0 || runner.GetTotalMs() < bestMs)
+        {
+            bestMs = runner.GetTotalMs();
+        }
+    }
+
+    if (!tracePath.empty())
+    {
+        CTraceLog::Stop();
+        if (!CTraceLog::WriteChromeTrace(tracePath))
+        {
+            fprintf(stderr, "hcfrrun: can't write %s\n", tracePath.c_str());
+            return 1;
+        }
+        CTraceLog::WriteSummary(std::cerr);
+    }
+
+    std::ofstream outputFile;
+    if (!outputPath.empty())
+    {
+        outputFile.open(outputPath.c_str());
+        if (!outputFile)
+        {
+            fprintf(stderr, "hcfrrun: can't write %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? std::cout : outputFile;
+    if (format == "csv")
+    {
+        runner.WriteCsv(out);
+    }
+    else
+    {
+        runner.WriteCgats(out);
+    }
+
+    if (!lutPath.empty())
+    {
+        std::vector<ColorRGBDisplay> rgb;
+        std::vector<ColorXYZ> XYZ;
+        for (size_t i = 0; i < runner.GetResults().size(); i++)
+        {
+            rgb.push_back(runner.GetResults()[i].rgb);
+            XYZ.push_back(runner.GetResults()[i].XYZ);
+        }
+        C3DLutBuilder builder;
+        builder.SetMeasurements(rgb, XYZ);
+        builder.SetTarget(config.colorReference, lutGamma);
+        builder.SetThreads(lutThreads);
+        if (!builder.Build(lutSize))
+        {
+            fprintf(stderr, "hcfrrun: %s\n", builder.GetLastError().c_str());
+            return 1;
+        }
+        std::ofstream lutFile(lutPath.c_str());
+        if (lutPath.size() > 4 && lutPath.substr(lutPath.size() - 4) == ".3dl")
+        {
+            builder.WriteThreeDL(lutFile);
+        }
+        else
+        {
+            builder.WriteCube(lutFile, "HCFR " + config.colorReference.GetName());
+        }
+        if (!lutFile)
+        {
+            fprintf(stderr, "hcfrrun: can't write %s\n", lutPath.c_str());
+            return 1;
+        }
+        fprintf(stderr, "%d point LUT: %.3f ms fit, %.3f ms inversion\n",
+                lutSize, builder.GetFitMs(), builder.GetInvertMs());
+    }
+
+    fprintf(stderr, "%d patches, %d run(s): %.3f ms per run average, %.3f ms best, %.4f ms per patch\n",
+            (int)patches.size(), nRuns, totalMs / nRuns, bestMs, bestMs / patches.size());
+    return 0;
+}
@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// Matrix benchmark: times Determinant() and GetInverse() against the
+// textbook cofactor expansion, on the sizes the colour code uses and a
+// larger one. Kept out of the unit tests, which only check results.
+//
+// Usage: matrixbench [nloops]
+
+#include "matrix.h"
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <iostream>
+
+namespace
+{
+    // the expansion along the first row, as Determinant() used to do it
+    double cofactorDeterminant(const Matrix& m)
+    {
+        if(m.GetRows() == 1)
+        {
+            return m(0, 0);
+        }
+        double sum = 0.0;
+        for(int q(0); q < m.GetColumns(); ++q)
+        {
+            sum += ((q % 2) ? -1.0 : 1.0) * m(0, q) * cofactorDeterminant(m.GetMinor(0, q));
+        }
+        return sum;
+    }
+
+    // well conditioned but otherwise arbitrary contents
+    Matrix testMatrix(int n)
+    {
+        Matrix m(0.0, n, n);
+        for(int i(0); i < n; ++i)
+        {
+            for(int j(0); j < n; ++j)
+            {
+                m(i, j) = sin(1.0 + i * n + j) + (i == j ? n : 0.0);
+            }
+        }
+        return m;
+    }
+
+    double elapsedMs(clock_t start)
+    {
+        return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int nLoops = argc > 1 ? atoi(argv[1]) : 100000;
+    double sink = 0.0;
+
+    if(nLoops < 100)
+    {
+        std::cerr << "Usage: matrixbench [nloops], at least 100" << std::endl;
+        return 1;
+    }
+
+    for(int n(3); n <= 7; n += (n == 4 ? 3 : 1))
+    {
+        Matrix m(testMatrix(n));
+        // the 7x7 expansion is too slow to run as often
+        int nSlowLoops = n == 7 ? nLoops / 100 : nLoops;
+
+        clock_t start = clock();
+        for(int i(0); i < nSlowLoops; ++i)
+        {
+            sink += cofactorDeterminant(m);
+        }
+        double cofactorMs = elapsedMs(start) * nLoops / nSlowLoops;
+
+        start = clock();
+        for(int i(0); i < nLoops; ++i)
+        {
+            sink += m.Determinant();
+        }
+        double determinantMs = elapsedMs(start);
+
+        start = clock();
+        for(int i(0); i < nLoops; ++i)
+        {
+            sink += m.GetInverse()(0, 0);
+        }
+        double inverseMs = elapsedMs(start);
+
+        std::cout << n << "x" << n << ", " << nLoops << " times: cofactor determinant "
+                  << cofactorMs << " ms, Determinant() " << determinantMs
+                  << " ms, GetInverse() " << inverseMs << " ms" << std::endl;
+    }
+    // keeps the loops from being optimised away
+    return sink == sink ? 0 : 1;
+}
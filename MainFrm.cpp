@@ -32,6 +32,8 @@
 #include "LangSelection.h"
 
 #include "PatternDisplay.h"
+#include "DocComparison.h"
+#include "DocEnumerator.h"
 
 //#include "WebUpdate.h"
 #include "CWebUpdate.h"
@@ -69,6 +71,7 @@ BEGIN_MESSAGE_MAP(CMainFrame, CNewMDIFrameWnd)
 	//{{AFX_MSG_MAP(CMainFrame)
 	ON_WM_CREATE()
 	ON_COMMAND(IDM_DUPLICATEDOC, OnDuplicateDoc)
+	ON_COMMAND(IDM_COMPARE_DOCUMENTS, OnCompareDocuments)
 	ON_COMMAND(ID_VIEW_VIEW_BAR, OnViewViewBar)
 	ON_UPDATE_COMMAND_UI(ID_VIEW_VIEW_BAR, OnUpdateViewViewBar)
 	ON_COMMAND(ID_VIEW_TOOLBAR, OnViewToolbar)
@@ -928,6 +931,71 @@ void CMainFrame::OnDuplicateDoc()
 	g_bNewDocIsDuplication = FALSE;
 }
 
+void CMainFrame::OnCompareDocuments()
+{
+	// Opened documents are compared with the .chc files picked here, which are loaded
+	// without any window, against the active document
+	const DWORD		nBufferSize = 32768;
+	CString			strFiles;
+	CFileDialog		fileOpenDialog ( TRUE, "chc", NULL, OFN_HIDEREADONLY | OFN_FILEMUSTEXIST | OFN_ALLOWMULTISELECT, "HCFR Save File (*.chc)|*.chc||" );
+	CDocComparison	comparison;
+
+	fileOpenDialog.m_ofn.lpstrFile = strFiles.GetBuffer ( nBufferSize );
+	fileOpenDialog.m_ofn.lpstrFile [ 0 ] = '\0';
+	fileOpenDialog.m_ofn.nMaxFile = nBufferSize;
+
+	if ( fileOpenDialog.DoModal () != IDOK )
+	{
+		strFiles.ReleaseBuffer ();
+		return;
+	}
+
+	comparison.AddOpenDocuments ();
+
+	POSITION pos = fileOpenDialog.GetStartPosition ();
+	while ( pos )
+	{
+		CString			strPath = fileOpenDialog.GetNextPathName ( pos );
+		CDocEnumerator	docEnumerator;
+		CDocument *		pDoc;
+		BOOL			bOpened = FALSE;
+
+		while ( ( pDoc = docEnumerator.Next () ) != NULL )
+		{
+			if ( pDoc -> GetPathName () .CompareNoCase ( strPath ) == 0 )
+				bOpened = TRUE;
+		}
+
+		if ( ! bOpened && comparison.LoadDocument ( strPath ) < 0 )
+		{
+			CString Msg = "Can't load " + strPath;
+			AfxMessageBox ( Msg, MB_ICONERROR | MB_OK );
+		}
+	}
+	strFiles.ReleaseBuffer ();
+
+	if ( comparison.GetDocumentCount () < 2 )
+	{
+		AfxMessageBox ( "At least two documents are needed for a comparison", MB_ICONINFORMATION | MB_OK );
+		return;
+	}
+
+	int nRefDoc = 0;
+	if ( MDIGetActive () && MDIGetActive () -> GetActiveDocument () && MDIGetActive () -> GetActiveDocument () -> IsKindOf ( RUNTIME_CLASS ( CDataSetDoc ) ) )
+		nRefDoc = max ( 0, comparison.FindDocument ( (CDataSetDoc *) MDIGetActive () -> GetActiveDocument () ) );
+
+	BeginWaitCursor ();
+	comparison.Compute ( nRefDoc );
+	EndWaitCursor ();
+
+	CFileDialog fileSaveDialog ( FALSE, "csv", NULL, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT, "CSV File (*.csv)|*.csv||" );
+	if ( fileSaveDialog.DoModal () == IDOK && ! comparison.SaveTable ( fileSaveDialog.GetPathName () ) )
+	{
+		CString Msg = "Can't write " + fileSaveDialog.GetPathName ();
+		AfxMessageBox ( Msg, MB_ICONERROR | MB_OK );
+	}
+}
+
 LRESULT CMainFrame::OnRightButton(WPARAM wParam, LPARAM lParam)
 {
 	CDataSetDoc *	pCurrentDocument = NULL;
@@ -116,6 +116,7 @@ protected:
 	//{{AFX_MSG(CMainFrame)
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
 	afx_msg void OnDuplicateDoc();
+	afx_msg void OnCompareDocuments();
 	afx_msg void OnViewViewBar();
 	afx_msg void OnUpdateViewSensorBar(CCmdUI* pCmdUI);
 	afx_msg void OnUpdateViewViewBar(CCmdUI* pCmdUI);
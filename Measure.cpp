@@ -30,6 +30,8 @@
 #include "LuxScaleAdvisor.h"
 #include "DataSetDoc.h"
 #include "Views\MainView.h"
+#include "TraceLog.h"
+#include "CHCFile.h"
 
 #include <math.h>
 #include <sstream>
@@ -228,6 +230,34 @@ void CMeasure::Copy(CMeasure * p,UINT nId)
 	}
 }
 
+void CMeasure::CopyMeasures ( const CMeasure & source )
+{
+	m_NearWhiteClipCol = source.m_NearWhiteClipCol;
+	m_bOverRideBlack = source.m_bOverRideBlack;
+	m_userBlack = source.m_userBlack;
+	m_grayMeasureArray.Copy ( source.m_grayMeasureArray );
+	m_nearBlackMeasureArray.Copy ( source.m_nearBlackMeasureArray );
+	m_nearWhiteMeasureArray.Copy ( source.m_nearWhiteMeasureArray );
+	m_redSatMeasureArray.Copy ( source.m_redSatMeasureArray );
+	m_greenSatMeasureArray.Copy ( source.m_greenSatMeasureArray );
+	m_blueSatMeasureArray.Copy ( source.m_blueSatMeasureArray );
+	m_yellowSatMeasureArray.Copy ( source.m_yellowSatMeasureArray );
+	m_cyanSatMeasureArray.Copy ( source.m_cyanSatMeasureArray );
+	m_magentaSatMeasureArray.Copy ( source.m_magentaSatMeasureArray );
+	m_cc24SatMeasureArray.Copy ( source.m_cc24SatMeasureArray );
+	m_cc24SatMeasureArray_master.Copy ( source.m_cc24SatMeasureArray_master );
+	m_measurementsArray.Copy ( source.m_measurementsArray );
+	m_primariesArray.Copy ( source.m_primariesArray );
+	m_secondariesArray.Copy ( source.m_secondariesArray );
+	m_OnOffBlack = source.m_OnOffBlack;
+	m_OnOffWhite = source.m_OnOffWhite;
+	m_AnsiBlack = source.m_AnsiBlack;
+	m_AnsiWhite = source.m_AnsiWhite;
+	m_PrimeWhite = source.m_PrimeWhite;
+	m_infoStr = source.m_infoStr;
+	m_bIREScaleMode = source.m_bIREScaleMode;
+}
+
 void CMeasure::Serialize(CArchive& ar)
 {
 	CObject::Serialize(ar) ;
@@ -696,6 +726,54 @@ void CMeasure::Serialize(CArchive& ar)
 	m_isModified = FALSE;
 }
 
+static void CopyColors ( const list<CColor> & colors, CArray<CColor,CColor> & dest )
+{
+	dest.SetSize ( (int) colors.size () );
+
+	int i = 0;
+	for ( list<CColor>::const_iterator it = colors.begin (); it != colors.end (); ++ it )
+		dest [ i ++ ] = * it;
+}
+
+static CColor GetListColor ( const list<CColor> & colors, int nIndex )
+{
+	for ( list<CColor>::const_iterator it = colors.begin (); it != colors.end (); ++ it )
+	{
+		if ( nIndex -- == 0 )
+			return * it;
+	}
+	return noDataColor;
+}
+
+void CMeasure::LoadMeasures ( CHCFile & file )
+{
+	CopyColors ( file.getGrayColors (), m_grayMeasureArray );
+	CopyColors ( file.getNearBlackColors (), m_nearBlackMeasureArray );
+	CopyColors ( file.getNearWhiteColors (), m_nearWhiteMeasureArray );
+	CopyColors ( file.getRedSaturationColors (), m_redSatMeasureArray );
+	CopyColors ( file.getGreenSaturationColors (), m_greenSatMeasureArray );
+	CopyColors ( file.getBlueSaturationColors (), m_blueSatMeasureArray );
+	CopyColors ( file.getYellowSaturationColors (), m_yellowSatMeasureArray );
+	CopyColors ( file.getCyanSaturationColors (), m_cyanSatMeasureArray );
+	CopyColors ( file.getMagentaSaturationColors (), m_magentaSatMeasureArray );
+	CopyColors ( file.getFreeMeasuresColors (), m_measurementsArray );
+
+	// Primaries then secondaries
+	for ( int i = 0; i < 3; i ++ )
+	{
+		m_primariesArray [ i ] = GetListColor ( file.getComponnentsColors (), i );
+		m_secondariesArray [ i ] = GetListColor ( file.getComponnentsColors (), 3 + i );
+	}
+
+	m_OnOffBlack = GetListColor ( file.getFullscreenContrastColors (), 0 );
+	m_OnOffWhite = GetListColor ( file.getFullscreenContrastColors (), 1 );
+	m_AnsiBlack = GetListColor ( file.getANSIContrastColors (), 0 );
+	m_AnsiWhite = GetListColor ( file.getANSIContrastColors (), 1 );
+	m_PrimeWhite = file.getPrimeWhite ();
+	m_bIREScaleMode = file.isIREScaleMode ();
+	m_isModified = FALSE;
+}
+
 void CMeasure::SetGrayScaleSize(int steps)
 {
 	int OldSize = m_grayMeasureArray.GetSize ();
@@ -900,10 +978,51 @@ UINT CMeasure::GetLuxMeasure ( double * pValue )
 
 	return nRet;
 }
+void CMeasure::JournalReading ( CDataSetDoc * pDoc, int nSeries, int nIndex )
+{
+	CArray<CColor,CColor> * pSeries = GetJournalSeries ( nSeries );
+
+	if ( pDoc && pSeries && nIndex < pSeries -> GetSize () )
+		pDoc -> JournalReading ( MakeJournalRecord ( nSeries, nIndex, pSeries -> GetSize (), pSeries -> GetAt ( nIndex ) ) );
+}
+
+CArray<CColor,CColor> * CMeasure::GetJournalSeries ( int nSeries )
+{
+	switch ( nSeries )
+	{
+		case JOURNAL_GRAY:			return & m_grayMeasureArray;
+		case JOURNAL_NEARBLACK:		return & m_nearBlackMeasureArray;
+		case JOURNAL_NEARWHITE:		return & m_nearWhiteMeasureArray;
+		case JOURNAL_REDSAT:		return & m_redSatMeasureArray;
+		case JOURNAL_GREENSAT:		return & m_greenSatMeasureArray;
+		case JOURNAL_BLUESAT:		return & m_blueSatMeasureArray;
+		case JOURNAL_YELLOWSAT:		return & m_yellowSatMeasureArray;
+		case JOURNAL_CYANSAT:		return & m_cyanSatMeasureArray;
+		case JOURNAL_MAGENTASAT:	return & m_magentaSatMeasureArray;
+		case JOURNAL_CC24SAT:		return & m_cc24SatMeasureArray;
+		case JOURNAL_PRIMARY:		return & m_primariesArray;
+		case JOURNAL_SECONDARY:		return & m_secondariesArray;
+	}
+	return NULL;
+}
+
+void CMeasure::ApplyJournalRecord ( const JournalRecord & record )
+{
+	CArray<CColor,CColor> * pSeries = GetJournalSeries ( record.series );
+
+	// Ignore readings of a series resized since they were taken
+	if ( pSeries && pSeries -> GetSize () == record.seriesSize && record.index >= 0 && record.index < record.seriesSize )
+	{
+		pSeries -> SetAt ( record.index, GetJournalColor ( record ) );
+		m_isModified = TRUE;
+	}
+}
+
 bool doSettling = FALSE;
 
 BOOL CMeasure::MeasureGrayScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG		Msg;
 	BOOL	bEscape;
 	BOOL	bPatternRetry = FALSE;
@@ -971,6 +1090,7 @@ BOOL CMeasure::MeasureGrayScale(CSensor *pSensor, CGenerator *pGenerator, CDataS
 				measuredColor[i]=pSensor->MeasureGray(ArrayIndexToGrayLevel ( i, size, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit));
 
 				m_grayMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_GRAY, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -1125,6 +1245,7 @@ BOOL CMeasure::MeasureGrayScale(CSensor *pSensor, CGenerator *pGenerator, CDataS
 
 BOOL CMeasure::MeasureGrayScaleAndColors(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG		Msg;
 	BOOL	bEscape;
 	BOOL	bPatternRetry = FALSE;
@@ -1192,6 +1313,7 @@ BOOL CMeasure::MeasureGrayScaleAndColors(CSensor *pSensor, CGenerator *pGenerato
 
 				measuredColor[i]=pSensor->MeasureGray(ArrayIndexToGrayLevel ( i, size, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit ));
 				m_grayMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_GRAY, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -1439,6 +1561,10 @@ BOOL CMeasure::MeasureGrayScaleAndColors(CSensor *pSensor, CGenerator *pGenerato
 					m_primariesArray[i] = measuredColor[size+i];
 				if (i>=3&&i<6)
 					m_secondariesArray[i-3] = measuredColor[size+i];
+				if (i<3)
+					JournalReading ( pDoc, JOURNAL_PRIMARY, i );
+				else if (i<6)
+					JournalReading ( pDoc, JOURNAL_SECONDARY, i-3 );
 				
 				if ( bUseLuxValues )
 				{
@@ -1585,6 +1711,7 @@ BOOL CMeasure::MeasureGrayScaleAndColors(CSensor *pSensor, CGenerator *pGenerato
 
 BOOL CMeasure::MeasureNearBlackScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG		Msg;
 	BOOL	bEscape;
 	BOOL	bPatternRetry = FALSE;
@@ -1652,6 +1779,7 @@ BOOL CMeasure::MeasureNearBlackScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 				measuredColor[i]=pSensor->MeasureGray(ArrayIndexToGrayLevel ( nCol, 101, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit));
 				m_nearBlackMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_NEARBLACK, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -1788,6 +1916,7 @@ BOOL CMeasure::MeasureNearBlackScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 BOOL CMeasure::MeasureNearWhiteScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG		Msg;
 	BOOL	bEscape;
 	BOOL	bPatternRetry = FALSE;
@@ -1869,6 +1998,7 @@ BOOL CMeasure::MeasureNearWhiteScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 				measuredColor[i]=pSensor->MeasureGray(ArrayIndexToGrayLevel ( m_NearWhiteClipCol - size+i, 101, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit));
 				m_nearWhiteMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_NEARWHITE, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -1968,6 +2098,7 @@ BOOL CMeasure::MeasureNearWhiteScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 BOOL CMeasure::MeasureRedSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2039,6 +2170,7 @@ BOOL CMeasure::MeasureRedSatScale(CSensor *pSensor, CGenerator *pGenerator, CDat
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_redSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_REDSAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2138,6 +2270,7 @@ BOOL CMeasure::MeasureRedSatScale(CSensor *pSensor, CGenerator *pGenerator, CDat
 
 BOOL CMeasure::MeasureGreenSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2208,6 +2341,7 @@ BOOL CMeasure::MeasureGreenSatScale(CSensor *pSensor, CGenerator *pGenerator, CD
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_greenSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_GREENSAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2307,6 +2441,7 @@ BOOL CMeasure::MeasureGreenSatScale(CSensor *pSensor, CGenerator *pGenerator, CD
 
 BOOL CMeasure::MeasureBlueSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2379,6 +2514,7 @@ BOOL CMeasure::MeasureBlueSatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_blueSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_BLUESAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2478,6 +2614,7 @@ BOOL CMeasure::MeasureBlueSatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 
 BOOL CMeasure::MeasureYellowSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2549,6 +2686,7 @@ BOOL CMeasure::MeasureYellowSatScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_yellowSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_YELLOWSAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2649,6 +2787,7 @@ BOOL CMeasure::MeasureYellowSatScale(CSensor *pSensor, CGenerator *pGenerator, C
 
 BOOL CMeasure::MeasureCyanSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2721,6 +2860,7 @@ BOOL CMeasure::MeasureCyanSatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_cyanSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_CYANSAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2821,6 +2961,7 @@ BOOL CMeasure::MeasureCyanSatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 
 BOOL CMeasure::MeasureMagentaSatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -2893,6 +3034,7 @@ BOOL CMeasure::MeasureMagentaSatScale(CSensor *pSensor, CGenerator *pGenerator,
 
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				m_magentaSatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_MAGENTASAT, i );
 				
 				if ( bUseLuxValues )
 				{
@@ -2992,6 +3134,7 @@ BOOL CMeasure::MeasureMagentaSatScale(CSensor *pSensor, CGenerator *pGenerator,
 
 BOOL CMeasure::MeasureCC24SatScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	MSG			Msg;
 	BOOL		bEscape;
 	BOOL		bPatternRetry = FALSE;
@@ -3127,6 +3270,7 @@ BOOL CMeasure::MeasureCC24SatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 				}
 
 				m_cc24SatMeasureArray[i] = measuredColor[i];
+				JournalReading ( pDoc, JOURNAL_CC24SAT, i );
 
 				if ( bUseLuxValues )
 				{
@@ -3242,6 +3386,7 @@ BOOL CMeasure::MeasureCC24SatScale(CSensor *pSensor, CGenerator *pGenerator, CDa
 
 BOOL CMeasure::MeasureAllSaturationScales(CSensor *pSensor, CGenerator *pGenerator, BOOL bPrimaryOnly, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	int			i, j;
 	MSG			Msg;
 	BOOL		bEscape;
@@ -3422,6 +3567,7 @@ BOOL CMeasure::MeasureAllSaturationScales(CSensor *pSensor, CGenerator *pGenerat
 						if ((i+j*size)>=3*size)
 							m_cc24SatMeasureArray[i] = measuredColor[j*size+i];
 					}
+					JournalReading ( pDoc, j < ( bPrimaryOnly ? 3 : 6 ) ? JOURNAL_REDSAT + j : JOURNAL_CC24SAT, i );
 					if ( bUseLuxValues )
 					{
 						switch ( GetLuxMeasure ( & dLuxValue ) )
@@ -3622,6 +3768,7 @@ BOOL CMeasure::MeasureAllSaturationScales(CSensor *pSensor, CGenerator *pGenerat
 
 BOOL CMeasure::MeasurePrimarySecondarySaturationScales(CSensor *pSensor, CGenerator *pGenerator, BOOL bPrimaryOnly, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	int			i, j;
 	MSG			Msg;
 	BOOL		bEscape;
@@ -3725,6 +3872,8 @@ BOOL CMeasure::MeasurePrimarySecondarySaturationScales(CSensor *pSensor, CGenera
 						if ((i+j*size)<size*6&&(i+j*size)>=5*size)
 							m_magentaSatMeasureArray[i] = measuredColor[5*size+i];
 					}
+					if ( j < ( bPrimaryOnly ? 3 : 6 ) )
+						JournalReading ( pDoc, JOURNAL_REDSAT + j, i );
 					
 					if ( bUseLuxValues )
 					{
@@ -3871,6 +4020,7 @@ BOOL CMeasure::MeasurePrimarySecondarySaturationScales(CSensor *pSensor, CGenera
 
 BOOL CMeasure::MeasurePrimaries(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	int		i;
 	MSG		Msg;
 	BOOL	bEscape;
@@ -4036,6 +4186,8 @@ BOOL CMeasure::MeasurePrimaries(CSensor *pSensor, CGenerator *pGenerator, CDataS
 				measuredColor[i]=pSensor->MeasureColor(GenColors[i], displaymode);
 				if (i < 3)
 					m_primariesArray[i] = measuredColor[i];
+				if (i < 3)
+					JournalReading ( pDoc, JOURNAL_PRIMARY, i );
 				if ( bUseLuxValues )
 				{
 					switch ( GetLuxMeasure ( & dLuxValue ) )
@@ -4160,6 +4312,7 @@ BOOL CMeasure::MeasurePrimaries(CSensor *pSensor, CGenerator *pGenerator, CDataS
 
 BOOL CMeasure::MeasureSecondaries(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	int		i;
 	MSG		Msg;
 	BOOL	bEscape;
@@ -4329,6 +4482,10 @@ BOOL CMeasure::MeasureSecondaries(CSensor *pSensor, CGenerator *pGenerator, CDat
 					m_primariesArray[i] = measuredColor[i];
 				if (i>=3&&i<6)
 					m_secondariesArray[i-3] = measuredColor[i];
+				if (i<3)
+					JournalReading ( pDoc, JOURNAL_PRIMARY, i );
+				else if (i<6)
+					JournalReading ( pDoc, JOURNAL_SECONDARY, i-3 );
 				if ( bUseLuxValues )
 				{
 					switch ( GetLuxMeasure ( & dLuxValue ) )
@@ -4461,6 +4618,7 @@ BOOL CMeasure::MeasureSecondaries(CSensor *pSensor, CGenerator *pGenerator, CDat
 
 BOOL CMeasure::MeasureContrast(CSensor *pSensor, CGenerator *pGenerator)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	int		i;
 	MSG		Msg;
 	BOOL	bEscape;
@@ -5042,6 +5200,7 @@ void CMeasure::DeleteContrast ()
 
 BOOL CMeasure::AddMeasurement(CSensor *pSensor, CGenerator *pGenerator,  CGenerator::MeasureType MT, int isPrimary, int last_minCol, int m_d)
 {
+	HCFR_TRACE_FUNCTION("measure");
 	BOOL		bDisplayColor = GetConfig () -> m_bDisplayTestColors;
 	BOOL		bOk;
 	COLORREF	clr;
@@ -5196,6 +5355,7 @@ void CMeasure::ApplySensorAdjustmentMatrix(const Matrix& aMatrix)
 
 BOOL CMeasure::WaitForDynamicIris ( BOOL bIgnoreEscape, CDataSetDoc *pDoc )
 {
+	HCFR_TRACE_FUNCTION("measure");
 	BOOL bEscape = FALSE;
 	int nLatencyTime = GetConfig()->m_latencyTime;
 	UINT nLoopTime = 10;
@@ -5254,6 +5414,7 @@ BOOL CMeasure::CheckBlackOverride ( )
 
 void CMeasure::UpdateViews ( CDataSetDoc *pDoc, int Sequence )
 {
+	HCFR_TRACE_FUNCTION("view");
 	if (pDoc )
 	{
 		POSITION pos = pDoc -> GetFirstViewPosition ();
@@ -6084,7 +6245,7 @@ BOOL CMeasure::ValidateBackgroundCC24SatScale ( BOOL bUseLuxValues, double * pLu
 	return bOk;
 }
 
-CColor CMeasure::GetGray(int i) const 
+const CColor & CMeasure::GetGray(int i) const 
 {
 	return m_grayMeasureArray[i]; 
 } 
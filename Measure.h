@@ -30,6 +30,7 @@
 #endif // _MSC_VER > 1000
 
 #include "Color.h"
+#include "MeasurementJournal.h"
 #include "Sensors\Sensor.h"
 #include "Generators\Generator.h"
 
@@ -44,10 +45,26 @@
 #define	DUPLINFO			8
 
 
+class CHCFile;
+
 #define LUX_NOMEASURE	0
 #define LUX_OK			1
 #define LUX_CANCELED	2
 
+// Series of the measurement journal, do not renumber
+#define JOURNAL_GRAY			0
+#define JOURNAL_NEARBLACK		1
+#define JOURNAL_NEARWHITE		2
+#define JOURNAL_REDSAT			3	// then green, blue, yellow, cyan and magenta
+#define JOURNAL_GREENSAT		4
+#define JOURNAL_BLUESAT			5
+#define JOURNAL_YELLOWSAT		6
+#define JOURNAL_CYANSAT			7
+#define JOURNAL_MAGENTASAT		8
+#define JOURNAL_CC24SAT			9
+#define JOURNAL_PRIMARY			10
+#define JOURNAL_SECONDARY		11
+
 
 class CMeasure : public CObject  
 {
@@ -105,15 +122,24 @@ public:
 	virtual ~CMeasure();
 
 	virtual void Serialize(CArchive& archive); 
+	// Measures read by CHCFile with empty measures kept, the file preferences are left out
+	void LoadMeasures ( CHCFile & file );
 
 	void StartLuxMeasure ();
 	UINT GetLuxMeasure ( double * pValue ); 
 
+	// Measurement journal: each reading is logged by the document as it lands
+	void JournalReading ( CDataSetDoc * pDoc, int nSeries, int nIndex );
+	CArray<CColor,CColor> * GetJournalSeries ( int nSeries );
+	void ApplyJournalRecord ( const JournalRecord & record );
+
 	void Copy(CMeasure * p,UINT nId);
+	// Everything Serialize stores, for a snapshot serialised on another thread
+	void CopyMeasures ( const CMeasure & source );
 	BOOL MeasureGrayScale(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc);
 	BOOL MeasureCC24(CSensor *pSensor, CGenerator *pGenerator);
 	BOOL MeasureGrayScaleAndColors(CSensor *pSensor, CGenerator *pGenerator, CDataSetDoc *pDoc);
-	CColor GetGray(int i) const;
+	const CColor & GetGray(int i) const;
 	void SetGray(int i,const CColor & aColor) {m_grayMeasureArray[i]=aColor; m_isModified=TRUE;} 
 	int GetGrayScaleSize() const { return m_grayMeasureArray.GetSize(); }
 	void SetGrayScaleSize(int steps);
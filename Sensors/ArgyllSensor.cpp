@@ -475,6 +475,26 @@ bool CArgyllSensor::setAvg()
     return m_meter->setAdaptMode();
 }
 
+void CArgyllSensor::setFastReadings(bool bFast)
+{
+    m_meter->setFastReadings(bFast);
+}
+
+bool CArgyllSensor::measureUpdateDelay(void (*showWhite)(void* context), void* context, int& updateDelayMs, int& instrumentDelayMs)
+{
+    if (!m_meter->doesMeterSupportUpdateDelay())
+    {
+        return false;
+    }
+    std::string errorDescription;
+    if (!m_meter->measureUpdateDelay(showWhite, context, updateDelayMs, instrumentDelayMs, errorDescription))
+    {
+        SetErrorString(errorDescription.c_str());
+        return false;
+    }
+    return true;
+}
+
 bool CArgyllSensor::isRefresh() const
 {
     return m_meter->isRefresh();
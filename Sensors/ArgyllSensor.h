@@ -83,6 +83,8 @@ public:
     void FillSpectralTypeCombo(CComboBox& comboToFill);
     virtual bool isColorimeter() const;
     virtual bool setAvg();
+    virtual void setFastReadings(bool bFast);
+    virtual bool measureUpdateDelay(void (*showWhite)(void* context), void* context, int& updateDelayMs, int& instrumentDelayMs);
     virtual bool isRefresh() const;
 
 private:
@@ -158,6 +158,7 @@ CKiSensor::CKiSensor()
 	m_nSensorsUsed = GetConfig()->GetProfileInt("HCFRSensor","Sensor",0);
 	m_nInterlaceMode = GetConfig()->GetProfileInt("HCFRSensor","Interlace",0);
 	m_bFastMeasure = GetConfig()->GetProfileInt("HCFRSensor","FastMeasure",0);
+	m_bFastReadings = FALSE;
 
 	m_bSingleSensor = GetConfig () -> GetProfileInt ( "Debug", "SingleSensor", FALSE );
 	m_bLEDStopped = FALSE;
@@ -430,6 +431,9 @@ BOOL CKiSensor::Init( BOOL bForSimultaneousMeasures )
 	BOOL		bLEDControl = FALSE;
 	char		szBuf [ 1024 ];
 
+	// Device may have moved to another port, and the version test needs the port
+	m_serialSession.Close ();
+
 	GetRealComPort ( m_RealComPort );
 	
 	if ( ! m_RealComPort.IsEmpty () )
@@ -469,6 +473,7 @@ BOOL CKiSensor::Release()
 		acquire((char *) (LPCTSTR) m_RealComPort, m_timeoutMesure, (char)0x82 , mStr);
 		m_bLEDStopped = FALSE;
 	}
+	m_serialSession.Close ();
 	return CSensor::Release();
 }
 
@@ -483,46 +488,28 @@ void CKiSensor::GetUniqueIdentifier( CString & strId )
 		strId = m_name + " on " + ComPort;
 }
 
+// sensVal must hold at least 255 characters
 BOOL CKiSensor::acquire(char *com_port, int timeout, char command, char *sensVal)
 {
-	CSerialCom port;
-	char c[2];
+	BYTE cmd = (BYTE) command;
 
-	strcpy(c, "");
 	strcpy(sensVal, "");
-	BYTE data=0;
 
-	if(!(port.OpenPort(com_port))){
+	// Port is opened on first use and stays open until Release
+	if(!m_serialSession.Open(com_port, 115200))
+	{
 		MessageBox(0, "Cannot open Communication Port","Error",MB_OK+MB_ICONERROR);
-	} else {
-		if(!(port.ConfigurePort(115200,8,0,NOPARITY ,ONESTOPBIT )))
-		{
-			MessageBox(0, "Cannot Configure Communication Port","Error",MB_OK+MB_ICONERROR);
-			port.ClosePort();
-		} else {
-			if(!(port.SetCommunicationTimeouts(0,timeout,0,0,0)))
-			{
-				MessageBox(0, "Cannot Configure Communication Timeouts","Error",MB_OK+MB_ICONERROR);
-				port.ClosePort();
-			} else {
-				if(!(port.WriteByte(command)))
-				{
-					MessageBox(0, "Cannot Write to Port","Error",MB_OK+MB_ICONERROR);
-					port.ClosePort();
-				} else {
-					while(port.ReadByte(data))
-					{
-						if (data==13) break;
-						sprintf(c, "%c", data);
-						strcat(sensVal, c);
-					}
-					port.ClosePort();
-					return TRUE;
-				}
-			}
-		} 
+		return FALSE;
+	}
+
+	// On a timeout the partial answer is returned as before, decodeKiStr rejects it
+	if(m_serialSession.Transact(&cmd, 1, sensVal, 255, 13, timeout) == CSerialSession::READ_ERROR)
+	{
+		MessageBox(0, "Communication Port Error","Error",MB_OK+MB_ICONERROR);
+		m_serialSession.Close();
+		return FALSE;
 	}
-	return FALSE;
+	return TRUE;
 }
 
 CColor CKiSensor::MeasureColorInternal(const ColorRGBDisplay& aRGBValue)
@@ -533,7 +520,7 @@ CColor CKiSensor::MeasureColorInternal(const ColorRGBDisplay& aRGBValue)
 	char cmd[1] = "";
 	
 	// Create command byte
-	cmd[0] = ( m_bMeasureRGB & 0x01 ) + ( ( m_bMeasureWhite & 0x01 ) << 1 ) + ( ( m_nSensorsUsed & 0x03 ) << 2 ) + ( ( m_nInterlaceMode & 0x03 ) << 4 ) + ( ( m_bFastMeasure & 0x01 ) << 6 );
+	cmd[0] = ( m_bMeasureRGB & 0x01 ) + ( ( m_bMeasureWhite & 0x01 ) << 1 ) + ( ( m_nSensorsUsed & 0x03 ) << 2 ) + ( ( m_nInterlaceMode & 0x03 ) << 4 ) + ( ( ( m_bFastMeasure || m_bFastReadings ) & 0x01 ) << 6 );
 
 	// sensor = 0;
 	if( acquire((char *) (LPCTSTR) m_RealComPort, m_timeoutMesure, *cmd , mStr) )
@@ -33,6 +33,7 @@
 
 #include "OneDeviceSensor.h"
 #include "KiSensorPropPage.h"
+#include "SerialSession.h"
 
 class CKiSensor : public COneDeviceSensor  
 {
@@ -41,6 +42,7 @@ public:
 
 protected:
 	CKiSensorPropPage m_kiSensorPropertiesPage;
+	CSerialSession m_serialSession;		// Kept open from the first measure until Release
  
 public:
 	CString	m_comPort;
@@ -52,6 +54,7 @@ public:
 	UINT	m_nSensorsUsed;
 	UINT	m_nInterlaceMode;
 	BOOL	m_bFastMeasure;
+	BOOL	m_bFastReadings;		// Fast measures while readings are filtered live
 	BOOL	m_bSingleSensor;
 	BOOL	m_bLEDStopped;
 
@@ -69,6 +72,7 @@ public:
 
 	virtual void SetPropertiesSheetValues();
 	virtual void GetPropertiesSheetValues();
+	virtual void setFastReadings(bool bFast) { m_bFastReadings = bFast; }
 
 	virtual LPCSTR GetStandardSubDir ()	{ return "Etalon_HCFR"; }
 
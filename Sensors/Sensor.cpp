@@ -25,6 +25,7 @@
 #include "ColorHCFR.h"
 #include "Sensor.h"
 #include "Generator.h"
+#include "TraceLog.h"
 
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -117,12 +118,17 @@ BOOL CSensor::Release()
 
 CColor CSensor::MeasureColor(const ColorRGBDisplay& aRGBValue, int displaymode)
 {
+	HCFR_TRACE_FUNCTION("sensor");
 	CColor result;
-	if (this->GetName() == "Simulated sensor")
-	    result = MeasureColorInternal(aRGBValue, displaymode);
-	else
-		result = MeasureColorInternal(aRGBValue);
+	{
+		HCFR_TRACE_SPAN("MeasureColorInternal", "sensor");
+		if (this->GetName() == "Simulated sensor")
+			result = MeasureColorInternal(aRGBValue, displaymode);
+		else
+			result = MeasureColorInternal(aRGBValue);
+	}
 	
+	HCFR_TRACE_SPAN("XYZ conversion", "sensor");
 	result.SetX(max(result.GetX(),0.00000001));
 	result.SetY(max(result.GetY(),0.00000001));
 	result.SetZ(max(result.GetZ(),0.00000001));
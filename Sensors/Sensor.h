@@ -112,6 +112,11 @@ public:
     virtual bool isColorimeter() const { return true; }
     virtual int ReadingType() const {return 0;}
     virtual bool setAvg() {return false;}
+    // Shortest readings the instrument can take, for live adjustment
+    virtual void setFastReadings(bool bFast) {}
+    // The instrument's own display update delay probe: showWhite is
+    // called from another thread while it watches for the change
+    virtual bool measureUpdateDelay(void (*showWhite)(void* context), void* context, int& updateDelayMs, int& instrumentDelayMs) { return false; }
 private:
     virtual CColor MeasureColorInternal(const ColorRGBDisplay& aRGBValue, int displaymode = 0) { return noDataColor;};
 };
@@ -26,6 +26,7 @@
 #include "ArgyllMeterWrapper.h"
 #include "CriticalSection.h"
 #include "LockWhileInScope.h"
+#include "TraceLog.h"
 #include <stdexcept>
 
 //#define SALONEINSTLIB
@@ -73,6 +74,25 @@ namespace
     {
         return ((fullInstCode & inst_mask) == partialInstCode);
     }
+
+    // the white patch half of an update delay measure, run while the
+    // meter samples in meas_delay()
+    struct WhiteChange
+    {
+        _inst* meter;
+        void (*showWhite)(void* context);
+        void* context;
+    };
+
+    DWORD WINAPI whiteChangeThreadFunc(LPVOID lpParam)
+    {
+        WhiteChange* pChange = (WhiteChange*)lpParam;
+        // let the meter see black for a while first
+        Sleep(200);
+        pChange->showWhite(pChange->context);
+        pChange->meter->white_change(pChange->meter, 0);
+        return 0;
+    }
    
     class ArgyllMeters
     {
@@ -175,13 +195,21 @@ ArgyllMeterWrapper::ArgyllMeterWrapper(_inst* meter) :
     m_meter(meter),
     m_nextCalibration(0),
     m_meterType(meter->get_itype(meter)),
-	m_Adapt(0)
+	m_Adapt(0),
+    m_fastReadings(false),
+    m_sp2cie(NULL),
+    m_sp2cieObType(-1)
     
 {
 }
 
 ArgyllMeterWrapper::~ArgyllMeterWrapper()
 {
+    if(m_sp2cie)
+    {
+        m_sp2cie->del(m_sp2cie);
+        m_sp2cie = NULL;
+    }
     if(m_meter)
     {
         m_meter->del(m_meter);
@@ -415,6 +443,45 @@ bool ArgyllMeterWrapper::doesMeterSupportCalibration()
             IMODETST(capabilities2, inst2_disptype) );
 }
 
+bool ArgyllMeterWrapper::doesMeterSupportUpdateDelay()
+{
+    checkMeterIsInitialized();
+    inst_mode capabilities(inst_mode_none);
+    inst2_capability capabilities2(inst2_none);
+    inst3_capability capabilities3(inst3_none);
+    m_meter->capabilities(m_meter, &capabilities, &capabilities2, &capabilities3);
+    return IMODETST(capabilities2, inst2_meas_disp_update) != 0;
+}
+
+bool ArgyllMeterWrapper::measureUpdateDelay(void (*showWhite)(void* context), void* context, int& dispMsec, int& instMsec, std::string& errorDescription)
+{
+    HCFR_TRACE_FUNCTION("meter");
+    if (!doesMeterSupportUpdateDelay())
+    {
+        errorDescription = "Meter can't measure the display update delay";
+        return false;
+    }
+
+    WhiteChange change = { m_meter, showWhite, context };
+    m_meter->white_change(m_meter, 1);
+    HANDLE hThread = CreateThread(NULL, 0, whiteChangeThreadFunc, &change, 0, NULL);
+    if (!hThread)
+    {
+        errorDescription = "Can't start the white patch thread";
+        return false;
+    }
+    inst_code instCode = m_meter->meas_delay(m_meter, &dispMsec, &instMsec);
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+
+    if (instCode != inst_ok)
+    {
+        errorDescription = m_meter->inst_interp_error(m_meter, instCode);
+        return false;
+    }
+    return true;
+}
+
 CColor ArgyllMeterWrapper::getLastReading() const
 {
     return m_lastReading;
@@ -503,6 +570,16 @@ int ArgyllMeterWrapper::getNumberOfObTypes()
     return icxOT_MAX;
 }
 
+std::vector<int> ArgyllMeterWrapper::getStandardObTypes()
+{
+    std::vector<int> obTypes;
+    for(int obType(icxOT_CIE_1931_2); obType < icxOT_MAX; ++obType)
+    {
+        obTypes.push_back(obType);
+    }
+    return obTypes;
+}
+
 const char* ArgyllMeterWrapper::getObTypeText(int obTypeInt)
 {
     return standardObserverDescription((icxObserverType) obTypeInt);
@@ -562,6 +639,7 @@ bool ArgyllMeterWrapper::setObType(CString SpectralType)
 
 ArgyllMeterWrapper::eMeterState ArgyllMeterWrapper::takeReading(CString SpectralType)
 {
+    HCFR_TRACE_FUNCTION("meter");
     checkMeterIsInitialized();
     ipatch argyllReading;
 	xsp2cie *sp2cie = NULL;			/* default conversion */
@@ -570,16 +648,33 @@ ArgyllMeterWrapper::eMeterState ArgyllMeterWrapper::takeReading(CString Spectral
 
 	if (!isColorimeter()) //needs to be set each time
     {
-        if (setObType(SpectralType))		
+        if (setObType(SpectralType))
+        {
+            // keep the converter between readings so its integration
+            // steps are only rebuilt when the observer changes
+            if (m_sp2cie != NULL && m_sp2cieObType != m_obType)
+            {
+                m_sp2cie->del(m_sp2cie);
+                m_sp2cie = NULL;
+            }
 //            MessageBox(NULL,"Set observer to "+SpectralType,"Setting observer",MB_OK);
 //        if ((sp2cie = new_xsp2cie(icxIT_none, &cust_illum, static_cast<icxObserverType>(m_obType), NULL, icSigXYZData,
 //			                           icxNoClamp)) == NULL)
-        if ((sp2cie = new_xsp2cie(icxIT_none, (int)6500, &cust_illum, static_cast<icxObserverType>(m_obType), NULL, icSigXYZData,
+            if (m_sp2cie == NULL)
+            {
+                if ((m_sp2cie = new_xsp2cie(icxIT_none, (int)6500, &cust_illum, static_cast<icxObserverType>(m_obType), NULL, icSigXYZData,
 			                           icxNoClamp)) == NULL)
-            MessageBox(NULL,"Creation of sp2cie object failed","Error setting observer",MB_OK);
+                    MessageBox(NULL,"Creation of sp2cie object failed","Error setting observer",MB_OK);
+                m_sp2cieObType = m_obType;
+            }
+            sp2cie = m_sp2cie;
+        }
     }
 
-	instCode = m_meter->read_sample(m_meter, "SPOT", &argyllReading, instNoClamp);
+    {
+        HCFR_TRACE_SPAN("read_sample", "meter");
+        instCode = m_meter->read_sample(m_meter, "SPOT", &argyllReading, instNoClamp);
+    }
     if(isInstCodeReason(instCode, inst_needs_cal))
     {
         // try autocalibration - we might get lucky
@@ -614,40 +709,51 @@ ArgyllMeterWrapper::eMeterState ArgyllMeterWrapper::takeReading(CString Spectral
     {
         throw std::logic_error("Taking Reading failed");
     }
-    if (!isColorimeter() && sp2cie != NULL)
-        sp2cie->convert(sp2cie, argyllReading.XYZ, &argyllReading.sp);
     m_lastReading.ResetSpectrum();
 
-    double X=argyllReading.XYZ[0];
-    double Y=argyllReading.XYZ[1];
-    double Z=argyllReading.XYZ[2];
+    // the number of readings to average is picked from the meter's own
+    // XYZ, they are then all converted under the observer in one batch
+    double meterY=argyllReading.XYZ[1];
 
     //Simple low-light averager    
     int cnt = 0;
-	if (m_Adapt)
+	if (m_Adapt && !m_fastReadings)
     {
-        if (Y < 1.0)
+        if (meterY < 1.0)
             cnt = 4; // 5 samples
-        else if (Y < 2.0)
+        else if (meterY < 2.0)
             cnt = 3; // 4 samples
-        else if (Y < 5.0)
+        else if (meterY < 5.0)
             cnt = 2; // 3 samples
-        else if (Y < 10.0)
+        else if (meterY < 10.0)
             cnt = 1; // 2 samples
+    }
 
-        if (cnt > 0)
+    std::vector<xspect> spectra(cnt+1);
+    std::vector<double> xyz(3 * (cnt+1));
+    for(int i(0); i <= cnt; ++i)
+    {
+        if (i > 0)
         {
-            for(int i(0); i < cnt; ++i)
-            {
-                instCode = m_meter->read_sample(m_meter, "SPOT", &argyllReading, instNoClamp);
-                if (!isColorimeter() && sp2cie != NULL)
-                    sp2cie->convert(sp2cie, argyllReading.XYZ, &argyllReading.sp);
-                    X+=argyllReading.XYZ[0];
-                    Y+=argyllReading.XYZ[1];
-                    Z+=argyllReading.XYZ[2];
-            }
+            HCFR_TRACE_SPAN("low light averaging", "meter");
+            instCode = m_meter->read_sample(m_meter, "SPOT", &argyllReading, instNoClamp);
+        }
+        spectra[i] = argyllReading.sp;
+        for(int j(0); j < 3; ++j)
+        {
+            xyz[3 * i + j] = argyllReading.XYZ[j];
         }
     }
+    if (!isColorimeter() && sp2cie != NULL)
+        sp2cie->bconvert(sp2cie, (double (*)[3])&xyz[0], &spectra[0], cnt+1);
+
+    double X=0.0, Y=0.0, Z=0.0;
+    for(int i(0); i <= cnt; ++i)
+    {
+        X+=xyz[3 * i];
+        Y+=xyz[3 * i + 1];
+        Z+=xyz[3 * i + 2];
+    }
     X = X / (cnt+1);
     Y = Y / (cnt+1);
     Z = Z / (cnt+1);
@@ -661,11 +767,55 @@ ArgyllMeterWrapper::eMeterState ArgyllMeterWrapper::takeReading(CString Spectral
         CSpectrum spectrum(argyllReading.sp.spec_n, shortWavelength, longWavelength, bandWidth, argyllReading.sp.spec);
         m_lastReading.SetSpectrum(spectrum);
     }
-	if (sp2cie != NULL)
-		sp2cie->del(sp2cie);
     return READY;
 }
 
+bool ArgyllMeterWrapper::spectraToXYZ(const std::vector<CSpectrum>& spectra, const std::vector<int>& obTypes, std::vector<ColorXYZ>& results)
+{
+    int nSpectra((int)spectra.size());
+    int nObservers((int)obTypes.size());
+
+    results.clear();
+    if(nSpectra == 0 || nObservers == 0)
+    {
+        return true;
+    }
+
+    std::vector<xspect> samples(nSpectra);
+    for(int i(0); i < nSpectra; ++i)
+    {
+        const CSpectrum& spectrum(spectra[i]);
+        if(spectrum.GetRows() < 2 || spectrum.GetRows() > XSPECT_MAX_BANDS)
+        {
+            return false;
+        }
+        XSPECT_SET_INFO(&samples[i], spectrum.GetRows(), spectrum.m_WaveLengthMin, spectrum.m_WaveLengthMax, 1.0);
+        for(int j(0); j < spectrum.GetRows(); ++j)
+        {
+            samples[i].spec[j] = spectrum[j];
+        }
+    }
+
+    std::vector<icxObserverType> observers(nObservers);
+    for(int i(0); i < nObservers; ++i)
+    {
+        observers[i] = static_cast<icxObserverType>(obTypes[i]);
+    }
+
+    std::vector<double> xyz(3 * nObservers * nSpectra);
+    if(icx_spN2XYZ_multi((double (*)[3])&xyz[0], &observers[0], nObservers, &samples[0], nSpectra))
+    {
+        return false;
+    }
+
+    results.reserve(nObservers * nSpectra);
+    for(int i(0); i < nObservers * nSpectra; ++i)
+    {
+        results.push_back(ColorXYZ(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]));
+    }
+    return true;
+}
+
 ArgyllMeterWrapper::eMeterState ArgyllMeterWrapper::calibrate()
 {
    checkMeterIsInitialized();
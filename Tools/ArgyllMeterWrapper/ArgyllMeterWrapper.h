@@ -34,6 +34,7 @@
 #include "SpectralSampleFiles.h" 
 
 struct _inst;
+struct _xsp2cie;
 
 class ArgyllMeterWrapper
 {
@@ -64,6 +65,15 @@ public:
     /// see if the meter supports calibration
     bool doesMeterSupportCalibration();
 
+    /// see if the meter can measure the display update delay
+    bool doesMeterSupportUpdateDelay();
+
+    /// measure the display update delay and the meter's own reaction
+    /// time, both in msec. Black must be on screen: showWhite is called
+    /// from another thread during the measure and must display white.
+    /// returns true on success
+    bool measureUpdateDelay(void (*showWhite)(void* context), void* context, int& dispMsec, int& instMsec, std::string& errorDescription);
+
     // try and do a reading
     // the client application will need to handle the
     // possible non success conditions
@@ -84,8 +94,10 @@ public:
     //Set the observer type used for meter->XYZ calcs, spectral devices only, return true if changed
     bool setObType(CString SpectralType);
     void setObType(int obTypeInt);
-    const char* getObTypeText(int obTypeInt);
-    int getNumberOfObTypes();
+    static const char* getObTypeText(int obTypeInt);
+    static int getNumberOfObTypes();
+    // the observers of the CIE and of the literature, without default, none and custom
+    static std::vector<int> getStandardObTypes();
     int getObType();
 
 	// Load the supplied spectral sample
@@ -122,6 +134,10 @@ public:
     /// Enable/Disable adaptive averaging
     bool setAdaptMode();
 
+    /// Single readings only, whatever the adaptive averaging, while
+    /// readings are filtered live
+    void setFastReadings(bool fastReadings) { m_fastReadings = fastReadings; }
+
     /// Does device support high resolution mode on i1Pro
     bool doesSupportHiRes() const;
 
@@ -139,6 +155,12 @@ public:
     // or delete the returned objects
     static ArgyllMeterWrappers getDetectedMeters(std::string& errorMessage);
 
+    // convert a batch of emissive spectra to XYZ for each of the given
+    // observers, one batch conversion per observer, results are indexed
+    // [observer * nSpectra + spectrum]
+    // returns false if an observer is unknown or a spectrum is invalid
+    static bool spectraToXYZ(const std::vector<CSpectrum>& spectra, const std::vector<int>& obTypes, std::vector<ColorXYZ>& results);
+
     // is the meter a colorimeter rather than a spectrometer
     virtual bool isColorimeter();
 
@@ -156,6 +178,9 @@ private:
     BOOL dark_only;
     char m_calibrationMessage[200];    
     bool m_Adapt;
+    bool m_fastReadings;
+    _xsp2cie* m_sp2cie;
+    int m_sp2cieObType;
     
     std::string m_SampleDescription;
 };
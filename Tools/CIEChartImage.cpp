@@ -23,6 +23,7 @@
 #include "stdafx.h"
 #include "color.h"
 #include "ColorHCFR.h"
+#include "CIEChartRaster.h"
 #include <math.h>
 
 
@@ -657,19 +658,11 @@ void DrawCIEChart(CDC* pDC, int cxMax, int cyMax, BOOL doFullChart, BOOL doShowB
 	POINT		ptFrom [ 4 ];
 	POINT		ptTo [ 4 ];
 	int			NbSegments;
-	COLORREF	Color;
 
 	int			DeltaX;
 	int			AbsDeltaY;
 	int			delta;
-	int			nMaxRgbVal = ( bCIEab ? 240 : (doFullChart ? 255 : 200) );
-	double		d;
-	double		squared_white_ray = 0.02;	// defines a diffusion zone around white point, to make it esthetically visible
-	double		xCie, yCie, zCie, yCieLine;
-	double		uCie, vCie;
-//	double		aCie, bCie;
-	double		val_r, val_g, val_b;
-	double		val_min, val_max;
+	double		xCie, yCie;
 	int			nCurrentPoint [ 2 ];	// Index 0 is left side of the tongue, Index 1 is right side
 	int			nbptShape [ 2 ];		// Index 0 is left side of the tongue, Index 1 is right side
 	POINT		ptShape [ 2 ] [ 256 ];	// Index 0 is left side of the tongue, Index 1 is right side
@@ -677,65 +670,38 @@ void DrawCIEChart(CDC* pDC, int cxMax, int cyMax, BOOL doFullChart, BOOL doShowB
 	double		(*pLeft) [2];
 	double		(*pRight) [2];
 
-	// Beautifying: something between 1 and 1/2.2 is fine. 
-	// Value 1 make primary colors larger than secondary, 1/2.2 makes large secondaries and reduces primaries 
-	const double gamma = 1.0 / 2.2;
-
-	// Variables for CIExy to rgb conversion
-    CColor	WhiteReference = GetColorReference().GetWhite();
-	CColor	RedReference = GetColorReference().GetRed();
-	CColor	GreenReference = GetColorReference().GetGreen();
-	CColor	BlueReference = GetColorReference().GetBlue();
-
-	const double xr = 0.6400;
-	const double yr = 0.3300;
-	const double zr = 1 - (xr + yr);
-
-    const double xg = 0.3000;
-	const double yg = 0.6000;
-	const double zg = 1 - (xg + yg);
-
-    const double xb = 0.1500;
-	const double yb = 0.0600;
-	const double zb = 1 - (xb + yb);
-
-    const double xw = WhiteReference.GetxyYValue()[0];
-	const double yw = WhiteReference.GetxyYValue()[1];
-	const double zw = 1 - (xw + yw);
-
-    /* xyz -> rgb matrix, before scaling to white. */
-    double rx = yg*zb - yb*zg;
-	double ry = xb*zg - xg*zb;
-	double rz = xg*yb - xb*yg;
-    double gx = yb*zr - yr*zb;
-	double gy = xr*zb - xb*zr;
-	double gz = xb*yr - xr*yb;
-    double bx = yr*zg - yg*zr;
-	double by = xg*zr - xr*zg;
-	double bz = xr*yg - xg*yr;
-
-    /* White scaling factors.
-       Dividing by yw scales the white luminance to unity, as conventional. */
-    const double rw = (rx*xw + ry*yw + rz*zw) / yw;
-    const double gw = (gx*xw + gy*yw + gz*zw) / yw;
-    const double bw = (bx*xw + by*yw + bz*zw) / yw;
-
-    /* xyz -> rgb matrix, correctly scaled to white. */
-    rx = rx / rw;
-	ry = ry / rw;
-	rz = rz / rw;
-    gx = gx / gw;
-	gy = gy / gw;
-	gz = gz / gw;
-    bx = bx / bw;
-	by = by / bw;
-	bz = bz / bw;
-	ColorLab tmp;
-
-	double lxr,lyr,lzr,fx,fy,fz;
-	double ep = 216. / 24389.;
-	double kap = 24389. / 27.;
-	ColorXYZ White = WhiteReference.GetXYZValue();
+	// Pixel colors are computed all at once, in parallel or from the disk cache,
+	// the scan line loop below only clips them to the tongue
+	CIEChartRasterDesc	RasterDesc;
+	std::vector<unsigned int> RasterPixels;
+	ColorXYZ	White = GetColorReference().GetWhite().GetXYZValue();
+	char		szCacheDir [ MAX_PATH ];
+	const char * pCacheDir = NULL;
+
+	RasterDesc.cx = cxMax;
+	RasterDesc.cy = cyMax;
+	RasterDesc.nDiagram = ( bCIEuv ? CIE_DIAGRAM_UV : ( bCIEab ? CIE_DIAGRAM_AB : CIE_DIAGRAM_XY ) );
+	RasterDesc.nMaxRgbVal = ( bCIEab ? 240 : (doFullChart ? 255 : 200) );
+	RasterDesc.whiteXYZ [ 0 ] = White [ 0 ];
+	RasterDesc.whiteXYZ [ 1 ] = White [ 1 ];
+	RasterDesc.whiteXYZ [ 2 ] = White [ 2 ];
+
+	if ( getenv ( "APPDATA" ) && strlen ( getenv ( "APPDATA" ) ) + 8 < sizeof ( szCacheDir ) )
+	{
+		strcpy ( szCacheDir, getenv ( "APPDATA" ) );
+		strcat ( szCacheDir, "\\color" );
+		pCacheDir = szCacheDir;
+	}
+	GetCIEChartRaster ( RasterDesc, pCacheDir, RasterPixels );
+
+	BITMAPINFO	RowInfo;
+	memset ( & RowInfo, 0, sizeof ( RowInfo ) );
+	RowInfo.bmiHeader.biSize = sizeof ( BITMAPINFOHEADER );
+	RowInfo.bmiHeader.biWidth = cxMax;
+	RowInfo.bmiHeader.biHeight = 1;
+	RowInfo.bmiHeader.biPlanes = 1;
+	RowInfo.bmiHeader.biBitCount = 32;
+	RowInfo.bmiHeader.biCompression = BI_RGB;
 
 	if ( bCIEuv )
 	{
@@ -1301,104 +1267,11 @@ void DrawCIEChart(CDC* pDC, int cxMax, int cyMax, BOOL doFullChart, BOOL doShowB
 		{
 			k = max ( 0, From [ i ] );
 			l = min ( cxMax - 1, To [ i ] ) - k;
-			if ( l >= 0 )
+			if ( l >= 0 && Y_Cour >= 0 && Y_Cour < cyMax && pDC )
 			{
-				// Compute color of each pixel
-				// Transform pixel coordinates (k, Y_Cour) in CIExy coordinates to determine its color
-				if (bCIEab)
-					yCieLine = (double) (( cyMax - Y_Cour ) * (400.)) / (double) cyMax - 200;
-				else
-					yCieLine = (double) (( cyMax - Y_Cour ) * (bCIEuv ? 0.8 : 1.0)) / (double) cyMax - 0.05;
-
-				for ( j = 0 ; j <= l ; j ++ )
-				{
-					if ( bCIEuv )
-					{
-						// Use CIE u'v' coordinates: convert them into CIE xy coordinates to define pixel color
-						uCie = (double) (k * 0.8) / (double) cxMax - 0.075;
-						vCie = yCieLine;
-
-						xCie = ( 9.0 * uCie ) / ( ( 6.0 * uCie ) - ( 16.0 * vCie ) + 12.0 );
-						yCie = ( 4.0 * vCie ) / ( ( 6.0 * uCie ) - ( 16.0 * vCie ) + 12.0 );
-					}
-					else if (bCIEab)
-					{
-						xCie = (double) (k * 400.) / (double) cxMax - 220.;
-						tmp[0]=xCie;
-						tmp[1]=yCieLine;
-						fx = tmp[0] / 500. + 1;
-						fy = 1.0;
-						fz = fy - tmp[1] / 200.;
-
-						if (pow(fx,3.0) > ep)
-							lxr = pow(fx,3.0);
-						else
-							lxr = (116. * fx - 16.) / kap;
-
-						lyr = pow(fy,3);
-
-						if (pow(fz,3.0) > ep)
-							lzr = pow(fz,3.0);
-						else
-							lzr = (116 * fz -16) / kap;
-
-						double X = (lxr * White[0]);
-						double Y = (lyr * White[1]);
-						double Z = (lzr * White[2]);
-
-						xCie = X / (X + Y + Z);
-						yCie = Y / (X + Y + Z);
-					}
-					else
-					{
-						xCie = (double) (k * 0.9) / (double) cxMax - 0.075;
-						yCie = yCieLine;
-					}
-
-					// Test if we are inside white circle to enlight
-					d = (xCie-xw)*(xCie-xw) + (yCie-yw)*(yCie-yw);
-					if ( d < squared_white_ray && !bCIEab)
-					{
-						// Enlarge smoothly white zone
-						d = pow ( d / squared_white_ray, 0.5 );
-						xCie = xw + (xCie - xw ) * d;
-						yCie = yw + (yCie - yw ) * d;
-					}
-
-					zCie = 1.0 - ( xCie + yCie );
-
-					/* rgb of the desired point */
-					val_r = rx*xCie + ry*yCie + rz*zCie;
-					val_g = gx*xCie + gy*yCie + gz*zCie;
-					val_b = bx*xCie + by*yCie + bz*zCie;
-					
-					val_min = min ( val_r, val_g );
-					if ( val_b < val_min )
-						val_min = val_b;
-					
-					if (val_min < 0) 
-					{
-						val_r -= val_min;
-						val_g -= val_min;
-						val_b -= val_min;
-					}
-						
-					// Scale to max(rgb) = 1. 
-					val_max = max ( val_r, val_g );
-					if ( val_b > val_max )
-						val_max = val_b;
-					
-					if ( val_max > 0 ) 
-					{
-						val_r /= val_max;
-						val_g /= val_max;
-						val_b /= val_max;
-					}
-					
-					Color = RGB ( (int)(pow(val_r,gamma) * nMaxRgbVal), (int)(pow(val_g,gamma) * nMaxRgbVal), (int)(pow(val_b,gamma) * nMaxRgbVal) );
-					if (pDC)
-						pDC -> SetPixel ( k ++, Y_Cour, Color );
-				}
+				// Copy the precomputed colors of the span (k, Y_Cour) - (k + l, Y_Cour)
+				SetDIBitsToDevice ( pDC -> m_hDC, k, Y_Cour, l + 1, 1, k, 0, 0, 1,
+									& RasterPixels [ (size_t) Y_Cour * cxMax ], & RowInfo, DIB_RGB_COLORS );
 			}
 		}
 
@@ -32,6 +32,19 @@ void CGoogleCastWrapper::RefreshList()
 	}
 }
 
+// Warm the discovery table up ahead of the first RefreshList()
+void CGoogleCastWrapper::StartDiscovery()
+{
+	if (start_ccids())
+		OutputDebugStringA("Google Cast discovery could not be started");
+}
+
+// get_ccids() keeps a discovery thread running; stop it before exit
+void CGoogleCastWrapper::StopDiscovery()
+{
+	stop_ccids();
+}
+
 const ccast_id *CGoogleCastWrapper::operator[](const char *name) const
 {
 	ccast_id *ret = NULL;
@@ -9,6 +9,8 @@ public:
 	~CGoogleCastWrapper(void);
 
 	void RefreshList();
+	static void StartDiscovery();
+	static void StopDiscovery();
 	int getCount() const { return m_count; }
 
 	const ccast_id *operator[](int index) const { return m_ids ? m_ids[index] : 0; }
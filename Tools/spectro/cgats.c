@@ -73,6 +73,16 @@ extern void error(const char *fmt, ...), warning(const char *fmt, ...);
 
 #undef  EMIT_KEYWORDS		/* [und] Emit unknown keywords by default */
 #define REAL_SIGDIG 6		/* [6] Number of significant digits in real representation */
+#define ARENA_MIN_CHUNK 4096			/* First table arena chunk size */
+#define ARENA_MAX_CHUNK (1024 * 1024)	/* Arena chunks double up to this size */
+
+/* A chunk of a table arena */
+struct _cgats_chunk {
+	struct _cgats_chunk *next;
+	size_t size;		/* Size of the space */
+	size_t used;		/* Space allocated so far */
+	double space[1];	/* Start of the space, aligned for any value */
+};
 
 static int cgats_read(cgats *p, cgatsFile *fp);
 static int find_kword(cgats *p, int table, const char *ksym);
@@ -94,6 +104,13 @@ static void cgats_del(cgats *p);
 
 static void cgats_table_free(cgats_table *t);
 static void *alloc_copy_data_type(cgatsAlloc *al, data_type ktype, void *dpoint);
+static void *arena_alloc(cgats_table *t, size_t size);
+static void *arena_copy_data_type(cgats_table *t, data_type dtype, void *dpoint);
+static int reserve_sets(cgats *p, cgats_table *t, int nsets, int rf);
+static int update_hash(cgats_table *t, int **hash, int *hasha, int *hn, char **syms, char **data, int nsyms);
+static int find_hash(int *hash, int hasha, char **syms, const char *sym);
+static double read_real(const char *cs);
+static int read_int(const char *cs);
 static int reserved_kword(const char *ksym);
 static int standard_kword(const char *ksym);
 static data_type standard_field(const char *fsym);
@@ -104,13 +121,21 @@ static int add_kword_at(cgats *p, int table, int  pos, const char *ksym, const c
 static int add_data_item(cgats *p, int table, void *data);
 static void unquote_cs(char *cs);
 static data_type guess_type(const char *cs);
+static int real_params(double value, int nsd, int *width, int *prec);
 static void real_format(double value, int nsd, char *fmt);
+static int fixed_real(char *buf, double value, int width, int prec);
 
 #ifdef COMBINED_STD
 static int cgats_read_name(cgats *p, const char *filename);
 static int cgats_write_name(cgats *p, const char *filename);
 #endif
 
+/* Exact powers of 10 */
+static const double exact_p10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 static const char *data_type_desc[] =
 	{ "real", "integer", "char string", "non-quoted char string", "no type" };
 
@@ -251,7 +276,7 @@ cgats_del(cgats *p) {
 static void
 cgats_table_free(cgats_table *t) {
 	cgatsAlloc *al = t->al;
-	int i,j;
+	int i;
 
 	/* Free all the keyword symbols */
 	if (t->ksym != NULL) {
@@ -285,28 +310,194 @@ cgats_table_free(cgats_table *t) {
 	/* Free array of field types */
 	if (t->ftype != NULL)
 		al->free(al, t->ftype);
-	/* Free all the original fields text values */
-	if (t->rfdata != NULL) {
-		for (j = 0; j < t->nsets; j++)
-			if (t->rfdata[j] != NULL) {
-				for (i = 0; i < t->nfields; i++)
-					if(t->rfdata[j][i] != NULL)
-						al->free(al, t->rfdata[j][i]);
-				al->free(al, t->rfdata[j]);
-			}
+	/* Free the set pointer arrays. The sets and their values */
+	/* are in the arena. */
+	if (t->rfdata != NULL)
 		al->free(al, t->rfdata);
+	if (t->fdata != NULL)
+		al->free(al, t->fdata);
+	while (t->arena != NULL) {
+		struct _cgats_chunk *c = t->arena;
+		t->arena = c->next;
+		al->free(al, c);
+	}
+
+	/* Free the lookup hashes */
+	if (t->khash != NULL)
+		al->free(al, t->khash);
+	if (t->fhash != NULL)
+		al->free(al, t->fhash);
+}
+
+/* ------------------------------------------- */
+
+/* The sets of a table, and their values, are allocated from a list */
+/* of chunks, so that a table of thousands of sets costs a few */
+/* allocations, and is freed as a whole. */
+
+/* Allocate space from the table arena */
+/* Return NULL if malloc failed */
+static void *
+arena_alloc(cgats_table *t, size_t size) {
+	cgatsAlloc *al = t->al;
+	struct _cgats_chunk *c = t->arena;
+	void *rv;
+
+	size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+	if (c == NULL || (c->size - c->used) < size) {
+		size_t csize;
+
+		if (t->arenas < ARENA_MIN_CHUNK)
+			t->arenas = ARENA_MIN_CHUNK;
+		csize = t->arenas > size ? t->arenas : size;
+		if ((c = (struct _cgats_chunk *)al->malloc(al, sizeof(struct _cgats_chunk) + csize)) == NULL)
+			return NULL;
+		c->size = csize;
+		c->used = 0;
+		c->next = t->arena;
+		t->arena = c;
+		if (t->arenas < ARENA_MAX_CHUNK)
+			t->arenas *= 2;
+	}
+	rv = (void *)((char *)c->space + c->used);
+	c->used += size;
+	return rv;
+}
+
+/* Allocate space for data with given type from the table arena, */
+/* and copy it from source */
+/* Return NULL if alloc failed, or unknown data type */
+static void *
+arena_copy_data_type(cgats_table *t, data_type dtype, void *dpoint) {
+	switch(dtype) {
+		case r_t: {	/* Real value */
+			double *p;
+			if ((p = (double *)arena_alloc(t, sizeof(double))) == NULL)
+				return NULL;
+			*p = *((double *)dpoint);
+			return (void *)p;
+		}
+		case i_t: {	/* Integer value */
+			int *p;
+			if ((p = (int *)arena_alloc(t, sizeof(int))) == NULL)
+				return NULL;
+			*p = *((int *)dpoint);
+			return (void *)p;
+		}
+		case cs_t:	/* Character string */
+		case nqcs_t: {	/* Character string */
+			char *p;
+			size_t len = strlen((char *)dpoint) + 1;
+			if ((p = (char *)arena_alloc(t, len * sizeof(char))) == NULL)
+				return NULL;
+			memcpy(p, dpoint, len);
+			return (void *)p;
+		}
+		case none_t:
+		default:
+			return NULL;
 	}
-	/* Free all the fields values */
-	if (t->fdata != NULL) {
-		for (j = 0; j < t->nsets; j++)
-			if (t->fdata[j] != NULL) {
-				for (i = 0; i < t->nfields; i++)
-					if(t->fdata[j][i] != NULL)
-						al->free(al, t->fdata[j][i]);
-				al->free(al, t->fdata[j]);
+	return NULL;	/* Shut the compiler up */
+}
+
+/* Make room for at least nsets set pointers. The arrays grow */
+/* geometrically, so adding n sets costs log(n) reallocs. */
+/* rf is non-zero to make room for read file text values too */
+/* return -2, errc & err on error */
+static int
+reserve_sets(cgats *p, cgats_table *t, int nsets, int rf) {
+	cgatsAlloc *al = p->al;
+	int nsetsa;
+
+	if (nsets <= t->nsetsa && (!rf || t->rfdata != NULL))
+		return 0;
+
+	nsetsa = t->nsetsa < 100 ? 100 : 2 * t->nsetsa;
+	if (nsetsa < nsets)
+		nsetsa = nsets;
+	if ((t->fdata = (void ***)al->realloc(al, t->fdata, nsetsa * sizeof(void **))) == NULL)
+		return err(p,-2,"cgats.reserve_sets(), realloc failed!");
+	if (rf || t->rfdata != NULL) {
+		if ((t->rfdata = (char ***)al->realloc(al, t->rfdata, nsetsa * sizeof(char **))) == NULL)
+			return err(p,-2,"cgats.reserve_sets(), realloc failed!");
+	}
+	t->nsetsa = nsetsa;
+	return 0;
+}
+
+/* ------------------------------------------- */
+
+/* Keywords and fields are found through an open addressed hash */
+/* of their index + 1. The hash is brought up to date with the */
+/* symbols when a lookup is made. */
+
+/* FNV-1a hash of a symbol */
+static unsigned int
+sym_hash(const char *sym) {
+	unsigned int h = 2166136261u;
+
+	for (; *sym != '\000'; sym++) {
+		h ^= (unsigned char)*sym;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* Add any symbols not yet in the hash. Only the first of several */
+/* symbols with the same name is found. If data is not NULL, symbols */
+/* without data are left out. */
+/* Return non-zero if malloc failed */
+static int
+update_hash(cgats_table *t, int **hash, int *hasha, int *hn, char **syms, char **data, int nsyms) {
+	cgatsAlloc *al = t->al;
+	int i;
+
+	/* Rebuild if the symbols were replaced, or the hash is getting full */
+	if (*hash == NULL || *hn < 0 || *hn > nsyms || (2 * nsyms) > *hasha) {
+		int hs = *hasha < 16 ? 16 : *hasha;
+
+		while ((2 * nsyms) > hs)
+			hs *= 2;
+		if (hs != *hasha) {
+			if (*hash != NULL)
+				al->free(al, *hash);
+			if ((*hash = (int *)al->malloc(al, hs * sizeof(int))) == NULL) {
+				*hasha = 0;
+				*hn = -1;
+				return 1;
 			}
-		al->free(al, t->fdata);
+			*hasha = hs;
+		}
+		memset(*hash, 0, *hasha * sizeof(int));
+		*hn = 0;
+	}
+
+	for (i = *hn; i < nsyms; i++) {
+		unsigned int m = *hasha - 1, h;
+
+		if (syms[i] == NULL || (data != NULL && data[i] == NULL))
+			continue;
+		for (h = sym_hash(syms[i]) & m; (*hash)[h] != 0; h = (h + 1) & m) {
+			if (strcmp(syms[(*hash)[h]-1], syms[i]) == 0)
+				break;
+		}
+		if ((*hash)[h] == 0)
+			(*hash)[h] = i + 1;
+	}
+	*hn = nsyms;
+	return 0;
+}
+
+/* Return the index of the symbol in the hash, -1 if not there */
+static int
+find_hash(int *hash, int hasha, char **syms, const char *sym) {
+	unsigned int m = hasha - 1, h;
+
+	for (h = sym_hash(sym) & m; hash[h] != 0; h = (h + 1) & m) {
+		if (strcmp(syms[hash[h]-1], sym) == 0)
+			return hash[h]-1;
 	}
+	return -1;
 }
 
 /* Return index of the keyword, -1 on fail */
@@ -326,7 +517,10 @@ find_kword(cgats *p, int table, const char *ksym) {
 	if (ksym == NULL || ksym[0] == '\000')
 		return -1;
 
-	for (i = 0; i < t->nkwords; i ++) {
+	if (update_hash(t, &t->khash, &t->khasha, &t->khn, t->ksym, t->kdata, t->nkwords) == 0)
+		return find_hash(t->khash, t->khasha, t->ksym, ksym);
+
+	for (i = 0; i < t->nkwords; i ++) {		/* No memory for the hash */
 		if (t->ksym[i] != NULL && t->kdata[i] != NULL
 		    && strcmp(t->ksym[i],ksym) == 0)
 			return i;
@@ -352,7 +546,10 @@ find_field(cgats *p, int table, const char *fsym) {
 	if (fsym == NULL || fsym[0] == '\000')
 		return -1;
 
-	for (i = 0; i < t->nfields; i ++)
+	if (update_hash(t, &t->fhash, &t->fhasha, &t->fhn, t->fsym, NULL, t->nfields) == 0)
+		return find_hash(t->fhash, t->fhasha, t->fsym, fsym);
+
+	for (i = 0; i < t->nfields; i ++)		/* No memory for the hash */
 		if (strcmp(t->fsym[i],fsym) == 0)
 			return i;
 
@@ -571,6 +768,13 @@ cgats_read(cgats *p, cgatsFile *fp) {
 
 					if(strcmp(tp,"BEGIN_DATA") == 0) {
 						rstate = R_DATA;
+						/* Make room for the sets we've been told to expect */
+						if (expsets > 0
+						 && reserve_sets(p, &p->t[p->ntables-1], expsets, 1) < 0) {
+							pp->del(pp);
+							DBGF((DBGA,"Reserve sets failed\n"));
+							return p->errc;
+						}
 						break;
 					}
 					/* Else must be a keyword */
@@ -717,9 +921,9 @@ cgats_read(cgats *p, cgatsFile *fp) {
 							switch(bt) {
 								case r_t: {
 									double dv;
-									dv = atof((char *)ct->rfdata[j][i]);
-									if ((ct->fdata[j][i] = alloc_copy_data_type(p->al, bt, (void *)&dv)) == NULL) {
-										err(p, -2, "cgats.alloc_copy_data_type() malloc fail");
+									dv = read_real((char *)ct->rfdata[j][i]);
+									if ((ct->fdata[j][i] = arena_copy_data_type(ct, bt, (void *)&dv)) == NULL) {
+										err(p, -2, "cgats.arena_copy_data_type() malloc fail");
 										pp->del(pp);
 										DBGF((DBGA,"Alloc copy data type failed\n"));
 										return p->errc;
@@ -728,9 +932,9 @@ cgats_read(cgats *p, cgatsFile *fp) {
 								}
 								case i_t: {
 									int iv;
-									iv = atoi((char *)ct->rfdata[j][i]);
-									if ((ct->fdata[j][i] = alloc_copy_data_type(p->al, bt, (void *)&iv)) == NULL) {
-										err(p, -2, "cgats.alloc_copy_data_type() malloc fail");
+									iv = read_int((char *)ct->rfdata[j][i]);
+									if ((ct->fdata[j][i] = arena_copy_data_type(ct, bt, (void *)&iv)) == NULL) {
+										err(p, -2, "cgats.arena_copy_data_type() malloc fail");
 										pp->del(pp);
 										DBGF((DBGA,"Alloc copy data type failed\n"));
 										return p->errc = -2;
@@ -742,8 +946,8 @@ cgats_read(cgats *p, cgatsFile *fp) {
 									char *cv;
 									cv = ct->rfdata[j][i];
 									if ((ct->fdata[j][i]
-= alloc_copy_data_type(p->al, bt, (void *)cv)) == NULL) {
-										err(p, -2, "cgats.alloc_copy_data_type() malloc fail");
+= arena_copy_data_type(ct, bt, (void *)cv)) == NULL) {
+										err(p, -2, "cgats.arena_copy_data_type() malloc fail");
 										pp->del(pp);
 										DBGF((DBGA,"Alloc copy data type failed\n"));
 										return p->errc = -2;
@@ -962,6 +1166,7 @@ add_kword_at(cgats *p, int table, int pos, const char *ksym, const char *kdata,
 		}
 		pos = t->nkwords-1;
 	} else {	/* This is a replacement */
+		t->khn = -1;		/* Keyword hash needs rebuilding */
 		if (t->ksym[pos] != NULL)
 			al->free(al, t->ksym[pos]);
 		if (t->kdata[pos] != NULL)
@@ -1083,6 +1288,7 @@ clear_fields(cgats *p, int table) {
 	/* Zero all the field counters */
 	t->nfields = 0;
 	t->nfieldsa = 0;
+	t->fhn = -1;		/* Field hash needs rebuilding */
 
 	return 0;
 }
@@ -1092,7 +1298,6 @@ clear_fields(cgats *p, int table) {
 /* return -2, -1, errc & err on error */
 static int
 add_set(cgats *p, int table, ...) {
-	cgatsAlloc *al = p->al;
 	va_list args;
 	int i;
 	cgats_table *t;
@@ -1108,16 +1313,14 @@ add_set(cgats *p, int table, ...) {
 	if (t->nfields == 0)
 		return err(p,-1,"cgats.add_set(), attempt to add set when no fields are defined");
 
+	if (reserve_sets(p, t, t->nsets+1, 0) < 0)
+		return p->errc;
 	t->nsets++;
-	
-	if (t->nsets > t->nsetsa) /* Allocate space for more sets */ {
-		/* Allocate set pointers in groups of 100 */
-		t->nsetsa += 100;
-		if ((t->fdata = (void ***)al->realloc(al, t->fdata, t->nsetsa * sizeof(void **))) == NULL)
-			return err(p,-2,"cgats.add_set(), realloc failed!");
-	}
+	if (t->rfdata != NULL)
+		t->rfdata[t->nsets-1] = NULL;	/* Not read from a file */
+
 	/* Allocate set pointer to data element values */
-	if ((t->fdata[t->nsets-1] = (void **)al->malloc(al, t->nfields * sizeof(void *))) == NULL)
+	if ((t->fdata[t->nsets-1] = (void **)arena_alloc(t, t->nfields * sizeof(void *))) == NULL)
 		return err(p,-2,"cgats.add_set(), malloc failed!");
 
 	/* Allocate and copy data to new set */
@@ -1126,23 +1329,23 @@ add_set(cgats *p, int table, ...) {
 			case r_t: {
 				double dv;
 				dv = va_arg(args, double);
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)&dv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)&dv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			case i_t: {
 				int iv;
 				iv = va_arg(args, int);
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)&iv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)&iv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			case cs_t:
 			case nqcs_t: {
 				char *sv;
 				sv = va_arg(args, char *);
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)sv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)sv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			default:
@@ -1160,7 +1363,6 @@ add_set(cgats *p, int table, ...) {
 /* return -2, -1, errc & err on error */
 static int
 add_setarr(cgats *p, int table, cgats_set_elem *args) {
-	cgatsAlloc *al = p->al;
 	int i;
 	cgats_table *t;
 
@@ -1173,16 +1375,14 @@ add_setarr(cgats *p, int table, cgats_set_elem *args) {
 	if (t->nfields == 0)
 		return err(p,-1,"cgats.add_setarr(), attempt to add set when no fields are defined");
 
+	if (reserve_sets(p, t, t->nsets+1, 0) < 0)
+		return p->errc;
 	t->nsets++;
-	
-	if (t->nsets > t->nsetsa) /* Allocate space for more sets */ {
-		/* Allocate set pointers in groups of 100 */
-		t->nsetsa += 100;
-		if ((t->fdata = (void ***)al->realloc(al,t->fdata, t->nsetsa * sizeof(void **))) == NULL)
-			return err(p,-2,"cgats.add_set(), realloc failed!");
-	}
+	if (t->rfdata != NULL)
+		t->rfdata[t->nsets-1] = NULL;	/* Not read from a file */
+
 	/* Allocate set pointer to data element values */
-	if ((t->fdata[t->nsets-1] = (void **)al->malloc(al,t->nfields * sizeof(void *))) == NULL)
+	if ((t->fdata[t->nsets-1] = (void **)arena_alloc(t, t->nfields * sizeof(void *))) == NULL)
 		return err(p,-2,"cgats.add_set(), malloc failed!");
 
 	/* Allocate and copy data to new set */
@@ -1191,23 +1391,23 @@ add_setarr(cgats *p, int table, cgats_set_elem *args) {
 			case r_t: {
 				double dv;
 				dv = args[i].d;
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)&dv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)&dv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			case i_t: {
 				int iv;
 				iv = args[i].i;
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)&iv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)&iv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			case cs_t:
 			case nqcs_t: {
 				char *sv;
 				sv = args[i].c;
-				if ((t->fdata[t->nsets-1][i] = alloc_copy_data_type(al, t->ftype[i], (void *)sv)) == NULL)
-					return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+				if ((t->fdata[t->nsets-1][i] = arena_copy_data_type(t, t->ftype[i], (void *)sv)) == NULL)
+					return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 				break;
 			}
 			default:
@@ -1258,7 +1458,6 @@ get_setarr(cgats *p, int table, int set_index, cgats_set_elem *args) {
 /* return -2, -1, errc & err on error */
 static int
 add_data_item(cgats *p, int table, void *data) {
-	cgatsAlloc *al = p->al;
 	cgats_table *t;
 
 	p->errc = 0;
@@ -1271,28 +1470,20 @@ add_data_item(cgats *p, int table, void *data) {
 		return err(p,-1,"cgats.add_item(), attempt to add data when no fields are defined");
 
 	if (t->ndf == 0) {	/* We're about to do the first element of a new set */
+		if (reserve_sets(p, t, t->nsets+1, 1) < 0)
+			return p->errc;
 		t->nsets++;
-		
-		if (t->nsets > t->nsetsa) { /* Allocate space for more sets */
-			/* Allocate set pointers in groups of 100 */
-			t->nsetsa += 100;
-			if ((t->rfdata = (char ***)al->realloc(al, t->rfdata, t->nsetsa * sizeof(void **)))
-			                                                                        == NULL)
-				return err(p,-2,"cgats.add_item(), realloc failed!");
-			if ((t->fdata = (void ***)al->realloc(al, t->fdata, t->nsetsa * sizeof(void **)))
-			                                                                        == NULL)
-				return err(p,-2,"cgats.add_item(), realloc failed!");
-		}
+
 		/* Allocate set pointer to data element values */
-		if ((t->rfdata[t->nsets-1] = (char **)al->malloc(al, t->nfields * sizeof(void *))) == NULL)
+		if ((t->rfdata[t->nsets-1] = (char **)arena_alloc(t, t->nfields * sizeof(void *))) == NULL)
 			return err(p,-2,"cgats.add_item(), malloc failed!");
-		if ((t->fdata[t->nsets-1] = (void **)al->malloc(al, t->nfields * sizeof(void *))) == NULL)
+		if ((t->fdata[t->nsets-1] = (void **)arena_alloc(t, t->nfields * sizeof(void *))) == NULL)
 			return err(p,-2,"cgats.add_item(), malloc failed!");
 	}
 
 	/* Data type is always cs_t at this point, because we haven't decided the type */
-	if ((t->rfdata[t->nsets-1][t->ndf] = alloc_copy_data_type(al, cs_t, data)) == NULL)
-		return err(p,-2,"cgats.alloc_copy_data_type() malloc fail");
+	if ((t->rfdata[t->nsets-1][t->ndf] = arena_copy_data_type(t, cs_t, data)) == NULL)
+		return err(p,-2,"cgats.arena_copy_data_type() malloc fail");
 
 	if (++t->ndf >= t->nfields)
 		t->ndf = 0;
@@ -1300,6 +1491,107 @@ add_data_item(cgats *p, int table, void *data) {
 	return 0;
 }
 
+/* Output is formatted into a buffer, and written out when it */
+/* fills, rather than with a file printf per value */
+
+#define WBUF_SIZE 16384
+
+typedef struct {
+	cgatsAlloc *al;
+	cgatsFile *fp;
+	size_t bo;				/* Bytes in the buffer */
+	char b[WBUF_SIZE];
+} wbuf;
+
+/* Write out the buffer. Return -1 on error */
+static int
+wb_flush(wbuf *wb) {
+	if (wb->bo > 0) {
+		if (wb->fp->write(wb->fp, wb->b, 1, wb->bo) != wb->bo)
+			return -1;
+		wb->bo = 0;
+	}
+	return 0;
+}
+
+/* Add a string to the buffer. Return -1 on error */
+static int
+wb_puts(wbuf *wb, const char *str) {
+	size_t len = strlen(str);
+
+	if (len > (WBUF_SIZE - wb->bo)) {
+		if (wb_flush(wb) < 0)
+			return -1;
+		if (len > WBUF_SIZE) {		/* Won't fit, write it directly */
+			if (wb->fp->write(wb->fp, (void *)str, 1, len) != len)
+				return -1;
+			return 0;
+		}
+	}
+	memcpy(wb->b + wb->bo, str, len);
+	wb->bo += len;
+	return 0;
+}
+
+/* printf to the buffer. Return -1 on error */
+static int
+wb_printf(wbuf *wb, const char *format, ...) {
+	va_list args;
+	int len, i;
+	size_t bs;
+	char *b;
+
+	/* Try with what's left, then with an empty buffer */
+	for (i = 0; i < 2; i++) {
+		size_t left = WBUF_SIZE - wb->bo;
+
+		va_start(args, format);
+		len = vsnprintf(wb->b + wb->bo, left, format, args);
+		va_end(args);
+		if (len >= 0 && (size_t)len < left) {
+			wb->bo += len;
+			return 0;
+		}
+		if (i == 0 && wb_flush(wb) < 0)
+			return -1;
+	}
+
+	/* Too big for the buffer, format it in a temporary one. */
+	/* vsnprintf() either returns -1 if it doesn't fit, or */
+	/* returns the size-1 needed in order to fit. */
+	for (bs = len >= 0 ? len + 1 : 2 * WBUF_SIZE;; bs *= 2) {
+		if ((b = (char *)wb->al->malloc(wb->al, bs)) == NULL)
+			return -1;
+		va_start(args, format);
+		len = vsnprintf(b, bs, format, args);
+		va_end(args);
+		if (len >= 0 && (size_t)len < bs)
+			break;
+		wb->al->free(wb->al, b);
+	}
+	i = wb->fp->write(wb->fp, b, 1, len) == (size_t)len ? 0 : -1;
+	wb->al->free(wb->al, b);
+	return i;
+}
+
+/* Add a real value and a space to the buffer. Return -1 on error */
+static int
+wb_real(wbuf *wb, double value) {
+	char fmt[30];
+	int width, prec, conv, len;
+
+	conv = real_params(value, REAL_SIGDIG, &width, &prec);
+	if (conv == 'f' && width < 40 && (WBUF_SIZE - wb->bo) >= 64
+	 && (len = fixed_real(wb->b + wb->bo, value, width, prec)) >= 0) {
+		wb->bo += len;
+		wb->b[wb->bo++] = ' ';
+		return 0;
+	}
+	real_format(value, REAL_SIGDIG, fmt);
+	strcat(fmt," ");
+	return wb_printf(wb, fmt, value);
+}
+
 /* Write structure into cgats file */
 /* Return -ve, errc & err if there was an error */
 static int
@@ -1308,6 +1600,11 @@ cgats_write(cgats *p, cgatsFile *fp) {
 	int i;
 	int table,set,field;
 	int *sfield = NULL;	/* Standard field flag */
+	wbuf wb;
+
+	wb.al = al;
+	wb.fp = fp;
+	wb.bo = 0;
 	p->errc = 0;
 	p->err[0] = '\000';
 
@@ -1416,33 +1713,33 @@ cgats_write(cgats *p, cgatsFile *fp) {
 		if (!t->sup_id)	/* If not suppressed */ {
 			switch(t->tt) {
 				case it8_7_1:
-					if (fp->gprintf(fp,"IT8.7/1\n\n") < 0)
+					if (wb_printf(&wb,"IT8.7/1\n\n") < 0)
 						goto write_error;
 					break;
 				case it8_7_2:
-					if (fp->gprintf(fp,"IT8.7/2\n\n") < 0)
+					if (wb_printf(&wb,"IT8.7/2\n\n") < 0)
 						goto write_error;
 					break;
 				case it8_7_3:
-					if (fp->gprintf(fp,"IT8.7/3\n\n") < 0)
+					if (wb_printf(&wb,"IT8.7/3\n\n") < 0)
 						goto write_error;
 					break;
 				case it8_7_4:
-					if (fp->gprintf(fp,"IT8.7/4\n\n") < 0)
+					if (wb_printf(&wb,"IT8.7/4\n\n") < 0)
 						goto write_error;
 					break;
 				case cgats_5:
-					if (fp->gprintf(fp,"CGATS.5\n\n") < 0)
+					if (wb_printf(&wb,"CGATS.5\n\n") < 0)
 						goto write_error;
 					break;
 				case cgats_X:				/* variable CGATS type */
 					if (p->cgats_type == NULL)
 						goto write_error;
-					if (fp->gprintf(fp,"%-7s\n\n", p->cgats_type) < 0)
+					if (wb_printf(&wb,"%-7s\n\n", p->cgats_type) < 0)
 						goto write_error;
 					break;
 				case tt_other:	/* User defined file identifier */
-					if (fp->gprintf(fp,"%-7s\n\n",p->others[t->oi]) < 0)
+					if (wb_printf(&wb,"%-7s\n\n",p->others[t->oi]) < 0)
 						goto write_error;
 					break;
 				case tt_none:
@@ -1457,7 +1754,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 				al->free(al, sfield);
 				return err(p,-1,"cgats_write(), ID should not be suppressed when table %d type is not the same as previous table",table);
 			}
-			if (fp->gprintf(fp,"\n\n") < 0)
+			if (wb_printf(&wb,"\n\n") < 0)
 				goto write_error;
 		}
 
@@ -1474,7 +1771,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 						al->free(al, sfield);
 						return err(p,-2,"quote_cs() malloc failed!");
 					}
-					if (fp->gprintf(fp,"KEYWORD %s\n",qs) < 0) {
+					if (wb_printf(&wb,"KEYWORD %s\n",qs) < 0) {
 						al->free(al, qs);
 						goto write_error;
 					}
@@ -1485,7 +1782,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 					al->free(al, sfield);
 					return err(p,-2,"quote_cs() malloc failed!");
 				}
-				if (fp->gprintf(fp,"%s %s%s",t->ksym[i],qs,
+				if (wb_printf(&wb,"%s %s%s",t->ksym[i],qs,
 				    t->kcom[i] == NULL ? "\n":"\t") < 0) {
 					al->free(al, qs);
 					goto write_error;
@@ -1494,7 +1791,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 			}
 			/* Comment if its present */
 			if (t->kcom[i] != NULL) {
-				if (fp->gprintf(fp,"# %s\n",t->kcom[i]) < 0) {
+				if (wb_printf(&wb,"# %s\n",t->kcom[i]) < 0) {
 					al->free(al, qs);
 					goto write_error;
 				}
@@ -1503,7 +1800,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 
 		/* Then the field specification */
 		if (!t->sup_fields) {	/* If not suppressed */
-			if (fp->gprintf(fp,"\n") < 0)
+			if (wb_printf(&wb,"\n") < 0)
 				goto write_error;
 	
 			/* Declare any non-standard fields */
@@ -1514,7 +1811,7 @@ cgats_write(cgats *p, cgatsFile *fp) {
 						al->free(al, sfield);
 						return err(p,-2,"quote_cs() malloc failed!");
 					}
-					if (fp->gprintf(fp,"KEYWORD %s\n",qs) < 0) {
+					if (wb_printf(&wb,"KEYWORD %s\n",qs) < 0) {
 						al->free(al, qs);
 						goto write_error;
 					}
@@ -1522,16 +1819,16 @@ cgats_write(cgats *p, cgatsFile *fp) {
 				}
 			}
 	
-			if (fp->gprintf(fp,"NUMBER_OF_FIELDS %d\n",t->nfields) < 0)
+			if (wb_printf(&wb,"NUMBER_OF_FIELDS %d\n",t->nfields) < 0)
 				goto write_error;
-			if (fp->gprintf(fp,"BEGIN_DATA_FORMAT\n") < 0)
+			if (wb_printf(&wb,"BEGIN_DATA_FORMAT\n") < 0)
 				goto write_error;
 			for (field = 0; field < t->nfields; field ++) {
 				DBGF((DBGA,"CGATS writing field %d\n",field));
-				if (fp->gprintf(fp,"%s ",t->fsym[field]) < 0)
+				if (wb_printf(&wb,"%s ",t->fsym[field]) < 0)
 					goto write_error;
 			}
-			if (fp->gprintf(fp,"\nEND_DATA_FORMAT\n") < 0)
+			if (wb_printf(&wb,"\nEND_DATA_FORMAT\n") < 0)
 				goto write_error;
 		} else { /* Check that it is safe to suppress fields */
 			cgats_table *pt = &p->t[table-1];
@@ -1552,23 +1849,19 @@ cgats_write(cgats *p, cgatsFile *fp) {
 		}
 
 		/* Then the actual data */
-		if (fp->gprintf(fp,"\nNUMBER_OF_SETS %d\n",t->nsets) < 0)
+		if (wb_printf(&wb,"\nNUMBER_OF_SETS %d\n",t->nsets) < 0)
 			goto write_error;
-		if (fp->gprintf(fp,"BEGIN_DATA\n") < 0)
+		if (wb_printf(&wb,"BEGIN_DATA\n") < 0)
 			goto write_error;
 		for (set = 0; set < t->nsets; set++) {
 			DBGF((DBGA,"CGATS writing set %d\n",set));
 			for (field = 0; field < t->nfields; field++) {
 				data_type tt;
 				if (t->ftype[field] == r_t) {
-					char fmt[30];
-					double val = *((double *)t->fdata[set][field]);
-					real_format(val, REAL_SIGDIG, fmt);
- 					strcat(fmt," ");
-					if (fp->gprintf(fp,fmt,val) < 0)
+					if (wb_real(&wb, *((double *)t->fdata[set][field])) < 0)
 						goto write_error;
 				} else if (t->ftype[field] == i_t) {
-					if (fp->gprintf(fp,"%d ",*((int *)t->fdata[set][field])) < 0)
+					if (wb_printf(&wb,"%d ",*((int *)t->fdata[set][field])) < 0)
 						goto write_error;
 				} else if (t->ftype[field] == nqcs_t
 				      && !cs_has_ws((char *)t->fdata[set][field])
@@ -1577,7 +1870,8 @@ cgats_write(cgats *p, cgatsFile *fp) {
 					/* We can only print a non-quote string if it doesn't contain white space, */
 					/* quote or comment characters, and if it is a standard field or */
 					/* can't be mistaken for a number. */
-					if (fp->gprintf(fp,"%s ",(char *)t->fdata[set][field]) < 0)
+					if (wb_puts(&wb,(char *)t->fdata[set][field]) < 0
+					 || wb_puts(&wb," ") < 0)
 						goto write_error;
 				} else if (t->ftype[field] == nqcs_t
 				      || t->ftype[field] == cs_t) {
@@ -1586,7 +1880,8 @@ cgats_write(cgats *p, cgatsFile *fp) {
 						al->free(al, sfield);
 						return err(p,-2,"quote_cs() malloc failed!");
 					}
-					if (fp->gprintf(fp,"%s ",qs) < 0) {
+					if (wb_puts(&wb,qs) < 0
+					 || wb_puts(&wb," ") < 0) {
 						al->free(al, qs);
 						goto write_error;
 					}
@@ -1596,16 +1891,18 @@ cgats_write(cgats *p, cgatsFile *fp) {
 					return err(p,-1,"cgats_write(), illegal data type found");
 				}
 			}
-			if (fp->gprintf(fp,"\n") < 0)
+			if (wb_printf(&wb,"\n") < 0)
 				goto write_error;
 		}
-		if (fp->gprintf(fp,"END_DATA\n") < 0)
+		if (wb_printf(&wb,"END_DATA\n") < 0)
 			goto write_error;
 
 		if (sfield != NULL)
 			al->free(al, sfield);
 		sfield = NULL;
 	}
+	if (wb_flush(&wb) < 0)
+		goto write_error;
 	return 0;
 
 write_error:
@@ -1932,22 +2229,101 @@ guess_type(const char *cs)
 	return i_t;
 	}
 
-/* Set the character format to the appropriate printf() */
-/* format given the real value and the desired number of significant digits. */
+/* Convert a real from the string. Values with no more than 15 */
+/* significant digits and a small exponent are an exact mantissa */
+/* and power of 10, and one multiply or divide gives the correctly */
+/* rounded result. Anything else is left to atof(). */
+static double
+read_real(const char *cs) {
+	const char *s = cs;
+	double m = 0.0;		/* Mantissa digits */
+	int nd = 0;			/* Number of significant digits */
+	int ndig = 0;		/* Number of mantissa digits */
+	int e = 0;			/* Decimal exponent */
+	int neg = 0;
+
+	if (*s == '-' || *s == '+')
+		neg = (*s++ == '-');
+	for (; *s >= '0' && *s <= '9'; s++, ndig++) {
+		if (nd > 0 || *s != '0') {
+			m = m * 10.0 + (*s - '0');
+			nd++;
+		}
+	}
+	if (*s == '.') {
+		for (s++; *s >= '0' && *s <= '9'; s++, ndig++) {
+			if (nd > 0 || *s != '0') {
+				m = m * 10.0 + (*s - '0');
+				nd++;
+			}
+			e--;
+		}
+	}
+	if (ndig == 0 || nd > 15)
+		return atof(cs);
+	if (*s == 'e' || *s == 'E') {
+		int eneg = 0, ev = 0;
+
+		s++;
+		if (*s == '-' || *s == '+')
+			eneg = (*s++ == '-');
+		if (*s < '0' || *s > '9')
+			return atof(cs);
+		for (; *s >= '0' && *s <= '9'; s++) {
+			if (ev > 1000)
+				return atof(cs);
+			ev = ev * 10 + (*s - '0');
+		}
+		e += eneg ? -ev : ev;
+	}
+	if (*s != '\000')
+		return atof(cs);
+
+	if (e < 0) {
+		if (e < -22)
+			return atof(cs);
+		m /= exact_p10[-e];
+	} else if (e > 0) {
+		if (e > 22)
+			return atof(cs);
+		m *= exact_p10[e];
+	}
+	return neg ? -m : m;
+}
+
+/* Convert an integer from the string, as atoi() */
+static int
+read_int(const char *cs) {
+	const char *s = cs;
+	int v = 0, n;
+	int neg = 0;
+
+	if (*s == '-' || *s == '+')
+		neg = (*s++ == '-');
+	for (n = 0; *s >= '0' && *s <= '9'; s++, n++) {
+		if (n >= 9)					/* Might overflow */
+			return atoi(cs);
+		v = v * 10 + (*s - '0');
+	}
+	return neg ? -v : v;
+}
+
+/* Set the printf() conversion, width and precision appropriate */
+/* for the real value and the desired number of significant digits. */
 /* We try to do this while not using the %e format for normal values. */
-/* The fmt string space is assumed to be big enough to contain the format */
-static void
-real_format(double value, int nsd, char *fmt) {
+/* Return 'f' or 'e', or 0 for a nan, which is printed as plain %f */
+static int
+real_params(double value, int nsd, int *width, int *prec) {
 	int ndigs;
 	int tot = nsd + 1;
 	int xtot = tot;
 	if (value == 0.0) {
-		sprintf(fmt,"%%%d.%df",tot,tot-2);
-		return;
+		*width = tot;
+		*prec = tot-2;
+		return 'f';
 	}
 	if (value != value) {		/* Hmm. A nan */
-		sprintf(fmt,"%%f");
-		return;
+		return 0;
 	}
 	if (value < 0.0) {
 		value = -value;
@@ -1957,21 +2333,85 @@ real_format(double value, int nsd, char *fmt) {
 		int thr = -5;
 		ndigs = (int)(log10(value));
 		if (ndigs <= thr) {
-			sprintf(fmt,"%%%d.%de",xtot,tot-2);
-			return;
+			*width = xtot;
+			*prec = tot-2;
+			return 'e';
 		}
-		sprintf(fmt,"%%%d.%df",xtot-ndigs,nsd-ndigs);
-		return;
+		*width = xtot-ndigs;
+		*prec = nsd-ndigs;
+		return 'f';
 	} else {
 		int thr = -0;
 		ndigs = (int)(log10(value));
 		if (ndigs >= (nsd + thr)) {
-			sprintf(fmt,"%%%d.%de",xtot,tot-2);
-			return;
+			*width = xtot;
+			*prec = tot-2;
+			return 'e';
 		}
-		sprintf(fmt,"%%%d.%df",xtot,(nsd + thr)-ndigs);
-		return;
+		*width = xtot;
+		*prec = (nsd + thr)-ndigs;
+		return 'f';
+	}
+}
+
+/* Set the character format to the appropriate printf() */
+/* format given the real value and the desired number of significant digits. */
+/* The fmt string space is assumed to be big enough to contain the format */
+static void
+real_format(double value, int nsd, char *fmt) {
+	int width, prec, conv;
+
+	if ((conv = real_params(value, nsd, &width, &prec)) == 0)
+		sprintf(fmt,"%%f");
+	else
+		sprintf(fmt,"%%%d.%d%c",width,prec,conv);
+}
+
+/* Print a real in fixed point into buf, as printf("%*.*f") would. */
+/* The value is scaled by an exact power of 10 and rounded, which is */
+/* only done when the scaled value is small enough for the rounding */
+/* to be certain. buf is assumed to have space for width + 20 chars. */
+/* Return the length, or -1 if printf() should be used. */
+static int
+fixed_real(char *buf, double value, int width, int prec) {
+	char digs[24];
+	double sv, fl;
+	unsigned long iv;
+	int neg = 0, nd = 0, len = 0, i;
+
+	if (value == 0.0 || value != value || prec < 0 || prec > 15)
+		return -1;		/* (printf() knows about -0.0) */
+	if (value < 0.0) {
+		neg = 1;
+		value = -value;
+	}
+	sv = value * exact_p10[prec];
+	if (!(sv < 1e9))
+		return -1;
+	fl = floor(sv);
+	if (fabs(sv - fl - 0.5) < 1e-6)	/* Too close to a tie to round */
+		return -1;
+	iv = (unsigned long)fl + (sv - fl > 0.5 ? 1 : 0);
+
+	/* Digits, least significant first, at least one before the point */
+	do {
+		digs[nd++] = (char)('0' + iv % 10);
+		iv /= 10;
+	} while (iv != 0);
+	while (nd <= prec)
+		digs[nd++] = '0';
+
+	for (i = neg + nd + (prec > 0 ? 1 : 0); i < width; i++)
+		buf[len++] = ' ';
+	if (neg)
+		buf[len++] = '-';
+	for (i = nd-1; i >= 0; i--) {
+		buf[len++] = digs[i];
+		if (i == prec && prec > 0)
+			buf[len++] = '.';
 	}
+	buf[len] = '\000';
+	return len;
 }
 
 /* ---------------------------------------------------------- */
@@ -70,6 +70,14 @@ struct _cgats_table {
 	int sup_id;			/* Set to non-zero if table ID output is to be suppressed */
 	int sup_kwords;		/* Set to non-zero if table default keyword output is to be suppressed */
 	int sup_fields;		/* Set to non-zero if table field output is to be suppressed */
+	struct _cgats_chunk *arena;	/* Chunks the set values are allocated from */
+	size_t arenas;		/* Size of the next chunk to allocate */
+	int *khash;			/* Keyword index hash of [khasha] index+1, 0 if empty */
+	int khasha;			/* Keyword hash size, a power of 2 */
+	int khn;			/* Number of keywords hashed, -1 if hash needs rebuilding */
+	int *fhash;			/* Field index hash of [fhasha] index+1, 0 if empty */
+	int fhasha;			/* Field hash size, a power of 2 */
+	int fhn;			/* Number of fields hashed */
 }; typedef struct _cgats_table cgats_table;
 
 struct _cgats {
@@ -0,0 +1,218 @@
+/* 
+ * Committee for Graphics Arts Technologies Standards
+ * CGATS.5 and IT8.7 family file I/O benchmark
+ *
+ * This material is licensed with an "MIT" free use license:-
+ * see the License4.txt file in this directory for licensing details.
+ */
+
+/*
+ * Times building, writing, reading and looking up a generated CGATS
+ * table shaped like a spectral measurement export: a sample id, RGB,
+ * XYZ and 36 spectral bands per set. The file is written to and read
+ * back from disk and from memory, and the values read are checked
+ * against the ones written.
+ *
+ * Build with cgats.c and pars.c (which pull in their std I/O).
+ *
+ * Usage: cgatsbench [nsets] [file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "pars.h"
+#include "cgats.h"
+
+#define NBANDS 36				/* 380 to 730nm in 10nm steps */
+#define NFIELDS (7 + NBANDS)
+
+void error(const char *fmt, ...);
+
+static double msec(clock_t start) {
+	return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static double value(int set, int field) {
+	return (set + 1) * 0.731 / (field + 1.0) + field * 1.0e-4;
+}
+
+/* Create the table in memory */
+static cgats *build(int nsets) {
+	cgats *pp;
+	cgats_set_elem ary[NFIELDS];
+	char id[20], fsym[20];
+	int i, j;
+
+	pp = new_cgats();
+	if (pp->add_table(pp, cgats_5, 0) < 0
+	 || pp->add_kword(pp, 0, "DESCRIPTOR", "Generated benchmark table", NULL) < 0
+	 || pp->add_kword(pp, 0, "SPECTRAL_BANDS", "36", NULL) < 0
+	 || pp->add_field(pp, 0, "SAMPLE_ID", cs_t) < 0
+	 || pp->add_field(pp, 0, "RGB_R", r_t) < 0
+	 || pp->add_field(pp, 0, "RGB_G", r_t) < 0
+	 || pp->add_field(pp, 0, "RGB_B", r_t) < 0
+	 || pp->add_field(pp, 0, "XYZ_X", r_t) < 0
+	 || pp->add_field(pp, 0, "XYZ_Y", r_t) < 0
+	 || pp->add_field(pp, 0, "XYZ_Z", r_t) < 0)
+		error("Adding fields error '%s'",pp->err);
+	for (j = 0; j < NBANDS; j++) {
+		sprintf(fsym, "SPEC_%03d", 380 + 10 * j);
+		if (pp->add_field(pp, 0, fsym, r_t) < 0)
+			error("Adding field error '%s'",pp->err);
+	}
+
+	for (i = 0; i < nsets; i++) {
+		sprintf(id, "%d", i + 1);
+		ary[0].c = id;
+		for (j = 1; j < NFIELDS; j++)
+			ary[j].d = value(i, j);
+		if (pp->add_setarr(pp, 0, ary) < 0)
+			error("Adding set error '%s'",pp->err);
+	}
+	return pp;
+}
+
+/* Look up every field and keyword by name, as readers do per set */
+static double lookup(cgats *pp) {
+	cgats_table *t = &pp->t[0];
+	double sum = 0.0;
+	int i, j, fi;
+
+	for (i = 0; i < t->nsets; i++) {
+		for (j = 1; j < t->nfields; j++) {
+			if ((fi = pp->find_field(pp, 0, t->fsym[j])) < 0)
+				error("Can't find field '%s'",t->fsym[j]);
+			sum += *((double *)t->fdata[i][fi]);
+		}
+		if (pp->find_kword(pp, 0, "SPECTRAL_BANDS") < 0)
+			error("Can't find keyword");
+	}
+	return sum;
+}
+
+/* Check a table read back against the generated values */
+static void check(cgats *pp, int nsets) {
+	cgats_table *t;
+	int i, j;
+
+	if (pp->ntables != 1 || pp->t[0].nsets != nsets || pp->t[0].nfields != NFIELDS)
+		error("Read back wrong table shape");
+	t = &pp->t[0];
+	if (t->ftype[0] != cs_t && t->ftype[0] != nqcs_t)
+		error("Read back wrong SAMPLE_ID type");
+	for (i = 0; i < nsets; i++) {
+		if (atoi((char *)t->fdata[i][0]) != i + 1)
+			error("Read back wrong SAMPLE_ID at set %d",i);
+		for (j = 1; j < NFIELDS; j++) {
+			double v = value(i, j), rv = *((double *)t->fdata[i][j]);
+			if (t->ftype[j] != r_t || fabs(rv - v) > 1e-5 * fabs(v))
+				error("Read back %f, expected %f at set %d field %d",rv,v,i,j);
+		}
+	}
+}
+
+int
+main(int argc, char *argv[]) {
+	int nsets = 5000;
+	char *fn = "cgatsbench.ti3";
+	cgatsFile *fp, *mfp;
+	cgats *pp;
+	unsigned char *buf;
+	size_t len;
+	clock_t stime;
+	double bms, wms, rms, lms, mwms, mrms, sum;
+
+	if (argc > 1)
+		nsets = atoi(argv[1]);
+	if (nsets <= 0)
+		nsets = 5000;
+	if (argc > 2)
+		fn = argv[2];
+
+	stime = clock();
+	pp = build(nsets);
+	bms = msec(stime);
+
+	stime = clock();
+	if ((fp = new_cgatsFileStd_name(fn, "w")) == NULL)
+		error("Error opening '%s' for writing",fn);
+	if (pp->write(pp, fp))
+		error("Write error : %s",pp->err);
+	fp->del(fp);
+	wms = msec(stime);
+
+	stime = clock();
+	if ((mfp = new_cgatsFileMem_d(NULL, 0)) == NULL)
+		error("Error creating memory file");
+	if (pp->write(pp, mfp))
+		error("Write error : %s",pp->err);
+	if (mfp->get_buf(mfp, &buf, &len))
+		error("Error getting memory file buffer");
+	mwms = msec(stime);
+	pp->del(pp);
+
+	stime = clock();
+	pp = new_cgats();
+	if ((fp = new_cgatsFileStd_name(fn, "r")) == NULL)
+		error("Error opening '%s' for reading",fn);
+	if (pp->read(pp, fp))
+		error("Read error : %s",pp->err);
+	fp->del(fp);
+	rms = msec(stime);
+	check(pp, nsets);
+
+	stime = clock();
+	sum = lookup(pp);
+	lms = msec(stime);
+	pp->del(pp);
+
+	stime = clock();
+	pp = new_cgats();
+	if ((fp = new_cgatsFileMem(buf, len)) == NULL)
+		error("Error creating memory file");
+	if (pp->read(pp, fp))
+		error("Read error : %s",pp->err);
+	fp->del(fp);
+	mrms = msec(stime);
+	check(pp, nsets);
+	pp->del(pp);
+	mfp->del(mfp);
+
+	printf("%d sets of %d fields, %lu bytes\n",nsets,NFIELDS,(unsigned long)len);
+	printf("  build:        %8.1f msec\n",bms);
+	printf("  write file:   %8.1f msec\n",wms);
+	printf("  write memory: %8.1f msec\n",mwms);
+	printf("  read file:    %8.1f msec\n",rms);
+	printf("  read memory:  %8.1f msec\n",mrms);
+	printf("  lookup:       %8.1f msec (sum %g)\n",lms,sum);
+
+	remove(fn);
+	return 0;
+}
+
+void
+error(const char *fmt, ...) {
+	va_list args;
+
+	fprintf(stderr,"cgatsbench: Error - ");
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit (-1);
+}
+
+void
+warning(const char *fmt, ...) {
+	va_list args;
+
+	fprintf(stderr,"cgatsbench: Warning - ");
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+}
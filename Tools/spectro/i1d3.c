@@ -2217,12 +2217,12 @@ i1d3_comp_calmat(
 	sampXYZ = dmatrix(0, nsamp-1, 0, 3-1);
 	sampRGB = dmatrix(0, nsamp-1, 0, 3-1);
 
-	/* Compute XYZ of the sample array */
+	/* Compute XYZ of the sample array, in one batch conversion. */
+	/* A fresh dmatrix has its rows contiguous, so it is also */
+	/* a double[nsamp][3] array. */
 	if ((conv = new_xsp2cie(icxIT_none, 0.0, NULL, obType, custObserver, icSigXYZData, icxClamp)) == NULL)
 		return i1d3_interp_code((inst *)p, I1D3_INT_CIECONVFAIL);
-	for (i = 0; i < nsamp; i++) {
-		conv->convert(conv, sampXYZ[i], &samples[i]); 
-	}
+	conv->bconvert(conv, (double (*)[3])sampXYZ[0], samples, nsamp); 
 	conv->del(conv);
 
 	/* Compute sensor RGB of the sample array */
@@ -2231,8 +2231,8 @@ i1d3_comp_calmat(
 		free_dmatrix(sampRGB, 0, nsamp-1, 0, 3-1);
 		return i1d3_interp_code((inst *)p, I1D3_INT_CIECONVFAIL);
 	}
+	conv->bconvert(conv, (double (*)[3])sampRGB[0], samples, nsamp); 
 	for (i = 0; i < nsamp; i++) {
-		conv->convert(conv, sampRGB[i], &samples[i]); 
 		/* But we need to undo lumens scaling, because it doesn't apply to RGB sensor values */
 		for (j = 0; j < 3; j++)
 			sampRGB[i][j] /= 0.683002;
@@ -59,6 +59,9 @@ static void reset_del(parse *p);
 static void add_del(struct _parse *p, char *t,
                     char *nr, char *c, char *q);
 static char *get_token(parse *p);
+static int fill_read(parse *p);
+
+#define PARS_READ_SIZE 65536	/* Size of blocks read from the file */
 
 /* Open the file, allocate and initialize the parse structure */
 /* Return pointer to parse structure. Return NULL on error */
@@ -80,6 +83,10 @@ cgatsFile *fp		/* File to read from */
 	p->bo = 0;
 	p->tb = NULL;	/* Init token buffer */
 	p->tbs = 0;
+	p->rb = NULL;	/* Init read buffer */
+	p->rbs = 0;
+	p->rbo = 0;
+	p->rbl = 0;
 	p->to = 0;
 	p->line = 0;
 	p->token = 0;
@@ -213,9 +220,12 @@ static void cgatsFileMem_filemem_resize(cgatsFileMem *p, unsigned char *ep) {
 	ce = p->end - p->start;		/* Current end */
 	na = ep - p->start;			/* new allocatd size */
 
-	/* Round new allocation up */
+	/* Round new allocation up, growing by at least half the */
+	/* current allocation so that many writes don't copy it each time */
 	if (na <= 1024)
 		na += 1024;
+	else if ((size_t)(p->aend - p->start) / 2 > 4096)
+		na += (p->aend - p->start) / 2;
 	else
 		na += 4096;
 
@@ -238,12 +248,12 @@ size_t count
 	size_t len;
 
 	len = ssat_mul(size, count);
-	if (len > (size_t)(p->end - p->cur))  /* Try and expand buffer */
-		cgatsFileMem_filemem_resize(p, p->start + len);
+	if (len > (size_t)(p->aend - p->cur))  /* Try and expand buffer */
+		cgatsFileMem_filemem_resize(p, p->cur + len);
 
-	if (len > (size_t)(p->end - p->cur)) {
+	if (len > (size_t)(p->aend - p->cur)) {
 		if (size > 0)
-			count = (p->end - p->cur)/size;
+			count = (p->aend - p->cur)/size;
 		else
 			count = 0;
 	}
@@ -409,6 +419,8 @@ del_parse(parse *p) {
 		al->free(al, p->b);
 	if (p->tb != NULL)
 		al->free(al, p->tb);
+	if (p->rb != NULL)
+		al->free(al, p->rb);
 	al->free(al, p);
 
 	if (del_al)			/* We are responsible for deleting allocator */
@@ -416,6 +428,26 @@ del_parse(parse *p) {
 }
 
 
+/* Refill the read buffer with the next block of the file, */
+/* and return its first character, or EOF. */
+/* If there is no memory for the buffer, read a character at a time. */
+static int
+fill_read(parse *p) {
+	if (p->rb == NULL && p->rbs == 0) {
+		if ((p->rb = (unsigned char *) p->al->malloc(p->al, PARS_READ_SIZE)) != NULL)
+			p->rbs = PARS_READ_SIZE;
+		else
+			p->rbs = 1;		/* Don't try again */
+	}
+	if (p->rb == NULL)
+		return p->fp->getch(p->fp);
+
+	p->rbo = 0;
+	if ((p->rbl = p->fp->read(p->fp, p->rb, 1, p->rbs)) == 0)
+		return EOF;
+	return p->rb[p->rbo++];
+}
+
 /* Read the next line from the file into the line buffer. */
 /* Return 0 if the read fails due to reaching EOF before */
 /* putting anything in the buffer. */
@@ -429,7 +461,7 @@ read_line(parse *p) {
 	p->errc = 0;		/* Reset error status */
 	p->err[0] = '\000';
 	do {
-		if ((c = p->fp->getch(p->fp)) == EOF) {
+		if ((c = p->rbo < p->rbl ? p->rb[p->rbo++] : fill_read(p)) == EOF) {
 			if (p->bo == 0) {	/* If there is nothing in the buffer */
 				p->line = 0;
 #ifdef DEBUG
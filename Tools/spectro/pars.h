@@ -227,6 +227,10 @@ struct _parse {
 	int to;			/* Token parsing offset into b */
 	char *tb;		/* Token buffer */
 	int tbs;		/* Token buffer size */
+	unsigned char *rb;	/* File read buffer. The file is read ahead of the current line */
+	size_t rbs;		/* Read buffer size */
+	size_t rbo;		/* Next read buffer offset */
+	size_t rbl;		/* Read buffer length */
 	char delf[256];		/* Parsing delimiter flags */
 	/* Parsing flags */
 #define PARS_TERM	0x01		/* Terminates a token */
@@ -2149,10 +2149,10 @@ spyd4_comp_calmat(
 	if ((conv = new_xsp2cie(icxIT_none, 0.0, NULL, obType, custObserver, icSigXYZData, icxClamp)) == NULL)
 		return spyd2_interp_code((inst *)p, SPYD2_INT_CIECONVFAIL);
 	sampXYZ = dmatrix(0, nasamp-1, 0, 3-1);
-	for (i = 0; i < nsamp; i++) {
-		conv->convert(conv, sampXYZ[i], &samples[i]); 
+	/* The dmatrix rows are contiguous, convert the samples in one batch */
+	conv->bconvert(conv, (double (*)[3])sampXYZ[0], samples, nsamp); 
+//	for (i = 0; i < nsamp; i++)
 //		a1logd(p->log, 3, "asamp[%d] XYZ = %f %f %f\n", i,sampXYZ[nsamp+i][0],sampXYZ[nsamp+i][1], sampXYZ[nsamp+i][2]);
-	}
 
 	/* Create extra spectral samples */
 	for (i = 0; i < 81; i++) {
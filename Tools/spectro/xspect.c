@@ -5838,6 +5838,7 @@ double wl_long		/* Ending nm */
 	p->spec_bw		 = bw;
 	p->spec_wl_short = wl_short;
 	p->spec_wl_long  = wl_long;
+	p->wt_n          = 0;		/* Batch weighting is now stale */
 }
 
 /* Do the normal spectral to CIE conversion. */
@@ -5911,6 +5912,156 @@ void xsp2cie_convert(xsp2cie *p, double *out, xspect *in) {
 	xsp2cie_sconvert(p, NULL, out, in);
 }
 
+/* Record everything xsp2cie_sconvert() looks up at each integration */
+/* step that doesn't depend on the values of a spectrum with the */
+/* sampling of in. Return NZ on error. */
+static int xsp2cie_comp_steps(
+xsp2cie *p,			/* this */
+xspect *in			/* Spectrum with the sampling to be used */
+) {
+	double ww, spcg, scale = 0.0;
+	int n, j;
+
+	spcg = (in->spec_wl_long - in->spec_wl_short)/(in->spec_n-1.0);
+
+	n = 0;
+	for (ww = p->spec_wl_short; ww <= p->spec_wl_long; ww += p->spec_bw)
+		n++;
+
+	free(p->wt_st);
+	p->wt_n = 0;
+	if ((p->wt_st = (xsp2cie_step *) calloc(n > 0 ? n : 1, sizeof(xsp2cie_step))) == NULL)
+		return 1;
+
+	/* Same steps and interpolation choices as getval_raw_xspec() */
+	p->wt_poly = spcg >= 5.01;
+	n = 0;
+	for (ww = p->spec_wl_short; ww <= p->spec_wl_long; ww += p->spec_bw, n++) {
+		xsp2cie_step *st = &p->wt_st[n];
+		double xw = ww, f;
+		int i;
+
+		for (j = 0; j < 3; j++) {
+			double I = 1.0, O;
+			if (!p->isemis)
+				getval_xspec(&p->illuminant, &I, ww);
+			getval_xspec(&p->observer[j], &O, ww);
+			if (j == 1)
+				scale += I * O;
+			st->io[j] = I * O;
+		}
+
+		if (xw < in->spec_wl_short)
+			xw = in->spec_wl_short;
+		if (xw > in->spec_wl_long)
+			xw = in->spec_wl_long;
+		f = (xw - in->spec_wl_short) / (in->spec_wl_long - in->spec_wl_short);
+		f *= (in->spec_n - 1.0);
+		i = (int)floor(f);
+
+		if (!p->wt_poly) {				/* As getval_raw_xspec_lin() */
+			if (i < 0)
+				i = 0;
+			else if (i > (in->spec_n - 2))
+				i = (in->spec_n - 2);
+			st->w = f - (double)i;
+		} else {						/* As getval_raw_xspec_poly3() */
+			if (i < 1)
+				i = 1;
+			else if (i > (in->spec_n - 3))
+				i = (in->spec_n - 3);
+			st->xw = xw;
+			st->x[0] = in->spec_wl_short + (i-1) * spcg;
+			st->x[1] = in->spec_wl_short + i * spcg;
+			st->x[2] = in->spec_wl_short + (i+1) * spcg;
+			st->x[3] = in->spec_wl_short + (i+2) * spcg;
+		}
+		st->ix = i;
+	}
+
+	p->wt_nst      = n;
+	p->wt_scale    = scale;
+	p->wt_n        = in->spec_n;
+	p->wt_wl_short = in->spec_wl_short;
+	p->wt_wl_long  = in->spec_wl_long;
+
+	return 0;
+}
+
+/* Batch Tristumulus conversion */
+static int xsp2cie_bconvert(
+xsp2cie *p,			/* this */
+double (*out)[3],	/* Return XYZ or D50 Lab values */
+xspect *in,			/* Spectra to be converted */
+int nsp				/* Number of spectra */
+) {
+	int i, j, n;
+
+	for (i = 0; i < nsp; i++) {
+		xspect *sp = &in[i];
+		double scale;
+
+		/* FWA compensation has its own integration, and the poly3 */
+		/* interpolation needs 4 samples, so do these the slow way */
+		if (p->convert != xsp2cie_convert
+		 || sp->spec_n < 2 || sp->spec_n > XSPECT_MAX_BANDS
+		 || (sp->spec_n < 4
+		  && (sp->spec_wl_long - sp->spec_wl_short)/(sp->spec_n-1.0) >= 5.01)) {
+			p->convert(p, out[i], sp);
+			continue;
+		}
+
+		if (p->wt_n != sp->spec_n
+		 || p->wt_wl_short != sp->spec_wl_short
+		 || p->wt_wl_long != sp->spec_wl_long) {
+			if (xsp2cie_comp_steps(p, sp))
+				return 1;
+		}
+
+		/* The same expressions, in the same order, as xsp2cie_sconvert() */
+		out[i][0] = out[i][1] = out[i][2] = 0.0;
+		for (n = 0; n < p->wt_nst; n++) {
+			xsp2cie_step *st = &p->wt_st[n];
+			double S;
+
+			if (!p->wt_poly) {
+				S = (1.0 - st->w) * sp->spec[st->ix] + st->w * sp->spec[st->ix+1];
+			} else {
+				double xw = st->xw, *x = st->x, *y = &sp->spec[st->ix-1];
+				S = y[0] * (xw-x[1]) * (xw-x[2]) * (xw-x[3])/((x[0]-x[1]) * (x[0]-x[2]) * (x[0]-x[3]))
+				  + y[1] * (xw-x[0]) * (xw-x[2]) * (xw-x[3])/((x[1]-x[0]) * (x[1]-x[2]) * (x[1]-x[3]))
+				  + y[2] * (xw-x[0]) * (xw-x[1]) * (xw-x[3])/((x[2]-x[0]) * (x[2]-x[1]) * (x[2]-x[3]))
+				  + y[3] * (xw-x[0]) * (xw-x[1]) * (xw-x[2])/((x[3]-x[0]) * (x[3]-x[1]) * (x[3]-x[2]));
+			}
+			S /= sp->norm;
+
+			for (j = 0; j < 3; j++)
+				out[i][j] += st->io[j] * S;
+		}
+
+		if (p->isemis) {
+			scale = 0.683002;
+			scale *= p->spec_bw;
+		} else {
+			scale = 1.0/p->wt_scale;
+		}
+		for (j = 0; j < 3; j++) {
+			out[i][j] *= scale;
+#ifdef CLAMP_XYZ
+			if (p->clamp && out[i][j] < 0.0)
+				out[i][j] = 0.0;
+#endif /* CLAMP_XYZ */
+		}
+
+		if (p->doLab == 1) {
+			icmXYZ2Lab(&icmD50, out[i], out[i]);
+		} else if (p->doLab == 2) {
+			icmXYZ2Lpt(&icmD50, out[i], out[i]);
+		}
+	}
+	return 0;
+}
+
 /* Return the illuminant XYZ being used in the CIE XYZ/Lab conversion. */ 
 /* Note that this will returne the 'E' illuminant XYZ for emissive. */
 void xsp2cie_get_cie_il(xsp2cie *p, double *xyz) {
@@ -5927,6 +6078,7 @@ void xsp2cie_get_cie_il(xsp2cie *p, double *xyz) {
 void xsp2cie_del(
 xsp2cie *p
 ) {
+	free(p->wt_st);
 	free(p);
 	return;
 }
@@ -6007,6 +6159,7 @@ icxClamping clamp				/* NZ to clamp XYZ/Lab to be +ve */
 	p->photo2rad     = xsp2cie_photo2rad;
 	p->convert       = xsp2cie_convert;
 	p->sconvert      = xsp2cie_sconvert;
+	p->bconvert      = xsp2cie_bconvert;
 	p->get_cie_il    = xsp2cie_get_cie_il;
 #ifndef SALONEINSTLIB
 	p->set_mw        = xsp2cie_set_mw;		/* Default no media white */
@@ -6051,6 +6204,41 @@ xspect *sp				/* Spectrum to be converted */
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* Given a batch of emissive spectra and a list of observer models, */
+/* return the XYZ value of every spectrum for every observer. */
+/* xyz is indexed [ob * nsp + i]. */
+/* Return 0 on sucess, 1 on error */
+int icx_spN2XYZ_multi(
+double (*xyz)[3],		/* Return nob * nsp XYZ values */
+icxObserverType *obTypes,	/* nob observers */
+int nob,				/* Number of observers */
+xspect *sp,				/* nsp spectra to be converted */
+int nsp					/* Number of spectra */
+) {
+	xsp2cie *conv;
+	int ob, rv;
+
+	if (nob <= 0 || nsp <= 0)
+		return 0;
+
+	/* The results of an observer are contiguous, so each one */
+	/* converts the whole batch in a single call */
+	for (ob = 0; ob < nob; ob++) {
+		if ((conv = new_xsp2cie(icxIT_none, 0.0, NULL, obTypes[ob], NULL,
+		                        icSigXYZData, icxNoClamp)) == NULL)
+			return 1;
+
+		rv = conv->bconvert(conv, &xyz[ob * nsp], sp, nsp);
+		conv->del(conv);
+		if (rv)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 /* Given an illuminant definition and an observer model, return */
 /* the normalised XYZ value for that spectrum. */
 /* Return 0 on sucess, 1 on error */
@@ -342,6 +342,15 @@ typedef enum {
     icxClamp			= 1,	/* Clamp XYZ/Lab to +ve */
 } icxClamping;
 
+/* The part of a 1nm integration step that doesn't depend on the */
+/* spectrum being converted, kept for batch conversion */
+typedef struct {
+	double io[3];				/* Illuminant * observer */
+	int    ix;					/* Base index of the input samples */
+	double w;					/* Linear interpolation weight */
+	double xw, x[4];			/* Poly3 wavelength and Lagrange basis wavelengths */
+} xsp2cie_step;
+
 /* The conversion object */
 struct _xsp2cie {
 	/* Private: */
@@ -356,6 +365,16 @@ struct _xsp2cie {
 	double spec_wl_short;		/* Start wavelength (nm) */
 	double spec_wl_long;		/* End wavelength (nm) */
 
+	/* Batch conversion steps, valid for input spectra with the */
+	/* recorded sampling. wt_n == 0 if not computed yet. */
+	int    wt_n;				/* Input number of bands */
+	double wt_wl_short;			/* Input start wavelength (nm) */
+	double wt_wl_long;			/* Input end wavelength (nm) */
+	int    wt_poly;				/* nz if the input is poly3 interpolated */
+	int    wt_nst;				/* Number of integration steps */
+	xsp2cie_step *wt_st;		/* wt_nst integration steps */
+	double wt_scale;			/* Y normalisation of the integration */
+
 #ifndef SALONEINSTLIB
 	/* FWA compensation */
 	double fwa_bw;	/* Integration bandwidth */
@@ -417,6 +436,18 @@ struct _xsp2cie {
 	                 xspect *in				/* Spectrum to be converted, normalised by norm */
 	                );
 
+	/* Convert a batch of spectra. Spectra with the same sampling as the */
+	/* previous one reuse the illuminant, observer and interpolation */
+	/* lookups of every integration step, and each spectrum is */
+	/* interpolated once per step rather than once per step and channel. */
+	/* The arithmetic is that of convert(), so results are identical */
+	/* to the bit. Return NZ on error. */
+	int (*bconvert) (struct _xsp2cie *p,	/* this */
+	                 double (*out)[3],		/* Return nsp XYZ or D50 Lab values */
+	                 xspect *in,			/* nsp spectra to be converted */
+	                 int nsp				/* Number of spectra */
+	                );
+
 	/* Get the XYZ of the illuminant being used to compute the CIE XYZ */
 	/* value. */
 	void (*get_cie_il)(struct _xsp2cie *p,	/* this */
@@ -507,6 +538,18 @@ xspect *custIllum,		/* Optional custom illuminant */
 xspect *sp				/* Spectrum to be converted */
 );
 
+/* Given a batch of emissive spectra and a list of observer models, */
+/* return the XYZ value of every spectrum for every observer. */
+/* xyz is indexed [ob * nsp + i]. */
+/* Return 0 on sucess, 1 on error */
+int icx_spN2XYZ_multi(
+double (*xyz)[3],		/* Return nob * nsp XYZ values */
+icxObserverType *obTypes,	/* nob observers */
+int nob,				/* Number of observers */
+xspect *sp,				/* nsp spectra to be converted */
+int nsp					/* Number of spectra */
+);
+
 /* Given an illuminant definition and an observer model, return */
 /* the normalised XYZ value for that spectrum. */
 /* Return 0 on sucess, 1 on error */
@@ -0,0 +1,217 @@
+#include "CHCFile.h"
+#include "Exceptions.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE CHCFileTestCase
+
+namespace
+{
+    const char* szFileA = "chcfile_unittest_a.chc";
+    const char* szFileB = "chcfile_unittest_b.chc";
+
+    // writes the bytes of a .chc file the way the MFC archive of the application does
+    class ArchiveWriter
+    {
+    public:
+        explicit ArchiveWriter(const char* szPath) : m_pFile(fopen(szPath, "wb")) {}
+        ~ArchiveWriter() { fclose(m_pFile); }
+
+        void Int(int value) { fwrite(&value, 4, 1, m_pFile); }
+        void Double(double value) { fwrite(&value, 8, 1, m_pFile); }
+
+        void Matrix(int nRows, int nCols, const double* values)
+        {
+            Int(0x434d6174);
+            Int(0x72697843);
+            Int(1);
+            Int(nCols);
+            Int(nRows);
+            for (int i = 0; i < nRows * nCols; i++)
+            {
+                Double(values ? values[i] : 0.0);
+            }
+        }
+
+        void Color(double X, double Y, double Z)
+        {
+            double XYZ[3] = { X, Y, Z };
+            Int(1);
+            Matrix(3, 1, XYZ);
+            Matrix(3, 3, NULL);
+            Matrix(3, 3, NULL);
+        }
+
+        void NoData() { Color(FX_NODATA, FX_NODATA, FX_NODATA); }
+
+        void String(const char* szText)
+        {
+            unsigned char nLength = (unsigned char)strlen(szText);
+            fwrite(&nLength, 1, 1, m_pFile);
+            fwrite(szText, 1, nLength, m_pFile);
+        }
+
+    private:
+        FILE* m_pFile;
+    };
+
+    // a document in the current format, its saved preferences use colorStandard and whiteTarget
+    void writeDocument(const char* szPath, int colorStandard, int whiteTarget, double whitex, double whitey)
+    {
+        ArchiveWriter ar(szPath);
+        ar.Int(0x4F4C4F43);
+        ar.Int(0x46434852);
+        ar.Int(3);
+
+        ar.Int(17);
+        ar.Double(0.0); ar.Double(1.0); ar.Double(0.5);
+        ar.Double(2.4);
+        for (int i = 0; i < 6; i++)
+        {
+            ar.Double(100.0 * i);
+        }
+        ar.Int(1); ar.Int(0);
+        ar.Double(203.0);
+        ar.Int(96);
+
+        ar.Int(whiteTarget);
+        ar.Int(0);
+        ar.Int(colorStandard);
+        ar.Int(5); ar.Int(3); ar.Int(2); ar.Int(1);
+        ar.Double(2.2); ar.Double(2.4); ar.Double(0.0);
+        ar.Double(whitex); ar.Double(whitey);
+        ar.Int(0);
+        ar.Double(0.15); ar.Double(0.64); ar.Double(0.30);
+        ar.Double(0.06); ar.Double(0.33); ar.Double(0.60);
+
+        ar.Int(0);
+        ar.NoData();
+
+        // grays, the second one not measured
+        ar.Int(3);
+        ar.Color(0.1, 0.1, 0.1);
+        ar.NoData();
+        ar.Color(95.0, 100.0, 108.9);
+        ar.Int(0);
+        ar.Int(0);
+        for (int i = 0; i < 6; i++)
+        {
+            ar.Int(0);
+        }
+
+        // the cc24 patches are stored sparsely, up to a marker color
+        ar.Int(1000);
+        ar.Color(20.0, 21.0, 22.0);
+        ar.Int(7);
+        ar.Color(0.123, 0.456, 0.789);
+        ar.Int(5000);
+        ar.Color(0.123, 0.456, 0.789);
+
+        ar.Int(0);
+        for (int i = 0; i < 6; i++)
+        {
+            ar.Color(10.0 + i, 20.0, 30.0);
+        }
+        ar.Color(0.05, 0.05, 0.05);
+        ar.Color(96.0, 101.0, 110.0);
+        ar.NoData();
+        ar.NoData();
+        ar.Color(94.0, 99.0, 107.0);
+        ar.String("Calibration by: \r\nDisplay: \r\nNote: \r\n");
+        ar.Int(1);
+
+        // the sensor and generator objects follow, they are not read
+        ar.Int(0xFFFF);
+        ar.String("CSensor");
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( ReadsCurrentFormat );
+    CPPUNIT_TEST( SettingsAreOnlyReported );
+    CPPUNIT_TEST( TruncatedFile );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void ReadsCurrentFormat()
+    {
+        writeDocument(szFileA, HDTV, D65, 0.3127, 0.3290);
+
+        CHCFile positional(true);
+        positional.readFile(szFileA);
+        CPPUNIT_ASSERT_EQUAL( (uint32_t)17, positional.getMeasuresVersion() );
+        CPPUNIT_ASSERT_EQUAL( (size_t)3, positional.getGrayColors().size() );
+        CPPUNIT_ASSERT( positional.getGrayColors().front().isValid() );
+        CPPUNIT_ASSERT( !(*++positional.getGrayColors().begin()).isValid() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, positional.getGrayColors().back().GetY(), 1e-12 );
+        CPPUNIT_ASSERT_EQUAL( (size_t)1, positional.getCC24SaturationColors().size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 21.0, positional.getCC24SaturationColors().front().GetY(), 1e-12 );
+        CPPUNIT_ASSERT_EQUAL( (size_t)6, positional.getComponnentsColors().size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 15.0, positional.getComponnentsColors().back().GetX(), 1e-12 );
+        CPPUNIT_ASSERT_EQUAL( (size_t)2, positional.getANSIContrastColors().size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 99.0, positional.getPrimeWhite().GetY(), 1e-12 );
+        CPPUNIT_ASSERT( positional.isIREScaleMode() );
+
+        // by default the empty measures are skipped
+        CHCFile compact;
+        compact.readFile(szFileA);
+        CPPUNIT_ASSERT_EQUAL( (size_t)2, compact.getGrayColors().size() );
+        CPPUNIT_ASSERT( compact.getANSIContrastColors().empty() );
+        remove(szFileA);
+    }
+
+    void SettingsAreOnlyReported()
+    {
+        // two documents saved under different references
+        writeDocument(szFileA, HDTV, D65, 0.3127, 0.3290);
+        writeDocument(szFileB, CUSTOM, DCUST, 0.3140, 0.3510);
+
+        CHCFile fileA, fileB;
+        fileA.readFile(szFileA);
+        fileB.readFile(szFileB);
+
+        CPPUNIT_ASSERT( fileA.getSettings().isValid && fileB.getSettings().isValid );
+        CPPUNIT_ASSERT_EQUAL( (int)HDTV, fileA.getSettings().colorStandard );
+        CPPUNIT_ASSERT_EQUAL( (int)CUSTOM, fileB.getSettings().colorStandard );
+        CPPUNIT_ASSERT_EQUAL( (int)DCUST, fileB.getSettings().whiteTarget );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.3510, fileB.getSettings().manualWhitey, 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.64, fileB.getSettings().manualRedx, 1e-12 );
+        CPPUNIT_ASSERT_EQUAL( 5, fileB.getSettings().dE_form );
+
+        // the measures are read as saved, whatever reference they were taken under
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( fileA.getGrayColors().back().GetY(), fileB.getGrayColors().back().GetY(), 1e-12 );
+
+        // reading the second file leaves what was read from the first alone
+        CPPUNIT_ASSERT_EQUAL( (int)HDTV, fileA.getSettings().colorStandard );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.3290, fileA.getSettings().manualWhitey, 1e-12 );
+        remove(szFileA);
+        remove(szFileB);
+    }
+
+    void TruncatedFile()
+    {
+        writeDocument(szFileA, HDTV, D65, 0.3127, 0.3290);
+
+        FILE* pFile = fopen(szFileA, "rb");
+        fseek(pFile, 0, SEEK_END);
+        long nSize = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+        std::string data(nSize, '\0');
+        CPPUNIT_ASSERT( fread(&data[0], 1, nSize, pFile) == (size_t)nSize );
+        fclose(pFile);
+        pFile = fopen(szFileA, "wb");
+        fwrite(data.data(), 1, nSize / 2, pFile);
+        fclose(pFile);
+
+        CHCFile file;
+        CPPUNIT_ASSERT_THROW( file.readFile(szFileA), Exception );
+        remove(szFileA);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,72 @@
+#include "CIEChartRaster.h"
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE CIEChartRasterTestCase
+
+namespace
+{
+    CIEChartRasterDesc makeDesc(int nWhite)
+    {
+        CIEChartRasterDesc desc;
+        desc.cx = 8;
+        desc.cy = 6;
+        desc.nDiagram = CIE_DIAGRAM_XY;
+        desc.nMaxRgbVal = 255;
+        desc.whiteXYZ[0] = 0.95 + nWhite * 0.001;
+        desc.whiteXYZ[1] = 1.0;
+        desc.whiteXYZ[2] = 1.09;
+        return desc;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( CachedRaster );
+    CPPUNIT_TEST( CacheLimit );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        TrimCIEChartCache(".", 0);
+    }
+
+    void tearDown()
+    {
+        TrimCIEChartCache(".", 0);
+    }
+
+    void CachedRaster()
+    {
+        std::vector<unsigned int> rendered;
+        std::vector<unsigned int> cached;
+        RenderCIEChartRaster(makeDesc(0), rendered);
+        GetCIEChartRaster(makeDesc(0), ".", cached);
+        CPPUNIT_ASSERT_EQUAL( (size_t)(8 * 6), rendered.size() );
+        CPPUNIT_ASSERT( cached == rendered );
+        CPPUNIT_ASSERT_EQUAL( 1, TrimCIEChartCache(".", CIE_RASTER_CACHE_FILES) );
+
+        cached.clear();
+        GetCIEChartRaster(makeDesc(0), ".", cached);
+        CPPUNIT_ASSERT( cached == rendered );
+    }
+
+    void CacheLimit()
+    {
+        std::vector<unsigned int> pixels;
+        for (int i = 0; i < CIE_RASTER_CACHE_FILES + 3; i++)
+        {
+            GetCIEChartRaster(makeDesc(i), ".", pixels);
+        }
+        CPPUNIT_ASSERT_EQUAL( CIE_RASTER_CACHE_FILES, TrimCIEChartCache(".", CIE_RASTER_CACHE_FILES) );
+
+        // the chart just written is never removed
+        CIEChartRasterDesc last = makeDesc(CIE_RASTER_CACHE_FILES + 2);
+        CPPUNIT_ASSERT_EQUAL( 1, TrimCIEChartCache(".", 0, &last) );
+        CPPUNIT_ASSERT_EQUAL( 0, TrimCIEChartCache(".", 0) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
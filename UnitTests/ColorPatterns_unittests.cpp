@@ -0,0 +1,129 @@
+#include "Color.h"
+#include "ColorCheckerTables.h"
+#include <math.h>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE ColorPatternsTestCase
+
+namespace
+{
+    const int modes[3] = { 0, 5, 7 };
+
+    // FNV-1a of the patterns to 1e-5, the nearest value is over 2e-8 from
+    // a rounding edge so compilers agree
+    unsigned int hashColors(const ColorRGBDisplay* colors, int n, unsigned int hash)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                long long value = (long long)floor(colors[i][c] * 1e5 + 0.5);
+                for (int b = 0; b < 8; b++)
+                {
+                    hash ^= (unsigned int)((value >> (8 * b)) & 0xff);
+                    hash *= 16777619u;
+                }
+            }
+        }
+        return hash;
+    }
+
+    unsigned int hashSaturations(ColorStandard standard)
+    {
+        const bool channels[6][3] = { {true, false, false}, {false, true, false}, {false, false, true},
+                                      {true, true, false}, {false, true, true}, {true, false, true} };
+        ColorRGBDisplay colors[11];
+        CColorReference reference(standard);
+        unsigned int hash = 2166136261u;
+        for (int m = 0; m < 3; m++)
+        {
+            for (int c = 0; c < 6; c++)
+            {
+                for (int n = 5; n <= 11; n += 6)
+                {
+                    GenerateSaturationColors(reference, colors, n, channels[c][0], channels[c][1], channels[c][2], modes[m]);
+                    hash = hashColors(colors, n, hash);
+                }
+            }
+        }
+        return hash;
+    }
+
+    unsigned int hashColorChecker(int aCCMode, int size)
+    {
+        const ColorStandard standards[4] = { HDTV, UHDTV2, UHDTV3, UHDTV4 };
+        ColorRGBDisplay colors[200];
+        unsigned int hash = 2166136261u;
+        for (int s = 0; s < 4; s++)
+        {
+            for (int m = 0; m < 3; m++)
+            {
+                GenerateCC24Colors(CColorReference(standards[s]), colors, aCCMode, modes[m]);
+                hash = hashColors(colors, size, hash);
+            }
+        }
+        return hash;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( Saturations );
+    CPPUNIT_TEST( ColorCheckers );
+    CPPUNIT_TEST( RepeatedCalls );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    // The hashes are of the patterns as they were built before the tables
+    void Saturations()
+    {
+        CPPUNIT_ASSERT_EQUAL( 0x7fda617cu, hashSaturations(PALSECAM) );
+        CPPUNIT_ASSERT_EQUAL( 0x5796e5f1u, hashSaturations(SDTV) );
+        CPPUNIT_ASSERT_EQUAL( 0xc2d38c52u, hashSaturations(HDTV) );
+        CPPUNIT_ASSERT_EQUAL( 0xc2d38c52u, hashSaturations(HDTVa) );
+        CPPUNIT_ASSERT_EQUAL( 0xc2d38c52u, hashSaturations(HDTVb) );
+        CPPUNIT_ASSERT_EQUAL( 0xc2d38c52u, hashSaturations(sRGB) );
+        CPPUNIT_ASSERT_EQUAL( 0x61280142u, hashSaturations(UHDTV) );
+        CPPUNIT_ASSERT_EQUAL( 0xe2d7dae4u, hashSaturations(UHDTV2) );
+        CPPUNIT_ASSERT_EQUAL( 0xb49ee96cu, hashSaturations(UHDTV3) );
+        CPPUNIT_ASSERT_EQUAL( 0xdc228fb7u, hashSaturations(UHDTV4) );
+    }
+
+    void ColorCheckers()
+    {
+        CPPUNIT_ASSERT_EQUAL( 0x8f3cf0c5u, hashColorChecker(GCD, 24) );
+        CPPUNIT_ASSERT_EQUAL( 0x32ef9a59u, hashColorChecker(MCD, 24) );
+        CPPUNIT_ASSERT_EQUAL( 0x82998dbfu, hashColorChecker(SKIN, 24) );
+        CPPUNIT_ASSERT_EQUAL( 0x6574001du, hashColorChecker(CMC, 24) );
+        CPPUNIT_ASSERT_EQUAL( 0x473951cau, hashColorChecker(CMS, 19) );
+        CPPUNIT_ASSERT_EQUAL( 0xd7bf73fbu, hashColorChecker(CPS, 19) );
+        CPPUNIT_ASSERT_EQUAL( 0x90931ba7u, hashColorChecker(CCSG, 96) );
+        CPPUNIT_ASSERT_EQUAL( 0x97c1b7e5u, hashColorChecker(AXIS, 71) );
+
+        CPPUNIT_ASSERT( GetColorCheckerTable(AXIS) == NULL );
+        CPPUNIT_ASSERT_EQUAL( 96, GetColorCheckerTable(CCSG)->size );
+    }
+
+    // Later calls come from the caches and must not differ
+    void RepeatedCalls()
+    {
+        CPPUNIT_ASSERT_EQUAL( hashSaturations(UHDTV3), hashSaturations(UHDTV3) );
+        CPPUNIT_ASSERT_EQUAL( hashColorChecker(CCSG, 96), hashColorChecker(CCSG, 96) );
+
+        ColorRGBDisplay first[24];
+        ColorRGBDisplay second[24];
+        GenerateCC24Colors(CColorReference(UHDTV2), first, GCD, 5);
+        GenerateCC24Colors(CColorReference(UHDTV2), second, GCD, 5);
+        for (int i = 0; i < 24; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                CPPUNIT_ASSERT_EQUAL( first[i][c], second[i][c] );
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
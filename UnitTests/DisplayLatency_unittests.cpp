@@ -0,0 +1,119 @@
+#include "DisplayLatency.h"
+#include <math.h>
+#include <sstream>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE DisplayLatencyTestCase
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( SimulatedResponse );
+    CPPUNIT_TEST( CharacteriseSimulatedDisplay );
+    CPPUNIT_TEST( WaitBetweenMeasuredLevels );
+    CPPUNIT_TEST( ProfileRoundTrip );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void SimulatedResponse()
+    {
+        CSimulatedLatencyDisplay display(50.0, 20.0, 40.0, 2.0, 100.0);
+        display.ShowLevel(100.0);
+        display.WaitMs(1000.0);
+        display.ShowLevel(0.0);
+        double start = display.GetClockMs();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, display.GetY(start + 49.0), 1e-9 );
+        // ln(9) time constants from 90% to 10%
+        double tau = 40.0 / log(9.0);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0 * exp(-1.0), display.GetY(start + 50.0 + tau), 1e-6 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, display.GetY(start + 1000.0), 1e-6 );
+    }
+
+    void CharacteriseSimulatedDisplay()
+    {
+        CSimulatedLatencyDisplay display(50.0, 20.0, 40.0);
+        display.SetReadTime(4.0, 2.0);
+        LatencyCharacterisationConfig config;
+        CDisplayLatencyProfile profile;
+        std::string error;
+
+        CPPUNIT_ASSERT( CharacteriseDisplayLatency(display, config, profile, error) );
+        CPPUNIT_ASSERT_EQUAL( 50, profile.GetUpdateDelayMs() );
+        CPPUNIT_ASSERT_EQUAL( 2, profile.GetInstrumentDelayMs() );
+        CPPUNIT_ASSERT_EQUAL( (size_t)20, profile.GetTransitions().size() );
+
+        for (size_t i = 0; i < profile.GetTransitions().size(); i++)
+        {
+            const DisplayTransition& transition = profile.GetTransitions()[i];
+            bool bRise = transition.toLevel > transition.fromLevel;
+            double transitionMs = bRise ? 20.0 : 40.0;
+            double tau = transitionMs / log(9.0);
+            // the 10% point is a little past the latency
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( 50.0 + tau * log(1.0 / 0.9), transition.latencyMs, 3.0 );
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( transitionMs, transition.riseMs, 3.0 );
+            // within 2% after ln(50) time constants
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( 50.0 + tau * log(50.0), transition.settleMs, 3.0 );
+        }
+    }
+
+    void WaitBetweenMeasuredLevels()
+    {
+        CDisplayLatencyProfile profile;
+        profile.SetMargin(0.0, 0.0);
+        const double levels[3] = { 0.0, 50.0, 100.0 };
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                if (i != j)
+                {
+                    // slower the darker the end level
+                    DisplayTransition transition = { levels[i], levels[j], 10.0, 10.0, 100.0 - levels[j] / 2.0 + levels[i] / 10.0 };
+                    profile.AddTransition(transition);
+                }
+            }
+        }
+
+        CPPUNIT_ASSERT_EQUAL( 0, profile.GetWaitMs(30.0, 30.0) );
+        CPPUNIT_ASSERT_EQUAL( 50, profile.GetWaitMs(0.0, 100.0) );
+        CPPUNIT_ASSERT_EQUAL( 110, profile.GetWaitMs(100.0, 0.0) );
+        // between measured levels, the slowest transition around them
+        CPPUNIT_ASSERT_EQUAL( 110, profile.GetWaitMs(75.0, 25.0) );
+        CPPUNIT_ASSERT_EQUAL( 110, profile.GetWaitMs(60.0, 0.0) );
+        CPPUNIT_ASSERT_EQUAL( 105, profile.GetWaitMs(50.0, 0.0) );
+
+        profile.SetMargin(10.0, 5.0);
+        CPPUNIT_ASSERT_EQUAL( 60, profile.GetWaitMs(0.0, 100.0) );
+
+        CDisplayLatencyProfile empty;
+        CPPUNIT_ASSERT_EQUAL( -1, empty.GetWaitMs(0.0, 100.0) );
+    }
+
+    void ProfileRoundTrip()
+    {
+        CSimulatedLatencyDisplay display(30.0, 10.0, 15.0);
+        LatencyCharacterisationConfig config;
+        config.levels.clear();
+        config.levels.push_back(0.0);
+        config.levels.push_back(100.0);
+        CDisplayLatencyProfile profile;
+        std::string error;
+        CPPUNIT_ASSERT( CharacteriseDisplayLatency(display, config, profile, error) );
+
+        std::ostringstream out;
+        profile.Write(out);
+        std::istringstream in(out.str());
+        CDisplayLatencyProfile loaded;
+        CPPUNIT_ASSERT( loaded.Read(in, error) );
+        CPPUNIT_ASSERT( loaded.GetDisplayName() == "Simulated latency display" );
+        CPPUNIT_ASSERT_EQUAL( 30, loaded.GetUpdateDelayMs() );
+        CPPUNIT_ASSERT_EQUAL( (size_t)2, loaded.GetTransitions().size() );
+        CPPUNIT_ASSERT_EQUAL( profile.GetWaitMs(0.0, 100.0), loaded.GetWaitMs(0.0, 100.0) );
+
+        std::istringstream bad("CGATS.17\nBEGIN_DATA_FORMAT\nSAMPLE_ID RGB_R RGB_G RGB_B\nEND_DATA_FORMAT\n");
+        CPPUNIT_ASSERT( !loaded.Read(bad, error) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,152 @@
+#include "DisplayModel.h"
+#include <math.h>
+#include <string>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE DisplayModelTestCase
+
+namespace
+{
+    double measureY(CDisplayModel& model, double level)
+    {
+        double rgb[3] = { level, level, level };
+        double XYZ[3];
+        model.Measure(rgb, XYZ);
+        return XYZ[1];
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( Response );
+    CPPUNIT_TEST( SeedRepeatsReadings );
+    CPPUNIT_TEST( BrightnessLimitingAndWarmUp );
+    CPPUNIT_TEST( Latency );
+    CPPUNIT_TEST( Settings );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void Response()
+    {
+        DisplayModelConfig config;
+        config.blackY = 0.1;
+        config.bits = 0;
+        CDisplayModel model(config);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, measureY(model, 0.0), 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 120.0, measureY(model, 100.0), 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1 + 119.9 * pow(0.5, 2.22), measureY(model, 50.0), 1e-9 );
+
+        // the primaries add up to the white point
+        double rgb[3] = { 100.0, 100.0, 100.0 };
+        double XYZ[3];
+        model.Measure(rgb, XYZ);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.3127, XYZ[0] / (XYZ[0] + XYZ[1] + XYZ[2]), 1e-9 );
+
+        config.eotf[0] = config.eotf[1] = config.eotf[2] = DisplayModelConfig::EOTF_PQ;
+        config.whiteY = 1000.0;
+        config.blackY = 0.0;
+        config.bits = 10;
+        CDisplayModel pq(config);
+        // 100 cd/m2 is a signal of 0.508, level 445 of 876
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, measureY(pq, 445.0 / 8.76), 1.0 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 1000.0, measureY(pq, 100.0), 1e-9 );
+    }
+
+    void SeedRepeatsReadings()
+    {
+        DisplayModelConfig config;
+        config.noiseRelative = 0.01;
+        config.noiseAbsolute = 0.05;
+        config.offsetErrorMax = 1.0;
+        config.seed = 42;
+        CDisplayModel first(config);
+        CDisplayModel second(config);
+        double firstY[100];
+        for (int i = 0; i < 100; i++)
+        {
+            firstY[i] = measureY(first, i);
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            CPPUNIT_ASSERT_EQUAL( firstY[i], measureY(second, i) );
+        }
+        second.Reset();
+        CPPUNIT_ASSERT_EQUAL( firstY[0], measureY(second, 0) );
+
+        config.seed = 43;
+        CDisplayModel other(config);
+        CPPUNIT_ASSERT( measureY(other, 50) != firstY[50] );
+    }
+
+    void BrightnessLimitingAndWarmUp()
+    {
+        DisplayModelConfig config;
+        config.ablWindow = 1.0;
+        config.ablThreshold = 0.2;
+        config.ablMinGain = 0.6;
+        CDisplayModel abl(config);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 72.0, measureY(abl, 100.0), 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 120.0 * pow(40.0 / 100.0, 2.22), measureY(abl, 40.0), 0.5 );
+
+        config = DisplayModelConfig();
+        config.warmUpDrop = 0.1;
+        config.warmUpMs = 1000.0;
+        config.readMs = 1000.0;
+        CDisplayModel warmUp(config);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 108.0, measureY(warmUp, 100.0), 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 120.0 - 12.0 * exp(-1.0), measureY(warmUp, 100.0), 1e-9 );
+    }
+
+    void Latency()
+    {
+        DisplayModelConfig config;
+        config.latencyMs = 50.0;
+        config.responseMs = 10.0;
+        CDisplayModel model(config);
+        double white[3] = { 100.0, 100.0, 100.0 };
+        double XYZ[3];
+
+        model.Show(white);
+        model.Wait(40.0);
+        model.Read(XYZ);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, XYZ[1], 1e-9 );
+        model.Wait(20.0);
+        model.Read(XYZ);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 120.0 * (1.0 - exp(-1.0)), XYZ[1], 1e-9 );
+
+        // a measure waits for the change to settle
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, measureY(model, 0.0), 0.2 );
+        CPPUNIT_ASSERT( model.GetClockMs() > 160.0 );
+    }
+
+    void Settings()
+    {
+        DisplayModelConfig config;
+        std::string error;
+        CPPUNIT_ASSERT( ParseDisplayModelConfig("eotf=bt1886,gamma=2.2:2.3:2.4,black=0.05,abl=0.1:0.2:0.7,noise=0.002:0.01,latency=50,spectrum=1,seed=9", config, error) );
+        CPPUNIT_ASSERT_EQUAL( DisplayModelConfig::EOTF_BT1886, config.eotf[2] );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.3, config.gamma[1], 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.7, config.ablMinGain, 1e-12 );
+        CPPUNIT_ASSERT( config.bSpectrum );
+        CPPUNIT_ASSERT_EQUAL( 9u, config.seed );
+
+        CPPUNIT_ASSERT( !ParseDisplayModelConfig("gamma=2.2:2.3", config, error) );
+        CPPUNIT_ASSERT( !ParseDisplayModelConfig("bits=12", config, error) );
+        CPPUNIT_ASSERT( !ParseDisplayModelConfig("colour=1", config, error) );
+        CPPUNIT_ASSERT( error.find("colour") != std::string::npos );
+
+        // BT.1886 starts from the black level
+        config.bits = 0;
+        CDisplayModel model(config);
+        double spectrum[CDisplayModel::SPECTRUM_BANDS];
+        double rgb[3] = { 0.0, 100.0, 0.0 };
+        double XYZ[3];
+        model.Measure(rgb, XYZ, spectrum);
+        CPPUNIT_ASSERT( spectrum[(545 - CDisplayModel::SPECTRUM_MIN) / 10] > spectrum[(455 - CDisplayModel::SPECTRUM_MIN) / 10] );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.05, measureY(model, 0.0), 0.05 * 0.01 + 0.01 * 5 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,104 @@
+#include "LiveReadout.h"
+#include "DisplayModel.h"
+#include <math.h>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE LiveReadoutTestCase
+
+namespace
+{
+    // the filter fed from a noisy display showing a patch
+    const LiveReadout& readPatch(CLiveReadoutFilter& filter, CDisplayModel& display, double level, int nReadings)
+    {
+        double rgb[3] = { level, level, level };
+        double XYZ[3];
+        display.Show(rgb);
+        for (int i = 0; i < nReadings; i++)
+        {
+            display.Read(XYZ);
+            filter.Add(XYZ);
+        }
+        return filter.GetReadout();
+    }
+
+    double trueY(double level)
+    {
+        return 120.0 * pow(level / 100.0, 2.22);
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( Settles );
+    CPPUNIT_TEST( FollowsSteps );
+    CPPUNIT_TEST( LearnsNoise );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void Settles()
+    {
+        DisplayModelConfig config;
+        config.noiseRelative = 0.01;
+        config.bits = 0;
+        CDisplayModel display(config);
+        CLiveReadoutFilter filter;
+
+        const LiveReadout& first = readPatch(filter, display, 50.0, 1);
+        CPPUNIT_ASSERT( first.bStep );
+        CPPUNIT_ASSERT( !first.bStable );
+
+        const LiveReadout& readout = readPatch(filter, display, 50.0, 50);
+        CPPUNIT_ASSERT( readout.count > 40 );
+        CPPUNIT_ASSERT( readout.bStable );
+        // better than a single reading, and the band holds the truth
+        CPPUNIT_ASSERT( readout.band[1] < 0.01 * trueY(50.0) );
+        CPPUNIT_ASSERT( fabs(readout.XYZ[1] - trueY(50.0)) < readout.band[1] );
+
+        filter.Reset();
+        CPPUNIT_ASSERT_EQUAL( 0, filter.GetReadout().count );
+    }
+
+    void FollowsSteps()
+    {
+        CLiveReadoutFilter filter;
+        double XYZ[3] = { 10.0, 10.0, 10.0 };
+        for (int i = 0; i < 10; i++)
+        {
+            filter.Add(XYZ);
+        }
+
+        // a single wild reading is ignored
+        double spike[3] = { 10.0, 20.0, 10.0 };
+        filter.Add(spike);
+        filter.Add(XYZ);
+        CPPUNIT_ASSERT_EQUAL( 11, filter.GetReadout().count );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0, filter.GetReadout().XYZ[1], 1e-12 );
+
+        // two in a row are a new level
+        double brighter[3] = { 11.0, 11.0, 11.0 };
+        CPPUNIT_ASSERT( !filter.Add(brighter).bStep );
+        const LiveReadout& readout = filter.Add(brighter);
+        CPPUNIT_ASSERT( readout.bStep );
+        CPPUNIT_ASSERT_EQUAL( 1, readout.count );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 11.0, readout.XYZ[1], 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, filter.GetNoiseScale(), 0.5 );
+    }
+
+    void LearnsNoise()
+    {
+        DisplayModelConfig config;
+        config.noiseRelative = 0.05;
+        config.bits = 0;
+        CDisplayModel display(config);
+        CLiveReadoutFilter filter;
+
+        const LiveReadout& readout = readPatch(filter, display, 75.0, 200);
+        CPPUNIT_ASSERT( filter.GetNoiseScale() > 20.0 );
+        CPPUNIT_ASSERT( readout.count > 50 );
+        CPPUNIT_ASSERT( fabs(readout.XYZ[1] - trueY(75.0)) < readout.band[1] );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
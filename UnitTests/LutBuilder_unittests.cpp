@@ -0,0 +1,156 @@
+#include "LutBuilder.h"
+#include "MeasurementRunner.h"
+#include <math.h>
+#include <sstream>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE LutBuilderTestCase
+
+namespace
+{
+    // A BT.2020 gamut display with a 2.2 gamma, a raised black and a
+    // little sensor noise, measured on a 9 x 9 x 9 patch cube
+    void measureDisplay(CSimulatedDisplaySensor& sensor, C3DLutBuilder& builder)
+    {
+        std::vector<ColorRGBDisplay> rgb;
+        std::vector<ColorXYZ> XYZ;
+        for (int r = 0; r < 9; r++)
+        {
+            for (int g = 0; g < 9; g++)
+            {
+                for (int b = 0; b < 9; b++)
+                {
+                    ColorRGBDisplay patch(r * 12.5, g * 12.5, b * 12.5);
+                    rgb.push_back(patch);
+                    XYZ.push_back(sensor.MeasureRGBColor(patch));
+                }
+            }
+        }
+        builder.SetMeasurements(rgb, XYZ);
+        builder.SetTarget(CColorReference(HDTV), 2.4);
+    }
+
+    double distance(const ColorXYZ& a, const ColorXYZ& b)
+    {
+        return sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( BadSize );
+    CPPUNIT_TEST( FitFollowsDisplay );
+    CPPUNIT_TEST( CorrectsToTarget );
+    CPPUNIT_TEST( SameResultOnAnyThreadCount );
+    CPPUNIT_TEST( FileFormats );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void BadSize()
+    {
+        CSimulatedDisplaySensor sensor(CColorReference(UHDTV2), 2.2, 100.0, 0.1);
+        C3DLutBuilder builder;
+        measureDisplay(sensor, builder);
+        CPPUNIT_ASSERT( !builder.Build(16) );
+        CPPUNIT_ASSERT( !builder.Build(66) );
+        CPPUNIT_ASSERT( !builder.GetLastError().empty() );
+
+        C3DLutBuilder empty;
+        CPPUNIT_ASSERT( !empty.Build(17) );
+    }
+
+    void FitFollowsDisplay()
+    {
+        CSimulatedDisplaySensor sensor(CColorReference(UHDTV2), 2.2, 100.0, 0.1);
+        C3DLutBuilder builder;
+        measureDisplay(sensor, builder);
+        CPPUNIT_ASSERT( builder.Build(17) );
+
+        // between the patches, within a percent of white
+        const double levels[][3] = { { 5, 5, 5 }, { 30, 60, 90 }, { 77, 21, 48 }, { 95, 95, 3 }, { 50, 50, 50 } };
+        for (int i = 0; i < 5; i++)
+        {
+            ColorRGBDisplay rgb(levels[i][0], levels[i][1], levels[i][2]);
+            CPPUNIT_ASSERT( distance(builder.GetFittedXYZ(rgb), sensor.MeasureRGBColor(rgb)) < 1.0 );
+        }
+    }
+
+    void CorrectsToTarget()
+    {
+        CSimulatedDisplaySensor sensor(CColorReference(UHDTV2), 2.2, 100.0, 0.1);
+        C3DLutBuilder builder;
+        measureDisplay(sensor, builder);
+        CPPUNIT_ASSERT( builder.Build(33) );
+
+        // the corrected display shows BT.709 colours with a 2.4 gamma
+        const double levels[][3] = { { 100, 100, 100 }, { 100, 0, 0 }, { 0, 75, 0 }, { 40, 40, 80 }, { 20, 20, 20 } };
+        for (int i = 0; i < 5; i++)
+        {
+            ColorRGBDisplay rgb(levels[i][0], levels[i][1], levels[i][2]);
+            ColorXYZ shown = sensor.MeasureRGBColor(builder.Apply(rgb));
+            CPPUNIT_ASSERT( distance(shown, builder.GetTargetXYZ(rgb)) < 1.0 );
+        }
+        // the white point is the display's own, so nothing is lost
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, builder.GetTargetXYZ(ColorRGBDisplay(100.0))[1], 0.5 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, builder.GetTargetXYZ(ColorRGBDisplay(0.0))[1], 0.05 );
+    }
+
+    void SameResultOnAnyThreadCount()
+    {
+        CSimulatedDisplaySensor sensor(CColorReference(UHDTV2), 2.2, 100.0, 0.1);
+        C3DLutBuilder single;
+        C3DLutBuilder multi;
+        measureDisplay(sensor, single);
+        measureDisplay(sensor, multi);
+        single.SetThreads(1);
+        multi.SetThreads(4);
+        CPPUNIT_ASSERT( single.Build(17) );
+        CPPUNIT_ASSERT( multi.Build(17) );
+
+        std::ostringstream singleCube, multiCube;
+        single.WriteCube(singleCube, "HCFR");
+        multi.WriteCube(multiCube, "HCFR");
+        CPPUNIT_ASSERT( singleCube.str() == multiCube.str() );
+    }
+
+    void FileFormats()
+    {
+        CSimulatedDisplaySensor sensor(CColorReference(UHDTV2), 2.2, 100.0, 0.1);
+        C3DLutBuilder builder;
+        measureDisplay(sensor, builder);
+        CPPUNIT_ASSERT( builder.Build(17) );
+
+        std::ostringstream cube;
+        builder.WriteCube(cube, "HCFR");
+        std::string text = cube.str();
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, text.find("TITLE \"HCFR\"\nLUT_3D_SIZE 17\n") );
+        size_t nLines = 0;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            nLines += (text[i] == '\n');
+        }
+        CPPUNIT_ASSERT_EQUAL( (size_t)(4 + 17 * 17 * 17), nLines );
+
+        std::ostringstream threeDL;
+        builder.WriteThreeDL(threeDL);
+        std::istringstream in(threeDL.str());
+        int mesh[17];
+        for (int i = 0; i < 17; i++)
+        {
+            in >> mesh[i];
+        }
+        CPPUNIT_ASSERT_EQUAL( 0, mesh[0] );
+        CPPUNIT_ASSERT_EQUAL( 64, mesh[1] );
+        CPPUNIT_ASSERT_EQUAL( 1023, mesh[16] );
+        // black first, then blue varies fastest
+        int r, g, b;
+        in >> r >> g >> b;
+        CPPUNIT_ASSERT( r < 50 && g < 50 && b < 50 );
+        in >> r >> g >> b;
+        CPPUNIT_ASSERT( b > r && b > g );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
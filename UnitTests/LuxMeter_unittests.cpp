@@ -0,0 +1,148 @@
+#include "LuxMeter.h"
+#include "TraceLog.h"
+#include <string>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#ifndef WIN32
+#   include <fcntl.h>
+#   include <stdlib.h>
+#   include <unistd.h>
+#endif
+
+#define THIS_TEST_CASE LuxMeterTestCase
+
+namespace
+{
+    // An LX-1108 packet, lux or Ft-cd, with the reading in units of the
+    // scale's last digit
+    std::string packet(bool bFtCd, char scale, const char* szDigits)
+    {
+        return std::string("\002411") + (bFtCd ? '6' : '5') + '0' + scale + "0000" + szDigits + "\r";
+    }
+
+    LuxSample sample(double timeMs, double lux)
+    {
+        LuxSample result = { timeMs, lux, false, false, false, false };
+        return result;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( DecodePackets );
+    CPPUNIT_TEST( MatchWindow );
+    CPPUNIT_TEST( RingWraps );
+#ifndef WIN32
+    CPPUNIT_TEST( ReadFromPty );
+#endif
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void DecodePackets()
+    {
+        LuxSample result;
+        char unit, scale;
+        CPPUNIT_ASSERT( DecodeLX1108Packet(packet(false, '1', "00001234").c_str(), result, unit, scale) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 123.4, result.lux, 1e-9 );
+        CPPUNIT_ASSERT_EQUAL( '5', unit );
+        CPPUNIT_ASSERT_EQUAL( '1', scale );
+
+        CPPUNIT_ASSERT( DecodeLX1108Packet(packet(true, '0', "00000010").c_str(), result, unit, scale) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0 / 0.0929, result.lux, 1e-9 );
+
+        CPPUNIT_ASSERT( DecodeLX1108Packet(packet(false, '3', "\x19").c_str(), result, unit, scale) );
+        CPPUNIT_ASSERT( result.bLow && result.bLowestScale && !result.bHigh );
+
+        CPPUNIT_ASSERT( !DecodeLX1108Packet("\0024119000000001234\r", result, unit, scale) );
+        CPPUNIT_ASSERT( !DecodeLX1108Packet(packet(false, '1', "00001234").substr(0, 15).c_str(), result, unit, scale) );
+    }
+
+    void MatchWindow()
+    {
+        CLuxSampleBuffer buffer;
+        LuxSample result;
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_PENDING, buffer.Match(0.0, 100.0, 100.0, result) );
+
+        for (int i = 1; i <= 10; i++)
+        {
+            buffer.Add(sample(i * 100.0, i));
+        }
+        // integrated wholly inside the window
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OK, buffer.Match(250.0, 620.0, 100.0, result) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 5.0, result.lux, 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 600.0, result.timeMs, 1e-9 );
+        // a short window takes the first reading after it began
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OK, buffer.Match(250.0, 260.0, 100.0, result) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 4.0, result.lux, 1e-9 );
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_PENDING, buffer.Match(950.0, 960.0, 100.0, result) );
+
+        LuxSample over = sample(1100.0, 0.0);
+        over.bHigh = true;
+        over.bHighestScale = true;
+        buffer.Add(over);
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OVER_RANGE, buffer.Match(950.0, 960.0, 100.0, result) );
+        CPPUNIT_ASSERT( result.bHighestScale );
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OK, buffer.Match(850.0, 1000.0, 100.0, result) );
+    }
+
+    void RingWraps()
+    {
+        CLuxSampleBuffer buffer;
+        for (int i = 0; i < CLuxSampleBuffer::CAPACITY + 44; i++)
+        {
+            buffer.Add(sample(i * 10.0, i));
+        }
+        CPPUNIT_ASSERT_EQUAL( (int)CLuxSampleBuffer::CAPACITY, buffer.GetCount() );
+        LuxSample result;
+        CPPUNIT_ASSERT( buffer.GetLatest(result) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( CLuxSampleBuffer::CAPACITY + 43.0, result.lux, 1e-9 );
+        // the oldest readings are gone
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OK, buffer.Match(0.0, 1e9, 0.0, result) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 44.0 + (CLuxSampleBuffer::CAPACITY - 1) / 2.0, result.lux, 1e-9 );
+    }
+
+#ifndef WIN32
+    // A fake lux meter on the master side of a pseudo terminal
+    void ReadFromPty()
+    {
+        int nMaster = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT( nMaster >= 0 );
+        CPPUNIT_ASSERT( grantpt(nMaster) == 0 && unlockpt(nMaster) == 0 );
+        std::string slave = ptsname(nMaster);
+
+        CLuxSampleBuffer buffer;
+        CLuxMeterReader reader(buffer);
+        CPPUNIT_ASSERT( reader.Start(slave) );
+        CPPUNIT_ASSERT( reader.IsRunning() );
+
+        double startMs = CTraceLog::GetClockUs() / 1000.0;
+        // the first reading on a range is dropped, then a packet split
+        // over two writes
+        std::string data = packet(false, '1', "00001000") + packet(false, '1', "00001234") + packet(false, '0', "00000050");
+        std::string last = packet(false, '0', "00000060");
+        CPPUNIT_ASSERT( write(nMaster, data.c_str(), data.size()) == (ssize_t)data.size() );
+        usleep(20000);
+        CPPUNIT_ASSERT( write(nMaster, last.c_str(), 5) == 5 );
+        usleep(20000);
+        CPPUNIT_ASSERT( write(nMaster, last.c_str() + 5, last.size() - 5) == (ssize_t)(last.size() - 5) );
+
+        for (int i = 0; i < 200 && buffer.GetCount() < 2; i++)
+        {
+            usleep(10000);
+        }
+        reader.Stop();
+        close(nMaster);
+
+        CPPUNIT_ASSERT_EQUAL( 2, buffer.GetCount() );
+        LuxSample result;
+        CPPUNIT_ASSERT_EQUAL( CLuxSampleBuffer::MATCH_OK, buffer.Match(startMs, 1e12, 0.0, result) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( (123.4 + 60.0) / 2.0, result.lux, 1e-9 );
+        CPPUNIT_ASSERT( result.timeMs >= startMs + 20.0 );
+        CPPUNIT_ASSERT( !reader.IsRunning() );
+    }
+#endif
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
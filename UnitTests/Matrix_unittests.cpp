@@ -0,0 +1,175 @@
+#include "Matrix.h"
+#include <math.h>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE MatrixTestCase
+
+namespace
+{
+    // the textbook expansion along the first row, as Determinant()
+    // used to do it, to check the fast paths against
+    double cofactorDeterminant(const Matrix& m)
+    {
+        if(m.GetRows() == 1)
+        {
+            return m(0, 0);
+        }
+        double sum = 0.0;
+        for(int q(0); q < m.GetColumns(); ++q)
+        {
+            sum += ((q % 2) ? -1.0 : 1.0) * m(0, q) * cofactorDeterminant(m.GetMinor(0, q));
+        }
+        return sum;
+    }
+
+    // well conditioned but otherwise arbitrary contents
+    Matrix testMatrix(int n)
+    {
+        Matrix m(0.0, n, n);
+        for(int i(0); i < n; ++i)
+        {
+            for(int j(0); j < n; ++j)
+            {
+                m(i, j) = sin(1.0 + i * n + j) + (i == j ? n : 0.0);
+            }
+        }
+        return m;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( DeterminantMatchesCofactors );
+    CPPUNIT_TEST( KnownInverses );
+    CPPUNIT_TEST( InverseNeedingPivoting );
+    CPPUNIT_TEST( SingularInverseThrows );
+    CPPUNIT_TEST( ConditionNumber );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+protected:
+    void checkIdentity(const Matrix& m, double tolerance)
+    {
+        for(int i(0); i < m.GetRows(); ++i)
+        {
+            for(int j(0); j < m.GetColumns(); ++j)
+            {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL( i == j ? 1.0 : 0.0, m(i, j), tolerance );
+            }
+        }
+    }
+
+    void checkEqual(const Matrix& ref, const Matrix& toTest, double tolerance)
+    {
+        for(int i(0); i < ref.GetRows(); ++i)
+        {
+            for(int j(0); j < ref.GetColumns(); ++j)
+            {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL( ref(i, j), toTest(i, j), tolerance );
+            }
+        }
+    }
+
+    void DeterminantMatchesCofactors()
+    {
+        for(int n(1); n <= 7; ++n)
+        {
+            Matrix m(testMatrix(n));
+            double expected = cofactorDeterminant(m);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( expected, m.Determinant(), fabs(expected) * 1e-12 );
+        }
+    }
+
+    void KnownInverses()
+    {
+        double a2[] = { 4, 7,
+                        2, 6 };
+        double i2[] = { 0.6, -0.7,
+                        -0.2, 0.4 };
+        checkEqual(Matrix(i2, 2, 2), Matrix(a2, 2, 2).GetInverse(), 1e-14);
+
+        double a3[] = { 1, 2, 3,
+                        0, 1, 4,
+                        5, 6, 0 };
+        double i3[] = { -24, 18, 5,
+                        20, -15, -4,
+                        -5, 4, 1 };
+        checkEqual(Matrix(i3, 3, 3), Matrix(a3, 3, 3).GetInverse(), 1e-12);
+
+        // symmetric, and its own inverse up to a factor 4
+        double a4[] = { 1, 1, 1, -1,
+                        1, 1, -1, 1,
+                        1, -1, 1, 1,
+                        -1, 1, 1, 1 };
+        checkEqual(Matrix(a4, 4, 4) * 0.25, Matrix(a4, 4, 4).GetInverse(), 1e-14);
+
+        for(int n(1); n <= 8; ++n)
+        {
+            Matrix m(testMatrix(n));
+            checkIdentity(m * m.GetInverse(), 1e-12);
+            checkIdentity(m.GetInverse() * m, 1e-12);
+        }
+    }
+
+    void InverseNeedingPivoting()
+    {
+        // zero on the diagonal, stopped the old elimination
+        Matrix m(0.0, 5, 5);
+        for(int i(0); i < 5; ++i)
+        {
+            m(i, (i + 1) % 5) = i + 1.0;
+        }
+        checkIdentity(m * m.GetInverse(), 1e-14);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 120.0, m.Determinant(), 1e-12 );
+
+        // tiny pivot, hopeless without row exchanges
+        double a[] = { 1e-20, 1, 0, 0, 0,
+                       1, 1, 0, 0, 0,
+                       0, 0, 1, 0, 0,
+                       0, 0, 0, 1, 0,
+                       0, 0, 0, 0, 1 };
+        Matrix t(a, 5, 5);
+        checkIdentity(t * t.GetInverse(), 1e-14);
+    }
+
+    void SingularInverseThrows()
+    {
+        double a3[] = { 1, 2, 3,
+                        2, 4, 6,
+                        5, 6, 0 };
+        Matrix m3(a3, 3, 3);
+        CPPUNIT_ASSERT_EQUAL( 0.0, m3.Determinant() );
+        CPPUNIT_ASSERT_THROW( m3.GetInverse(), MatrixException* );
+
+        Matrix m6(testMatrix(6));
+        for(int j(0); j < 6; ++j)
+        {
+            m6(5, j) = m6(0, j);
+        }
+        CPPUNIT_ASSERT_THROW( m6.GetInverse(), MatrixException* );
+    }
+
+    void ConditionNumber()
+    {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, Matrix::IdentityMatrix(3).GetConditionNumber(), 1e-15 );
+
+        // three measures of almost the same colour
+        double a[] = { 41.2, 41.2000001, 41.2,
+                       21.3, 21.3, 21.3000001,
+                       1.93, 1.93, 1.93 };
+        CPPUNIT_ASSERT( Matrix(a, 3, 3).GetConditionNumber() > 1e6 );
+
+        double s[] = { 1, 2, 3,
+                       2, 4, 6,
+                       5, 6, 0 };
+        CPPUNIT_ASSERT_EQUAL( HUGE_VAL, Matrix(s, 3, 3).GetConditionNumber() );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,225 @@
+#include "MeasurementJournal.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE MeasurementJournalTestCase
+
+namespace
+{
+    const char* szJournal = "journal_unittest.hcj";
+    const char* szSnapshot = "journal_unittest.chc";
+
+    long fileSize(const char* szPath)
+    {
+        FILE* pFile = fopen(szPath, "rb");
+        if (!pFile)
+        {
+            return -1;
+        }
+        fseek(pFile, 0, SEEK_END);
+        long nSize = ftell(pFile);
+        fclose(pFile);
+        return nSize;
+    }
+
+    // records the thread that builds it, the measuring thread only copies the document
+    class TestSnapshot : public CJournalSnapshot
+    {
+    public:
+        TestSnapshot(bool& bDeleted, bool& bOnCaller) : m_bDeleted(bDeleted), m_bOnCaller(bOnCaller)
+        {
+#ifdef LIBHCFR_HAS_WIN32_API
+            m_caller = GetCurrentThreadId();
+#else
+            m_caller = pthread_self();
+#endif
+        }
+        virtual ~TestSnapshot() { m_bDeleted = true; }
+
+        virtual bool Build(std::vector<char>& data)
+        {
+#ifdef LIBHCFR_HAS_WIN32_API
+            m_bOnCaller = (GetCurrentThreadId() == m_caller);
+#else
+            m_bOnCaller = (pthread_equal(pthread_self(), m_caller) != 0);
+#endif
+            data.assign(500, 'B');
+            return true;
+        }
+
+    private:
+        bool& m_bDeleted;
+        bool& m_bOnCaller;
+#ifdef LIBHCFR_HAS_WIN32_API
+        DWORD m_caller;
+#else
+        pthread_t m_caller;
+#endif
+    };
+
+    CColor reading(int i)
+    {
+        CColor color(i, i * 2.0, i * 3.0);
+        if (i % 2)
+        {
+            color.SetLuxValue(i * 0.5);
+        }
+        return color;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( RecordRoundTrip );
+    CPPUNIT_TEST( AppendAndRead );
+    CPPUNIT_TEST( TornTail );
+    CPPUNIT_TEST( CompactRestartsJournal );
+    CPPUNIT_TEST( SnapshotBuiltByWriter );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void RecordRoundTrip()
+    {
+        double values[4] = { 0.1, 0.2, 0.4, 0.8 };
+        CSpectrum spectrum(4, 380, 410, 10.0, values);
+        CColor color(12.0, 13.0, 14.0);
+        color.SetLuxValue(42.0);
+        color.SetSpectrum(spectrum);
+
+        CColor result = GetJournalColor(MakeJournalRecord(3, 7, 21, color));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 13.0, result.GetY(), 1e-12 );
+        CPPUNIT_ASSERT( result.HasLuxValue() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 42.0, result.GetLuxValue(), 1e-12 );
+        CPPUNIT_ASSERT( result.HasSpectrum() );
+        CSpectrum resultSpectrum = result.GetSpectrum();
+        CPPUNIT_ASSERT_EQUAL( 4, resultSpectrum.GetRows() );
+        CPPUNIT_ASSERT_EQUAL( 410, resultSpectrum.m_WaveLengthMax );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.8, resultSpectrum[3], 1e-12 );
+
+        CColor plain = GetJournalColor(MakeJournalRecord(0, 0, 1, CColor(1.0, 2.0, 3.0)));
+        CPPUNIT_ASSERT( !plain.HasLuxValue() && !plain.HasSpectrum() );
+    }
+
+    void AppendAndRead()
+    {
+        CMeasurementJournal journal;
+        CPPUNIT_ASSERT( journal.Open(szJournal, "C:\\HCFR\\display.chc", szSnapshot) );
+        for (int i = 0; i < 1000; i++)
+        {
+            journal.Append(MakeJournalRecord(1, i, 1000, reading(i)));
+        }
+        CPPUNIT_ASSERT_EQUAL( 1000, journal.GetRecordCount() );
+        journal.Close();
+
+        std::string documentPath, snapshotPath, error;
+        std::vector<JournalRecord> records;
+        CPPUNIT_ASSERT( CMeasurementJournal::Read(szJournal, documentPath, snapshotPath, records, error) );
+        CPPUNIT_ASSERT( documentPath == "C:\\HCFR\\display.chc" );
+        CPPUNIT_ASSERT( snapshotPath == szSnapshot );
+        CPPUNIT_ASSERT_EQUAL( (size_t)1000, records.size() );
+        CPPUNIT_ASSERT_EQUAL( 999, records[999].index );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 3.0 * 999, records[999].XYZ[2], 1e-12 );
+        CPPUNIT_ASSERT( records[999].bHasLux && !records[998].bHasLux );
+        remove(szJournal);
+    }
+
+    void TornTail()
+    {
+        CMeasurementJournal journal;
+        CPPUNIT_ASSERT( journal.Open(szJournal, "", szSnapshot) );
+        for (int i = 0; i < 10; i++)
+        {
+            journal.Append(MakeJournalRecord(2, i, 10, reading(i)));
+        }
+        journal.Close();
+
+        // the last record cut short, as by a crash during the write
+        long nSize = fileSize(szJournal);
+        std::vector<char> data(nSize);
+        FILE* pFile = fopen(szJournal, "rb");
+        CPPUNIT_ASSERT( fread(&data[0], 1, nSize, pFile) == (size_t)nSize );
+        fclose(pFile);
+        pFile = fopen(szJournal, "wb");
+        fwrite(&data[0], 1, nSize - 5, pFile);
+        fclose(pFile);
+
+        std::string documentPath, snapshotPath, error;
+        std::vector<JournalRecord> records;
+        CPPUNIT_ASSERT( CMeasurementJournal::Read(szJournal, documentPath, snapshotPath, records, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)9, records.size() );
+
+        // a damaged header is refused
+        pFile = fopen(szJournal, "wb");
+        fwrite("HCFRJRN0", 1, 8, pFile);
+        fclose(pFile);
+        CPPUNIT_ASSERT( !CMeasurementJournal::Read(szJournal, documentPath, snapshotPath, records, error) );
+        remove(szJournal);
+    }
+
+    void CompactRestartsJournal()
+    {
+        CMeasurementJournal journal;
+        CPPUNIT_ASSERT( journal.Open(szJournal, "", szSnapshot) );
+        for (int i = 0; i < 10; i++)
+        {
+            journal.Append(MakeJournalRecord(1, i, 20, reading(i)));
+        }
+        std::vector<char> snapshot(1000, 'S');
+        journal.Compact(snapshot);
+        CPPUNIT_ASSERT_EQUAL( 0, journal.GetRecordCount() );
+        for (int i = 10; i < 15; i++)
+        {
+            journal.Append(MakeJournalRecord(1, i, 20, reading(i)));
+        }
+        journal.Flush();
+        CPPUNIT_ASSERT_EQUAL( 1000L, fileSize(szSnapshot) );
+
+        // the journal only holds what came after the snapshot
+        std::string documentPath, snapshotPath, error;
+        std::vector<JournalRecord> records;
+        CPPUNIT_ASSERT( CMeasurementJournal::Read(szJournal, documentPath, snapshotPath, records, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)5, records.size() );
+        CPPUNIT_ASSERT_EQUAL( 10, records[0].index );
+
+        journal.Discard();
+        CPPUNIT_ASSERT_EQUAL( -1L, fileSize(szJournal) );
+        CPPUNIT_ASSERT_EQUAL( -1L, fileSize(szSnapshot) );
+    }
+
+    void SnapshotBuiltByWriter()
+    {
+        CMeasurementJournal journal;
+        CPPUNIT_ASSERT( journal.Open(szJournal, "", szSnapshot) );
+        for (int i = 0; i < 10; i++)
+        {
+            journal.Append(MakeJournalRecord(1, i, 20, reading(i)));
+        }
+        bool bDeleted = false, bOnCaller = true;
+        journal.Compact(new TestSnapshot(bDeleted, bOnCaller));
+        CPPUNIT_ASSERT_EQUAL( 0, journal.GetRecordCount() );
+        journal.Append(MakeJournalRecord(1, 10, 20, reading(10)));
+        journal.Flush();
+
+        CPPUNIT_ASSERT( bDeleted );
+        CPPUNIT_ASSERT( !bOnCaller );
+        CPPUNIT_ASSERT_EQUAL( 500L, fileSize(szSnapshot) );
+
+        std::string documentPath, snapshotPath, error;
+        std::vector<JournalRecord> records;
+        CPPUNIT_ASSERT( CMeasurementJournal::Read(szJournal, documentPath, snapshotPath, records, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)1, records.size() );
+        CPPUNIT_ASSERT_EQUAL( 10, records[0].index );
+
+        // a closed journal still frees the snapshot
+        journal.Discard();
+        bDeleted = false;
+        journal.Compact(new TestSnapshot(bDeleted, bOnCaller));
+        CPPUNIT_ASSERT( bDeleted );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,176 @@
+#include "MeasurementRunner.h"
+#include <math.h>
+#include <sstream>
+#include <algorithm>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE MeasurementRunnerTestCase
+
+namespace
+{
+    // fails to display the patch it is told to
+    class FailingGenerator : public CMeasurementGenerator
+    {
+    public:
+        FailingGenerator(int nFailAt) : m_nFailAt(nFailAt), m_nShown(0) {}
+        virtual std::string GetName() const { return "Failing generator"; }
+        virtual bool DisplayRGBColor(const ColorRGBDisplay&) { return m_nShown++ != m_nFailAt; }
+    private:
+        int m_nFailAt;
+        int m_nShown;
+    };
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( BuildSeries );
+    CPPUNIT_TEST( BadSeries );
+    CPPUNIT_TEST( SimulatedGrayscale );
+    CPPUNIT_TEST( RunStopsOnGeneratorFailure );
+    CPPUNIT_TEST( CgatsOutput );
+    CPPUNIT_TEST( CsvQuotesLongNames );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void BuildSeries()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches;
+        std::string error;
+
+        CPPUNIT_ASSERT( BuildMeasurementSeries("gray:11", config, patches, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)11, patches.size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, patches[0].rgb[0], 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, patches[10].rgb[2], 1e-9 );
+        CPPUNIT_ASSERT( patches[5].name == "Gray 50%" );
+
+        CPPUNIT_ASSERT( BuildMeasurementSeries("sat:5", config, patches, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)(11 + 6 * 5), patches.size() );
+        // full red saturation is the red primary
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, patches[11 + 4].rgb[1], 1e-6 );
+
+        CPPUNIT_ASSERT( BuildMeasurementSeries("cc:GCD", config, patches, error) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)(11 + 30 + 24), patches.size() );
+    }
+
+    void BadSeries()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches;
+        std::string error;
+
+        CPPUNIT_ASSERT( !BuildMeasurementSeries("gray:1", config, patches, error) );
+        CPPUNIT_ASSERT( !BuildMeasurementSeries("gray:x", config, patches, error) );
+        CPPUNIT_ASSERT( !BuildMeasurementSeries("cc:NONE", config, patches, error) );
+        CPPUNIT_ASSERT( !BuildMeasurementSeries("user:no such file.csv", config, patches, error) );
+        CPPUNIT_ASSERT( !BuildMeasurementSeries("ramp", config, patches, error) );
+        CPPUNIT_ASSERT( patches.empty() );
+        CPPUNIT_ASSERT( !error.empty() );
+    }
+
+    void SimulatedGrayscale()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches;
+        std::string error;
+        BuildMeasurementSeries("gray:21", config, patches, error);
+
+        CSimulatedDisplaySensor sensor(config.colorReference, 2.4, 100.0, 0.05);
+        CNullGenerator generator;
+        CMeasurementRunner runner(sensor, generator);
+
+        CPPUNIT_ASSERT( runner.Run(patches) );
+        const std::vector<MeasurementResult>& results = runner.GetResults();
+        CPPUNIT_ASSERT_EQUAL( patches.size(), results.size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.05, results[0].XYZ[1], 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, results[20].XYZ[1], 1e-9 );
+        for (size_t i = 1; i < results.size(); i++)
+        {
+            CPPUNIT_ASSERT( results[i].XYZ[1] > results[i - 1].XYZ[1] );
+        }
+
+        // the white chromaticity is the reference white
+        ColorxyY white(results[20].XYZ);
+        ColorxyY reference(config.colorReference.GetWhite());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( reference[0], white[0], 1e-6 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( reference[1], white[1], 1e-6 );
+
+        // a repeated seed repeats the errors
+        sensor.SetErrors(1.0, 0.01, 7);
+        runner.Run(patches);
+        double first = runner.GetResults()[10].XYZ[1];
+        sensor.SetErrors(1.0, 0.01, 7);
+        runner.Run(patches);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( first, runner.GetResults()[10].XYZ[1], 1e-12 );
+    }
+
+    void RunStopsOnGeneratorFailure()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches;
+        std::string error;
+        BuildMeasurementSeries("gray:11", config, patches, error);
+
+        CSimulatedDisplaySensor sensor(config.colorReference);
+        FailingGenerator generator(3);
+        CMeasurementRunner runner(sensor, generator);
+
+        CPPUNIT_ASSERT( !runner.Run(patches) );
+        CPPUNIT_ASSERT_EQUAL( (size_t)3, runner.GetResults().size() );
+        CPPUNIT_ASSERT( runner.GetLastError().find("Gray 30%") != std::string::npos );
+    }
+
+    void CgatsOutput()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches;
+        std::string error;
+        BuildMeasurementSeries("gray:5", config, patches, error);
+
+        CSimulatedDisplaySensor sensor(config.colorReference);
+        CNullGenerator generator;
+        CMeasurementRunner runner(sensor, generator);
+        runner.Run(patches);
+
+        std::ostringstream cgats;
+        runner.WriteCgats(cgats);
+        std::string text = cgats.str();
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, text.find("CGATS.17\n") );
+        CPPUNIT_ASSERT( text.find("NUMBER_OF_SETS 5\n") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("\n5 100.0000 100.0000 100.0000 ") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("END_DATA\n") != std::string::npos );
+
+        std::ostringstream csv;
+        runner.WriteCsv(csv);
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, csv.str().find("Name,R,G,B,X,Y,Z,DisplayMs,MeasureMs\nGray 0%,") );
+    }
+
+    void CsvQuotesLongNames()
+    {
+        MeasurementSeriesConfig config;
+        std::vector<MeasurementPatch> patches(1);
+        patches[0].name = std::string(2000, 'x') + ", \"red\"";
+        patches[0].rgb = ColorRGBDisplay(100.0, 0.0, 0.0);
+
+        CSimulatedDisplaySensor sensor(config.colorReference);
+        CNullGenerator generator;
+        CMeasurementRunner runner(sensor, generator);
+        CPPUNIT_ASSERT( runner.Run(patches) );
+
+        std::ostringstream csv;
+        runner.WriteCsv(csv);
+        std::string row = csv.str().substr(csv.str().find('\n') + 1);
+        std::string quoted = "\"" + std::string(2000, 'x') + ", \"\"red\"\"\",100.0000,0.0000,0.0000,";
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, row.find(quoted) );
+        // the fields after the name
+        CPPUNIT_ASSERT_EQUAL( 8, (int)std::count(row.begin() + quoted.find("\",100") + 1, row.end(), ',') );
+
+        std::ostringstream cgats;
+        runner.WriteCgats(cgats);
+        CPPUNIT_ASSERT( cgats.str().find("\n1 100.0000 0.0000 0.0000 ") != std::string::npos );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,128 @@
+#include "MeterCorrection.h"
+#include <math.h>
+#include <stdexcept>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE MeterCorrectionTestCase
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( ExactMatrix );
+    CPPUNIT_TEST( MatrixWithOffset );
+    CPPUNIT_TEST( NotEnoughPatches );
+    CPPUNIT_TEST( ReducesDeltaE );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+    }
+
+protected:
+    // readings of a meter whose error is the inverse of a known matrix
+    // and offset, on a grid of patches covering the gamut
+    void addPatches(CMeterCorrection& fit, const double matrix[3][3], const double offset[3])
+    {
+        for(int r(0); r < 5; ++r)
+        {
+            for(int g(0); g < 5; ++g)
+            {
+                for(int b(0); b < 5; ++b)
+                {
+                    ColorXYZ measured(r * 20.0 + 1.0, g * 20.0 + 1.0, b * 20.0 + 1.0);
+                    ColorXYZ reference(
+                        matrix[0][0] * measured[0] + matrix[0][1] * measured[1] + matrix[0][2] * measured[2] + offset[0],
+                        matrix[1][0] * measured[0] + matrix[1][1] * measured[1] + matrix[1][2] * measured[2] + offset[1],
+                        matrix[2][0] * measured[0] + matrix[2][1] * measured[1] + matrix[2][2] * measured[2] + offset[2]);
+                    fit.AddPatch(measured, reference);
+                }
+            }
+        }
+    }
+
+    void ExactMatrix()
+    {
+        const double matrix[3][3] = {
+                                        { 1.05,  0.03, -0.02 },
+                                        { 0.02,  0.97,  0.01 },
+                                        {-0.01,  0.04,  1.10 }
+                                    };
+        const double offset[3] = { 0.0, 0.0, 0.0 };
+
+        CMeterCorrection fit;
+        addPatches(fit, matrix, offset);
+        CPPUNIT_ASSERT_EQUAL( 125, fit.GetPatchCount() );
+
+        fit.Fit(ColorXYZ(95.047, 100.0, 108.883));
+
+        Matrix result(fit.GetMatrix());
+        for(int i(0); i < 3; ++i)
+        {
+            for(int j(0); j < 3; ++j)
+            {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL( matrix[i][j], result(i, j), 0.0001 );
+            }
+        }
+        CPPUNIT_ASSERT( fit.GetMaxDeltaE() < 0.01 );
+    }
+
+    void MatrixWithOffset()
+    {
+        const double matrix[3][3] = {
+                                        { 0.98, -0.02,  0.05 },
+                                        { 0.01,  1.02,  0.00 },
+                                        { 0.00, -0.03,  0.95 }
+                                    };
+        const double offset[3] = { 0.05, 0.04, 0.08 };
+
+        CMeterCorrection fit;
+        addPatches(fit, matrix, offset);
+        fit.Fit(ColorXYZ(95.047, 100.0, 108.883), true);
+
+        ColorXYZ resultOffset(fit.GetOffset());
+        for(int i(0); i < 3; ++i)
+        {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( offset[i], resultOffset[i], 0.001 );
+        }
+
+        ColorXYZ test(fit.Apply(ColorXYZ(50.0, 40.0, 30.0)));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.98 * 50.0 - 0.02 * 40.0 + 0.05 * 30.0 + 0.05, test[0], 0.001 );
+        CPPUNIT_ASSERT( fit.GetMaxDeltaE() < 0.01 );
+    }
+
+    void NotEnoughPatches()
+    {
+        CMeterCorrection fit;
+        fit.AddPatch(ColorXYZ(41.0, 21.0, 2.0), ColorXYZ(41.2, 21.3, 1.9));
+        fit.AddPatch(ColorXYZ(36.0, 72.0, 12.0), ColorXYZ(35.8, 71.5, 11.9));
+        CPPUNIT_ASSERT_THROW( fit.Fit(ColorXYZ(95.047, 100.0, 108.883)), std::logic_error );
+    }
+
+    // a meter error no matrix can undo: the dE2000 refinement must improve
+    // on the starting linear fit
+    void ReducesDeltaE()
+    {
+        const ColorXYZ white(95.047, 100.0, 108.883);
+        CMeterCorrection fit;
+        for(int i(0); i < 200; ++i)
+        {
+            ColorXYZ reference(1.0 + 90.0 * fabs(sin(i * 1.3)), 1.0 + 95.0 * fabs(sin(i * 0.7 + 1.0)), 1.0 + 100.0 * fabs(sin(i * 2.1 + 2.0)));
+            ColorXYZ measured(reference[0] * (1.0 + 0.03 * sin(i * 0.37)), reference[1] * 1.02 + 0.01 * reference[0], reference[2] * (0.97 + 0.0004 * reference[2]));
+            fit.AddPatch(measured, reference);
+        }
+
+        fit.Fit(white, false, 0);
+        double linearDeltaE = fit.GetAverageDeltaE();
+        double linearMaxDeltaE = fit.GetMaxDeltaE();
+        CPPUNIT_ASSERT_EQUAL( 0, fit.GetIterations() );
+
+        fit.Fit(white);
+        CPPUNIT_ASSERT( fit.GetIterations() > 0 );
+        CPPUNIT_ASSERT( fit.GetAverageDeltaE() < linearDeltaE );
+        CPPUNIT_ASSERT( fit.GetMaxDeltaE() < linearMaxDeltaE * 0.95 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(THIS_TEST_CASE);
@@ -0,0 +1,206 @@
+#include "PGeneratorClient.h"
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// The mock generator uses BSD sockets and pthreads directly, so like the
+// serial session tests these only run on the POSIX backend
+#if !defined(LIBHCFR_HAS_WIN32_API)
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#define THIS_TEST_CASE PGeneratorClientTestCase
+
+namespace
+{
+    // Answers like a PGenerator on the loopback interface, after
+    // nDelayMs as if drawing the pattern: the resolution to
+    // CMD:GET_RESOLUTION, an error to BAD, OK to anything else.
+    // DROP closes the connection without a reply.
+    struct MockPGenerator
+    {
+        int fdListen;
+        int nPort;
+        int nDelayMs;
+        int nConnections;
+        std::vector<std::string> commands;
+        pthread_mutex_t mutex;
+        pthread_t thread;
+
+        static void* threadFunc(void* pParam)
+        {
+            MockPGenerator* pServer = (MockPGenerator*)pParam;
+            int fd;
+            while((fd = accept(pServer->fdListen, NULL, NULL)) >= 0)
+            {
+                ++pServer->nConnections;
+                pServer->serve(fd);
+                close(fd);
+            }
+            return 0;
+        }
+
+        void serve(int fd)
+        {
+            std::string input;
+            char buffer[256];
+            int nRead;
+            while((nRead = (int)read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                input.append(buffer, nRead);
+                size_t nEnd;
+                while((nEnd = input.find("\x02\r")) != std::string::npos)
+                {
+                    std::string command(input, 0, nEnd);
+                    input.erase(0, nEnd + 2);
+                    pthread_mutex_lock(&mutex);
+                    commands.push_back(command);
+                    pthread_mutex_unlock(&mutex);
+
+                    if(command == "DROP" || command == "QUIT")
+                    {
+                        return;
+                    }
+                    usleep(nDelayMs * 1000);
+                    std::string reply("OK");
+                    if(command == "CMD:GET_RESOLUTION")
+                    {
+                        reply = "OK:1920x1080";
+                    }
+                    else if(command == "BAD")
+                    {
+                        reply = "ERR:unknown command";
+                    }
+                    reply += "\x02\r";
+                    write(fd, reply.c_str(), reply.size());
+                }
+            }
+        }
+    };
+
+    int msecSince(const struct timeval& start)
+    {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        return (int)((now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000);
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( GetAfterPipelinedSends );
+    CPPUNIT_TEST( SendDoesNotWaitForReply );
+    CPPUNIT_TEST( ErrorReplyIsCounted );
+    CPPUNIT_TEST( ReconnectAfterDrop );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        m_server.nDelayMs = 0;
+        m_server.nConnections = 0;
+        m_server.commands.clear();
+        pthread_mutex_init(&m_server.mutex, NULL);
+
+        m_server.fdListen = socket(AF_INET, SOCK_STREAM, 0);
+        CPPUNIT_ASSERT( m_server.fdListen >= 0 );
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        CPPUNIT_ASSERT( bind(m_server.fdListen, (struct sockaddr*)&addr, sizeof(addr)) == 0 );
+        CPPUNIT_ASSERT( listen(m_server.fdListen, 4) == 0 );
+        socklen_t nSize = sizeof(addr);
+        getsockname(m_server.fdListen, (struct sockaddr*)&addr, &nSize);
+        m_server.nPort = ntohs(addr.sin_port);
+        CPPUNIT_ASSERT( pthread_create(&m_server.thread, NULL, MockPGenerator::threadFunc, &m_server) == 0 );
+    }
+
+    void tearDown()
+    {
+        m_client.Close();
+        // accept() fails once the listening socket is shut down
+        shutdown(m_server.fdListen, SHUT_RDWR);
+        close(m_server.fdListen);
+        pthread_join(m_server.thread, NULL);
+        pthread_mutex_destroy(&m_server.mutex);
+    }
+
+protected:
+    void GetAfterPipelinedSends()
+    {
+        std::string reply;
+
+        CPPUNIT_ASSERT( m_client.Connect("127.0.0.1", m_server.nPort) );
+        for(int i(0); i < 5; ++i)
+        {
+            CPPUNIT_ASSERT( m_client.Send("RGB=RECTANGLE;100,100;100;255,255,255;0,0,0;-1,-1") );
+        }
+        CPPUNIT_ASSERT( m_client.Get("CMD:GET_RESOLUTION", reply) );
+        CPPUNIT_ASSERT_EQUAL( std::string("OK:1920x1080"), reply );
+        CPPUNIT_ASSERT_EQUAL( 0, m_client.GetPendingCount() );
+        CPPUNIT_ASSERT_EQUAL( 0, m_client.GetErrorCount() );
+        CPPUNIT_ASSERT_EQUAL( 6, (int)m_server.commands.size() );
+    }
+
+    void SendDoesNotWaitForReply()
+    {
+        const int nCommands = 10;
+        m_server.nDelayMs = 50;
+        struct timeval start;
+
+        CPPUNIT_ASSERT( m_client.Connect("127.0.0.1", m_server.nPort) );
+        gettimeofday(&start, NULL);
+        for(int i(0); i < nCommands; ++i)
+        {
+            CPPUNIT_ASSERT( m_client.Send("TESTTEMPLATERAMDISK:HCFR:128,128,128;0,0,0") );
+        }
+        // a synchronous client would have waited for every reply by now
+        CPPUNIT_ASSERT( msecSince(start) < nCommands * m_server.nDelayMs / 2 );
+        CPPUNIT_ASSERT( m_client.GetPendingCount() > 0 );
+
+        CPPUNIT_ASSERT( m_client.WaitForReplies(5000) );
+        CPPUNIT_ASSERT_EQUAL( 0, m_client.GetPendingCount() );
+        CPPUNIT_ASSERT( msecSince(start) >= nCommands * m_server.nDelayMs );
+    }
+
+    void ErrorReplyIsCounted()
+    {
+        CPPUNIT_ASSERT( m_client.Connect("127.0.0.1", m_server.nPort) );
+        CPPUNIT_ASSERT( m_client.Send("BAD") );
+        CPPUNIT_ASSERT( m_client.Send("RGB=RECTANGLE;100,100;100;0,0,0;0,0,0;-1,-1") );
+        CPPUNIT_ASSERT( m_client.WaitForReplies(2000) );
+        CPPUNIT_ASSERT_EQUAL( 1, m_client.GetErrorCount() );
+        CPPUNIT_ASSERT_EQUAL( std::string("ERR:unknown command"), m_client.GetLastError() );
+    }
+
+    void ReconnectAfterDrop()
+    {
+        std::string reply;
+
+        CPPUNIT_ASSERT( m_client.Connect("127.0.0.1", m_server.nPort) );
+        CPPUNIT_ASSERT( m_client.Send("DROP") );
+        // let the hang up arrive, as it would between two patches
+        usleep(50000);
+        CPPUNIT_ASSERT( m_client.Get("CMD:GET_RESOLUTION", reply) );
+        CPPUNIT_ASSERT_EQUAL( std::string("OK:1920x1080"), reply );
+        CPPUNIT_ASSERT_EQUAL( 2, m_server.nConnections );
+    }
+
+private:
+    MockPGenerator m_server;
+    CPGeneratorClient m_client;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
+
+#endif
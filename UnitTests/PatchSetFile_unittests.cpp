@@ -0,0 +1,134 @@
+#include "PatchSetFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE PatchSetFileTestCase
+
+namespace
+{
+    const char* szPatchFile = "patchset_unittest.csv";
+
+    bool parse(CPatchSetFile& patchSet, const char* szData)
+    {
+        return patchSet.Parse(szData, strlen(szData));
+    }
+
+    void writeFile(const char* szPath, const char* szData)
+    {
+        FILE* pFile = fopen(szPath, "wb");
+        fwrite(szData, 1, strlen(szData), pFile);
+        fclose(pFile);
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( VideoLevels );
+    CPPUNIT_TEST( Percents );
+    CPPUNIT_TEST( Cgats );
+    CPPUNIT_TEST( ErrorsByLine );
+    CPPUNIT_TEST( CacheFollowsFile );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void VideoLevels()
+    {
+        CPatchSetFile patchSet;
+        CPPUNIT_ASSERT( parse(patchSet, "16,16,16,0 Black,CM 5-Point Luminance\r\n235,235,235,100 White,\r\n,,,\r\n") );
+        CPPUNIT_ASSERT_EQUAL( CPatchSetFile::FORMAT_8BIT, patchSet.GetFormat() );
+        CPPUNIT_ASSERT_EQUAL( 2, patchSet.GetSize() );
+        CPPUNIT_ASSERT( patchSet.GetName(1) == "100 White" );
+        CPPUNIT_ASSERT( patchSet.GetDescription() == "CM 5-Point Luminance" );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, patchSet.GetColors()[1][2], 1e-9 );
+
+        CPPUNIT_ASSERT( parse(patchSet, "64,502,940\n") );
+        CPPUNIT_ASSERT_EQUAL( CPatchSetFile::FORMAT_10BIT, patchSet.GetFormat() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 50.0, patchSet.GetColors()[0][1], 1e-9 );
+
+        // all levels below 256 still read as 10-bit when asked to
+        CPPUNIT_ASSERT( parse(patchSet, "# format 10bit\n64,64,64\n") );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, patchSet.GetColors()[0][0], 1e-9 );
+    }
+
+    void Percents()
+    {
+        CPatchSetFile patchSet;
+        CPPUNIT_ASSERT( parse(patchSet, "\xEF\xBB\xBF" "50.0, 25, 75\n100%,0%,1e1%,Named\n") );
+        CPPUNIT_ASSERT_EQUAL( CPatchSetFile::FORMAT_PERCENT, patchSet.GetFormat() );
+        CPPUNIT_ASSERT_EQUAL( 2, patchSet.GetSize() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 25.0, patchSet.GetColors()[0][1], 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0, patchSet.GetColors()[1][2], 1e-9 );
+        CPPUNIT_ASSERT( patchSet.GetName(1) == "Named" );
+    }
+
+    void Cgats()
+    {
+        CPatchSetFile patchSet;
+        CPPUNIT_ASSERT( parse(patchSet,
+            "CTI1\n"
+            "DESCRIPTOR \"Argyll patches\"\n"
+            "NUMBER_OF_FIELDS 4\n"
+            "BEGIN_DATA_FORMAT\n"
+            "SAMPLE_ID RGB_R RGB_G RGB_B\n"
+            "END_DATA_FORMAT\n"
+            "NUMBER_OF_SETS 2\n"
+            "BEGIN_DATA\n"
+            "1 100.00 100.00 100.00\n"
+            "2 0.0 50.0 12.5 # comment\n"
+            "END_DATA\n") );
+        CPPUNIT_ASSERT_EQUAL( CPatchSetFile::FORMAT_CGATS, patchSet.GetFormat() );
+        CPPUNIT_ASSERT_EQUAL( 2, patchSet.GetSize() );
+        CPPUNIT_ASSERT( patchSet.GetDescription() == "Argyll patches" );
+        CPPUNIT_ASSERT( patchSet.GetName(1) == "2" );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 12.5, patchSet.GetColors()[1][2], 1e-9 );
+
+        CPPUNIT_ASSERT( !parse(patchSet, "CTI1\nBEGIN_DATA_FORMAT\nSAMPLE_ID XYZ_X\nEND_DATA_FORMAT\nBEGIN_DATA\n1 2\nEND_DATA\n") );
+        CPPUNIT_ASSERT_EQUAL( 5, patchSet.GetErrors()[0].line );
+    }
+
+    void ErrorsByLine()
+    {
+        CPatchSetFile patchSet;
+        CPPUNIT_ASSERT( !parse(patchSet, "16,16,16\n# comment\n16,x,16\n16,16\n300,16,16\n") );
+        CPPUNIT_ASSERT_EQUAL( 0, patchSet.GetSize() );
+        CPPUNIT_ASSERT_EQUAL( (size_t)2, patchSet.GetErrors().size() );
+        CPPUNIT_ASSERT_EQUAL( 3, patchSet.GetErrors()[0].line );
+        CPPUNIT_ASSERT_EQUAL( 4, patchSet.GetErrors()[1].line );
+        // 300 makes the file 10-bit, where 16 is below black but allowed
+        CPPUNIT_ASSERT_EQUAL( CPatchSetFile::FORMAT_10BIT, patchSet.GetFormat() );
+
+        CPPUNIT_ASSERT( !parse(patchSet, "# format 8bit\n16,16,16\n16,16,256\n") );
+        CPPUNIT_ASSERT_EQUAL( 3, patchSet.GetErrors()[0].line );
+        CPPUNIT_ASSERT( patchSet.GetErrorString().find("line 3: ") == 0 );
+    }
+
+    void CacheFollowsFile()
+    {
+        ColorRGBDisplay colors[4];
+        CPPUNIT_ASSERT_EQUAL( -1, CPatchSetFile::ReadCachedColors(szPatchFile, colors, 4) );
+
+        writeFile(szPatchFile, "16,16,16\n235,235,235\n");
+        CPPUNIT_ASSERT_EQUAL( 2, CPatchSetFile::ReadCachedColors(szPatchFile, colors, 4) );
+        CPPUNIT_ASSERT_EQUAL( 1, CPatchSetFile::ReadCachedColors(szPatchFile, colors, 1) );
+
+        // a new size is seen even within the same second
+        writeFile(szPatchFile, "16,16,16\n126,126,126\n235,235,235\n");
+        CPPUNIT_ASSERT_EQUAL( 3, CPatchSetFile::ReadCachedColors(szPatchFile, colors, 4) );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0 * 110 / 219, colors[1][0], 1e-9 );
+
+        writeFile(szPatchFile, "16,16,16\n126,126\n235,235,235\n");
+        CPatchSetFile patchSet;
+        CPPUNIT_ASSERT( !CPatchSetFile::ReadCached(szPatchFile, patchSet) );
+        CPPUNIT_ASSERT_EQUAL( 2, patchSet.GetErrors()[0].line );
+
+        remove(szPatchFile);
+        CPPUNIT_ASSERT_EQUAL( -1, CPatchSetFile::ReadCachedColors(szPatchFile, colors, 4) );
+        CPatchSetFile::ClearCache();
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
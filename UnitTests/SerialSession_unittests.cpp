@@ -0,0 +1,135 @@
+#include "SerialSession.h"
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// The fake device sits on the master side of a pseudo terminal, which
+// only exists on the termios backend
+#if !defined(LIBHCFR_HAS_WIN32_API)
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THIS_TEST_CASE SerialSessionTestCase
+
+namespace
+{
+    // Answers like an HCFR probe: the version string to 0xFF, a
+    // measure line to anything else, and nothing to 0x00.
+    // The measure line is sent in small pieces to exercise framing.
+    struct FakeKiDevice
+    {
+        int fdMaster;
+        int nCommands;
+        pthread_t thread;
+
+        static void* threadFunc(void* pParam)
+        {
+            FakeKiDevice* pDevice = (FakeKiDevice*)pParam;
+            unsigned char command;
+            while(read(pDevice->fdMaster, &command, 1) == 1)
+            {
+                ++pDevice->nCommands;
+                if(command == 0xFF)
+                {
+                    const char reply[] = "v5.20\r";
+                    write(pDevice->fdMaster, reply, strlen(reply));
+                }
+                else if(command != 0x00)
+                {
+                    const char reply[] = "RGB_2:000 030 255 156 089 034\r";
+                    for(size_t i(0); i < strlen(reply); i += 7)
+                    {
+                        size_t n = strlen(reply) - i < 7 ? strlen(reply) - i : 7;
+                        write(pDevice->fdMaster, reply + i, n);
+                        usleep(2000);
+                    }
+                }
+            }
+            return 0;
+        }
+    };
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( VersionQuery );
+    CPPUNIT_TEST( ReplyInSeveralBlocks );
+    CPPUNIT_TEST( TimeoutKeepsSession );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp()
+    {
+        m_device.nCommands = 0;
+        m_device.fdMaster = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT( m_device.fdMaster != -1 );
+        CPPUNIT_ASSERT( grantpt(m_device.fdMaster) == 0 );
+        CPPUNIT_ASSERT( unlockpt(m_device.fdMaster) == 0 );
+        m_slaveName = ptsname(m_device.fdMaster);
+        CPPUNIT_ASSERT( pthread_create(&m_device.thread, NULL, FakeKiDevice::threadFunc, &m_device) == 0 );
+    }
+
+    void tearDown()
+    {
+        m_session.Close();
+        // the device thread leaves its read loop once the master is gone
+        pthread_cancel(m_device.thread);
+        pthread_join(m_device.thread, NULL);
+        close(m_device.fdMaster);
+    }
+
+protected:
+    void VersionQuery()
+    {
+        char reply[256];
+        const unsigned char command = 0xFF;
+
+        CPPUNIT_ASSERT( m_session.Open(m_slaveName.c_str(), 115200) );
+        CPPUNIT_ASSERT_EQUAL( CSerialSession::READ_OK, m_session.Transact(&command, 1, reply, sizeof(reply), '\r', 2000) );
+        CPPUNIT_ASSERT_EQUAL( std::string("v5.20"), std::string(reply) );
+    }
+
+    void ReplyInSeveralBlocks()
+    {
+        char reply[256];
+        const unsigned char command = 0x41;
+
+        CPPUNIT_ASSERT( m_session.Open(m_slaveName.c_str(), 115200) );
+        for(int i(0); i < 3; ++i)
+        {
+            CPPUNIT_ASSERT_EQUAL( CSerialSession::READ_OK, m_session.Transact(&command, 1, reply, sizeof(reply), '\r', 2000) );
+            CPPUNIT_ASSERT_EQUAL( std::string("RGB_2:000 030 255 156 089 034"), std::string(reply) );
+        }
+
+        // too small a buffer is reported, not overrun
+        CPPUNIT_ASSERT_EQUAL( CSerialSession::READ_OVERFLOW, m_session.Transact(&command, 1, reply, 8, '\r', 2000) );
+        CPPUNIT_ASSERT_EQUAL( std::string("RGB_2:0"), std::string(reply) );
+    }
+
+    void TimeoutKeepsSession()
+    {
+        char reply[256];
+        const unsigned char silent = 0x00;
+        const unsigned char command = 0xFF;
+
+        CPPUNIT_ASSERT( m_session.Open(m_slaveName.c_str(), 115200) );
+        CPPUNIT_ASSERT_EQUAL( CSerialSession::READ_TIMEOUT, m_session.Transact(&silent, 1, reply, sizeof(reply), '\r', 100) );
+        CPPUNIT_ASSERT( m_session.IsOpen() );
+        CPPUNIT_ASSERT_EQUAL( CSerialSession::READ_OK, m_session.Transact(&command, 1, reply, sizeof(reply), '\r', 2000) );
+        CPPUNIT_ASSERT_EQUAL( std::string("v5.20"), std::string(reply) );
+        CPPUNIT_ASSERT_EQUAL( 2, m_device.nCommands );
+    }
+
+private:
+    FakeKiDevice m_device;
+    std::string m_slaveName;
+    CSerialSession m_session;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
+
+#endif
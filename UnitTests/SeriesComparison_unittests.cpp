@@ -0,0 +1,94 @@
+#include "SeriesComparison.h"
+#include <math.h>
+#include <sstream>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE SeriesComparisonTestCase
+
+namespace
+{
+    // a display with the reference white and primaries, a power law
+    // grayscale and the blue of its grays scaled by blueGain
+    ComparedMeasures makeMeasures(const char* name, double gamma, double blueGain)
+    {
+        CColorReference reference(HDTV);
+        ComparedMeasures measures;
+        measures.name = name;
+        for (int i = 0; i <= 10; i++)
+        {
+            double Y = 100.0 * pow(i / 10.0, gamma);
+            ColorXYZ white = reference.GetWhite();
+            measures.series[COMPARE_GRAYSCALE].push_back(ColorXYZ(white[0] * Y, white[1] * Y, white[2] * Y * blueGain));
+        }
+        measures.series[COMPARE_PRIMARIES].push_back(reference.GetRed());
+        measures.series[COMPARE_PRIMARIES].push_back(reference.GetGreen());
+        measures.series[COMPARE_PRIMARIES].push_back(ColorXYZ());
+        measures.grayWhiteY = 100.0;
+        measures.colorWhiteY = 1.0;
+        measures.gamma = gamma;
+        return measures;
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( AgainstReference );
+    CPPUNIT_TEST( Table );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void AgainstReference()
+    {
+        CSeriesComparison comparison(CColorReference(HDTV), 0, 0);
+        comparison.Add(makeMeasures("reference", 2.2, 1.0));
+        comparison.Add(makeMeasures("same", 2.2, 1.0));
+        comparison.Add(makeMeasures("bluer", 2.4, 1.1));
+        comparison.Compute(0, 2);
+
+        CPPUNIT_ASSERT_EQUAL( (size_t)(3 * COMPARE_SERIES_COUNT), comparison.GetResults().size() );
+        const SeriesComparisonResult* reference = comparison.GetResult(0, COMPARE_GRAYSCALE);
+        CPPUNIT_ASSERT_EQUAL( 11, reference->nPatches );
+        CPPUNIT_ASSERT_EQUAL( 0, reference->nCompared );
+        CPPUNIT_ASSERT( reference->colorTemp > 6000.0 && reference->colorTemp < 7000.0 );
+
+        const SeriesComparisonResult* same = comparison.GetResult(1, COMPARE_GRAYSCALE);
+        CPPUNIT_ASSERT_EQUAL( 11, same->nCompared );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, same->dEMax, 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, same->dGamma, 1e-12 );
+
+        const SeriesComparisonResult* bluer = comparison.GetResult(2, COMPARE_GRAYSCALE);
+        CPPUNIT_ASSERT( bluer->dEAvg > 1.0 );
+        CPPUNIT_ASSERT( bluer->dEMax >= bluer->dEAvg );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, bluer->dGamma, 1e-12 );
+        CPPUNIT_ASSERT( bluer->dColorTemp > 0.0 );
+
+        // the unmeasured blue is neither counted nor compared
+        const SeriesComparisonResult* primaries = comparison.GetResult(2, COMPARE_PRIMARIES);
+        CPPUNIT_ASSERT_EQUAL( 2, primaries->nPatches );
+        CPPUNIT_ASSERT_EQUAL( 2, primaries->nCompared );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, primaries->dEMax, 1e-9 );
+
+        CPPUNIT_ASSERT( comparison.GetResult(3, COMPARE_GRAYSCALE) == NULL );
+    }
+
+    void Table()
+    {
+        CSeriesComparison comparison(CColorReference(HDTV), 0, 0);
+        comparison.Add(makeMeasures("panel \"A\", left", 2.2, 1.0));
+        comparison.Add(makeMeasures("panel B", 2.4, 1.0));
+        comparison.Compute(1);
+
+        std::ostringstream table;
+        comparison.WriteTable(table);
+        std::string text = table.str();
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, text.find("Document,Series,Patches,Compared,dE avg,dE max,Gamma,ColorTemp,dGamma,dColorTemp\n") );
+        CPPUNIT_ASSERT( text.find("\n\"panel \"\"A\"\", left\",Grayscale,11,11,") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("\n\"panel B (reference)\",Primaries,2,0,") != std::string::npos );
+        // series without patches are left out
+        CPPUNIT_ASSERT( text.find("Near black") == std::string::npos );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -0,0 +1,87 @@
+#include "TraceLog.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <cppunit/config/SourcePrefix.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#define THIS_TEST_CASE TraceLogTestCase
+
+namespace
+{
+    void measurePatch()
+    {
+        HCFR_TRACE_SPAN("patch", "measure");
+        {
+            HCFR_TRACE_SPAN("settle", "generator");
+        }
+        HCFR_TRACE_SPAN("read", "sensor");
+    }
+}
+
+class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
+    CPPUNIT_TEST( NothingRecordedWhenStopped );
+    CPPUNIT_TEST( SummaryCountsSpans );
+    CPPUNIT_TEST( ChromeTraceEvents );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void NothingRecordedWhenStopped()
+    {
+        CTraceLog::Start();
+        CTraceLog::Stop();
+        for (int i = 0; i < 1000; i++)
+        {
+            measurePatch();
+        }
+        std::ostringstream summary;
+        CTraceLog::WriteSummary(summary);
+        CPPUNIT_ASSERT( summary.str().find("patch") == std::string::npos );
+    }
+
+    void SummaryCountsSpans()
+    {
+        CTraceLog::Start();
+        for (int i = 0; i < 10; i++)
+        {
+            measurePatch();
+        }
+        CTraceLog::Stop();
+        // spans ending after Stop() are not recorded
+        measurePatch();
+
+        std::ostringstream summary;
+        CTraceLog::WriteSummary(summary);
+        std::string text = summary.str();
+        CPPUNIT_ASSERT( text.find("measure    patch") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("generator  settle") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("sensor     read") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("      10 ") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("      11 ") == std::string::npos );
+    }
+
+    void ChromeTraceEvents()
+    {
+        CTraceLog::Start();
+        measurePatch();
+        CTraceLog::Stop();
+
+        const char* path = "TraceLog_unittests.json";
+        CPPUNIT_ASSERT( CTraceLog::WriteChromeTrace(path) );
+        std::ifstream in(path);
+        std::stringstream json;
+        json << in.rdbuf();
+        in.close();
+        remove(path);
+
+        std::string text = json.str();
+        CPPUNIT_ASSERT_EQUAL( (size_t)0, text.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") );
+        CPPUNIT_ASSERT( text.find("{\"name\":\"settle\",\"cat\":\"generator\",\"ph\":\"X\",\"ts\":") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("{\"name\":\"patch\",\"cat\":\"measure\",\"ph\":\"X\",\"ts\":") != std::string::npos );
+        CPPUNIT_ASSERT( text.find("\n]}\n") != std::string::npos );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( THIS_TEST_CASE );
@@ -1,6 +1,9 @@
 #include <cppunit/config/SourcePrefix.h>
 #include <cppunit/extensions/HelperMacros.h>
 #include <numsup.h>
+// as the spectro library is built, xsp2cie is laid out accordingly
+#define SALONEINSTLIB
+#include <xspect.h>
 
 #define THIS_TEST_CASE SpectroTestCase
 
@@ -8,6 +11,8 @@ class THIS_TEST_CASE : public CPPUNIT_NS::TestFixture
 {
     CPPUNIT_TEST_SUITE(THIS_TEST_CASE);
     CPPUNIT_TEST( floatConversion );
+    CPPUNIT_TEST( batchConversion );
+    CPPUNIT_TEST( multiObserverConversion );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -24,6 +29,91 @@ protected:
         double result = IEEE754todouble(1034279276);
         CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.080981105566024780, result, 0.00000000000001 );
     }
+
+    // bconvert() must give exactly what convert() gives, for linearly
+    // and poly3 interpolated samplings, emissive or not, and when the
+    // sampling changes from one spectrum to the next
+    void batchConversion()
+    {
+        const int nSpectra = 6;
+        xspect spectra[nSpectra];
+        const int bands[nSpectra] = { 41, 41, 401, 36, 41, 2 };
+        const double shortWl[nSpectra] = { 380.0, 380.0, 380.0, 380.0, 380.0, 550.0 };
+        const double longWl[nSpectra] = { 780.0, 780.0, 780.0, 730.0, 780.0, 555.0 };
+        unsigned int seed = 12345;
+
+        for (int i = 0; i < nSpectra; i++)
+        {
+            XSPECT_SET_INFO(&spectra[i], bands[i], shortWl[i], longWl[i], i == 1 ? 2.5 : 1.0);
+            for (int j = 0; j < bands[i]; j++)
+            {
+                seed = seed * 1103515245u + 12345u;
+                spectra[i].spec[j] = (double)((seed >> 8) & 0xffff) / 6553.6;
+            }
+        }
+
+        const icxObserverType observers[3] = { icxOT_CIE_1931_2, icxOT_CIE_1964_10, icxOT_CIE_2012_2 };
+        const icxIllumeType illuminants[2] = { icxIT_none, icxIT_D50 };
+        for (int ob = 0; ob < 3; ob++)
+        {
+            for (int il = 0; il < 2; il++)
+            {
+                xsp2cie* conv = new_xsp2cie(illuminants[il], 0.0, NULL, observers[ob], NULL, icSigXYZData, icxClamp);
+                CPPUNIT_ASSERT( conv != NULL );
+
+                double batched[nSpectra][3];
+                CPPUNIT_ASSERT_EQUAL( 0, conv->bconvert(conv, batched, spectra, nSpectra) );
+                for (int i = 0; i < nSpectra; i++)
+                {
+                    double single[3];
+                    conv->convert(conv, single, &spectra[i]);
+                    for (int j = 0; j < 3; j++)
+                    {
+                        CPPUNIT_ASSERT_EQUAL( single[j], batched[i][j] );
+                    }
+                }
+                conv->del(conv);
+            }
+        }
+    }
+
+    // every spectrum converted under every observer, indexed [ob * nSpectra + i]
+    void multiObserverConversion()
+    {
+        const int nSpectra = 4;
+        xspect spectra[nSpectra];
+        unsigned int seed = 54321;
+
+        for (int i = 0; i < nSpectra; i++)
+        {
+            XSPECT_SET_INFO(&spectra[i], 41, 380.0, 780.0, 1.0);
+            for (int j = 0; j < 41; j++)
+            {
+                seed = seed * 1103515245u + 12345u;
+                spectra[i].spec[j] = (double)((seed >> 8) & 0xffff) / 6553.6;
+            }
+        }
+
+        icxObserverType observers[3] = { icxOT_CIE_1931_2, icxOT_CIE_1964_10, icxOT_CIE_2012_10 };
+        double xyz[3 * nSpectra][3];
+        CPPUNIT_ASSERT_EQUAL( 0, icx_spN2XYZ_multi(xyz, observers, 3, spectra, nSpectra) );
+
+        for (int ob = 0; ob < 3; ob++)
+        {
+            xsp2cie* conv = new_xsp2cie(icxIT_none, 0.0, NULL, observers[ob], NULL, icSigXYZData, icxNoClamp);
+            CPPUNIT_ASSERT( conv != NULL );
+            for (int i = 0; i < nSpectra; i++)
+            {
+                double single[3];
+                conv->convert(conv, single, &spectra[i]);
+                for (int j = 0; j < 3; j++)
+                {
+                    CPPUNIT_ASSERT_EQUAL( single[j], xyz[ob * nSpectra + i][j] );
+                }
+            }
+            conv->del(conv);
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(THIS_TEST_CASE);
@@ -46,6 +46,10 @@ extern void DrawDeltaECurve(CDC* pDC, int cxMax, int cyMax, double DeltaE, BOOL
 #define FX_MINSIZETOSHOW_TRIANGLEDETAILS 100
 #define FX_MINSIZETOSHOW_REFDETAILS 300
 
+// Full quality background once resizing pauses for this many milliseconds
+#define CIE_RESIZE_TIMER	1
+#define CIE_RESIZE_DELAY	200
+
 /////////////////////////////////////////////////////////////////////////////
 // CCIEGraphPoint
 
@@ -157,15 +161,40 @@ CCIEChartGrapher::CCIEChartGrapher()
 	m_DeltaY = 0;
 	dE10 = 0.;
 	isSat = FALSE;
+
+	m_bgSize = CSize(0,0);
+	m_bgWhiteBkgnd = FALSE;
+	m_bgDraft = FALSE;
+	m_bgOptions = 0;
+	m_bgChartsVersion = 0;
+	m_bgWhitex = 0.;
+	m_bgWhitey = 0.;
 }
 
 std::vector <COLORREF> stRGB,eRGB;
 
-void CCIEChartGrapher::MakeBgBitmap(CRect rect, BOOL bWhiteBkgnd)	// Create background bitmap
+void CCIEChartGrapher::MakeBgBitmap(CRect rect, BOOL bWhiteBkgnd, BOOL bDraft)	// Create background bitmap
 {
     int		i;
 	CDC		ScreenDC;
 	
+	// Stretching the 1400x1000 charts is the costly part: do it only when something drawn here changed
+	DWORD dwOptions = ( m_doDisplayBackground ? 0x0001 : 0 ) | ( m_doDisplayDeltaERef ? 0x0002 : 0 ) | ( m_bCIEuv ? 0x0004 : 0 ) | ( m_bCIEab ? 0x0008 : 0 );
+	ColorxyY WhiteRef = GetColorReference().GetWhite();
+	UINT nChartsVersion = GetColorApp() -> m_nCIEBitmapsVersion;
+
+	if ( m_bgBitmap.m_hObject && m_bgSize == rect.Size() && m_bgWhiteBkgnd == bWhiteBkgnd && m_bgOptions == dwOptions
+		&& m_bgChartsVersion == nChartsVersion && m_bgWhitex == WhiteRef[0] && m_bgWhitey == WhiteRef[1] && ( bDraft || ! m_bgDraft ) )
+		return;
+
+	m_bgSize = rect.Size();
+	m_bgWhiteBkgnd = bWhiteBkgnd;
+	m_bgDraft = bDraft;
+	m_bgOptions = dwOptions;
+	m_bgChartsVersion = nChartsVersion;
+	m_bgWhitex = WhiteRef[0];
+	m_bgWhitey = WhiteRef[1];
+
 	ScreenDC.CreateDC ( "DISPLAY", NULL, NULL, NULL );
 
     CDC bgDC;
@@ -219,7 +248,7 @@ void CCIEChartGrapher::MakeBgBitmap(CRect rect, BOOL bWhiteBkgnd)	// Create back
 				pOld = memDC.SelectObject( & GetColorApp() -> m_chartBitmap );
 		}
 
-		bgDC.SetStretchBltMode(HALFTONE);
+		bgDC.SetStretchBltMode(bDraft?COLORONCOLOR:HALFTONE);
 		SetBrushOrgEx(bgDC, 0,0, NULL);
 		bgDC.StretchBlt(0,0,rect.right,rect.bottom,&memDC,0,0,bm.bmWidth,bm.bmHeight,SRCCOPY);
 	    memDC.SelectObject(pOld);
@@ -292,7 +321,7 @@ void CCIEChartGrapher::MakeBgBitmap(CRect rect, BOOL bWhiteBkgnd)	// Create back
 		bgDC.SelectObject(&m_gamutBitmap);
 		GetColorApp() -> m_lightenChartBitmap.GetBitmap(&bm);
 		CBitmap* pOld = memDC.SelectObject(m_bCIEab ? & GetColorApp() -> m_lightenChartBitmap_ab: (m_bCIEuv ? & GetColorApp() -> m_lightenChartBitmap_uv : & GetColorApp() -> m_lightenChartBitmap));
-		bgDC.SetStretchBltMode(HALFTONE);
+		bgDC.SetStretchBltMode(bDraft?COLORONCOLOR:HALFTONE);
 		SetBrushOrgEx(bgDC, 0,0, NULL);
 
 		bgDC.StretchBlt(0,0,rect.right,rect.bottom,&memDC,0,0,bm.bmWidth,bm.bmHeight,SRCCOPY);
@@ -2346,6 +2375,31 @@ void CCIEChartGrapher::SaveGraphFile ( CDataSetDoc * pDoc, CSize ImageSize, LPCS
 		default: format = CXIMAGE_FORMAT_JPG; break;
 	}
 
+	CBitmap bitmap; 
+	RenderGraphBitmap ( pDoc, bitmap, ImageSize, PDF );
+
+	CxImage *pImage = new CxImage();
+	pImage->CreateFromHBITMAP(bitmap);
+
+	if (pImage->IsValid())
+	{
+		pImage->SetJpegQuality(ImageQuality);
+		pImage->Save(lpszPathName,format);
+	}
+
+	delete pImage;
+}
+
+BOOL CCIEChartGrapher::RenderGraphImage ( CDataSetDoc * pDoc, CSize ImageSize, CGraphImage & Image, bool PDF )
+{
+	CBitmap bitmap; 
+	RenderGraphBitmap ( pDoc, bitmap, ImageSize, PDF );
+
+	return Image.ReadBitmap ( bitmap );
+}
+
+void CCIEChartGrapher::RenderGraphBitmap ( CDataSetDoc * pDoc, CBitmap & bitmap, CSize ImageSize, bool PDF )
+{
     CRect rect(0,0,ImageSize.cx,ImageSize.cy);
 
 	CDC ScreenDC;
@@ -2354,7 +2408,6 @@ void CCIEChartGrapher::SaveGraphFile ( CDataSetDoc * pDoc, CSize ImageSize, LPCS
 	CDC dc2;
     dc2.CreateCompatibleDC(&ScreenDC);
 
-	CBitmap bitmap; 
     bitmap.CreateCompatibleBitmap(&ScreenDC,rect.Width(),rect.Height());
 
 	ScreenDC.DeleteDC ();
@@ -2364,17 +2417,6 @@ void CCIEChartGrapher::SaveGraphFile ( CDataSetDoc * pDoc, CSize ImageSize, LPCS
 	MakeBgBitmap(rect,GetConfig()->m_bWhiteBkgndOnFile && !PDF);
 	DrawChart ( pDoc, & dc2, rect, NULL, NULL );
 	dc2.SelectObject(pOldBitmap);
-
-	CxImage *pImage = new CxImage();
-	pImage->CreateFromHBITMAP(bitmap);
-
-	if (pImage->IsValid())
-	{
-		pImage->SetJpegQuality(ImageQuality);
-		pImage->Save(lpszPathName,format);
-	}
-
-	delete pImage;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -2396,6 +2438,7 @@ BEGIN_MESSAGE_MAP(CCIEChartView, CSavingView)
 	//{{AFX_MSG_MAP(CCIEChartView)
 	ON_WM_ERASEBKGND()
 	ON_WM_SIZE()
+	ON_WM_TIMER()
 	ON_WM_CONTEXTMENU()
 	ON_UPDATE_COMMAND_UI(IDM_CIE_SHOWBACKGROUND, OnUpdateCieShowbackground)
 	ON_UPDATE_COMMAND_UI(IDM_CIE_SHOWDELTAE, OnUpdateCieShowDeltaE)
@@ -2642,11 +2685,28 @@ void CCIEChartView::OnSize(UINT nType, int cx, int cy)
 		else
 			RefRect = ClientRect;
 
-		m_Grapher.MakeBgBitmap(RefRect,GetConfig()->m_bWhiteBkgndOnScreen);
+		// Cheap stretch while the window is being resized, the final one when it settles
+		m_Grapher.MakeBgBitmap(RefRect,GetConfig()->m_bWhiteBkgndOnScreen,TRUE);
+		SetTimer(CIE_RESIZE_TIMER,CIE_RESIZE_DELAY,NULL);
 	}
 	Invalidate(FALSE);
 }
 
+void CCIEChartView::OnTimer(UINT_PTR nIDEvent) 
+{
+	if ( nIDEvent == CIE_RESIZE_TIMER )
+	{
+		KillTimer(CIE_RESIZE_TIMER);
+
+		CRect RefRect;
+		GetReferenceRect(&RefRect);
+		m_Grapher.MakeBgBitmap(RefRect,GetConfig()->m_bWhiteBkgndOnScreen);
+		Invalidate(FALSE);
+	}
+	else
+		CSavingView::OnTimer(nIDEvent);
+}
+
 void CCIEChartView::OnContextMenu(CWnd* pWnd, CPoint point) 
 {
 	// load and display popup menu
@@ -988,7 +988,7 @@ void CGraphControl::DrawFiligree(CDC *pDC, CRect rect, COLORREF clr)
 	pDC -> SelectObject ( pOldFont );
 }
 
-void CGraphControl::SaveGraphs(CGraphControl *pGraphToAppend, CGraphControl *pGraphToAppend2, CGraphControl *pGraphToAppend3, bool do_Dialog, int nSequence)
+void CGraphControl::SaveGraphs(CGraphControl *pGraphToAppend, CGraphControl *pGraphToAppend2, CGraphControl *pGraphToAppend3, bool do_Dialog, int nSequence, CGraphImage * pImage)
 {
 	int				i, NbOtherGraphs = 0;
 	CGraphControl *	pOtherGraphs [ 3 ];
@@ -1160,21 +1160,27 @@ void CGraphControl::SaveGraphs(CGraphControl *pGraphToAppend, CGraphControl *pGr
 		}
 	} else
 	{
-		char * path;
-		char filename1[255];
-		path = getenv("APPDATA");
-		strcpy_s(filename1, path);
-		strcat_s(filename1, "\\");
-		strcat_s(filename1, "color\\temp.png");
 		size = CSize(900,600);
-		SaveGraphFile ( size, filename1, 2, 95, pOtherGraphs, NbOtherGraphs, do_Dialog );
+		if ( pImage )
+		{
+			// Report generation: keep the picture in memory, no temporary file
+			RenderGraphImage ( size, * pImage, pOtherGraphs, NbOtherGraphs, do_Dialog );
+		}
+		else
+		{
+			char * path;
+			char filename1[255];
+			path = getenv("APPDATA");
+			strcpy_s(filename1, path);
+			strcat_s(filename1, "\\");
+			strcat_s(filename1, "color\\temp.png");
+			SaveGraphFile ( size, filename1, 2, 95, pOtherGraphs, NbOtherGraphs, do_Dialog );
+		}
 	}
 }
 
 void CGraphControl::SaveGraphFile ( CSize ImageSize, LPCSTR lpszPathName, int ImageFormat, int ImageQuality, CGraphControl * * pOtherGraphs, int NbOtherGraphs, bool do_Gradient )
 {
-	int				i, j;
-	COLORREF		clr;
 	int				format;
 
 	switch ( ImageFormat )
@@ -1185,6 +1191,34 @@ void CGraphControl::SaveGraphFile ( CSize ImageSize, LPCSTR lpszPathName, int Im
 		default: format = CXIMAGE_FORMAT_JPG; break;
 	}
 
+	CBitmap bitmap; 
+	RenderGraphBitmap ( bitmap, ImageSize, pOtherGraphs, NbOtherGraphs, do_Gradient );
+
+	CxImage *pImage = new CxImage();
+	pImage->CreateFromHBITMAP(bitmap);
+
+	if (pImage->IsValid())
+	{
+		pImage->SetJpegQuality(ImageQuality);
+		pImage->Save(lpszPathName,format);
+	}
+
+	delete pImage;
+}
+
+BOOL CGraphControl::RenderGraphImage ( CSize ImageSize, CGraphImage & Image, CGraphControl * * pOtherGraphs, int NbOtherGraphs, bool do_Gradient )
+{
+	CBitmap bitmap; 
+	RenderGraphBitmap ( bitmap, ImageSize, pOtherGraphs, NbOtherGraphs, do_Gradient );
+
+	return Image.ReadBitmap ( bitmap );
+}
+
+void CGraphControl::RenderGraphBitmap ( CBitmap & bitmap, CSize ImageSize, CGraphControl * * pOtherGraphs, int NbOtherGraphs, bool do_Gradient )
+{
+	int				i, j;
+	COLORREF		clr;
+
     CRect rect(0,0,ImageSize.cx,ImageSize.cy);
 
 	CDC ScreenDC;
@@ -1193,7 +1227,6 @@ void CGraphControl::SaveGraphFile ( CSize ImageSize, LPCSTR lpszPathName, int Im
 	CDC MemDC;
     MemDC.CreateCompatibleDC ( & ScreenDC );
 
-	CBitmap bitmap; 
     bitmap.CreateCompatibleBitmap ( & ScreenDC, rect.Width(), rect.Height() );
 
 	ScreenDC.DeleteDC ();
@@ -1259,17 +1292,65 @@ void CGraphControl::SaveGraphFile ( CSize ImageSize, LPCSTR lpszPathName, int Im
 		DrawGraphs(&MemDC,rect);
 	}
 	MemDC.SelectObject(pOldBitmap);
+}
 
-	CxImage *pImage = new CxImage();
-	pImage->CreateFromHBITMAP(bitmap);
+/////////////////////////////////////////////////////////////////////////////
+// CGraphImage
 
-	if (pImage->IsValid())
+BOOL CGraphImage::ReadBitmap ( CBitmap & bitmap )
+{
+	BITMAP		bm;
+	BITMAPINFO	bmi;
+
+	m_Pixels.clear ();
+	m_Width = m_Height = 0;
+
+	if ( ! bitmap.GetBitmap ( & bm ) )
+		return FALSE;
+
+	// Ask GDI for a top-down 24 bits DIB: rows are stored BGR and padded to 4 bytes
+	memset ( & bmi, 0, sizeof ( bmi ) );
+	bmi.bmiHeader.biSize = sizeof ( BITMAPINFOHEADER );
+	bmi.bmiHeader.biWidth = bm.bmWidth;
+	bmi.bmiHeader.biHeight = - bm.bmHeight;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 24;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	int	nStride = ( ( bm.bmWidth * 3 ) + 3 ) & ~3;
+	m_Pixels.resize ( nStride * bm.bmHeight );
+
+	HDC hDC = ::GetDC ( NULL );
+	int nLines = ::GetDIBits ( hDC, (HBITMAP) bitmap.GetSafeHandle (), 0, bm.bmHeight, & m_Pixels [ 0 ], & bmi, DIB_RGB_COLORS );
+	::ReleaseDC ( NULL, hDC );
+
+	if ( nLines != bm.bmHeight )
 	{
-		pImage->SetJpegQuality(ImageQuality);
-		pImage->Save(lpszPathName,format);
+		m_Pixels.clear ();
+		return FALSE;
 	}
 
-	delete pImage;
+	// Convert in place to packed RGB rows. Destination never goes past source,
+	// so each pixel is read before it can be overwritten.
+	for ( int y = 0; y < bm.bmHeight; y ++ )
+	{
+		const BYTE *	pSrc = & m_Pixels [ y * nStride ];
+		BYTE *			pDst = & m_Pixels [ y * bm.bmWidth * 3 ];
+
+		for ( int x = 0; x < bm.bmWidth; x ++, pSrc += 3, pDst += 3 )
+		{
+			BYTE b = pSrc [ 0 ], g = pSrc [ 1 ], r = pSrc [ 2 ];
+			pDst [ 0 ] = r;
+			pDst [ 1 ] = g;
+			pDst [ 2 ] = b;
+		}
+	}
+
+	m_Pixels.resize ( bm.bmWidth * bm.bmHeight * 3 );
+	m_Width = bm.bmWidth;
+	m_Height = bm.bmHeight;
+
+	return TRUE;
 }
 
 BOOL CGraphControl::PreTranslateMessage(MSG* pMsg) 
@@ -27,6 +27,25 @@
 //
 
 #include "PPTooltip.h" 
+#include <vector>
+
+/////////////////////////////////////////////////////////////////////////////
+// CGraphImage
+// Uncompressed 24 bits RGB picture, rows from top to bottom, ready to be
+// handed to libharu with HPDF_LoadRawImageFromMem
+/////////////////////////////////////////////////////////////////////////////
+class CGraphImage
+{
+public:
+	CGraphImage() : m_Width(0), m_Height(0) {}
+
+	BOOL ReadBitmap ( CBitmap & bitmap );
+	BOOL IsValid () const { return ! m_Pixels.empty (); }
+
+	int					m_Width;
+	int					m_Height;
+	std::vector<BYTE>	m_Pixels;
+};
 
 /////////////////////////////////////////////////////////////////////////////
 // CGraph
@@ -150,10 +169,12 @@ public:
 	void DrawGraphs(CDC *pDC, CRect rect);
 
 	static void DrawFiligree(CDC *pDC, CRect rect, COLORREF clr);
-	void SaveGraphs(CGraphControl *pGraphToAppend=NULL, CGraphControl *pGraphToAppend2=NULL, CGraphControl *pGraphToAppend3=NULL, bool do_Dialog = TRUE, int nSequence = 0);
+	void SaveGraphs(CGraphControl *pGraphToAppend=NULL, CGraphControl *pGraphToAppend2=NULL, CGraphControl *pGraphToAppend3=NULL, bool do_Dialog = TRUE, int nSequence = 0, CGraphImage * pImage = NULL);
 	void SaveGraphFile ( CSize ImageSize, LPCSTR lpszPathName, int ImageFormat = 0, int ImageQuality = 95, CGraphControl * * pOtherGraphs = NULL, int NbOtherGraphs = 0, bool do_Gradient = FALSE );
+	BOOL RenderGraphImage ( CSize ImageSize, CGraphImage & Image, CGraphControl * * pOtherGraphs = NULL, int NbOtherGraphs = 0, bool do_Gradient = FALSE );
 
 protected:
+	void RenderGraphBitmap ( CBitmap & bitmap, CSize ImageSize, CGraphControl * * pOtherGraphs, int NbOtherGraphs, bool do_Gradient );
 	int GetGraphX(double x,CRect rect);
 	int GetGraphY(double y,CRect rect);
 	CPoint GetGraphPoint(CDecimalPoint aPoint,CRect rect);
@@ -49,6 +49,7 @@
 #include <vector>
 #include <afxpriv.h>
 #include "EditEx.h"
+#include "TraceLog.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -345,6 +346,59 @@ static const SCtrlLayout g_CtrlLayout [] = {
 					};
 
 
+/////////////////////////////////////////////////////////////////////////////
+// CMeasureGridCell: measures grid cell whose text is formatted by the view
+// when the grid draws or reads it. The cell keeps the text as a cache and
+// asks again with GVN_GETDISPINFO, the view only answers when the grid
+// was updated since the cell was formatted.
+
+class CMeasureGridCell : public CGridCell
+{
+	DECLARE_DYNCREATE(CMeasureGridCell)
+
+public:
+	CMeasureGridCell() { m_nRow = m_nCol = -1; m_nStamp = 0; }
+
+	virtual void SetCoords(int nRow, int nCol) { m_nRow = nRow; m_nCol = nCol; }
+	virtual LPCTSTR GetText() const;
+
+protected:
+	int		m_nRow, m_nCol;
+	int		m_nStamp;
+};
+
+IMPLEMENT_DYNCREATE(CMeasureGridCell, CGridCell)
+
+LPCTSTR CMeasureGridCell::GetText() const
+{
+	CGridCtrl *	pGrid = GetGrid ();
+
+	if ( m_nRow > 0 && m_nCol > 0 && ! ( GetState () & GVIS_FIXED ) && pGrid && ::IsWindow ( pGrid -> m_hWnd ) )
+	{
+		GV_DISPINFO	dispInfo;
+		CWnd *		pOwner = pGrid -> GetOwner ();
+
+		dispInfo.hdr.hwndFrom = pGrid -> m_hWnd;
+		dispInfo.hdr.idFrom = pGrid -> GetDlgCtrlID ();
+		dispInfo.hdr.code = GVN_GETDISPINFO;
+		dispInfo.item.mask = 0;
+		dispInfo.item.row = m_nRow;
+		dispInfo.item.col = m_nCol;
+		dispInfo.item.lParam = m_nStamp;
+
+		if ( pOwner && pOwner -> SendMessage ( WM_NOTIFY, dispInfo.hdr.idFrom, (LPARAM) & dispInfo ) && ( dispInfo.item.mask & GVIF_TEXT ) )
+		{
+			CMeasureGridCell * pThis = const_cast<CMeasureGridCell *> ( this );
+			pThis -> m_strText = dispInfo.item.strText;
+			pThis -> m_nStamp = (int) dispInfo.item.lParam;
+			if ( dispInfo.item.mask & GVIF_FORMAT )
+				pThis -> m_nFormat = dispInfo.item.nFormat;
+		}
+	}
+	return CGridCell::GetText ();
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // CMainView
 
@@ -392,6 +446,7 @@ BEGIN_MESSAGE_MAP(CMainView, CFormView)
 	ON_NOTIFY(GVN_BEGINLABELEDIT, IDC_GRAYSCALE_GRID, OnGrayScaleGridBeginEdit)
 	ON_NOTIFY(GVN_ENDLABELEDIT, IDC_GRAYSCALE_GRID, OnGrayScaleGridEndEdit)
 	ON_NOTIFY(GVN_SELCHANGED, IDC_GRAYSCALE_GRID, OnGrayScaleGridEndSelChange)
+	ON_NOTIFY(GVN_GETDISPINFO, IDC_GRAYSCALE_GRID, OnGrayScaleGridGetDispInfo)
 	ON_MESSAGE(WM_SET_USER_INFO_POST_INIT, OnSetUserInfoPostInitialUpdate)
 	ON_MESSAGE(WM_CTLCOLORSTATIC, OnCtlColorStatic)
 END_MESSAGE_MAP()
@@ -430,6 +485,10 @@ CMainView::CMainView()
 
 	m_pGrayScaleGrid = NULL;
 	m_pSelectedColorGrid = NULL;
+	m_nGridRows = 0;
+	m_bGridHasLuxValues = FALSE;
+	m_bGridHasLuxDelta = FALSE;
+	m_nGridStamp = 0;
 	m_pBgBrush= new CBrush(FxGetMenuBgColor());
 
 	m_pInfoWnd = NULL;
@@ -589,6 +648,7 @@ void CMainView::OnInitialUpdate()
 
 		m_pGrayScaleGrid -> SetHScrollAlwaysVisible ( TRUE );
 		m_pGrayScaleGrid -> SetVScrollAlwaysVisible ( TRUE );
+		m_pGrayScaleGrid -> SetDefaultCellType ( RUNTIME_CLASS ( CMeasureGridCell ) );
 
 		CRect rect;
         m_valuesStatic.GetWindowRect(&rect);	// size control to m_valuesStatic control size
@@ -1177,6 +1237,10 @@ void CMainView::InitGrid(bool sizeGrid)
 	if(m_pGrayScaleGrid==NULL)
 		return;
 
+	// Nothing to format until UpdateGrid fills the columns of the new layout
+	m_gridColumns.clear ();
+	m_nGridStamp ++;
+
 	CDataSetDoc *	pDataRef = GetDataRef();
 
 	if ( pDataRef == GetDocument () )
@@ -1940,9 +2004,12 @@ CDataSetDoc* CMainView::GetDocument() // non-debug version is inline
 
 void CMainView::OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint) 
 {
+	HCFR_TRACE_FUNCTION("view");
 	int		nForceMode = -1;
 	double	dContrast;
 	InitSelectedColorGrid();
+	if ( lHint != UPD_FREEMEASUREAPPENDED )
+		m_Target.InvalidateTarget ();
 	CFrameWnd * pFrame = (CFrameWnd *)(AfxGetApp()->m_pMainWnd);
 //	if (pFrame)
 //		pFrame->GetActiveFrame()->ActivateFrame();
@@ -2960,9 +3027,6 @@ void CMainView::UpdateGrid()
 		double			Gamma,Offset = 0.0;
 		COLORREF		clrSpecial1=RGB(128,128,128), clrSpecial2=RGB(128,128,128);
 		CDataSetDoc *	pDataRef = GetDataRef();
-		GV_ITEM Item;
-		Item.mask = GVIF_TEXT|GVIF_FORMAT;
-		Item.nFormat = DT_RIGHT|DT_VCENTER|DT_SINGLELINE|DT_END_ELLIPSIS|DT_NOPREFIX;
 		bool isHDR = GetConfig()->m_GammaOffsetType == 5;
 		CColorReference  bRef = ((GetColorReference().m_standard == UHDTV3 || GetColorReference().m_standard == UHDTV4)?CColorReference(UHDTV2):(GetColorReference().m_standard == HDTVa || GetColorReference().m_standard == HDTVb)?CColorReference(HDTV):GetColorReference());
 		GetConfig()->WriteProfileInt("MainView","Chart Display",m_displayMode);
@@ -3257,6 +3321,15 @@ void CMainView::UpdateGrid()
 					
 		YWhite_for_color_comp = YWhite;
 
+		// Cells are formatted when the grid draws them, from what is kept
+		// here for each column
+		m_gridColumns.resize ( nCount );
+		m_nGridRows = nRows;
+		m_bGridHasLuxValues = bHasLuxValues;
+		m_bGridHasLuxDelta = bHasLuxDelta;
+		m_gridRefLuxColor = refLuxColor;
+		m_nGridStamp ++;
+
 		for( int j = 0 ; j < nCount ; j ++ )
 		{
             int i = GetDocument() -> GetMeasure () -> GetGrayScaleSize ();
@@ -3635,58 +3708,24 @@ void CMainView::UpdateGrid()
 				}
 			}
 
-			for( int i = 0 ; i < nRows ; i ++ )
+			GridColumn & column = m_gridColumns [ j ];
+			column.aColor = aColor;
+			column.refColor = refColor;
+			column.refDocColor = refDocColor;
+			column.YWhite = YWhite;
+			column.YWhiteRefDoc = YWhiteRefDoc;
+			column.Offset = Offset;
+			column.isGS = isGS;
+			column.strDeltaE.Empty ();
+
+			// Delta E row updates the statistics and highlights, it cannot wait for the grid
+			if ( nRows > 3 && ! ( bHasLuxValues && nRows - ( 1 + bHasLuxDelta ) <= 3 ) )
+				column.strDeltaE = GetItemText ( aColor, YWhite, refColor, refDocColor, YWhiteRefDoc, 3, j+1, Offset, isGS );
+
+			if ( bSpecialRef )
 			{
-				Item.row = i+1;
-				Item.col = j+1;
-				
-				if ( bHasLuxValues && i == nRows - ( 1 + bHasLuxDelta ) )
-				{
-					if ( aColor.isValid() && aColor.HasLuxValue () )
-					{
-						if ( GetConfig () -> m_bUseImperialUnits )
-							Item.strText.Format ( "%.5g", aColor.GetLuxValue () * 0.0929 );
-						else
-							Item.strText.Format ( "%.5g", aColor.GetLuxValue () );
-					}
-					else
-						Item.strText.Empty ();
-				}
-				else if ( bHasLuxValues && bHasLuxDelta && i == nRows - 1 )
-				{
-					if ( aColor.isValid() )
-					{
-						double dRef = refLuxColor.GetY() / refLuxColor.GetLuxValue ();
-						double dColor = aColor.GetY() / aColor.GetLuxValue ();
-
-						if ( fabs ( dRef ) < 0.000000001 )
-							Item.strText.Empty ();
-						else if ( fabs ( ( dRef - dColor ) / dRef ) < 0.001 )
-						{
-							if ( j == nCount - ( 1 + m_displayMode ) )
-								Item.strText = "Ref";
-							else
-								Item.strText = "=";
-						}
-						else if ( dColor < dRef )
-							Item.strText.Format("-%.1f %%", 100.0 * ( dRef - dColor ) / dRef );
-						else
-							Item.strText.Format("+%.1f %%", 100.0 * ( dColor - dRef ) / dRef );
-					}
-					else
-						Item.strText.Empty ();
-				}
-				else
-				{
-					Item.strText = GetItemText ( aColor, YWhite, refColor, refDocColor, YWhiteRefDoc, i, j+1, Offset, isGS );
-				}
-				
-				m_pGrayScaleGrid->SetItem(&Item);
-
-				if ( bSpecialRef && i >= 3 )
-				{
+				for( int i = 3 ; i < nRows ; i ++ )
 					m_pGrayScaleGrid->SetItemBkColour ( i+1, j+1, ( i&1 ? clrSpecial1 : clrSpecial2 ) );
-				}
 			}
 		}
 		
@@ -4087,6 +4126,74 @@ void CMainView::UpdateGrid()
 		m_tooltip.AddTool(pWnd, m_infoLine + nMeasures + t);
 }
 
+CString CMainView::GetGridCellText(GridColumn & column, int aComponentNum, int nCol)
+{
+	CString		str;
+	CColor &	aColor = column.aColor;
+
+	if ( m_bGridHasLuxValues && aComponentNum == m_nGridRows - ( 1 + m_bGridHasLuxDelta ) )
+	{
+		if ( aColor.isValid() && aColor.HasLuxValue () )
+		{
+			if ( GetConfig () -> m_bUseImperialUnits )
+				str.Format ( "%.5g", aColor.GetLuxValue () * 0.0929 );
+			else
+				str.Format ( "%.5g", aColor.GetLuxValue () );
+		}
+	}
+	else if ( m_bGridHasLuxValues && m_bGridHasLuxDelta && aComponentNum == m_nGridRows - 1 )
+	{
+		if ( aColor.isValid() )
+		{
+			double dRef = m_gridRefLuxColor.GetY() / m_gridRefLuxColor.GetLuxValue ();
+			double dColor = aColor.GetY() / aColor.GetLuxValue ();
+
+			if ( fabs ( dRef ) < 0.000000001 )
+				str.Empty ();
+			else if ( fabs ( ( dRef - dColor ) / dRef ) < 0.001 )
+			{
+				if ( nCol - 1 == (int) m_gridColumns.size () - ( 1 + m_displayMode ) )
+					str = "Ref";
+				else
+					str = "=";
+			}
+			else if ( dColor < dRef )
+				str.Format("-%.1f %%", 100.0 * ( dRef - dColor ) / dRef );
+			else
+				str.Format("+%.1f %%", 100.0 * ( dColor - dRef ) / dRef );
+		}
+	}
+	else if ( aComponentNum == 3 )
+		str = column.strDeltaE;
+	else
+		str = GetItemText ( aColor, column.YWhite, column.refColor, column.refDocColor, column.YWhiteRefDoc, aComponentNum, nCol, column.Offset, column.isGS );
+
+	return str;
+}
+
+void CMainView::OnGrayScaleGridGetDispInfo(NMHDR *pNotifyStruct,LRESULT* pResult)
+{
+	GV_DISPINFO *	pDispInfo = (GV_DISPINFO*) pNotifyStruct;
+	int				nRow = pDispInfo -> item.row;
+	int				nCol = pDispInfo -> item.col;
+
+	*pResult = FALSE;
+
+	// Only the measure cells UpdateGrid filled are formatted here
+	if ( nRow < 1 || nRow > m_nGridRows || nCol < 1 || nCol > (int) m_gridColumns.size () )
+		return;
+
+	// Cell text still up to date
+	if ( pDispInfo -> item.lParam == m_nGridStamp )
+		return;
+
+	pDispInfo -> item.strText = GetGridCellText ( m_gridColumns [ nCol - 1 ], nRow - 1, nCol );
+	pDispInfo -> item.nFormat = DT_RIGHT|DT_VCENTER|DT_SINGLELINE|DT_END_ELLIPSIS|DT_NOPREFIX;
+	pDispInfo -> item.mask = GVIF_TEXT|GVIF_FORMAT;
+	pDispInfo -> item.lParam = m_nGridStamp;
+	*pResult = TRUE;
+}
+
 void CMainView::UpdateContrastValuesInGrid ()
 {
 	GV_ITEM Item;
@@ -5650,13 +5757,13 @@ void CMainView::UpdateMeasurementsAfterBkgndMeasure ()
 			Item.strText = GetItemText ( MeasuredColor, YWhite, refColor, refDocColor, YWhiteRefDoc, i, n, 0.0, isGS );
 			
 			m_pGrayScaleGrid->SetItem(&Item);
-			UpdateGrid();
 
 			if ( bSpecialRef && i >= 3 )
 			{
 				m_pGrayScaleGrid->SetItemBkColour ( i+1, n, ( i&1 ? clrSpecial1 : clrSpecial2 ) );
 			}
 		}
+		UpdateGrid();
 
 		ASSERT ( n == m_pGrayScaleGrid->GetColumnCount()-1 );
 
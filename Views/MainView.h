@@ -86,6 +86,23 @@ public:
 private:
     void AddColorToGrid(const ColorTriplet& color, GV_ITEM& Item, const char* format);
 
+	// What UpdateGrid computed for one measurement column of the grid, the
+	// cells are formatted from it when the grid first draws or reads them
+	struct GridColumn
+	{
+		CColor	aColor, refColor, refDocColor;
+		double	YWhite, YWhiteRefDoc, Offset;
+		bool	isGS;
+		CString	strDeltaE;		// delta E row, computed with the statistics
+	};
+	CString GetGridCellText(GridColumn & column, int aComponentNum, int nCol);
+
+	std::vector<GridColumn> m_gridColumns;
+	int			m_nGridRows;
+	BOOL		m_bGridHasLuxValues, m_bGridHasLuxDelta;
+	CColor		m_gridRefLuxColor;
+	int			m_nGridStamp;		// stamp of the last grid update
+
     BOOL		m_bPositionsInit;
 	POINT		m_InitialWindowSize;
 	RECT		m_OriginalRect;
@@ -223,6 +240,7 @@ protected:
 	void OnGrayScaleGridBeginEdit(NMHDR *pNotifyStruct,LRESULT* pResult);
 	void OnGrayScaleGridEndEdit(NMHDR *pNotifyStruct,LRESULT* pResult);
 	void OnGrayScaleGridEndSelChange(NMHDR *pNotifyStruct,LRESULT* pResult);
+	void OnGrayScaleGridGetDispInfo(NMHDR *pNotifyStruct,LRESULT* pResult);
 
 public:
 	void UpdateMeasurementsAfterBkgndMeasure ();
@@ -37,6 +37,7 @@
 class CDataSetDoc;
 
 #include "PPTooltip.h" 
+#include "GraphControl.h"
 
 class CCIEGraphPoint
 {
@@ -124,11 +125,24 @@ class CCIEChartGrapher
 	int		m_DeltaX;		// When zoom active, delta values for picture scrolling in pixels
 	int		m_DeltaY;
 
+	// What the background bitmaps were last built for, to skip identical rebuilds
+	CSize	m_bgSize;
+	BOOL	m_bgWhiteBkgnd;
+	BOOL	m_bgDraft;
+	DWORD	m_bgOptions;
+	UINT	m_bgChartsVersion;
+	double	m_bgWhitex;
+	double	m_bgWhitey;
+
 	// Operations
-	void MakeBgBitmap(CRect rect,BOOL bWhiteBkgnd);
+	void MakeBgBitmap(CRect rect,BOOL bWhiteBkgnd,BOOL bDraft=FALSE);
 	void DrawAlphaBitmap(CDC *pDC, const CCIEGraphPoint& aGraphPoint, CBitmap *pBitmap, CRect rect, CPPToolTip * pTooltip, CWnd * pWnd, CCIEGraphPoint * pRefPoint = NULL, bool isSelected = FALSE, double dE10=100.0, bool isPrimeSec = FALSE);
 	void DrawChart(CDataSetDoc * pDoc, CDC* pDC, CRect rect, CPPToolTip * pTooltip, CWnd * pWnd);
 	void SaveGraphFile ( CDataSetDoc * pDoc, CSize ImageSize, LPCSTR lpszPathName, int ImageFormat = 0, int ImageQuality = 95, bool PDF=FALSE );
+	BOOL RenderGraphImage ( CDataSetDoc * pDoc, CSize ImageSize, CGraphImage & Image, bool PDF=FALSE );
+
+protected:
+	void RenderGraphBitmap ( CDataSetDoc * pDoc, CBitmap & bitmap, CSize ImageSize, bool PDF );
 };
 
 class CCIEChartView : public CSavingView
@@ -189,6 +203,7 @@ protected:
 	//{{AFX_MSG(CCIEChartView)
 	afx_msg BOOL OnEraseBkgnd(CDC* pDC);
 	afx_msg void OnSize(UINT nType, int cx, int cy);
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 	afx_msg void OnContextMenu(CWnd* pWnd, CPoint point);
 	afx_msg void OnUpdateCieShowbackground(CCmdUI* pCmdUI);
 	afx_msg void OnUpdateCieShowDeltaE(CCmdUI* pCmdUI);
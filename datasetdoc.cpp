@@ -56,6 +56,8 @@
 #include "SpectralSampleDlg.h"
 
 #include "Matrix.h"
+#include "MeterCorrection.h"
+#include "LiveReadout.h"
 #include "NewDocWizard.h"
 
 #include "Export.h"
@@ -66,6 +68,7 @@
 #include "ScaleSizes.h"
 
 #include "DocEnumerator.h"
+#include "DeviceLatencyTarget.h"
 #include <math.h>
 
 #ifdef _DEBUG
@@ -114,6 +117,12 @@ static CRITICAL_SECTION g_CritSec;
 static CPtrList			g_MeasuredColorList;
 volatile BOOL			g_bInsideBkgndRefresh = FALSE;
 
+// Live adjustment: continuous measures take short readings and show them
+// filtered, several times per second
+static BOOL				g_bLiveAdjust = FALSE;
+static CLiveReadoutFilter	g_LiveFilter;		// Used by the background thread only
+static LiveReadout		g_LiveReadout;		// Last readout, protected by g_CritSec
+
 // The background thread function
 static UINT __cdecl BkgndThreadFunc ( LPVOID lpParameter )
 {
@@ -130,6 +139,9 @@ static UINT __cdecl BkgndThreadFunc ( LPVOID lpParameter )
 	    POSITION		pos;
 		int				m_d = 0;
 			    
+		if ( g_bLiveAdjust )
+			pSensor -> setFastReadings ( true );
+
 		pos = g_pDataDocRunningThread -> GetFirstViewPosition ();
 		if (!pos)
 			g_bTerminateThread = TRUE;
@@ -166,6 +178,7 @@ static UINT __cdecl BkgndThreadFunc ( LPVOID lpParameter )
 				if ( g_CurrentColor != clr || (( (m_nPat % GetConfig()->m_ablFreq) == 0) && GetConfig()->m_bABL) )
 			    {
 				    g_CurrentColor = clr;
+					g_LiveFilter.Reset ();
 												
 					if ( m_d == 1 || (m_d < 11 && m_d > 4) )
 						MT = CGenerator::MT_ACTUAL;
@@ -189,7 +202,21 @@ static UINT __cdecl BkgndThreadFunc ( LPVOID lpParameter )
 				    CColor * pMeasurement = new CColor;
 				    *pMeasurement = measuredColor;
 
-				    while ( g_bInsideBkgndRefresh )
+					if ( g_bLiveAdjust )
+					{
+						// Show the filtered light rather than the last short reading
+						ColorXYZ measuredXYZ = measuredColor.GetXYZValue ();
+						double XYZ[3] = { measuredXYZ[0], measuredXYZ[1], measuredXYZ[2] };
+						const LiveReadout & readout = g_LiveFilter.Add ( XYZ );
+						pMeasurement -> SetXYZValue ( ColorXYZ ( readout.XYZ[0], readout.XYZ[1], readout.XYZ[2] ) );
+
+						EnterCriticalSection (& g_CritSec );
+						g_LiveReadout = readout;
+						LeaveCriticalSection (& g_CritSec );
+					}
+
+					// Live readouts do not wait: the display only takes the last one
+				    while ( g_bInsideBkgndRefresh && ! g_bLiveAdjust )
 					
 					Sleep ( 500 ); //allow for user interaction
 
@@ -246,6 +273,8 @@ static UINT __cdecl BkgndThreadFunc ( LPVOID lpParameter )
 	    } while ( TRUE );
 
 		
+		if ( g_bLiveAdjust )
+			pSensor -> setFastReadings ( false );
 	    pSensor -> Release ();
 	    DeleteCriticalSection (& g_CritSec );
 	
@@ -326,6 +355,9 @@ BOOL StartBackgroundMeasures ( CDataSetDoc * pDoc )
 			}
 		}
 
+		g_bLiveAdjust = GetConfig()->m_bContinuousMeasures && GetConfig()->m_bLiveAdjust;
+		g_LiveFilter.Reset ();
+
 		// Create the background thread
 		g_bTerminateThread = FALSE;
 		g_pDataDocRunningThread = pDoc;
@@ -475,6 +507,7 @@ BEGIN_MESSAGE_MAP(CDataSetDoc, CDocument)
 	ON_COMMAND(IDM_CALIBRATION_MANUAL, OnCalibrationManual)
 	ON_COMMAND(IDM_CALIBRATION_EXISTING, OnCalibrationExisting)
 	ON_COMMAND(IDM_CALIBRATION_SPECTRAL, OnCalibrationSpectralSample)
+	ON_COMMAND(IDM_DISPLAY_LATENCY, OnDisplayLatency)
 	ON_COMMAND(IDM_SIM_GRAYSCALE, OnSimGrayscale)
 	ON_COMMAND(IDM_SIM_PRIMARIES, OnSimPrimaries)
 	ON_COMMAND(IDM_SIM_SECONDARIES, OnSimSecondaries)
@@ -961,32 +994,12 @@ BOOL CDataSetDoc::OnNewDocument()
 void CDataSetDoc::Serialize(CArchive& ar)
 {
 	CString	Msg, Title;
-	CDataSetWindowPositions * pWndPos;
 
 	StopBackgroundMeasures ();
 
 	if (ar.IsStoring())
 	{
-		// write the object header first so we can correctly recognise the object type "CMatrixC"
-		long header1=0x4F4C4F43;	// header is "COLORHCF" in hexa
-		long header2=0x46434852;
-		int	 version = CURRENT_FILE_FORMAT_VERSION ;			// serialization version format number
-
-		ar << header1;
-		ar << header2;
-		ar << version;
-
-		// save Measure
-		m_measure.Serialize(ar);
-
-		// save Sensor & Generator
-		ar << m_pSensor;
-		ar << m_pGenerator;
-
-		// Save views positions
-		pWndPos = new CDataSetWindowPositions ( this );
-		pWndPos -> Serialize ( ar );
-		delete pWndPos;
+		StoreDocument ( ar );
 	}
 	else
 	{
@@ -1049,6 +1062,146 @@ void CDataSetDoc::Serialize(CArchive& ar)
 	}
 }
 
+static void StoreFileHeader(CArchive& ar)
+{
+	// write the object header first so we can correctly recognise the object type "CMatrixC"
+	long header1=0x4F4C4F43;	// header is "COLORHCF" in hexa
+	long header2=0x46434852;
+	int	 version = CURRENT_FILE_FORMAT_VERSION ;			// serialization version format number
+
+	ar << header1;
+	ar << header2;
+	ar << version;
+}
+
+void CDataSetDoc::StoreDocument(CArchive& ar)
+{
+	StoreFileHeader ( ar );
+
+	// save Measure
+	m_measure.Serialize(ar);
+
+	StoreDeviceObjects ( ar );
+}
+
+// Sensor, generator and views positions, the end of the file
+void CDataSetDoc::StoreDeviceObjects(CArchive& ar)
+{
+	CDataSetWindowPositions * pWndPos;
+
+	// save Sensor & Generator
+	ar << m_pSensor;
+	ar << m_pGenerator;
+
+	// Save views positions
+	pWndPos = new CDataSetWindowPositions ( this );
+	pWndPos -> Serialize ( ar );
+	delete pWndPos;
+}
+
+// Document as it would be saved, serialised by the journal writer thread. The measures are
+// copied, the end of the file is stored right away: the sensor, generator and views belong
+// to the document thread. No object is stored before them, so a separate archive gives the
+// same bytes as StoreDocument.
+class CDocumentSnapshot : public CJournalSnapshot
+{
+public:
+	CDocumentSnapshot ( const CMeasure & measure ) { m_measure.CopyMeasures ( measure ); }
+
+	std::vector<char>	m_deviceObjects;
+
+	virtual bool Build ( std::vector<char> & data )
+	{
+		if ( ! StoreToMemory ( data ) )
+			return false;
+		data.insert ( data.end (), m_deviceObjects.begin (), m_deviceObjects.end () );
+		return true;
+	}
+
+	BOOL StoreToMemory ( std::vector<char> & data, CDataSetDoc * pDoc = NULL )
+	{
+		CMemFile	file;
+		BYTE *		pData;
+		ULONGLONG	nSize;
+
+		try
+		{
+			CArchive	ar ( & file, CArchive::store );
+			if ( pDoc )
+			{
+				ar.m_pDocument = pDoc;
+				pDoc -> StoreDeviceObjects ( ar );
+			}
+			else
+			{
+				StoreFileHeader ( ar );
+				m_measure.Serialize ( ar );
+			}
+			ar.Close ();
+		}
+		catch ( CException * e )
+		{
+			e -> Delete ();
+			return FALSE;
+		}
+
+		nSize = file.GetLength ();
+		pData = file.Detach ();
+		data.assign ( (char *) pData, (char *) pData + nSize );
+		free ( pData );
+		return TRUE;
+	}
+
+protected:
+	CMeasure	m_measure;
+};
+
+CJournalSnapshot * CDataSetDoc::CreateSnapshot ()
+{
+	CDocumentSnapshot * pSnapshot = new CDocumentSnapshot ( m_measure );
+
+	if ( ! pSnapshot -> StoreToMemory ( pSnapshot -> m_deviceObjects, this ) )
+	{
+		delete pSnapshot;
+		return NULL;
+	}
+	return pSnapshot;
+}
+
+// Called as each reading lands in a series. The journal starts with a snapshot of the document
+// and is compacted into a new one every JournalCompactRecords readings, the files go in the
+// Recovery folder and are removed once the document is saved or closed. Here the readings are
+// only queued and the measures copied, the journal thread does the writing and serialising.
+void CDataSetDoc::JournalReading ( const JournalRecord & record )
+{
+	CJournalSnapshot *	pSnapshot;
+
+	if ( ! m_journal.IsOpen () )
+	{
+		CString	strPath, strName;
+
+		strPath = GetConfig () -> m_ApplicationPath;
+		strPath += "Recovery\\";
+		CreateDirectory ( strPath, NULL );
+		strName.Format ( "%08X%08X", GetCurrentProcessId (), GetTickCount () );
+
+		if ( ! m_journal.Open ( (LPCSTR) ( strPath + strName + ".hcj" ), (LPCSTR) GetPathName (), (LPCSTR) ( strPath + strName + ".chc" ) ) )
+			return;
+
+		// The first snapshot already holds this reading, replaying it again is harmless
+		if ( ( pSnapshot = CreateSnapshot () ) != NULL )
+			m_journal.Compact ( pSnapshot );
+	}
+
+	m_journal.Append ( record );
+
+	if ( m_journal.GetRecordCount () >= GetConfig () -> GetProfileInt ( "Options", "JournalCompactRecords", 2000 ) )
+	{
+		if ( ( pSnapshot = CreateSnapshot () ) != NULL )
+			m_journal.Compact ( pSnapshot );
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // CDataSetDoc diagnostics
 
@@ -1104,6 +1257,9 @@ void CDataSetDoc::OnCloseDocument()
 {
 	StopBackgroundMeasures ();
 
+	// Unsaved readings are dropped with the document
+	m_journal.Discard ();
+
 // If reference measure document is closed, clear reference measure
 	if (GetDataRef() == this) {	//Ki
 		UpdateDataRef(FALSE, this);
@@ -1523,6 +1679,9 @@ BOOL CDataSetDoc::OnSaveDocument(LPCTSTR lpszPathName)
 
 	if (return_value)
 	{
+		// Everything journaled is in the saved document now
+		m_journal.Discard ();
+
 		CString string = (CString)lpszPathName;
 		CString string2,name;
 		int	lastpos,pos = 0;
@@ -1956,6 +2115,51 @@ void CDataSetDoc::OnCalibrationManual()
     
 }
 
+void CDataSetDoc::OnDisplayLatency()
+{
+	// Measures the transitions of the display with this document's sensor and
+	// generator, into the profile the full screen generator waits with
+	CString							Msg, Title;
+	CDisplayLatencyProfile			profile;
+	LatencyCharacterisationConfig	config;
+	std::string						error;
+
+	StopBackgroundMeasures ();
+
+	Msg = "The display will show gray levels while the sensor reads them. Place the sensor on the screen and press OK.";
+	if ( GetColorApp()->InMeasureMessageBox ( Msg, "Display latency", MB_OKCANCEL | MB_ICONINFORMATION ) != IDOK )
+		return;
+
+	BeginWaitCursor ();
+	BOOL bOk = CharacteriseDeviceLatency ( m_pSensor, m_pGenerator, config, profile, error );
+	EndWaitCursor ();
+
+	if ( ! bOk )
+	{
+		Msg = "Display latency characterisation failed: ";
+		Msg += error.c_str ();
+		Title.LoadString ( IDS_ERROR );
+		GetColorApp()->InMeasureMessageBox ( Msg, Title, MB_ICONERROR | MB_OK );
+		return;
+	}
+
+	CFileDialog fileSaveDialog ( FALSE, "txt", NULL, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT, "Latency profile (*.txt)|*.txt||" );
+	if ( fileSaveDialog.DoModal () != IDOK )
+		return;
+
+	if ( ! profile.Save ( (LPCSTR) fileSaveDialog.GetPathName () ) )
+	{
+		Msg = "Can't write " + fileSaveDialog.GetPathName ();
+		Title.LoadString ( IDS_ERROR );
+		GetColorApp()->InMeasureMessageBox ( Msg, Title, MB_ICONERROR | MB_OK );
+		return;
+	}
+
+	Msg = "Use this profile to time the patterns of the full screen generator?";
+	if ( GetColorApp()->InMeasureMessageBox ( Msg, "Display latency", MB_YESNO | MB_ICONQUESTION ) == IDYES )
+		GetConfig()->WriteProfileString ( "GDIGenerator", "LatencyProfile", fileSaveDialog.GetPathName () );
+}
+
 void CDataSetDoc::OnCalibrationSpectralSample() 
 {
 	int		i;
@@ -2286,6 +2490,56 @@ BOOL CDataSetDoc::ComputeAdjustmentMatrix()
     Matrix oldMatrix = m_pSensor->GetSensorMatrix();
     Matrix ConvMatrix = ComputeConversionMatrix (measures, references, white, whiteRef, GetConfig () -> m_bUseOnlyPrimaries );
 
+	if ( GetConfig () -> m_bUseMultiPatchMatrix && whiteRef.isValid() )
+	{
+		// Fit the matrix on every patch measured in both documents, minimizing dE2000
+		CMeterCorrection	fit;
+		CMeasure &			ref = pDataRef -> m_measure;
+
+		for ( int i = 0; i < 3; i ++ )
+		{
+			fit.AddPatch ( m_measure.GetPrimary(i).GetXYZValue(), ref.GetPrimary(i).GetXYZValue() );
+			fit.AddPatch ( m_measure.GetSecondary(i).GetXYZValue(), ref.GetSecondary(i).GetXYZValue() );
+		}
+
+		// White is the top of the grayscale when both documents measured it: add it once
+		int		nGrays = m_measure.GetGrayScaleSize();
+		BOOL	bGrayWhite = FALSE;
+
+		if ( nGrays > 0 && nGrays == ref.GetGrayScaleSize() )
+		{
+			for ( int i = 0; i < nGrays; i ++ )
+				fit.AddPatch ( m_measure.GetGray(i).GetXYZValue(), ref.GetGray(i).GetXYZValue() );
+			bGrayWhite = m_measure.GetGray(nGrays-1).GetXYZValue().isValid() && ref.GetGray(nGrays-1).GetXYZValue().isValid();
+		}
+
+		if ( ! bGrayWhite )
+			fit.AddPatch ( white, whiteRef );
+
+		if ( m_measure.GetSaturationSize() == ref.GetSaturationSize() )
+		{
+			for ( int i = 0; i < m_measure.GetSaturationSize(); i ++ )
+			{
+				fit.AddPatch ( m_measure.GetRedSat(i).GetXYZValue(), ref.GetRedSat(i).GetXYZValue() );
+				fit.AddPatch ( m_measure.GetGreenSat(i).GetXYZValue(), ref.GetGreenSat(i).GetXYZValue() );
+				fit.AddPatch ( m_measure.GetBlueSat(i).GetXYZValue(), ref.GetBlueSat(i).GetXYZValue() );
+				fit.AddPatch ( m_measure.GetYellowSat(i).GetXYZValue(), ref.GetYellowSat(i).GetXYZValue() );
+				fit.AddPatch ( m_measure.GetCyanSat(i).GetXYZValue(), ref.GetCyanSat(i).GetXYZValue() );
+				fit.AddPatch ( m_measure.GetMagentaSat(i).GetXYZValue(), ref.GetMagentaSat(i).GetXYZValue() );
+			}
+		}
+
+		try
+		{
+			fit.Fit ( whiteRef );
+			ConvMatrix = fit.GetMatrix ();
+		}
+		catch ( std::logic_error & )
+		{
+			// Not enough patches: keep primaries based matrix
+		}
+	}
+
 	// check that matrix is inversible
 	if ( ConvMatrix.Determinant() != 0.0 )
 	{
@@ -4123,29 +4377,73 @@ void CDataSetDoc::OnUpdateContinuousMeasurement(CCmdUI* pCmdUI)
 
 void CDataSetDoc::ComputeGammaAndOffset(double * Gamma, double * Offset, int ColorSpace,int ColorIndex,int Size, bool m_bBT1886)
 {
-	int		nConfigOffsetType = GetConfig() -> m_GammaOffsetType;
-	int		nLumCurveMode = GetConfig () -> m_nLuminanceCurveMode;
-	double	blacklvl, whitelvl, graylvl, Offset_opt, Gamma_opt;
-	BOOL	bIRE = GetMeasure () -> m_bIREScaleMode;
+	// Every view, the main grid and the exports ask for the same few fits on each
+	// redraw. Results are cached per (ColorSpace, ColorIndex) and only recomputed
+	// when the normalized gray levels or the settings driving the fit change.
+	CGammaFitCache *	pCache = NULL;
+	
+	if ( ColorSpace == 0 && ColorIndex >= 0 && ColorIndex < 3 )
+		pCache = & m_GammaFitCache [ ColorIndex ];
+	else if ( ColorSpace > 0 && ColorSpace < 4 )
+		pCache = & m_GammaFitCache [ 2 + ColorSpace ];
+
+	*Gamma = 1.0;
+	*Offset = 0.0;
 
-	double * lumlvl = new double [ Size ];
-	double * valx = new double [ Size ];
-	double * tmpx = new double [ Size ];
+	if ( Size <= 0 || Size > GetMeasure () -> GetGrayScaleSize () )
+		return;
+
+	CGammaFitCache		fit;
+	int					nConfigOffsetType = GetConfig() -> m_GammaOffsetType;
+	int					nLumCurveMode = GetConfig () -> m_nLuminanceCurveMode;
+	BOOL				bPreferLux = GetConfig () -> m_bPreferLuxmeter;
+	const CColor &		Black = GetMeasure () -> GetGray ( 0 );
+	const CColor &		White = GetMeasure () -> GetGray ( Size - 1 );
+	double				blacklvl, whitelvl, graylvl;
+
+	fit.ColorSpace = ColorSpace;
+	fit.ColorIndex = ColorIndex;
+	fit.Size = Size;
+	fit.bBT1886 = m_bBT1886;
+
+	// Everything the fit depends on besides the gray levels themselves
+	fit.Params.reserve ( 24 );
+	fit.Params.push_back ( nConfigOffsetType );
+	fit.Params.push_back ( nLumCurveMode );
+	fit.Params.push_back ( bPreferLux );
+	fit.Params.push_back ( GetConfig() -> m_colorStandard );
+	fit.Params.push_back ( GetConfig() -> m_manualGOffset );
+	fit.Params.push_back ( GetConfig() -> m_bUseRoundDown );
+	fit.Params.push_back ( GetConfig() -> m_bUse10bit );
+	fit.Params.push_back ( GetConfig() -> m_GammaRel );
+	fit.Params.push_back ( GetConfig() -> m_Split );
+	fit.Params.push_back ( GetConfig() -> m_DiffuseL );
+	fit.Params.push_back ( GetConfig() -> m_MasterMinL );
+	fit.Params.push_back ( GetConfig() -> m_MasterMaxL );
+	fit.Params.push_back ( GetConfig() -> m_TargetMinL );
+	fit.Params.push_back ( GetConfig() -> m_TargetMaxL );
+	fit.Params.push_back ( GetConfig() -> m_useToneMap );
+	fit.Params.push_back ( GetConfig() -> m_TargetSysGamma );
+	fit.Params.push_back ( GetConfig() -> m_BT2390_BS );
+	fit.Params.push_back ( GetConfig() -> m_BT2390_WS );
+	fit.Params.push_back ( GetConfig() -> m_BT2390_WS1 );
+	fit.Params.push_back ( White.isValid() ? White.GetY() : -1.0 );
+	fit.Params.push_back ( Black.isValid() ? Black.GetY() : -1.0 );
 
 	if (ColorSpace == 0) 
 	{
-		blacklvl=GetMeasure()->GetGray(0).GetRGBValue((GetColorReference()))[ColorIndex];
-		whitelvl=GetMeasure()->GetGray(Size-1).GetRGBValue((GetColorReference()))[ColorIndex];
+		blacklvl=Black.GetRGBValue((GetColorReference()))[ColorIndex];
+		whitelvl=White.GetRGBValue((GetColorReference()))[ColorIndex];
 	}
 	else if (ColorSpace == 1) 
 	{
-		blacklvl=GetMeasure()->GetGray(0).GetLuxOrLumaValue(GetConfig () -> m_nLuminanceCurveMode);
-		whitelvl=GetMeasure()->GetGray(Size-1).GetLuxOrLumaValue(GetConfig () -> m_nLuminanceCurveMode);
+		blacklvl=Black.GetLuxOrLumaValue(nLumCurveMode);
+		whitelvl=White.GetLuxOrLumaValue(nLumCurveMode);
 	}
 	else if (ColorSpace == 2) 
 	{
-		blacklvl=GetMeasure()->GetGray(0).GetLuxValue();
-		whitelvl=GetMeasure()->GetGray(Size-1).GetLuxValue();
+		blacklvl=Black.GetLuxValue();
+		whitelvl=White.GetLuxValue();
 	}
 	else
 	{
@@ -4153,124 +4451,110 @@ void CDataSetDoc::ComputeGammaAndOffset(double * Gamma, double * Offset, int Col
 		if ( nLumCurveMode > 0 )
 		{
 			// When luxmeter values are authorized in curves, use preference for contrast/delta luminance
-			blacklvl=GetMeasure()->GetGray(0).GetPreferedLuxValue(GetConfig () -> m_bPreferLuxmeter);
-			whitelvl=GetMeasure()->GetGray(Size-1).GetPreferedLuxValue(GetConfig () -> m_bPreferLuxmeter);
+			blacklvl=Black.GetPreferedLuxValue(bPreferLux);
+			whitelvl=White.GetPreferedLuxValue(bPreferLux);
 		}
 		else
 		{
 			// Use only colorimeter values
-			blacklvl=GetMeasure()->GetGray(0).GetLuminance();
-			whitelvl=GetMeasure()->GetGray(Size-1).GetLuminance();
+			blacklvl=Black.GetLuminance();
+			whitelvl=White.GetLuminance();
 		}
 	}
 
 	if ( nConfigOffsetType == 1 )
 		whitelvl = whitelvl - blacklvl;
 
+	fit.lumlvl.resize ( Size );
 	for (int i=0; i<Size; i++)
 	{	
+		const CColor & gray = GetMeasure () -> GetGray ( i );
+
 		if (ColorSpace == 0)
-			graylvl=GetMeasure()->GetGray(i).GetRGBValue((GetColorReference()))[ColorIndex];
+			graylvl=gray.GetRGBValue((GetColorReference()))[ColorIndex];
 		else if (ColorSpace == 1)
-			graylvl=GetMeasure()->GetGray(i).GetLuxOrLumaValue(GetConfig () -> m_nLuminanceCurveMode);
+			graylvl=gray.GetLuxOrLumaValue(nLumCurveMode);
 		else if (ColorSpace == 2) 
-			graylvl=GetMeasure()->GetGray(i).GetLuxValue();
+			graylvl=gray.GetLuxValue();
 		else
 		{
 			if ( nLumCurveMode > 0 )
-				graylvl=GetMeasure()->GetGray(i).GetPreferedLuxValue(GetConfig () -> m_bPreferLuxmeter);
+				graylvl=gray.GetPreferedLuxValue(bPreferLux);
 			else
-				graylvl=GetMeasure()->GetGray(i).GetLuminance();
+				graylvl=gray.GetLuminance();
 		}
 
 		if ( nConfigOffsetType == 1 )
 			graylvl = graylvl - blacklvl;
-		lumlvl[i] = graylvl/whitelvl;
+		fit.lumlvl[i] = graylvl/whitelvl;
 	}
+	fit.Params.push_back ( whitelvl );
 
-	if ( nConfigOffsetType == 1 )
-		blacklvl = 0;
-
-
-	Gamma_opt = 1.0;
-	Offset_opt = 0.0;
+	if ( pCache && pCache -> IsSameFit ( fit ) )
+	{
+		*Gamma = pCache -> Gamma;
+		*Offset = pCache -> Offset;
+		return;
+	}
 
+	fit.Gamma = 1.0;
+	fit.Offset = 0.0;
 			
 	if ((Size > 2) && (whitelvl > 0))
 	{
 		switch ( nConfigOffsetType )
 		{
-		case 0:
-		case 1:
-			Offset_opt = 0;
-			break;
 		case 2:
 			if(GetConfig()->m_colorStandard == sRGB)
-				Offset_opt = 0.055;
+				fit.Offset = 0.055;
 			else
-				Offset_opt = 0.099;
+				fit.Offset = 0.099;
 			break;
 		case 3:
-			Offset_opt = GetConfig() -> m_manualGOffset;
-			break;
-		case 4: //bt.1886
-			{
-				Offset_opt = 0.0;
-			}
-			break;
-		case 5: //ST2084
-			{
-				Offset_opt = 0.0;
-			}
+			fit.Offset = GetConfig() -> m_manualGOffset;
 			break;
-		case 6: //L*
-			{
-				Offset_opt = 0.0;
-			}
-			break;
-		case 7: //BBC hgl
-			{
-				Offset_opt = 0.0;
-			}
+		default: // none, black compensation, bt.1886, ST2084, L*, BBC hlg
+			fit.Offset = 0.0;
 			break;
 		}
-			double x, v;
 
-			for (int i=0; i<Size; i++)
-			{
-				x = ArrayIndexToGrayLevel ( i, Size, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit);
-				v = GrayLevelToGrayProp(x, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit);
-				valx[i]=(v+Offset_opt)/(1.0+Offset_opt);
-			}
+		std::vector<double> valx ( Size );
+		for (int i=0; i<Size; i++)
+		{
+			double x = ArrayIndexToGrayLevel ( i, Size, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit);
+			double v = GrayLevelToGrayProp(x, GetConfig () -> m_bUseRoundDown, GetConfig () -> m_bUse10bit);
+			valx[i]=(v+fit.Offset)/(1.0+fit.Offset);
+		}
+
+		int mode = nConfigOffsetType;
+		if (GetConfig()->m_colorStandard == sRGB) mode = 99;
+		bool bUseEOTF = ( m_bBT1886 || mode > 5 || mode == 5 );	// !GetConfig()->m_useMeasuredGamma
+		double EOTFScale = ( m_bBT1886 || mode > 5 ) ? 1.0 : 100.;
 
-			int	nb = 0;
-			double avg = 0;
-			for (int i=1; i<Size-2; i++)
+		int	nb = 0;
+		double avg = 0;
+		for (int i=1; i<Size-2; i++)
+		{
+			if ( fit.lumlvl[i] > 0.0 )
 			{
-				if ( lumlvl[i] > 0.0 )
-				{
-					int mode = GetConfig()->m_GammaOffsetType;
-					if (GetConfig()->m_colorStandard == sRGB) mode = 99;
-                    if (m_bBT1886 || mode > 5) // !GetConfig()->m_useMeasuredGamma)
-                        avg += log(getL_EOTF(valx[i], GetMeasure()->GetGray(Size -1), GetMeasure()->GetGray(0), GetConfig()->m_GammaRel, GetConfig()->m_Split, mode, GetConfig()->m_DiffuseL, GetConfig()->m_MasterMinL, GetConfig()->m_MasterMaxL, GetConfig()->m_TargetMinL, GetConfig()->m_TargetMaxL,GetConfig()->m_useToneMap, FALSE, GetConfig()->m_TargetSysGamma, GetConfig()->m_BT2390_BS, GetConfig()->m_BT2390_WS, GetConfig()->m_BT2390_WS1))/log(valx[i]);
-                    else
-	                    if (mode == 5)// && !GetConfig()->m_useMeasuredGamma)
-			                avg += log(getL_EOTF(valx[i], GetMeasure()->GetGray(Size -1), GetMeasure()->GetGray(0), GetConfig()->m_GammaRel, GetConfig()->m_Split, mode, GetConfig()->m_DiffuseL, GetConfig()->m_MasterMinL, GetConfig()->m_MasterMaxL, GetConfig()->m_TargetMinL, GetConfig()->m_TargetMaxL,GetConfig()->m_useToneMap, FALSE, GetConfig()->m_TargetSysGamma, GetConfig()->m_BT2390_BS, GetConfig()->m_BT2390_WS, GetConfig()->m_BT2390_WS1) / 100.)/log(valx[i]);
-						else
-		    				avg += log(lumlvl[i])/log(valx[i]);
-					nb ++;
-				}
+				double lum = fit.lumlvl[i];
+				if ( bUseEOTF )
+					lum = getL_EOTF(valx[i], White, Black, GetConfig()->m_GammaRel, GetConfig()->m_Split, mode, GetConfig()->m_DiffuseL, GetConfig()->m_MasterMinL, GetConfig()->m_MasterMaxL, GetConfig()->m_TargetMinL, GetConfig()->m_TargetMaxL,GetConfig()->m_useToneMap, FALSE, GetConfig()->m_TargetSysGamma, GetConfig()->m_BT2390_BS, GetConfig()->m_BT2390_WS, GetConfig()->m_BT2390_WS1) / EOTFScale;
+				avg += log(lum)/log(valx[i]);
+				nb ++;
 			}
-			Gamma_opt = avg / ( nb ? nb : 1 );
+		}
+		fit.Gamma = avg / ( nb ? nb : 1 );
 	}
-	*Offset = Offset_opt;
-	*Gamma = Gamma_opt;
 
-	delete lumlvl;
-	delete valx;
-	delete tmpx;
+	*Offset = fit.Offset;
+	*Gamma = fit.Gamma;
+
+	if ( pCache )
+		pCache -> swap ( fit );
 }
 
+
 bool CDataSetDoc::CheckVideoLevel()
 {
 	if ( !m_pGenerator->m_b16_235 && GetConfig()->GetProfileInt("GDIGenerator","DisplayMode",DISPLAY_DEFAULT_MODE) != DISPLAY_ccast )
@@ -4294,6 +4578,14 @@ void CDataSetDoc::OnBkgndMeasureReady()
 	if ( g_hThread && ! g_bTerminateThread && this == g_pDataDocRunningThread )
 	{
 		EnterCriticalSection ( & g_CritSec );
+
+		// Each live readout already holds the ones before it
+		if ( g_bLiveAdjust )
+		{
+			while ( g_MeasuredColorList.GetCount () > 1 )
+				delete ( CColor * ) g_MeasuredColorList.RemoveHead ();
+		}
+
 		pos = g_MeasuredColorList.GetHeadPosition ();
 		POSITION pos2 = g_pDataDocRunningThread -> GetFirstViewPosition ();
 		
@@ -4315,7 +4607,15 @@ void CDataSetDoc::OnBkgndMeasureReady()
 			delete pMeasurement;
 		}
 		g_MeasuredColorList.RemoveAll ();
+		LiveReadout readout = g_LiveReadout;
 		LeaveCriticalSection ( & g_CritSec );
+
+		if ( g_bLiveAdjust && readout.count > 0 )
+		{
+			CString	Msg;
+			Msg.Format ( "Live readout: Y %.3f +/- %.3f cd/m2, %d readings%s", readout.XYZ[1], readout.band[1], readout.count, readout.bStable ? ", stable" : "" );
+			( (CFrameWnd *) AfxGetMainWnd () ) -> SetMessageText ( Msg );
+		}
 //		(CMDIFrameWnd *)AfxGetMainWnd()->SendMessage(WM_COMMAND,IDM_REFRESH_CONTROLS,NULL);	// refresh mainframe controls
 	}
 
@@ -76,6 +76,7 @@ class CDataSetFrameInfo;
 #include "Measure.h"
 #include "Sensors\Sensor.h"
 #include "Generators\Generator.h"
+#include <vector>
 
 #define WM_BKGND_MEASURE_READY	WM_USER + 1279
 
@@ -139,6 +140,10 @@ public:
 	BOOL ComputeAdjustmentMatrix();
 
 	void SetSelectedColor ( const CColor & clr )	{ m_SelectedColor = clr; }
+
+	// Measurement journal, holding the readings since the last snapshot of the document
+	void JournalReading ( const JournalRecord & record );
+	CJournalSnapshot * CreateSnapshot ();
 	void SetLastColor ( const CColor & clr )	{ m_LastColor = clr; }
 // Overrides
 	// ClassWizard generated virtual function overrides
@@ -177,6 +182,45 @@ protected:
 	
 	virtual void UpdateFrameCounts();
 	bool Settling;
+
+	void StoreDocument ( CArchive & ar );
+	void StoreDeviceObjects ( CArchive & ar );
+	CMeasurementJournal	m_journal;
+
+	// Last gamma fit computed by ComputeGammaAndOffset, with everything it was computed from
+	struct CGammaFitCache
+	{
+		int					ColorSpace;
+		int					ColorIndex;
+		int					Size;
+		bool				bBT1886;
+		std::vector<double>	Params;
+		std::vector<double>	lumlvl;
+		double				Gamma;
+		double				Offset;
+
+		CGammaFitCache () : ColorSpace(-1), ColorIndex(-1), Size(0), bBT1886(false), Gamma(1.0), Offset(0.0) {}
+
+		bool IsSameFit ( const CGammaFitCache & fit ) const
+		{
+			return ColorSpace == fit.ColorSpace && ColorIndex == fit.ColorIndex && Size == fit.Size
+				&& bBT1886 == fit.bBT1886 && Params == fit.Params && lumlvl == fit.lumlvl;
+		}
+
+		void swap ( CGammaFitCache & fit )
+		{
+			std::swap ( ColorSpace, fit.ColorSpace );
+			std::swap ( ColorIndex, fit.ColorIndex );
+			std::swap ( Size, fit.Size );
+			std::swap ( bBT1886, fit.bBT1886 );
+			Params.swap ( fit.Params );
+			lumlvl.swap ( fit.lumlvl );
+			std::swap ( Gamma, fit.Gamma );
+			std::swap ( Offset, fit.Offset );
+		}
+	};
+	// One slot per RGB component (ColorSpace 0) then ColorSpace 1 to 3
+	CGammaFitCache	m_GammaFitCache [ 6 ];
 friend class CMainView;
 
 // Generated message map functions
@@ -195,6 +239,7 @@ protected:
 	afx_msg void OnCalibrationManual();
 	afx_msg void OnCalibrationExisting();
 	afx_msg void OnCalibrationSpectralSample();
+	afx_msg void OnDisplayLatency();
 	afx_msg void OnSimGrayscale();
 	afx_msg void OnSimPrimaries();
 	afx_msg void OnSimSecondaries();
@@ -28,18 +28,70 @@
 #include "Exceptions.h"
 #include "Endianness.h"
 
-CHCFile::CHCFile ()
+namespace
 {
-  
+  uint32_t readUint32 (ifstream &file)
+  {
+    uint32_t value = 0;
+    file.read((char*)&value, 4);
+    return littleEndianUint32ToHost(value);
+  }
+
+  double readDouble (ifstream &file)
+  {
+    double value = 0.0;
+    file.read((char*)&value, 8);
+    return littleEndianDoubleToHost(value);
+  }
+
+  // borne la taille des tableaux, un fichier endommagé ne doit pas faire allouer n'importe quoi
+  const uint32_t maxArraySize = 100000;
+}
+
+CHCFile::CHCFile (bool keepEmptyMeasures) : keepEmptyMeasures(keepEmptyMeasures), measuresVersion(0), IREScaleMode(false), primeWhite(noDataColor)
+{
+  settings.isValid = false;
 }
 CHCFile::~CHCFile ()
 {
   
 }
 
+void CHCFile::readColors (ifstream &file, uint32_t count, list<CColor> &colors)
+{
+  if (count > maxArraySize || file.fail())
+    throw Exception("Invalid file format");
+
+  for (uint32_t loopIndex = 0; loopIndex < count; loopIndex ++)
+  {
+    if (file.fail())
+      throw Exception("Invalid file format");
+    CColor newColor (file);
+    if (keepEmptyMeasures || newColor.isValid())
+      colors.push_back(newColor);
+  }
+}
+
+// Depuis la version 13 des mesures, seules les mesures cc24 valides sont enregistrées,
+// chacune suivie de son indice, et la liste se termine par une couleur marqueur.
+void CHCFile::readSparseColors (ifstream &file, list<CColor> &colors)
+{
+  readUint32(file); // la taille du tableau, inutile ici
+
+  for (uint32_t loopIndex = 0; loopIndex <= maxArraySize && !file.fail(); loopIndex ++)
+  {
+    CColor newColor (file);
+    if (newColor.GetX() == 0.123 && newColor.GetY() == 0.456 && newColor.GetZ() == 0.789)
+      return;
+    readUint32(file); // l'indice
+    colors.push_back(newColor);
+  }
+  throw Exception("Invalid file format");
+}
+
 void CHCFile::readFile (const char* path)
 {
-  ifstream file(path);
+  ifstream file(path, ios::in | ios::binary);
   
   if (!file.is_open())
   {
@@ -47,16 +99,9 @@ void CHCFile::readFile (const char* path)
     throw Exception("Unable to open file");
   }
   
-  uint32_t header1;
-	uint32_t header2;
-	uint32_t version = 0;
-    
-  file.read((char*)&header1, 4);
-  header1 = littleEndianUint32ToHost(header1);
-  file.read((char*)&header2, 4);
-  header2 = littleEndianUint32ToHost(header2);
-  file.read((char*)&version, 4);
-  version = littleEndianUint32ToHost(version);
+  uint32_t header1 = readUint32(file);
+  uint32_t header2 = readUint32(file);
+  uint32_t version = readUint32(file);
   
   if( header1 != 0x4F4C4F43 || header2 != 0x46434852 )
   {
@@ -71,165 +116,166 @@ void CHCFile::readFile (const char* path)
   }
   
   // encore une version, mais ce n'est pas la même.
-  file.read((char*)&version, 4);
-  version = littleEndianUint32ToHost(version);
-  if(version > 6)
+  version = readUint32(file);
+  if(version > 17)
   {
     cout << "LibHCFR : CHCFile::readCalibrationFile : unreadable measures format version : " << version << endl;
     throw Exception("Cannot read this file version (yet)");
   }
-  
-  // maintenant, les "vrai" données
-  uint32_t  arraySize; // sera utilisé pour lire la taille des tableaux de Color
-  uint32_t  loopIndex; // pour les boucles de lecture
+  measuresVersion = version;
 
-  // les niveaux de gris
-  file.read((char*)&arraySize, 4);
-  arraySize = littleEndianUint32ToHost(arraySize);
-  for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
+  // les préférences, lues mais jamais appliquées
+  if (version > 16)
   {
-    CColor newColor (file);
-    if (newColor.isValid())
-      grayColors.push_back(newColor);
+    // BT.2390
+    readDouble(file);
+    readDouble(file);
+    readDouble(file);
   }
+  if (version > 15)
+    readDouble(file); // gamma système cible
+  if (version > 14)
+  {
+    // luminances du tone mapping
+    for (int i = 0; i < 6; i ++)
+      readDouble(file);
+    readUint32(file);
+    readUint32(file);
+    readDouble(file);
+  }
+  if (version > 13)
+    readUint32(file); // colonne d'écrêtage proche du blanc
+  if (version > 11)
+  {
+    settings.isValid = true;
+    settings.whiteTarget = readUint32(file);
+    settings.CCMode = readUint32(file);
+    settings.colorStandard = readUint32(file);
+    settings.dE_form = readUint32(file);
+    settings.dE_gray = readUint32(file);
+    settings.gwWeight = readUint32(file);
+    settings.gammaOffsetType = readUint32(file);
+    settings.gammaRef = readDouble(file);
+    settings.gammaRel = readDouble(file);
+    settings.split = readDouble(file);
+    settings.manualWhitex = readDouble(file);
+    settings.manualWhitey = readDouble(file);
+    settings.useMeasuredGamma = (readUint32(file) != 0);
+    settings.manualBluex = readDouble(file);
+    settings.manualRedx = readDouble(file);
+    settings.manualGreenx = readDouble(file);
+    settings.manualBluey = readDouble(file);
+    settings.manualRedy = readDouble(file);
+    settings.manualGreeny = readDouble(file);
+  }
+  if (version > 10)
+  {
+    // noir utilisateur
+    readUint32(file);
+    CColor userBlack (file);
+  }
+
+  // maintenant, les "vrai" données
+
+  // les niveaux de gris
+  readColors(file, readUint32(file), grayColors);
 
   // les proximité du blanc et du noir, en version > 2 uniquement
   if (version > 2)
   {
-    // proximité du noir
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        nearBlackColors.push_back(newColor);
-    }
-
-    // proximité du blanc
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        nearWhiteColors.push_back(newColor);
-    }
+    readColors(file, readUint32(file), nearBlackColors);
+    readColors(file, readUint32(file), nearWhiteColors);
   }
   
   // saturations à partir de la version 2
   if (version > 1)
   {
-    // saturation rouge
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        redSaturationColors.push_back(newColor);
-    }
+    readColors(file, readUint32(file), redSaturationColors);
+    readColors(file, readUint32(file), greenSaturationColors);
+    readColors(file, readUint32(file), blueSaturationColors);
+    readColors(file, readUint32(file), yellowSaturationColors);
+    readColors(file, readUint32(file), cyanSaturationColors);
+    readColors(file, readUint32(file), magentaSaturationColors);
 
-    // saturation vert
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
+    // saturation cc24 à partir de la version 8, puis les mires maîtres en version 10
+    if (version >= 8)
     {
-      CColor newColor (file);
-      if (newColor.isValid())
-        greenSaturationColors.push_back(newColor);
-    }
+      list<CColor> masterColors;
 
-    // saturation bleu
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        blueSaturationColors.push_back(newColor);
-    }
-
-    // saturation jaune
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        yellowSaturationColors.push_back(newColor);
-    }
-
-    // saturation cyan
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        cyanSaturationColors.push_back(newColor);
-    }
-
-    // saturation magenta
-    file.read((char*)&arraySize, 4);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        magentaSaturationColors.push_back(newColor);
-    }
-    // saturation cc24
-    file.read((char*)&arraySize, 24);
-    arraySize = littleEndianUint32ToHost(arraySize);
-    for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-    {
-      CColor newColor (file);
-      if (newColor.isValid())
-        cc24SaturationColors.push_back(newColor);
+      if (version <= 12)
+      {
+        readColors(file, readUint32(file), cc24SaturationColors);
+        if (version >= 10)
+          readColors(file, readUint32(file), masterColors);
+      }
+      else
+      {
+        readSparseColors(file, cc24SaturationColors);
+        readSparseColors(file, masterColors);
+      }
     }
   }
   
   // mesures libres
-  file.read((char*)&arraySize, 4);
-  arraySize = littleEndianUint32ToHost(arraySize);
-  for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-  {
-    CColor newColor (file);
-    if (newColor.isValid())
-      freeMeasuresColors.push_back(newColor);
-  }
+  readColors(file, readUint32(file), freeMeasuresColors);
   
   // les composantes primaires et secondaires
-  arraySize = 6;
-  for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
-  {
-    CColor newColor (file);
-    if (newColor.isValid())
-      componnentsColors.push_back(newColor);
-  }
+  readColors(file, 6, componnentsColors);
   
   // le contrat plein écran
-  arraySize = 2;
-  for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
+  readColors(file, 2, fullscreenContrastColors);
+  CColor onOffWhite = noDataColor;
+  if (!fullscreenContrastColors.empty())
+    onOffWhite = fullscreenContrastColors.back();
+
+  // le contrat ANSI
+  readColors(file, 2, ansiContrastColors);
+
+  // le blanc de référence, avant la version 9 c'était le blanc du contraste plein écran
+  if (version > 8)
+    primeWhite = CColor (file);
+  else if (onOffWhite.isValid())
+    primeWhite = onOffWhite;
+
+  // la description
+  delete [] readCString(file);
+
+  if (version > 4 && version < 7)
   {
-    CColor newColor (file);
-    if (newColor.isValid())
-      fullscreenContrastColors.push_back(newColor);
+    // l'ancienne matrice d'ajustement
+    readUint32(file);
+    Matrix adjustmentMatrix (file);
+    delete [] readCString(file);
   }
 
-  // le contrat ANSI
-  arraySize = 2;
-  for (loopIndex = 0; loopIndex < arraySize; loopIndex ++)
+  if (version > 5)
+    IREScaleMode = (readUint32(file) != 0);
+
+  if (file.fail())
   {
-    CColor newColor (file);
-    if (newColor.isValid())
-      ansiContrastColors.push_back(newColor);
+    cout << "LibHCFR : CHCFile::readFile : unexpected end of file" << endl;
+    throw Exception("Invalid file format");
   }
   
   file.close();
 }
 
+uint32_t CHCFile::getMeasuresVersion () const
+{
+  return measuresVersion;
+}
+const CHCFileSettings& CHCFile::getSettings () const
+{
+  return settings;
+}
+bool CHCFile::isIREScaleMode () const
+{
+  return IREScaleMode;
+}
+const CColor& CHCFile::getPrimeWhite () const
+{
+  return primeWhite;
+}
 list<CColor>& CHCFile::getGrayColors ()
 {
   return grayColors;
@@ -28,13 +28,41 @@
 
 #include "Color.h"
 #include <time.h>
+#include <stdint.h>
 #include <list>
 
 using namespace std;
 
+// Preferences saved with the measures (measures format 12 and above).
+// The reader only reports them: loading a file never applies them.
+struct CHCFileSettings
+{
+  bool    isValid;
+  int     whiteTarget;
+  int     CCMode;
+  int     colorStandard;
+  int     dE_form;
+  int     dE_gray;
+  int     gwWeight;
+  int     gammaOffsetType;
+  double  gammaRef;
+  double  gammaRel;
+  double  split;
+  double  manualWhitex, manualWhitey;
+  bool    useMeasuredGamma;
+  double  manualRedx, manualRedy;
+  double  manualGreenx, manualGreeny;
+  double  manualBluex, manualBluey;
+};
+
 class CHCFile
 {
 private :
+  bool            keepEmptyMeasures; // garde les mesures vides, la position dans la liste est alors l'indice du patch
+  uint32_t        measuresVersion; // la version du format des mesures lue
+  CHCFileSettings settings; // les préférences enregistrées avec les mesures
+  bool            IREScaleMode; // niveaux de gris en IRE
+  CColor          primeWhite; // le blanc de référence des couleurs
   list<CColor>    grayColors; // la liste contenant les mesures de niveau de gris
   list<CColor>    nearBlackColors; // la liste contenant les mesures de niveau de gris a proximité du noir
   list<CColor>    nearWhiteColors; // la liste contenant les mesures de niveau de gris a proximité du blanc
@@ -53,14 +81,23 @@ private :
   list<CColor>    ansiContrastColors; // la liste contenant les mesures de contrast dans l'ordre suivant :
                                              // ON OFF
 
+  void readColors (ifstream &file, uint32_t count, list<CColor> &colors);
+  void readSparseColors (ifstream &file, list<CColor> &colors);
   
 public :
-  CHCFile();
+  // Par défaut, les mesures vides sont ignorées
+  CHCFile(bool keepEmptyMeasures = false);
   ~CHCFile();
   
   // Attention, cette fonction est susceptible de lever une exception en cas de problème.
+  // Seules les mesures sont lues : les préférences du fichier ne sont que rapportées
+  // par getSettings, et les capteur et générateur qui suivent sont ignorés.
   void readFile (const char* path);
   
+  uint32_t getMeasuresVersion () const;
+  const CHCFileSettings& getSettings () const;
+  bool isIREScaleMode () const;
+  const CColor& getPrimeWhite () const;
   list<CColor>& getGrayColors ();
   list<CColor>& getNearBlackColors ();
   list<CColor>& getNearWhiteColors ();
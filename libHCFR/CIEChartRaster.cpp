@@ -0,0 +1,392 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// CIEChartRaster.cpp : platform independent CIE chart colour rendering
+//
+
+#include "CIEChartRaster.h"
+#include "ParallelJob.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#	include <windows.h>
+#	include <sys/utime.h>
+#else
+#	include <dirent.h>
+#	include <utime.h>
+#endif
+
+// Change when the rendering changes, to invalidate cached files
+#define CIE_RASTER_VERSION	1
+
+// Rows computed by one work item
+#define CIE_RASTER_BAND		16
+
+namespace
+{
+	class CRenderCIEChartJob : public CParallelJob
+	{
+	public:
+		CRenderCIEChartJob ( const CIEChartRasterDesc & desc, unsigned int * pPixels );
+		virtual void Run ( int nItem );
+
+	private:
+		unsigned int PixelColor ( int x, int y ) const;
+
+		const CIEChartRasterDesc & m_desc;
+		unsigned int * m_pPixels;
+		double m_xw, m_yw;
+		double m_rx, m_ry, m_rz, m_gx, m_gy, m_gz, m_bx, m_by, m_bz;
+	};
+
+	CRenderCIEChartJob::CRenderCIEChartJob ( const CIEChartRasterDesc & desc, unsigned int * pPixels ) :
+		m_desc ( desc ),
+		m_pPixels ( pPixels )
+	{
+		// Same Rec709 primaries based xyz -> rgb conversion as DrawCIEChart
+		const double xr = 0.6400;
+		const double yr = 0.3300;
+		const double zr = 1 - (xr + yr);
+
+		const double xg = 0.3000;
+		const double yg = 0.6000;
+		const double zg = 1 - (xg + yg);
+
+		const double xb = 0.1500;
+		const double yb = 0.0600;
+		const double zb = 1 - (xb + yb);
+
+		double sum = desc.whiteXYZ [ 0 ] + desc.whiteXYZ [ 1 ] + desc.whiteXYZ [ 2 ];
+		m_xw = desc.whiteXYZ [ 0 ] / sum;
+		m_yw = desc.whiteXYZ [ 1 ] / sum;
+		const double zw = 1 - (m_xw + m_yw);
+
+		m_rx = yg*zb - yb*zg;
+		m_ry = xb*zg - xg*zb;
+		m_rz = xg*yb - xb*yg;
+		m_gx = yb*zr - yr*zb;
+		m_gy = xr*zb - xb*zr;
+		m_gz = xb*yr - xr*yb;
+		m_bx = yr*zg - yg*zr;
+		m_by = xg*zr - xr*zg;
+		m_bz = xr*yg - xg*yr;
+
+		const double rw = (m_rx*m_xw + m_ry*m_yw + m_rz*zw) / m_yw;
+		const double gw = (m_gx*m_xw + m_gy*m_yw + m_gz*zw) / m_yw;
+		const double bw = (m_bx*m_xw + m_by*m_yw + m_bz*zw) / m_yw;
+
+		m_rx /= rw;
+		m_ry /= rw;
+		m_rz /= rw;
+		m_gx /= gw;
+		m_gy /= gw;
+		m_gz /= gw;
+		m_bx /= bw;
+		m_by /= bw;
+		m_bz /= bw;
+	}
+
+	unsigned int CRenderCIEChartJob::PixelColor ( int x, int y ) const
+	{
+		const double squared_white_ray = 0.02;	// defines a diffusion zone around white point
+		const double gamma = 1.0 / 2.2;
+		const int cxMax = m_desc.cx;
+		const int cyMax = m_desc.cy;
+		double xCie, yCie, zCie, yCieLine, d;
+		double val_r, val_g, val_b, val_min, val_max;
+
+		if ( m_desc.nDiagram == CIE_DIAGRAM_AB )
+			yCieLine = (double) (( cyMax - y ) * (400.)) / (double) cyMax - 200;
+		else
+			yCieLine = (double) (( cyMax - y ) * (m_desc.nDiagram == CIE_DIAGRAM_UV ? 0.8 : 1.0)) / (double) cyMax - 0.05;
+
+		if ( m_desc.nDiagram == CIE_DIAGRAM_UV )
+		{
+			// Use CIE u'v' coordinates: convert them into CIE xy coordinates to define pixel color
+			double uCie = (double) (x * 0.8) / (double) cxMax - 0.075;
+			double vCie = yCieLine;
+
+			xCie = ( 9.0 * uCie ) / ( ( 6.0 * uCie ) - ( 16.0 * vCie ) + 12.0 );
+			yCie = ( 4.0 * vCie ) / ( ( 6.0 * uCie ) - ( 16.0 * vCie ) + 12.0 );
+		}
+		else if ( m_desc.nDiagram == CIE_DIAGRAM_AB )
+		{
+			const double ep = 216. / 24389.;
+			const double kap = 24389. / 27.;
+			double fx = ((double) (x * 400.) / (double) cxMax - 220.) / 500. + 1;
+			double fz = 1.0 - yCieLine / 200.;
+			double lxr, lzr;
+
+			if ( fx * fx * fx > ep )
+				lxr = fx * fx * fx;
+			else
+				lxr = (116. * fx - 16.) / kap;
+
+			if ( fz * fz * fz > ep )
+				lzr = fz * fz * fz;
+			else
+				lzr = (116 * fz -16) / kap;
+
+			double X = (lxr * m_desc.whiteXYZ [ 0 ]);
+			double Y = m_desc.whiteXYZ [ 1 ];
+			double Z = (lzr * m_desc.whiteXYZ [ 2 ]);
+
+			xCie = X / (X + Y + Z);
+			yCie = Y / (X + Y + Z);
+		}
+		else
+		{
+			xCie = (double) (x * 0.9) / (double) cxMax - 0.075;
+			yCie = yCieLine;
+		}
+
+		// Test if we are inside white circle to enlight
+		d = (xCie-m_xw)*(xCie-m_xw) + (yCie-m_yw)*(yCie-m_yw);
+		if ( d < squared_white_ray && m_desc.nDiagram != CIE_DIAGRAM_AB )
+		{
+			// Enlarge smoothly white zone
+			d = sqrt ( d / squared_white_ray );
+			xCie = m_xw + (xCie - m_xw ) * d;
+			yCie = m_yw + (yCie - m_yw ) * d;
+		}
+
+		zCie = 1.0 - ( xCie + yCie );
+
+		val_r = m_rx*xCie + m_ry*yCie + m_rz*zCie;
+		val_g = m_gx*xCie + m_gy*yCie + m_gz*zCie;
+		val_b = m_bx*xCie + m_by*yCie + m_bz*zCie;
+
+		val_min = ( val_r < val_g ? val_r : val_g );
+		if ( val_b < val_min )
+			val_min = val_b;
+
+		if ( val_min < 0 )
+		{
+			val_r -= val_min;
+			val_g -= val_min;
+			val_b -= val_min;
+		}
+
+		// Scale to max(rgb) = 1
+		val_max = ( val_r > val_g ? val_r : val_g );
+		if ( val_b > val_max )
+			val_max = val_b;
+
+		if ( val_max > 0 )
+		{
+			val_r /= val_max;
+			val_g /= val_max;
+			val_b /= val_max;
+		}
+
+		unsigned int r = (unsigned int)(pow(val_r,gamma) * m_desc.nMaxRgbVal);
+		unsigned int g = (unsigned int)(pow(val_g,gamma) * m_desc.nMaxRgbVal);
+		unsigned int b = (unsigned int)(pow(val_b,gamma) * m_desc.nMaxRgbVal);
+
+		return ( ( r & 0xFF ) << 16 ) | ( ( g & 0xFF ) << 8 ) | ( b & 0xFF );
+	}
+
+	void CRenderCIEChartJob::Run ( int nItem )
+	{
+		int yStart = nItem * CIE_RASTER_BAND;
+		int yEnd = yStart + CIE_RASTER_BAND;
+
+		if ( yEnd > m_desc.cy )
+			yEnd = m_desc.cy;
+
+		for ( int y = yStart; y < yEnd; y ++ )
+		{
+			unsigned int * pRow = m_pPixels + (size_t) y * m_desc.cx;
+			for ( int x = 0; x < m_desc.cx; x ++ )
+				pRow [ x ] = PixelColor ( x, y );
+		}
+	}
+
+	struct CIEChartRasterFileHeader
+	{
+		char				magic [ 8 ];
+		int					nVersion;
+		CIEChartRasterDesc	desc;
+	};
+
+	void GetCacheFileName ( const CIEChartRasterDesc & desc, const char * cacheDir, char * szFileName, size_t nSize )
+	{
+		// White point in the name keeps charts for several references side by side
+		snprintf ( szFileName, nSize, "%s/CIEChart_%d_%dx%d_%d_%.6f_%.6f_%.6f.bin", cacheDir,
+				   desc.nDiagram, desc.cx, desc.cy, desc.nMaxRgbVal,
+				   desc.whiteXYZ [ 0 ], desc.whiteXYZ [ 1 ], desc.whiteXYZ [ 2 ] );
+		szFileName [ nSize - 1 ] = '\0';
+	}
+
+	void FillHeader ( const CIEChartRasterDesc & desc, CIEChartRasterFileHeader & header )
+	{
+		memset ( & header, 0, sizeof ( header ) );
+		memcpy ( header.magic, "HCFRCIE", 8 );
+		header.nVersion = CIE_RASTER_VERSION;
+		header.desc = desc;
+	}
+
+	bool LoadCIEChartRaster ( const CIEChartRasterDesc & desc, const char * cacheDir, std::vector<unsigned int> & pixels )
+	{
+		char szFileName [ 512 ];
+		CIEChartRasterFileHeader expected, header;
+		size_t nPixels = (size_t) desc.cx * desc.cy;
+		bool bOk = false;
+
+		GetCacheFileName ( desc, cacheDir, szFileName, sizeof ( szFileName ) );
+		FILE * f = fopen ( szFileName, "rb" );
+		if ( f == NULL )
+			return false;
+
+		FillHeader ( desc, expected );
+		if ( fread ( & header, sizeof ( header ), 1, f ) == 1 && memcmp ( & header, & expected, sizeof ( header ) ) == 0 )
+		{
+			pixels.resize ( nPixels );
+			bOk = ( fread ( & pixels [ 0 ], sizeof ( unsigned int ), nPixels, f ) == nPixels );
+		}
+		fclose ( f );
+		return bOk;
+	}
+
+	void SaveCIEChartRaster ( const CIEChartRasterDesc & desc, const char * cacheDir, const std::vector<unsigned int> & pixels )
+	{
+		char szFileName [ 512 ];
+		CIEChartRasterFileHeader header;
+
+		GetCacheFileName ( desc, cacheDir, szFileName, sizeof ( szFileName ) );
+		FILE * f = fopen ( szFileName, "wb" );
+		if ( f == NULL )
+			return;
+
+		FillHeader ( desc, header );
+		bool bOk = ( fwrite ( & header, sizeof ( header ), 1, f ) == 1 )
+				&& ( fwrite ( & pixels [ 0 ], sizeof ( unsigned int ), pixels.size (), f ) == pixels.size () );
+		fclose ( f );
+
+		// Never leave a truncated file behind
+		if ( ! bOk )
+			remove ( szFileName );
+	}
+
+	// A cache hit makes the file the most recently used one
+	void TouchCacheFile ( const CIEChartRasterDesc & desc, const char * cacheDir )
+	{
+		char szFileName [ 512 ];
+
+		GetCacheFileName ( desc, cacheDir, szFileName, sizeof ( szFileName ) );
+#ifdef LIBHCFR_HAS_WIN32_API
+		_utime ( szFileName, NULL );
+#else
+		utime ( szFileName, NULL );
+#endif
+	}
+
+	// Cached chart files of cacheDir with their modification time
+	void ListCacheFiles ( const char * cacheDir, std::vector< std::pair<time_t,std::string> > & files )
+	{
+		std::vector<std::string> names;
+
+#ifdef LIBHCFR_HAS_WIN32_API
+		WIN32_FIND_DATAA findData;
+		std::string pattern = std::string ( cacheDir ) + "/CIEChart_*.bin";
+		HANDLE hFind = FindFirstFileA ( pattern.c_str (), & findData );
+		if ( hFind != INVALID_HANDLE_VALUE )
+		{
+			do
+				names.push_back ( findData.cFileName );
+			while ( FindNextFileA ( hFind, & findData ) );
+			FindClose ( hFind );
+		}
+#else
+		DIR * pDir = opendir ( cacheDir );
+		if ( pDir )
+		{
+			struct dirent * pEntry;
+			while ( ( pEntry = readdir ( pDir ) ) != NULL )
+			{
+				size_t nLength = strlen ( pEntry -> d_name );
+				if ( strncmp ( pEntry -> d_name, "CIEChart_", 9 ) == 0 && nLength > 13 && strcmp ( pEntry -> d_name + nLength - 4, ".bin" ) == 0 )
+					names.push_back ( pEntry -> d_name );
+			}
+			closedir ( pDir );
+		}
+#endif
+
+		for ( size_t i = 0; i < names.size (); i ++ )
+		{
+			struct stat fileStat;
+			std::string path = std::string ( cacheDir ) + "/" + names [ i ];
+			if ( stat ( path.c_str (), & fileStat ) == 0 )
+				files.push_back ( std::make_pair ( fileStat.st_mtime, path ) );
+		}
+	}
+}
+
+void RenderCIEChartRaster ( const CIEChartRasterDesc & desc, std::vector<unsigned int> & pixels )
+{
+	pixels.resize ( (size_t) desc.cx * desc.cy );
+	if ( pixels.empty () )
+		return;
+
+	CRenderCIEChartJob job ( desc, & pixels [ 0 ] );
+	RunParallelJob ( job, ( desc.cy + CIE_RASTER_BAND - 1 ) / CIE_RASTER_BAND );
+}
+
+void GetCIEChartRaster ( const CIEChartRasterDesc & desc, const char * cacheDir, std::vector<unsigned int> & pixels )
+{
+	if ( cacheDir && LoadCIEChartRaster ( desc, cacheDir, pixels ) )
+	{
+		TouchCacheFile ( desc, cacheDir );
+		return;
+	}
+
+	RenderCIEChartRaster ( desc, pixels );
+
+	if ( cacheDir && ! pixels.empty () )
+	{
+		SaveCIEChartRaster ( desc, cacheDir, pixels );
+		TrimCIEChartCache ( cacheDir, CIE_RASTER_CACHE_FILES, & desc );
+	}
+}
+
+int TrimCIEChartCache ( const char * cacheDir, int nKeep, const CIEChartRasterDesc * pKeptDesc )
+{
+	std::vector< std::pair<time_t,std::string> > files;
+	char szKept [ 512 ] = "";
+
+	ListCacheFiles ( cacheDir, files );
+	if ( (int) files.size () <= nKeep )
+		return (int) files.size ();
+
+	// Charts written in the same second sort by name, never drop the one just written
+	if ( pKeptDesc )
+		GetCacheFileName ( * pKeptDesc, cacheDir, szKept, sizeof ( szKept ) );
+
+	std::sort ( files.begin (), files.end () );
+	int nLeft = (int) files.size ();
+	for ( size_t i = 0; i < files.size () && nLeft > nKeep; i ++ )
+	{
+		if ( files [ i ].second != szKept && remove ( files [ i ].second.c_str () ) == 0 )
+			nLeft --;
+	}
+	return nLeft;
+}
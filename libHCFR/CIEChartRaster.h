@@ -0,0 +1,66 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// CIEChartRaster.h : platform independent CIE chart colour rendering
+//
+// The colour field of the CIE diagrams is computed into a plain pixel
+// buffer, one band of rows per work item, so that it can be spread over
+// all processors. Rendered buffers are cached on disk, keyed by diagram,
+// size and white point, so that a chart is only computed once. A file
+// is about 5.6 MB at the application's chart size, only the
+// CIE_RASTER_CACHE_FILES most recently used ones are kept.
+//////////////////////////////////////////////////////////////////////
+
+#if !defined(CIECHARTRASTER_H_INCLUDED_)
+#define CIECHARTRASTER_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include <stddef.h>
+#include <vector>
+
+// The six charts of the application for two white points
+#define CIE_RASTER_CACHE_FILES	12
+
+enum CIEChartDiagram
+{
+	CIE_DIAGRAM_XY = 0,
+	CIE_DIAGRAM_UV = 1,
+	CIE_DIAGRAM_AB = 2
+};
+
+struct CIEChartRasterDesc
+{
+	int		cx;				// Width in pixels
+	int		cy;				// Height in pixels
+	int		nDiagram;		// CIEChartDiagram
+	int		nMaxRgbVal;		// Brightest channel value
+	double	whiteXYZ [ 3 ];	// Reference white
+};
+
+// Fill pixels with the colour of every point of the diagram, as 32 bits
+// 0x00RRGGBB values in top-down rows (the layout of a 32 bits DIB).
+// Pixels are computed everywhere: the caller clips to the tongue.
+void RenderCIEChartRaster ( const CIEChartRasterDesc & desc, std::vector<unsigned int> & pixels );
+
+// Same as RenderCIEChartRaster, using the on disk cache stored in
+// cacheDir when possible. cacheDir may be NULL to disable the cache.
+void GetCIEChartRaster ( const CIEChartRasterDesc & desc, const char * cacheDir, std::vector<unsigned int> & pixels );
+
+// Remove the least recently used cached charts of cacheDir beyond nKeep,
+// but not the one of pKeptDesc when given. Returns the charts left.
+int TrimCIEChartCache ( const char * cacheDir, int nKeep, const CIEChartRasterDesc * pKeptDesc = NULL );
+
+#endif // !defined(CIECHARTRASTER_H_INCLUDED_)
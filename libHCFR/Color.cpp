@@ -31,10 +31,15 @@
 #include "Endianness.h"
 #include "CriticalSection.h"
 #include "LockWhileInScope.h"
+#include "PatchSetFile.h"
+#include "ColorCheckerTables.h"
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 #include <stdexcept>
 #include <sstream>
+#include <map>
+#include <algorithm>
 
 // critical section to be used in this file to
 // ensure config matrices don't get changed mid-calculation
@@ -1433,7 +1438,7 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 //			outL = (Lbt + minL * (1 - split / 100.))/(maxL + minL * (1 - split / 100.));
 		break;
 		case 5: //BT.2084
-			outL = pow(max(pow(valx,1.0 / m2) - c1,0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
+			outL = pow(max(pow(valx,1.0 / m2) - c1,0.0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
 			outL = outL * 10000. / 100.00 * m_diffuseL / 94.37844; 
 			outL = min(outL, m_MaxTL / 100.0);
 //			outL = min(outL, 100.0);
@@ -1467,7 +1472,7 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 			double E1,E2,E4,b,d,KS,T,p;
 			if (!cBT2390)
 			{
-				double tmWhite = getL_EOTF(0.5022283, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, TRUE, bbc_gamma, b_fact, E2_fact) * 100.0;
+				double tmWhite = getL_EOTF(0.5022283, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, true, bbc_gamma, b_fact, E2_fact) * 100.0;
 				m_MaxML = m_MaxML * m_diffuseL / 94.37844 ; 
 
 				if (m_MinML > m_MinTL)
@@ -1504,13 +1509,13 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 					p = min(1.0 / b, 4 * b_fact);
 					E3 = E2 + b * pow((1.0 - E2),p);
 					E3 = (E3 * d + pow( (c1 + c2 * pow(m_MinML/Scale,m1)) / (1 + c3 * pow(m_MinML/Scale,m1)), m2)); 
-					E4 = pow(max(pow(E3,1.0 / m2) - c1,0) / (c2 - c3 * pow(E3, 1.0 / m2)), 1.0 / m1);
+					E4 = pow(max(pow(E3,1.0 / m2) - c1,0.0) / (c2 - c3 * pow(E3, 1.0 / m2)), 1.0 / m1);
 					outL = E4 * 10000. / 100.00 * m_diffuseL / 94.37844;
 					outL = min(outL, m_MaxTL / 100.0 );
 				}
 				else
 				{
-					outL = pow(max(pow(valx,1.0 / m2) - c1,0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
+					outL = pow(max(pow(valx,1.0 / m2) - c1,0.0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
 					outL = outL * 10000. / 100.00 * m_diffuseL / 94.37844; 
 					outL = min(outL, m_MaxTL / 100.0);
 //					outL = min(outL, 100.0);
@@ -1564,13 +1569,13 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 						p = min(1.0 / b, 4 * b_fact); //Hoech mod
 						E3 = E2 + b * pow((1.0 - E2),p);
 						E3 = (E3 * d + pow( (c1 + c2 * pow(m_MinML/Scale,m1)) / (1 + c3 * pow(m_MinML/Scale,m1)), m2)); 
-						E4 = pow(max(pow(E3,1.0 / m2) - c1,0) / (c2 - c3 * pow(E3, 1.0 / m2)), 1.0 / m1);
+						E4 = pow(max(pow(E3,1.0 / m2) - c1,0.0) / (c2 - c3 * pow(E3, 1.0 / m2)), 1.0 / m1);
 						outL = E4 * 10000. / 100.00 * m_diffuseL / 94.37844;
 						outL = min(outL, m_MaxTL / 100.0);
 					}
 					else
 					{
-						outL = pow(max(pow(valx,1.0 / m2) - c1,0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
+						outL = pow(max(pow(valx,1.0 / m2) - c1,0.0) / (c2 - c3 * pow(valx, 1.0 / m2)), 1.0 / m1);
 						outL = outL * 10000. / 100.00 * m_diffuseL / 94.37844; 
 						outL = min(outL, m_MaxTL / 100.0);
 //						outL = min(outL, 100.0);
@@ -1582,10 +1587,10 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 		break;
 		case -10: //BT.2084/2390 inverse curve look-up
 			{
-//				double tmWhite = getL_EOTF(0.5022283, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, TRUE, bbc_gamma, b_fact, E2_fact, E2_fact1) * 100.0;
+//				double tmWhite = getL_EOTF(0.5022283, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, true, bbc_gamma, b_fact, E2_fact, E2_fact1) * 100.0;
 //				m_MaxML = m_MaxML * tmWhite / 94.37844;
 //				m_MaxML = m_MaxML * m_diffuseL / 94.37844 ; 
-				getL_EOTF(valx, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, TRUE, bbc_gamma, b_fact, E2_fact, E2_fact1);
+				getL_EOTF(valx, White, Black, g_rel, split, 5, m_diffuseL, m_MinML, m_MaxML, m_MinTL, m_MaxTL, ToneMap, true, bbc_gamma, b_fact, E2_fact, E2_fact1);
 				value = abs(valx - BT2390y[0]);
 				outL = BT2390x[0];
 				for (int i = 0; i < (int)BT2390y.size(); i++)
@@ -1654,7 +1659,37 @@ double getL_EOTF ( double valx, CColor White, CColor Black, double g_rel, double
 			}
 		break;
 	}
-	return min(max(0,outL),100);
+	return min(max(0.0,outL),100.0);
+}
+
+double GetDeltaE2000(double L1, double a1, double b1, double L2, double a2, double b2)
+{
+	// CIEDE2000 between reference L1a1b1 and L2a2b2
+	double Lp = (L1 + L2) / 2.0;
+	double C1 = sqrt( pow(a1, 2.0) + pow(b1, 2.0) );
+	double C2 = sqrt( pow(a2, 2.0) + pow(b2, 2.0) );
+	double C = (C1 + C2) / 2.0;
+	double G = (1 - sqrt ( pow(C, 7.0) / (pow(C, 7.0) + pow(25, 7.0)) ) ) / 2;
+	double a1p = a1 * (1 + G);
+	double a2p = a2 * (1 + G);
+	double C1p = sqrt ( pow(a1p, 2.0) + pow(b1, 2.0) );
+	double C2p = sqrt ( pow(a2p, 2.0) + pow(b2, 2.0) );
+	double Cp = (C1p + C2p) / 2.0;
+	double h1p = (atan2(b1, a1p) >= 0?atan2(b1, a1p):atan2(b1, a1p) + PI * 2.0);
+	double h2p = (atan2(b2, a2p) >= 0?atan2(b2, a2p):atan2(b2, a2p) + PI * 2.0);
+	double Hp = ( abs(h1p - h2p) > PI ?(h1p + h2p + PI * 2) / 2.0:(h1p + h2p) / 2.0);
+	double T = 1 - 0.17 * cos(Hp - 30. / 180. * PI) + 0.24 * cos(2 * Hp) + 0.32 * cos(3 * Hp + 6.0 / 180. * PI) - 0.20 * cos(4 * Hp - 63.0 / 180. * PI);
+	double dhp = ( abs(h2p - h1p) <= PI?(h2p - h1p):((h2p <= h1p)?(h2p - h1p + 2 * PI):(h2p - h1p - 2 * PI)));
+	double dLp = L2 - L1;
+	double dCp = C2p - C1p;
+	double dHp = 2 * sqrt( C1p * C2p ) * sin( dhp / 2);
+	double SL = 1 + (0.015 * pow( (Lp - 50), 2.0 ) / sqrt( 20 + pow( Lp - 50, 2.0) ) );
+	double SC = 1 + 0.045 * Cp;
+	double SH = 1 + 0.015 * Cp * T;
+	double dtheta = 30 * exp( -1.0 * pow(( (Hp * 180. / PI - 275.0) / 25.0), 2.0) );
+	double RC = 2 * sqrt ( pow(Cp, 7.0) / (pow(Cp, 7.0) + pow(25.0, 7.0)) );
+	double RT = -1.0 * RC * sin(2 * dtheta / 180. * PI);
+	return sqrt ( pow( dLp / SL, 2.0) + pow( dCp / SC, 2.0) + pow( dHp / SH, 2.0) + RT * (dCp / SC) * (dHp / SH));
 }
 
 double ColorXYZ::GetDeltaE(double YWhite, const ColorXYZ& refColor, double YWhiteRef, const CColorReference & colorReference, int dE_form, bool isGS, int gw_Weight ) const
@@ -1719,37 +1754,7 @@ double ColorXYZ::GetDeltaE(double YWhite, const ColorXYZ& refColor, double YWhit
 			//CIE2000
 			ColorLab LabRef(refColor, YWhiteRef, cRef);
 			ColorLab Lab(*this, YWhite, cRef);
-			double L1 = LabRef[0];
-			double L2 = Lab[0];
-			double Lp = (L1 + L2) / 2.0;
-			double a1 = LabRef[1];
-			double a2 = Lab[1];
-			double b1 = LabRef[2];
-			double b2 = Lab[2];
-			double C1 = sqrt( pow(a1, 2.0) + pow(b1, 2.0) );
-			double C2 = sqrt( pow(a2, 2.0) + pow(b2, 2.0) );
-			double C = (C1 + C2) / 2.0;
-			double G = (1 - sqrt ( pow(C, 7.0) / (pow(C, 7.0) + pow(25, 7.0)) ) ) / 2;
-			double a1p = a1 * (1 + G);
-			double a2p = a2 * (1 + G);
-			double C1p = sqrt ( pow(a1p, 2.0) + pow(b1, 2.0) );
-			double C2p = sqrt ( pow(a2p, 2.0) + pow(b2, 2.0) );
-			double Cp = (C1p + C2p) / 2.0;
-			double h1p = (atan2(b1, a1p) >= 0?atan2(b1, a1p):atan2(b1, a1p) + PI * 2.0);
-			double h2p = (atan2(b2, a2p) >= 0?atan2(b2, a2p):atan2(b2, a2p) + PI * 2.0);
-			double Hp = ( abs(h1p - h2p) > PI ?(h1p + h2p + PI * 2) / 2.0:(h1p + h2p) / 2.0);
-			double T = 1 - 0.17 * cos(Hp - 30. / 180. * PI) + 0.24 * cos(2 * Hp) + 0.32 * cos(3 * Hp + 6.0 / 180. * PI) - 0.20 * cos(4 * Hp - 63.0 / 180. * PI);
-			double dhp = ( abs(h2p - h1p) <= PI?(h2p - h1p):((h2p <= h1p)?(h2p - h1p + 2 * PI):(h2p - h1p - 2 * PI)));
-			double dLp = L2 - L1;
-			double dCp = C2p - C1p;
-			double dHp = 2 * sqrt( C1p * C2p ) * sin( dhp / 2);
-			double SL = 1 + (0.015 * pow( (Lp - 50), 2.0 ) / sqrt( 20 + pow( Lp - 50, 2.0) ) );
-			double SC = 1 + 0.045 * Cp;
-			double SH = 1 + 0.015 * Cp * T;
-			double dtheta = 30 * exp( -1.0 * pow(( (Hp * 180. / PI - 275.0) / 25.0), 2.0) );
-			double RC = 2 * sqrt ( pow(Cp, 7.0) / (pow(Cp, 7.0) + pow(25.0, 7.0)) );
-			double RT = -1.0 * RC * sin(2 * dtheta / 180. * PI);
-			dE = sqrt ( pow( dLp / SL, 2.0) + pow( dCp / SC, 2.0) + pow( dHp / SH, 2.0) + RT * (dCp / SC) * (dHp / SH));
+			dE = GetDeltaE2000(LabRef[0], LabRef[1], LabRef[2], Lab[0], Lab[1], Lab[2]);
 			break;
 		}
 		case 4:
@@ -1794,37 +1799,7 @@ double ColorXYZ::GetDeltaE(double YWhite, const ColorXYZ& refColor, double YWhit
         		//CIE2000
                 ColorLab LabRef(refColor, YWhiteRef, cRef);
                 ColorLab Lab(*this, YWhite, cRef);
-		        double L1 = LabRef[0];
-		        double L2 = Lab[0];
-		        double Lp = (L1 + L2) / 2.0;
-		        double a1 = LabRef[1];
-		        double a2 = Lab[1];
-		        double b1 = LabRef[2];
-		        double b2 = Lab[2];
-		        double C1 = sqrt( pow(a1, 2.0) + pow(b1, 2.0) );
-		        double C2 = sqrt( pow(a2, 2.0) + pow(b2, 2.0) );
-		        double C = (C1 + C2) / 2.0;
-		        double G = (1 - sqrt ( pow(C, 7.0) / (pow(C, 7.0) + pow(25, 7.0)) ) ) / 2;
-		        double a1p = a1 * (1 + G);
-		        double a2p = a2 * (1 + G);
-		        double C1p = sqrt ( pow(a1p, 2.0) + pow(b1, 2.0) );
-		        double C2p = sqrt ( pow(a2p, 2.0) + pow(b2, 2.0) );
-		        double Cp = (C1p + C2p) / 2.0;
-		        double h1p = (atan2(b1, a1p) >= 0?atan2(b1, a1p):atan2(b1, a1p) + PI * 2.0);
-		        double h2p = (atan2(b2, a2p) >= 0?atan2(b2, a2p):atan2(b2, a2p) + PI * 2.0);
-		        double Hp = ( abs(h1p - h2p) > PI ?(h1p + h2p + PI * 2) / 2.0:(h1p + h2p) / 2.0);
-		        double T = 1 - 0.17 * cos(Hp - 30. / 180. * PI) + 0.24 * cos(2 * Hp) + 0.32 * cos(3 * Hp + 6.0 / 180. * PI) - 0.20 * cos(4 * Hp - 63.0 / 180. * PI);
-		        double dhp = ( abs(h2p - h1p) <= PI?(h2p - h1p):((h2p <= h1p)?(h2p - h1p + 2 * PI):(h2p - h1p - 2 * PI)));
-		        double dLp = L2 - L1;
-		        double dCp = C2p - C1p;
-		        double dHp = 2 * sqrt( C1p * C2p ) * sin( dhp / 2);
-		        double SL = 1 + (0.015 * pow( (Lp - 50), 2.0 ) / sqrt( 20 + pow( Lp - 50, 2.0) ) );
-		        double SC = 1 + 0.045 * Cp;
-		        double SH = 1 + 0.015 * Cp * T;
-		        double dtheta = 30 * exp( -1.0 * pow(( (Hp * 180. / PI - 275.0) / 25.0), 2.0) );
-		        double RC = 2 * sqrt ( pow(Cp, 7.0) / (pow(Cp, 7.0) + pow(25.0, 7.0)) );
-		        double RT = -1.0 * RC * sin(2 * dtheta / 180. * PI);
-		        dE = sqrt ( pow( dLp / SL, 2.0) + pow( dCp / SC, 2.0) + pow( dHp / SH, 2.0) + RT * (dCp / SC) * (dHp / SH));
+		        dE = GetDeltaE2000(LabRef[0], LabRef[1], LabRef[2], Lab[0], Lab[1], Lab[2]);
 					std::cerr << "Unexpected Exception in measurement thread" << std::endl;
 				}
 		break;
@@ -2064,16 +2039,16 @@ ColorICtCp::ColorICtCp(const ColorXYZ& XYZ, double YWhiteRef, CColorReference co
 			S = 0.0 * var_X + 0.0 * var_Y + 0.9182 * var_Z;
 		}
 
-		L = min(max(L,0),10000.);
-		M = min(max(M,0),10000.);
-		S = min(max(S,0),10000.);
+		L = min(max(L,0.0),10000.);
+		M = min(max(M,0.0),10000.);
+		S = min(max(S,0.0),10000.);
 
 		double Lp = getL_EOTF(L / 10000., noDataColor, noDataColor, 0.0, 0.0, -5);
 		double Mp = getL_EOTF(M / 10000., noDataColor, noDataColor, 0.0, 0.0, -5);
 		double Sp = getL_EOTF(S / 10000., noDataColor, noDataColor, 0.0, 0.0, -5);
-		Lp = min(max(Lp,0),1.0);
-		Mp = min(max(Mp,0),1.0);
-		Sp = min(max(Sp,0),1.0);
+		Lp = min(max(Lp,0.0),1.0);
+		Mp = min(max(Mp,0.0),1.0);
+		Sp = min(max(Sp,0.0),1.0);
 
         (*this)[0] = (0.5 * Lp + 0.5 * Mp);	 // I
         (*this)[1] = (6610. * Lp - 13613. * Mp + 7003. * Sp) / 4096.; // Ct
@@ -2125,9 +2100,9 @@ ColorLMS::ColorLMS(const ColorXYZ& XYZ, double YWhiteRef, CColorReference colorR
 			S = 0.0 * var_X + 0.0 * var_Y + 0.9182 * var_Z;
 		}
 
-		L = min(max(L,0),10000.);
-		M = min(max(M,0),10000.);
-		S = min(max(S,0),10000.);
+		L = min(max(L,0.0),10000.);
+		M = min(max(M,0.0),10000.);
+		S = min(max(S,0.0),10000.);
 
         (*this)[0] = L;	 // L
         (*this)[1] = M; // M
@@ -2733,226 +2708,150 @@ void CSpectrum::Serialize(CArchive& archive)
 }
 #endif
 
-int ReadColorsFromCsv(ColorRGBDisplay* genColors, int maxEntries, CString csvPath)
+// The file is parsed once and kept until it changes, see CPatchSetFile
+int ReadColorsFromCsv(ColorRGBDisplay* genColors, int maxEntries, const std::string& csvPath)
 {
-	ifstream colorFile(csvPath);
-	std::string line;
-	int cnt = 0;
-	int n1, n2, n3;
-	if (!colorFile)
+	return CPatchSetFile::ReadCachedColors(csvPath, genColors, maxEntries);
+}
+
+// Saturation and colour checker patterns only depend on these, and are
+// computed once for each
+struct PatternKey
+{
+	int kind;				// channels of a saturation, or 8 + colour checker set
+	int size;
+	int mode;				// 5 or 7 for HDR, 0 for the others
+	int standard;
+	double reference[13];	// white and RGB to XYZ matrix of the reference, HDR reference level
+
+	PatternKey(const CColorReference& colorReference, int aKind, int aSize, int aMode)
 	{
-		return -1;
+		kind = aKind;
+		size = aSize;
+		mode = (aMode == 5 || aMode == 7) ? aMode : 0;
+		standard = colorReference.m_standard;
+		ColorXYZ white = colorReference.GetWhite();
+		for (int i = 0; i < 3; i++)
+		{
+			reference[i] = white[i];
+			for (int j = 0; j < 3; j++)
+				reference[3 + i * 3 + j] = colorReference.RGBtoXYZMatrix(i, j);
+		}
+		reference[12] = m_HDRRefLevel;
 	}
-	while (std::getline(colorFile, line) && cnt < maxEntries)
+
+	bool operator<(const PatternKey& other) const
 	{
-		std::istringstream s(line);
-		std::string field;
-		s >> n1;
-		getline(s, field, ',');
-		s >> n2;
-		getline(s, field, ',');
-		s >> n3;
-		genColors[cnt] = ColorRGBDisplay(((n1 - 16) / 219.) * 100, ((n2 - 16) / 219.) * 100, ((n3 - 16) / 219.) * 100.);
-		cnt++;
+		if (kind != other.kind)
+			return kind < other.kind;
+		if (size != other.size)
+			return size < other.size;
+		if (mode != other.mode)
+			return mode < other.mode;
+		if (standard != other.standard)
+			return standard < other.standard;
+		for (int i = 0; i < 13; i++)
+		{
+			if (reference[i] != other.reference[i])
+				return reference[i] < other.reference[i];
+		}
+		return false;
+	}
+};
+
+// custom references can make any number of patterns, start again past this
+static const size_t MAX_CACHED_PATTERNS = 256;
+static CriticalSection m_patternSection;
+static std::map<PatternKey, std::vector<ColorRGBDisplay> > m_patternCache;
+
+// Patterns of key, empty until computed. Call within m_patternSection.
+static std::vector<ColorRGBDisplay>& CachedPatterns(const PatternKey& key)
+{
+	if (m_patternCache.size() >= MAX_CACHED_PATTERNS && m_patternCache.find(key) == m_patternCache.end())
+		m_patternCache.clear();
+	return m_patternCache[key];
+}
+
+// HDR levels of patches given for SDR: the SDR light, or the same XYZ as BT.709
+// with constant_XYZ, coded with the PQ or HLG curve of mode
+static void RecalcHDRColors(const CColorReference& colorReference, ColorRGBDisplay* GenColors, int n_elements, bool constant_XYZ, int mode)
+{
+	CColor tempColor;
+	for (int i=0; i<n_elements; i++)
+	{
+		//linearize
+		double r = (GenColors[i][0]<=0.0||GenColors[i][0]>100.0)?min(max(GenColors[i][0],0.0),100.0):pow(GenColors[i][0] / 100.,2.22);
+		double g = (GenColors[i][1]<=0.0||GenColors[i][1]>100.0)?min(max(GenColors[i][1],0.0),100.0):pow(GenColors[i][1] / 100.,2.22);
+		double b = (GenColors[i][2]<=0.0||GenColors[i][2]>100.0)?min(max(GenColors[i][2],0.0),100.0):pow(GenColors[i][2] / 100.,2.22);
+
+		//Constant XYZ - levels calculated to generate the same 709 XYZ values
+		if (constant_XYZ)		
+		{
+			tempColor.SetRGBValue(ColorRGB(r,g,b),CColorReference(HDTV));
+			if (mode == 5)
+			{
+				tempColor.SetX(tempColor.GetX() / m_HDRRefLevel); //50.23% 8-bit reference for HDR-10
+				tempColor.SetY(tempColor.GetY() / m_HDRRefLevel);
+				tempColor.SetZ(tempColor.GetZ() / m_HDRRefLevel);
+			}
+		}
+		else
+			tempColor.SetRGBValue(ColorRGB(r,g,b),(colorReference.m_standard==UHDTV3||colorReference.m_standard==UHDTV4)?CColorReference(UHDTV2):colorReference);
+
+		ColorRGB aRGBColor = tempColor.GetRGBValue((colorReference.m_standard==UHDTV3||colorReference.m_standard==UHDTV4)?CColorReference(UHDTV2):colorReference);	
+		
+		r = (aRGBColor[0]<=0.0||aRGBColor[0]>1.0)?min(max(aRGBColor[0],0.0),1.0):getL_EOTF(aRGBColor[0], noDataColor, noDataColor,0.0,0.0,-1*mode);
+		g = (aRGBColor[1]<=0.0||aRGBColor[1]>1.0)?min(max(aRGBColor[1],0.0),1.0):getL_EOTF(aRGBColor[1], noDataColor, noDataColor,0.0,0.0,-1*mode);
+		b = (aRGBColor[2]<=0.0||aRGBColor[2]>1.0)?min(max(aRGBColor[2],0.0),1.0):getL_EOTF(aRGBColor[2], noDataColor, noDataColor,0.0,0.0,-1*mode);
+
+		//re-quantize to 8-bit video %
+		GenColors[i][0] = floor( (r * 219.) + 0.5 ) / 2.19;
+		GenColors[i][1] = floor( (g * 219.) + 0.5 ) / 2.19;
+		GenColors[i][2] = floor( (b * 219.) + 0.5 ) / 2.19;
 	}
-	return cnt;
 }
 
 bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay* GenColors, int aCCMode, int mode)
 {
-	//six cases, one for GCD sequence, one for Mascior's disk (Chromapure based), and four different generator only cases
-	//GCD
-	//MCD
-    //CCGS 96 CalMAN ColorChecker SG patterns
+	//built in sets, GCD sequence, Mascior's disk (Chromapure based), CalMAN and ColorChecker SG patterns,
+	//come from ColorCheckerTables.cpp with their HDR levels computed once per reference and mode
+	const ColorCheckerTable* pTable = GetColorCheckerTable(aCCMode);
+	if (pTable)
+	{
+		if (mode == 5 || mode == 7)
+		{
+			CLockWhileInScope lock(m_patternSection);
+			std::vector<ColorRGBDisplay>& colors = CachedPatterns(PatternKey(colorReference, 8 + aCCMode, pTable->size, mode));
+			if (colors.empty())
+			{
+				for (int i=0; i<pTable->size; i++)
+					colors.push_back(ColorRGBDisplay(pTable->colors[i][0], pTable->colors[i][1], pTable->colors[i][2]));
+				RecalcHDRColors(colorReference, &colors[0], pTable->size, true, mode);
+			}
+			std::copy(colors.begin(), colors.end(), GenColors);
+		}
+		else
+		{
+			for (int i=0; i<pTable->size; i++)
+				GenColors[i] = ColorRGBDisplay(pTable->colors[i][0], pTable->colors[i][1], pTable->colors[i][2]);
+		}
+		return true;
+	}
+
+	//the others, generated or read from files
     //USER user defined
 	char * path;
 	char appPath[255];
 	path = getenv("APPDATA");
-	strcpy(appPath, path);
+	strcpy(appPath, path ? path : ".");
 	strcat(appPath, "\\color");
-	bool bOk = true, constant_XYZ = FALSE, m_bRecalc = FALSE;
+	bool bOk = true, constant_XYZ = false, m_bRecalc = false;
 	int n_elements=24;
 	switch (aCCMode)
 	{
-	case GCD:
-		{
-//GCD
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-			GenColors [ 0 ] = ColorRGBDisplay( 0, 0, 0 );
-            GenColors [ 1 ] = ColorRGBDisplay( 62.1, 62.1, 62.1 );
-            GenColors [ 2 ] = ColorRGBDisplay( 73.06, 73.06, 73.06 );
-            GenColors [ 3 ] = ColorRGBDisplay( 82.19, 82.19, 82.19 );
-            GenColors [ 4 ] = ColorRGBDisplay( 89.95, 89.95, 89.95 );
-            GenColors [ 5 ] = ColorRGBDisplay( 100, 100, 100 );
-            GenColors [ 6 ] = ColorRGBDisplay( 45.2, 31.96, 26.03 );
-            GenColors [ 7 ] = ColorRGBDisplay( 75.8, 58.9, 51.14 );
-            GenColors [ 8 ] = ColorRGBDisplay( 36.99, 47.95, 61.19 );
-            GenColors [ 9 ] = ColorRGBDisplay( 35.16,42.01,26.03);
-            GenColors [ 10 ] = ColorRGBDisplay( 51.14,50.23,68.95);
-            GenColors [ 11 ] = ColorRGBDisplay( 38.81,73.97,66.21 );
-            GenColors [ 12 ] = ColorRGBDisplay( 84.93,47.03,15.98);
-            GenColors [ 13 ] = ColorRGBDisplay( 29.22,36.07,63.93);
-            GenColors [ 14 ] = ColorRGBDisplay( 75.80, 32.88,37.90 );
-            GenColors [ 15 ] = ColorRGBDisplay( 36.07, 24.20, 42.01);
-            GenColors [ 16 ] = ColorRGBDisplay( 62.10, 73.06, 25.11 );
-            GenColors [ 17 ] = ColorRGBDisplay( 89.95, 63.01, 17.81 );
-            GenColors [ 18 ] = ColorRGBDisplay( 20.09, 24.20, 58.90);
-            GenColors [ 19 ] = ColorRGBDisplay( 27.85, 57.99, 27.85);
-            GenColors [ 20 ] = ColorRGBDisplay( 68.95, 19.18, 22.83);
-            GenColors [ 21 ] = ColorRGBDisplay( 93.15, 78.08, 12.79 );
-            GenColors [ 22 ] = ColorRGBDisplay( 73.06, 32.88, 57.08);
-            GenColors [ 23 ] = ColorRGBDisplay( 0, 52.05, 63.93);
-        break;
-		}
-	case MCD:
-		{
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-	 	    GenColors [ 23 ] = ColorRGBDisplay( 21, 20.5, 21 );
-            GenColors [ 22 ] = ColorRGBDisplay( 32.88, 32.88, 32.88 );
-            GenColors [ 21 ] = ColorRGBDisplay( 47.49, 47.49, 47.03 );
-            GenColors [ 20 ] = ColorRGBDisplay( 62.56, 62.56, 62.56 );
-            GenColors [ 19 ] = ColorRGBDisplay( 78.54, 78.54, 78.08 );
-            GenColors [ 18 ] = ColorRGBDisplay( 94.98, 94.52, 92.69 );
-            GenColors [ 0 ] = ColorRGBDisplay( 44.74, 31.51, 26.03 );
-            GenColors [ 1 ] = ColorRGBDisplay( 75.80, 58.45, 50.68 );
-            GenColors [ 2 ] = ColorRGBDisplay( 36.99, 47.95, 60.73 );
-            GenColors [ 3 ] = ColorRGBDisplay( 34.70,42.47,26.48);
-            GenColors [ 4 ] = ColorRGBDisplay( 50.68,50.22,68.49);
-            GenColors [ 5 ] = ColorRGBDisplay( 39.27,73.97,66.21 );
-            GenColors [ 6 ] = ColorRGBDisplay( 84.47,47.49,16.44);
-            GenColors [ 7 ] = ColorRGBDisplay( 28.77,35.62,64.38);
-            GenColors [ 8 ] = ColorRGBDisplay( 75.80, 33.33,38.36 );
-            GenColors [ 9 ] = ColorRGBDisplay( 36.07, 24.20, 42.01);
-            GenColors [ 10 ] = ColorRGBDisplay( 62.10, 73.06, 24.66 );
-            GenColors [ 11 ] = ColorRGBDisplay( 89.95, 63.47, 18.26 );
-            GenColors [ 12 ] = ColorRGBDisplay( 19.63, 24.20, 59.36);
-            GenColors [ 13 ] = ColorRGBDisplay( 28.31, 57.99, 27.85);
-            GenColors [ 14 ] = ColorRGBDisplay( 68.95, 19.18, 22.83);
-            GenColors [ 15 ] = ColorRGBDisplay( 93.15, 78.08, 12.79 );
-            GenColors [ 16 ] = ColorRGBDisplay( 72.61, 32.42, 57.53);
-            GenColors [ 17 ] = ColorRGBDisplay( 11.87, 51.60, 59.82);
-		break;
-		}
-	case CMC:
-		{
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-            GenColors [ 0 ] = ColorRGBDisplay( 100,	100,	100);
-            GenColors [ 1 ] = ColorRGBDisplay( 89.9543379,	89.9543379,	89.9543379);
-            GenColors [ 2 ] = ColorRGBDisplay( 82.19178082,	82.19178082,	82.19178082);
-            GenColors [ 3 ] = ColorRGBDisplay( 73.05936073,	73.05936073,	73.05936073);
-            GenColors [ 4 ] = ColorRGBDisplay( 62.10045662,	62.10045662,	62.10045662);
-            GenColors [ 5 ] = ColorRGBDisplay( 0,	0,	0);
-            GenColors [ 6 ] = ColorRGBDisplay( 45.20547945,	31.96347032,	26.02739726);
-            GenColors [ 7 ] = ColorRGBDisplay( 75.79908676,	58.90410959,	51.14155251);
-            GenColors [ 8 ] = ColorRGBDisplay( 36.98630137,	47.94520548,	61.18721461);
-            GenColors [ 9 ] = ColorRGBDisplay( 35.15981735,	42.00913242,	26.02739726);
-            GenColors [ 10 ] = ColorRGBDisplay( 51.14155251,	50.2283105,	68.94977169);
-            GenColors [ 11 ] = ColorRGBDisplay( 38.81278539,	73.97260274,	66.21004566);
-            GenColors [ 12 ] = ColorRGBDisplay( 84.93150685,	47.03196347,	15.98173516);
-            GenColors [ 13 ] = ColorRGBDisplay( 29.22374429,	36.07305936,	63.92694064);
-            GenColors [ 14 ] = ColorRGBDisplay( 75.79908676,	32.87671233,	37.89954338);
-            GenColors [ 15 ] = ColorRGBDisplay( 36.07305936,	24.20091324,	42.00913242);
-            GenColors [ 16 ] = ColorRGBDisplay( 62.10045662,	73.05936073,	25.11415525);
-            GenColors [ 17 ] = ColorRGBDisplay( 89.9543379,	63.01369863,	17.80821918);
-            GenColors [ 18 ] = ColorRGBDisplay( 20.0913242,	24.20091324,	58.90410959);
-            GenColors [ 19 ] = ColorRGBDisplay( 27.85388128,	57.99086758,	27.85388128);
-            GenColors [ 20 ] = ColorRGBDisplay( 68.94977169,	19.17808219,	22.83105023);
-            GenColors [ 21 ] = ColorRGBDisplay( 93.15068493,	78.08219178,	12.78538813);
-            GenColors [ 22 ] = ColorRGBDisplay( 73.05936073,	32.87671233,	57.07762557);
-            GenColors [ 23 ] = ColorRGBDisplay( 0,	52.05479452,	63.92694064);		
-        break;
-		}
-		//CalMan classic
-	case CMS:
-		{
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-            GenColors [ 0 ] = ColorRGBDisplay( 100, 100, 100 );
-            GenColors [ 1 ] = ColorRGBDisplay( 0, 0, 0 );
-            GenColors [ 2 ] = ColorRGBDisplay( 43.83561644,	25.11415525,	15.06849315 );
-            GenColors [ 3 ] = ColorRGBDisplay( 79.9086758,	53.88127854,	40.1826484);
-            GenColors [ 4 ] = ColorRGBDisplay( 100,	78.08219178,	59.8173516);
-            GenColors [ 5 ] = ColorRGBDisplay( 100,	78.08219178,	67.12328767);
-            GenColors [ 6 ] = ColorRGBDisplay( 96.80365297,	67.12328767,	48.85844749);
-            GenColors [ 7 ] = ColorRGBDisplay( 78.08219178,	54.79452055,	36.07305936);
-            GenColors [ 8 ] = ColorRGBDisplay( 56.16438356,	36.07305936,	20.0913242);
-			GenColors [ 9 ] = ColorRGBDisplay( 80.82191781,	58.90410959,	45.20547945);
-            GenColors [ 10 ] = ColorRGBDisplay( 63.01369863,	33.78995434,	12.78538813);
-            GenColors [ 11 ] = ColorRGBDisplay( 84.01826484,	52.05479452,	36.07305936);
-            GenColors [ 12 ] = ColorRGBDisplay( 82.19178082,	53.88127854,	41.09589041);
-            GenColors [ 13 ] = ColorRGBDisplay( 98.17351598,	59.8173516,	45.20547945);
-            GenColors [ 14 ] = ColorRGBDisplay( 78.08219178,	56.16438356,	42.00913242);
-            GenColors [ 15 ] = ColorRGBDisplay( 78.99543379,	54.79452055,	42.00913242);
-            GenColors [ 16 ] = ColorRGBDisplay( 79.9086758,	56.16438356,	41.09589041);
-            GenColors [ 17 ] = ColorRGBDisplay( 47.94520548,	29.22374429,	15.06849315);
-            GenColors [ 18 ] = ColorRGBDisplay( 84.93150685,	54.79452055,	36.98630137);
-			n_elements= 19;
-        break;
-		}
-		//CalMAN skin
-	case CPS:
-		{
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-            GenColors [ 0 ] = ColorRGBDisplay( 100, 100, 100 );
-            GenColors [ 1 ] = ColorRGBDisplay( 84.47488584,	49.31506849,	34.24657534);
-            GenColors [ 2 ] = ColorRGBDisplay( 78.99543379,	55.25114155,	48.40182648);
-            GenColors [ 3 ] = ColorRGBDisplay( 93.60730594,	67.57990868,	57.99086758);
-            GenColors [ 4 ] = ColorRGBDisplay( 94.52054795,	61.18721461,	52.96803653);
-            GenColors [ 5 ] = ColorRGBDisplay( 75.34246575,	56.16438356,	42.92237443);
-            GenColors [ 6 ] = ColorRGBDisplay( 74.88584475,	57.07762557,	49.31506849);
-            GenColors [ 7 ] = ColorRGBDisplay( 55.25114155,	36.52968037,	24.65753425);
-            GenColors [ 8 ] = ColorRGBDisplay( 76.25570776,	56.62100457,	49.7716895);
-			GenColors [ 9 ] = ColorRGBDisplay( 75.79908676,	58.90410959,	51.14155251);
-            GenColors [ 10 ] = ColorRGBDisplay( 77.16894977,	56.62100457,	48.85844749);
-            GenColors [ 11 ] = ColorRGBDisplay( 62.10045662,	34.24657534,	17.80821918);
-            GenColors [ 12 ] = ColorRGBDisplay( 47.03196347,	29.6803653,	18.72146119);
-            GenColors [ 13 ] = ColorRGBDisplay( 81.73515982,	52.96803653,	42.46575342);
-            GenColors [ 14 ] = ColorRGBDisplay( 82.64840183,	56.16438356,	43.83561644);
-            GenColors [ 15 ] = ColorRGBDisplay( 93.15068493,	68.49315068,	48.40182648);
-            GenColors [ 16 ] = ColorRGBDisplay( 81.73515982,	60.2739726,	42.46575342);
-            GenColors [ 17 ] = ColorRGBDisplay( 45.20547945,	31.96347032,	26.48401826);
-            GenColors [ 18 ] = ColorRGBDisplay( 76.25570776,	58.90410959,	51.14155251);
-			n_elements= 19;
-        break;
-		}
-		//Chromapure skin
-	case SKIN:
-		{
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-            GenColors [ 0 ] = ColorRGBDisplay(100,87.67123288,76.71232877);
-            GenColors [ 1 ] = ColorRGBDisplay(94.06392694,83.56164384,74.42922374);
-            GenColors [ 2 ] = ColorRGBDisplay(93.15068493,80.82191781,70.3196347);
-            GenColors [ 3 ] = ColorRGBDisplay(88.12785388,72.14611872,59.8173516);
-            GenColors [ 4 ] = ColorRGBDisplay(89.9543379,76.25570776,59.8173516);
-            GenColors [ 5 ] = ColorRGBDisplay(100,86.30136986,69.8630137);
-            GenColors [ 6 ] = ColorRGBDisplay(89.9543379,72.14611872,56.16438356);
-            GenColors [ 7 ] = ColorRGBDisplay(89.9543379,62.55707763,45.20547945);
-            GenColors [ 8 ] = ColorRGBDisplay(90.4109589,62.10045662,42.92237443);
-            GenColors [ 9 ] = ColorRGBDisplay(85.84474886,56.62100457,39.7260274);
-            GenColors [ 10 ] = ColorRGBDisplay(80.82191781,58.90410959,48.40182648);
-            GenColors [ 11 ] = ColorRGBDisplay(77.62557078,47.03196347,33.78995434);
-            GenColors [ 12 ] = ColorRGBDisplay(73.05936073,42.46575342,28.76712329);
-            GenColors [ 13 ] = ColorRGBDisplay(64.84018265,44.74885845,34.24657534);
-            GenColors [ 14 ] = ColorRGBDisplay(94.06392694,78.53881279,78.99543379);
-            GenColors [ 15 ] = ColorRGBDisplay(86.75799087,65.75342466,62.55707763);
-            GenColors [ 16 ] = ColorRGBDisplay(72.60273973,48.40182648,42.92237443);
-            GenColors [ 17 ] = ColorRGBDisplay(65.75342466,45.66210046,42.46575342);
-            GenColors [ 18 ] = ColorRGBDisplay(68.03652968,39.26940639,31.96347032);
-            GenColors [ 19 ] = ColorRGBDisplay(36.07305936,21.91780822,21.00456621);
-            GenColors [ 20 ] = ColorRGBDisplay(79.45205479,51.59817352,26.02739726);
-            GenColors [ 21 ] = ColorRGBDisplay(73.97260274,44.74885845,23.74429224);
-            GenColors [ 22 ] = ColorRGBDisplay(43.83561644,25.57077626,22.37442922);
-            GenColors [ 23 ] = ColorRGBDisplay(63.92694064,52.51141553,41.55251142);
-        break;
-		}
 	case AXIS:
 		{
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			GenColors [ 0 ] = ColorRGBDisplay(0,0,0);
 			for (int i=0;i<10;i++) {GenColors [ i + 1 ] = ColorRGBDisplay( (i+1) * 10,	(i+1) * 10,	(i+1) * 10);}
 			for (int i=0;i<10;i++) {GenColors [ i + 11 ] = ColorRGBDisplay( (i+1) * 10,	0,	0);}
@@ -2964,126 +2863,26 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 			n_elements= 70;
         break;
 		}
-		//ColorCheckerSG 96 colors
-    case CCSG:
-        {
-			constant_XYZ = TRUE;
-			m_bRecalc = TRUE;
-            GenColors [ 0 ] = ColorRGBDisplay(	100	,	100	,	100	);
-            GenColors [ 1 ] = ColorRGBDisplay(	87.2146119	,	87.2146119	,	87.2146119	);
-            GenColors [ 2 ] = ColorRGBDisplay(	77.1689498	,	77.1689498	,	77.1689498	);
-            GenColors [ 3 ] = ColorRGBDisplay(	72.1461187	,	72.1461187	,	72.1461187	);
-            GenColors [ 4 ] = ColorRGBDisplay(	67.1232877	,	67.1232877	,	67.1232877	);
-            GenColors [ 5 ] = ColorRGBDisplay(	61.1872146	,	61.1872146	,	61.1872146	);
-            GenColors [ 6 ] = ColorRGBDisplay(	56.1643836	,	56.1643836	,	56.1643836	);
-            GenColors [ 7 ] = ColorRGBDisplay(	46.1187215	,	46.1187215	,	46.1187215	);
-            GenColors [ 8 ] = ColorRGBDisplay(	42.0091324	,	42.0091324	,	42.0091324	);
-            GenColors [ 9 ] = ColorRGBDisplay(	36.9863014	,	36.9863014	,	36.9863014	);
-            GenColors [ 10 ] = ColorRGBDisplay(	32.8767123	,	32.8767123	,	32.8767123	);
-            GenColors [ 11 ] = ColorRGBDisplay(	29.2237443	,	29.2237443	,	29.2237443	);
-            GenColors [ 12 ] = ColorRGBDisplay(	21.0045662	,	21.0045662	,	21.0045662	);
-            GenColors [ 13 ] = ColorRGBDisplay(	16.8949772	,	16.8949772	,	16.8949772	);
-            GenColors [ 14 ] = ColorRGBDisplay(	0	,	0	,	0	);
-            GenColors [ 15 ] = ColorRGBDisplay(	57.0776256	,	10.9589041	,	32.8767123	);
-            GenColors [ 16 ] = ColorRGBDisplay(	29.2237443	,	17.8082192	,	27.8538813	);
-            GenColors [ 17 ] = ColorRGBDisplay(	84.9315068	,	82.1917808	,	75.7990868	);
-            GenColors [ 18 ] = ColorRGBDisplay(	43.8356164	,	25.1141553	,	15.0684932	);
-            GenColors [ 19 ] = ColorRGBDisplay(	79.9086758	,	53.8812785	,	40.1826484	);
-            GenColors [ 20 ] = ColorRGBDisplay(	35.1598174	,	43.8356164	,	51.1415525	);
-            GenColors [ 21 ] = ColorRGBDisplay(	32.8767123	,	37.8995434	,	11.8721461	);
-            GenColors [ 22 ] = ColorRGBDisplay(	50.2283105	,	46.1187215	,	57.0776256	);
-            GenColors [ 23 ] = ColorRGBDisplay(	42.0091324	,	70.7762557	,	56.1643836	);
-            GenColors [ 24 ] = ColorRGBDisplay(	100	,	78.0821918	,	59.8173516	);
-            GenColors [ 25 ] = ColorRGBDisplay(	38.8127854	,	10.9589041	,	15.9817352	);
-            GenColors [ 26 ] = ColorRGBDisplay(	74.8858447	,	11.8721461	,	29.2237443	);
-            GenColors [ 27 ] = ColorRGBDisplay(	73.9726027	,	50.2283105	,	61.1872146	);
-            GenColors [ 28 ] = ColorRGBDisplay(	42.9223744	,	35.1598174	,	53.8812785	);
-            GenColors [ 29 ] = ColorRGBDisplay(	99.086758	,	78.0821918	,	70.7762557	);
-            GenColors [ 30 ] = ColorRGBDisplay(	90.8675799	,	43.8356164	,	0	);
-            GenColors [ 31 ] = ColorRGBDisplay(	24.2009132	,	31.0502283	,	56.1643836	);
-            GenColors [ 32 ] = ColorRGBDisplay(	78.0821918	,	25.1141553	,	26.9406393	);
-            GenColors [ 33 ] = ColorRGBDisplay(	31.9634703	,	15.0684932	,	31.9634703	);
-            GenColors [ 34 ] = ColorRGBDisplay(	66.2100457	,	70.7762557	,	0	);
-            GenColors [ 35 ] = ColorRGBDisplay(	91.7808219	,	58.9041096	,	0	);
-            GenColors [ 36 ] = ColorRGBDisplay(	84.0182648	,	90.8675799	,	70.7762557	);
-            GenColors [ 37 ] = ColorRGBDisplay(	79.9086758	,	0	,	8.2191781	);
-            GenColors [ 38 ] = ColorRGBDisplay(	33.7899543	,	12.7853881	,	21.0045662	);
-            GenColors [ 39 ] = ColorRGBDisplay(	46.1187215	,	11.8721461	,	43.8356164	);
-            GenColors [ 40 ] = ColorRGBDisplay(	0	,	21.0045662	,	35.1598174	);
-            GenColors [ 41 ] = ColorRGBDisplay(	73.9726027	,	85.8447489	,	72.1461187	);
-            GenColors [ 42 ] = ColorRGBDisplay(	5.0228311	,	16.8949772	,	46.1187215	);
-            GenColors [ 43 ] = ColorRGBDisplay(	26.0273973	,	54.7945205	,	15.9817352	);
-            GenColors [ 44 ] = ColorRGBDisplay(	69.8630137	,	0	,	10.0456621	);
-            GenColors [ 45 ] = ColorRGBDisplay(	96.803653	,	74.8858447	,	0	);
-            GenColors [ 46 ] = ColorRGBDisplay(	75.7990868	,	26.0273973	,	47.9452055	);
-            GenColors [ 47 ] = ColorRGBDisplay(	0	,	50.2283105	,	54.7945205	);
-            GenColors [ 48 ] = ColorRGBDisplay(	90.8675799	,	79.9086758	,	74.8858447	);
-            GenColors [ 49 ] = ColorRGBDisplay(	84.0182648	,	46.1187215	,	47.0319635	);
-            GenColors [ 50 ] = ColorRGBDisplay(	74.8858447	,	0	,	15.0684932	);
-            GenColors [ 51 ] = ColorRGBDisplay(	0	,	48.8584475	,	68.0365297	);
-            GenColors [ 52 ] = ColorRGBDisplay(	32.8767123	,	59.8173516	,	68.0365297	);
-            GenColors [ 53 ] = ColorRGBDisplay(	100	,	78.0821918	,	67.1232877	);
-            GenColors [ 54 ] = ColorRGBDisplay(	74.8858447	,	84.0182648	,	75.7990868	);
-            GenColors [ 55 ] = ColorRGBDisplay(	87.2146119	,	46.1187215	,	40.1826484	);
-            GenColors [ 56 ] = ColorRGBDisplay(	94.0639269	,	20.0913242	,	15.0684932	);
-            GenColors [ 57 ] = ColorRGBDisplay(	19.1780822	,	63.0136986	,	64.8401826	);
-            GenColors [ 58 ] = ColorRGBDisplay(	0	,	22.8310502	,	26.9406393	);
-            GenColors [ 59 ] = ColorRGBDisplay(	85.8447489	,	83.1050228	,	52.0547945	);
-            GenColors [ 60 ] = ColorRGBDisplay(	100	,	40.1826484	,	0	);
-            GenColors [ 61 ] = ColorRGBDisplay(	100	,	63.0136986	,	0	);
-            GenColors [ 62 ] = ColorRGBDisplay(	0	,	22.8310502	,	20.0913242	);
-            GenColors [ 63 ] = ColorRGBDisplay(	46.1187215	,	57.9908676	,	68.9497717	);
-            GenColors [ 64 ] = ColorRGBDisplay(	85.8447489	,	47.9452055	,	27.8538813	);
-            GenColors [ 65 ] = ColorRGBDisplay(	96.803653	,	67.1232877	,	48.8584475	);
-            GenColors [ 66 ] = ColorRGBDisplay(	78.0821918	,	54.7945205	,	36.0730594	);
-            GenColors [ 67 ] = ColorRGBDisplay(	56.1643836	,	36.0730594	,	20.0913242	);
-            GenColors [ 68 ] = ColorRGBDisplay(	80.8219178	,	58.9041096	,	45.2054795	);
-            GenColors [ 69 ] = ColorRGBDisplay(	63.0136986	,	33.7899543	,	12.7853881	);
-            GenColors [ 70 ] = ColorRGBDisplay(	84.0182648	,	52.0547945	,	36.0730594	);
-            GenColors [ 71 ] = ColorRGBDisplay(	78.0821918	,	69.8630137	,	0	);
-            GenColors [ 72 ] = ColorRGBDisplay(	100	,	74.8858447	,	0	);
-            GenColors [ 73 ] = ColorRGBDisplay(	0	,	63.0136986	,	56.1643836	);
-            GenColors [ 74 ] = ColorRGBDisplay(	0	,	54.7945205	,	46.1187215	);
-            GenColors [ 75 ] = ColorRGBDisplay(	82.1917808	,	53.8812785	,	41.0958904	);
-            GenColors [ 76 ] = ColorRGBDisplay(	98.173516	,	59.8173516	,	45.2054795	);
-            GenColors [ 77 ] = ColorRGBDisplay(	78.0821918	,	56.1643836	,	42.0091324	);
-            GenColors [ 78 ] = ColorRGBDisplay(	78.9954338	,	54.7945205	,	42.0091324	);
-            GenColors [ 79 ] = ColorRGBDisplay(	79.9086758	,	56.1643836	,	41.0958904	);
-            GenColors [ 80 ] = ColorRGBDisplay(	47.9452055	,	29.2237443	,	15.0684932	);
-            GenColors [ 81 ] = ColorRGBDisplay(	84.9315068	,	54.7945205	,	36.9863014	);
-            GenColors [ 82 ] = ColorRGBDisplay(	72.1461187	,	56.1643836	,	9.1324201	);
-            GenColors [ 83 ] = ColorRGBDisplay(	73.0593607	,	69.8630137	,	0	);
-            GenColors [ 84 ] = ColorRGBDisplay(	25.1141553	,	21.0045662	,	14.1552511	);
-            GenColors [ 85 ] = ColorRGBDisplay(	35.1598174	,	63.0136986	,	35.1598174	);
-            GenColors [ 86 ] = ColorRGBDisplay(	0	,	53.8812785	,	31.0502283	);
-            GenColors [ 87 ] = ColorRGBDisplay(	11.8721461	,	25.1141553	,	15.9817352	);
-            GenColors [ 88 ] = ColorRGBDisplay(	22.8310502	,	63.0136986	,	42.9223744	);
-            GenColors [ 89 ] = ColorRGBDisplay(	47.9452055	,	61.1872146	,	21.9178082	);
-            GenColors [ 90 ] = ColorRGBDisplay(	20.0913242	,	53.8812785	,	10.0456621	);
-            GenColors [ 91 ] = ColorRGBDisplay(	29.2237443	,	66.2100457	,	15.9817352	);
-            GenColors [ 92 ] = ColorRGBDisplay(	78.9954338	,	52.0547945	,	16.8949772	);
-            GenColors [ 93 ] = ColorRGBDisplay(	62.1004566	,	58.9041096	,	10.0456621	);
-            GenColors [ 94 ] = ColorRGBDisplay(	64.8401826	,	73.0593607	,	0	);
-            GenColors [ 95 ] = ColorRGBDisplay(	30.1369863	,	16.8949772	,	10.0456621	);
-			n_elements= 96;
-            break;
-        }
     case USER:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
+#ifdef LIBHCFR_HAS_WIN32_API
             char m_ApplicationPath [MAX_PATH];
 			LPSTR lpStr;
             GetModuleFileName ( NULL, m_ApplicationPath, sizeof ( m_ApplicationPath ) );
 			lpStr = strrchr ( m_ApplicationPath, (int) '\\' );
 			lpStr [ 1 ] = '\0';
-            CString strPath = m_ApplicationPath;
+            std::string strPath = m_ApplicationPath;
+#else
+            std::string strPath = "./";
+#endif
 			n_elements = ReadColorsFromCsv(GenColors, MAX_USER_CC_PATCH_SIZE, strPath + "usercolors.csv");
             break;
         }
 
 	case CM10SAT:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 10-Point Saturation (100AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3091,7 +2890,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 
 	case CM10SAT75:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 10-Point Saturation (75AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3099,7 +2898,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM4LUM:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\CM 4-Point Luminance.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3107,7 +2906,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 
 	case CM5LUM:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\CM 5-Point Luminance.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3115,7 +2914,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM10LUM:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\CM 10-Point Luminance.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3123,7 +2922,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM4SAT:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 4-Point Saturation (100AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3131,7 +2930,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM4SAT75:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 4-Point Saturation (75AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3139,7 +2938,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM5SAT:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 5-Point Saturation (100AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3147,7 +2946,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM5SAT75:
         {//read in user defined colors
-			m_bRecalc = TRUE;
+			m_bRecalc = true;
 			strcat(appPath, "\\CM 5-Point Saturation (75AMP).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3155,7 +2954,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case CM6NB:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\CM 6-Point Near Black.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3268,7 +3067,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 
 		case CMDNR:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\CM Dynamic Range (Clipping).csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3276,7 +3075,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 
 	case RANDOM250:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\Random_250.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3284,7 +3083,7 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	
 	case RANDOM500:
         {//read in user defined colors
-			m_bRecalc = FALSE;
+			m_bRecalc = false;
 			strcat(appPath, "\\Random_500.csv");
 			n_elements = ReadColorsFromCsv(GenColors, 100, appPath);
             break;
@@ -3299,48 +3098,12 @@ bool GenerateCC24Colors (const CColorReference& colorReference, ColorRGBDisplay*
 	//HDR mode target recalculation
 	//Will recalc color checker and saturation based levels, luminance, random and user left as-is
 	if ( (mode == 5 || mode == 7) && m_bRecalc )
-	{
-		CColor tempColor;
-		for (int i=0; i<n_elements; i++)
-		{
-
-			//linearize
-			double r = (GenColors[i][0]<=0.0||GenColors[i][0]>100.0)?min(max(GenColors[i][0],0),100):pow(GenColors[i][0] / 100.,2.22);
-			double g = (GenColors[i][1]<=0.0||GenColors[i][1]>100.0)?min(max(GenColors[i][1],0),100):pow(GenColors[i][1] / 100.,2.22);
-			double b = (GenColors[i][2]<=0.0||GenColors[i][2]>100.0)?min(max(GenColors[i][2],0),100):pow(GenColors[i][2] / 100.,2.22);
-
-			//Constant XYZ - levels calculated to generate the same 709 XYZ values
-			if (constant_XYZ)		
-			{
-				tempColor.SetRGBValue(ColorRGB(r,g,b),CColorReference(HDTV));
-				if (mode == 5)
-				{
-					tempColor.SetX(tempColor.GetX() / m_HDRRefLevel); //50.23% 8-bit reference for HDR-10
-					tempColor.SetY(tempColor.GetY() / m_HDRRefLevel);
-					tempColor.SetZ(tempColor.GetZ() / m_HDRRefLevel);
-				}
-			}
-			else
-				tempColor.SetRGBValue(ColorRGB(r,g,b),(colorReference.m_standard==UHDTV3||colorReference.m_standard==UHDTV4)?CColorReference(UHDTV2):colorReference);
-
-			ColorRGB aRGBColor = tempColor.GetRGBValue((colorReference.m_standard==UHDTV3||colorReference.m_standard==UHDTV4)?CColorReference(UHDTV2):colorReference);	
-			
-			r = (aRGBColor[0]<=0.0||aRGBColor[0]>1.0)?min(max(aRGBColor[0],0),1):getL_EOTF(aRGBColor[0], noDataColor, noDataColor,0.0,0.0,-1*mode);
-			g = (aRGBColor[1]<=0.0||aRGBColor[1]>1.0)?min(max(aRGBColor[1],0),1):getL_EOTF(aRGBColor[1], noDataColor, noDataColor,0.0,0.0,-1*mode);
-			b = (aRGBColor[2]<=0.0||aRGBColor[2]>1.0)?min(max(aRGBColor[2],0),1):getL_EOTF(aRGBColor[2], noDataColor, noDataColor,0.0,0.0,-1*mode);
-
-			//re-quantize to 8-bit video %
-			GenColors[i][0] = floor( (r * 219.) + 0.5 ) / 2.19;
-			GenColors[i][1] = floor( (g * 219.) + 0.5 ) / 2.19;
-			GenColors[i][2] = floor( (b * 219.) + 0.5 ) / 2.19;
-
-		}
-	}
+		RecalcHDRColors(colorReference, GenColors, n_elements, constant_XYZ, mode);
 
 	return bOk;
 }
 
-void GenerateSaturationColors (const CColorReference& colorReference, ColorRGBDisplay* GenColors, int nSteps, bool bRed, bool bGreen, bool bBlue, int mode)
+static void BuildSaturationColors (const CColorReference& colorReference, ColorRGBDisplay* GenColors, int nSteps, bool bRed, bool bGreen, bool bBlue, int mode)
 {
 	//use fully saturated space if user has special color space modes set
 	//UHDTV pseudo-spaces XYZ is set in original space and mapped to BT.2020
@@ -3457,15 +3220,15 @@ void GenerateSaturationColors (const CColorReference& colorReference, ColorRGBDi
 
 		if (mode == 5 || mode == 7)
 		{
-				rgbColor[0] = 100.0 * ( (rgbColor[0]<=0.0||rgbColor[0]>1.0)?min(max(rgbColor[0],0),1):getL_EOTF(rgbColor[0], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
-				rgbColor[1] = 100.0 * ( (rgbColor[1]<=0.0||rgbColor[1]>1.0)?min(max(rgbColor[1],0),1):getL_EOTF(rgbColor[1], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
-				rgbColor[2] = 100.0 * ( (rgbColor[2]<=0.0||rgbColor[2]>1.0)?min(max(rgbColor[2],0),1):getL_EOTF(rgbColor[2], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
+				rgbColor[0] = 100.0 * ( (rgbColor[0]<=0.0||rgbColor[0]>1.0)?min(max(rgbColor[0],0.0),1.0):getL_EOTF(rgbColor[0], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
+				rgbColor[1] = 100.0 * ( (rgbColor[1]<=0.0||rgbColor[1]>1.0)?min(max(rgbColor[1],0.0),1.0):getL_EOTF(rgbColor[1], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
+				rgbColor[2] = 100.0 * ( (rgbColor[2]<=0.0||rgbColor[2]>1.0)?min(max(rgbColor[2],0.0),1.0):getL_EOTF(rgbColor[2], noDataColor, noDataColor, 2.4, 0.9, -1*mode));
 		}
 		else
 		{
-			rgbColor[0] = 100.0 * ( (rgbColor[0]<=0.0||rgbColor[0]>=1.0)?min(max(rgbColor[0],0),1):pow(rgbColor[0], 1.0 / 2.22) );
-			rgbColor[1] = 100.0 * ( (rgbColor[1]<=0.0||rgbColor[1]>=1.0)?min(max(rgbColor[1],0),1):pow(rgbColor[1], 1.0 / 2.22) );
-			rgbColor[2] = 100.0 * ( (rgbColor[2]<=0.0||rgbColor[2]>=1.0)?min(max(rgbColor[2],0),1):pow(rgbColor[2], 1.0 / 2.22) );
+			rgbColor[0] = 100.0 * ( (rgbColor[0]<=0.0||rgbColor[0]>=1.0)?min(max(rgbColor[0],0.0),1.0):pow(rgbColor[0], 1.0 / 2.22) );
+			rgbColor[1] = 100.0 * ( (rgbColor[1]<=0.0||rgbColor[1]>=1.0)?min(max(rgbColor[1],0.0),1.0):pow(rgbColor[1], 1.0 / 2.22) );
+			rgbColor[2] = 100.0 * ( (rgbColor[2]<=0.0||rgbColor[2]>=1.0)?min(max(rgbColor[2],0.0),1.0):pow(rgbColor[2], 1.0 / 2.22) );
 		}
 
 		//quantize to 8-bit video %
@@ -3478,6 +3241,25 @@ void GenerateSaturationColors (const CColorReference& colorReference, ColorRGBDi
     }
 }
 
+void GenerateSaturationColors (const CColorReference& colorReference, ColorRGBDisplay* GenColors, int nSteps, bool bRed, bool bGreen, bool bBlue, int mode)
+{
+	if (nSteps <= 0)
+		return;
+
+	CLockWhileInScope lock(m_patternSection);
+	std::vector<ColorRGBDisplay>& colors = CachedPatterns(PatternKey(colorReference, (bRed ? 1 : 0) + (bGreen ? 2 : 0) + (bBlue ? 4 : 0), nSteps, mode));
+	if (colors.empty())
+	{
+		colors.resize(nSteps);
+		BuildSaturationColors(colorReference, &colors[0], nSteps, bRed, bGreen, bBlue, mode);
+	}
+	std::copy(colors.begin(), colors.end(), GenColors);
+}
+
+// Beyond this the three measures are too close to each other for the
+// inverse to mean anything, even though the determinant is not zero
+static const double MAX_MEASURES_CONDITION_NUMBER = 1e10;
+
 Matrix ComputeConversionMatrix3Colour(const ColorXYZ measures[3], const ColorXYZ references[3])
 {
     Matrix measuresXYZ(measures[0]);
@@ -3488,7 +3270,7 @@ Matrix ComputeConversionMatrix3Colour(const ColorXYZ measures[3], const ColorXYZ
     referencesXYZ.CMAC(references[1]);
     referencesXYZ.CMAC(references[2]);
 
-    if(measuresXYZ.Determinant() == 0) // check that reference matrix is inversible
+    if(measuresXYZ.GetConditionNumber() > MAX_MEASURES_CONDITION_NUMBER) // check that reference matrix is inversible
     {
         throw std::logic_error("Can't invert measures matrix");
     }
@@ -0,0 +1,315 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "ColorCheckerTables.h"
+#include "Color.h"
+
+namespace
+{
+    // GretagMacbeth ColorChecker, grays first
+    const double gcdColors[24][3] =
+    {
+        { 0, 0, 0 },
+        { 62.1, 62.1, 62.1 },
+        { 73.06, 73.06, 73.06 },
+        { 82.19, 82.19, 82.19 },
+        { 89.95, 89.95, 89.95 },
+        { 100, 100, 100 },
+        { 45.2, 31.96, 26.03 },
+        { 75.8, 58.9, 51.14 },
+        { 36.99, 47.95, 61.19 },
+        { 35.16, 42.01, 26.03 },
+        { 51.14, 50.23, 68.95 },
+        { 38.81, 73.97, 66.21 },
+        { 84.93, 47.03, 15.98 },
+        { 29.22, 36.07, 63.93 },
+        { 75.80, 32.88, 37.90 },
+        { 36.07, 24.20, 42.01 },
+        { 62.10, 73.06, 25.11 },
+        { 89.95, 63.01, 17.81 },
+        { 20.09, 24.20, 58.90 },
+        { 27.85, 57.99, 27.85 },
+        { 68.95, 19.18, 22.83 },
+        { 93.15, 78.08, 12.79 },
+        { 73.06, 32.88, 57.08 },
+        { 0, 52.05, 63.93 },
+    };
+
+    // Mascior's disk, ChromaPure based, grays last
+    const double mcdColors[24][3] =
+    {
+        { 44.74, 31.51, 26.03 },
+        { 75.80, 58.45, 50.68 },
+        { 36.99, 47.95, 60.73 },
+        { 34.70, 42.47, 26.48 },
+        { 50.68, 50.22, 68.49 },
+        { 39.27, 73.97, 66.21 },
+        { 84.47, 47.49, 16.44 },
+        { 28.77, 35.62, 64.38 },
+        { 75.80, 33.33, 38.36 },
+        { 36.07, 24.20, 42.01 },
+        { 62.10, 73.06, 24.66 },
+        { 89.95, 63.47, 18.26 },
+        { 19.63, 24.20, 59.36 },
+        { 28.31, 57.99, 27.85 },
+        { 68.95, 19.18, 22.83 },
+        { 93.15, 78.08, 12.79 },
+        { 72.61, 32.42, 57.53 },
+        { 11.87, 51.60, 59.82 },
+        { 94.98, 94.52, 92.69 },
+        { 78.54, 78.54, 78.08 },
+        { 62.56, 62.56, 62.56 },
+        { 47.49, 47.49, 47.03 },
+        { 32.88, 32.88, 32.88 },
+        { 21, 20.5, 21 },
+    };
+
+    // ChromaPure skin
+    const double skinColors[24][3] =
+    {
+        { 100, 87.67123288, 76.71232877 },
+        { 94.06392694, 83.56164384, 74.42922374 },
+        { 93.15068493, 80.82191781, 70.3196347 },
+        { 88.12785388, 72.14611872, 59.8173516 },
+        { 89.9543379, 76.25570776, 59.8173516 },
+        { 100, 86.30136986, 69.8630137 },
+        { 89.9543379, 72.14611872, 56.16438356 },
+        { 89.9543379, 62.55707763, 45.20547945 },
+        { 90.4109589, 62.10045662, 42.92237443 },
+        { 85.84474886, 56.62100457, 39.7260274 },
+        { 80.82191781, 58.90410959, 48.40182648 },
+        { 77.62557078, 47.03196347, 33.78995434 },
+        { 73.05936073, 42.46575342, 28.76712329 },
+        { 64.84018265, 44.74885845, 34.24657534 },
+        { 94.06392694, 78.53881279, 78.99543379 },
+        { 86.75799087, 65.75342466, 62.55707763 },
+        { 72.60273973, 48.40182648, 42.92237443 },
+        { 65.75342466, 45.66210046, 42.46575342 },
+        { 68.03652968, 39.26940639, 31.96347032 },
+        { 36.07305936, 21.91780822, 21.00456621 },
+        { 79.45205479, 51.59817352, 26.02739726 },
+        { 73.97260274, 44.74885845, 23.74429224 },
+        { 43.83561644, 25.57077626, 22.37442922 },
+        { 63.92694064, 52.51141553, 41.55251142 },
+    };
+
+    // CalMAN ColorChecker, grays first from white
+    const double cmcColors[24][3] =
+    {
+        { 100, 100, 100 },
+        { 89.9543379, 89.9543379, 89.9543379 },
+        { 82.19178082, 82.19178082, 82.19178082 },
+        { 73.05936073, 73.05936073, 73.05936073 },
+        { 62.10045662, 62.10045662, 62.10045662 },
+        { 0, 0, 0 },
+        { 45.20547945, 31.96347032, 26.02739726 },
+        { 75.79908676, 58.90410959, 51.14155251 },
+        { 36.98630137, 47.94520548, 61.18721461 },
+        { 35.15981735, 42.00913242, 26.02739726 },
+        { 51.14155251, 50.2283105, 68.94977169 },
+        { 38.81278539, 73.97260274, 66.21004566 },
+        { 84.93150685, 47.03196347, 15.98173516 },
+        { 29.22374429, 36.07305936, 63.92694064 },
+        { 75.79908676, 32.87671233, 37.89954338 },
+        { 36.07305936, 24.20091324, 42.00913242 },
+        { 62.10045662, 73.05936073, 25.11415525 },
+        { 89.9543379, 63.01369863, 17.80821918 },
+        { 20.0913242, 24.20091324, 58.90410959 },
+        { 27.85388128, 57.99086758, 27.85388128 },
+        { 68.94977169, 19.17808219, 22.83105023 },
+        { 93.15068493, 78.08219178, 12.78538813 },
+        { 73.05936073, 32.87671233, 57.07762557 },
+        { 0, 52.05479452, 63.92694064 },
+    };
+
+    // CalMAN classic
+    const double cmsColors[19][3] =
+    {
+        { 100, 100, 100 },
+        { 0, 0, 0 },
+        { 43.83561644, 25.11415525, 15.06849315 },
+        { 79.9086758, 53.88127854, 40.1826484 },
+        { 100, 78.08219178, 59.8173516 },
+        { 100, 78.08219178, 67.12328767 },
+        { 96.80365297, 67.12328767, 48.85844749 },
+        { 78.08219178, 54.79452055, 36.07305936 },
+        { 56.16438356, 36.07305936, 20.0913242 },
+        { 80.82191781, 58.90410959, 45.20547945 },
+        { 63.01369863, 33.78995434, 12.78538813 },
+        { 84.01826484, 52.05479452, 36.07305936 },
+        { 82.19178082, 53.88127854, 41.09589041 },
+        { 98.17351598, 59.8173516, 45.20547945 },
+        { 78.08219178, 56.16438356, 42.00913242 },
+        { 78.99543379, 54.79452055, 42.00913242 },
+        { 79.9086758, 56.16438356, 41.09589041 },
+        { 47.94520548, 29.22374429, 15.06849315 },
+        { 84.93150685, 54.79452055, 36.98630137 },
+    };
+
+    // CalMAN skin
+    const double cpsColors[19][3] =
+    {
+        { 100, 100, 100 },
+        { 84.47488584, 49.31506849, 34.24657534 },
+        { 78.99543379, 55.25114155, 48.40182648 },
+        { 93.60730594, 67.57990868, 57.99086758 },
+        { 94.52054795, 61.18721461, 52.96803653 },
+        { 75.34246575, 56.16438356, 42.92237443 },
+        { 74.88584475, 57.07762557, 49.31506849 },
+        { 55.25114155, 36.52968037, 24.65753425 },
+        { 76.25570776, 56.62100457, 49.7716895 },
+        { 75.79908676, 58.90410959, 51.14155251 },
+        { 77.16894977, 56.62100457, 48.85844749 },
+        { 62.10045662, 34.24657534, 17.80821918 },
+        { 47.03196347, 29.6803653, 18.72146119 },
+        { 81.73515982, 52.96803653, 42.46575342 },
+        { 82.64840183, 56.16438356, 43.83561644 },
+        { 93.15068493, 68.49315068, 48.40182648 },
+        { 81.73515982, 60.2739726, 42.46575342 },
+        { 45.20547945, 31.96347032, 26.48401826 },
+        { 76.25570776, 58.90410959, 51.14155251 },
+    };
+
+    // ColorChecker SG, 96 colors
+    const double ccsgColors[96][3] =
+    {
+        { 100, 100, 100 },
+        { 87.2146119, 87.2146119, 87.2146119 },
+        { 77.1689498, 77.1689498, 77.1689498 },
+        { 72.1461187, 72.1461187, 72.1461187 },
+        { 67.1232877, 67.1232877, 67.1232877 },
+        { 61.1872146, 61.1872146, 61.1872146 },
+        { 56.1643836, 56.1643836, 56.1643836 },
+        { 46.1187215, 46.1187215, 46.1187215 },
+        { 42.0091324, 42.0091324, 42.0091324 },
+        { 36.9863014, 36.9863014, 36.9863014 },
+        { 32.8767123, 32.8767123, 32.8767123 },
+        { 29.2237443, 29.2237443, 29.2237443 },
+        { 21.0045662, 21.0045662, 21.0045662 },
+        { 16.8949772, 16.8949772, 16.8949772 },
+        { 0, 0, 0 },
+        { 57.0776256, 10.9589041, 32.8767123 },
+        { 29.2237443, 17.8082192, 27.8538813 },
+        { 84.9315068, 82.1917808, 75.7990868 },
+        { 43.8356164, 25.1141553, 15.0684932 },
+        { 79.9086758, 53.8812785, 40.1826484 },
+        { 35.1598174, 43.8356164, 51.1415525 },
+        { 32.8767123, 37.8995434, 11.8721461 },
+        { 50.2283105, 46.1187215, 57.0776256 },
+        { 42.0091324, 70.7762557, 56.1643836 },
+        { 100, 78.0821918, 59.8173516 },
+        { 38.8127854, 10.9589041, 15.9817352 },
+        { 74.8858447, 11.8721461, 29.2237443 },
+        { 73.9726027, 50.2283105, 61.1872146 },
+        { 42.9223744, 35.1598174, 53.8812785 },
+        { 99.086758, 78.0821918, 70.7762557 },
+        { 90.8675799, 43.8356164, 0 },
+        { 24.2009132, 31.0502283, 56.1643836 },
+        { 78.0821918, 25.1141553, 26.9406393 },
+        { 31.9634703, 15.0684932, 31.9634703 },
+        { 66.2100457, 70.7762557, 0 },
+        { 91.7808219, 58.9041096, 0 },
+        { 84.0182648, 90.8675799, 70.7762557 },
+        { 79.9086758, 0, 8.2191781 },
+        { 33.7899543, 12.7853881, 21.0045662 },
+        { 46.1187215, 11.8721461, 43.8356164 },
+        { 0, 21.0045662, 35.1598174 },
+        { 73.9726027, 85.8447489, 72.1461187 },
+        { 5.0228311, 16.8949772, 46.1187215 },
+        { 26.0273973, 54.7945205, 15.9817352 },
+        { 69.8630137, 0, 10.0456621 },
+        { 96.803653, 74.8858447, 0 },
+        { 75.7990868, 26.0273973, 47.9452055 },
+        { 0, 50.2283105, 54.7945205 },
+        { 90.8675799, 79.9086758, 74.8858447 },
+        { 84.0182648, 46.1187215, 47.0319635 },
+        { 74.8858447, 0, 15.0684932 },
+        { 0, 48.8584475, 68.0365297 },
+        { 32.8767123, 59.8173516, 68.0365297 },
+        { 100, 78.0821918, 67.1232877 },
+        { 74.8858447, 84.0182648, 75.7990868 },
+        { 87.2146119, 46.1187215, 40.1826484 },
+        { 94.0639269, 20.0913242, 15.0684932 },
+        { 19.1780822, 63.0136986, 64.8401826 },
+        { 0, 22.8310502, 26.9406393 },
+        { 85.8447489, 83.1050228, 52.0547945 },
+        { 100, 40.1826484, 0 },
+        { 100, 63.0136986, 0 },
+        { 0, 22.8310502, 20.0913242 },
+        { 46.1187215, 57.9908676, 68.9497717 },
+        { 85.8447489, 47.9452055, 27.8538813 },
+        { 96.803653, 67.1232877, 48.8584475 },
+        { 78.0821918, 54.7945205, 36.0730594 },
+        { 56.1643836, 36.0730594, 20.0913242 },
+        { 80.8219178, 58.9041096, 45.2054795 },
+        { 63.0136986, 33.7899543, 12.7853881 },
+        { 84.0182648, 52.0547945, 36.0730594 },
+        { 78.0821918, 69.8630137, 0 },
+        { 100, 74.8858447, 0 },
+        { 0, 63.0136986, 56.1643836 },
+        { 0, 54.7945205, 46.1187215 },
+        { 82.1917808, 53.8812785, 41.0958904 },
+        { 98.173516, 59.8173516, 45.2054795 },
+        { 78.0821918, 56.1643836, 42.0091324 },
+        { 78.9954338, 54.7945205, 42.0091324 },
+        { 79.9086758, 56.1643836, 41.0958904 },
+        { 47.9452055, 29.2237443, 15.0684932 },
+        { 84.9315068, 54.7945205, 36.9863014 },
+        { 72.1461187, 56.1643836, 9.1324201 },
+        { 73.0593607, 69.8630137, 0 },
+        { 25.1141553, 21.0045662, 14.1552511 },
+        { 35.1598174, 63.0136986, 35.1598174 },
+        { 0, 53.8812785, 31.0502283 },
+        { 11.8721461, 25.1141553, 15.9817352 },
+        { 22.8310502, 63.0136986, 42.9223744 },
+        { 47.9452055, 61.1872146, 21.9178082 },
+        { 20.0913242, 53.8812785, 10.0456621 },
+        { 29.2237443, 66.2100457, 15.9817352 },
+        { 78.9954338, 52.0547945, 16.8949772 },
+        { 62.1004566, 58.9041096, 10.0456621 },
+        { 64.8401826, 73.0593607, 0 },
+        { 30.1369863, 16.8949772, 10.0456621 },
+    };
+
+    struct ColorCheckerEntry
+    {
+        CCPatterns pattern;
+        ColorCheckerTable table;
+    };
+
+    const ColorCheckerEntry colorCheckerTables[] =
+    {
+        { GCD, { gcdColors, 24 } },
+        { MCD, { mcdColors, 24 } },
+        { SKIN, { skinColors, 24 } },
+        { CMC, { cmcColors, 24 } },
+        { CMS, { cmsColors, 19 } },
+        { CPS, { cpsColors, 19 } },
+        { CCSG, { ccsgColors, 96 } },
+    };
+}
+
+const ColorCheckerTable* GetColorCheckerTable(int aCCMode)
+{
+    for (size_t i = 0; i < sizeof(colorCheckerTables) / sizeof(colorCheckerTables[0]); i++)
+    {
+        if (colorCheckerTables[i].pattern == aCCMode)
+        {
+            return &colorCheckerTables[i].table;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,34 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(COLOR_CHECKER_TABLES_H_INCLUDED_)
+#define COLOR_CHECKER_TABLES_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+
+// The patches of a colour checker set built into the library, in percent
+// of the video range, before any HDR recalculation
+struct ColorCheckerTable
+{
+    const double (*colors)[3];
+    int size;
+};
+
+// The table of GCD, MCD, SKIN, CMC, CMS, CPS or CCSG, NULL for the sets
+// that are computed or read from files
+const ColorCheckerTable* GetColorCheckerTable(int aCCMode);
+
+#endif // !defined(COLOR_CHECKER_TABLES_H_INCLUDED_)
@@ -23,7 +23,7 @@ CriticalSection::CriticalSection()
 {
 #ifdef LIBHCFR_HAS_WIN32_API
     InitializeCriticalSection(&m_critcalSection);
-#elif LIBHCFR_HAS_PTHREADS
+#elif defined(LIBHCFR_HAS_PTHREADS)
     pthread_mutex_init(&m_matrixMutex, NULL);
 #endif
 }
@@ -32,7 +32,7 @@ CriticalSection::~CriticalSection()
 {
 #ifdef LIBHCFR_HAS_WIN32_API
     DeleteCriticalSection(&m_critcalSection);
-#elif LIBHCFR_HAS_PTHREADS
+#elif defined(LIBHCFR_HAS_PTHREADS)
     pthread_mutex_destroy(&m_matrixMutex);
 #endif
 }
@@ -41,7 +41,7 @@ _Acquires_lock_(&m_critcalSection) void CriticalSection::lock()
 {
 #ifdef LIBHCFR_HAS_WIN32_API
 	EnterCriticalSection(&m_critcalSection);
-#elif LIBHCFR_HAS_PTHREADS
+#elif defined(LIBHCFR_HAS_PTHREADS)
     pthread_mutex_lock(&m_matrixMutex);
 #endif
 }
@@ -50,7 +50,7 @@ _Releases_lock_(&m_critcalSection) void CriticalSection::unlock()
 {
 #ifdef LIBHCFR_HAS_WIN32_API
     LeaveCriticalSection(&m_critcalSection);
-#elif LIBHCFR_HAS_PTHREADS
+#elif defined(LIBHCFR_HAS_PTHREADS)
     pthread_mutex_unlock (&m_matrixMutex);
 #endif
 }
@@ -24,10 +24,16 @@
 
 #ifdef LIBHCFR_HAS_WIN32_API
 #   include <windows.h>
-#elif LIBHCFR_HAS_PTHREADS
+#elif defined(LIBHCFR_HAS_PTHREADS)
 #   include <pthread.h>
 #endif
 
+// lock annotations only mean something to the MSVC code analyser
+#ifndef _Acquires_lock_
+#   define _Acquires_lock_(lock)
+#   define _Releases_lock_(lock)
+#endif
+
 /// CriticalSection
 /// Class to provide a simple way of ensuring that
 /// multiple threads do not access the same object at the same
@@ -43,7 +49,7 @@ public:
 private:
 #   ifdef LIBHCFR_HAS_WIN32_API
         CRITICAL_SECTION m_critcalSection;
-#   elif LIBHCFR_HAS_PTHREADS
+#   elif defined(LIBHCFR_HAS_PTHREADS)
         pthread_mutex_t m_matrixMutex;
 #   endif
 };
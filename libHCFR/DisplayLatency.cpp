@@ -0,0 +1,511 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "DisplayLatency.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    struct LatencySample
+    {
+        double timeMs;
+        double Y;
+    };
+
+    // First time the change reaches a fraction of its size, between
+    // the samples around it
+    double crossingTime(const std::vector<LatencySample>& samples, double fromY, double change, double fraction)
+    {
+        double previous = 0.0;
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            double progress = (samples[i].Y - fromY) / change;
+            if (progress >= fraction)
+            {
+                if (i == 0 || progress <= previous)
+                {
+                    return samples[i].timeMs;
+                }
+                return samples[i - 1].timeMs + (samples[i].timeMs - samples[i - 1].timeMs)
+                       * (fraction - previous) / (progress - previous);
+            }
+            previous = progress;
+        }
+        return samples.empty() ? 0.0 : samples.back().timeMs;
+    }
+
+    // Time after which the light stays within the tolerance of its
+    // final value
+    double settlingTime(const std::vector<LatencySample>& samples, double toY, double tolerance)
+    {
+        int last = -1;
+        for (int i = (int)samples.size() - 1; i >= 0; i--)
+        {
+            if (fabs(samples[i].Y - toY) > tolerance)
+            {
+                last = i;
+                break;
+            }
+        }
+        if (last < 0)
+        {
+            return samples.front().timeMs;
+        }
+        if (last + 1 >= (int)samples.size())
+        {
+            return samples.back().timeMs;
+        }
+        double outside = fabs(samples[last].Y - toY);
+        double inside = fabs(samples[last + 1].Y - toY);
+        return samples[last].timeMs + (samples[last + 1].timeMs - samples[last].timeMs)
+               * (outside - tolerance) / (outside - inside);
+    }
+
+    bool sameLevel(double a, double b)
+    {
+        return fabs(a - b) < 1e-6;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// CDisplayLatencyProfile
+
+CDisplayLatencyProfile::CDisplayLatencyProfile() :
+    m_updateDelayMs(-1),
+    m_instrumentDelayMs(-1),
+    m_marginPercent(10.0),
+    m_marginMs(10.0)
+{
+}
+
+void CDisplayLatencyProfile::Clear()
+{
+    m_displayName.clear();
+    m_updateDelayMs = m_instrumentDelayMs = -1;
+    m_levels.clear();
+    m_transitions.clear();
+}
+
+void CDisplayLatencyProfile::SetProbeDelays(int updateDelayMs, int instrumentDelayMs)
+{
+    m_updateDelayMs = updateDelayMs;
+    m_instrumentDelayMs = instrumentDelayMs;
+}
+
+void CDisplayLatencyProfile::AddTransition(const DisplayTransition& transition)
+{
+    m_transitions.push_back(transition);
+    double levels[2] = { transition.fromLevel, transition.toLevel };
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<double>::iterator it = std::lower_bound(m_levels.begin(), m_levels.end(), levels[i] - 1e-6);
+        if (it == m_levels.end() || !sameLevel(*it, levels[i]))
+        {
+            m_levels.insert(it, levels[i]);
+        }
+    }
+}
+
+const DisplayTransition* CDisplayLatencyProfile::find(double fromLevel, double toLevel) const
+{
+    for (size_t i = 0; i < m_transitions.size(); i++)
+    {
+        if (sameLevel(m_transitions[i].fromLevel, fromLevel) && sameLevel(m_transitions[i].toLevel, toLevel))
+        {
+            return &m_transitions[i];
+        }
+    }
+    return NULL;
+}
+
+int CDisplayLatencyProfile::GetWaitMs(double fromLevel, double toLevel) const
+{
+    if (sameLevel(fromLevel, toLevel))
+    {
+        return 0;
+    }
+    if (m_transitions.empty())
+    {
+        return -1;
+    }
+
+    // the measured levels on each side of both ends
+    size_t from[2], to[2];
+    double ends[2] = { fromLevel, toLevel };
+    size_t* brackets[2] = { from, to };
+    for (int i = 0; i < 2; i++)
+    {
+        size_t upper = std::lower_bound(m_levels.begin(), m_levels.end(), ends[i]) - m_levels.begin();
+        brackets[i][1] = std::min(upper, m_levels.size() - 1);
+        brackets[i][0] = (upper > 0 && !sameLevel(m_levels[brackets[i][1]], ends[i])) ? upper - 1 : brackets[i][1];
+    }
+
+    double settleMs = -1.0;
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            const DisplayTransition* transition = find(m_levels[from[i]], m_levels[to[j]]);
+            if (from[i] != to[j] && transition)
+            {
+                settleMs = std::max(settleMs, transition->settleMs);
+            }
+        }
+    }
+    if (settleMs < 0.0)
+    {
+        // nothing measured around these levels, take the slowest
+        for (size_t i = 0; i < m_transitions.size(); i++)
+        {
+            settleMs = std::max(settleMs, m_transitions[i].settleMs);
+        }
+    }
+    return (int)ceil(settleMs * (1.0 + m_marginPercent / 100.0) + m_marginMs - 1e-6);
+}
+
+void CDisplayLatencyProfile::Write(std::ostream& out) const
+{
+    char line[256];
+    out << "CGATS.17\n\n";
+    out << "ORIGINATOR \"HCFR\"\n";
+    out << "DESCRIPTOR \"" << m_displayName << "\"\n";
+    out << "UPDATE_DELAY_MS " << m_updateDelayMs << "\n";
+    out << "INSTRUMENT_DELAY_MS " << m_instrumentDelayMs << "\n";
+    sprintf(line, "MARGIN_PERCENT %.1f\nMARGIN_MS %.1f\n\n", m_marginPercent, m_marginMs);
+    out << line;
+    out << "NUMBER_OF_FIELDS 5\n";
+    out << "BEGIN_DATA_FORMAT\n";
+    out << "FROM_LEVEL TO_LEVEL LATENCY_MS RISE_MS SETTLE_MS\n";
+    out << "END_DATA_FORMAT\n\n";
+    out << "NUMBER_OF_SETS " << m_transitions.size() << "\n";
+    out << "BEGIN_DATA\n";
+    for (size_t i = 0; i < m_transitions.size(); i++)
+    {
+        const DisplayTransition& transition = m_transitions[i];
+        sprintf(line, "%.2f %.2f %.1f %.1f %.1f\n", transition.fromLevel, transition.toLevel,
+                transition.latencyMs, transition.riseMs, transition.settleMs);
+        out << line;
+    }
+    out << "END_DATA\n";
+}
+
+bool CDisplayLatencyProfile::Read(std::istream& in, std::string& error)
+{
+    Clear();
+    std::string line;
+    bool bData = false;
+    bool bEnd = false;
+    int nLine = 0;
+
+    while (!bEnd && std::getline(in, line))
+    {
+        nLine++;
+        if (!line.empty() && line[line.size() - 1] == '\r')
+        {
+            line.erase(line.size() - 1);
+        }
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword))
+        {
+            continue;
+        }
+
+        if (nLine == 1 && keyword != "CGATS.17")
+        {
+            error = "not a CGATS file";
+            return false;
+        }
+        if (bData)
+        {
+            if (keyword == "END_DATA")
+            {
+                bEnd = true;
+                continue;
+            }
+            DisplayTransition transition;
+            std::istringstream values(line);
+            if (!(values >> transition.fromLevel >> transition.toLevel >> transition.latencyMs
+                         >> transition.riseMs >> transition.settleMs))
+            {
+                std::ostringstream message;
+                message << "bad transition on line " << nLine;
+                error = message.str();
+                return false;
+            }
+            AddTransition(transition);
+        }
+        else if (keyword == "DESCRIPTOR")
+        {
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            if (first != std::string::npos && last > first)
+            {
+                m_displayName = line.substr(first + 1, last - first - 1);
+            }
+        }
+        else if (keyword == "UPDATE_DELAY_MS")
+        {
+            fields >> m_updateDelayMs;
+        }
+        else if (keyword == "INSTRUMENT_DELAY_MS")
+        {
+            fields >> m_instrumentDelayMs;
+        }
+        else if (keyword == "MARGIN_PERCENT")
+        {
+            fields >> m_marginPercent;
+        }
+        else if (keyword == "MARGIN_MS")
+        {
+            fields >> m_marginMs;
+        }
+        else if (keyword == "BEGIN_DATA_FORMAT")
+        {
+            std::string format;
+            std::getline(in, format);
+            nLine++;
+            if (format.find("FROM_LEVEL TO_LEVEL LATENCY_MS RISE_MS SETTLE_MS") != 0)
+            {
+                error = "not a display latency profile";
+                return false;
+            }
+        }
+        else if (keyword == "BEGIN_DATA")
+        {
+            bData = true;
+        }
+    }
+
+    if (!bEnd || m_transitions.empty())
+    {
+        error = "no transitions in the profile";
+        return false;
+    }
+    return true;
+}
+
+bool CDisplayLatencyProfile::Save(const std::string& path) const
+{
+    std::ofstream out(path.c_str());
+    if (!out)
+    {
+        return false;
+    }
+    Write(out);
+    return out.good();
+}
+
+bool CDisplayLatencyProfile::Load(const std::string& path, std::string& error)
+{
+    std::ifstream in(path.c_str());
+    if (!in)
+    {
+        error = "can't open " + path;
+        return false;
+    }
+    return Read(in, error);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Characterisation
+
+LatencyCharacterisationConfig::LatencyCharacterisationConfig() :
+    windowMs(500.0),
+    holdMs(500.0),
+    tolerance(0.02),
+    minChange(0.01)
+{
+    for (int level = 0; level <= 100; level += 25)
+    {
+        levels.push_back(level);
+    }
+}
+
+bool CharacteriseDisplayLatency(CLatencyTarget& target,
+                                const LatencyCharacterisationConfig& config,
+                                CDisplayLatencyProfile& profile,
+                                std::string& error)
+{
+    profile.Clear();
+    profile.SetDisplayName(target.GetName());
+
+    // readings are stamped at the middle of the read, unless the
+    // instrument knows when it samples
+    int updateDelayMs = -1;
+    int instrumentDelayMs = -1;
+    if (target.MeasureUpdateDelay(updateDelayMs, instrumentDelayMs))
+    {
+        profile.SetProbeDelays(updateDelayMs, instrumentDelayMs);
+    }
+
+    for (size_t i = 0; i < config.levels.size(); i++)
+    {
+        for (size_t j = 0; j < config.levels.size(); j++)
+        {
+            if (i == j)
+            {
+                continue;
+            }
+
+            double fromY = 0.0;
+            if (!target.ShowLevel(config.levels[i]))
+            {
+                error = "can't display the starting level";
+                return false;
+            }
+            target.WaitMs(config.holdMs);
+            if (!target.ReadY(fromY))
+            {
+                error = "can't read the starting level";
+                return false;
+            }
+
+            std::vector<LatencySample> samples;
+            double start = target.GetClockMs();
+            if (!target.ShowLevel(config.levels[j]))
+            {
+                error = "can't display the level";
+                return false;
+            }
+            while (target.GetClockMs() - start < config.windowMs)
+            {
+                LatencySample sample;
+                double before = target.GetClockMs();
+                if (!target.ReadY(sample.Y))
+                {
+                    error = "reading failed";
+                    return false;
+                }
+                double after = target.GetClockMs();
+                sample.timeMs = (instrumentDelayMs >= 0 ? before + instrumentDelayMs : (before + after) / 2.0) - start;
+                samples.push_back(sample);
+            }
+            if (samples.size() < 5)
+            {
+                error = "the instrument reads too slowly to time transitions";
+                return false;
+            }
+
+            // the final level is what the end of the window settled on
+            double toY = 0.0;
+            int nFinal = 0;
+            for (size_t k = 0; k < samples.size(); k++)
+            {
+                if (samples[k].timeMs >= config.windowMs * 0.8 || k + 1 == samples.size())
+                {
+                    toY += samples[k].Y;
+                    nFinal++;
+                }
+            }
+            toY /= nFinal;
+
+            DisplayTransition transition;
+            transition.fromLevel = config.levels[i];
+            transition.toLevel = config.levels[j];
+            double change = toY - fromY;
+            if (fabs(change) < config.minChange)
+            {
+                // too small to see, the display update delay is all
+                // that can be waited for
+                transition.latencyMs = transition.riseMs = 0.0;
+                transition.settleMs = std::max(0, updateDelayMs);
+            }
+            else
+            {
+                transition.latencyMs = crossingTime(samples, fromY, change, 0.1);
+                transition.riseMs = crossingTime(samples, fromY, change, 0.9) - transition.latencyMs;
+                transition.settleMs = settlingTime(samples, toY, fabs(change) * config.tolerance);
+                if (transition.settleMs > config.windowMs * 0.8)
+                {
+                    // still moving when the final level was taken
+                    transition.settleMs = config.windowMs;
+                }
+            }
+            profile.AddTransition(transition);
+        }
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// CSimulatedLatencyDisplay
+
+CSimulatedLatencyDisplay::CSimulatedLatencyDisplay(double latencyMs, double riseMs, double fallMs,
+                                                   double gamma, double whiteY) :
+    m_latencyMs(latencyMs),
+    m_riseMs(riseMs),
+    m_fallMs(fallMs),
+    m_gamma(gamma),
+    m_whiteY(whiteY),
+    m_readMs(10.0),
+    m_instrumentDelayMs(5.0),
+    m_clockMs(0.0),
+    m_changeMs(0.0),
+    m_fromY(0.0),
+    m_toY(0.0)
+{
+}
+
+void CSimulatedLatencyDisplay::SetReadTime(double readMs, double instrumentDelayMs)
+{
+    m_readMs = readMs;
+    m_instrumentDelayMs = instrumentDelayMs;
+}
+
+double CSimulatedLatencyDisplay::GetY(double timeMs) const
+{
+    double elapsed = timeMs - m_changeMs - m_latencyMs;
+    if (elapsed <= 0.0)
+    {
+        return m_fromY;
+    }
+    // first order response, its 10% to 90% time is ln(9) time constants
+    double transitionMs = (m_toY >= m_fromY ? m_riseMs : m_fallMs);
+    if (transitionMs <= 0.0)
+    {
+        return m_toY;
+    }
+    return m_toY + (m_fromY - m_toY) * exp(-elapsed * log(9.0) / transitionMs);
+}
+
+bool CSimulatedLatencyDisplay::ShowLevel(double level)
+{
+    double fromY = GetY(m_clockMs);
+    m_fromY = fromY;
+    m_toY = m_whiteY * pow(std::max(0.0, std::min(level, 100.0)) / 100.0, m_gamma);
+    m_changeMs = m_clockMs;
+    return true;
+}
+
+bool CSimulatedLatencyDisplay::ReadY(double& Y)
+{
+    Y = GetY(m_clockMs + m_instrumentDelayMs);
+    m_clockMs += m_readMs;
+    return true;
+}
+
+bool CSimulatedLatencyDisplay::MeasureUpdateDelay(int& updateDelayMs, int& instrumentDelayMs)
+{
+    updateDelayMs = (int)floor(m_latencyMs + 0.5);
+    instrumentDelayMs = (int)floor(m_instrumentDelayMs + 0.5);
+    return true;
+}
@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(DISPLAY_LATENCY_H_INCLUDED_)
+#define DISPLAY_LATENCY_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+// Timing of one gray transition, from the moment the new level is
+// sent to the display
+struct DisplayTransition
+{
+    double fromLevel;   // percent
+    double toLevel;     // percent
+    double latencyMs;   // until 10% of the change is seen
+    double riseMs;      // 10% to 90% of the change, rise or fall
+    double settleMs;    // until the light stays within tolerance of
+                        // its final value
+};
+
+// How long each gray transition of a display takes to settle, so that
+// generators wait no longer than needed before a reading
+class CDisplayLatencyProfile
+{
+public:
+    CDisplayLatencyProfile();
+
+    void Clear();
+    bool IsEmpty() const { return m_transitions.empty(); }
+
+    void SetDisplayName(const std::string& name) { m_displayName = name; }
+    const std::string& GetDisplayName() const { return m_displayName; }
+    // What the instrument delay probe found, -1 when not measured
+    void SetProbeDelays(int updateDelayMs, int instrumentDelayMs);
+    int GetUpdateDelayMs() const { return m_updateDelayMs; }
+    int GetInstrumentDelayMs() const { return m_instrumentDelayMs; }
+    // Added to every wait, in percent of the settling time and in ms
+    void SetMargin(double percent, double ms) { m_marginPercent = percent; m_marginMs = ms; }
+
+    void AddTransition(const DisplayTransition& transition);
+    const std::vector<DisplayTransition>& GetTransitions() const { return m_transitions; }
+
+    // Wait for a change between two levels: the longest settling time
+    // of the measured transitions around them, plus the margin. No
+    // wait when the level doesn't change.
+    int GetWaitMs(double fromLevel, double toLevel) const;
+
+    void Write(std::ostream& out) const;
+    bool Read(std::istream& in, std::string& error);
+    bool Save(const std::string& path) const;
+    bool Load(const std::string& path, std::string& error);
+
+private:
+    const DisplayTransition* find(double fromLevel, double toLevel) const;
+
+    std::string m_displayName;
+    int m_updateDelayMs;
+    int m_instrumentDelayMs;
+    double m_marginPercent;
+    double m_marginMs;
+    std::vector<double> m_levels;
+    std::vector<DisplayTransition> m_transitions;
+};
+
+// A display and an instrument looking at it, as the characterisation
+// drives them
+class CLatencyTarget
+{
+public:
+    virtual ~CLatencyTarget() {}
+    virtual std::string GetName() const = 0;
+    // Returns once the pattern is submitted, without waiting for it to settle:
+    // transitions are timed from this call
+    virtual bool ShowLevel(double level) = 0;
+    // A single quick luminance reading
+    virtual bool ReadY(double& Y) = 0;
+    virtual double GetClockMs() = 0;
+    virtual void WaitMs(double ms) = 0;
+    // The instrument's own display update delay measure, timing a
+    // black to white change, when it has one
+    virtual bool MeasureUpdateDelay(int& /*updateDelayMs*/, int& /*instrumentDelayMs*/) { return false; }
+};
+
+struct LatencyCharacterisationConfig
+{
+    LatencyCharacterisationConfig();
+
+    std::vector<double> levels;     // gray levels, every pair is measured
+    double windowMs;                // sampling time of a transition
+    double holdMs;                  // time the starting level is shown
+    double tolerance;               // settled within this fraction of the change
+    double minChange;               // smaller Y changes are not timed
+};
+
+// Time every transition between the configured levels and fill the
+// profile. When the instrument can probe the update delay, readings
+// are timestamped with its reaction time.
+bool CharacteriseDisplayLatency(CLatencyTarget& target,
+                                const LatencyCharacterisationConfig& config,
+                                CDisplayLatencyProfile& profile,
+                                std::string& error);
+
+// A display with a programmable latency and first order rise and fall,
+// on a simulated clock so that a characterisation takes no real time
+class CSimulatedLatencyDisplay : public CLatencyTarget
+{
+public:
+    CSimulatedLatencyDisplay(double latencyMs, double riseMs, double fallMs,
+                             double gamma = 2.22, double whiteY = 120.0);
+
+    // Time a reading takes, and when in it the light is sampled
+    void SetReadTime(double readMs, double instrumentDelayMs);
+
+    virtual std::string GetName() const { return "Simulated latency display"; }
+    virtual bool ShowLevel(double level);
+    virtual bool ReadY(double& Y);
+    virtual double GetClockMs() { return m_clockMs; }
+    virtual void WaitMs(double ms) { m_clockMs += ms; }
+    virtual bool MeasureUpdateDelay(int& updateDelayMs, int& instrumentDelayMs);
+
+    // Light at a time of the simulated clock
+    double GetY(double timeMs) const;
+
+private:
+    double m_latencyMs;
+    double m_riseMs;
+    double m_fallMs;
+    double m_gamma;
+    double m_whiteY;
+    double m_readMs;
+    double m_instrumentDelayMs;
+    double m_clockMs;
+    double m_changeMs;
+    double m_fromY;
+    double m_toY;
+};
+
+#endif // !defined(DISPLAY_LATENCY_H_INCLUDED_)
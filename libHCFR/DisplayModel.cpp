@@ -0,0 +1,572 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "DisplayModel.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    // a change is settled within this fraction of its size
+    const double SETTLED = 0.001;
+
+    // Gaussian stand ins for the emission of the primaries, peak and
+    // width in nm
+    const double spectrumPeaks[3] = { 612.0, 545.0, 455.0 };
+    const double spectrumWidths[3] = { 18.0, 25.0, 12.0 };
+
+    double eotf(DisplayModelConfig::Eotf type, double gamma, double whiteY, double blackY, double value)
+    {
+        switch (type)
+        {
+        case DisplayModelConfig::EOTF_BT1886:
+            {
+                if (whiteY <= blackY || blackY <= 0.0)
+                {
+                    return pow(value, gamma);
+                }
+                double whiteRoot = pow(whiteY, 1.0 / gamma);
+                double blackRoot = pow(blackY, 1.0 / gamma);
+                double a = pow(whiteRoot - blackRoot, gamma);
+                double b = blackRoot / (whiteRoot - blackRoot);
+                // the black level is added to every patch afterwards
+                return (a * pow(value + b, gamma) - blackY) / (whiteY - blackY);
+            }
+        case DisplayModelConfig::EOTF_SRGB:
+            return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+        case DisplayModelConfig::EOTF_PQ:
+            {
+                const double m1 = 2610.0 / 16384.0;
+                const double m2 = 2523.0 / 4096.0 * 128.0;
+                const double c1 = 3424.0 / 4096.0;
+                const double c2 = 2413.0 / 4096.0 * 32.0;
+                const double c3 = 2392.0 / 4096.0 * 32.0;
+                double p = pow(value, 1.0 / m2);
+                double numerator = p - c1 > 0.0 ? p - c1 : 0.0;
+                double Y = 10000.0 * pow(numerator / (c2 - c3 * p), 1.0 / m1);
+                return Y < whiteY ? Y / whiteY : 1.0;
+            }
+        default:
+            return pow(value, gamma);
+        }
+    }
+
+    // XYZ of a chromaticity with a Y of 1
+    void xyToXYZ(const double xy[2], double XYZ[3])
+    {
+        XYZ[0] = xy[0] / xy[1];
+        XYZ[1] = 1.0;
+        XYZ[2] = (1.0 - xy[0] - xy[1]) / xy[1];
+    }
+
+    double determinant(const double m[3][3])
+    {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    // Up to three numbers separated by colons
+    bool parseNumbers(const std::string& text, double values[3], int& nValues)
+    {
+        nValues = 0;
+        const char* p = text.c_str();
+        while (nValues < 3)
+        {
+            char* pEnd;
+            values[nValues] = strtod(p, &pEnd);
+            if (pEnd == p)
+            {
+                return false;
+            }
+            nValues++;
+            if (*pEnd == '\0')
+            {
+                return true;
+            }
+            if (*pEnd != ':')
+            {
+                return false;
+            }
+            p = pEnd + 1;
+        }
+        return false;
+    }
+}
+
+DisplayModelConfig::DisplayModelConfig() :
+    whiteY(120.0),
+    blackY(0.0),
+    bits(8),
+    ablWindow(0.1),
+    ablThreshold(1.0),
+    ablMinGain(1.0),
+    warmUpDrop(0.0),
+    warmUpMs(600000.0),
+    noiseRelative(0.0),
+    noiseAbsolute(0.0),
+    offsetErrorMax(0.0),
+    gainErrorMax(0.0),
+    latencyMs(0.0),
+    responseMs(0.0),
+    readMs(0.0),
+    bSpectrum(false),
+    seed(1)
+{
+    // BT.709 with a 2.22 gamma
+    red[0] = 0.640;
+    red[1] = 0.330;
+    green[0] = 0.300;
+    green[1] = 0.600;
+    blue[0] = 0.150;
+    blue[1] = 0.060;
+    white[0] = 0.3127;
+    white[1] = 0.3290;
+    for (int i = 0; i < 3; i++)
+    {
+        eotf[i] = EOTF_GAMMA;
+        gamma[i] = 2.22;
+    }
+}
+
+void DisplayModelConfig::SetPrimaries(const CColorReference& colorReference)
+{
+    ColorxyY redxyY(colorReference.redPrimary);
+    ColorxyY greenxyY(colorReference.greenPrimary);
+    ColorxyY bluexyY(colorReference.bluePrimary);
+    ColorxyY whitexyY(colorReference.GetWhite());
+    red[0] = redxyY[0];
+    red[1] = redxyY[1];
+    green[0] = greenxyY[0];
+    green[1] = greenxyY[1];
+    blue[0] = bluexyY[0];
+    blue[1] = bluexyY[1];
+    white[0] = whitexyY[0];
+    white[1] = whitexyY[1];
+}
+
+bool ParseDisplayModelConfig(const std::string& text, DisplayModelConfig& config, std::string& error)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        std::string setting = text.substr(start, end - start);
+        start = end + 1;
+
+        size_t equals = setting.find('=');
+        if (equals == std::string::npos)
+        {
+            error = "expected name=value in display model setting " + setting;
+            return false;
+        }
+        std::string name = setting.substr(0, equals);
+        std::string value = setting.substr(equals + 1);
+        double values[3] = { 0.0, 0.0, 0.0 };
+        int nValues = 0;
+        bool bOk = true;
+
+        if (name == "eotf")
+        {
+            if (value == "gamma")
+            {
+                config.eotf[0] = DisplayModelConfig::EOTF_GAMMA;
+            }
+            else if (value == "bt1886")
+            {
+                config.eotf[0] = DisplayModelConfig::EOTF_BT1886;
+            }
+            else if (value == "srgb")
+            {
+                config.eotf[0] = DisplayModelConfig::EOTF_SRGB;
+            }
+            else if (value == "pq")
+            {
+                config.eotf[0] = DisplayModelConfig::EOTF_PQ;
+            }
+            else
+            {
+                bOk = false;
+            }
+            config.eotf[1] = config.eotf[0];
+            config.eotf[2] = config.eotf[0];
+        }
+        else if (!parseNumbers(value, values, nValues))
+        {
+            bOk = false;
+        }
+        else if (name == "gamma")
+        {
+            bOk = (nValues == 1 || nValues == 3);
+            for (int i = 0; i < 3 && bOk; i++)
+            {
+                config.gamma[i] = values[nValues == 3 ? i : 0];
+            }
+        }
+        else if (name == "abl")
+        {
+            bOk = (nValues == 3);
+            config.ablWindow = values[0];
+            config.ablThreshold = values[1];
+            config.ablMinGain = values[2];
+        }
+        else if (name == "warmup" || name == "noise" || name == "errors")
+        {
+            bOk = (nValues == 2);
+            double& first = (name == "warmup") ? config.warmUpDrop : (name == "noise") ? config.noiseRelative : config.offsetErrorMax;
+            double& second = (name == "warmup") ? config.warmUpMs : (name == "noise") ? config.noiseAbsolute : config.gainErrorMax;
+            first = values[0];
+            second = values[1];
+        }
+        else
+        {
+            bOk = (nValues == 1);
+            if (name == "white")
+            {
+                config.whiteY = values[0];
+            }
+            else if (name == "black")
+            {
+                config.blackY = values[0];
+            }
+            else if (name == "bits")
+            {
+                config.bits = (int)values[0];
+                bOk = bOk && (config.bits == 0 || config.bits == 8 || config.bits == 10);
+            }
+            else if (name == "latency")
+            {
+                config.latencyMs = values[0];
+            }
+            else if (name == "response")
+            {
+                config.responseMs = values[0];
+            }
+            else if (name == "read")
+            {
+                config.readMs = values[0];
+            }
+            else if (name == "spectrum")
+            {
+                config.bSpectrum = (values[0] != 0.0);
+            }
+            else if (name == "seed")
+            {
+                config.seed = (unsigned int)values[0];
+            }
+            else
+            {
+                error = "unknown display model setting " + name;
+                return false;
+            }
+        }
+
+        if (!bOk)
+        {
+            error = "bad value in display model setting " + setting;
+            return false;
+        }
+    }
+    return true;
+}
+
+CDisplayModel::CDisplayModel(const DisplayModelConfig& config) :
+    m_config(config)
+{
+    // scale the primaries so that together they make the white
+    double primaries[3][3];
+    double XYZ[3];
+    xyToXYZ(config.red, XYZ);
+    for (int i = 0; i < 3; i++)
+    {
+        primaries[i][0] = XYZ[i];
+    }
+    xyToXYZ(config.green, XYZ);
+    for (int i = 0; i < 3; i++)
+    {
+        primaries[i][1] = XYZ[i];
+    }
+    xyToXYZ(config.blue, XYZ);
+    for (int i = 0; i < 3; i++)
+    {
+        primaries[i][2] = XYZ[i];
+    }
+    xyToXYZ(config.white, m_whiteXYZ);
+
+    double det = determinant(primaries);
+    for (int j = 0; j < 3; j++)
+    {
+        double replaced[3][3];
+        memcpy(replaced, primaries, sizeof(replaced));
+        for (int i = 0; i < 3; i++)
+        {
+            replaced[i][j] = m_whiteXYZ[i];
+        }
+        double scale = determinant(replaced) / det;
+        for (int i = 0; i < 3; i++)
+        {
+            m_matrix[i][j] = primaries[i][j] * scale;
+        }
+    }
+
+    // responses tabled for every video level from black to white
+    m_nLevels = (config.bits == 10) ? 876 : (config.bits == 8) ? 219 : 0;
+    for (int channel = 0; channel < 3; channel++)
+    {
+        m_levels[channel].resize(m_nLevels > 0 ? m_nLevels + 1 : 0);
+        for (int i = 0; i <= m_nLevels && m_nLevels > 0; i++)
+        {
+            m_levels[channel][i] = eotf(config.eotf[channel], config.gamma[channel], config.whiteY, config.blackY, (double)i / m_nLevels);
+        }
+    }
+
+    m_settleMs = config.latencyMs + (config.responseMs > 0.0 ? -log(SETTLED) * config.responseMs : 0.0);
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        for (int band = 0; band < SPECTRUM_BANDS; band++)
+        {
+            double offset = (SPECTRUM_MIN + band * 10.0 - spectrumPeaks[channel]) / spectrumWidths[channel];
+            m_primarySpectra[channel][band] = m_matrix[1][channel] * exp(-0.5 * offset * offset);
+        }
+    }
+
+    Reset();
+}
+
+void CDisplayModel::Reset()
+{
+    m_clockMs = 0.0;
+    m_changeMs = -1e30;
+    for (int i = 0; i < 3; i++)
+    {
+        m_fromWeights[i] = m_config.blackY;
+        m_toWeights[i] = m_config.blackY;
+    }
+    memset(m_lastSpectrum, 0, sizeof(m_lastSpectrum));
+
+    unsigned int seed = m_config.seed;
+    for (int i = 0; i < 4; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        m_state[i] = seed ^ (seed >> 16);
+    }
+    if ((m_state[0] | m_state[1] | m_state[2] | m_state[3]) == 0)
+    {
+        m_state[0] = 1;
+    }
+    m_bHasGaussian = false;
+    m_nextGaussian = 0.0;
+}
+
+unsigned int CDisplayModel::random()
+{
+    // xorshift128, the state is the model's own so that readings
+    // don't depend on anything else using rand()
+    unsigned int t = m_state[0] ^ (m_state[0] << 11);
+    m_state[0] = m_state[1];
+    m_state[1] = m_state[2];
+    m_state[2] = m_state[3];
+    m_state[3] = m_state[3] ^ (m_state[3] >> 19) ^ t ^ (t >> 8);
+    return m_state[3];
+}
+
+double CDisplayModel::uniform()
+{
+    return (random() >> 8) * (1.0 / 16777216.0);
+}
+
+double CDisplayModel::gaussian()
+{
+    if (m_bHasGaussian)
+    {
+        m_bHasGaussian = false;
+        return m_nextGaussian;
+    }
+    double radius = sqrt(-2.0 * log(1.0 - uniform()));
+    double angle = 2.0 * PI * uniform();
+    m_nextGaussian = radius * sin(angle);
+    m_bHasGaussian = true;
+    return radius * cos(angle);
+}
+
+double CDisplayModel::linear(int channel, double percent)
+{
+    double value = percent;
+    if (m_nLevels > 0)
+    {
+        int level = (int)floor(percent / 100.0 * m_nLevels + 0.5);
+        if (level < 0)
+        {
+            level = 0;
+        }
+        else if (level > m_nLevels)
+        {
+            level = m_nLevels;
+        }
+        if (m_config.offsetErrorMax <= 0.0 && m_config.gainErrorMax <= 0.0)
+        {
+            return m_levels[channel][level];
+        }
+        value = level * 100.0 / m_nLevels;
+    }
+
+    if (m_config.offsetErrorMax > 0.0)
+    {
+        value += m_config.offsetErrorMax * (2.0 * uniform() - 1.0);
+    }
+    if (m_config.gainErrorMax > 0.0)
+    {
+        value *= 1.0 + m_config.gainErrorMax * (2.0 * uniform() - 1.0);
+    }
+    if (value < 0.0)
+    {
+        value = 0.0;
+    }
+    else if (value > 100.0)
+    {
+        value = 100.0;
+    }
+    return eotf(m_config.eotf[channel], m_config.gamma[channel], m_config.whiteY, m_config.blackY, value / 100.0);
+}
+
+void CDisplayModel::Show(const double rgb[3])
+{
+    double current[3];
+    lightAt(m_clockMs, current);
+
+    double weights[3];
+    for (int i = 0; i < 3; i++)
+    {
+        weights[i] = linear(i, rgb[i]);
+    }
+
+    double gain = m_config.whiteY - m_config.blackY;
+    if (m_config.ablThreshold < 1.0)
+    {
+        double Y = m_matrix[1][0] * weights[0] + m_matrix[1][1] * weights[1] + m_matrix[1][2] * weights[2];
+        double level = m_config.ablWindow * Y;
+        if (level > m_config.ablThreshold)
+        {
+            gain *= 1.0 - (1.0 - m_config.ablMinGain) * (level - m_config.ablThreshold) / (1.0 - m_config.ablThreshold);
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        m_fromWeights[i] = current[i];
+        m_toWeights[i] = weights[i] * gain + m_config.blackY;
+    }
+    m_changeMs = m_clockMs;
+}
+
+void CDisplayModel::lightAt(double timeMs, double weights[3]) const
+{
+    double elapsed = timeMs - m_changeMs - m_config.latencyMs;
+    double remaining;
+    if (elapsed < 0.0)
+    {
+        remaining = 1.0;
+    }
+    else if (m_config.responseMs <= 0.0)
+    {
+        remaining = 0.0;
+    }
+    else
+    {
+        remaining = exp(-elapsed / m_config.responseMs);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        weights[i] = m_toWeights[i] + (m_fromWeights[i] - m_toWeights[i]) * remaining;
+    }
+}
+
+void CDisplayModel::Read(double XYZ[3], double* pSpectrum)
+{
+    double weights[3];
+    lightAt(m_clockMs, weights);
+
+    double scale = 1.0;
+    if (m_config.warmUpDrop > 0.0)
+    {
+        scale -= m_config.warmUpDrop * exp(-m_clockMs / m_config.warmUpMs);
+    }
+    if (m_config.noiseRelative > 0.0)
+    {
+        scale *= 1.0 + m_config.noiseRelative * gaussian();
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        weights[i] *= scale;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        XYZ[i] = m_matrix[i][0] * weights[0] + m_matrix[i][1] * weights[1] + m_matrix[i][2] * weights[2];
+    }
+    if (m_config.noiseAbsolute > 0.0)
+    {
+        double noise = m_config.noiseAbsolute * gaussian();
+        for (int i = 0; i < 3; i++)
+        {
+            XYZ[i] += m_whiteXYZ[i] * noise;
+        }
+    }
+
+    if (m_config.bSpectrum || pSpectrum)
+    {
+        for (int band = 0; band < SPECTRUM_BANDS; band++)
+        {
+            m_lastSpectrum[band] = m_primarySpectra[0][band] * weights[0]
+                                 + m_primarySpectra[1][band] * weights[1]
+                                 + m_primarySpectra[2][band] * weights[2];
+        }
+        if (pSpectrum)
+        {
+            memcpy(pSpectrum, m_lastSpectrum, sizeof(m_lastSpectrum));
+        }
+    }
+
+    m_clockMs += m_config.readMs;
+}
+
+void CDisplayModel::Measure(const double rgb[3], double XYZ[3], double* pSpectrum)
+{
+    Show(rgb);
+    m_clockMs += m_settleMs;
+    Read(XYZ, pSpectrum);
+}
+
+ColorXYZ CDisplayModel::Measure(const ColorRGBDisplay& rgb)
+{
+    double values[3] = { rgb[0], rgb[1], rgb[2] };
+    double XYZ[3];
+    Measure(values, XYZ);
+    return ColorXYZ(XYZ[0], XYZ[1], XYZ[2]);
+}
+
+CSpectrum CDisplayModel::GetLastSpectrum() const
+{
+    double values[SPECTRUM_BANDS];
+    memcpy(values, m_lastSpectrum, sizeof(values));
+    return CSpectrum(SPECTRUM_BANDS, SPECTRUM_MIN, SPECTRUM_MAX, 10.0, values);
+}
@@ -0,0 +1,151 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(DISPLAY_MODEL_H_INCLUDED_)
+#define DISPLAY_MODEL_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "Color.h"
+#include <string>
+#include <vector>
+
+// What the simulated display does, see CDisplayModel
+struct DisplayModelConfig
+{
+    enum Eotf
+    {
+        EOTF_GAMMA,     // power law
+        EOTF_BT1886,    // BT.1886 with the black level
+        EOTF_SRGB,
+        EOTF_PQ         // SMPTE ST 2084, clipped at the white level
+    };
+
+    DisplayModelConfig();
+
+    // Primaries and white of a colour reference
+    void SetPrimaries(const CColorReference& colorReference);
+
+    double red[2];              // xy chromaticities
+    double green[2];
+    double blue[2];
+    double white[2];
+    Eotf eotf[3];               // per channel, red, green and blue
+    double gamma[3];            // EOTF_GAMMA and EOTF_BT1886 exponents
+    double whiteY;              // cd/m2
+    double blackY;
+    int bits;                   // video quantization, 8, 10 or 0 for none
+
+    // Automatic brightness limiting: the light drops once the average
+    // picture level, the patch window times its luminance, goes above
+    // the threshold, down to minGain for a full white screen
+    double ablWindow;           // fraction of the screen the patch covers
+    double ablThreshold;        // 1 for no limiting
+    double ablMinGain;
+
+    // The light is warmUpDrop short at power on and recovers with a
+    // warmUpMs time constant
+    double warmUpDrop;
+    double warmUpMs;
+
+    // Reading noise standard deviations, relative to the light and in
+    // cd/m2
+    double noiseRelative;
+    double noiseAbsolute;
+
+    // Drive errors of the application's simulated sensor, uniform in
+    // +/- offsetErrorMax percent and +/- gainErrorMax
+    double offsetErrorMax;
+    double gainErrorMax;
+
+    double latencyMs;           // before a new patch starts to show
+    double responseMs;          // first order rise and fall time constant
+    double readMs;              // simulated time a reading takes
+
+    bool bSpectrum;             // compute spectra along the readings
+    unsigned int seed;
+};
+
+// Read the model settings from a comma separated list of name=value
+// pairs, values of several numbers are separated by colons:
+//   eotf=gamma|bt1886|srgb|pq  gamma=G or R:G:B  white=Y  black=Y
+//   bits=8|10|0  abl=window:threshold:minGain  warmup=drop:ms
+//   noise=relative:absolute  errors=offset:gain  latency=ms
+//   response=ms  read=ms  spectrum=0|1  seed=N
+bool ParseDisplayModelConfig(const std::string& text, DisplayModelConfig& config, std::string& error);
+
+// A display and a perfect instrument looking at it, on a simulated
+// clock. Everything random comes from a generator seeded by the
+// configuration so that the same calls give the same readings.
+//
+// Readings work on plain arrays and the response curves are tabled
+// for the quantized video levels, so that throughput runs get
+// millions of readings per second.
+class CDisplayModel
+{
+public:
+    // 380 to 730 nm in 10 nm steps
+    enum { SPECTRUM_BANDS = 36, SPECTRUM_MIN = 380, SPECTRUM_MAX = 730 };
+
+    explicit CDisplayModel(const DisplayModelConfig& config);
+
+    const DisplayModelConfig& GetConfig() const { return m_config; }
+    // Back to power on, with the seed of the configuration
+    void Reset();
+
+    // Start showing a patch, video levels in percent
+    void Show(const double rgb[3]);
+    void Wait(double ms) { m_clockMs += ms; }
+    // Light of the screen now, advancing the clock by the reading time.
+    // The spectrum, when enabled, is in relative units with the shape
+    // of the mixed primaries.
+    void Read(double XYZ[3], double* pSpectrum = NULL);
+    // Show, wait for the latency and the response, and read
+    void Measure(const double rgb[3], double XYZ[3], double* pSpectrum = NULL);
+
+    double GetClockMs() const { return m_clockMs; }
+
+    // The same with the library's colour types
+    ColorXYZ Measure(const ColorRGBDisplay& rgb);
+    CSpectrum GetLastSpectrum() const;
+
+private:
+    double linear(int channel, double percent);
+    void lightAt(double timeMs, double weights[3]) const;
+    unsigned int random();
+    double uniform();
+    double gaussian();
+
+    DisplayModelConfig m_config;
+    double m_matrix[3][3];          // cd/m2 of each channel to XYZ
+    double m_whiteXYZ[3];           // of 1 cd/m2
+    std::vector<double> m_levels[3];  // light of each video level, 0 to 1
+    int m_nLevels;
+    double m_settleMs;
+    double m_primarySpectra[3][SPECTRUM_BANDS];
+
+    double m_clockMs;
+    double m_changeMs;
+    // light of each channel in cd/m2 of white, black level included,
+    // before and after the last change
+    double m_fromWeights[3];
+    double m_toWeights[3];
+    double m_lastSpectrum[SPECTRUM_BANDS];
+    unsigned int m_state[4];
+    bool m_bHasGaussian;
+    double m_nextGaussian;
+};
+
+#endif // !defined(DISPLAY_MODEL_H_INCLUDED_)
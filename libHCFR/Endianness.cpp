@@ -19,6 +19,7 @@
 
 #include "Endianness.h"
 #include <algorithm> //required for std::swap
+#include <string.h>
 
 #if defined(__BIG_ENDIAN__)
 void swapBytes(char * b, int n)
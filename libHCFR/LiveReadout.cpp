@@ -0,0 +1,162 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "LiveReadout.h"
+#include <math.h>
+
+namespace
+{
+    // weight of each reading in the noise scale
+    const double NOISE_LEARNING = 0.05;
+    const double MIN_NOISE_SCALE = 0.01;
+    const double MAX_NOISE_SCALE = 1e6;
+}
+
+LiveReadoutConfig::LiveReadoutConfig() :
+    noiseRelative(0.005),
+    noiseAbsolute(0.002),
+    driftRelative(0.001),
+    stepSigmas(4.0),
+    stepCount(2),
+    bandSigmas(2.0),
+    stableRelative(0.01)
+{
+}
+
+CLiveReadoutFilter::CLiveReadoutFilter(const LiveReadoutConfig& config) :
+    m_config(config),
+    m_noiseScale(1.0)
+{
+    if (m_config.stepCount < 1)
+    {
+        m_config.stepCount = 1;
+    }
+    Reset();
+}
+
+void CLiveReadoutFilter::Reset()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_readout.XYZ[i] = 0.0;
+        m_readout.band[i] = 0.0;
+        m_variance[i] = 0.0;
+    }
+    m_readout.count = 0;
+    m_readout.bStep = false;
+    m_readout.bStable = false;
+    m_nOutliers = 0;
+}
+
+double CLiveReadoutFilter::noiseVariance(double value) const
+{
+    double relative = m_config.noiseRelative * value;
+    return (relative * relative + m_config.noiseAbsolute * m_config.noiseAbsolute) * m_noiseScale;
+}
+
+void CLiveReadoutFilter::restart(const double XYZ[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_readout.XYZ[i] = XYZ[i];
+        m_variance[i] = noiseVariance(XYZ[i]);
+    }
+    m_readout.count = 1;
+    m_readout.bStep = true;
+    m_nOutliers = 0;
+    updateReadout();
+}
+
+void CLiveReadoutFilter::updateReadout()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_readout.band[i] = m_config.bandSigmas * sqrt(m_variance[i]);
+    }
+    m_readout.bStable = m_readout.count >= 2 &&
+        m_readout.band[1] <= m_config.stableRelative * fabs(m_readout.XYZ[1]) + m_config.noiseAbsolute;
+}
+
+const LiveReadout& CLiveReadoutFilter::Add(const double XYZ[3])
+{
+    if (m_readout.count == 0)
+    {
+        restart(XYZ);
+        return m_readout;
+    }
+
+    double predicted[3];
+    double noise[3];
+    double worstRatio = 0.0;
+    double meanRatio = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        double drift = m_config.driftRelative * m_readout.XYZ[i];
+        double innovation = XYZ[i] - m_readout.XYZ[i];
+        predicted[i] = m_variance[i] + drift * drift;
+        noise[i] = noiseVariance(m_readout.XYZ[i]);
+        double ratio = innovation * innovation / (predicted[i] + noise[i]);
+        if (ratio > worstRatio)
+        {
+            worstRatio = ratio;
+        }
+        meanRatio += ratio / 3.0;
+    }
+
+    m_readout.bStep = false;
+    if (worstRatio > m_config.stepSigmas * m_config.stepSigmas)
+    {
+        if (++m_nOutliers < m_config.stepCount)
+        {
+            return m_readout;
+        }
+        if (m_readout.count <= 1)
+        {
+            // nothing agreed with the last step either, the noise is
+            // larger than we thought
+            m_noiseScale *= 4.0;
+            if (m_noiseScale > MAX_NOISE_SCALE)
+            {
+                m_noiseScale = MAX_NOISE_SCALE;
+            }
+        }
+        restart(XYZ);
+        return m_readout;
+    }
+    m_nOutliers = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        double gain = predicted[i] / (predicted[i] + noise[i]);
+        m_readout.XYZ[i] += gain * (XYZ[i] - m_readout.XYZ[i]);
+        m_variance[i] = (1.0 - gain) * predicted[i];
+    }
+    m_readout.count++;
+
+    // the ratios average one when the noise is what we assume
+    m_noiseScale *= 1.0 + NOISE_LEARNING * (meanRatio - 1.0);
+    if (m_noiseScale < MIN_NOISE_SCALE)
+    {
+        m_noiseScale = MIN_NOISE_SCALE;
+    }
+    else if (m_noiseScale > MAX_NOISE_SCALE)
+    {
+        m_noiseScale = MAX_NOISE_SCALE;
+    }
+
+    updateReadout();
+    return m_readout;
+}
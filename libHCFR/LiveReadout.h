@@ -0,0 +1,98 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(LIVE_READOUT_H_INCLUDED_)
+#define LIVE_READOUT_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+
+// How CLiveReadoutFilter weighs the readings
+struct LiveReadoutConfig
+{
+    LiveReadoutConfig();
+
+    // Reading noise standard deviations, relative to the light and in
+    // cd/m2. These are a starting point, the filter follows the noise
+    // it actually sees.
+    double noiseRelative;
+    double noiseAbsolute;
+    // How far the light may wander between two readings while nobody
+    // touches the display, relative to the light
+    double driftRelative;
+    // A reading further than this many standard deviations from the
+    // estimate is an outlier, stepCount outliers in a row a control change
+    double stepSigmas;
+    int stepCount;
+    // Half width of the band in standard deviations, 2 for about 95%
+    double bandSigmas;
+    // The readout is stable once the band of Y is within this fraction
+    // of Y, plus the absolute noise
+    double stableRelative;
+};
+
+// The filtered light after a reading
+struct LiveReadout
+{
+    double XYZ[3];
+    double band[3];     // half width of the confidence band of each value
+    int count;          // readings since the last step
+    bool bStep;         // the last reading started a new level
+    bool bStable;
+};
+
+// Turns a stream of short, noisy readings of the same patch into a
+// steady value with a confidence band, for watching a display while its
+// controls are being adjusted.
+//
+// Each of X, Y and Z goes through a scalar Kalman filter for a value that
+// only drifts. The measurement noise is scaled by how large the
+// differences between readings and estimates turn out to be, so the band
+// stays honest whatever the instrument. A single wild reading is ignored;
+// when stepCount readings in a row disagree with the estimate the
+// filter starts again from the last one, so that a change of the display
+// shows after stepCount readings rather than after the filter has
+// slowly caught up.
+class CLiveReadoutFilter
+{
+public:
+    explicit CLiveReadoutFilter(const LiveReadoutConfig& config = LiveReadoutConfig());
+
+    const LiveReadoutConfig& GetConfig() const { return m_config; }
+
+    // Forget the readings, for a new patch. What was learnt of the
+    // instrument noise is kept.
+    void Reset();
+
+    const LiveReadout& Add(const double XYZ[3]);
+    // Nothing is meaningful before the first reading
+    const LiveReadout& GetReadout() const { return m_readout; }
+
+    // Seen noise over configured noise, in variance
+    double GetNoiseScale() const { return m_noiseScale; }
+
+private:
+    double noiseVariance(double value) const;
+    void restart(const double XYZ[3]);
+    void updateReadout();
+
+    LiveReadoutConfig m_config;
+    LiveReadout m_readout;
+    double m_variance[3];           // of the estimates
+    double m_noiseScale;
+    int m_nOutliers;
+};
+
+#endif // !defined(LIVE_READOUT_H_INCLUDED_)
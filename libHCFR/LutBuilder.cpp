@@ -0,0 +1,503 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "LutBuilder.h"
+#include "ParallelJob.h"
+#include "TraceLog.h"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace
+{
+    // the local fits are linear in roughly linear light, where a
+    // display is closest to additive
+    const double LINEARISE_GAMMA = 2.2;
+    const int MAX_NEWTON_STEPS = 20;
+    const double MAX_NEWTON_STEP = 0.25;
+    const double JACOBIAN_DELTA = 1.0 / 1024.0;
+
+    double clamp01(double x)
+    {
+        return x < 0.0 ? 0.0 : (x > 1.0 ? 1.0 : x);
+    }
+
+    // Gaussian elimination with partial pivoting of A x = B, A is n x n
+    // and B n x nRhs, both row major. The solution replaces B.
+    bool solve(double* A, double* B, int n, int nRhs)
+    {
+        for (int col = 0; col < n; col++)
+        {
+            int pivot = col;
+            for (int row = col + 1; row < n; row++)
+            {
+                if (fabs(A[row * n + col]) > fabs(A[pivot * n + col]))
+                {
+                    pivot = row;
+                }
+            }
+            if (fabs(A[pivot * n + col]) < 1e-15)
+            {
+                return false;
+            }
+            if (pivot != col)
+            {
+                for (int k = 0; k < n; k++)
+                {
+                    std::swap(A[pivot * n + k], A[col * n + k]);
+                }
+                for (int k = 0; k < nRhs; k++)
+                {
+                    std::swap(B[pivot * nRhs + k], B[col * nRhs + k]);
+                }
+            }
+            for (int row = col + 1; row < n; row++)
+            {
+                double factor = A[row * n + col] / A[col * n + col];
+                for (int k = col; k < n; k++)
+                {
+                    A[row * n + k] -= factor * A[col * n + k];
+                }
+                for (int k = 0; k < nRhs; k++)
+                {
+                    B[row * nRhs + k] -= factor * B[col * nRhs + k];
+                }
+            }
+        }
+        for (int row = n - 1; row >= 0; row--)
+        {
+            for (int k = 0; k < nRhs; k++)
+            {
+                double sum = B[row * nRhs + k];
+                for (int j = row + 1; j < n; j++)
+                {
+                    sum -= A[row * n + j] * B[j * nRhs + k];
+                }
+                B[row * nRhs + k] = sum / A[row * n + row];
+            }
+        }
+        return true;
+    }
+
+    // Trilinear interpolation in a grid of nSize^3 triplets, red
+    // slowest, of a 0 to 1 point
+    template <class T>
+    void interpolate(const T* grid, int nSize, const double* rgb, double* value)
+    {
+        int index[3];
+        double fraction[3];
+        for (int c = 0; c < 3; c++)
+        {
+            double x = clamp01(rgb[c]) * (nSize - 1);
+            index[c] = std::min((int)x, nSize - 2);
+            fraction[c] = x - index[c];
+        }
+
+        value[0] = value[1] = value[2] = 0.0;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            int dr = (corner >> 2) & 1;
+            int dg = (corner >> 1) & 1;
+            int db = corner & 1;
+            double weight = (dr ? fraction[0] : 1.0 - fraction[0])
+                          * (dg ? fraction[1] : 1.0 - fraction[1])
+                          * (db ? fraction[2] : 1.0 - fraction[2]);
+            const T* node = grid + 3 * (((index[0] + dr) * nSize + index[1] + dg) * nSize + index[2] + db);
+            value[0] += weight * node[0];
+            value[1] += weight * node[1];
+            value[2] += weight * node[2];
+        }
+    }
+
+    // One item per red and green row of the grid being computed
+    class CLutFitJob : public CParallelJob
+    {
+    public:
+        CLutFitJob(C3DLutBuilder& builder) : m_builder(builder) {}
+        virtual void Run(int nItem) { m_builder.FitRow(nItem); }
+    private:
+        CLutFitJob& operator=(const CLutFitJob&);
+        C3DLutBuilder& m_builder;
+    };
+
+    class CLutInvertJob : public CParallelJob
+    {
+    public:
+        CLutInvertJob(C3DLutBuilder& builder) : m_builder(builder) {}
+        virtual void Run(int nItem) { m_builder.InvertRow(nItem); }
+    private:
+        CLutInvertJob& operator=(const CLutInvertJob&);
+        C3DLutBuilder& m_builder;
+    };
+}
+
+C3DLutBuilder::C3DLutBuilder() :
+    m_colorReference(HDTV),
+    m_gamma(2.4),
+    m_nThreads(0),
+    m_bandwidth2(0.0),
+    m_targetWhiteY(0.0),
+    m_tolerance2(0.0),
+    m_nSize(0),
+    m_fitMs(0.0),
+    m_invertMs(0.0)
+{
+    m_black[0] = m_black[1] = m_black[2] = 0.0;
+    for (int i = 0; i < 9; i++)
+    {
+        m_targetMatrix[i] = 0.0;
+    }
+}
+
+void C3DLutBuilder::SetMeasurements(const std::vector<ColorRGBDisplay>& rgb, const std::vector<ColorXYZ>& XYZ)
+{
+    size_t nSamples = std::min(rgb.size(), XYZ.size());
+    m_samplesRGB.resize(nSamples * 3);
+    m_samplesLinear.resize(nSamples * 3);
+    m_samplesXYZ.resize(nSamples * 3);
+    for (size_t i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            double level = clamp01(rgb[i][c] / 100.0);
+            m_samplesRGB[i * 3 + c] = level;
+            m_samplesLinear[i * 3 + c] = pow(level, LINEARISE_GAMMA);
+            m_samplesXYZ[i * 3 + c] = XYZ[i][c];
+        }
+    }
+}
+
+void C3DLutBuilder::SetTarget(const CColorReference& colorReference, double gamma)
+{
+    m_colorReference = colorReference;
+    m_gamma = gamma;
+}
+
+bool C3DLutBuilder::Build(int nSize)
+{
+    HCFR_TRACE_FUNCTION("lut");
+    m_lastError.clear();
+    m_fitMs = m_invertMs = 0.0;
+
+    if (nSize < MIN_SIZE || nSize > MAX_SIZE)
+    {
+        char message[128];
+        sprintf(message, "LUT size %d is not between %d and %d", nSize, MIN_SIZE, MAX_SIZE);
+        m_lastError = message;
+        return false;
+    }
+    size_t nSamples = m_samplesRGB.size() / 3;
+    if (nSamples < 8)
+    {
+        m_lastError = "at least 8 patches are needed to fit a LUT";
+        return false;
+    }
+
+    // the fit follows the patches closely where they are dense, and
+    // blends its neighbours where they are sparse
+    double spacing = 1.0 / std::max(1.0, pow((double)nSamples, 1.0 / 3.0) - 1.0);
+    m_bandwidth2 = 0.25 * spacing * spacing;
+
+    double start = CTraceLog::GetClockUs();
+    {
+        HCFR_TRACE_SPAN("fit", "lut");
+        m_forwardGrid.assign(FIT_GRID_SIZE * FIT_GRID_SIZE * FIT_GRID_SIZE * 3, 0.0);
+        CLutFitJob job(*this);
+        RunParallelJob(job, FIT_GRID_SIZE * FIT_GRID_SIZE, m_nThreads);
+    }
+    m_fitMs = (CTraceLog::GetClockUs() - start) / 1000.0;
+
+    if (!computeTargetWhite())
+    {
+        return false;
+    }
+
+    start = CTraceLog::GetClockUs();
+    {
+        HCFR_TRACE_SPAN("invert", "lut");
+        m_nSize = nSize;
+        m_lut.assign(nSize * nSize * nSize * 3, 0.0f);
+        CLutInvertJob job(*this);
+        RunParallelJob(job, nSize * nSize, m_nThreads);
+    }
+    m_invertMs = (CTraceLog::GetClockUs() - start) / 1000.0;
+    return true;
+}
+
+void C3DLutBuilder::FitRow(int nRow)
+{
+    const int n = FIT_GRID_SIZE;
+    const size_t nSamples = m_samplesRGB.size() / 3;
+    double node[3] = { (nRow / n) / (n - 1.0), (nRow % n) / (n - 1.0), 0.0 };
+
+    for (int b = 0; b < n; b++)
+    {
+        node[2] = b / (n - 1.0);
+        double linear[3];
+        for (int c = 0; c < 3; c++)
+        {
+            linear[c] = pow(node[c], LINEARISE_GAMMA);
+        }
+
+        // weighted least squares of XYZ = a + B (linear - node linear),
+        // a is the node value
+        double A[16] = { 0.0 };
+        double B[12] = { 0.0 };
+        for (size_t i = 0; i < nSamples; i++)
+        {
+            const double* rgb = &m_samplesRGB[i * 3];
+            const double* sample = &m_samplesLinear[i * 3];
+            const double* XYZ = &m_samplesXYZ[i * 3];
+            double d2 = (rgb[0] - node[0]) * (rgb[0] - node[0])
+                      + (rgb[1] - node[1]) * (rgb[1] - node[1])
+                      + (rgb[2] - node[2]) * (rgb[2] - node[2]);
+            double w = 1.0 / ((d2 + m_bandwidth2) * (d2 + m_bandwidth2));
+            double x[4] = { 1.0, sample[0] - linear[0], sample[1] - linear[1], sample[2] - linear[2] };
+            for (int k = 0; k < 4; k++)
+            {
+                double wx = w * x[k];
+                for (int l = k; l < 4; l++)
+                {
+                    A[k * 4 + l] += wx * x[l];
+                }
+                B[k * 3 + 0] += wx * XYZ[0];
+                B[k * 3 + 1] += wx * XYZ[1];
+                B[k * 3 + 2] += wx * XYZ[2];
+            }
+        }
+        for (int k = 1; k < 4; k++)
+        {
+            for (int l = 0; l < k; l++)
+            {
+                A[k * 4 + l] = A[l * 4 + k];
+            }
+        }
+        // a little damping of the slopes keeps grayscale only or
+        // clustered patch sets solvable
+        double damping = A[0] * 1e-6;
+        A[5] += damping;
+        A[10] += damping;
+        A[15] += damping;
+
+        double* value = &m_forwardGrid[3 * (nRow * n + b)];
+        if (solve(A, B, 4, 3))
+        {
+            value[0] = B[0];
+            value[1] = B[1];
+            value[2] = B[2];
+        }
+    }
+}
+
+void C3DLutBuilder::InvertRow(int nRow)
+{
+    const int n = m_nSize;
+    double input[3] = { (nRow / n) / (n - 1.0), (nRow % n) / (n - 1.0), 0.0 };
+
+    for (int b = 0; b < n; b++)
+    {
+        input[2] = b / (n - 1.0);
+        double goal[3];
+        target(input, goal);
+
+        double x[3] = { input[0], input[1], input[2] };
+        double best[3] = { x[0], x[1], x[2] };
+        double bestError2 = -1.0;
+        for (int step = 0; step < MAX_NEWTON_STEPS; step++)
+        {
+            double F[3];
+            forward(x, F);
+            double e[3] = { goal[0] - F[0], goal[1] - F[1], goal[2] - F[2] };
+            double error2 = e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+            if (bestError2 < 0.0 || error2 < bestError2)
+            {
+                bestError2 = error2;
+                best[0] = x[0];
+                best[1] = x[1];
+                best[2] = x[2];
+            }
+            if (error2 < m_tolerance2)
+            {
+                break;
+            }
+
+            // central differences, one sided at the cube faces
+            double J[9];
+            for (int k = 0; k < 3; k++)
+            {
+                double high[3] = { x[0], x[1], x[2] };
+                double low[3] = { x[0], x[1], x[2] };
+                high[k] = std::min(1.0, x[k] + JACOBIAN_DELTA);
+                low[k] = std::max(0.0, x[k] - JACOBIAN_DELTA);
+                double Fhigh[3], Flow[3];
+                forward(high, Fhigh);
+                forward(low, Flow);
+                for (int c = 0; c < 3; c++)
+                {
+                    J[c * 3 + k] = (Fhigh[c] - Flow[c]) / (high[k] - low[k]);
+                }
+            }
+            if (!solve(J, e, 3, 1))
+            {
+                break;
+            }
+            double largest = std::max(fabs(e[0]), std::max(fabs(e[1]), fabs(e[2])));
+            double scale = largest > MAX_NEWTON_STEP ? MAX_NEWTON_STEP / largest : 1.0;
+            for (int c = 0; c < 3; c++)
+            {
+                x[c] = clamp01(x[c] + e[c] * scale);
+            }
+        }
+
+        float* value = &m_lut[3 * ((b * n + nRow % n) * n + nRow / n)];
+        value[0] = (float)best[0];
+        value[1] = (float)best[1];
+        value[2] = (float)best[2];
+    }
+}
+
+void C3DLutBuilder::forward(const double* rgb, double* XYZ) const
+{
+    interpolate(&m_forwardGrid[0], FIT_GRID_SIZE, rgb, XYZ);
+}
+
+void C3DLutBuilder::target(const double* rgb, double* XYZ) const
+{
+    double linear[3];
+    for (int c = 0; c < 3; c++)
+    {
+        linear[c] = pow(clamp01(rgb[c]), m_gamma);
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        XYZ[c] = m_black[c] + m_targetMatrix[c * 3 + 0] * linear[0]
+                            + m_targetMatrix[c * 3 + 1] * linear[1]
+                            + m_targetMatrix[c * 3 + 2] * linear[2];
+    }
+}
+
+bool C3DLutBuilder::computeTargetWhite()
+{
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    forward(origin, m_black);
+
+    // how much of each display primary makes the reference white,
+    // the brightest white is where the first one runs out
+    double primaries[9];
+    for (int k = 0; k < 3; k++)
+    {
+        double full[3] = { k == 0 ? 1.0 : 0.0, k == 1 ? 1.0 : 0.0, k == 2 ? 1.0 : 0.0 };
+        double XYZ[3];
+        forward(full, XYZ);
+        for (int c = 0; c < 3; c++)
+        {
+            primaries[c * 3 + k] = XYZ[c] - m_black[c];
+        }
+    }
+    ColorXYZ white = m_colorReference.GetWhite();
+    double amounts[3] = { white[0] / white[1], 1.0, white[2] / white[1] };
+    if (!solve(primaries, amounts, 3, 1))
+    {
+        m_lastError = "the measured primaries are not independent";
+        return false;
+    }
+    double largest = std::max(amounts[0], std::max(amounts[1], amounts[2]));
+    if (largest <= 0.0)
+    {
+        m_lastError = "the display can't show the reference white";
+        return false;
+    }
+    m_targetWhiteY = 1.0 / largest;
+    m_tolerance2 = 1e-12 * m_targetWhiteY * m_targetWhiteY;
+
+    // reference RGB to XYZ with the white at the target luminance
+    for (int c = 0; c < 3; c++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            m_targetMatrix[c * 3 + k] = m_colorReference.RGBtoXYZMatrix(c, k) * m_targetWhiteY / white[1];
+        }
+    }
+    return true;
+}
+
+ColorRGBDisplay C3DLutBuilder::GetValue(int r, int g, int b) const
+{
+    const float* value = &m_lut[3 * ((b * m_nSize + g) * m_nSize + r)];
+    return ColorRGBDisplay(value[0] * 100.0, value[1] * 100.0, value[2] * 100.0);
+}
+
+ColorRGBDisplay C3DLutBuilder::Apply(const ColorRGBDisplay& rgb) const
+{
+    // the LUT is stored blue slowest, so interpolate on swapped axes
+    double swapped[3] = { rgb[2] / 100.0, rgb[1] / 100.0, rgb[0] / 100.0 };
+    double value[3];
+    interpolate(&m_lut[0], m_nSize, swapped, value);
+    return ColorRGBDisplay(value[0] * 100.0, value[1] * 100.0, value[2] * 100.0);
+}
+
+ColorXYZ C3DLutBuilder::GetFittedXYZ(const ColorRGBDisplay& rgb) const
+{
+    double level[3] = { rgb[0] / 100.0, rgb[1] / 100.0, rgb[2] / 100.0 };
+    double XYZ[3];
+    forward(level, XYZ);
+    return ColorXYZ(XYZ[0], XYZ[1], XYZ[2]);
+}
+
+ColorXYZ C3DLutBuilder::GetTargetXYZ(const ColorRGBDisplay& rgb) const
+{
+    double level[3] = { rgb[0] / 100.0, rgb[1] / 100.0, rgb[2] / 100.0 };
+    double XYZ[3];
+    target(level, XYZ);
+    return ColorXYZ(XYZ[0], XYZ[1], XYZ[2]);
+}
+
+void C3DLutBuilder::WriteCube(std::ostream& out, const std::string& title) const
+{
+    char line[128];
+    out << "TITLE \"" << title << "\"\n";
+    out << "LUT_3D_SIZE " << m_nSize << "\n";
+    out << "DOMAIN_MIN 0.0 0.0 0.0\n";
+    out << "DOMAIN_MAX 1.0 1.0 1.0\n";
+    for (size_t i = 0; i < m_lut.size(); i += 3)
+    {
+        sprintf(line, "%.6f %.6f %.6f\n", m_lut[i], m_lut[i + 1], m_lut[i + 2]);
+        out << line;
+    }
+}
+
+void C3DLutBuilder::WriteThreeDL(std::ostream& out) const
+{
+    char line[128];
+    for (int i = 0; i < m_nSize; i++)
+    {
+        out << (i ? " " : "") << (int)floor(i * 1023.0 / (m_nSize - 1) + 0.5);
+    }
+    out << "\n";
+    for (int r = 0; r < m_nSize; r++)
+    {
+        for (int g = 0; g < m_nSize; g++)
+        {
+            for (int b = 0; b < m_nSize; b++)
+            {
+                const float* value = &m_lut[3 * ((b * m_nSize + g) * m_nSize + r)];
+                sprintf(line, "%d %d %d\n", (int)floor(value[0] * 4095.0 + 0.5),
+                        (int)floor(value[1] * 4095.0 + 0.5), (int)floor(value[2] * 4095.0 + 0.5));
+                out << line;
+            }
+        }
+    }
+}
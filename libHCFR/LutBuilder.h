@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(LUT_BUILDER_H_INCLUDED_)
+#define LUT_BUILDER_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "Color.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Builds a 3D correction LUT from measured patches: the LUT maps the
+// video levels of the target, a colour reference with a power law
+// gamma, to the video levels that make the display show them.
+//
+// The display response is fitted on a 17 point forward grid from the
+// scattered patches, each node by a distance weighted local linear
+// fit of XYZ against linearised RGB, so any patch set that covers the
+// cube will do. Each LUT node is then found by inverting the forward
+// grid with Newton steps. Both stages are split over threads.
+// Targets the display can't reach are clipped to its gamut, and the
+// target white is scaled down to the brightest one the display can
+// show with the reference white point.
+class C3DLutBuilder
+{
+public:
+    enum { MIN_SIZE = 17, MAX_SIZE = 65, FIT_GRID_SIZE = 17 };
+
+    C3DLutBuilder();
+
+    // Patch video levels in percent, as ColorRGBDisplay, and their
+    // measures
+    void SetMeasurements(const std::vector<ColorRGBDisplay>& rgb, const std::vector<ColorXYZ>& XYZ);
+    void SetTarget(const CColorReference& colorReference, double gamma);
+    // 0 for one thread per processor
+    void SetThreads(int nThreads) { m_nThreads = nThreads; }
+
+    // Fit and invert for a LUT of nSize points per side, MIN_SIZE to
+    // MAX_SIZE
+    bool Build(int nSize);
+
+    int GetSize() const { return m_nSize; }
+    // Corrected video level of a LUT node, in percent
+    ColorRGBDisplay GetValue(int r, int g, int b) const;
+    // Trilinear interpolation of the LUT
+    ColorRGBDisplay Apply(const ColorRGBDisplay& rgb) const;
+    // Display response fitted from the patches, in measure units
+    ColorXYZ GetFittedXYZ(const ColorRGBDisplay& rgb) const;
+    // What the LUT aims at for a video level
+    ColorXYZ GetTargetXYZ(const ColorRGBDisplay& rgb) const;
+
+    // Resolve and IRIDAS .cube, red varying fastest, 0 to 1 values
+    void WriteCube(std::ostream& out, const std::string& title) const;
+    // Autodesk/Lustre .3dl, blue varying fastest, 10 bit input mesh
+    // and 12 bit values
+    void WriteThreeDL(std::ostream& out) const;
+
+    double GetFitMs() const { return m_fitMs; }
+    double GetInvertMs() const { return m_invertMs; }
+    const std::string& GetLastError() const { return m_lastError; }
+
+    // Work items of the two stages, one red and green row of the
+    // forward grid or of the LUT
+    void FitRow(int nRow);
+    void InvertRow(int nRow);
+
+private:
+    void forward(const double* rgb, double* XYZ) const;
+    void target(const double* rgb, double* XYZ) const;
+    bool computeTargetWhite();
+
+    std::vector<double> m_samplesRGB;
+    std::vector<double> m_samplesLinear;
+    std::vector<double> m_samplesXYZ;
+    CColorReference m_colorReference;
+    double m_gamma;
+    int m_nThreads;
+
+    double m_bandwidth2;
+    std::vector<double> m_forwardGrid;
+    double m_black[3];
+    double m_targetMatrix[9];
+    double m_targetWhiteY;
+    double m_tolerance2;
+
+    int m_nSize;
+    std::vector<float> m_lut;
+    double m_fitMs;
+    double m_invertMs;
+    std::string m_lastError;
+};
+
+#endif // !defined(LUT_BUILDER_H_INCLUDED_)
@@ -0,0 +1,439 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "LuxMeter.h"
+#include "LockWhileInScope.h"
+#include "TraceLog.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#if !defined(LIBHCFR_HAS_WIN32_API) && defined(LIBHCFR_HAS_PTHREADS)
+#   include <fcntl.h>
+#   include <termios.h>
+#   include <unistd.h>
+#endif
+
+bool DecodeLX1108Packet(const char* szPacket, LuxSample& sample, char& unit, char& scale)
+{
+    size_t n = strlen(szPacket);
+    if (n < 12 || strncmp(szPacket, "\002411", 4) != 0 ||
+        (szPacket[4] != '5' && szPacket[4] != '6') ||
+        (szPacket[5] != '0' && szPacket[5] != '1') ||
+        strchr("012378", szPacket[6]) == NULL ||
+        strncmp(szPacket + 7, "0000", 4) != 0 ||
+        szPacket[n - 1] != 0x0D)
+    {
+        return false;
+    }
+
+    bool bFtCd = (szPacket[4] == '6');
+    double dmul = 1.0;
+    sample.lux = 0.0;
+    sample.bLow = false;
+    sample.bHigh = false;
+    sample.bLowestScale = false;
+    sample.bHighestScale = false;
+
+    switch (szPacket[6])
+    {
+    case '0':
+        dmul = 1.0;
+        break;
+    case '1':
+        dmul = 0.1;
+        break;
+    case '2':
+        dmul = 0.01;
+        sample.bLowestScale = !bFtCd;
+        break;
+    case '3':
+        dmul = 0.001;
+        sample.bLowestScale = true;
+        break;
+    case '7':
+        dmul = 10.0;
+        break;
+    case '8':
+        dmul = 100.0;
+        sample.bHighestScale = true;
+        break;
+    }
+
+    if (szPacket[5] == '1')
+    {
+        dmul = -dmul;
+    }
+
+    if (isdigit((unsigned char)szPacket[11]))
+    {
+        sample.lux = (double)atoi(szPacket + 11) * dmul;
+        if (bFtCd)
+        {
+            sample.lux /= 0.0929;
+        }
+    }
+    else if (szPacket[11] == 0x18)
+    {
+        sample.bHigh = true;
+    }
+    else if (szPacket[11] == 0x19)
+    {
+        sample.bLow = true;
+    }
+
+    unit = szPacket[4];
+    scale = szPacket[6];
+    return true;
+}
+
+CLuxSampleBuffer::CLuxSampleBuffer() :
+    m_nFirst(0),
+    m_nCount(0)
+{
+}
+
+void CLuxSampleBuffer::Clear()
+{
+    CLockWhileInScope lock(m_section);
+    m_nFirst = 0;
+    m_nCount = 0;
+}
+
+void CLuxSampleBuffer::Add(const LuxSample& sample)
+{
+    CLockWhileInScope lock(m_section);
+    if (m_nCount < CAPACITY)
+    {
+        m_samples[(m_nFirst + m_nCount) % CAPACITY] = sample;
+        m_nCount++;
+    }
+    else
+    {
+        m_samples[m_nFirst] = sample;
+        m_nFirst = (m_nFirst + 1) % CAPACITY;
+    }
+}
+
+int CLuxSampleBuffer::GetCount()
+{
+    CLockWhileInScope lock(m_section);
+    return m_nCount;
+}
+
+bool CLuxSampleBuffer::GetLatest(LuxSample& sample)
+{
+    CLockWhileInScope lock(m_section);
+    if (m_nCount == 0)
+    {
+        return false;
+    }
+    sample = m_samples[(m_nFirst + m_nCount - 1) % CAPACITY];
+    return true;
+}
+
+CLuxSampleBuffer::MatchResult CLuxSampleBuffer::Match(double startMs, double endMs, double integrationMs, LuxSample& result)
+{
+    CLockWhileInScope lock(m_section);
+
+    // readings come in time order, skip those that began integrating
+    // before the window
+    int i = 0;
+    while (i < m_nCount && m_samples[(m_nFirst + i) % CAPACITY].timeMs - integrationMs < startMs)
+    {
+        i++;
+    }
+    if (i == m_nCount)
+    {
+        return MATCH_PENDING;
+    }
+
+    const LuxSample& first = m_samples[(m_nFirst + i) % CAPACITY];
+    result = first;
+    int nMatched = 0;
+    double sum = 0.0;
+    for (; i < m_nCount; i++)
+    {
+        const LuxSample& sample = m_samples[(m_nFirst + i) % CAPACITY];
+        if (sample.timeMs > endMs && nMatched > 0)
+        {
+            break;
+        }
+        if (sample.bLow || sample.bHigh)
+        {
+            result = sample;
+            return sample.bLow ? MATCH_UNDER_RANGE : MATCH_OVER_RANGE;
+        }
+        sum += sample.lux;
+        nMatched++;
+        result.timeMs = sample.timeMs;
+        if (sample.timeMs > endMs)
+        {
+            break;
+        }
+    }
+    result.lux = sum / nMatched;
+    return MATCH_OK;
+}
+
+namespace
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    DWORD WINAPI luxThreadFunc(LPVOID lpParam)
+    {
+        ((CLuxMeterReader*)lpParam)->Run();
+        return 0;
+    }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    void* luxThreadFunc(void* lpParam)
+    {
+        ((CLuxMeterReader*)lpParam)->Run();
+        return NULL;
+    }
+#endif
+}
+
+CLuxMeterReader::CLuxMeterReader(CLuxSampleBuffer& buffer) :
+    m_buffer(buffer),
+    m_callback(NULL),
+    m_pContext(NULL),
+    m_unit(0),
+    m_scale(0),
+    m_bStop(false),
+    m_bRunning(false)
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    m_hPort = INVALID_HANDLE_VALUE;
+    m_hThread = NULL;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    m_nPort = -1;
+#endif
+}
+
+CLuxMeterReader::~CLuxMeterReader()
+{
+    Stop();
+}
+
+void CLuxMeterReader::SetCallback(SampleCallback callback, void* pContext)
+{
+    m_callback = callback;
+    m_pContext = pContext;
+}
+
+bool CLuxMeterReader::Start(const std::string& port)
+{
+    Stop();
+    m_unit = 0;
+    m_scale = 0;
+    m_bStop = false;
+
+#ifdef LIBHCFR_HAS_WIN32_API
+    m_hPort = CreateFileA(port.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (m_hPort == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    COMMCONFIG cc;
+    memset(&cc, 0, sizeof(cc));
+    cc.dwSize = sizeof(cc);
+    cc.dcb.DCBlength = sizeof(cc.dcb);
+    DWORD dwSize = sizeof(cc);
+    GetDefaultCommConfigA(port.c_str(), &cc, &dwSize);
+    cc.dcb.BaudRate = CBR_9600;
+    cc.dcb.fBinary = TRUE;
+    cc.dcb.ByteSize = 8;
+    cc.dcb.Parity = NOPARITY;
+    cc.dcb.StopBits = ONESTOPBIT;
+
+    // reads return after a second without data, to check for Stop()
+    COMMTIMEOUTS ct;
+    ct.ReadIntervalTimeout = 0;
+    ct.ReadTotalTimeoutConstant = 1000;
+    ct.ReadTotalTimeoutMultiplier = 0;
+    ct.WriteTotalTimeoutConstant = 0;
+    ct.WriteTotalTimeoutMultiplier = 0;
+
+    if (!SetCommConfig(m_hPort, &cc, sizeof(cc)) || !SetCommMask(m_hPort, 0) ||
+        !PurgeComm(m_hPort, PURGE_RXCLEAR) || !SetCommTimeouts(m_hPort, &ct))
+    {
+        CloseHandle(m_hPort);
+        m_hPort = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    m_bRunning = true;
+    m_hThread = CreateThread(NULL, 65536, luxThreadFunc, this, 0, NULL);
+    if (m_hThread == NULL)
+    {
+        m_bRunning = false;
+        CloseHandle(m_hPort);
+        m_hPort = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    // readings are timestamped on arrival
+    SetThreadPriority(m_hThread, THREAD_PRIORITY_ABOVE_NORMAL);
+    return true;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    m_nPort = open(port.c_str(), O_RDONLY | O_NOCTTY);
+    if (m_nPort < 0)
+    {
+        return false;
+    }
+
+    // raw 9600 8N1, reads return after a second without data, to
+    // check for Stop()
+    struct termios tio;
+    if (tcgetattr(m_nPort, &tio) != 0)
+    {
+        close(m_nPort);
+        m_nPort = -1;
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B9600);
+    cfsetospeed(&tio, B9600);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 10;
+    if (tcsetattr(m_nPort, TCSANOW, &tio) != 0)
+    {
+        close(m_nPort);
+        m_nPort = -1;
+        return false;
+    }
+    tcflush(m_nPort, TCIFLUSH);
+
+    m_bRunning = true;
+    if (pthread_create(&m_thread, NULL, luxThreadFunc, this) != 0)
+    {
+        m_bRunning = false;
+        close(m_nPort);
+        m_nPort = -1;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CLuxMeterReader::Stop()
+{
+    m_bStop = true;
+#ifdef LIBHCFR_HAS_WIN32_API
+    if (m_hThread)
+    {
+        if (WaitForSingleObject(m_hThread, 10000) == WAIT_TIMEOUT)
+        {
+            TerminateThread(m_hThread, 0);
+        }
+        CloseHandle(m_hThread);
+        m_hThread = NULL;
+    }
+    if (m_hPort != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hPort);
+        m_hPort = INVALID_HANDLE_VALUE;
+    }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    if (m_nPort >= 0)
+    {
+        pthread_join(m_thread, NULL);
+        close(m_nPort);
+        m_nPort = -1;
+    }
+#endif
+    m_bRunning = false;
+}
+
+void CLuxMeterReader::Run()
+{
+    char szPacket[256];
+    size_t nLength = 0;
+    bool bRecord = false;
+    double startMs = 0.0;
+    char data[64];
+
+    while (!m_bStop)
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        DWORD nRead = 0;
+        if (!ReadFile(m_hPort, data, sizeof(data), &nRead, NULL))
+        {
+            break;
+        }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+        ssize_t nRead = read(m_nPort, data, sizeof(data));
+        if (nRead < 0)
+        {
+            break;
+        }
+#else
+        int nRead = 0;
+#endif
+        double nowMs = CTraceLog::GetClockUs() / 1000.0;
+        for (int i = 0; i < (int)nRead; i++)
+        {
+            if (data[i] == 0x02)
+            {
+                startMs = nowMs;
+                bRecord = true;
+                nLength = 0;
+            }
+            if (bRecord)
+            {
+                szPacket[nLength++] = data[i];
+                if (data[i] == 0x0D)
+                {
+                    szPacket[nLength] = '\0';
+                    bRecord = false;
+                    packetReceived(szPacket, startMs);
+                }
+                else if (nLength >= sizeof(szPacket) - 1)
+                {
+                    bRecord = false;
+                }
+            }
+        }
+    }
+    m_bRunning = false;
+}
+
+void CLuxMeterReader::packetReceived(const char* szPacket, double timeMs)
+{
+    LuxSample sample;
+    char unit;
+    char scale;
+    if (!DecodeLX1108Packet(szPacket, sample, unit, scale))
+    {
+        return;
+    }
+    if (unit != m_unit || scale != m_scale)
+    {
+        // the first reading on a new range is incoherent
+        m_unit = unit;
+        m_scale = scale;
+        return;
+    }
+    sample.timeMs = timeMs;
+    m_buffer.Add(sample);
+    if (m_callback)
+    {
+        m_callback(m_pContext, sample);
+    }
+}
@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(LUX_METER_H_INCLUDED_)
+#define LUX_METER_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "CriticalSection.h"
+#include <string>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <pthread.h>
+#endif
+
+// One reading of the lux meter
+struct LuxSample
+{
+    double timeMs;          // CTraceLog clock when the packet began to arrive
+    double lux;
+    bool bLow;              // below the range of the current scale
+    bool bHigh;             // above the range of the current scale
+    bool bLowestScale;
+    bool bHighestScale;
+};
+
+// Decode one LX-1108 packet, STX to CR included. The unit and scale
+// characters are returned so that readings taken across a range change
+// can be told apart. Ft-cd readings are converted to lux.
+bool DecodeLX1108Packet(const char* szPacket, LuxSample& sample, char& unit, char& scale);
+
+// The last lux readings, oldest first, shared between the serial
+// thread that adds them and the measures that match them
+class CLuxSampleBuffer
+{
+public:
+    enum { CAPACITY = 256 };
+    enum MatchResult
+    {
+        MATCH_OK,
+        MATCH_PENDING,      // nothing integrated inside the window yet
+        MATCH_UNDER_RANGE,  // the scale is too high for the light
+        MATCH_OVER_RANGE    // the scale is too low for the light
+    };
+
+    CLuxSampleBuffer();
+
+    void Clear();
+    void Add(const LuxSample& sample);
+    int GetCount();
+    bool GetLatest(LuxSample& sample);
+
+    // Average of the readings integrated wholly inside [startMs, endMs],
+    // a reading covering the integrationMs before its time. When a
+    // short window holds none, the first reading integrated wholly
+    // after startMs is used. The matched range flags are returned in
+    // result.
+    MatchResult Match(double startMs, double endMs, double integrationMs, LuxSample& result);
+
+private:
+    CriticalSection m_section;
+    LuxSample m_samples[CAPACITY];
+    int m_nFirst;
+    int m_nCount;
+};
+
+// Reads an LX-1108 on a serial port (9600 bauds, 8N1) from its own
+// thread into a sample buffer. Readings just after a unit or scale
+// change are dropped, the meter sends one stale value.
+class CLuxMeterReader
+{
+public:
+    typedef void (*SampleCallback)(void* pContext, const LuxSample& sample);
+
+    CLuxMeterReader(CLuxSampleBuffer& buffer);
+    ~CLuxMeterReader();
+
+    // Called from the reader thread after each reading is buffered
+    void SetCallback(SampleCallback callback, void* pContext);
+
+    bool Start(const std::string& port);
+    void Stop();
+    bool IsRunning() const { return m_bRunning; }
+
+    // Thread body
+    void Run();
+
+private:
+    void packetReceived(const char* szPacket, double timeMs);
+
+    CLuxSampleBuffer& m_buffer;
+    SampleCallback m_callback;
+    void* m_pContext;
+    char m_unit;
+    char m_scale;
+    volatile bool m_bStop;
+    volatile bool m_bRunning;
+#ifdef LIBHCFR_HAS_WIN32_API
+    HANDLE m_hPort;
+    HANDLE m_hThread;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    int m_nPort;
+    pthread_t m_thread;
+#endif
+};
+
+#endif // !defined(LUX_METER_H_INCLUDED_)
@@ -0,0 +1,547 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "MeasurementJournal.h"
+#include "LockWhileInScope.h"
+#include <string.h>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <io.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <unistd.h>
+#endif
+
+namespace
+{
+    const char szMagic[8] = { 'H', 'C', 'F', 'R', 'J', 'R', 'N', '1' };
+    // larger frames can only come from a damaged file
+    const unsigned int MAX_RECORD_SIZE = 1 << 20;
+
+    unsigned int checksum(const char* pData, size_t nSize)
+    {
+        // FNV-1a
+        unsigned int hash = 2166136261u;
+        for (size_t i = 0; i < nSize; i++)
+        {
+            hash ^= (unsigned char)pData[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    template <class T> void put(std::vector<char>& data, const T& value)
+    {
+        const char* p = (const char*)&value;
+        data.insert(data.end(), p, p + sizeof(T));
+    }
+
+    template <class T> bool get(const std::vector<char>& data, size_t& nPos, T& value)
+    {
+        if (nPos + sizeof(T) > data.size())
+        {
+            return false;
+        }
+        memcpy(&value, &data[nPos], sizeof(T));
+        nPos += sizeof(T);
+        return true;
+    }
+
+    void putString(std::vector<char>& data, const std::string& value)
+    {
+        put(data, (unsigned int)value.size());
+        data.insert(data.end(), value.begin(), value.end());
+    }
+
+    bool readString(FILE* pFile, std::string& value)
+    {
+        unsigned int nSize;
+        if (fread(&nSize, sizeof(nSize), 1, pFile) != 1 || nSize > MAX_RECORD_SIZE)
+        {
+            return false;
+        }
+        value.resize(nSize);
+        return nSize == 0 || fread(&value[0], 1, nSize, pFile) == nSize;
+    }
+
+    std::vector<char> encode(const JournalRecord& record)
+    {
+        std::vector<char> data;
+        put(data, record.series);
+        put(data, record.index);
+        put(data, record.seriesSize);
+        put(data, record.XYZ[0]);
+        put(data, record.XYZ[1]);
+        put(data, record.XYZ[2]);
+        put(data, (char)record.bHasLux);
+        put(data, record.lux);
+        put(data, (int)record.spectrum.size());
+        if (!record.spectrum.empty())
+        {
+            put(data, record.spectrumMin);
+            put(data, record.spectrumMax);
+            put(data, record.spectrumBandWidth);
+            for (size_t i = 0; i < record.spectrum.size(); i++)
+            {
+                put(data, record.spectrum[i]);
+            }
+        }
+        return data;
+    }
+
+    bool decode(const std::vector<char>& data, JournalRecord& record)
+    {
+        size_t nPos = 0;
+        char bHasLux;
+        int nBands;
+        if (!get(data, nPos, record.series) || !get(data, nPos, record.index) ||
+            !get(data, nPos, record.seriesSize) || !get(data, nPos, record.XYZ[0]) ||
+            !get(data, nPos, record.XYZ[1]) || !get(data, nPos, record.XYZ[2]) ||
+            !get(data, nPos, bHasLux) || !get(data, nPos, record.lux) ||
+            !get(data, nPos, nBands) || nBands < 0)
+        {
+            return false;
+        }
+        record.bHasLux = (bHasLux != 0);
+        record.spectrum.clear();
+        record.spectrumMin = 0;
+        record.spectrumMax = 0;
+        record.spectrumBandWidth = 0.0;
+        if (nBands > 0)
+        {
+            if (!get(data, nPos, record.spectrumMin) || !get(data, nPos, record.spectrumMax) ||
+                !get(data, nPos, record.spectrumBandWidth))
+            {
+                return false;
+            }
+            record.spectrum.resize(nBands);
+            for (int i = 0; i < nBands; i++)
+            {
+                if (!get(data, nPos, record.spectrum[i]))
+                {
+                    return false;
+                }
+            }
+        }
+        return nPos == data.size();
+    }
+
+    void syncFile(FILE* pFile)
+    {
+        fflush(pFile);
+#ifdef LIBHCFR_HAS_WIN32_API
+        _commit(_fileno(pFile));
+#elif defined(LIBHCFR_HAS_PTHREADS)
+        fsync(fileno(pFile));
+#endif
+    }
+
+    void sleepMs(int ms)
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        Sleep(ms);
+#else
+        usleep(ms * 1000);
+#endif
+    }
+
+#ifdef LIBHCFR_HAS_WIN32_API
+    DWORD WINAPI journalThreadFunc(LPVOID lpParam)
+    {
+        ((CMeasurementJournal*)lpParam)->Run();
+        return 0;
+    }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    void* journalThreadFunc(void* lpParam)
+    {
+        ((CMeasurementJournal*)lpParam)->Run();
+        return NULL;
+    }
+#endif
+}
+
+JournalRecord MakeJournalRecord(int series, int index, int seriesSize, const CColor& color)
+{
+    JournalRecord record;
+    record.series = series;
+    record.index = index;
+    record.seriesSize = seriesSize;
+    record.XYZ[0] = color.GetX();
+    record.XYZ[1] = color.GetY();
+    record.XYZ[2] = color.GetZ();
+    record.bHasLux = color.HasLuxValue();
+    record.lux = (record.bHasLux ? color.GetLuxValue() : 0.0);
+    record.spectrumMin = 0;
+    record.spectrumMax = 0;
+    record.spectrumBandWidth = 0.0;
+    if (color.HasSpectrum())
+    {
+        CSpectrum spectrum = color.GetSpectrum();
+        record.spectrumMin = spectrum.m_WaveLengthMin;
+        record.spectrumMax = spectrum.m_WaveLengthMax;
+        record.spectrumBandWidth = spectrum.m_BandWidth;
+        record.spectrum.resize(spectrum.GetRows());
+        for (int i = 0; i < spectrum.GetRows(); i++)
+        {
+            record.spectrum[i] = spectrum[i];
+        }
+    }
+    return record;
+}
+
+CColor GetJournalColor(const JournalRecord& record)
+{
+    CColor color(record.XYZ[0], record.XYZ[1], record.XYZ[2]);
+    if (record.bHasLux)
+    {
+        color.SetLuxValue(record.lux);
+    }
+    if (!record.spectrum.empty())
+    {
+        std::vector<double> values(record.spectrum);
+        CSpectrum spectrum((int)values.size(), record.spectrumMin, record.spectrumMax, record.spectrumBandWidth, &values[0]);
+        color.SetSpectrum(spectrum);
+    }
+    return color;
+}
+
+CMeasurementJournal::CMeasurementJournal() :
+    m_bOpen(false),
+    m_nRecords(0),
+    m_pFile(NULL),
+    m_bBusy(false),
+    m_bStop(false)
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    m_hWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hThread = NULL;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    pthread_mutex_init(&m_wakeMutex, NULL);
+    pthread_cond_init(&m_wakeCondition, NULL);
+    m_bWake = false;
+#endif
+}
+
+CMeasurementJournal::~CMeasurementJournal()
+{
+    Close();
+#ifdef LIBHCFR_HAS_WIN32_API
+    CloseHandle(m_hWake);
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    pthread_cond_destroy(&m_wakeCondition);
+    pthread_mutex_destroy(&m_wakeMutex);
+#endif
+}
+
+bool CMeasurementJournal::Open(const std::string& path, const std::string& documentPath, const std::string& snapshotPath)
+{
+    Close();
+    m_path = path;
+    m_documentPath = documentPath;
+    m_snapshotPath = snapshotPath;
+    m_nRecords = 0;
+    if (!startFile())
+    {
+        return false;
+    }
+
+    m_bStop = false;
+#ifdef LIBHCFR_HAS_WIN32_API
+    m_hThread = CreateThread(NULL, 0, journalThreadFunc, this, 0, NULL);
+    m_bOpen = (m_hThread != NULL);
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    m_bWake = false;
+    m_bOpen = (pthread_create(&m_thread, NULL, journalThreadFunc, this) == 0);
+#endif
+    if (!m_bOpen)
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+    }
+    return m_bOpen;
+}
+
+void CMeasurementJournal::Append(const JournalRecord& record)
+{
+    if (!m_bOpen)
+    {
+        return;
+    }
+    Item item;
+    item.bSnapshot = false;
+    item.pSnapshot = NULL;
+    std::vector<char> payload = encode(record);
+    put(item.data, (unsigned int)payload.size());
+    put(item.data, checksum(&payload[0], payload.size()));
+    item.data.insert(item.data.end(), payload.begin(), payload.end());
+    queue(item);
+    m_nRecords++;
+}
+
+void CMeasurementJournal::Compact(const std::vector<char>& snapshot)
+{
+    if (!m_bOpen)
+    {
+        return;
+    }
+    Item item;
+    item.bSnapshot = true;
+    item.data = snapshot;
+    item.pSnapshot = NULL;
+    queue(item);
+    m_nRecords = 0;
+}
+
+void CMeasurementJournal::Compact(CJournalSnapshot* pSnapshot)
+{
+    if (!m_bOpen)
+    {
+        delete pSnapshot;
+        return;
+    }
+    Item item;
+    item.bSnapshot = true;
+    item.pSnapshot = pSnapshot;
+    queue(item);
+    m_nRecords = 0;
+}
+
+void CMeasurementJournal::queue(Item& item)
+{
+    {
+        CLockWhileInScope lock(m_section);
+        m_queue.push_back(Item());
+        m_queue.back().bSnapshot = item.bSnapshot;
+        m_queue.back().data.swap(item.data);
+        m_queue.back().pSnapshot = item.pSnapshot;
+    }
+#ifdef LIBHCFR_HAS_WIN32_API
+    SetEvent(m_hWake);
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    pthread_mutex_lock(&m_wakeMutex);
+    m_bWake = true;
+    pthread_cond_signal(&m_wakeCondition);
+    pthread_mutex_unlock(&m_wakeMutex);
+#endif
+}
+
+void CMeasurementJournal::Flush()
+{
+    while (m_bOpen)
+    {
+        {
+            CLockWhileInScope lock(m_section);
+            if (m_queue.empty() && !m_bBusy)
+            {
+                return;
+            }
+        }
+        sleepMs(1);
+    }
+}
+
+void CMeasurementJournal::Close()
+{
+    if (!m_bOpen)
+    {
+        return;
+    }
+    Flush();
+    m_bStop = true;
+#ifdef LIBHCFR_HAS_WIN32_API
+    SetEvent(m_hWake);
+    WaitForSingleObject(m_hThread, INFINITE);
+    CloseHandle(m_hThread);
+    m_hThread = NULL;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    pthread_mutex_lock(&m_wakeMutex);
+    m_bWake = true;
+    pthread_cond_signal(&m_wakeCondition);
+    pthread_mutex_unlock(&m_wakeMutex);
+    pthread_join(m_thread, NULL);
+#endif
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+    }
+    m_bOpen = false;
+}
+
+void CMeasurementJournal::Discard()
+{
+    Close();
+    if (!m_path.empty())
+    {
+        remove(m_path.c_str());
+    }
+    if (!m_snapshotPath.empty())
+    {
+        remove(m_snapshotPath.c_str());
+    }
+    m_nRecords = 0;
+}
+
+void CMeasurementJournal::Run()
+{
+    std::deque<Item> items;
+    while (true)
+    {
+        {
+            CLockWhileInScope lock(m_section);
+            items.swap(m_queue);
+            m_bBusy = !items.empty();
+        }
+
+        if (items.empty())
+        {
+            if (m_bStop)
+            {
+                break;
+            }
+#ifdef LIBHCFR_HAS_WIN32_API
+            WaitForSingleObject(m_hWake, INFINITE);
+#elif defined(LIBHCFR_HAS_PTHREADS)
+            pthread_mutex_lock(&m_wakeMutex);
+            while (!m_bWake)
+            {
+                pthread_cond_wait(&m_wakeCondition, &m_wakeMutex);
+            }
+            m_bWake = false;
+            pthread_mutex_unlock(&m_wakeMutex);
+#endif
+            continue;
+        }
+
+        // one flush for everything queued meanwhile
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            if (items[i].bSnapshot)
+            {
+                // the journal is only restarted once its readings are in a snapshot
+                bool bBuilt = true;
+                if (items[i].pSnapshot)
+                {
+                    bBuilt = items[i].pSnapshot->Build(items[i].data);
+                    delete items[i].pSnapshot;
+                }
+                if (bBuilt && writeSnapshot(items[i].data))
+                {
+                    startFile();
+                }
+            }
+            else if (m_pFile)
+            {
+                fwrite(&items[i].data[0], 1, items[i].data.size(), m_pFile);
+            }
+        }
+        if (m_pFile)
+        {
+            syncFile(m_pFile);
+        }
+        items.clear();
+
+        {
+            CLockWhileInScope lock(m_section);
+            m_bBusy = false;
+        }
+    }
+}
+
+bool CMeasurementJournal::startFile()
+{
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+    }
+    m_pFile = fopen(m_path.c_str(), "wb");
+    if (!m_pFile)
+    {
+        return false;
+    }
+    std::vector<char> header(szMagic, szMagic + sizeof(szMagic));
+    putString(header, m_documentPath);
+    putString(header, m_snapshotPath);
+    fwrite(&header[0], 1, header.size(), m_pFile);
+    syncFile(m_pFile);
+    return true;
+}
+
+bool CMeasurementJournal::writeSnapshot(const std::vector<char>& snapshot)
+{
+    // written aside then renamed, a crash keeps the previous snapshot
+    // and its journal
+    std::string tempPath = m_snapshotPath + ".tmp";
+    FILE* pFile = fopen(tempPath.c_str(), "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    bool bOk = snapshot.empty() || fwrite(&snapshot[0], 1, snapshot.size(), pFile) == snapshot.size();
+    syncFile(pFile);
+    fclose(pFile);
+#ifdef LIBHCFR_HAS_WIN32_API
+    bOk = bOk && MoveFileExA(tempPath.c_str(), m_snapshotPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    bOk = bOk && rename(tempPath.c_str(), m_snapshotPath.c_str()) == 0;
+#endif
+    if (!bOk)
+    {
+        remove(tempPath.c_str());
+    }
+    return bOk;
+}
+
+bool CMeasurementJournal::Read(const std::string& path, std::string& documentPath, std::string& snapshotPath,
+                               std::vector<JournalRecord>& records, std::string& error)
+{
+    records.clear();
+    FILE* pFile = fopen(path.c_str(), "rb");
+    if (!pFile)
+    {
+        error = "Can't open " + path;
+        return false;
+    }
+
+    char magic[sizeof(szMagic)];
+    if (fread(magic, 1, sizeof(magic), pFile) != sizeof(magic) || memcmp(magic, szMagic, sizeof(magic)) != 0 ||
+        !readString(pFile, documentPath) || !readString(pFile, snapshotPath))
+    {
+        fclose(pFile);
+        error = path + " is not a measurement journal";
+        return false;
+    }
+
+    // stops at the end or at a record torn by a crash
+    while (true)
+    {
+        unsigned int frame[2];
+        if (fread(frame, sizeof(frame), 1, pFile) != 1 || frame[0] > MAX_RECORD_SIZE)
+        {
+            break;
+        }
+        std::vector<char> payload(frame[0]);
+        JournalRecord record;
+        if ((frame[0] > 0 && fread(&payload[0], 1, frame[0], pFile) != frame[0]) ||
+            checksum(payload.empty() ? NULL : &payload[0], payload.size()) != frame[1] ||
+            !decode(payload, record))
+        {
+            break;
+        }
+        records.push_back(record);
+    }
+    fclose(pFile);
+    return true;
+}
@@ -0,0 +1,140 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MEASUREMENT_JOURNAL_H_INCLUDED_)
+#define MEASUREMENT_JOURNAL_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "CriticalSection.h"
+#include "Color.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <stdio.h>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <pthread.h>
+#endif
+
+// One reading as it landed in a series of the document
+struct JournalRecord
+{
+    int series;             // series id, defined by the document
+    int index;
+    int seriesSize;
+    double XYZ[3];
+    bool bHasLux;
+    double lux;
+    int spectrumMin;        // wavelengths, when spectrum is not empty
+    int spectrumMax;
+    double spectrumBandWidth;
+    std::vector<double> spectrum;
+};
+
+JournalRecord MakeJournalRecord(int series, int index, int seriesSize, const CColor& color);
+CColor GetJournalColor(const JournalRecord& record);
+
+// Snapshot of the document, copied by the thread taking the readings and
+// serialised by the journal writer thread, which then deletes it
+class CJournalSnapshot
+{
+public:
+    virtual ~CJournalSnapshot() {}
+    virtual bool Build(std::vector<char>& data) = 0;
+};
+
+// Append only log of the readings of a document since its last
+// snapshot, so that a crash loses nothing and saving during a long run
+// costs the new readings only.
+//
+// A writer thread appends the records and flushes them to disk as they
+// are queued. Compact() queues a snapshot of the whole document: the
+// writer replaces the snapshot file with it and restarts the journal,
+// readings queued after it go to the new journal. Given a
+// CJournalSnapshot, the writer also builds the snapshot data. Records are framed
+// with their length and a checksum, so a record torn by a crash ends
+// the journal cleanly. The file is in native byte order, it never
+// leaves the machine that wrote it.
+class CMeasurementJournal
+{
+public:
+    CMeasurementJournal();
+    ~CMeasurementJournal();
+
+    // Start an empty journal. documentPath is the document the readings
+    // belong to, empty when it was never saved.
+    bool Open(const std::string& path, const std::string& documentPath, const std::string& snapshotPath);
+    bool IsOpen() const { return m_bOpen; }
+    const std::string& GetPath() const { return m_path; }
+    const std::string& GetSnapshotPath() const { return m_snapshotPath; }
+
+    void Append(const JournalRecord& record);
+    void Compact(const std::vector<char>& snapshot);
+    // Takes ownership of pSnapshot
+    void Compact(CJournalSnapshot* pSnapshot);
+    // Records appended since the last compaction
+    int GetRecordCount() const { return m_nRecords; }
+
+    // Wait until everything queued is on disk
+    void Flush();
+    // Flush and stop, the files are kept for recovery
+    void Close();
+    // Close and delete the files, the document was saved
+    void Discard();
+
+    static bool Read(const std::string& path, std::string& documentPath, std::string& snapshotPath,
+                     std::vector<JournalRecord>& records, std::string& error);
+
+    // Writer thread body
+    void Run();
+
+private:
+    struct Item
+    {
+        bool bSnapshot;
+        std::vector<char> data;
+        CJournalSnapshot* pSnapshot;
+    };
+
+    void queue(Item& item);
+    bool startFile();
+    bool writeSnapshot(const std::vector<char>& snapshot);
+
+    std::string m_path;
+    std::string m_documentPath;
+    std::string m_snapshotPath;
+    bool m_bOpen;
+    int m_nRecords;
+    FILE* m_pFile;
+
+    CriticalSection m_section;
+    std::deque<Item> m_queue;
+    volatile bool m_bBusy;
+    volatile bool m_bStop;
+#ifdef LIBHCFR_HAS_WIN32_API
+    HANDLE m_hWake;
+    HANDLE m_hThread;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    pthread_mutex_t m_wakeMutex;
+    pthread_cond_t m_wakeCondition;
+    bool m_bWake;
+    pthread_t m_thread;
+#endif
+};
+
+#endif // !defined(MEASUREMENT_JOURNAL_H_INCLUDED_)
@@ -0,0 +1,450 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "MeasurementRunner.h"
+#include "TraceLog.h"
+#include "PatchSetFile.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sstream>
+#include <iomanip>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <unistd.h>
+#   include <sys/time.h>
+#endif
+
+namespace
+{
+    const int MAX_SERIES_STEPS = 256;
+
+    struct ColorCheckerSet
+    {
+        const char* name;
+        CCPatterns pattern;
+        int nPatches;
+    };
+
+    // the sets of a fixed size, the others are read from files
+    // by GenerateCC24Colors() and can be given as user series
+    const ColorCheckerSet colorCheckerSets[] =
+    {
+        { "GCD", GCD, 24 },
+        { "MCD", MCD, 24 },
+        { "SKIN", SKIN, 24 },
+        { "CMC", CMC, 24 },
+        { "CMS", CMS, 19 },
+        { "CPS", CPS, 19 },
+        { "CCSG", CCSG, 96 },
+    };
+
+    const char* saturationNames[6] = { "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+    const bool saturationChannels[6][3] =
+    {
+        { true, false, false },
+        { false, true, false },
+        { false, false, true },
+        { true, true, false },
+        { false, true, true },
+        { true, false, true },
+    };
+
+    std::string stepName(const char* prefix, int nStep, int nSteps)
+    {
+        std::ostringstream name;
+        name << prefix << " " << (nSteps > 1 ? nStep * 100 / (nSteps - 1) : 100) << "%";
+        return name.str();
+    }
+
+    void addPatch(std::vector<MeasurementPatch>& patches, const std::string& name, const ColorRGBDisplay& rgb)
+    {
+        MeasurementPatch patch;
+        patch.name = name;
+        patch.rgb = rgb;
+        patches.push_back(patch);
+    }
+
+    bool parseSteps(const std::string& value, int& nSteps)
+    {
+        char* end;
+        long n = strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || n < 2 || n > MAX_SERIES_STEPS)
+        {
+            return false;
+        }
+        nSteps = (int)n;
+        return true;
+    }
+
+    void sleepMs(int nMs)
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        Sleep(nMs);
+#else
+        usleep(nMs * 1000);
+#endif
+    }
+}
+
+double GetMeasurementClockMs()
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+MeasurementSeriesConfig::MeasurementSeriesConfig() :
+    colorReference(HDTV),
+    gammaOffsetType(0),
+    bUseRoundDown(false),
+    bUse10bit(false)
+{
+}
+
+bool BuildMeasurementSeries(const std::string& description,
+                            const MeasurementSeriesConfig& config,
+                            std::vector<MeasurementPatch>& patches,
+                            std::string& error)
+{
+    size_t colon = description.find(':');
+    std::string kind = description.substr(0, colon);
+    std::string value = colon == std::string::npos ? "" : description.substr(colon + 1);
+    int nSteps = 0;
+
+    if (kind == "gray")
+    {
+        if (!parseSteps(value, nSteps))
+        {
+            error = "bad step count in " + description;
+            return false;
+        }
+        for (int i = 0; i < nSteps; i++)
+        {
+            addPatch(patches, stepName("Gray", i, nSteps),
+                     ColorRGBDisplay(ArrayIndexToGrayLevel(i, nSteps, config.bUseRoundDown, config.bUse10bit)));
+        }
+        return true;
+    }
+
+    if (kind == "sat")
+    {
+        if (!parseSteps(value, nSteps))
+        {
+            error = "bad step count in " + description;
+            return false;
+        }
+        std::vector<ColorRGBDisplay> colors(nSteps);
+        for (int color = 0; color < 6; color++)
+        {
+            GenerateSaturationColors(config.colorReference, &colors[0], nSteps,
+                                     saturationChannels[color][0], saturationChannels[color][1], saturationChannels[color][2],
+                                     config.gammaOffsetType);
+            for (int i = 0; i < nSteps; i++)
+            {
+                addPatch(patches, stepName(saturationNames[color], i, nSteps), colors[i]);
+            }
+        }
+        return true;
+    }
+
+    if (kind == "cc")
+    {
+        for (size_t set = 0; set < sizeof(colorCheckerSets) / sizeof(colorCheckerSets[0]); set++)
+        {
+            if (value != colorCheckerSets[set].name)
+            {
+                continue;
+            }
+            std::vector<ColorRGBDisplay> colors(colorCheckerSets[set].nPatches);
+            if (!GenerateCC24Colors(config.colorReference, &colors[0], colorCheckerSets[set].pattern, config.gammaOffsetType))
+            {
+                error = "can't generate " + description;
+                return false;
+            }
+            for (size_t i = 0; i < colors.size(); i++)
+            {
+                std::ostringstream name;
+                name << value << " " << (i + 1);
+                addPatch(patches, name.str(), colors[i]);
+            }
+            return true;
+        }
+        error = "unknown colour checker in " + description;
+        return false;
+    }
+
+    if (kind == "user")
+    {
+        CPatchSetFile patchSet;
+        if (!CPatchSetFile::ReadCached(value, patchSet))
+        {
+            error = "can't read patches from " + value + "\n" + patchSet.GetErrorString();
+            return false;
+        }
+        int nColors = patchSet.GetSize() < MAX_USER_CC_PATCH_SIZE ? patchSet.GetSize() : MAX_USER_CC_PATCH_SIZE;
+        if (nColors == 0)
+        {
+            error = "no patches in " + value;
+            return false;
+        }
+        for (int i = 0; i < nColors; i++)
+        {
+            std::string name = patchSet.GetName(i);
+            if (name.empty())
+            {
+                std::ostringstream defaultName;
+                defaultName << "User " << (i + 1);
+                name = defaultName.str();
+            }
+            addPatch(patches, name, patchSet.GetColors()[i]);
+        }
+        return true;
+    }
+
+    error = "unknown series " + description;
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////
+// CSimulatedDisplaySensor
+
+namespace
+{
+    // the 75% and plasma references share the HDTV primaries, and
+    // the BT.2020 containers their own, as in CSimulatedSensor
+    DisplayModelConfig referenceDisplay(const CColorReference& colorReference,
+                                        double gamma, double whiteY,
+                                        double blackY, bool b10bit)
+    {
+        DisplayModelConfig config;
+        if (colorReference.m_standard == HDTVa || colorReference.m_standard == HDTVb)
+        {
+            config.SetPrimaries(CColorReference(HDTV));
+        }
+        else if (colorReference.m_standard == UHDTV3 || colorReference.m_standard == UHDTV4)
+        {
+            config.SetPrimaries(CColorReference(UHDTV2));
+        }
+        else
+        {
+            config.SetPrimaries(colorReference);
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            config.gamma[i] = gamma;
+        }
+        config.whiteY = whiteY;
+        config.blackY = blackY;
+        config.bits = b10bit ? 10 : 8;
+        return config;
+    }
+}
+
+CSimulatedDisplaySensor::CSimulatedDisplaySensor(const CColorReference& colorReference,
+                                                 double gamma, double whiteY,
+                                                 double blackY, bool b10bit) :
+    m_model(referenceDisplay(colorReference, gamma, whiteY, blackY, b10bit)),
+    m_nReadDelayMs(0)
+{
+}
+
+CSimulatedDisplaySensor::CSimulatedDisplaySensor(const DisplayModelConfig& config) :
+    m_model(config),
+    m_nReadDelayMs(0)
+{
+}
+
+void CSimulatedDisplaySensor::SetDisplayModel(const DisplayModelConfig& config)
+{
+    m_model = CDisplayModel(config);
+}
+
+void CSimulatedDisplaySensor::SetErrors(double offsetErrorMax, double gainErrorMax, unsigned int seed)
+{
+    DisplayModelConfig config = m_model.GetConfig();
+    config.offsetErrorMax = offsetErrorMax;
+    config.gainErrorMax = gainErrorMax;
+    config.seed = seed;
+    SetDisplayModel(config);
+}
+
+ColorXYZ CSimulatedDisplaySensor::MeasureRGBColor(const ColorRGBDisplay& color)
+{
+    if (m_nReadDelayMs > 0)
+    {
+        sleepMs(m_nReadDelayMs);
+    }
+    return m_model.Measure(color);
+}
+
+/////////////////////////////////////////////////////////////////////
+// CMeasurementRunner
+
+namespace
+{
+    // patch names come from user files, quote those that would break the row
+    void writeCsvField(std::ostream& out, const std::string& field)
+    {
+        if (field.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            out << field;
+            return;
+        }
+        out << '"';
+        for (size_t i = 0; i < field.size(); i++)
+        {
+            if (field[i] == '"')
+            {
+                out << '"';
+            }
+            out << field[i];
+        }
+        out << '"';
+    }
+}
+
+CMeasurementRunner::CMeasurementRunner(CMeasurementSensor& sensor, CMeasurementGenerator& generator) :
+    m_sensor(sensor),
+    m_generator(generator),
+    m_totalMs(0.0)
+{
+}
+
+bool CMeasurementRunner::Run(const std::vector<MeasurementPatch>& patches)
+{
+    HCFR_TRACE_FUNCTION("measure");
+    double start = GetMeasurementClockMs();
+    bool bOk = true;
+
+    m_results.clear();
+    m_results.reserve(patches.size());
+    m_lastError.clear();
+
+    if (!m_generator.Init())
+    {
+        m_lastError = "can't initialise " + m_generator.GetName();
+        m_totalMs = GetMeasurementClockMs() - start;
+        return false;
+    }
+
+    if (!m_sensor.Init())
+    {
+        m_lastError = "can't initialise " + m_sensor.GetName();
+        m_generator.Release();
+        m_totalMs = GetMeasurementClockMs() - start;
+        return false;
+    }
+
+    for (size_t i = 0; i < patches.size(); i++)
+    {
+        HCFR_TRACE_SPAN("patch", "measure");
+        MeasurementResult result;
+        result.name = patches[i].name;
+        result.rgb = patches[i].rgb;
+
+        double t0 = GetMeasurementClockMs();
+        bool bDisplayed;
+        {
+            HCFR_TRACE_SPAN("DisplayRGBColor", "generator");
+            bDisplayed = m_generator.DisplayRGBColor(patches[i].rgb);
+        }
+        if (!bDisplayed)
+        {
+            m_lastError = m_generator.GetName() + " failed to display " + patches[i].name;
+            bOk = false;
+            break;
+        }
+        double t1 = GetMeasurementClockMs();
+        {
+            HCFR_TRACE_SPAN("MeasureRGBColor", "sensor");
+            result.XYZ = m_sensor.MeasureRGBColor(patches[i].rgb);
+        }
+        double t2 = GetMeasurementClockMs();
+
+        if (!result.XYZ.isValid())
+        {
+            m_lastError = m_sensor.GetName() + " failed to measure " + patches[i].name;
+            bOk = false;
+            break;
+        }
+
+        result.displayMs = t1 - t0;
+        result.measureMs = t2 - t1;
+        m_results.push_back(result);
+    }
+
+    m_sensor.Release();
+    m_generator.Release();
+    m_totalMs = GetMeasurementClockMs() - start;
+    return bOk;
+}
+
+void CMeasurementRunner::WriteCsv(std::ostream& out) const
+{
+    out << "Name,R,G,B,X,Y,Z,DisplayMs,MeasureMs\n";
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const MeasurementResult& result = m_results[i];
+        std::ostringstream line;
+        line << std::fixed;
+        writeCsvField(line, result.name);
+        line << std::setprecision(4) << ',' << result.rgb[0] << ',' << result.rgb[1] << ',' << result.rgb[2];
+        line << std::setprecision(6) << ',' << result.XYZ[0] << ',' << result.XYZ[1] << ',' << result.XYZ[2];
+        line << std::setprecision(3) << ',' << result.displayMs << ',' << result.measureMs << '\n';
+        out << line.str();
+    }
+}
+
+void CMeasurementRunner::WriteCgats(std::ostream& out) const
+{
+    char created[64];
+    time_t now = time(NULL);
+
+    strftime(created, sizeof(created), "%a %b %d %H:%M:%S %Y", localtime(&now));
+
+    out << "CGATS.17\n\n";
+    out << "ORIGINATOR \"HCFR\"\n";
+    out << "DESCRIPTOR \"" << m_sensor.GetName() << ", " << m_generator.GetName() << "\"\n";
+    out << "CREATED \"" << created << "\"\n";
+    out << "INSTRUMENTATION \"" << m_sensor.GetName() << "\"\n\n";
+    out << "NUMBER_OF_FIELDS 7\n";
+    out << "BEGIN_DATA_FORMAT\n";
+    out << "SAMPLE_ID RGB_R RGB_G RGB_B XYZ_X XYZ_Y XYZ_Z\n";
+    out << "END_DATA_FORMAT\n\n";
+    out << "NUMBER_OF_SETS " << m_results.size() << "\n";
+    out << "BEGIN_DATA\n";
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const MeasurementResult& result = m_results[i];
+        std::ostringstream line;
+        line << std::fixed << (i + 1);
+        line << std::setprecision(4) << ' ' << result.rgb[0] << ' ' << result.rgb[1] << ' ' << result.rgb[2];
+        line << std::setprecision(6) << ' ' << result.XYZ[0] << ' ' << result.XYZ[1] << ' ' << result.XYZ[2] << '\n';
+        out << line.str();
+    }
+    out << "END_DATA\n";
+}
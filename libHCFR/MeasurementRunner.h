@@ -0,0 +1,163 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MEASUREMENT_RUNNER_H_INCLUDED_)
+#define MEASUREMENT_RUNNER_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "Color.h"
+#include "DisplayModel.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Running a series of patches without the application: the same
+// display, measure and store loop as the CMeasure series, over
+// sensor and generator interfaces that don't need MFC, so that
+// runs can be scripted and timed on any platform.
+
+struct MeasurementPatch
+{
+    std::string name;
+    ColorRGBDisplay rgb;
+};
+
+struct MeasurementResult
+{
+    std::string name;
+    ColorRGBDisplay rgb;
+    ColorXYZ XYZ;
+    double displayMs;   // time spent in DisplayRGBColor()
+    double measureMs;   // time spent in MeasureRGBColor()
+};
+
+// Settings the series are built from, the CColorHCFRConfig
+// members of the same names
+struct MeasurementSeriesConfig
+{
+    MeasurementSeriesConfig();
+
+    CColorReference colorReference;
+    int gammaOffsetType;
+    bool bUseRoundDown;
+    bool bUse10bit;
+};
+
+// Append the patches of one series to the list. The description is
+// one of
+//   gray:N      N step grayscale, black to white
+//   sat:N       N step saturation sweeps of the primaries and
+//               secondaries, in red, green, blue, yellow, cyan,
+//               magenta order
+//   cc:SET      a colour checker, SET is GCD, MCD, SKIN, CMC, CMS,
+//               CPS or CCSG
+//   user:FILE   patches of a CSV file of 16-235 R,G,B lines
+bool BuildMeasurementSeries(const std::string& description,
+                            const MeasurementSeriesConfig& config,
+                            std::vector<MeasurementPatch>& patches,
+                            std::string& error);
+
+class CMeasurementGenerator
+{
+public:
+    virtual ~CMeasurementGenerator() {}
+    virtual std::string GetName() const = 0;
+    virtual bool Init() { return true; }
+    virtual bool DisplayRGBColor(const ColorRGBDisplay& color) = 0;
+    virtual void Release() {}
+};
+
+class CMeasurementSensor
+{
+public:
+    virtual ~CMeasurementSensor() {}
+    virtual std::string GetName() const = 0;
+    virtual bool Init() { return true; }
+    virtual ColorXYZ MeasureRGBColor(const ColorRGBDisplay& color) = 0;
+    virtual void Release() {}
+};
+
+// Shows nothing, for when the sensor doesn't look at a screen
+class CNullGenerator : public CMeasurementGenerator
+{
+public:
+    virtual std::string GetName() const { return "Null generator"; }
+    virtual bool DisplayRGBColor(const ColorRGBDisplay&) { return true; }
+};
+
+// Reads what a CDisplayModel display shows. By default one with the
+// primaries of the colour reference and a power law response, with the
+// video level quantization and the random offset and gain errors of the
+// application's simulated sensor. The model is seeded so that runs can
+// be repeated.
+class CSimulatedDisplaySensor : public CMeasurementSensor
+{
+public:
+    CSimulatedDisplaySensor(const CColorReference& colorReference,
+                            double gamma = 2.22, double whiteY = 120.0,
+                            double blackY = 0.0, bool b10bit = false);
+    explicit CSimulatedDisplaySensor(const DisplayModelConfig& config);
+
+    // Replaces the display and restarts it from power on
+    void SetDisplayModel(const DisplayModelConfig& config);
+    const DisplayModelConfig& GetDisplayModel() const { return m_model.GetConfig(); }
+
+    // Maximum offset error in percent and gain error as a fraction,
+    // 0 for none
+    void SetErrors(double offsetErrorMax, double gainErrorMax, unsigned int seed = 1);
+    // Real time a reading takes, the application's sensor takes 50 ms
+    void SetReadDelay(int nMs) { m_nReadDelayMs = nMs; }
+
+    virtual std::string GetName() const { return "Simulated sensor"; }
+    virtual ColorXYZ MeasureRGBColor(const ColorRGBDisplay& color);
+
+private:
+    CDisplayModel m_model;
+    int m_nReadDelayMs;
+};
+
+class CMeasurementRunner
+{
+public:
+    CMeasurementRunner(CMeasurementSensor& sensor, CMeasurementGenerator& generator);
+
+    // Display and measure every patch, stopping at the first failure
+    bool Run(const std::vector<MeasurementPatch>& patches);
+
+    const std::vector<MeasurementResult>& GetResults() const { return m_results; }
+    // Wall time of the last Run(), init and release included
+    double GetTotalMs() const { return m_totalMs; }
+    const std::string& GetLastError() const { return m_lastError; }
+
+    // One line per patch with the display and measure times
+    void WriteCsv(std::ostream& out) const;
+    void WriteCgats(std::ostream& out) const;
+
+private:
+    CMeasurementRunner(const CMeasurementRunner&);
+    CMeasurementRunner& operator=(const CMeasurementRunner&);
+
+    CMeasurementSensor& m_sensor;
+    CMeasurementGenerator& m_generator;
+    std::vector<MeasurementResult> m_results;
+    double m_totalMs;
+    std::string m_lastError;
+};
+
+// Milliseconds from an arbitrary start, for timing
+double GetMeasurementClockMs();
+
+#endif // !defined(MEASUREMENT_RUNNER_H_INCLUDED_)
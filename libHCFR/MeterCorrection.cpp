@@ -0,0 +1,557 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// MeterCorrection.cpp : multi-patch meter correction matrix fitting
+//////////////////////////////////////////////////////////////////////
+
+#include "MeterCorrection.h"
+#include "ParallelJob.h"
+#include <math.h>
+#include <string.h>
+#include <stdexcept>
+
+namespace
+{
+	// Patches handled by one work item when evaluating the fit
+	const int PATCHES_PER_ITEM = 64;
+
+	// Same conversion as ColorLab, with an explicit white
+	void XYZToLab ( const double * XYZ, const double * white, double * Lab )
+	{
+		const double epsilon ( 216.0 / 24389.0 );
+		const double kappa ( 24389.0 / 27.0 );
+		double v [ 3 ];
+
+		for ( int i = 0; i < 3; i ++ )
+		{
+			v [ i ] = XYZ [ i ] / white [ i ];
+			if ( v [ i ] > epsilon )
+				v [ i ] = pow ( v [ i ], 1.0 / 3.0 );
+			else
+				v [ i ] = ( kappa * v [ i ] + 16.0 ) / 116.0;
+		}
+
+		Lab [ 0 ] = 116.0 * v [ 1 ] - 16.0;
+		Lab [ 1 ] = 500.0 * ( v [ 0 ] - v [ 1 ] );
+		Lab [ 2 ] = 200.0 * ( v [ 1 ] - v [ 2 ] );
+	}
+
+	void ApplyParams ( const double * params, const double * in, double * out )
+	{
+		for ( int j = 0; j < 3; j ++ )
+			out [ j ] = params [ j * 4 ] * in [ 0 ] + params [ j * 4 + 1 ] * in [ 1 ] + params [ j * 4 + 2 ] * in [ 2 ] + params [ j * 4 + 3 ];
+	}
+
+	double PatchDeltaE ( const double * refLab, const double * XYZ, const double * white )
+	{
+		double Lab [ 3 ];
+
+		XYZToLab ( XYZ, white, Lab );
+		return GetDeltaE2000 ( refLab [ 0 ], refLab [ 1 ], refLab [ 2 ], Lab [ 0 ], Lab [ 1 ], Lab [ 2 ] );
+	}
+
+	// Gradients below are with respect to the sample L*a*b*, one double [ 3 ] per quantity
+	inline void Scale ( double * out, const double * g, double k )
+	{
+		out [ 0 ] = g [ 0 ] * k;
+		out [ 1 ] = g [ 1 ] * k;
+		out [ 2 ] = g [ 2 ] * k;
+	}
+
+	inline void Combine ( double * out, const double * g1, double k1, const double * g2, double k2 )
+	{
+		out [ 0 ] = g1 [ 0 ] * k1 + g2 [ 0 ] * k2;
+		out [ 1 ] = g1 [ 1 ] * k1 + g2 [ 1 ] * k2;
+		out [ 2 ] = g1 [ 2 ] * k1 + g2 [ 2 ] * k2;
+	}
+
+	// sqrt ( C^7 / ( C^7 + 25^7 ) ) of dE2000 and its derivative
+	inline double Chroma7 ( double C, double * pDerivative )
+	{
+		const double K = 6103515625.0;	// 25^7
+		double C7 = pow ( C, 7.0 );
+
+		* pDerivative = 3.5 * K * pow ( C, 2.5 ) / pow ( C7 + K, 1.5 );
+		return sqrt ( C7 / ( C7 + K ) );
+	}
+
+	// Gradient of GetDeltaE2000 ( refLab, Lab ) with respect to Lab, following
+	// its computation step by step. Zero where dE2000 is not differentiable
+	// (no difference, or a neutral sample).
+	void DeltaE2000Gradient ( const double * refLab, const double * Lab, double * grad )
+	{
+		const double	L1 = refLab [ 0 ], a1 = refLab [ 1 ], b1 = refLab [ 2 ];
+		const double	L2 = Lab [ 0 ], a2 = Lab [ 1 ], b2 = Lab [ 2 ];
+		const double	eL [ 3 ] = { 1.0, 0.0, 0.0 };
+		const double	ea [ 3 ] = { 0.0, 1.0, 0.0 };
+		const double	eb [ 3 ] = { 0.0, 0.0, 1.0 };
+
+		grad [ 0 ] = grad [ 1 ] = grad [ 2 ] = 0.0;
+
+		double C1 = sqrt ( a1 * a1 + b1 * b1 );
+		double C2 = sqrt ( a2 * a2 + b2 * b2 );
+		if ( C2 <= 0.0 )
+			return;
+
+		double gC [ 3 ];
+		Combine ( gC, ea, a2 / ( 2.0 * C2 ), eb, b2 / ( 2.0 * C2 ) );
+		double dF;
+		double G = ( 1.0 - Chroma7 ( ( C1 + C2 ) / 2.0, & dF ) ) / 2.0;
+		double gG [ 3 ];
+		Scale ( gG, gC, - dF / 2.0 );
+
+		double a1p = a1 * ( 1.0 + G ), a2p = a2 * ( 1.0 + G );
+		double ga1p [ 3 ], ga2p [ 3 ];
+		Scale ( ga1p, gG, a1 );
+		Combine ( ga2p, ea, 1.0 + G, gG, a2 );
+
+		double C1p = sqrt ( a1p * a1p + b1 * b1 );
+		double C2p = sqrt ( a2p * a2p + b2 * b2 );
+		if ( C1p <= 0.0 || C2p <= 0.0 )
+			return;
+
+		double gC1p [ 3 ], gC2p [ 3 ], gCp [ 3 ];
+		Scale ( gC1p, ga1p, a1p / C1p );
+		Combine ( gC2p, ga2p, a2p / C2p, eb, b2 / C2p );
+		Combine ( gCp, gC1p, 0.5, gC2p, 0.5 );
+		double Cp = ( C1p + C2p ) / 2.0;
+
+		// d atan2 ( y, x ) = ( x dy - y dx ) / ( x^2 + y^2 ), the 2 pi wraps are constants
+		double h1p = ( atan2 ( b1, a1p ) >= 0 ? atan2 ( b1, a1p ) : atan2 ( b1, a1p ) + PI * 2.0 );
+		double h2p = ( atan2 ( b2, a2p ) >= 0 ? atan2 ( b2, a2p ) : atan2 ( b2, a2p ) + PI * 2.0 );
+		double gh1p [ 3 ], gh2p [ 3 ], gHp [ 3 ], gdhp [ 3 ];
+		Scale ( gh1p, ga1p, - b1 / ( C1p * C1p ) );
+		Combine ( gh2p, eb, a2p / ( C2p * C2p ), ga2p, - b2 / ( C2p * C2p ) );
+		Combine ( gHp, gh1p, 0.5, gh2p, 0.5 );
+		Combine ( gdhp, gh2p, 1.0, gh1p, -1.0 );
+		double Hp = ( fabs ( h1p - h2p ) > PI ? ( h1p + h2p + PI * 2 ) / 2.0 : ( h1p + h2p ) / 2.0 );
+		double dhp = ( fabs ( h2p - h1p ) <= PI ? ( h2p - h1p ) : ( ( h2p <= h1p ) ? ( h2p - h1p + 2 * PI ) : ( h2p - h1p - 2 * PI ) ) );
+
+		double T = 1 - 0.17 * cos ( Hp - 30. / 180. * PI ) + 0.24 * cos ( 2 * Hp ) + 0.32 * cos ( 3 * Hp + 6.0 / 180. * PI ) - 0.20 * cos ( 4 * Hp - 63.0 / 180. * PI );
+		double dTdH = 0.17 * sin ( Hp - 30. / 180. * PI ) - 0.48 * sin ( 2 * Hp ) - 0.96 * sin ( 3 * Hp + 6.0 / 180. * PI ) + 0.80 * sin ( 4 * Hp - 63.0 / 180. * PI );
+		double gT [ 3 ];
+		Scale ( gT, gHp, dTdH );
+
+		double dLp = L2 - L1;
+		double dCp = C2p - C1p;
+		double gdCp [ 3 ];
+		Combine ( gdCp, gC2p, 1.0, gC1p, -1.0 );
+
+		double s = sqrt ( C1p * C2p );
+		double dHp = 2 * s * sin ( dhp / 2 );
+		double gs [ 3 ], gdHp [ 3 ];
+		Combine ( gs, gC1p, C2p / ( 2.0 * s ), gC2p, C1p / ( 2.0 * s ) );
+		Combine ( gdHp, gs, 2 * sin ( dhp / 2 ), gdhp, s * cos ( dhp / 2 ) );
+
+		double u = ( L1 + L2 ) / 2.0 - 50;
+		double SL = 1 + ( 0.015 * u * u / sqrt ( 20 + u * u ) );
+		double gSL [ 3 ];
+		Scale ( gSL, eL, 0.5 * 0.015 * u * ( 40 + u * u ) / pow ( 20 + u * u, 1.5 ) );
+
+		double SC = 1 + 0.045 * Cp;
+		double SH = 1 + 0.015 * Cp * T;
+		double gSC [ 3 ], gSH [ 3 ];
+		Scale ( gSC, gCp, 0.045 );
+		Combine ( gSH, gCp, 0.015 * T, gT, 0.015 * Cp );
+
+		double x = ( Hp * 180. / PI - 275.0 ) / 25.0;
+		double dtheta = 30 * exp ( -1.0 * x * x );
+		double gdtheta [ 3 ];
+		Scale ( gdtheta, gHp, dtheta * ( -2.0 * x / 25.0 ) * 180. / PI );
+
+		double dRC;
+		double RC = 2 * Chroma7 ( Cp, & dRC );
+		double gRC [ 3 ], gRT [ 3 ];
+		Scale ( gRC, gCp, 2 * dRC );
+		Combine ( gRT, gRC, - sin ( 2 * dtheta / 180. * PI ), gdtheta, - RC * cos ( 2 * dtheta / 180. * PI ) * 2.0 / 180. * PI );
+		double RT = -1.0 * RC * sin ( 2 * dtheta / 180. * PI );
+
+		double tL = dLp / SL, tC = dCp / SC, tH = dHp / SH;
+		double gtL [ 3 ], gtC [ 3 ], gtH [ 3 ];
+		Combine ( gtL, eL, 1.0 / SL, gSL, - tL / SL );
+		Combine ( gtC, gdCp, 1.0 / SC, gSC, - tC / SC );
+		Combine ( gtH, gdHp, 1.0 / SH, gSH, - tH / SH );
+
+		double dE = sqrt ( tL * tL + tC * tC + tH * tH + RT * tC * tH );
+		if ( dE <= 0.0 )
+			return;
+
+		for ( int i = 0; i < 3; i ++ )
+			grad [ i ] = ( 2 * tL * gtL [ i ] + 2 * tC * gtC [ i ] + 2 * tH * gtH [ i ] + gRT [ i ] * tC * tH + RT * ( gtC [ i ] * tH + tC * gtH [ i ] ) ) / ( 2 * dE );
+	}
+
+	// Carry a L*a*b* gradient back to XYZ, through XYZToLab
+	void LabGradientToXYZ ( const double * XYZ, const double * white, const double * gLab, double * grad )
+	{
+		const double epsilon ( 216.0 / 24389.0 );
+		const double kappa ( 24389.0 / 27.0 );
+		double df [ 3 ];
+
+		for ( int i = 0; i < 3; i ++ )
+		{
+			double v = XYZ [ i ] / white [ i ];
+			if ( v > epsilon )
+				df [ i ] = pow ( v, -2.0 / 3.0 ) / ( 3.0 * white [ i ] );
+			else
+				df [ i ] = kappa / ( 116.0 * white [ i ] );
+		}
+
+		grad [ 0 ] = 500.0 * gLab [ 1 ] * df [ 0 ];
+		grad [ 1 ] = ( 116.0 * gLab [ 0 ] - 500.0 * gLab [ 1 ] + 200.0 * gLab [ 2 ] ) * df [ 1 ];
+		grad [ 2 ] = -200.0 * gLab [ 2 ] * df [ 2 ];
+	}
+
+	// Solve A.x = b in place (x returned in b) by gaussian elimination with
+	// partial pivoting. A is n x n, row major. Returns false when singular.
+	bool SolveLinearSystem ( double * A, double * b, int n )
+	{
+		for ( int col = 0; col < n; col ++ )
+		{
+			int pivot = col;
+			for ( int row = col + 1; row < n; row ++ )
+			{
+				if ( fabs ( A [ row * n + col ] ) > fabs ( A [ pivot * n + col ] ) )
+					pivot = row;
+			}
+
+			if ( fabs ( A [ pivot * n + col ] ) < 1e-300 )
+				return false;
+
+			if ( pivot != col )
+			{
+				for ( int k = 0; k < n; k ++ )
+				{
+					double tmp = A [ col * n + k ];
+					A [ col * n + k ] = A [ pivot * n + k ];
+					A [ pivot * n + k ] = tmp;
+				}
+				double tmp = b [ col ];
+				b [ col ] = b [ pivot ];
+				b [ pivot ] = tmp;
+			}
+
+			for ( int row = col + 1; row < n; row ++ )
+			{
+				double factor = A [ row * n + col ] / A [ col * n + col ];
+				if ( factor != 0.0 )
+				{
+					for ( int k = col; k < n; k ++ )
+						A [ row * n + k ] -= factor * A [ col * n + k ];
+					b [ row ] -= factor * b [ col ];
+				}
+			}
+		}
+
+		for ( int row = n - 1; row >= 0; row -- )
+		{
+			double sum = b [ row ];
+			for ( int k = row + 1; k < n; k ++ )
+				sum -= A [ row * n + k ] * b [ k ];
+			b [ row ] = sum / A [ row * n + row ];
+		}
+		return true;
+	}
+
+	// Index in the 12 parameters of the i-th fitted parameter
+	inline int ParamIndex ( int i, int nParams )
+	{
+		return nParams == 12 ? i : ( i / 3 ) * 4 + ( i % 3 );
+	}
+}
+
+// Gauss-Newton normal equations over a range of patches. The residual
+// of a patch is sqrt(weight).dE2000. Its gradient with respect to the
+// corrected XYZ is analytic, through L*a*b*, and so is its carrying to
+// the matrix coefficients: d(XYZ[j]) / d(m[j][c]) = measured[c].
+class CMeterCorrectionJob : public CParallelJob
+{
+public:
+	CMeterCorrectionJob ( const CMeterCorrection & fit, const double * params, int nItems )
+		: m_fit ( fit ), m_params ( params ), m_JtJ ( nItems * 144, 0.0 ), m_Jtr ( nItems * 12, 0.0 ), m_cost ( nItems, 0.0 )
+	{
+	}
+
+	virtual void Run ( int nItem )
+	{
+		const int		nParams = m_fit.m_nParams;
+		const double *	white = m_fit.m_white;
+		double *		JtJ = & m_JtJ [ nItem * 144 ];
+		double *		Jtr = & m_Jtr [ nItem * 12 ];
+		int				nFirst = nItem * PATCHES_PER_ITEM;
+		int				nLast = nFirst + PATCHES_PER_ITEM;
+
+		if ( nLast > (int) m_fit.m_patches.size () )
+			nLast = (int) m_fit.m_patches.size ();
+
+		for ( int i = nFirst; i < nLast; i ++ )
+		{
+			const CMeterCorrection::Patch & patch = m_fit.m_patches [ i ];
+			double	XYZ [ 3 ], Lab [ 3 ], gLab [ 3 ], grad [ 3 ], J [ 12 ];
+			double	a [ 4 ] = { patch.measured [ 0 ], patch.measured [ 1 ], patch.measured [ 2 ], 1.0 };
+			double	sw = sqrt ( patch.weight );
+
+			ApplyParams ( m_params, patch.measured, XYZ );
+			XYZToLab ( XYZ, white, Lab );
+			double r = sw * GetDeltaE2000 ( patch.refLab [ 0 ], patch.refLab [ 1 ], patch.refLab [ 2 ], Lab [ 0 ], Lab [ 1 ], Lab [ 2 ] );
+
+			DeltaE2000Gradient ( patch.refLab, Lab, gLab );
+			LabGradientToXYZ ( XYZ, white, gLab, grad );
+			for ( int j = 0; j < 3; j ++ )
+				grad [ j ] *= sw;
+
+			for ( int k = 0; k < nParams; k ++ )
+			{
+				int p = ParamIndex ( k, nParams );
+				J [ k ] = grad [ p / 4 ] * a [ p % 4 ];
+			}
+
+			for ( int k = 0; k < nParams; k ++ )
+			{
+				Jtr [ k ] += J [ k ] * r;
+				for ( int l = k; l < nParams; l ++ )
+					JtJ [ k * nParams + l ] += J [ k ] * J [ l ];
+			}
+			m_cost [ nItem ] += r * r;
+		}
+	}
+
+	// Sum the partial results of every item
+	double Reduce ( double * JtJ, double * Jtr ) const
+	{
+		const int	nParams = m_fit.m_nParams;
+		double		cost = 0.0;
+
+		memset ( JtJ, 0, nParams * nParams * sizeof ( double ) );
+		memset ( Jtr, 0, nParams * sizeof ( double ) );
+
+		for ( size_t n = 0; n < m_cost.size (); n ++ )
+		{
+			for ( int k = 0; k < nParams; k ++ )
+			{
+				Jtr [ k ] += m_Jtr [ n * 12 + k ];
+				for ( int l = k; l < nParams; l ++ )
+					JtJ [ k * nParams + l ] += m_JtJ [ n * 144 + k * nParams + l ];
+			}
+			cost += m_cost [ n ];
+		}
+
+		for ( int k = 0; k < nParams; k ++ )
+		{
+			for ( int l = 0; l < k; l ++ )
+				JtJ [ k * nParams + l ] = JtJ [ l * nParams + k ];
+		}
+		return cost;
+	}
+
+private:
+	const CMeterCorrection &	m_fit;
+	const double *				m_params;
+	std::vector<double>			m_JtJ;
+	std::vector<double>			m_Jtr;
+	std::vector<double>			m_cost;
+};
+
+CMeterCorrection::CMeterCorrection ()
+{
+	Clear ();
+}
+
+void CMeterCorrection::Clear ()
+{
+	m_patches.clear ();
+	memset ( m_params, 0, sizeof ( m_params ) );
+	m_params [ 0 ] = m_params [ 5 ] = m_params [ 10 ] = 1.0;
+	m_white [ 0 ] = m_white [ 1 ] = m_white [ 2 ] = 1.0;
+	m_nParams = 9;
+	m_avgDeltaE = 0.0;
+	m_maxDeltaE = 0.0;
+	m_nIterations = 0;
+}
+
+void CMeterCorrection::AddPatch ( const ColorXYZ & measured, const ColorXYZ & reference, double weight )
+{
+	if ( ! measured.isValid () || ! reference.isValid () || weight <= 0.0 )
+		return;
+
+	Patch patch;
+	for ( int i = 0; i < 3; i ++ )
+	{
+		patch.measured [ i ] = measured [ i ];
+		patch.reference [ i ] = reference [ i ];
+		patch.refLab [ i ] = 0.0;
+	}
+	patch.weight = weight;
+	m_patches.push_back ( patch );
+}
+
+void CMeterCorrection::LinearFit ()
+{
+	const int	nCoefs = ( m_nParams == 12 ? 4 : 3 );
+	// Relative error weighting, floored so that black patches do not dominate
+	const double floor2 = pow ( m_white [ 1 ] * 0.01, 2.0 );
+
+	for ( int j = 0; j < 3; j ++ )
+	{
+		double	N [ 16 ], b [ 4 ];
+
+		memset ( N, 0, sizeof ( N ) );
+		memset ( b, 0, sizeof ( b ) );
+
+		for ( size_t i = 0; i < m_patches.size (); i ++ )
+		{
+			const Patch & patch = m_patches [ i ];
+			double a [ 4 ] = { patch.measured [ 0 ], patch.measured [ 1 ], patch.measured [ 2 ], 1.0 };
+			double w = patch.weight / ( patch.reference [ 1 ] * patch.reference [ 1 ] + floor2 );
+
+			for ( int k = 0; k < nCoefs; k ++ )
+			{
+				b [ k ] += w * a [ k ] * patch.reference [ j ];
+				for ( int l = 0; l < nCoefs; l ++ )
+					N [ k * nCoefs + l ] += w * a [ k ] * a [ l ];
+			}
+		}
+
+		if ( ! SolveLinearSystem ( N, b, nCoefs ) )
+			throw std::logic_error ( "Can't fit correction matrix on these patches" );
+
+		for ( int k = 0; k < 4; k ++ )
+			m_params [ j * 4 + k ] = ( k < nCoefs ? b [ k ] : 0.0 );
+	}
+}
+
+double CMeterCorrection::ComputeNormalEquations ( const double * params, double * JtJ, double * Jtr ) const
+{
+	int nItems = ( (int) m_patches.size () + PATCHES_PER_ITEM - 1 ) / PATCHES_PER_ITEM;
+	CMeterCorrectionJob job ( * this, params, nItems );
+
+	RunParallelJob ( job, nItems );
+	return job.Reduce ( JtJ, Jtr );
+}
+
+void CMeterCorrection::Fit ( const ColorXYZ & WhiteRef, bool bWithOffset, int nMaxIterations )
+{
+	m_nParams = ( bWithOffset ? 12 : 9 );
+	m_nIterations = 0;
+
+	if ( GetPatchCount () < ( bWithOffset ? 4 : 3 ) )
+		throw std::logic_error ( "Not enough patches to compute correction matrix" );
+
+	if ( ! WhiteRef.isValid () || WhiteRef [ 0 ] <= 0.0 || WhiteRef [ 1 ] <= 0.0 || WhiteRef [ 2 ] <= 0.0 )
+		throw std::logic_error ( "Invalid reference white" );
+
+	for ( int i = 0; i < 3; i ++ )
+		m_white [ i ] = WhiteRef [ i ];
+
+	for ( size_t i = 0; i < m_patches.size (); i ++ )
+		XYZToLab ( m_patches [ i ].reference, m_white, m_patches [ i ].refLab );
+
+	LinearFit ();
+
+	// Levenberg-Marquardt refinement on dE2000
+	const int	n = m_nParams;
+	double		JtJ [ 144 ], Jtr [ 12 ], A [ 144 ], delta [ 12 ];
+	double		trial [ 12 ], trialJtJ [ 144 ], trialJtr [ 12 ];
+	double		lambda = 1e-3;
+	double		cost = ComputeNormalEquations ( m_params, JtJ, Jtr );
+
+	while ( m_nIterations < nMaxIterations && cost > 0.0 )
+	{
+		m_nIterations ++;
+
+		memcpy ( A, JtJ, n * n * sizeof ( double ) );
+		for ( int k = 0; k < n; k ++ )
+		{
+			A [ k * n + k ] += lambda * ( JtJ [ k * n + k ] > 0.0 ? JtJ [ k * n + k ] : 1.0 );
+			delta [ k ] = - Jtr [ k ];
+		}
+
+		if ( SolveLinearSystem ( A, delta, n ) )
+		{
+			memcpy ( trial, m_params, sizeof ( trial ) );
+			for ( int k = 0; k < n; k ++ )
+				trial [ ParamIndex ( k, n ) ] += delta [ k ];
+
+			double trialCost = ComputeNormalEquations ( trial, trialJtJ, trialJtr );
+			if ( trialCost < cost )
+			{
+				bool bConverged = ( cost - trialCost ) < cost * 1e-6;
+
+				memcpy ( m_params, trial, sizeof ( m_params ) );
+				memcpy ( JtJ, trialJtJ, sizeof ( JtJ ) );
+				memcpy ( Jtr, trialJtr, sizeof ( Jtr ) );
+				cost = trialCost;
+
+				if ( bConverged )
+					break;
+
+				lambda = ( lambda > 1e-12 ? lambda / 10.0 : lambda );
+				continue;
+			}
+		}
+
+		lambda *= 10.0;
+		if ( lambda > 1e10 )
+			break;
+	}
+
+	UpdateStatistics ();
+}
+
+void CMeterCorrection::UpdateStatistics ()
+{
+	m_avgDeltaE = 0.0;
+	m_maxDeltaE = 0.0;
+
+	for ( size_t i = 0; i < m_patches.size (); i ++ )
+	{
+		double XYZ [ 3 ];
+
+		ApplyParams ( m_params, m_patches [ i ].measured, XYZ );
+		double dE = PatchDeltaE ( m_patches [ i ].refLab, XYZ, m_white );
+		m_avgDeltaE += dE;
+		if ( dE > m_maxDeltaE )
+			m_maxDeltaE = dE;
+	}
+
+	if ( ! m_patches.empty () )
+		m_avgDeltaE /= m_patches.size ();
+}
+
+Matrix CMeterCorrection::GetMatrix () const
+{
+	Matrix result ( 0.0, 3, 3 );
+
+	for ( int j = 0; j < 3; j ++ )
+	{
+		for ( int c = 0; c < 3; c ++ )
+			result ( j, c ) = m_params [ j * 4 + c ];
+	}
+	return result;
+}
+
+ColorXYZ CMeterCorrection::GetOffset () const
+{
+	return ColorXYZ ( m_params [ 3 ], m_params [ 7 ], m_params [ 11 ] );
+}
+
+ColorXYZ CMeterCorrection::Apply ( const ColorXYZ & measured ) const
+{
+	double in [ 3 ] = { measured [ 0 ], measured [ 1 ], measured [ 2 ] };
+	double out [ 3 ];
+
+	ApplyParams ( m_params, in, out );
+	return ColorXYZ ( out [ 0 ], out [ 1 ], out [ 2 ] );
+}
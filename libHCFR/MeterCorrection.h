@@ -0,0 +1,82 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2005-2011 Association Homecinema Francophone.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// MeterCorrection.h : multi-patch meter correction matrix fitting
+//
+// Fits the matrix that maps colorimeter readings onto reference (usually
+// spectro) readings of the same patches, from any number of patch pairs.
+// The fit starts from a weighted linear least squares solution in XYZ and
+// is then refined with Levenberg-Marquardt to minimise the weighted sum of
+// squared dE2000 in L*a*b* relative to the reference white.
+//////////////////////////////////////////////////////////////////////
+
+#if !defined(METERCORRECTION_H_INCLUDED_)
+#define METERCORRECTION_H_INCLUDED_
+
+#include "Color.h"
+#include <vector>
+
+class CMeterCorrection
+{
+public:
+	CMeterCorrection ();
+
+	void Clear ();
+
+	// Add a pair of readings of the same patch. Invalid readings are ignored.
+	void AddPatch ( const ColorXYZ & measured, const ColorXYZ & reference, double weight = 1.0 );
+	int GetPatchCount () const { return (int) m_patches.size (); }
+
+	// Compute the correction. WhiteRef is the reference white used for the
+	// L*a*b* conversion. With bWithOffset a 3x4 fit is done, adding a
+	// constant XYZ offset (meter black level) to the 3x3 matrix.
+	// Throws std::logic_error when the patches cannot define the correction.
+	void Fit ( const ColorXYZ & WhiteRef, bool bWithOffset = false, int nMaxIterations = 100 );
+
+	Matrix GetMatrix () const;
+	ColorXYZ GetOffset () const;
+	ColorXYZ Apply ( const ColorXYZ & measured ) const;
+
+	// Fit quality, in dE2000, over all patches (unweighted)
+	double GetAverageDeltaE () const { return m_avgDeltaE; }
+	double GetMaxDeltaE () const { return m_maxDeltaE; }
+	int GetIterations () const { return m_nIterations; }
+
+private:
+	struct Patch
+	{
+		double	measured [ 3 ];
+		double	reference [ 3 ];
+		double	refLab [ 3 ];
+		double	weight;
+	};
+
+	void LinearFit ();
+	double ComputeNormalEquations ( const double * params, double * JtJ, double * Jtr ) const;
+	void UpdateStatistics ();
+
+	std::vector<Patch>	m_patches;
+	double				m_white [ 3 ];
+	double				m_params [ 12 ];	// 3 rows of [ m0 m1 m2 offset ]
+	int					m_nParams;			// 9 (3x3) or 12 (3x4)
+	double				m_avgDeltaE;
+	double				m_maxDeltaE;
+	int					m_nIterations;
+
+	friend class CMeterCorrectionJob;
+};
+
+#endif // !defined(METERCORRECTION_H_INCLUDED_)
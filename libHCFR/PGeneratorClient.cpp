@@ -0,0 +1,415 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+// winsock2 has to come before anything that includes windows.h
+#include "libHCFR_Config.h"
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#   pragma comment(lib, "ws2_32")
+#else
+#   include <errno.h>
+#   include <netdb.h>
+#   include <netinet/in.h>
+#   include <netinet/tcp.h>
+#   include <arpa/inet.h>
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <unistd.h>
+#endif
+
+#include "PGeneratorClient.h"
+#include "LockWhileInScope.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef LIBHCFR_HAS_WIN32_API
+typedef int SOCKET;
+#   define INVALID_SOCKET (-1)
+#   define closesocket close
+#endif
+#ifndef MSG_NOSIGNAL
+#   define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+    const char TERMINATOR[] = "\x02\r";
+    const int REPLY_TIMEOUT_MS = 5000;
+
+    // Winsock has to be started by each user, it counts them
+    struct WinsockUser
+    {
+        WinsockUser()
+        {
+#ifdef LIBHCFR_HAS_WIN32_API
+            WSADATA data;
+            WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        }
+        ~WinsockUser()
+        {
+#ifdef LIBHCFR_HAS_WIN32_API
+            WSACleanup();
+#endif
+        }
+    };
+
+    // > 0 when the socket is readable, 0 on timeout, < 0 on error
+    int waitReadable(SOCKET s, int nTimeoutMs)
+    {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(s, &readSet);
+        struct timeval tv;
+        tv.tv_sec = nTimeoutMs / 1000;
+        tv.tv_usec = (nTimeoutMs % 1000) * 1000;
+        int nReady;
+        do
+        {
+            nReady = select((int)s + 1, &readSet, NULL, NULL, &tv);
+        }
+#ifdef LIBHCFR_HAS_WIN32_API
+        while(false);
+#else
+        while(nReady < 0 && errno == EINTR);
+#endif
+        return nReady;
+    }
+}
+
+CPGeneratorClient::CPGeneratorClient() :
+    m_nPort(DEFAULT_PORT),
+    m_socket(INVALID_SOCKET),
+    m_nPending(0),
+    m_nErrors(0)
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+}
+
+CPGeneratorClient::~CPGeneratorClient()
+{
+    Close();
+#ifdef LIBHCFR_HAS_WIN32_API
+    WSACleanup();
+#endif
+}
+
+std::string CPGeneratorClient::Discover(int nTimeoutMs, int nPort)
+{
+    WinsockUser winsock;
+    std::string address;
+
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, 0);
+    if(s == INVALID_SOCKET)
+    {
+        return address;
+    }
+    int nOn = 1;
+    setsockopt(s, SOL_SOCKET, SO_BROADCAST, (const char*)&nOn, sizeof(nOn));
+
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons((unsigned short)nPort);
+    dest.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+
+    const char request[] = "Who is a PGenerator";
+    if(sendto(s, request, (int)strlen(request), 0, (struct sockaddr*)&dest, sizeof(dest)) > 0)
+    {
+        // anything else on the port that answers is not a generator
+        while(waitReadable(s, nTimeoutMs) > 0)
+        {
+            char reply[256];
+            struct sockaddr_in from;
+            socklen_t nFromSize = sizeof(from);
+            int nRead = recvfrom(s, reply, sizeof(reply) - 1, 0, (struct sockaddr*)&from, &nFromSize);
+            if(nRead <= 0)
+            {
+                break;
+            }
+            reply[nRead] = '\0';
+            if(strstr(reply, "PGenerator") != NULL)
+            {
+                address = inet_ntoa(from.sin_addr);
+                break;
+            }
+        }
+    }
+    closesocket(s);
+    return address;
+}
+
+bool CPGeneratorClient::Connect(const char* szHost, int nPort)
+{
+    CLockWhileInScope lock(m_lock);
+
+    if(IsConnected() && m_host == szHost && m_nPort == nPort)
+    {
+        return true;
+    }
+    closeSocket();
+    m_host = szHost;
+    m_nPort = nPort;
+    m_nErrors = 0;
+    m_lastError.clear();
+    return openSocket();
+}
+
+void CPGeneratorClient::Close()
+{
+    CLockWhileInScope lock(m_lock);
+
+    if(IsConnected())
+    {
+        collectReplies(0, REPLY_TIMEOUT_MS);
+        writeCommand("QUIT");
+    }
+    closeSocket();
+    m_host.clear();
+}
+
+bool CPGeneratorClient::IsConnected() const
+{
+    return m_socket != INVALID_SOCKET;
+}
+
+bool CPGeneratorClient::Send(const char* szCommand)
+{
+    CLockWhileInScope lock(m_lock);
+    return sendCommand(szCommand);
+}
+
+bool CPGeneratorClient::Get(const char* szCommand, std::string& reply, int nTimeoutMs)
+{
+    CLockWhileInScope lock(m_lock);
+
+    reply.clear();
+    if(!sendCommand(szCommand))
+    {
+        return false;
+    }
+    // replies come in order, ours is the last one
+    if(collectReplies(1, nTimeoutMs) <= 0 || readReply(reply, nTimeoutMs) <= 0)
+    {
+        closeSocket();
+        return false;
+    }
+    --m_nPending;
+    return true;
+}
+
+bool CPGeneratorClient::WaitForReplies(int nTimeoutMs)
+{
+    CLockWhileInScope lock(m_lock);
+
+    int nResult = collectReplies(0, nTimeoutMs);
+    if(nResult < 0)
+    {
+        closeSocket();
+    }
+    return nResult > 0;
+}
+
+bool CPGeneratorClient::sendCommand(const char* szCommand)
+{
+    if(m_host.empty())
+    {
+        return false;
+    }
+
+    if(IsConnected())
+    {
+        // take the replies that are already in without waiting, a lost
+        // connection shows up here rather than on the write
+        if(collectReplies(0, 0) < 0)
+        {
+            closeSocket();
+        }
+        else if(m_nPending >= MAX_PENDING)
+        {
+            int nResult = collectReplies(MAX_PENDING - 1, REPLY_TIMEOUT_MS);
+            if(nResult == 0)
+            {
+                m_lastError = "no reply from PGenerator";
+                return false;
+            }
+            if(nResult < 0)
+            {
+                closeSocket();
+            }
+        }
+    }
+
+    for(int nTry(0); nTry < 2; ++nTry)
+    {
+        if(!IsConnected() && !openSocket())
+        {
+            return false;
+        }
+        if(writeCommand(szCommand))
+        {
+            ++m_nPending;
+            return true;
+        }
+        // the generator may have been restarted: replies to what was
+        // sent before are lost with the old connection
+        closeSocket();
+    }
+    return false;
+}
+
+bool CPGeneratorClient::openSocket()
+{
+    char szPort[16];
+    sprintf(szPort, "%d", m_nPort);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* pAddresses = NULL;
+    if(getaddrinfo(m_host.c_str(), szPort, &hints, &pAddresses) != 0)
+    {
+        return false;
+    }
+
+    SOCKET s = INVALID_SOCKET;
+    for(struct addrinfo* pAddress = pAddresses; pAddress != NULL; pAddress = pAddress->ai_next)
+    {
+        s = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+        if(s == INVALID_SOCKET)
+        {
+            continue;
+        }
+        if(connect(s, pAddress->ai_addr, (int)pAddress->ai_addrlen) == 0)
+        {
+            break;
+        }
+        closesocket(s);
+        s = INVALID_SOCKET;
+    }
+    freeaddrinfo(pAddresses);
+    if(s == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    // commands are small and sent back to back, Nagle would hold each
+    // one until the previous reply is in and undo the pipelining
+    int nOn = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&nOn, sizeof(nOn));
+    // sessions last the whole measurement, with long pauses in between
+    setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, (const char*)&nOn, sizeof(nOn));
+
+    m_socket = s;
+    m_input.clear();
+    m_nPending = 0;
+    return true;
+}
+
+void CPGeneratorClient::closeSocket()
+{
+    if(m_socket != INVALID_SOCKET)
+    {
+        closesocket((SOCKET)m_socket);
+        m_socket = INVALID_SOCKET;
+    }
+    m_input.clear();
+    m_nPending = 0;
+}
+
+bool CPGeneratorClient::writeCommand(const char* szCommand)
+{
+    std::string message(szCommand);
+    message += TERMINATOR;
+
+    const char* pData = message.c_str();
+    int nSize = (int)message.size();
+    while(nSize > 0)
+    {
+        int nWritten = send((SOCKET)m_socket, pData, nSize, MSG_NOSIGNAL);
+        if(nWritten <= 0)
+        {
+#ifndef LIBHCFR_HAS_WIN32_API
+            if(nWritten < 0 && errno == EINTR)
+            {
+                continue;
+            }
+#endif
+            return false;
+        }
+        pData += nWritten;
+        nSize -= nWritten;
+    }
+    return true;
+}
+
+int CPGeneratorClient::readReply(std::string& reply, int nTimeoutMs)
+{
+    for(;;)
+    {
+        size_t nEnd = m_input.find(TERMINATOR);
+        if(nEnd != std::string::npos)
+        {
+            reply.assign(m_input, 0, nEnd);
+            m_input.erase(0, nEnd + sizeof(TERMINATOR) - 1);
+            return 1;
+        }
+
+        int nReady = waitReadable((SOCKET)m_socket, nTimeoutMs);
+        if(nReady <= 0)
+        {
+            return nReady;
+        }
+        char buffer[1024];
+        int nRead = recv((SOCKET)m_socket, buffer, sizeof(buffer), 0);
+        if(nRead <= 0)
+        {
+            // readable with nothing to read is the generator hanging up
+            return -1;
+        }
+        m_input.append(buffer, nRead);
+    }
+}
+
+int CPGeneratorClient::collectReplies(int nLeft, int nTimeoutMs)
+{
+    while(m_nPending > nLeft)
+    {
+        std::string reply;
+        int nResult = readReply(reply, nTimeoutMs);
+        if(nResult <= 0)
+        {
+            return nResult;
+        }
+        --m_nPending;
+        checkReply(reply);
+    }
+    return 1;
+}
+
+void CPGeneratorClient::checkReply(const std::string& reply)
+{
+    if(reply.compare(0, 2, "OK") != 0)
+    {
+        ++m_nErrors;
+        m_lastError = reply;
+    }
+}
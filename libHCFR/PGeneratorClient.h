@@ -0,0 +1,103 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(PGENERATOR_CLIENT_H_INCLUDED_)
+#define PGENERATOR_CLIENT_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "CriticalSection.h"
+#include <string>
+
+// A connection to a PGenerator, the Raspberry Pi pattern generator.
+// It speaks the protocol of RB8PGenerator.dll: commands and replies are
+// strings ended by STX CR on a TCP connection, and every command gets a
+// reply, "OK" for those that only change the picture.
+// Send() does not wait for that reply: commands are pipelined and the
+// replies collected by later calls, so commands that don't gate a
+// reading cost no round trip. Before measuring a patch, wait for its
+// reply with WaitForReplies() or send it with Get().
+// Calls may come from several threads, they are serialised.
+class CPGeneratorClient
+{
+public:
+    enum
+    {
+        DEFAULT_PORT = 85,
+        DISCOVERY_PORT = 1977,
+        MAX_PENDING = 16    // Send() waits for replies past this
+    };
+
+    CPGeneratorClient();
+    ~CPGeneratorClient();
+
+    // Broadcast a discovery request and return the address of the
+    // first generator to answer, or an empty string
+    static std::string Discover(int nTimeoutMs, int nPort = DISCOVERY_PORT);
+
+    // Connecting to the host the client is already connected to does
+    // nothing
+    bool Connect(const char* szHost, int nPort = DEFAULT_PORT);
+    // Waits for pending replies and says QUIT before closing
+    void Close();
+    bool IsConnected() const;
+    const std::string& GetHost() const { return m_host; }
+
+    // Send a command without waiting for its reply. If the connection
+    // was lost it is made again and the command sent once more.
+    bool Send(const char* szCommand);
+
+    // Send a command and wait for its reply, after those of the commands
+    // sent before it
+    bool Get(const char* szCommand, std::string& reply, int nTimeoutMs = 5000);
+
+    // Wait until every command sent has been answered
+    bool WaitForReplies(int nTimeoutMs);
+
+    int GetPendingCount() const { return m_nPending; }
+    // Replies other than OK to commands sent with Send(), since Connect()
+    int GetErrorCount() const { return m_nErrors; }
+    const std::string& GetLastError() const { return m_lastError; }
+
+private:
+    CPGeneratorClient(const CPGeneratorClient&);
+    CPGeneratorClient& operator=(const CPGeneratorClient&);
+
+    bool sendCommand(const char* szCommand);
+    bool openSocket();
+    void closeSocket();
+    bool writeCommand(const char* szCommand);
+    // 1 reply read, 0 on timeout, -1 on error
+    int readReply(std::string& reply, int nTimeoutMs);
+    // Read the replies to sent commands until nLeft are pending,
+    // same results as readReply()
+    int collectReplies(int nLeft, int nTimeoutMs);
+    void checkReply(const std::string& reply);
+
+    CriticalSection m_lock;
+    std::string m_host;
+    int m_nPort;
+#ifdef LIBHCFR_HAS_WIN32_API
+    size_t m_socket;    // a SOCKET, without pulling winsock into the header
+#else
+    int m_socket;
+#endif
+    std::string m_input;
+    int m_nPending;
+    int m_nErrors;
+    std::string m_lastError;
+};
+
+#endif // !defined(PGENERATOR_CLIENT_H_INCLUDED_)
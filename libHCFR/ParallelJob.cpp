@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "ParallelJob.h"
+#include <vector>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+
+namespace
+{
+    // shared state of one RunParallelJob call, items are handed
+    // out one at a time so uneven items balance themselves
+    struct JobState
+    {
+        CParallelJob* pJob;
+        int nItems;
+        volatile long nNextItem;
+    };
+
+    long takeNextItem(JobState* pState)
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        return InterlockedIncrement(&pState->nNextItem) - 1;
+#else
+        return __sync_fetch_and_add(&pState->nNextItem, 1);
+#endif
+    }
+
+    void runItems(JobState* pState)
+    {
+        long nItem;
+        while((nItem = takeNextItem(pState)) < pState->nItems)
+        {
+            pState->pJob->Run((int)nItem);
+        }
+    }
+
+#ifdef LIBHCFR_HAS_WIN32_API
+    DWORD WINAPI jobThreadFunc(LPVOID lpParam)
+    {
+        runItems((JobState*)lpParam);
+        return 0;
+    }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    void* jobThreadFunc(void* lpParam)
+    {
+        runItems((JobState*)lpParam);
+        return NULL;
+    }
+#endif
+}
+
+int GetNumberOfProcessors()
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    return (int)sysInfo.dwNumberOfProcessors;
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    long nProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    return nProcessors > 0 ? (int)nProcessors : 1;
+#else
+    return 1;
+#endif
+}
+
+void RunParallelJob(CParallelJob& job, int nItems, int nMaxThreads)
+{
+    JobState state;
+    state.pJob = &job;
+    state.nItems = nItems;
+    state.nNextItem = 0;
+
+    int nThreads = (nMaxThreads > 0 ? nMaxThreads : GetNumberOfProcessors());
+    if(nThreads > nItems)
+    {
+        nThreads = nItems;
+    }
+
+    // the calling thread is one of the workers
+#ifdef LIBHCFR_HAS_WIN32_API
+    std::vector<HANDLE> threads;
+    for(int i(1); i < nThreads; ++i)
+    {
+        HANDLE hThread = CreateThread(NULL, 0, jobThreadFunc, &state, 0, NULL);
+        if(hThread)
+        {
+            threads.push_back(hThread);
+        }
+    }
+    runItems(&state);
+    for(size_t i(0); i < threads.size(); ++i)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#elif defined(LIBHCFR_HAS_PTHREADS)
+    std::vector<pthread_t> threads;
+    for(int i(1); i < nThreads; ++i)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, jobThreadFunc, &state) == 0)
+        {
+            threads.push_back(thread);
+        }
+    }
+    runItems(&state);
+    for(size_t i(0); i < threads.size(); ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    runItems(&state);
+#endif
+}
@@ -0,0 +1,42 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(PARALLEL_JOB_H_INCLUDED_)
+#define PARALLEL_JOB_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+
+// A job made of independent work items that can be processed
+// concurrently. Run() is called once for every item index, from
+// any of the worker threads, so it must only touch data owned by
+// that item.
+class CParallelJob
+{
+public:
+    virtual ~CParallelJob() {}
+    virtual void Run(int nItem) = 0;
+};
+
+// Number of processors available to the process
+int GetNumberOfProcessors();
+
+// Process items 0 to nItems - 1 of the job, spreading them over
+// at most nMaxThreads threads (0 means one per processor).
+// The calling thread takes part in the work and the function only
+// returns once every item has been processed.
+void RunParallelJob(CParallelJob& job, int nItems, int nMaxThreads = 0);
+
+#endif // !defined(PARALLEL_JOB_H_INCLUDED_)
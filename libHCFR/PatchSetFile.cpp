@@ -0,0 +1,800 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "PatchSetFile.h"
+#include "LockWhileInScope.h"
+#include <map>
+#include <sstream>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+namespace
+{
+    // only the first ones are worth reporting
+    const size_t MAX_ERRORS = 20;
+    // a patch set is a few hundred kilobytes at most
+    const long long MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+    // Percents a 8-bit video level can reach
+    const double MIN_PERCENT = (0 - 16) / 219. * 100.;
+    const double MAX_PERCENT = (255 - 16) / 219. * 100.;
+
+    struct Range
+    {
+        const char* begin;
+        const char* end;
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool nextLine(const char*& p, const char* pEnd, Range& line)
+    {
+        if (p >= pEnd)
+        {
+            return false;
+        }
+        const char* pNewLine = (const char*)memchr(p, '\n', pEnd - p);
+        line.begin = p;
+        line.end = pNewLine ? pNewLine : pEnd;
+        p = pNewLine ? pNewLine + 1 : pEnd;
+
+        while (line.end > line.begin && (isSpace(line.end[-1]) || line.end[-1] == '\r'))
+        {
+            line.end--;
+        }
+        while (line.begin < line.end && isSpace(*line.begin))
+        {
+            line.begin++;
+        }
+        return true;
+    }
+
+    void skipSpaces(const char*& p, const char* pEnd)
+    {
+        while (p < pEnd && isSpace(*p))
+        {
+            p++;
+        }
+    }
+
+    bool equalsNoCase(const Range& range, const char* sz)
+    {
+        size_t nLength = strlen(sz);
+        if ((size_t)(range.end - range.begin) != nLength)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < nLength; i++)
+        {
+            char c = range.begin[i];
+            if (c >= 'A' && c <= 'Z')
+            {
+                c = c - 'A' + 'a';
+            }
+            if (c != sz[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Decimal number, the data is not null terminated so strtod() can't
+    // be used on it
+    bool readNumber(const char*& p, const char* pEnd, double& value, bool& bDecimal)
+    {
+        const char* pStart = p;
+        bool bNegative = false;
+        if (p < pEnd && (*p == '+' || *p == '-'))
+        {
+            bNegative = (*p == '-');
+            p++;
+        }
+
+        double result = 0.0;
+        int nDigits = 0;
+        while (p < pEnd && isDigit(*p))
+        {
+            result = result * 10.0 + (*p++ - '0');
+            nDigits++;
+        }
+        if (p < pEnd && *p == '.')
+        {
+            p++;
+            double fraction = 0.0;
+            double scale = 1.0;
+            while (p < pEnd && isDigit(*p))
+            {
+                fraction = fraction * 10.0 + (*p++ - '0');
+                scale *= 10.0;
+                nDigits++;
+            }
+            result += fraction / scale;
+            bDecimal = true;
+        }
+        if (nDigits == 0)
+        {
+            p = pStart;
+            return false;
+        }
+
+        if (p < pEnd && (*p == 'e' || *p == 'E'))
+        {
+            const char* q = p + 1;
+            bool bNegativeExponent = false;
+            if (q < pEnd && (*q == '+' || *q == '-'))
+            {
+                bNegativeExponent = (*q == '-');
+                q++;
+            }
+            if (q < pEnd && isDigit(*q))
+            {
+                int exponent = 0;
+                while (q < pEnd && isDigit(*q) && exponent < 1000)
+                {
+                    exponent = exponent * 10 + (*q++ - '0');
+                }
+                result *= pow(10.0, bNegativeExponent ? -exponent : exponent);
+                bDecimal = true;
+                p = q;
+            }
+        }
+
+        value = bNegative ? -result : result;
+        return true;
+    }
+
+    std::string readField(const char*& p, const char* pEnd)
+    {
+        skipSpaces(p, pEnd);
+        const char* pStart = p;
+        while (p < pEnd && *p != ',')
+        {
+            p++;
+        }
+        const char* pStop = p;
+        while (pStop > pStart && isSpace(pStop[-1]))
+        {
+            pStop--;
+        }
+        if (p < pEnd)
+        {
+            p++;
+        }
+        return std::string(pStart, pStop);
+    }
+
+    // CGATS tokens are separated by spaces, strings are quoted
+    void tokenize(const Range& line, std::vector<Range>& tokens)
+    {
+        tokens.clear();
+        const char* p = line.begin;
+        while (true)
+        {
+            skipSpaces(p, line.end);
+            if (p >= line.end || *p == '#')
+            {
+                break;
+            }
+            Range token;
+            if (*p == '"')
+            {
+                token.begin = ++p;
+                while (p < line.end && *p != '"')
+                {
+                    p++;
+                }
+                token.end = p;
+                if (p < line.end)
+                {
+                    p++;
+                }
+            }
+            else
+            {
+                token.begin = p;
+                while (p < line.end && !isSpace(*p))
+                {
+                    p++;
+                }
+                token.end = p;
+            }
+            tokens.push_back(token);
+        }
+    }
+
+    const char* formatName(CPatchSetFile::Format format)
+    {
+        switch (format)
+        {
+        case CPatchSetFile::FORMAT_8BIT:
+            return "8-bit levels";
+        case CPatchSetFile::FORMAT_10BIT:
+            return "10-bit levels";
+        default:
+            return "percents";
+        }
+    }
+
+    bool fileStamp(const std::string& path, long long& size, long long& time)
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        struct _stat64 status;
+        if (_stat64(path.c_str(), &status) != 0)
+        {
+            return false;
+        }
+#else
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+        {
+            return false;
+        }
+#endif
+        size = status.st_size;
+        time = status.st_mtime;
+        return true;
+    }
+
+    bool readWholeFile(const std::string& path, std::vector<char>& data)
+    {
+        FILE* pFile = fopen(path.c_str(), "rb");
+        if (!pFile)
+        {
+            return false;
+        }
+        char buffer[65536];
+        size_t nRead;
+        while ((nRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+        {
+            data.insert(data.end(), buffer, buffer + nRead);
+        }
+        fclose(pFile);
+        return true;
+    }
+
+    struct CacheEntry
+    {
+        long long size;
+        long long time;
+        bool bOk;
+        CPatchSetFile patchSet;
+    };
+
+    CriticalSection cacheSection;
+    std::map<std::string, CacheEntry> cache;
+
+    // Entry of a file as it is on disk, NULL if it is not there any
+    // more. Must be called with cacheSection locked.
+    CacheEntry* findCurrent(const std::string& path)
+    {
+        long long size, time;
+        if (!fileStamp(path, size, time))
+        {
+            cache.erase(path);
+            return NULL;
+        }
+        std::map<std::string, CacheEntry>::iterator it = cache.find(path);
+        if (it == cache.end() || it->second.size != size || it->second.time != time)
+        {
+            CacheEntry& entry = cache[path];
+            entry.size = size;
+            entry.time = time;
+            entry.bOk = entry.patchSet.Read(path);
+            return &entry;
+        }
+        return &it->second;
+    }
+}
+
+CPatchSetFile::CPatchSetFile() :
+    m_format(FORMAT_NONE)
+{
+}
+
+void CPatchSetFile::clear()
+{
+    m_colors.clear();
+    m_names.clear();
+    m_description.clear();
+    m_format = FORMAT_NONE;
+    m_errors.clear();
+}
+
+void CPatchSetFile::addError(int line, const std::string& message)
+{
+    if (m_errors.size() < MAX_ERRORS)
+    {
+        Error error;
+        error.line = line;
+        error.message = message;
+        m_errors.push_back(error);
+    }
+}
+
+std::string CPatchSetFile::GetErrorString() const
+{
+    std::ostringstream result;
+    for (size_t i = 0; i < m_errors.size(); i++)
+    {
+        if (i > 0)
+        {
+            result << "\n";
+        }
+        if (m_errors[i].line > 0)
+        {
+            result << "line " << m_errors[i].line << ": ";
+        }
+        result << m_errors[i].message;
+    }
+    return result.str();
+}
+
+bool CPatchSetFile::Read(const std::string& path)
+{
+    clear();
+
+#ifdef LIBHCFR_HAS_WIN32_API
+    HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        addError(0, "can't open " + path);
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart > MAX_FILE_SIZE)
+    {
+        CloseHandle(hFile);
+        addError(0, "can't read " + path);
+        return false;
+    }
+    long long nSize = fileSize.QuadPart;
+    HANDLE hMapping = (nSize > 0) ? CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    const char* pData = hMapping ? (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (pData)
+    {
+        bool bOk = Parse(pData, (size_t)nSize);
+        UnmapViewOfFile(pData);
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return bOk;
+    }
+    if (hMapping)
+    {
+        CloseHandle(hMapping);
+    }
+    CloseHandle(hFile);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        addError(0, "can't open " + path);
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size > MAX_FILE_SIZE)
+    {
+        close(fd);
+        addError(0, "can't read " + path);
+        return false;
+    }
+    long long nSize = status.st_size;
+    void* pMap = (nSize > 0) ? mmap(NULL, (size_t)nSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (pMap != MAP_FAILED)
+    {
+        bool bOk = Parse((const char*)pMap, (size_t)nSize);
+        munmap(pMap, (size_t)nSize);
+        return bOk;
+    }
+#endif
+
+    // empty file, or one that can't be mapped
+    std::vector<char> data;
+    if (!readWholeFile(path, data))
+    {
+        addError(0, "can't read " + path);
+        return false;
+    }
+    return Parse(data.empty() ? "" : &data[0], data.size());
+}
+
+bool CPatchSetFile::Parse(const char* pData, size_t nSize)
+{
+    clear();
+
+    const char* p = pData;
+    const char* pEnd = pData + nSize;
+    if (nSize >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+    {
+        p += 3;
+    }
+
+    // CSV rows start with a number, CGATS files with a keyword
+    const char* q = p;
+    Range line;
+    while (nextLine(q, pEnd, line))
+    {
+        if (line.begin < line.end && *line.begin != '#' && *line.begin != ',')
+        {
+            char c = *line.begin;
+            if (!isDigit(c) && c != '+' && c != '-' && c != '.')
+            {
+                return parseCgats(p, pEnd);
+            }
+            break;
+        }
+    }
+    return parseCsv(p, pEnd);
+}
+
+bool CPatchSetFile::parseCsv(const char* p, const char* pEnd)
+{
+    Format format = FORMAT_NONE;
+    bool bDecimal = false;
+    double maxValue = 0.0;
+    std::vector<double> values;
+    std::vector<int> lines;
+    int nLine = 0;
+    Range line;
+
+    while (nextLine(p, pEnd, line))
+    {
+        nLine++;
+        if (line.begin == line.end)
+        {
+            continue;
+        }
+
+        if (*line.begin == '#')
+        {
+            std::vector<Range> words;
+            Range comment = { line.begin + 1, line.end };
+            tokenize(comment, words);
+            if (words.size() >= 1 && equalsNoCase(words[0], "format"))
+            {
+                if (words.size() == 2 && (equalsNoCase(words[1], "8bit") || equalsNoCase(words[1], "8-bit")))
+                {
+                    format = FORMAT_8BIT;
+                }
+                else if (words.size() == 2 && (equalsNoCase(words[1], "10bit") || equalsNoCase(words[1], "10-bit")))
+                {
+                    format = FORMAT_10BIT;
+                }
+                else if (words.size() == 2 && (equalsNoCase(words[1], "percent") || equalsNoCase(words[1], "%")))
+                {
+                    format = FORMAT_PERCENT;
+                }
+                else
+                {
+                    addError(nLine, "unknown format, expected 8bit, 10bit or percent");
+                }
+            }
+            continue;
+        }
+
+        // spreadsheets leave rows of empty cells
+        const char* q = line.begin;
+        while (q < line.end && (*q == ',' || isSpace(*q)))
+        {
+            q++;
+        }
+        if (q == line.end)
+        {
+            continue;
+        }
+
+        double rgb[3];
+        bool bOk = true;
+        q = line.begin;
+        for (int i = 0; i < 3 && bOk; i++)
+        {
+            skipSpaces(q, line.end);
+            bOk = readNumber(q, line.end, rgb[i], bDecimal);
+            skipSpaces(q, line.end);
+            if (bOk && q < line.end && *q == '%')
+            {
+                bDecimal = true;
+                q++;
+                skipSpaces(q, line.end);
+            }
+            if (bOk && q < line.end)
+            {
+                bOk = (*q++ == ',');
+            }
+            else if (bOk && i < 2)
+            {
+                bOk = false;
+            }
+        }
+        if (!bOk)
+        {
+            addError(nLine, "expected R,G,B values");
+            continue;
+        }
+
+        std::string name = readField(q, line.end);
+        if (m_names.empty() && values.empty())
+        {
+            m_description = readField(q, line.end);
+        }
+        m_names.push_back(name);
+        for (int i = 0; i < 3; i++)
+        {
+            values.push_back(rgb[i]);
+            if (rgb[i] > maxValue)
+            {
+                maxValue = rgb[i];
+            }
+        }
+        lines.push_back(nLine);
+    }
+
+    if (format == FORMAT_NONE)
+    {
+        if (bDecimal)
+        {
+            format = FORMAT_PERCENT;
+        }
+        else if (maxValue > 255.0)
+        {
+            format = FORMAT_10BIT;
+        }
+        else
+        {
+            format = FORMAT_8BIT;
+        }
+    }
+
+    double black, range, minValue, maxAllowed;
+    switch (format)
+    {
+    case FORMAT_8BIT:
+        black = 16.0;
+        range = 219.0;
+        minValue = 0.0;
+        maxAllowed = 255.0;
+        break;
+    case FORMAT_10BIT:
+        black = 64.0;
+        range = 876.0;
+        minValue = 0.0;
+        maxAllowed = 1023.0;
+        break;
+    default:
+        black = 0.0;
+        range = 100.0;
+        minValue = MIN_PERCENT;
+        maxAllowed = MAX_PERCENT;
+        break;
+    }
+
+    m_colors.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        const double* rgb = &values[i * 3];
+        if (rgb[0] < minValue || rgb[0] > maxAllowed
+            || rgb[1] < minValue || rgb[1] > maxAllowed
+            || rgb[2] < minValue || rgb[2] > maxAllowed)
+        {
+            addError(lines[i], std::string("value out of range for ") + formatName(format));
+        }
+        m_colors.push_back(ColorRGBDisplay((rgb[0] - black) / range * 100.,
+                                           (rgb[1] - black) / range * 100.,
+                                           (rgb[2] - black) / range * 100.));
+    }
+    m_format = format;
+
+    if (!m_errors.empty())
+    {
+        m_colors.clear();
+        m_names.clear();
+        return false;
+    }
+    return true;
+}
+
+bool CPatchSetFile::parseCgats(const char* p, const char* pEnd)
+{
+    enum { HEADER, DATA_FORMAT, DATA, DONE } state = HEADER;
+    std::vector<std::string> fields;
+    int redField = -1, greenField = -1, blueField = -1, nameField = -1, idField = -1;
+    std::vector<Range> tokens;
+    int nLine = 0;
+    Range line;
+
+    m_format = FORMAT_CGATS;
+    while (state != DONE && nextLine(p, pEnd, line))
+    {
+        nLine++;
+        tokenize(line, tokens);
+        if (tokens.empty())
+        {
+            continue;
+        }
+
+        if (state == HEADER)
+        {
+            if (equalsNoCase(tokens[0], "begin_data_format"))
+            {
+                state = DATA_FORMAT;
+                tokens.erase(tokens.begin());
+            }
+            else if (equalsNoCase(tokens[0], "begin_data"))
+            {
+                if (redField < 0 || greenField < 0 || blueField < 0)
+                {
+                    addError(nLine, "no RGB_R, RGB_G and RGB_B fields before the data");
+                    break;
+                }
+                state = DATA;
+                continue;
+            }
+            else
+            {
+                if (equalsNoCase(tokens[0], "descriptor") && tokens.size() > 1)
+                {
+                    m_description.assign(tokens[1].begin, tokens[1].end);
+                }
+                continue;
+            }
+        }
+
+        if (state == DATA_FORMAT)
+        {
+            for (size_t i = 0; i < tokens.size() && state == DATA_FORMAT; i++)
+            {
+                if (equalsNoCase(tokens[i], "end_data_format"))
+                {
+                    state = HEADER;
+                    break;
+                }
+                int nField = (int)fields.size();
+                if (equalsNoCase(tokens[i], "rgb_r"))
+                {
+                    redField = nField;
+                }
+                else if (equalsNoCase(tokens[i], "rgb_g"))
+                {
+                    greenField = nField;
+                }
+                else if (equalsNoCase(tokens[i], "rgb_b"))
+                {
+                    blueField = nField;
+                }
+                else if (equalsNoCase(tokens[i], "sample_name"))
+                {
+                    nameField = nField;
+                }
+                else if (equalsNoCase(tokens[i], "sample_id"))
+                {
+                    idField = nField;
+                }
+                fields.push_back(std::string(tokens[i].begin, tokens[i].end));
+            }
+            continue;
+        }
+
+        // data
+        if (equalsNoCase(tokens[0], "end_data"))
+        {
+            state = DONE;
+            continue;
+        }
+        if (tokens.size() != fields.size())
+        {
+            std::ostringstream message;
+            message << "expected " << fields.size() << " values, found " << tokens.size();
+            addError(nLine, message.str());
+            continue;
+        }
+
+        double rgb[3];
+        int rgbFields[3] = { redField, greenField, blueField };
+        bool bOk = true;
+        for (int i = 0; i < 3 && bOk; i++)
+        {
+            const Range& token = tokens[rgbFields[i]];
+            const char* q = token.begin;
+            bool bDecimal = false;
+            bOk = readNumber(q, token.end, rgb[i], bDecimal) && q == token.end;
+        }
+        if (!bOk)
+        {
+            addError(nLine, "RGB value is not a number");
+            continue;
+        }
+        if (rgb[0] < MIN_PERCENT || rgb[0] > MAX_PERCENT
+            || rgb[1] < MIN_PERCENT || rgb[1] > MAX_PERCENT
+            || rgb[2] < MIN_PERCENT || rgb[2] > MAX_PERCENT)
+        {
+            addError(nLine, "value out of range for percents");
+            continue;
+        }
+
+        int nNameField = (nameField >= 0) ? nameField : idField;
+        m_names.push_back(nNameField >= 0 ? std::string(tokens[nNameField].begin, tokens[nNameField].end) : std::string());
+        m_colors.push_back(ColorRGBDisplay(rgb[0], rgb[1], rgb[2]));
+    }
+
+    if (m_errors.empty() && state != DONE && state != DATA)
+    {
+        addError(0, "no CGATS data");
+    }
+    if (!m_errors.empty())
+    {
+        m_colors.clear();
+        m_names.clear();
+        return false;
+    }
+    return true;
+}
+
+bool CPatchSetFile::ReadCached(const std::string& path, CPatchSetFile& patchSet)
+{
+    CLockWhileInScope lock(cacheSection);
+    CacheEntry* pEntry = findCurrent(path);
+    if (!pEntry)
+    {
+        patchSet.clear();
+        patchSet.addError(0, "can't open " + path);
+        return false;
+    }
+    patchSet = pEntry->patchSet;
+    return pEntry->bOk;
+}
+
+int CPatchSetFile::ReadCachedColors(const std::string& path, ColorRGBDisplay* colors, int maxEntries)
+{
+    CLockWhileInScope lock(cacheSection);
+    CacheEntry* pEntry = findCurrent(path);
+    if (!pEntry || !pEntry->bOk)
+    {
+        return -1;
+    }
+    const std::vector<ColorRGBDisplay>& cachedColors = pEntry->patchSet.GetColors();
+    int nColors = (int)cachedColors.size() < maxEntries ? (int)cachedColors.size() : maxEntries;
+    for (int i = 0; i < nColors; i++)
+    {
+        colors[i] = cachedColors[i];
+    }
+    return nColors;
+}
+
+void CPatchSetFile::ClearCache()
+{
+    CLockWhileInScope lock(cacheSection);
+    cache.clear();
+}
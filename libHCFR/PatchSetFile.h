@@ -0,0 +1,92 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(PATCH_SET_FILE_H_INCLUDED_)
+#define PATCH_SET_FILE_H_INCLUDED_
+
+#include "Color.h"
+#include <string>
+#include <vector>
+
+// Patch set read from a user file, usercolors.csv or one of the pattern
+// files of the color checker modes.
+//
+// CSV rows are "R,G,B[,name[,description]]", the description is only
+// taken from the first row. Values are 8-bit video levels (16-235),
+// 10-bit video levels (64-940) or percents. A "# format 8bit", "10bit"
+// or "percent" comment line sets the format, without it values with a
+// decimal point or a % sign are percents and values above 255 are 10-bit
+// levels. CGATS files, like Argyll .ti1 files, give the patches in
+// percent in the RGB_R, RGB_G and RGB_B fields, the names come from
+// SAMPLE_NAME or SAMPLE_ID.
+//
+// A row that can't be read fails the whole file, skipping it would shift
+// every patch after it. The errors are kept with their line numbers.
+class CPatchSetFile
+{
+public:
+    enum Format
+    {
+        FORMAT_NONE,
+        FORMAT_8BIT,
+        FORMAT_10BIT,
+        FORMAT_PERCENT,
+        FORMAT_CGATS
+    };
+
+    struct Error
+    {
+        int line;           // 0 when not about a line
+        std::string message;
+    };
+
+    CPatchSetFile();
+
+    bool Read(const std::string& path);
+    bool Parse(const char* pData, size_t nSize);
+
+    // Colors in percent of the video range, like GenerateCC24Colors() gives
+    int GetSize() const { return (int)m_colors.size(); }
+    const std::vector<ColorRGBDisplay>& GetColors() const { return m_colors; }
+    const std::string& GetName(int i) const { return m_names[i]; }
+    const std::string& GetDescription() const { return m_description; }
+    Format GetFormat() const { return m_format; }
+
+    const std::vector<Error>& GetErrors() const { return m_errors; }
+    // The first errors, one per line
+    std::string GetErrorString() const;
+
+    // Files are parsed once and kept until they change on disk, the
+    // same as Read() otherwise
+    static bool ReadCached(const std::string& path, CPatchSetFile& patchSet);
+    // Colors of the cached file, at most maxEntries, -1 if it can't be read
+    static int ReadCachedColors(const std::string& path, ColorRGBDisplay* colors, int maxEntries);
+    static void ClearCache();
+
+private:
+    void clear();
+    void addError(int line, const std::string& message);
+    bool parseCsv(const char* p, const char* pEnd);
+    bool parseCgats(const char* p, const char* pEnd);
+
+    std::vector<ColorRGBDisplay> m_colors;
+    std::vector<std::string> m_names;
+    std::string m_description;
+    Format m_format;
+    std::vector<Error> m_errors;
+};
+
+#endif // !defined(PATCH_SET_FILE_H_INCLUDED_)
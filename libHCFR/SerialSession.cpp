@@ -0,0 +1,394 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "SerialSession.h"
+#include <string.h>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#else
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <termios.h>
+#   include <unistd.h>
+#endif
+
+CSerialSession::CSerialSession() :
+    m_nBaudRate(0),
+#ifdef LIBHCFR_HAS_WIN32_API
+    m_hPort(INVALID_HANDLE_VALUE),
+    m_nPortTimeoutMs(-1),
+#else
+    m_fd(-1),
+#endif
+    m_nBufferStart(0),
+    m_nBufferEnd(0)
+{
+}
+
+CSerialSession::~CSerialSession()
+{
+    Close();
+}
+
+bool CSerialSession::Open(const char* szPortName, int nBaudRate)
+{
+    if(IsOpen() && m_portName == szPortName && m_nBaudRate == nBaudRate)
+    {
+        return true;
+    }
+    Close();
+    m_portName = szPortName;
+    m_nBaudRate = nBaudRate;
+    return openPort();
+}
+
+void CSerialSession::Close()
+{
+    closePort();
+}
+
+void CSerialSession::Flush()
+{
+    m_nBufferStart = m_nBufferEnd = 0;
+    if(!IsOpen())
+    {
+        return;
+    }
+#ifdef LIBHCFR_HAS_WIN32_API
+    PurgeComm(m_hPort, PURGE_RXCLEAR);
+#else
+    tcflush(m_fd, TCIFLUSH);
+#endif
+}
+
+bool CSerialSession::Write(const unsigned char* pData, int nSize)
+{
+    return IsOpen() && writeAll(pData, nSize);
+}
+
+CSerialSession::ReadResult CSerialSession::ReadFrame(char* pReply, int nReplySize, char cTerminator, int nTimeoutMs)
+{
+    int nLength = 0;
+    pReply[0] = '\0';
+
+    if(!IsOpen())
+    {
+        return READ_ERROR;
+    }
+
+    for(;;)
+    {
+        // take what the last block brought in first
+        while(m_nBufferStart < m_nBufferEnd)
+        {
+            char c = (char)m_buffer[m_nBufferStart++];
+            if(c == cTerminator)
+            {
+                pReply[nLength] = '\0';
+                return READ_OK;
+            }
+            if(nLength == nReplySize - 1)
+            {
+                pReply[nLength] = '\0';
+                return READ_OVERFLOW;
+            }
+            pReply[nLength++] = c;
+        }
+
+        int nRead = readSome(m_buffer, sizeof(m_buffer), nTimeoutMs);
+        if(nRead <= 0)
+        {
+            pReply[nLength] = '\0';
+            return nRead == 0 ? READ_TIMEOUT : READ_ERROR;
+        }
+        m_nBufferStart = 0;
+        m_nBufferEnd = nRead;
+    }
+}
+
+CSerialSession::ReadResult CSerialSession::Transact(const unsigned char* pCommand, int nCommandSize, char* pReply, int nReplySize, char cTerminator, int nTimeoutMs)
+{
+    pReply[0] = '\0';
+
+    if(!IsOpen() && !openPort())
+    {
+        return READ_ERROR;
+    }
+
+    for(int nTry(0); ; ++nTry)
+    {
+        // a reply left over from a timed out command must not be
+        // taken for the answer to this one
+        Flush();
+
+        ReadResult result = READ_ERROR;
+        if(writeAll(pCommand, nCommandSize))
+        {
+            result = ReadFrame(pReply, nReplySize, cTerminator, nTimeoutMs);
+        }
+        if(result != READ_ERROR || nTry > 0 || !reopenPort())
+        {
+            return result;
+        }
+    }
+}
+
+bool CSerialSession::reopenPort()
+{
+    closePort();
+    return openPort();
+}
+
+#ifdef LIBHCFR_HAS_WIN32_API
+
+bool CSerialSession::IsOpen() const
+{
+    return m_hPort != INVALID_HANDLE_VALUE;
+}
+
+bool CSerialSession::openPort()
+{
+    // the device namespace prefix is needed for COM10 and above
+    std::string path(m_portName);
+    if(path.compare(0, 4, "\\\\.\\") != 0)
+    {
+        path = "\\\\.\\" + path;
+    }
+
+    HANDLE hPort = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if(hPort == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    DCB dcb;
+    memset(&dcb, 0, sizeof(dcb));
+    dcb.DCBlength = sizeof(dcb);
+    if(!GetCommState(hPort, &dcb))
+    {
+        CloseHandle(hPort);
+        return false;
+    }
+    dcb.BaudRate = m_nBaudRate;
+    dcb.ByteSize = 8;
+    dcb.fBinary = TRUE;
+    dcb.fParity = FALSE;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    if(!SetCommState(hPort, &dcb))
+    {
+        CloseHandle(hPort);
+        return false;
+    }
+
+    m_hPort = hPort;
+    m_nPortTimeoutMs = -1;
+    m_nBufferStart = m_nBufferEnd = 0;
+    PurgeComm(m_hPort, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    return true;
+}
+
+void CSerialSession::closePort()
+{
+    if(m_hPort != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hPort);
+        m_hPort = INVALID_HANDLE_VALUE;
+    }
+    m_nBufferStart = m_nBufferEnd = 0;
+}
+
+bool CSerialSession::writeAll(const unsigned char* pData, int nSize)
+{
+    while(nSize > 0)
+    {
+        DWORD dwWritten = 0;
+        if(!WriteFile(m_hPort, pData, nSize, &dwWritten, NULL) || dwWritten == 0)
+        {
+            return false;
+        }
+        pData += dwWritten;
+        nSize -= dwWritten;
+    }
+    return true;
+}
+
+int CSerialSession::readSome(unsigned char* pBuffer, int nSize, int nTimeoutMs)
+{
+    // With both interval and multiplier at MAXDWORD, ReadFile returns as
+    // soon as anything is available, or after the constant timeout.
+    // The timeouts only need setting again when the caller changes them.
+    if(nTimeoutMs != m_nPortTimeoutMs)
+    {
+        COMMTIMEOUTS timeouts;
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = nTimeoutMs > 0 ? nTimeoutMs : 1;
+        timeouts.WriteTotalTimeoutMultiplier = 0;
+        timeouts.WriteTotalTimeoutConstant = 0;
+        if(!SetCommTimeouts(m_hPort, &timeouts))
+        {
+            return -1;
+        }
+        m_nPortTimeoutMs = nTimeoutMs;
+    }
+
+    DWORD dwRead = 0;
+    if(!ReadFile(m_hPort, pBuffer, nSize, &dwRead, NULL))
+    {
+        return -1;
+    }
+    return (int)dwRead;
+}
+
+#else
+
+namespace
+{
+    speed_t baudRateToSpeed(int nBaudRate)
+    {
+        switch(nBaudRate)
+        {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        default: return B115200;
+        }
+    }
+}
+
+bool CSerialSession::IsOpen() const
+{
+    return m_fd != -1;
+}
+
+bool CSerialSession::openPort()
+{
+    int fd = open(m_portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(fd == -1)
+    {
+        return false;
+    }
+
+    // raw 8N1, no flow control, reads never block: waiting is done with poll()
+    struct termios tio;
+    if(tcgetattr(fd, &tio) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+#ifdef CRTSCTS
+    tio.c_cflag &= ~CRTSCTS;
+#endif
+    tio.c_cflag |= CS8 | CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, baudRateToSpeed(m_nBaudRate));
+    cfsetospeed(&tio, baudRateToSpeed(m_nBaudRate));
+    if(tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_nBufferStart = m_nBufferEnd = 0;
+    tcflush(m_fd, TCIOFLUSH);
+    return true;
+}
+
+void CSerialSession::closePort()
+{
+    if(m_fd != -1)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_nBufferStart = m_nBufferEnd = 0;
+}
+
+bool CSerialSession::writeAll(const unsigned char* pData, int nSize)
+{
+    while(nSize > 0)
+    {
+        ssize_t nWritten = write(m_fd, pData, nSize);
+        if(nWritten < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            if(errno != EAGAIN)
+            {
+                return false;
+            }
+            struct pollfd pfd = { m_fd, POLLOUT, 0 };
+            if(poll(&pfd, 1, 1000) <= 0)
+            {
+                return false;
+            }
+            continue;
+        }
+        pData += nWritten;
+        nSize -= (int)nWritten;
+    }
+    return true;
+}
+
+int CSerialSession::readSome(unsigned char* pBuffer, int nSize, int nTimeoutMs)
+{
+    for(;;)
+    {
+        struct pollfd pfd = { m_fd, POLLIN, 0 };
+        int nReady = poll(&pfd, 1, nTimeoutMs);
+        if(nReady < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if(nReady == 0)
+        {
+            return 0;
+        }
+        if(!(pfd.revents & POLLIN))
+        {
+            // hang up or error without pending data
+            return -1;
+        }
+
+        ssize_t nRead = read(m_fd, pBuffer, nSize);
+        if(nRead > 0)
+        {
+            return (int)nRead;
+        }
+        if(nRead == 0 || (errno != EINTR && errno != EAGAIN))
+        {
+            return -1;
+        }
+    }
+}
+
+#endif
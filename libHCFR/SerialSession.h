@@ -0,0 +1,88 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(SERIAL_SESSION_H_INCLUDED_)
+#define SERIAL_SESSION_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include <string>
+
+// A serial port kept open between transactions with a device that
+// answers each command with a single terminated line.
+// Incoming data is read by blocks into an internal buffer, replies
+// are cut out of it at the terminator.
+// The Win32 backend uses the comm API, the other one uses termios
+// with the same raw settings as Argyll's icoms_ux.
+class CSerialSession
+{
+public:
+    enum ReadResult
+    {
+        READ_OK,
+        READ_TIMEOUT,
+        READ_OVERFLOW,  // reply did not fit, truncated
+        READ_ERROR
+    };
+
+    CSerialSession();
+    ~CSerialSession();
+
+    // 8 bits, no parity, one stop bit. Opening the port the session
+    // already has open does nothing.
+    bool Open(const char* szPortName, int nBaudRate);
+    void Close();
+    bool IsOpen() const;
+    const std::string& GetPortName() const { return m_portName; }
+
+    // Drop whatever the device sent and has not been read yet
+    void Flush();
+    bool Write(const unsigned char* pData, int nSize);
+
+    // Read one reply, up to the terminator which is not stored.
+    // The reply is always nul terminated. nTimeoutMs is the longest
+    // wait for the next block of data, not for the whole reply.
+    ReadResult ReadFrame(char* pReply, int nReplySize, char cTerminator, int nTimeoutMs);
+
+    // Send a command and read its reply. On an I/O error the port is
+    // reopened and the command sent once more, so an unplugged and
+    // replugged device does not need a new session.
+    ReadResult Transact(const unsigned char* pCommand, int nCommandSize, char* pReply, int nReplySize, char cTerminator, int nTimeoutMs);
+
+private:
+    CSerialSession(const CSerialSession&);
+    CSerialSession& operator=(const CSerialSession&);
+
+    bool openPort();
+    void closePort();
+    bool reopenPort();
+    bool writeAll(const unsigned char* pData, int nSize);
+    // > 0 bytes read, 0 on timeout, < 0 on error
+    int readSome(unsigned char* pBuffer, int nSize, int nTimeoutMs);
+
+    std::string m_portName;
+    int m_nBaudRate;
+#ifdef LIBHCFR_HAS_WIN32_API
+    void* m_hPort;
+    int m_nPortTimeoutMs;
+#else
+    int m_fd;
+#endif
+    unsigned char m_buffer[512];
+    int m_nBufferStart;
+    int m_nBufferEnd;
+};
+
+#endif // !defined(SERIAL_SESSION_H_INCLUDED_)
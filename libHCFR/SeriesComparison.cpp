@@ -0,0 +1,249 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "SeriesComparison.h"
+#include "ParallelJob.h"
+#include <string.h>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    double averageColorTemp(const std::vector<ColorXYZ>& colors, int nSeries, const CColorReference& colorReference)
+    {
+        double sum = 0.0;
+        int count = 0;
+
+        // skip black, where colour temperature is meaningless
+        for (size_t i = (nSeries == COMPARE_GRAYSCALE ? 1 : 0); i < colors.size(); i++)
+        {
+            if (colors[i].isValid())
+            {
+                int colorTemp = colors[i].GetColorTemp(colorReference);
+                if (colorTemp > 0)
+                {
+                    sum += colorTemp;
+                    count++;
+                }
+            }
+        }
+        return count ? sum / count : 0.0;
+    }
+
+    // set names may hold the separator or quotes
+    void writeName(std::ostream& out, const std::string& name)
+    {
+        out << '"';
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            if (name[i] == '"')
+            {
+                out << '"';
+            }
+            out << name[i];
+        }
+        out << '"';
+    }
+
+    class CSeriesComparisonJob : public CParallelJob
+    {
+    public:
+        CSeriesComparisonJob(const std::vector<ComparedMeasures>& sets, int nReference,
+                             const CColorReference& colorReference, int dE_form, int gw_Weight,
+                             std::vector<SeriesComparisonResult>& results) :
+            m_sets(sets),
+            m_nReference(nReference),
+            m_colorReference(colorReference),
+            m_dE_form(dE_form),
+            m_gw_Weight(gw_Weight),
+            m_results(results)
+        {
+        }
+
+        virtual void Run(int nItem)
+        {
+            SeriesComparisonResult& result = m_results[nItem];
+            const ComparedMeasures& measures = m_sets[result.nSet];
+            const ComparedMeasures& reference = m_sets[m_nReference];
+            int nSeries = result.nSeries;
+            const std::vector<ColorXYZ>& colors = measures.series[nSeries];
+            const std::vector<ColorXYZ>& refColors = reference.series[nSeries];
+            bool isGS = (nSeries <= COMPARE_NEARWHITE);
+            bool bCompare = (result.nSet != m_nReference && colors.size() == refColors.size());
+            double whiteY = isGS ? measures.grayWhiteY : measures.colorWhiteY;
+            double refWhiteY = isGS ? reference.grayWhiteY : reference.colorWhiteY;
+
+            if (nSeries == COMPARE_GRAYSCALE && measures.bIREScaleMode != reference.bIREScaleMode)
+            {
+                bCompare = false;
+            }
+
+            for (size_t i = 0; i < colors.size(); i++)
+            {
+                if (!colors[i].isValid())
+                {
+                    continue;
+                }
+                result.nPatches++;
+
+                if (bCompare && refColors[i].isValid())
+                {
+                    double dE = colors[i].GetDeltaE(whiteY, refColors[i], refWhiteY, m_colorReference, m_dE_form, isGS, m_gw_Weight);
+                    result.dEAvg += dE;
+                    if (dE > result.dEMax)
+                    {
+                        result.dEMax = dE;
+                    }
+                    result.nCompared++;
+                }
+            }
+            if (result.nCompared)
+            {
+                result.dEAvg /= result.nCompared;
+            }
+
+            if (nSeries == COMPARE_GRAYSCALE)
+            {
+                result.gamma = measures.gamma;
+                if (result.nSet != m_nReference && measures.gamma > 0.0 && reference.gamma > 0.0)
+                {
+                    result.dGamma = measures.gamma - reference.gamma;
+                }
+            }
+
+            if (nSeries == COMPARE_GRAYSCALE || nSeries == COMPARE_NEARWHITE)
+            {
+                result.colorTemp = averageColorTemp(colors, nSeries, m_colorReference);
+                if (result.nSet != m_nReference && result.colorTemp > 0.0)
+                {
+                    double refColorTemp = averageColorTemp(refColors, nSeries, m_colorReference);
+                    if (refColorTemp > 0.0)
+                    {
+                        result.dColorTemp = result.colorTemp - refColorTemp;
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<ComparedMeasures>& m_sets;
+        int m_nReference;
+        const CColorReference& m_colorReference;
+        int m_dE_form;
+        int m_gw_Weight;
+        std::vector<SeriesComparisonResult>& m_results;
+    };
+}
+
+ComparedMeasures::ComparedMeasures() :
+    bIREScaleMode(false),
+    grayWhiteY(0.0),
+    colorWhiteY(0.0),
+    gamma(0.0)
+{
+}
+
+CSeriesComparison::CSeriesComparison(const CColorReference& colorReference, int dE_form, int gw_Weight) :
+    m_colorReference(colorReference),
+    m_dE_form(dE_form),
+    m_gw_Weight(gw_Weight),
+    m_nReference(0)
+{
+}
+
+void CSeriesComparison::RemoveAll()
+{
+    m_sets.clear();
+    m_results.clear();
+    m_nReference = 0;
+}
+
+int CSeriesComparison::Add(const ComparedMeasures& measures)
+{
+    m_sets.push_back(measures);
+    return (int)m_sets.size() - 1;
+}
+
+void CSeriesComparison::Compute(int nReference, int nMaxThreads)
+{
+    m_results.clear();
+    if (m_sets.empty())
+    {
+        return;
+    }
+    m_nReference = (nReference >= 0 && nReference < GetCount()) ? nReference : 0;
+
+    SeriesComparisonResult empty;
+    memset(&empty, 0, sizeof(empty));
+    m_results.resize(m_sets.size() * COMPARE_SERIES_COUNT, empty);
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        m_results[i].nSet = (int)i / COMPARE_SERIES_COUNT;
+        m_results[i].nSeries = (int)i % COMPARE_SERIES_COUNT;
+    }
+
+    CSeriesComparisonJob job(m_sets, m_nReference, m_colorReference, m_dE_form, m_gw_Weight, m_results);
+    RunParallelJob(job, (int)m_results.size(), nMaxThreads);
+}
+
+const SeriesComparisonResult* CSeriesComparison::GetResult(int nSet, int nSeries) const
+{
+    if (nSeries < 0 || nSeries >= COMPARE_SERIES_COUNT || nSet < 0 || nSet >= (int)(m_results.size() / COMPARE_SERIES_COUNT))
+    {
+        return NULL;
+    }
+    return &m_results[nSet * COMPARE_SERIES_COUNT + nSeries];
+}
+
+const char* CSeriesComparison::GetSeriesName(int nSeries)
+{
+    static const char* names[COMPARE_SERIES_COUNT] =
+    {
+        "Grayscale", "Near black", "Near white", "Primaries", "Secondaries",
+        "Red saturation", "Green saturation", "Blue saturation",
+        "Yellow saturation", "Cyan saturation", "Magenta saturation"
+    };
+
+    return (nSeries >= 0 && nSeries < COMPARE_SERIES_COUNT) ? names[nSeries] : "";
+}
+
+void CSeriesComparison::WriteTable(std::ostream& out, char cSeparator) const
+{
+    const char s = cSeparator;
+
+    out << "Document" << s << "Series" << s << "Patches" << s << "Compared" << s
+        << "dE avg" << s << "dE max" << s << "Gamma" << s << "ColorTemp" << s
+        << "dGamma" << s << "dColorTemp\n";
+
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const SeriesComparisonResult& result = m_results[i];
+        if (result.nPatches == 0)
+        {
+            continue;
+        }
+
+        std::ostringstream line;
+        line << std::fixed;
+        writeName(line, m_sets[result.nSet].name + (result.nSet == m_nReference ? " (reference)" : ""));
+        line << s << GetSeriesName(result.nSeries) << s << result.nPatches << s << result.nCompared;
+        line << std::setprecision(4) << s << result.dEAvg << s << result.dEMax << s << result.gamma;
+        line << std::setprecision(0) << s << result.colorTemp;
+        line << std::setprecision(4) << s << result.dGamma;
+        line << std::setprecision(0) << s << result.dColorTemp << '\n';
+        out << line.str();
+    }
+}
@@ -0,0 +1,112 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(SERIES_COMPARISON_H_INCLUDED_)
+#define SERIES_COMPARISON_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include "Color.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum ComparedSeries
+{
+    COMPARE_GRAYSCALE = 0,
+    COMPARE_NEARBLACK,
+    COMPARE_NEARWHITE,
+    COMPARE_PRIMARIES,
+    COMPARE_SECONDARIES,
+    COMPARE_REDSAT,
+    COMPARE_GREENSAT,
+    COMPARE_BLUESAT,
+    COMPARE_YELLOWSAT,
+    COMPARE_CYANSAT,
+    COMPARE_MAGENTASAT,
+    COMPARE_SERIES_COUNT
+};
+
+// One set of measures, such as a document, as the comparison sees it.
+// Invalid colours are patches that were not measured.
+struct ComparedMeasures
+{
+    ComparedMeasures();
+
+    std::string name;
+    std::vector<ColorXYZ> series[COMPARE_SERIES_COUNT];
+    // Gray levels in IRE do not line up with gray levels in steps
+    bool bIREScaleMode;
+    // Luminance of white that delta E is relative to, for the gray
+    // series and for the colours
+    double grayWhiteY;
+    double colorWhiteY;
+    // Average gamma of the grayscale, from the caller's gamma fit,
+    // 0 when there is none
+    double gamma;
+};
+
+// Statistics of one series of one set of measures
+struct SeriesComparisonResult
+{
+    int nSet;
+    int nSeries;
+    int nPatches;       // valid patches in the series
+    int nCompared;      // patches compared with the reference set
+    double dEAvg;       // against the same patches of the reference set
+    double dEMax;
+    double gamma;       // grayscale only, 0 elsewhere
+    double colorTemp;   // average, grayscale and near white only, 0 elsewhere
+    double dGamma;      // difference with the reference set
+    double dColorTemp;
+};
+
+// Compares any number of measure sets against one of them, series by
+// series. Every (set, series) pair is an independent work item, they are
+// processed on all processors through RunParallelJob.
+class CSeriesComparison
+{
+public:
+    CSeriesComparison(const CColorReference& colorReference, int dE_form, int gw_Weight);
+
+    void RemoveAll();
+    // Returns the index of the set
+    int Add(const ComparedMeasures& measures);
+    int GetCount() const { return (int)m_sets.size(); }
+    const ComparedMeasures& GetMeasures(int nSet) const { return m_sets[nSet]; }
+
+    // Compare every set against nReference
+    void Compute(int nReference = 0, int nMaxThreads = 0);
+    int GetReference() const { return m_nReference; }
+
+    const std::vector<SeriesComparisonResult>& GetResults() const { return m_results; }
+    // NULL when out of range or not computed
+    const SeriesComparisonResult* GetResult(int nSet, int nSeries) const;
+
+    static const char* GetSeriesName(int nSeries);
+
+    // All results as one table, a row per set and series with patches
+    void WriteTable(std::ostream& out, char cSeparator = ',') const;
+
+private:
+    CColorReference m_colorReference;
+    int m_dE_form;
+    int m_gw_Weight;
+    std::vector<ComparedMeasures> m_sets;
+    std::vector<SeriesComparisonResult> m_results;
+    int m_nReference;
+};
+
+#endif // !defined(SERIES_COMPARISON_H_INCLUDED_)
@@ -0,0 +1,223 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#include "TraceLog.h"
+#include "CriticalSection.h"
+#include "LockWhileInScope.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#ifdef LIBHCFR_HAS_WIN32_API
+#   include <windows.h>
+#elif defined(LIBHCFR_HAS_PTHREADS)
+#   include <pthread.h>
+#   include <time.h>
+#endif
+
+bool CTraceLog::m_bEnabled = false;
+
+namespace
+{
+    // a long run records a few spans per patch, this is hours of them
+    const size_t MAX_EVENTS = 1000000;
+
+    struct TraceEvent
+    {
+        const char* szName;
+        const char* szCategory;
+        double startUs;
+        double durationUs;
+        unsigned long threadId;
+    };
+
+    struct SpanTotals
+    {
+        SpanTotals() : nCount(0), totalUs(0.0), maxUs(0.0) {}
+        int nCount;
+        double totalUs;
+        double maxUs;
+    };
+
+    CriticalSection traceSection;
+    std::vector<TraceEvent> traceEvents;
+    size_t nDroppedEvents = 0;
+    double traceStartUs = 0.0;
+
+    unsigned long currentThreadId()
+    {
+#ifdef LIBHCFR_HAS_WIN32_API
+        return GetCurrentThreadId();
+#else
+        return (unsigned long)pthread_self();
+#endif
+    }
+
+    void writeJsonString(std::ostream& out, const char* sz)
+    {
+        out << '"';
+        for (; *sz; sz++)
+        {
+            if (*sz == '"' || *sz == '\\')
+            {
+                out << '\\';
+            }
+            out << *sz;
+        }
+        out << '"';
+    }
+
+    bool byTotal(const std::pair<std::string, SpanTotals>& a, const std::pair<std::string, SpanTotals>& b)
+    {
+        return a.second.totalUs > b.second.totalUs;
+    }
+}
+
+double CTraceLog::GetClockUs()
+{
+#ifdef LIBHCFR_HAS_WIN32_API
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000.0 + now.tv_nsec / 1000.0;
+#endif
+}
+
+void CTraceLog::Start()
+{
+    CLockWhileInScope lock(traceSection);
+    traceEvents.clear();
+    traceEvents.reserve(4096);
+    nDroppedEvents = 0;
+    traceStartUs = GetClockUs();
+    m_bEnabled = true;
+}
+
+void CTraceLog::Stop()
+{
+    m_bEnabled = false;
+}
+
+void CTraceLog::Record(const char* szName, const char* szCategory, double startUs, double endUs)
+{
+    TraceEvent event;
+    event.szName = szName;
+    event.szCategory = szCategory;
+    event.startUs = startUs;
+    event.durationUs = endUs - startUs;
+    event.threadId = currentThreadId();
+
+    CLockWhileInScope lock(traceSection);
+    if (traceEvents.size() < MAX_EVENTS)
+    {
+        traceEvents.push_back(event);
+    }
+    else
+    {
+        nDroppedEvents++;
+    }
+}
+
+bool CTraceLog::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream out(path.c_str());
+    if (!out)
+    {
+        return false;
+    }
+
+    char numbers[128];
+    CLockWhileInScope lock(traceSection);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < traceEvents.size(); i++)
+    {
+        const TraceEvent& event = traceEvents[i];
+        out << (i ? ",\n" : "") << "{\"name\":";
+        writeJsonString(out, event.szName);
+        out << ",\"cat\":";
+        writeJsonString(out, event.szCategory);
+        sprintf(numbers, ",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,\"pid\":1,\"tid\":%lu}",
+                event.startUs - traceStartUs, event.durationUs, event.threadId);
+        out << numbers;
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+void CTraceLog::WriteSummary(std::ostream& out)
+{
+    std::map<std::string, SpanTotals> totals;
+    double firstUs = 0.0;
+    double lastUs = 0.0;
+    size_t nDropped;
+
+    {
+        CLockWhileInScope lock(traceSection);
+        for (size_t i = 0; i < traceEvents.size(); i++)
+        {
+            const TraceEvent& event = traceEvents[i];
+            SpanTotals& span = totals[std::string(event.szCategory) + "\t" + event.szName];
+            span.nCount++;
+            span.totalUs += event.durationUs;
+            span.maxUs = std::max(span.maxUs, event.durationUs);
+            if (i == 0 || event.startUs < firstUs)
+            {
+                firstUs = event.startUs;
+            }
+            lastUs = std::max(lastUs, event.startUs + event.durationUs);
+        }
+        nDropped = nDroppedEvents;
+    }
+
+    std::vector<std::pair<std::string, SpanTotals> > sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(), byTotal);
+
+    double wallUs = lastUs - firstUs;
+    char line[512];
+
+    sprintf(line, "%.1f ms recorded", wallUs / 1000.0);
+    out << line;
+    if (nDropped)
+    {
+        out << ", " << nDropped << " spans dropped";
+    }
+    out << "\n";
+    sprintf(line, "%-10s %-40s %8s %12s %10s %10s %7s\n", "category", "span", "count", "total ms", "mean ms", "max ms", "share");
+    out << line;
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        const std::string& key = sorted[i].first;
+        const SpanTotals& span = sorted[i].second;
+        size_t tab = key.find('\t');
+        sprintf(line, "%-10s %-40s %8d %12.3f %10.3f %10.3f %6.1f%%\n",
+                key.substr(0, tab).c_str(), key.substr(tab + 1).c_str(), span.nCount,
+                span.totalUs / 1000.0, span.totalUs / 1000.0 / span.nCount, span.maxUs / 1000.0,
+                wallUs > 0.0 ? span.totalUs * 100.0 / wallUs : 0.0);
+        out << line;
+    }
+}
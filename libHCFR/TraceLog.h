@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2012 Hcfr Project.  All rights reserved.
+/////////////////////////////////////////////////////////////////////////////
+//
+//  This file is subject to the terms of the GNU General Public License as
+//  published by the Free Software Foundation.  A copy of this license is
+//  included with this software distribution in the file COPYING.htm. If you
+//  do not have a copy, you may obtain a copy by writing to the Free
+//  Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(TRACE_LOG_H_INCLUDED_)
+#define TRACE_LOG_H_INCLUDED_
+
+#include "libHCFR_Config.h"
+#include <string>
+#include <ostream>
+
+// Timing spans, to see where the time of a measurement series goes.
+// Spans are only recorded between Start() and Stop(), the rest of
+// the time a span costs a flag test. What was recorded can be
+// written as Chrome trace events, for chrome://tracing or Perfetto,
+// and as a summary per span name.
+class CTraceLog
+{
+public:
+    static bool IsEnabled() { return m_bEnabled; }
+
+    // Start recording, dropping what was recorded before
+    static void Start();
+    static void Stop();
+
+    // Names and categories are kept as pointers, they must be
+    // string literals
+    static void Record(const char* szName, const char* szCategory, double startUs, double endUs);
+
+    static bool WriteChromeTrace(const std::string& path);
+    // Count, total, mean and longest time of each span, by decreasing
+    // total. Spans nest, so the shares of the recorded time add up to
+    // more than 100%.
+    static void WriteSummary(std::ostream& out);
+
+    // Microseconds from an arbitrary start
+    static double GetClockUs();
+
+private:
+    static bool m_bEnabled;
+};
+
+// Records the time from its construction to the end of its scope
+class CTraceSpan
+{
+public:
+    CTraceSpan(const char* szName, const char* szCategory) :
+        m_szName(szName),
+        m_szCategory(szCategory),
+        m_startUs(CTraceLog::IsEnabled() ? CTraceLog::GetClockUs() : -1.0)
+    {
+    }
+
+    ~CTraceSpan()
+    {
+        if (m_startUs >= 0.0)
+        {
+            CTraceLog::Record(m_szName, m_szCategory, m_startUs, CTraceLog::GetClockUs());
+        }
+    }
+
+private:
+    CTraceSpan(const CTraceSpan&);
+    CTraceSpan& operator=(const CTraceSpan&);
+
+    const char* m_szName;
+    const char* m_szCategory;
+    double m_startUs;
+};
+
+#define HCFR_TRACE_CONCAT2(a, b) a##b
+#define HCFR_TRACE_CONCAT(a, b) HCFR_TRACE_CONCAT2(a, b)
+
+// Time the rest of the enclosing scope
+#define HCFR_TRACE_SPAN(name, category) CTraceSpan HCFR_TRACE_CONCAT(traceSpan, __LINE__)(name, category)
+// Time the rest of the enclosing function, named after it
+#define HCFR_TRACE_FUNCTION(category) HCFR_TRACE_SPAN(__FUNCTION__, category)
+
+#endif // !defined(TRACE_LOG_H_INCLUDED_)
@@ -3,57 +3,12 @@
 //------------------------------------
 
 #include <math.h>
-#include "endianness.h"
+#include <algorithm>
+#include "Endianness.h"
 #include "matrix.h"
 #include "Exceptions.h"
 using namespace std;
 
-//appends an identity matrix to the right of the calling object
-//used in finding the inverse
-//the user probably doesn't need access to this
-Matrix& Matrix::RightAppendIdentity()
-{
-    Matrix temp;
-    temp = Matrix(0.0, m_nRows, (2 * m_nCols));
-
-    for(int i=0; i<m_nRows; ++i) 
-    {
-        for(int j=0; j<m_nCols; ++j) 
-        {
-            temp.m_pData[i * temp.m_nCols + j] = m_pData[i* m_nCols + j];
-        }
-    }
-    for(int q=0; q<m_nRows; ++q) 
-    {
-        temp.m_pData[q * temp.m_nCols + m_nCols + q] = 1;
-    }
-
-    *this = temp;
-
-    return *this;
-}
-
-//removes an identity matrix from the left of the calling object
-//used in finding the inverse
-//the user probably doesn't need access to this
-Matrix& Matrix::LeftRemoveIdentity()
-{
-    Matrix temp;
-    temp = Matrix(0.0, m_nRows, (m_nCols / 2));
-
-    for(int i=0; i<m_nRows; ++i)
-    {
-        for(int j=0; j<m_nCols/2; ++j)
-        {
-            temp.m_pData[i * temp.m_nCols + j] = m_pData[i* m_nCols + m_nCols/2+j];
-        }
-    }
-
-    *this = temp;
-
-    return *this;
-}
-
 //standard constructor
 //Data = Null; rows = columns = 0
 Matrix::Matrix()
@@ -132,8 +87,8 @@ Matrix::Matrix(ifstream &theFile) :
 
 void Matrix::readFromFile(ifstream &theFile)
 {
-    uint32_t header1, header2, version;
-    uint32_t nbColumns, nbRows;
+    uint32_t header1 = 0, header2 = 0, version = 0;
+    uint32_t nbColumns = 0, nbRows = 0;
 
     // les détrompeurs
     theFile.read((char*)&header1, 4);
@@ -424,6 +379,7 @@ bool Matrix::IsEmpty() const
 }
 
 //finds determinant of the matrix
+//closed forms up to 4x4, LU decomposition above
 double Matrix::Determinant() const
 {
     if(m_nRows != m_nCols)
@@ -431,20 +387,52 @@ double Matrix::Determinant() const
         cout << "Matrix exception : determinant on a non-square matrix" << endl;
         throw new MatrixException("Determinant on a non-square matrix");
     }
-  
-    double sum = 0;
 
-    if(m_nRows == 2) 
+    const double* a = m_nRows > 0 ? &m_pData[0] : 0;
+
+    switch(m_nRows)
     {
-        return((m_pData[0 * m_nCols + 0] * m_pData[1 * m_nCols + 1]) - (m_pData[1 * m_nCols + 0] * m_pData[0 * m_nCols + 1]));
+    case 0:
+        return 1.0;
+    case 1:
+        return a[0];
+    case 2:
+        return a[0] * a[3] - a[2] * a[1];
+    case 3:
+        return a[0] * (a[4] * a[8] - a[5] * a[7])
+             - a[1] * (a[3] * a[8] - a[5] * a[6])
+             + a[2] * (a[3] * a[7] - a[4] * a[6]);
+    case 4:
+        {
+            // Laplace expansion on the first two rows
+            double s0 = a[0] * a[5] - a[4] * a[1];
+            double s1 = a[0] * a[6] - a[4] * a[2];
+            double s2 = a[0] * a[7] - a[4] * a[3];
+            double s3 = a[1] * a[6] - a[5] * a[2];
+            double s4 = a[1] * a[7] - a[5] * a[3];
+            double s5 = a[2] * a[7] - a[6] * a[3];
+            double c5 = a[10] * a[15] - a[14] * a[11];
+            double c4 = a[9] * a[15] - a[13] * a[11];
+            double c3 = a[9] * a[14] - a[13] * a[10];
+            double c2 = a[8] * a[15] - a[12] * a[11];
+            double c1 = a[8] * a[14] - a[12] * a[10];
+            double c0 = a[8] * a[13] - a[12] * a[9];
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        }
     }
 
-	for(int q=0; q<m_nCols; ++q) {
-		Matrix NewMinor = GetMinor(0, q);
-		sum += (pow(-1.0, (double)q)*(m_pData[0 * m_nCols + q]*NewMinor.Determinant()));
-	}
-
-	return sum;
+    vector<double> lu;
+    vector<int> perm;
+    double det;
+    if(!LUDecompose(lu, perm, det))
+    {
+        return 0.0;
+    }
+    for(int i=0; i<m_nRows; ++i)
+    {
+        det *= lu[i * m_nCols + i];
+    }
+    return det;
 }
 
 //returns number of rows of the matrix
@@ -460,6 +448,7 @@ int Matrix::GetColumns() const
 }
 
 //returns the inverse of the calling matrix
+//closed forms for 2x2 to 4x4, LU decomposition with partial pivoting above
 Matrix Matrix::GetInverse() const
 {
     if(m_nRows != m_nCols)
@@ -468,12 +457,151 @@ Matrix Matrix::GetInverse() const
         throw new MatrixException("GetInverse : not a square matrix");
     }
 
-    Matrix temp(*this);
-    temp.RightAppendIdentity();
-    temp.RREF();
-    temp.LeftRemoveIdentity();
+    Matrix temp(0.0, m_nRows, m_nCols);
+    const double* a = m_nRows > 0 ? &m_pData[0] : 0;
+    double* r = m_nRows > 0 ? &temp.m_pData[0] : 0;
+    double det;
 
-    return temp;
+    switch(m_nRows)
+    {
+    case 1:
+        if(a[0] == 0.0)
+        {
+            break;
+        }
+        r[0] = 1.0 / a[0];
+        return temp;
+    case 2:
+        det = a[0] * a[3] - a[2] * a[1];
+        if(det == 0.0)
+        {
+            break;
+        }
+        r[0] = a[3] / det;
+        r[1] = -a[1] / det;
+        r[2] = -a[2] / det;
+        r[3] = a[0] / det;
+        return temp;
+    case 3:
+        {
+            // adjugate over determinant
+            double c0 = a[4] * a[8] - a[5] * a[7];
+            double c1 = a[5] * a[6] - a[3] * a[8];
+            double c2 = a[3] * a[7] - a[4] * a[6];
+            det = a[0] * c0 + a[1] * c1 + a[2] * c2;
+            if(det == 0.0)
+            {
+                break;
+            }
+            r[0] = c0 / det;
+            r[1] = (a[2] * a[7] - a[1] * a[8]) / det;
+            r[2] = (a[1] * a[5] - a[2] * a[4]) / det;
+            r[3] = c1 / det;
+            r[4] = (a[0] * a[8] - a[2] * a[6]) / det;
+            r[5] = (a[2] * a[3] - a[0] * a[5]) / det;
+            r[6] = c2 / det;
+            r[7] = (a[1] * a[6] - a[0] * a[7]) / det;
+            r[8] = (a[0] * a[4] - a[1] * a[3]) / det;
+            return temp;
+        }
+    case 4:
+        {
+            // adjugate from the 2x2 minors of the top and bottom row pairs
+            double s0 = a[0] * a[5] - a[4] * a[1];
+            double s1 = a[0] * a[6] - a[4] * a[2];
+            double s2 = a[0] * a[7] - a[4] * a[3];
+            double s3 = a[1] * a[6] - a[5] * a[2];
+            double s4 = a[1] * a[7] - a[5] * a[3];
+            double s5 = a[2] * a[7] - a[6] * a[3];
+            double c5 = a[10] * a[15] - a[14] * a[11];
+            double c4 = a[9] * a[15] - a[13] * a[11];
+            double c3 = a[9] * a[14] - a[13] * a[10];
+            double c2 = a[8] * a[15] - a[12] * a[11];
+            double c1 = a[8] * a[14] - a[12] * a[10];
+            double c0 = a[8] * a[13] - a[12] * a[9];
+            det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+            if(det == 0.0)
+            {
+                break;
+            }
+            r[0] = ( a[5] * c5 - a[6] * c4 + a[7] * c3) / det;
+            r[1] = (-a[1] * c5 + a[2] * c4 - a[3] * c3) / det;
+            r[2] = ( a[13] * s5 - a[14] * s4 + a[15] * s3) / det;
+            r[3] = (-a[9] * s5 + a[10] * s4 - a[11] * s3) / det;
+            r[4] = (-a[4] * c5 + a[6] * c2 - a[7] * c1) / det;
+            r[5] = ( a[0] * c5 - a[2] * c2 + a[3] * c1) / det;
+            r[6] = (-a[12] * s5 + a[14] * s2 - a[15] * s1) / det;
+            r[7] = ( a[8] * s5 - a[10] * s2 + a[11] * s1) / det;
+            r[8] = ( a[4] * c4 - a[5] * c2 + a[7] * c0) / det;
+            r[9] = (-a[0] * c4 + a[1] * c2 - a[3] * c0) / det;
+            r[10] = ( a[12] * s4 - a[13] * s2 + a[15] * s0) / det;
+            r[11] = (-a[8] * s4 + a[9] * s2 - a[11] * s0) / det;
+            r[12] = (-a[4] * c3 + a[5] * c1 - a[6] * c0) / det;
+            r[13] = ( a[0] * c3 - a[1] * c1 + a[2] * c0) / det;
+            r[14] = (-a[12] * s3 + a[13] * s1 - a[14] * s0) / det;
+            r[15] = ( a[8] * s3 - a[9] * s1 + a[10] * s0) / det;
+            return temp;
+        }
+    default:
+        {
+            vector<double> lu;
+            vector<int> perm;
+            if(!LUDecompose(lu, perm, det))
+            {
+                break;
+            }
+            // solve for each column of the identity
+            for(int k=0; k<m_nCols; ++k)
+            {
+                vector<double> x(m_nRows, 0.0);
+                for(int i=0; i<m_nRows; ++i)
+                {
+                    double sum = (perm[i] == k) ? 1.0 : 0.0;
+                    for(int j=0; j<i; ++j)
+                    {
+                        sum -= lu[i * m_nCols + j] * x[j];
+                    }
+                    x[i] = sum;
+                }
+                for(int i=m_nRows-1; i>=0; --i)
+                {
+                    double sum = x[i];
+                    for(int j=i+1; j<m_nCols; ++j)
+                    {
+                        sum -= lu[i * m_nCols + j] * x[j];
+                    }
+                    x[i] = sum / lu[i * m_nCols + i];
+                }
+                for(int i=0; i<m_nRows; ++i)
+                {
+                    r[i * m_nCols + k] = x[i];
+                }
+            }
+            return temp;
+        }
+    }
+
+    cout << "Matrix exception : getInverse on a singular matrix" << endl;
+    throw new MatrixException("GetInverse : singular matrix");
+}
+
+//returns the 1-norm condition number of the matrix, how much relative
+//errors in it can be amplified by its inverse. Well conditioned colour
+//matrices are in the tens, singular ones return HUGE_VAL
+double Matrix::GetConditionNumber() const
+{
+    if(m_nRows != m_nCols)
+    {
+        cout << "Matrix exception : condition number of a non-square matrix" << endl;
+        throw new MatrixException("GetConditionNumber : not a square matrix");
+    }
+
+    // same test for singularity as GetInverse(), without the exception
+    if(Determinant() == 0.0)
+    {
+        return HUGE_VAL;
+    }
+    return OneNorm() * GetInverse().OneNorm();
 }
 
 //turns the calling matrix into its inverse
@@ -484,65 +612,78 @@ Matrix& Matrix::Invert()
 	return *this;
 }
 
-//add 'SourceRow' by scale of 'factor' (default is one) to 'DestRow'
-Matrix& Matrix::AddRows(const int SourceRow, const int DestRow, const double factor)
+//LU decomposition with partial pivoting, PA = LU with L unit lower
+//triangular, both stored in 'lu'. perm[i] is the row of the calling
+//matrix that ended up in row i, sign is -1 for an odd number of swaps.
+//Returns false if the matrix is singular
+bool Matrix::LUDecompose(vector<double>& lu, vector<int>& perm, double& sign) const
 {
-    for(int j=0; j<m_nCols; ++j) 
+    const int n = m_nRows;
+    lu = m_pData;
+    perm.resize(n);
+    for(int i=0; i<n; ++i)
     {
-        m_pData[DestRow * m_nCols + j] += (m_pData[SourceRow * m_nCols + j] * factor);
+        perm[i] = i;
     }
+    sign = 1.0;
 
-    return *this;
-}
-
-Matrix& Matrix::DivideRow(const int Row, const double _d)
-{
-    if(_d == 0)
-    {
-        cout << "Matrix exception : DivideRow : division by zero" << endl;
-        throw new MatrixException("DivideRow : division by zero");
-    }
-    for(int j=0; j<m_nCols; ++j) 
+    for(int k=0; k<n; ++k)
     {
-        m_pData[Row * m_nCols + j] /= _d;
-    }
-
-    return *this;
-}
+        // largest pivot left in this column
+        int p = k;
+        for(int i=k+1; i<n; ++i)
+        {
+            if(fabs(lu[i * n + k]) > fabs(lu[p * n + k]))
+            {
+                p = i;
+            }
+        }
+        if(lu[p * n + k] == 0.0)
+        {
+            return false;
+        }
+        if(p != k)
+        {
+            for(int j=0; j<n; ++j)
+            {
+                swap(lu[p * n + j], lu[k * n + j]);
+            }
+            swap(perm[p], perm[k]);
+            sign = -sign;
+        }
 
-//puts the matrix into row-echelon form
-Matrix& Matrix::REF()
-{
-    for(int i=0; i<m_nRows; ++i)
-    {
-        for(int j=i+1; j<m_nRows; ++j) 
+        for(int i=k+1; i<n; ++i)
         {
-            AddRows(i, j, -m_pData[j * m_nCols + i]/m_pData[i * m_nCols + i]);
+            double factor = lu[i * n + k] / lu[k * n + k];
+            lu[i * n + k] = factor;
+            for(int j=k+1; j<n; ++j)
+            {
+                lu[i * n + j] -= factor * lu[k * n + j];
+            }
         }
-        DivideRow(i, m_pData[i * m_nCols + i]);
     }
-
-    return *this;
+    return true;
 }
 
-//puts the matrix into reduced row-echelon form
-Matrix& Matrix::RREF()
+//largest column sum of absolute values
+double Matrix::OneNorm() const
 {
-    REF();
-
-    for(int i=m_nRows-1; i>=0; --i) 
+    double norm = 0.0;
+    for(int j=0; j<m_nCols; ++j)
     {
-        for(int j=i-1; j>=0; --j) 
+        double sum = 0.0;
+        for(int i=0; i<m_nRows; ++i)
+        {
+            sum += fabs(m_pData[i * m_nCols + j]);
+        }
+        if(sum > norm)
         {
-            AddRows(i, j, -m_pData[j * m_nCols + i]/m_pData[i * m_nCols + i]);
+            norm = sum;
         }
-        DivideRow(i, m_pData[i * m_nCols + i]);
     }
-
-    return *this;
+    return norm;
 }
 
-
 //returns minor around spot Row,Col
 Matrix Matrix::GetMinor(const int RowSpot, const int ColSpot) const
 {
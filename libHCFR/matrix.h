@@ -22,11 +22,6 @@ private:
 	int m_nCols;                                                       //number of columns
 	int m_nRows;                                                       //number of rows
 
-
-	//private functions
-
-	Matrix& RightAppendIdentity();
-	Matrix& LeftRemoveIdentity();
 public:
 	//constructors and destructor
 
@@ -75,6 +70,7 @@ public:
 
 	Matrix GetInverse() const;
 	Matrix& Invert();
+	double GetConditionNumber() const;
 
 	Matrix GetMinor(const int RowSpot, const int ColSpot) const;
 
@@ -97,10 +93,8 @@ public:
 
 	static Matrix IdentityMatrix(int Diagonal);
 private:
-    Matrix& AddRows(const int SourceRow, const int DestRow, const double factor);
-    Matrix& DivideRow(const int Row, const double factor);
-    Matrix& REF();
-    Matrix& RREF();
+    bool LUDecompose(vector<double>& lu, vector<int>& perm, double& sign) const;
+    double OneNorm() const;
 
 };
 
@@ -386,12 +386,17 @@ static void del_ccast(ccast *p) {
 		amutex_del(p->rlock);
 		acond_del(p->rcond);
 
+		if (p->jgen != NULL)
+			yajl_gen_free(p->jgen);
+		free(p->ebuf);
 		free(p);
 	}
 }
 
 static int load_ccast(ccast *p, char *url, unsigned char *ibuf, size_t ilen,
                       double bg[3], double x, double y, double w, double h);
+static int load_solid_ccast(ccast *p, double fg[3], double bg[3],
+                      double x, double y, double w, double h);
 void ccast_install_signal_handlers(ccast *p);
 
 /* Startup a ChromCast session */
@@ -425,24 +430,33 @@ static int start_ccast(ccast *p) {
 		amutex_init(p->rlock);
 		acond_init(p->rcond);
 
-		/* Hmm. Could put creation of pk inside new_ccmessv() ? */
-		if ((pk = new_ccpacket()) == NULL) {
-			DBG((g_log,0,"start_ccast: new_ccpacket() failed\n"))
-			goto retry;
-		}
+		/* Local stand-in receiver for testing */
+		if (p->id.ip != NULL && strcmp(p->id.ip, CCAST_STANDIN_IP) == 0) {
+			if ((p->messv = new_ccmessv_standin()) == NULL) {
+				DBG((g_log,0,"start_ccast: new_ccmessv_standin() failed\n"))
+				goto retry;
+			}
+
+		} else {
+			/* Hmm. Could put creation of pk inside new_ccmessv() ? */
+			if ((pk = new_ccpacket()) == NULL) {
+				DBG((g_log,0,"start_ccast: new_ccpacket() failed\n"))
+				goto retry;
+			}
 		
-		if ((perr = pk->connect(pk, p->id.ip, 8009)) != ccpacket_OK) {
-			DBG((g_log,0,"start_ccast: ccpacket connect failed with '%s'\n",ccpacket_emes(perr)))
-			goto retry;
-		} 
+			if ((perr = pk->connect(pk, p->id.ip, 8009)) != ccpacket_OK) {
+				DBG((g_log,0,"start_ccast: ccpacket connect failed with '%s'\n",ccpacket_emes(perr)))
+				goto retry;
+			} 
 
-		DBG((g_log,0,"Got TLS connection to '%s\n'",p->id.name))
+			DBG((g_log,0,"Got TLS connection to '%s\n'",p->id.name))
 
-		if ((p->messv = new_ccmessv(pk)) == NULL) {
-			DBG((g_log,0,"start_ccast: new_ccmessv() failed\n"))
-			goto retry;
+			if ((p->messv = new_ccmessv(pk)) == NULL) {
+				DBG((g_log,0,"start_ccast: new_ccmessv() failed\n"))
+				goto retry;
+			}
+			pk = NULL;		/* Will get deleted with messv now */
 		}
-		pk = NULL;		/* Will get deleted with messv now */
 
 		/* Attempt a connection */
 		mes.source_id      = "sender-0";
@@ -620,12 +634,19 @@ int forcedef) {				// Force default reciever
 		return NULL;
 	}
 
+	if ((p->jgen = yajl_gen_alloc(NULL)) == NULL) {
+		DBG((g_log,0, "new_ccast: yajl_gen_alloc failed\n"))
+		free(p);
+		return NULL;
+	}
+
 	/* Init method pointers */
 	p->del             = del_ccast;
 	p->load            = load_ccast;
 	p->shutdown        = shutdown_ccast;
 	p->get_load_delay  = get_load_delay;
 	p->get_direct_send = get_direct_send;
+	p->load_solid      = load_solid_ccast;
 
 #ifdef USE_DEF_RECIEVER
 	forcedef = 1;
@@ -643,6 +664,81 @@ int forcedef) {				// Force default reciever
 	return p;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - */
+/* Per-patch messages are generated with the ccast's yajl_gen and */
+/* base64 encoded into its ebuf, so that these buffers get reused */
+/* rather than allocated for each patch. (Only load() and load_solid() */
+/* use them, so they are not locked.) */
+
+/* Add a string key or value */
+static void jmes_str(yajl_gen g, char *s) {
+	yajl_gen_string(g, (unsigned char *)s, strlen(s));
+}
+
+/* Start a message with its requestId */
+static yajl_gen jmes_start(ccast *p, int reqid) {
+	yajl_gen g = p->jgen;
+
+	yajl_gen_reset(g, NULL);
+	yajl_gen_clear(g);
+	yajl_gen_map_open(g);
+	jmes_str(g, "requestId");
+	yajl_gen_integer(g, reqid);
+
+	return g;
+}
+
+/* Add a CSS rgb() color value */
+static void jmes_rgb(yajl_gen g, double rgb[3]) {
+	char buf[50];
+
+	sprintf(buf, "rgb(%d, %d, %d)", (int)(rgb[0] * 255.0 + 0.5),
+	                                (int)(rgb[1] * 255.0 + 0.5),
+	                                (int)(rgb[2] * 255.0 + 0.5));
+	jmes_str(g, buf);
+}
+
+/* Add "key": [a, b] */
+static void jmes_pair(yajl_gen g, char *key, double a, double b) {
+	jmes_str(g, key);
+	yajl_gen_array_open(g);
+	yajl_gen_double(g, a);
+	yajl_gen_double(g, b);
+	yajl_gen_array_close(g);
+}
+
+/* Close the message and return it. It is valid until the next jmes_start(). */
+/* Return NULL on error */
+static char *jmes_end(yajl_gen g) {
+	const unsigned char *buf;
+	size_t len;
+
+	yajl_gen_map_close(g);
+	if (yajl_gen_get_buf(g, &buf, &len) != yajl_gen_status_ok)
+		return NULL;
+
+	return (char *)buf;
+}
+
+/* base64 encode slen bytes of src into p->ebuf. */
+/* Return the encoded length, or -1 on malloc failure */
+static int jmes_base64(ccast *p, unsigned char *src, size_t slen) {
+	size_t need = EBASE64LEN(slen) + 1;
+	int dlen;
+
+	if (need > p->ebsize) {
+		char *nbuf;
+		if ((nbuf = malloc(need)) == NULL)
+			return -1;
+		free(p->ebuf);
+		p->ebuf = nbuf;
+		p->ebsize = need;
+	}
+	ebase64(&dlen, p->ebuf, src, (int)slen);
+
+	return dlen;
+}
+
 /* Load up a URL */
 /* Returns nz on error: */
 /*	1 send error */
@@ -769,16 +865,12 @@ static int load_ccast(
 #else	/* !NEVER */
 			/* Send base64 PNG image & background color definition in multiple packets */
 			} else if (iibuf != NULL) {
-				char *mesbuf, *cp;
+				yajl_gen g;
+				char *mesbuf;
 				size_t maxlen, meslen;
 				size_t enclen, senclen = 0;
 				int dlen;			/* Encoded length to send */
 
-				if ((mesbuf = malloc(61 * 1024)) == NULL) {
-					DBG((g_log,0,"mes->send malloc failed\n"))
-					return 1;
-				}
-
 				dchan = 1;
 
 				enclen = EBASE64LEN(ilen);			/* Encoded length of whole image */
@@ -787,31 +879,35 @@ static int load_ccast(
 				if (meslen > maxlen)	
 					meslen = maxlen;
  
-				cp = mesbuf;
-				cp += sprintf(cp, "{ ");
-				cp += sprintf(cp, "\"requestId\": %d,",reqid); 
-				cp += sprintf(cp, "\"foreground\": { ");
-				cp += sprintf(cp, "\"contentType\": \"image/png\",");
-				cp += sprintf(cp, "\"encoding\": \"base64\",");
-				cp += sprintf(cp, "\"data\": \"");
-				ebase64(&dlen, cp, iibuf, meslen);
+				if ((dlen = jmes_base64(p, iibuf, meslen)) < 0) {
+					DBG((g_log,0,"mes->send malloc failed\n"))
+					return 1;
+				}
 				DBG((g_log,0,"part base64 encoded PNG = %d bytes\n",dlen))
 				iibuf += meslen;
 				iilen -= meslen;
 				senclen += dlen;
-				cp += dlen;
-				cp += sprintf(cp, "\",");
-				cp += sprintf(cp, "\"size\": %lu",(unsigned long)EBASE64LEN(ilen));
-				cp += sprintf(cp, " },");
-
-				cp += sprintf(cp, "\"background\": \"rgb(%d, %d, %d)\",",
-				                               (int)(bg[0] * 255.0 + 0.5),
-				                               (int)(bg[1] * 255.0 + 0.5),
-				                               (int)(bg[2] * 255.0 + 0.5));
 
-				cp += sprintf(cp, "\"offset\": [%f, %f],",x,y);
-				cp += sprintf(cp, "\"scale\": [%f, %f]",w,h);
-				cp += sprintf(cp, " }");
+				g = jmes_start(p, reqid);
+				jmes_str(g, "foreground");
+				yajl_gen_map_open(g);
+				jmes_str(g, "contentType");
+				jmes_str(g, "image/png");
+				jmes_str(g, "encoding");
+				jmes_str(g, "base64");
+				jmes_str(g, "data");
+				yajl_gen_string(g, (unsigned char *)p->ebuf, dlen);
+				jmes_str(g, "size");
+				yajl_gen_integer(g, (long long)EBASE64LEN(ilen));
+				yajl_gen_map_close(g);
+				jmes_str(g, "background");
+				jmes_rgb(g, bg);
+				jmes_pair(g, "offset", x, y);
+				jmes_pair(g, "scale", w, h);
+				if ((mesbuf = jmes_end(g)) == NULL) {
+					DBG((g_log,0,"mes->send JSON generation failed\n"))
+					return 1;
+				}
 
 				mes.source_id      = "sender-0";
 				mes.destination_id = p->transportId;
@@ -824,7 +920,6 @@ static int load_ccast(
 
 				if ((merr = p->messv->send(p->messv, &mes)) != ccmessv_OK) {
 					DBG((g_log,0,"mes->send LOAD failed with '%s'\n",ccmessv_emes(merr)))
-					free(mesbuf);
 					rv = 1;
 					goto retry;		/* Failed */
 				}
@@ -841,19 +936,22 @@ static int load_ccast(
 
 					lastid = reqid = ++p->requestId;
 
-					cp = mesbuf;
-					cp += sprintf(cp, "{ ");
-					cp += sprintf(cp, "\"requestId\": %d,",reqid); 
-					cp += sprintf(cp, "\"foreground\": \"");
-					ebase64(&dlen, cp, iibuf, meslen);
+					if ((dlen = jmes_base64(p, iibuf, meslen)) < 0) {
+						DBG((g_log,0,"mes->send malloc failed\n"))
+						return 1;
+					}
 					DBG((g_log,0,"part base64 encoded PNG = %d bytes\n",dlen))
 					iibuf += meslen;
 					iilen -= meslen;
 					senclen += dlen;
 
-
-					cp += dlen;
-					cp += sprintf(cp, "\" }");
+					g = jmes_start(p, reqid);
+					jmes_str(g, "foreground");
+					yajl_gen_string(g, (unsigned char *)p->ebuf, dlen);
+					if ((mesbuf = jmes_end(g)) == NULL) {
+						DBG((g_log,0,"mes->send JSON generation failed\n"))
+						return 1;
+					}
 	
 					mes.source_id      = "sender-0";
 					mes.destination_id = p->transportId;
@@ -865,7 +963,6 @@ static int load_ccast(
 #endif
 					if ((merr = p->messv->send(p->messv, &mes)) != ccmessv_OK) {
 						DBG((g_log,0,"mes->send LOAD failed with '%s'\n",ccmessv_emes(merr)))
-						free(mesbuf);
 						rv = 1;
 						goto retry;		/* Failed */
 					}
@@ -915,7 +1012,6 @@ static int load_ccast(
 						firstid++;
 					}
 				};
-				free(mesbuf);
 
 				/* This would be bad... */
 				if (iilen == 0 && senclen != enclen)
@@ -1023,6 +1119,88 @@ static int load_ccast(
 	return rv;
 }
 
+/* Show a solid patch using the pattern generator receiver. */
+/* The foreground is given as a color rather than an image, so there */
+/* is nothing to render, encode or transfer. No retries are done here: */
+/* on any failure the caller falls back to load() with a PNG, which */
+/* takes care of re-connecting. */
+/* Returns nz on error: */
+/*	1 send error or not supported */
+/*	2 receieve error or NACK */
+static int load_solid_ccast(
+	ccast *p,
+	double fg[3],					/* Patch color RGB */
+	double bg[3],					/* Background color RGB */
+	double x, double y,				/* Window location and size as prop. of display */
+	double w, double h				/* Size as multiplier of default 10% width */
+) {
+	ccmessv_err merr;
+	int reqid, rv;
+	ccmes mes;
+	yajl_gen g;
+	char *mesbuf;
+	char *direct_chan = "urn:x-cast:net.hoech.cast.patterngenerator";
+
+	if (p->messv == NULL || !p->patgenrcv || p->nosolid)
+		return 1;
+
+	ccmes_init(&mes);
+	reqid = ++p->requestId;
+
+	g = jmes_start(p, reqid);
+	jmes_str(g, "foreground");
+	yajl_gen_map_open(g);
+	jmes_str(g, "contentType");
+	jmes_str(g, "text/css");
+	jmes_str(g, "data");
+	jmes_rgb(g, fg);
+	yajl_gen_map_close(g);
+	jmes_str(g, "background");
+	jmes_rgb(g, bg);
+	jmes_pair(g, "offset", x, y);
+	jmes_pair(g, "scale", w, h);
+	if ((mesbuf = jmes_end(g)) == NULL)
+		return 1;
+
+	mes.source_id      = "sender-0";
+	mes.destination_id = p->transportId;
+	mes.namespace      = direct_chan;
+	mes.binary         = 0;
+	mes.data   = (ORD8 *)mesbuf;
+#ifdef CHECK_JSON
+	check_json((char *)mes.data);
+#endif
+	if ((merr = p->messv->send(p->messv, &mes)) != ccmessv_OK) {
+		DBG((g_log,0,"load_solid_ccast: send failed with '%s'\n",ccmessv_emes(merr)))
+		return 1;
+	}
+
+	if ((rv = get_a_reply_id(p, direct_chan, reqid, &mes, 5000)) != 0) {
+		DBG((g_log,0,"load_solid_ccast: failed to get reply\n"))
+		if (rv == 2)
+			p->nosolid = 1;		/* Receiver ignores the message */
+		return 2;
+	}
+
+	if (mes.mtype == NULL || strcmp(mes.mtype, "ACK") != 0) {
+		/* Older receiver that only knows about images */
+		DBG((g_log,0,"load_solid_ccast: got mtype '%s', not using solid patches\n",
+		                                   mes.mtype == NULL ? "(null)" : mes.mtype))
+		p->nosolid = 1;
+		ccmes_empty(&mes);
+		return 2;
+	}
+	ccmes_empty(&mes);
+
+	p->loaded1 = 1;
+
+	/* The receiver still needs time to put it on screen */
+	if (p->load_delay > 0.0)
+		msec_sleep(p->load_delay);
+
+	return 0;
+}
+
 /*  - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /* Static list so that all open ChromCast connections can be closed on a SIGKILL */
@@ -49,6 +49,12 @@ struct _ccast {
 	/* else have to setup webserver and send URL */
 	int (*get_direct_send)(struct _ccast *p);
 
+	/* Show a solid fg patch over a bg screen, sent as parameters over the */
+	/* pattern generator channel rather than as a PNG. */
+	/* Returns nz on error, and sets nosolid if the receiver refused it. */
+	int (*load_solid)(struct _ccast *p, double fg[3], double bg[3],
+		     double x, double y, double w, double h);
+
 	/* Thread context */
 	athread *rmesth;				/* Receive message thread */
 	struct _ccmes *rmes;			/* Linked list of received messages */
@@ -66,6 +72,12 @@ struct _ccast {
 	int forcedef;					/* Force using default reciever rather than patgen */
 	int patgenrcv;					/* nz if pattern generator receiver, else default receiver */
 	int load_delay;					/* Delay needed after succesful LOAD */
+	int nosolid;					/* nz if receiver doesn't take solid patch messages */
+
+	/* Reused for building per-patch messages */
+	struct yajl_gen_t *jgen;		/* JSON generator */
+	char *ebuf;						/* base64 encoding buffer */
+	size_t ebsize;					/* Allocated size of ebuf */
 
 	struct _ccast *next;			/* Next in static list for signal cleanup */
 }; typedef struct _ccast ccast;
@@ -76,6 +88,11 @@ struct _ccast {
 /* Can also set environment variabl "ARGYLL_CCAST_DEFAULT_RECEIVER" to do this. */
 ccast *new_ccast(ccast_id *id, int forcedef);
 
+/* ccast_id ip that connects to an in-process stand-in for the pattern */
+/* generator receiver, so that patch latency can be measured without */
+/* a ChromeCast. See new_ccmessv_standin(). */
+#define CCAST_STANDIN_IP "standin"
+
 /* Quantization model of ChromCast and TV */
 /* ctx is a placeholder, and can be NULL */
 
@@ -0,0 +1,147 @@
+/*
+ * Argyll Color Correction System
+ * ChromCast message framing benchmark
+ *
+ * This material is licenced under the GNU AFFERO GENERAL PUBLIC LICENSE Version 3 :-
+ * see the License2.txt file for licencing details.
+ *
+ */
+
+/*
+ * Measures messages per second through ccmessv & ccpacket, using plain
+ * packets over a socketpair so that TLS and the network don't hide
+ * the cost of packing, framing, unpacking and parsing.
+ * A small message is the size of a solid patch, a large one the size
+ * of a PNG patch chunk.
+ *
+ * Usage: ccbench [nmessages]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "copyright.h"
+#include "aconfig.h"
+#ifndef SALONEINSTLIB
+#include "numlib.h"
+#else
+#include "numsup.h"
+#endif
+#include "conv.h"
+#include "yajl.h"
+#include "ccpacket.h"
+#include "ccmes.h"
+
+static char *direct_chan = "urn:x-cast:net.hoech.cast.patterngenerator";
+
+typedef struct {
+	ccmessv *rx;
+	int nmes;
+	int nerr;
+} rxctx;
+
+/* Receive and discard nmes messages */
+static int rx_thread(void *context) {
+	rxctx *c = (rxctx *)context;
+	ccmes mes;
+	int i;
+
+	for (i = 0; i < c->nmes;) {
+		ccmessv_err rv;
+
+		if ((rv = c->rx->receive(c->rx, &mes)) == ccmessv_timeout)
+			continue;
+		if (rv != ccmessv_OK || mes.mtype == NULL) {
+			c->nerr++;
+			return 1;
+		}
+		ccmes_empty(&mes);
+		i++;
+	}
+	return 0;
+}
+
+/* Send nmes messages of about size bytes and return messages/sec */
+static double run(ccmessv *tx, ccmessv *rx, int nmes, int size) {
+	athread *th;
+	rxctx c;
+	ccmes mes;
+	char *body;
+	unsigned int stime, etime;
+	int i, hlen;
+
+	if ((body = malloc(size + 100)) == NULL)
+		error("malloc failed");
+	hlen = sprintf(body, "{ \"requestId\": 1, \"type\": \"ACK\", \"foreground\": \"");
+	for (i = hlen; i < size; i++)
+		body[i] = 'A' + i % 26;
+	strcpy(body + (size > hlen ? size : hlen), "\" }");
+
+	c.rx = rx;
+	c.nmes = nmes;
+	c.nerr = 0;
+
+	stime = msec_time();
+	if ((th = new_athread(rx_thread, &c)) == NULL)
+		error("new_athread failed");
+
+	for (i = 0; i < nmes; i++) {
+		ccmes_init(&mes);
+		mes.source_id      = "sender-0";
+		mes.destination_id = "receiver-0";
+		mes.namespace      = direct_chan;
+		mes.binary         = 0;
+		mes.data           = (ORD8 *)body;
+		if (tx->send(tx, &mes) != ccmessv_OK)
+			error("send failed");
+	}
+	th->wait(th);
+	etime = msec_time();
+	th->del(th);
+	free(body);
+
+	if (c.nerr != 0)
+		error("receive failed");
+
+	if (etime == stime)
+		etime++;
+	return nmes * 1000.0 / (etime - stime);
+}
+
+int
+main(
+	int argc,
+	char *argv[]
+) {
+	int sv[2];
+	ccpacket *txp, *rxp;
+	ccmessv *tx, *rx;
+	int nmes = 20000;
+
+	if (argc > 1)
+		nmes = atoi(argv[1]);
+	if (nmes <= 0)
+		nmes = 20000;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+		error("socketpair failed");
+
+	if ((txp = new_ccpacket_sock(sv[0])) == NULL
+	 || (rxp = new_ccpacket_sock(sv[1])) == NULL)
+		error("new_ccpacket_sock failed");
+
+	if ((tx = new_ccmessv(txp)) == NULL
+	 || (rx = new_ccmessv(rxp)) == NULL)
+		error("new_ccmessv failed");
+
+	printf("%d messages each\n",nmes);
+	printf("  small (250 bytes): %.0f messages/sec\n",run(tx, rx, nmes, 250));
+	printf("  large (60 KBytes): %.0f messages/sec\n",run(tx, rx, nmes/20, 60 * 1024));
+
+	tx->del(tx);
+	rx->del(rx);
+
+	return 0;
+}
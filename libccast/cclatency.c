@@ -0,0 +1,88 @@
+/*
+ * Argyll Color Correction System
+ * ChromCast patch latency test harness
+ *
+ * This material is licenced under the GNU AFFERO GENERAL PUBLIC LICENSE Version 3 :-
+ * see the License2.txt file for licencing details.
+ *
+ */
+
+/*
+ * Times ccwin set_color() against the in-process receiver stand-in,
+ * once with solid patch messages and once forcing the PNG path.
+ * The receiver's fixed display settle delay is left out, so what is
+ * measured is rendering, encoding, messaging and the ACK round trip.
+ *
+ * Usage: cclatency [npatches]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/types.h>
+#include "copyright.h"
+#include "aconfig.h"
+#ifndef SALONEINSTLIB
+#include "numlib.h"
+#else
+#include "numsup.h"
+#endif
+#include "conv.h"
+#include "ccwin.h"
+
+/* Show npatches gray levels, return the average msec per patch */
+static double time_patches(dispwin *dw, int npatches) {
+	unsigned int stime;
+	int i;
+
+	stime = msec_time();
+	for (i = 0; i < npatches; i++) {
+		double v = (i % 11) / 10.0;
+		if (dw->set_color(dw, v, v, v) != 0)
+			error("set_color failed");
+	}
+	return (msec_time() - stime) / (double)npatches;
+}
+
+int
+main(
+	int argc,
+	char *argv[]
+) {
+	ccast_id id;
+	dispwin *dw;
+	chws *ws;
+	int npatches = 50;
+	double solid, png;
+
+	if (argc > 1)
+		npatches = atoi(argv[1]);
+	if (npatches <= 0)
+		npatches = 50;
+
+	id.name = "Stand-in receiver";
+	id.ip = CCAST_STANDIN_IP;
+	id.typ = cctyp_1;
+
+	/* 10% window, as HCFR uses by default */
+	if ((dw = new_ccwin(&id, 1.0, 1.0, 0.0, 0.0, 0, 0.0)) == NULL)
+		error("new_ccwin failed");
+
+	ws = (chws *)dw->pcntx;
+	ws->cc->load_delay = 0;
+
+	solid = time_patches(dw, npatches);
+	if (ws->cc->nosolid)
+		printf("Receiver refused solid patches, both timings use PNG\n");
+
+	ws->cc->nosolid = 1;
+	png = time_patches(dw, npatches);
+
+	printf("%d patches\n",npatches);
+	printf("  solid message: %.1f msec per patch\n",solid);
+	printf("  PNG image:     %.1f msec per patch\n",png);
+
+	dw->del(dw);
+
+	return 0;
+}
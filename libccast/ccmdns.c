@@ -427,7 +427,7 @@ static int send_mDNS(SOCKET sock) {
 	return 0;
 }
 
-static int parse_dns(char **name, char **ip, cctype *ptyp, int *pcaflags, ORD8 *buf, int size);
+static int parse_dns(char **name, char **ip, cctype *ptyp, int *pcaflags, unsigned int *pttl, ORD8 *buf, int size);
 
 /* Free up what get_ccids returned */
 void free_ccids(ccast_id **ids) {
@@ -443,163 +443,366 @@ void free_ccids(ccast_id **ids) {
 	}
 }
 
-/* Spend the given time waiting for replies. */
-/* (Note than on MSWin this will be a minimum of 500msec) */
-/* Add any ChromeCast replies to the list. */
-/* return nz on error & free *ids */
-static int receive_mDNS(SOCKET sock, ccast_id ***ids, int *nids, int emsec) {
-	unsigned int smsec;
-	unsigned int nSize;
-	int off, size;
+/* ==================================================================== */
+/* Background discovery */
+
+/*
+ * Rather than send queries and wait out a fixed window on every
+ * get_ccids(), a thread keeps listening on the mDNS socket, and maintains
+ * a table of the ChromeCasts it has heard from, each with the expiry time
+ * given by its records TTL. Replies to anyone's queries and unsolicited
+ * announcements all refresh the table. We only query ourselves while
+ * warming up, and when a device's records are at 80% of their TTL (then
+ * every 5% after that until they expire, as RFC 6762 suggests).
+ */
+
+#define CCDISC_WARM 700			/* msec to listen before the table is complete */
+#define CCDISC_WARM_EMPTY 1600	/* msec if nothing has been heard by CCDISC_WARM */
+#define CCDISC_MIN_TTL 2		/* Minimum TTL in seconds we honour, to bound the query rate */
+
+typedef struct {
+	ccast_id id;
+	int ttl;					/* Record TTL in msec */
+	unsigned int expire;		/* msec_time() at which the records expire */
+	unsigned int requery;		/* msec_time() at which to query for fresh records */
+} ccdisc_ent;
+
+static amutex_static(ccdisc_lock);	/* Protects all the ccdisc_ variables */
+static athread *ccdisc_th = NULL;	/* Discovery thread, NULL if not started */
+static SOCKET ccdisc_sock;
+static int ccdisc_stop = 0;			/* nz to tell the thread to exit */
+static int ccdisc_state = 0;		/* 0 = warming up, 1 = warm, 2 = failed */
+static unsigned int ccdisc_smsec;	/* msec_time() warm up started at */
+static ccdisc_ent *ccdisc_ents = NULL;
+static int ccdisc_nents = 0;		/* Number of valid entries */
+static int ccdisc_aents = 0;		/* Number of allocated entries */
+
+/* Remove entry i. Call with ccdisc_lock held */
+static void ccdisc_remove(int i) {
+	free(ccdisc_ents[i].id.name);
+	free(ccdisc_ents[i].id.ip);
+	ccdisc_nents--;
+	if (i < ccdisc_nents)
+		ccdisc_ents[i] = ccdisc_ents[ccdisc_nents];
+}
+
+/* Add or refresh a device, taking ownership of name and ip. */
+/* ttl is in seconds, 0 being a goodbye. Call with ccdisc_lock held. */
+/* Return nz on error */
+static int ccdisc_update(char *name, char *ip, cctype typ, unsigned int ttl) {
+	unsigned int now = msec_time();
+	ccdisc_ent *ent;
+	int i;
+
+	for (i = 0; i < ccdisc_nents; i++) {
+		if (strcmp(ccdisc_ents[i].id.name, name) == 0
+		 && strcmp(ccdisc_ents[i].id.ip, ip) == 0)
+			break;
+	}
+
+	if (ttl == 0) {
+		if (i < ccdisc_nents) {
+			DBG2((g_log,DLEV,"ccdisc: '%s' said goodbye\n",name))
+			ccdisc_remove(i);
+		}
+		free(name);
+		free(ip);
+		return 0;
+	}
+
+	if (i < ccdisc_nents) {
+		ent = &ccdisc_ents[i];
+		free(name);
+		free(ip);
+	} else {
+		if (ccdisc_nents >= ccdisc_aents) {
+			ccdisc_ent *tents;
+			int naents = ccdisc_aents == 0 ? 4 : 2 * ccdisc_aents;
+			if ((tents = realloc(ccdisc_ents, naents * sizeof(ccdisc_ent))) == NULL) {
+				DBG((g_log,0,"realloc fail\n"))
+				free(name);
+				free(ip);
+				return 1;
+			}
+			ccdisc_ents = tents;
+			ccdisc_aents = naents;
+		}
+		DBG2((g_log,DLEV,"ccdisc: adding '%s' at '%s'\n",name,ip))
+		ent = &ccdisc_ents[ccdisc_nents++];
+		ent->id.name = name;
+		ent->id.ip = ip;
+	}
+	ent->id.typ = typ;
+
+	if (ttl < CCDISC_MIN_TTL)
+		ttl = CCDISC_MIN_TTL;
+	if (ttl > (INT_MAX/1000))
+		ttl = INT_MAX/1000;
+	ent->ttl = ttl * 1000;
+	ent->expire = now + ent->ttl;
+	ent->requery = now + ent->ttl/10 * 8;
+
+	return 0;
+}
+
+/* Handle one received mDNS message */
+static void ccdisc_message(ORD8 *buf, int size) {
+	char *name, *ip;
+	cctype typ;
+	int caflags;					/* (We're not currently saving this) */
+	unsigned int ttl;
+
+	DBG2((g_log,DLEVP1,"Got mDNS message length %d bytes\n",size))
+#ifdef DEBUG
+	adump_bytes(g_log, "    ", buf, 0, size);
+#endif
+
+	if (parse_dns(&name, &ip, &typ, &caflags, &ttl, buf, size) != 0) {
+		DBG((g_log,0,"Failed to parse the reply\n"))
+		return;
+	}
+	DBG((g_log,0,"Parsed reply OK\n"))
+
+	/* If we didn't find a complete entry */
+	if (name == NULL || ip == NULL) {
+		free(name);
+		free(ip);
+		return;
+	}
+	DBG((g_log,0,"Got a name '%s', IP '%s', type %s, TTL %u\n",name,ip, cctype2str(typ),ttl))
+
+	/* Check if it is a Chromecast-Audio or Other */
+	if (typ == cctyp_Audio
+	 || typ == cctyp_Other) {
+		DBG((g_log,0,"Ignoring Chromecast-Audio/Other\n"))
+		free(name);
+		free(ip);
+		return;
+	}
+
+	amutex_lock(ccdisc_lock);
+	ccdisc_update(name, ip, typ, ttl);
+	amutex_unlock(ccdisc_lock);
+}
+
+/* The discovery thread. Exits when ccdisc_stop is set, */
+/* or with ccdisc_state = 2 if the socket fails. */
+static int ccdisc_thread(void *context) {
+	unsigned int lquery = 0;	/* msec_time() of last query */
+	int nquery = 0;				/* Queries sent while warming up */
 	ORD8 achInBuf[BUFSIZE]; 
-	struct sockaddr_in stSourceAddr; 
 
-	DBG((g_log,0,"receive_mDNS() called with %d ids\n",*nids))
+	DBG2((g_log,DLEV,"ccdisc: thread started\n"))
 
-	/* While there is still wait time */
-	for (smsec = msec_time(), emsec += smsec;msec_time() <= emsec;) {
-		int i;
-		char *name, *ip;
-		cctype typ;
-		int caflags;					/* (We're not currently saving this) */
+	for (;;) {
+		unsigned int now = msec_time();
+		int doquery = 0;
+		unsigned int nSize;
+		int i, size;
 		struct sockaddr stSockAddr; 
 
-		/* Recv the available data */ 
+		amutex_lock(ccdisc_lock);
+		if (ccdisc_stop) {
+			amutex_unlock(ccdisc_lock);
+			break;
+		}
+
+		/* Forget devices whose records have expired */
+		for (i = 0; i < ccdisc_nents;) {
+			if ((int)(now - ccdisc_ents[i].expire) >= 0) {
+				DBG2((g_log,DLEV,"ccdisc: '%s' expired\n",ccdisc_ents[i].id.name))
+				ccdisc_remove(i);
+			} else {
+				i++;
+			}
+		}
+
+		if (ccdisc_state == 0) {
+			/* Same schedule get_ccids() used to follow: query, */
+			/* wait 200 msec, then re-query every 500 msec */
+			if (nquery == 0
+			 || ((now - ccdisc_smsec) < (unsigned int)CCDISC_WARM_EMPTY
+			  && (int)(now - lquery) >= (nquery == 1 ? 200 : 500))) {
+				if (nquery == 0)
+					ccdisc_smsec = now;
+				doquery = 1;
+				nquery++;
+			}
+			if ((now - ccdisc_smsec) >= CCDISC_WARM
+			 && (ccdisc_nents > 0 || (now - ccdisc_smsec) >= CCDISC_WARM_EMPTY)) {
+				DBG2((g_log,DLEV,"ccdisc: warm after %d msec with %d devices\n",
+				                                       now - ccdisc_smsec, ccdisc_nents))
+				ccdisc_state = 1;
+				nquery = 0;
+			}
+		} else {
+			for (i = 0; i < ccdisc_nents; i++) {
+				if ((int)(now - ccdisc_ents[i].requery) >= 0) {
+					DBG2((g_log,DLEV,"ccdisc: refreshing '%s'\n",ccdisc_ents[i].id.name))
+					doquery = 1;
+					ccdisc_ents[i].requery = now + ccdisc_ents[i].ttl/20;
+				}
+			}
+		}
+		amutex_unlock(ccdisc_lock);
+
+		if (doquery) {
+			if (send_mDNS(ccdisc_sock)) {
+				DBG2((g_log,0,"ccdisc: send_mDNS() failed\n"))
+			}
+			lquery = now;
+		}
+
+		/* Recv the available data (times out after 100 msec) */ 
 		nSize = sizeof(struct sockaddr); 
-		size = recvfrom(sock, (char *)achInBuf, 
+		size = recvfrom(ccdisc_sock, (char *)achInBuf, 
 						BUFSIZE, 0, (struct sockaddr *) &stSockAddr, &nSize); 
 		if (size == SOCKET_ERROR) { 
 			if (ERRNO == UDP_SOCKET_TIMEOUT)
 				continue;			/* Timeout */
-			DBG2((g_log,DLEV,"recvfrom failed with %d\n",ERRNO))
-			free_ccids(*ids);
-			*ids = NULL;
-			return 1;
+			DBG2((g_log,0,"ccdisc: recvfrom failed with %d\n",ERRNO))
+			amutex_lock(ccdisc_lock);
+			ccdisc_state = 2;
+			amutex_unlock(ccdisc_lock);
+			break;
 		}
+		ccdisc_message(achInBuf, size);
+	}
 
-		DBG2((g_log,DLEVP1,"Got mDNS message length %d bytes\n",size))
-#ifdef DEBUG
-		adump_bytes(g_log, "    ", achInBuf, 0, size);
-#endif
+	DBG2((g_log,DLEV,"ccdisc: thread exiting\n"))
+	return 0;
+}
 
-		if (parse_dns(&name, &ip, &typ, &caflags, achInBuf, size) != 0) {
-			DBG((g_log,0,"Failed to parse the reply\n"))
-		} else {
-			DBG((g_log,0,"Parsed reply OK\n"))
+/* Stop the thread and forget everything. Call with ccdisc_lock held */
+static void ccdisc_shutdown() {
+	athread *th;
+
+	if ((th = ccdisc_th) == NULL)
+		return;
+
+	ccdisc_stop = 1;
+	amutex_unlock(ccdisc_lock);
+	th->del(th);				/* Waits for it to exit */
+	amutex_lock(ccdisc_lock);
+
+	closesocket(ccdisc_sock);
+	while (ccdisc_nents > 0)
+		ccdisc_remove(ccdisc_nents-1);
+	free(ccdisc_ents);
+	ccdisc_ents = NULL;
+	ccdisc_aents = 0;
+	ccdisc_th = NULL;
+}
 
-			/* If we found an entry */
-			if (name != NULL && ip != NULL) {
-				DBG((g_log,0,"Got a name '%s', IP '%s', type %s\n",name,ip, cctype2str(typ)))
+/* Start the thread if it isn't running. Call with ccdisc_lock held. */
+/* Return nz on error */
+static int ccdisc_startup() {
 
-				/* Check if it is a Chromecast-Audio or Other */
-				if (typ == cctyp_Audio
-				 || typ == cctyp_Other) {
-					DBG((g_log,0,"Ignoring Chromecast-Audio/Other\n"))
-					free(name);
-					free(ip);
+	if (ccdisc_th != NULL)
+		return 0;
 
-				} else {
-			
-					/* Check if it is a duplcate */
-					for (i = 0; i < *nids; i++) {
-						if (strcmp((*ids)[i]->name, name) == 0
-						 && strcmp((*ids)[i]->ip, ip) == 0)
-							break;	/* yes */
-					} 
-					if (i < *nids) {
-						DBG((g_log,0,"Duplicate\n"))
-						free(name);
-						free(ip);
-					} else {
-						ccast_id **tids;
-						if ((tids = realloc(*ids, (*nids + 2) * sizeof(ccast_id *))) == NULL
-						 || (*ids = tids, (*ids)[*nids] = malloc(sizeof(ccast_id)), (*ids)[*nids]) == NULL) {
-							DBG((g_log,0,"realloc/malloc fail\n"))
-							free(name);
-							free(ip);
-							free_ccids(*ids);
-							*ids = NULL;
-							return 1;
-						} else {
-							DBG((g_log,0,"Adding entry\n"))
-							(*ids)[*nids]->name = name;
-							(*ids)[*nids]->ip = ip;
-							(*ids)[*nids]->typ = typ;
-							(*nids)++;
-							(*ids)[*nids] = NULL;		/* End marker */
-						}
-					}
-				}
-			}
-		}
+	if (init_mDNS()) {
+		DBG2((g_log,0,"ccdisc: init_mDNS() failed\n"))
+		return 1;
 	}
 
-	DBG2((g_log,DLEVP1,"receive_mDNS() returning %d in list\n",*nids))
+	if (init_socket_mDNS(&ccdisc_sock)) {
+		DBG2((g_log,0,"ccdisc: init_socket_mDNS() failed\n"))
+		return 1;
+	}
+
+	ccdisc_stop = 0;
+	ccdisc_state = 0;
+	ccdisc_smsec = msec_time();
 
+	if ((ccdisc_th = new_athread(ccdisc_thread, NULL)) == NULL) {
+		DBG2((g_log,0,"ccdisc: new_athread() failed\n"))
+		closesocket(ccdisc_sock);
+		return 1;
+	}
 	return 0;
 }
 
+/* Start discovering Chromecasts in the background, so that a later */
+/* get_ccids() can return at once. Return nz on error */
+int start_ccids(void) {
+	int rv;
+
+	amutex_lock(ccdisc_lock);
+	rv = ccdisc_startup();
+	amutex_unlock(ccdisc_lock);
+
+	return rv;
+}
+
+/* Stop background discovery */
+void stop_ccids(void) {
+	amutex_lock(ccdisc_lock);
+	ccdisc_shutdown();
+	amutex_unlock(ccdisc_lock);
+}
+
 /* ==================================================================== */
 
 /* Get a list of Video output capable Chromecasts. Return NULL on error */
 /* Last pointer in array is NULL */
-/* Takes 1.5 second to return */
+/* Returns at once from the discovery table once it is warm, */
+/* or takes up to 1.6 seconds the first time or if none are known. */
 ccast_id **get_ccids() {
 	ccast_id **ids = NULL;
-	int nids = 0;
-	int i, j, k;
-	unsigned int smsec;
-	int waittime = 200;
-	SOCKET sock;
+	int i, j;
 
 	DBG2((g_log,DLEV,"get_ccids: called\n"))
 
-	if (init_mDNS()) {
-		DBG2((g_log,0,"get_ccids: init_mDNS() failed\n"))
-		return NULL;
-	}
+	amutex_lock(ccdisc_lock);
+
+	/* Restart if the socket failed since last time */
+	if (ccdisc_state == 2)
+		ccdisc_shutdown();
 
-	if (init_socket_mDNS(&sock)) {
-		DBG2((g_log,0,"get_ccids: init_socket_mDNS() failed\n"))
+	if (ccdisc_startup()) {
+		amutex_unlock(ccdisc_lock);
+		DBG2((g_log,0,"get_ccids: starting discovery failed\n"))
 		return NULL;
 	}
 
-	smsec = msec_time();
-
-	/* Try a few times, with increasing response wait time */
-	for (k = 1;
-		    ((msec_time() - smsec) < 700)
-		 || (nids == 0 && (msec_time() - smsec) < 1600);
-	     k++) {
+	/* If we know of nothing, maybe something has been turned on */
+	/* since we last looked, so go through the warm up again. */
+	if (ccdisc_state == 1 && ccdisc_nents == 0) {
+		DBG2((g_log,DLEV,"get_ccids: no devices known, re-querying\n"))
+		ccdisc_state = 0;
+	}
 
-		DBG2((g_log,DLEV,"get_ccids: Sending mDNS query #%d:\n",k))
-		if (send_mDNS(sock)) {
-			DBG2((g_log,0,"get_ccids: send_mDNS() #1 failed\n"))
-			closesocket(sock);
-			return NULL;
-		}
-	
-		DBG2((g_log,DLEV,"get_ccids: Waiting for mDNS reply #%d:\n",k))
-		if (receive_mDNS(sock, &ids, &nids, waittime)) {
-			DBG2((g_log,0,"get_ccids: receive_mDNS() #%d failed\n",k))
-			closesocket(sock);
-			return NULL;
-		}
-		DBG2((g_log,DLEV,"get_ccids: have %d %s\n",nids, nids == 1 ? "reply" : "replies"))
+	/* Wait for the table to be complete */
+	while (ccdisc_state == 0) {
+		amutex_unlock(ccdisc_lock);
+		msec_sleep(20);
+		amutex_lock(ccdisc_lock);
+	}
 
-		if (waittime < 500)
-			waittime = 500;
+	if (ccdisc_state == 2) {
+		amutex_unlock(ccdisc_lock);
+		DBG2((g_log,0,"get_ccids: discovery failed\n"))
+		return NULL;
 	}
-	closesocket(sock);
 
-	/* If no ChromCasts found, return an empty list */
-	if (ids == NULL) {
-		DBG2((g_log,DLEV,"get_ccids: no devices found\n"))
-		if ((ids = calloc(sizeof(ccast_id *), 1)) == NULL) {
-			DBG2((g_log,0,"get_ccids: calloc fail\n"))
+	/* Copy the table */
+	if ((ids = calloc(sizeof(ccast_id *), ccdisc_nents + 1)) == NULL) {
+		amutex_unlock(ccdisc_lock);
+		DBG2((g_log,0,"get_ccids: calloc fail\n"))
+		return NULL;
+	}
+	for (i = 0; i < ccdisc_nents; i++) {
+		if ((ids[i] = ccast_id_clone(&ccdisc_ents[i].id)) == NULL) {
+			amutex_unlock(ccdisc_lock);
+			DBG2((g_log,0,"get_ccids: ccast_id_clone fail\n"))
+			free_ccids(ids);
 			return NULL;
 		}
+		ids[i]->typ = ccdisc_ents[i].id.typ;
 	}
+	amutex_unlock(ccdisc_lock);
+
 	/* Sort the results so that it is stable */
 	for (i = 0; ids[i] != NULL && ids[i+1] != NULL; i++) {
 		for (j = i+1; ids[j] != NULL; j++) {
@@ -809,8 +1012,9 @@ int parse_query(ORD8 *buf, int off, int size) {
 }
 
 /* Parse an mDNS reply, and set Friendly name (if known) + formal name + IP */
+/* and reduce *pttl to the reply TTL if it is smaller. */
 /* Return updated off value or -1 on error */
-int parse_reply(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8 *buf, int off, int size) {
+int parse_reply(char **pname, char **pip, cctype *ptyp, int *pcaflags, unsigned int *pttl, ORD8 *buf, int off, int size) {
 	char *sv;
 	int rtype, rclass, rdlength;
 	unsigned int ttl;
@@ -847,6 +1051,10 @@ int parse_reply(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8 *buf
 	ttl = read_ORD32_be(buf + off); off += 4;
 	DBG((g_log,0," TTL = %u, now off = 0x%x\n",ttl,off))
 
+	/* The device info is only as good as its shortest lived record */
+	if (rtype != DNS_TYPE_NSEC && ttl < *pttl)
+		*pttl = ttl;
+
 	if ((size - off) < 2)
 		return -1;
 	rdlength = read_ORD16_be(buf + off); off += 2;
@@ -1022,8 +1230,9 @@ int parse_reply(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8 *buf
 
 /* Parse an mDNS reply into a ChromCast name & IP address */
 /* Allocate and return name and IP on finding ChromeCast reply, NULL otherwise */
+/* *pttl is set to the smallest record TTL in seconds (0 == goodbye) */
 /* Return nz on failure */
-static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8 *buf, int size) {
+static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, unsigned int *pttl, ORD8 *buf, int size) {
 	int i, off = 0;
 	int id, flags, qdcount, ancount, nscount, arcount;
 
@@ -1031,6 +1240,7 @@ static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8
 
 	*pname = NULL;
 	*pip = NULL;
+	*pttl = 0xffffffff;
 
 	// Parse reply header
 	if ((size - off) < 2) return 1;
@@ -1069,7 +1279,7 @@ static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8
 
 	// Parse all the answers (ANCOUNT)
 	for (i = 0; i < ancount; i++) {
-		if ((off = parse_reply(pname, pip, ptyp, pcaflags, buf, off, size)) < 0) {
+		if ((off = parse_reply(pname, pip, ptyp, pcaflags, pttl, buf, off, size)) < 0) {
 			DBG((g_log,0," ### Parsing answer failed ###\n"))
 			return 1;
 		}
@@ -1077,7 +1287,7 @@ static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8
 
 	// Parse all the NS records (NSCOUNT)
 	for (i = 0; i < nscount; i++) {
-		if ((off = parse_reply(pname, pip, ptyp, pcaflags, buf, off, size)) < 0) {
+		if ((off = parse_reply(pname, pip, ptyp, pcaflags, pttl, buf, off, size)) < 0) {
 			DBG((g_log,0," ### Parsing NS record failed ###\n"))
 			return 1;
 		}
@@ -1085,7 +1295,7 @@ static int parse_dns(char **pname, char **pip, cctype *ptyp, int *pcaflags, ORD8
 
 	// Parse all the addition RR answers (ARCOUNT)
 	for (i = 0; i < arcount; i++) {
-		if ((off = parse_reply(pname, pip, ptyp, pcaflags, buf, off, size)) < 0) {
+		if ((off = parse_reply(pname, pip, ptyp, pcaflags, pttl, buf, off, size)) < 0) {
 			DBG((g_log,0," ### Parsing additional records failed ###\n"))
 			return 1;
 		}
@@ -46,9 +46,16 @@ struct _ccast_id {
 
 /* Get a list of Video out capable Chromecasts. Return NULL on error */
 /* Last pointer in array is NULL */ 
-/* Takes 0.5 second to return */
+/* Returns at once from a background discovery table, except */
+/* the first time or when none are known (up to 1.6 seconds) */
 ccast_id **get_ccids(void);
 
+/* Start background discovery ahead of get_ccids(). Return nz on error */
+int start_ccids(void);
+
+/* Stop background discovery */
+void stop_ccids(void);
+
 /* Free up what get_ccids returned */
 void free_ccids(ccast_id **ids);
 
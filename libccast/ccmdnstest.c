@@ -0,0 +1,315 @@
+/*
+ * Argyll Color Correction System
+ * ChromCast mDNS discovery test harness
+ *
+ * This material is licenced under the GNU AFFERO GENERAL PUBLIC LICENSE Version 3 :-
+ * see the License2.txt file for licencing details.
+ *
+ */
+
+/*
+ * Two halves, to check the background discovery without any ChromeCast:
+ *
+ *   ccmdnstest -r [-t ttl] [-s secs] [name]
+ *
+ * is a responder that imitates a ChromeCast at 127.0.0.1. It announces
+ * itself on the mDNS multicast group at start and at half its TTL,
+ * answers any _googlecast queries it sees, and says goodbye (TTL 0)
+ * when it exits after secs seconds.
+ *
+ *   ccmdnstest [-n calls] [-p msec]
+ *
+ * times get_ccids() calls pause msec apart, and lists what each returns.
+ *
+ * Note that queries are sent with multicast loopback disabled, so
+ * a responder on the same machine only sees them from another host.
+ * Its announcements do loop back, which is enough for the listener.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "copyright.h"
+#include "aconfig.h"
+#ifndef SALONEINSTLIB
+#include "numlib.h"
+#else
+#include "numsup.h"
+#endif
+#include "ccmdns.h"
+
+#if defined(NT)
+# define WIN32_LEAN_AND_MEAN
+# include <winsock2.h>
+# include <windows.h>
+# include <ws2tcpip.h>
+# define ERRNO GetLastError()
+#else
+# include <errno.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+# include <sys/time.h>
+# include <unistd.h>
+typedef int SOCKET;
+# define ERRNO errno
+# define INVALID_SOCKET -1
+# define SOCKET_ERROR -1
+# define closesocket(xxx) close(xxx);
+#endif
+
+#define MDNS_MCAST "224.0.0.251"
+#define MDNS_PORT 5353
+#define BUFSIZE 2048
+
+static void usage(void) {
+	fprintf(stderr,"Test ChromeCast mDNS discovery\n");
+	fprintf(stderr,"usage: ccmdnstest [-n calls] [-p msec]\n");
+	fprintf(stderr,"       ccmdnstest -r [-t ttl] [-s secs] [name]\n");
+	fprintf(stderr," -n calls      Number of get_ccids() calls to time (default 5)\n");
+	fprintf(stderr," -p msec       Pause between calls (default 1000)\n");
+	fprintf(stderr," -r            Run a test responder instead\n");
+	fprintf(stderr," -t ttl        Responder record TTL in seconds (default 10)\n");
+	fprintf(stderr," -s secs       Responder run time in seconds (default 60)\n");
+	fprintf(stderr," name          Responder friendly name (default \"Stand-in\")\n");
+	exit(1);
+}
+
+/* Write a dotted name as a sequence of labels */
+static int write_name(ORD8 *buf, int off, char *name) {
+	char *cp, *ep;
+
+	for (cp = name; *cp != '\000'; cp = ep) {
+		int len;
+		if ((ep = strchr(cp, '.')) == NULL)
+			ep = cp + strlen(cp);
+		len = (int)(ep - cp);
+		buf[off++] = len;
+		memcpy(buf + off, cp, len);
+		off += len;
+		if (*ep == '.')
+			ep++;
+	}
+	buf[off++] = 0;
+	return off;
+}
+
+/* Write a resource record header, and return the offset of RDLENGTH */
+static int write_rr(ORD8 *buf, int *poff, char *name, int type, unsigned int ttl) {
+	int off = *poff, rdl;
+
+	off = write_name(buf, off, name);
+	write_ORD16_be(buf + off, type); off += 2;
+	write_ORD16_be(buf + off, 0x8001); off += 2;	/* IN + cache flush */
+	write_ORD32_be(buf + off, ttl); off += 4;
+	rdl = off;
+	off += 2;
+	*poff = off;
+	return rdl;
+}
+
+/* Create a reply like a ChromeCast's: PTR, TXT and A records */
+static int make_reply(ORD8 *buf, char *fname, unsigned int ttl) {
+	char *svc = "_googlecast._tcp.local";
+	char *inst = "Chromecast-standin._googlecast._tcp.local";
+	char *host = "standin.local";
+	char txt[256];
+	int off, rdl, i;
+	char *txts[3];
+
+	write_ORD16_be(buf + 0, 0);			/* ID */
+	write_ORD16_be(buf + 2, 0x8400);	/* Response, authoritative */
+	write_ORD16_be(buf + 4, 0);			/* QDCOUNT */
+	write_ORD16_be(buf + 6, 1);			/* ANCOUNT */
+	write_ORD16_be(buf + 8, 0);			/* NSCOUNT */
+	write_ORD16_be(buf + 10, 2);		/* ARCOUNT */
+	off = 12;
+
+	rdl = write_rr(buf, &off, svc, 12, ttl);			/* PTR */
+	off = write_name(buf, off, inst);
+	write_ORD16_be(buf + rdl, off - rdl - 2);
+
+	rdl = write_rr(buf, &off, inst, 16, ttl);			/* TXT */
+	sprintf(txt, "fn=%.200s", fname);
+	txts[0] = txt;
+	txts[1] = "md=Chromecast";
+	txts[2] = "ca=4101";
+	for (i = 0; i < 3; i++) {
+		int len = (int)strlen(txts[i]);
+		buf[off++] = len;
+		memcpy(buf + off, txts[i], len);
+		off += len;
+	}
+	write_ORD16_be(buf + rdl, off - rdl - 2);
+
+	rdl = write_rr(buf, &off, host, 1, ttl);			/* A */
+	buf[off++] = 127;
+	buf[off++] = 0;
+	buf[off++] = 0;
+	buf[off++] = 1;
+	write_ORD16_be(buf + rdl, 4);
+
+	return off;
+}
+
+/* Return nz if buf is a query for _googlecast._tcp.local */
+static int is_ccquery(ORD8 *buf, int size) {
+	ORD8 qname[BUFSIZE];
+	int len;
+
+	if (size < 12 || (read_ORD16_be(buf + 2) & 0x8000) != 0
+	 || read_ORD16_be(buf + 4) == 0)
+		return 0;
+	len = write_name(qname, 0, "_googlecast._tcp.local");
+	return (size - 12) >= len && memcmp(buf + 12, qname, len) == 0;
+}
+
+static void responder(char *fname, unsigned int ttl, int secs) {
+	SOCKET sock;
+	struct sockaddr_in addr, dest;
+	struct ip_mreq mreq;
+	ORD8 rbuf[BUFSIZE], ibuf[BUFSIZE];
+	int rsize, on = 1;
+	unsigned int smsec, lannounce;
+
+#ifdef NT
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2,2), &data))
+		error("WSAStartup failed");
+#endif
+
+	if ((sock = socket(PF_INET, SOCK_DGRAM, 0)) == INVALID_SOCKET)
+		error("socket failed with %d",ERRNO);
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on));
+#ifdef SO_REUSEPORT
+	setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char *)&on, sizeof(on));
+#endif
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = PF_INET;
+	addr.sin_port = htons(MDNS_PORT);
+	addr.sin_addr.s_addr = INADDR_ANY;
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR)
+		error("bind failed with %d",ERRNO);
+
+	mreq.imr_multiaddr.s_addr = inet_addr(MDNS_MCAST);
+	mreq.imr_interface.s_addr = INADDR_ANY;
+	if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *)&mreq, sizeof(mreq)) == SOCKET_ERROR)
+		error("IP_ADD_MEMBERSHIP failed with %d",ERRNO);
+
+	/* Wake up every 100 msec to check for announcement time */
+#ifdef NT
+	{
+		DWORD tv = 100;
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+	}
+#else
+	{
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = 100 * 1000;
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+	}
+#endif
+
+	memset(&dest, 0, sizeof(dest));
+	dest.sin_family = PF_INET;
+	dest.sin_port = htons(MDNS_PORT);
+	dest.sin_addr.s_addr = inet_addr(MDNS_MCAST);
+
+	rsize = make_reply(rbuf, fname, ttl);
+
+	printf("Responding as '%s' at 127.0.0.1, TTL %u, for %d seconds\n",fname,ttl,secs);
+	lannounce = smsec = msec_time();
+	sendto(sock, (char *)rbuf, rsize, 0, (struct sockaddr *)&dest, sizeof(dest));
+
+	while ((msec_time() - smsec) < (unsigned int)secs * 1000) {
+		int size;
+
+		if ((msec_time() - lannounce) >= ttl * 500) {
+			printf("Announcing\n");
+			sendto(sock, (char *)rbuf, rsize, 0, (struct sockaddr *)&dest, sizeof(dest));
+			lannounce = msec_time();
+		}
+
+		if ((size = recv(sock, (char *)ibuf, BUFSIZE, 0)) == SOCKET_ERROR)
+			continue;
+		if (is_ccquery(ibuf, size)) {
+			printf("Answering query\n");
+			sendto(sock, (char *)rbuf, rsize, 0, (struct sockaddr *)&dest, sizeof(dest));
+		}
+	}
+
+	printf("Saying goodbye\n");
+	rsize = make_reply(rbuf, fname, 0);
+	sendto(sock, (char *)rbuf, rsize, 0, (struct sockaddr *)&dest, sizeof(dest));
+	closesocket(sock);
+}
+
+int
+main(
+	int argc,
+	char *argv[]
+) {
+	int fa;
+	int respond = 0;
+	unsigned int ttl = 10;
+	int secs = 60;
+	int ncalls = 5;
+	int pause = 1000;
+	char *fname = "Stand-in";
+	int k;
+
+	for (fa = 1; fa < argc; fa++) {
+		if (argv[fa][0] == '-') {
+			if (argv[fa][1] == 'r') {
+				respond = 1;
+			} else if (argv[fa][1] == 't' && fa+1 < argc) {
+				ttl = atoi(argv[++fa]);
+			} else if (argv[fa][1] == 's' && fa+1 < argc) {
+				secs = atoi(argv[++fa]);
+			} else if (argv[fa][1] == 'n' && fa+1 < argc) {
+				ncalls = atoi(argv[++fa]);
+			} else if (argv[fa][1] == 'p' && fa+1 < argc) {
+				pause = atoi(argv[++fa]);
+			} else {
+				usage();
+			}
+		} else {
+			fname = argv[fa];
+		}
+	}
+
+	if (respond) {
+		responder(fname, ttl, secs);
+		return 0;
+	}
+
+	if (start_ccids())
+		error("start_ccids() failed");
+
+	for (k = 0; k < ncalls; k++) {
+		ccast_id **ids;
+		unsigned int smsec;
+		int i;
+
+		if (k > 0)
+			msec_sleep(pause);
+
+		smsec = msec_time();
+		if ((ids = get_ccids()) == NULL)
+			error("get_ccids() failed");
+		printf("get_ccids() #%d took %d msec:\n",k+1, msec_time() - smsec);
+
+		for (i = 0; ids[i] != NULL; i++)
+			printf("  '%s' at %s, %s\n",ids[i]->name, ids[i]->ip, cctype2str(ids[i]->typ));
+		if (i == 0)
+			printf("  No ChromeCasts found\n");
+		free_ccids(ids);
+	}
+
+	stop_ccids();
+
+	return 0;
+}
@@ -154,6 +154,7 @@ void ccmes_init(ccmes *mes) {
 }
 
 /* Free up just the contents */
+/* (Received strings share the data allocation) */
 void ccmes_empty(ccmes *mes) {
 	if (mes->tnode != NULL)
 		yajl_tree_free(mes->tnode);
@@ -172,11 +173,29 @@ void ccmes_del(ccmes *mes) {
 	}
 }
 
+/* protobuf-c allocator that hands out memory from the ccmessv receive arena. */
+/* Nothing is freed, the arena is just reused for the next message. */
+static void *arena_alloc(void *allocator_data, size_t size) {
+	ccmessv *p = (ccmessv *)allocator_data;
+	void *rv;
+
+	size = (size + 7) & ~((size_t)7);		/* Keep 8 byte alignment */
+	if (size > (p->asize - p->aused)) {
+		p->ashort = 1;
+		return NULL;
+	}
+	rv = (void *)(p->arena + p->aused);
+	p->aused += size;
+	return rv;
+}
+
+static void arena_free(void *allocator_data, void *pointer) {
+}
+
 /* Send a normal raw message */
 /* Return ccmessv_err on error */
 ccmessv_err send_ccmessv(ccmessv *p, ccmes *mes) {
 	ccpacket_err perr;
-	ORD8 *buf;
     unsigned int len;
 	Extensions__Api__CastChannel__CastMessage msg
 	    = EXTENSIONS__API__CAST_CHANNEL__CAST_MESSAGE__INIT;
@@ -208,22 +227,31 @@ ccmessv_err send_ccmessv(ccmessv *p, ccmes *mes) {
 		msg.payload_binary.data = NULL;
 	}
     len = extensions__api__cast_channel__cast_message__get_packed_size(&msg);
-        
-    if ((buf = malloc(len)) == NULL)
-		return ccmessv_malloc;
-
-    extensions__api__cast_channel__cast_message__pack(&msg, buf);
 
+	/* Pack straight into the send buffer after room for the packet header */
 	amutex_lock(p->slock);
-	if ((perr = p->pk->send(p->pk, buf, len)) != ccpacket_OK) {
+	if ((4 + len) > p->sbsize) {
+		ORD8 *nbuf;
+		unsigned int nsize = 4 + len + len/4;
+
+		if ((nbuf = malloc(nsize)) == NULL) {
+			amutex_unlock(p->slock);
+			return ccmessv_malloc;
+		}
+		free(p->sbuf);
+		p->sbuf = nbuf;
+		p->sbsize = nsize;
+	}
+
+    extensions__api__cast_channel__cast_message__pack(&msg, p->sbuf + 4);
+
+	if ((perr = p->pk->send_hdr(p->pk, p->sbuf, len)) != ccpacket_OK) {
 		amutex_unlock(p->slock);
-		free(buf);
 		if (perr == ccpacket_timeout)
 			return ccmessv_timeout;
 		return ccmessv_send; 
 	}
 	amutex_unlock(p->slock);
-	free(buf);
 
 	return ccmessv_OK;
 }
@@ -233,9 +261,11 @@ ccmessv_err send_ccmessv(ccmessv *p, ccmes *mes) {
 /* Return ccmessv_err on error */
 ccmessv_err receive_ccmessv(ccmessv *p, ccmes *mes) {
 	ccpacket_err perr;
-	ORD8 *buf;
+	ORD8 *buf, *blk;
 	unsigned int len;
+	size_t need, plen, slen, dlen, nlen;
 	Extensions__Api__CastChannel__CastMessage *msg;
+	ProtobufCAllocator alloc;
 
 	if (p->pk == NULL)
 		return ccmessv_closed;
@@ -246,31 +276,76 @@ ccmessv_err receive_ccmessv(ccmessv *p, ccmes *mes) {
 		return ccmessv_recv; 
 	}
 
-	msg = extensions__api__cast_channel__cast_message__unpack(NULL, len, buf);   
+	/* Unpack into the arena. The unpacked message can't be much */
+	/* bigger than the packed one, but grow and retry if it is. */
+	alloc.alloc = arena_alloc;
+	alloc.free = arena_free;
+	alloc.allocator_data = (void *)p;
+	for (need = 2 * len + 1024;; need *= 2) {
+		if (need > p->asize) {
+			free(p->arena);
+			p->asize = 0;
+			if ((p->arena = malloc(need)) == NULL)
+				return ccmessv_malloc;
+			p->asize = need;
+		}
+		p->aused = 0;
+		p->ashort = 0;
+		msg = extensions__api__cast_channel__cast_message__unpack(&alloc, len, buf);   
+		if (msg != NULL || !p->ashort)
+			break;
+	}
 	if (msg == NULL)
 		return ccmessv_unpack; 
 
 	ccmes_init(mes);
 
-	if ((mes->source_id = strdup(msg->source_id)) == NULL)
-		return ccmessv_malloc;
-	if ((mes->destination_id = strdup(msg->destination_id)) == NULL)
-		return ccmessv_malloc;
-	if ((mes->namespace = strdup(msg->namespace_)) == NULL)
-		return ccmessv_malloc;
-
+	/* Copy the payload and the strings into one block that */
+	/* ccmes_empty() frees with the data */
 	if (msg->payload_type == EXTENSIONS__API__CAST_CHANNEL__CAST_MESSAGE__PAYLOAD_TYPE__BINARY) {
 		mes->binary = 1;
-		if ((mes->data = malloc(msg->payload_binary.len)) == NULL)
-			return ccmessv_malloc;
-		memcpy(mes->data, msg->payload_binary.data, msg->payload_binary.len);
-		mes->bin_len = msg->payload_binary.len;
+		plen = msg->payload_binary.len;
 	} else {
 		mes->binary = 0;
-		if ((mes->data = (ORD8 *)strdup(msg->payload_utf8)) == NULL)
-			return ccmessv_malloc;
+		plen = msg->payload_utf8 != NULL ? strlen(msg->payload_utf8) + 1 : 1;
+	}
+	slen = msg->source_id != NULL ? strlen(msg->source_id) + 1 : 1;
+	dlen = msg->destination_id != NULL ? strlen(msg->destination_id) + 1 : 1;
+	nlen = msg->namespace_ != NULL ? strlen(msg->namespace_) + 1 : 1;
+
+	if ((blk = malloc(plen + slen + dlen + nlen)) == NULL)
+		return ccmessv_malloc;
+
+	mes->data = blk;
+	if (mes->binary) {
+		memcpy(blk, msg->payload_binary.data, plen);
+		mes->bin_len = plen;
+	} else if (msg->payload_utf8 != NULL) {
+		memcpy(blk, msg->payload_utf8, plen);
+	} else {
+		blk[0] = '\000';
 	}
-	extensions__api__cast_channel__cast_message__free_unpacked(msg, NULL);
+	blk += plen;
+
+	mes->source_id = (char *)blk;
+	if (msg->source_id != NULL)
+		memcpy(blk, msg->source_id, slen);
+	else
+		blk[0] = '\000';
+	blk += slen;
+
+	mes->destination_id = (char *)blk;
+	if (msg->destination_id != NULL)
+		memcpy(blk, msg->destination_id, dlen);
+	else
+		blk[0] = '\000';
+	blk += dlen;
+
+	mes->namespace = (char *)blk;
+	if (msg->namespace_ != NULL)
+		memcpy(blk, msg->namespace_, nlen);
+	else
+		blk[0] = '\000';
 
 #if defined(LOWVERBTRACE) || defined(DEBUG)
 	mes_dump(mes, "Recv");
@@ -306,6 +381,8 @@ void del_ccmessv(ccmessv *p) {
 		amutex_del(p->slock);
 		if (p->pk != NULL)
 			p->pk->del(p->pk);
+		free(p->sbuf);
+		free(p->arena);
 		free(p);
 	}
 }
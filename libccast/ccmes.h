@@ -88,6 +88,15 @@ typedef struct _ccmessv {
 
 	amutex slock;					/* Send lock protecting */
 
+/* Private: */
+	ORD8 *sbuf;						/* Send packing buffer, reused. Protected by slock */
+	unsigned int sbsize;			/* Allocated size of sbuf */
+
+	ORD8 *arena;					/* Receive unpacking arena, reused */
+	size_t asize;					/* Allocated size of arena */
+	size_t aused;					/* Amount of arena used so far */
+	int ashort;						/* Set if the arena was too small */
+
 } ccmessv;
 
 /* Create a new ccmessv object, and hand it the working packet connection. */
@@ -95,6 +104,11 @@ typedef struct _ccmessv {
 /* Return NULL on error */
 ccmessv *new_ccmessv(ccpacket *pk);
 
+/* Create a ccmessv connected to an in-process stand-in for the pattern */
+/* generator receiver rather than to a ChromeCast (see ccstandin.c). */
+/* Return NULL on error */
+ccmessv *new_ccmessv_standin(void);
+
 #ifdef __cplusplus
 	}
 #endif
@@ -283,6 +283,8 @@ static void clear_ccpacket(ccpacket *p);
 static ccpacket_err re_connect_ccpacket(
 	ccpacket *p
 ) {
+	if (p->plain)
+		return ccpacket_connect;	/* We didn't make the connection */
 	clear_ccpacket(p);
 	return connect_ccpacket_imp(p);
 }
@@ -294,252 +296,235 @@ static ccpacket_err re_connect_ccpacket(
 /* with a lock. Note that we need to make sure that a receive */
 /* doesn't wait for too long, or it will block sends. */
 
-/* Send a message */
-/* Return ccpacket_err on error */
-static ccpacket_err send_ccpacket(ccpacket *p,
-	ORD8 *buf, ORD32 len		/* Message body to send */
-) {
-	int lens, ilen;
-	ORD8 *sbuf;
-	ORD32 slen;
+/* Make sure *pbuf has at least len bytes. Contents are not kept. */
+/* Return nz on malloc failure */
+static int grow_buf(ORD8 **pbuf, ORD32 *psize, ORD32 len) {
+	if (len > *psize) {
+		ORD8 *nbuf;
+		ORD32 nsize = len + len/4;	/* Avoid creeping up a few bytes at a time */
+
+		if ((nbuf = malloc(nsize)) == NULL)
+			return 1;
+		free(*pbuf);
+		*pbuf = nbuf;
+		*psize = nsize;
+	}
+	return 0;
+}
 
-	if (p->ssl == NULL)
-		return ccpacket_ssl; 
+/* Return nz if the last plain socket error was a timeout */
+static int plain_timeout() {
+#ifdef NT
+	return ERRNO == WSAETIMEDOUT || ERRNO == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
 
-	if ((sbuf = malloc(4 + len)) == NULL) {
-		return ccpacket_malloc; 
-	}
+/* Write all of buf */
+/* Return ccpacket_err on error */
+static ccpacket_err write_ccpacket(ccpacket *p, ORD8 *buf, ORD32 len) {
+	int lens, ilen;
 
-	write_ORD32_be(sbuf, len);
-	memcpy(sbuf+4, buf, len);
-	slen = len + 4;
+	for (lens = 0; lens < (int)len; lens += ilen) {
+		DBG((g_log,0, "Sending packet %d bytes\n",len - lens))
 
-#if defined(DEBUG) && defined(DUMPSDATA)
-	printf("send_ccpacket sending packet:\n");
-	adump_bytes(g_log,"  ", sbuf, 0, slen);
-#endif
+		if (p->plain) {
+			if ((ilen = send(p->sock, (char *)buf + lens, len - lens, 0)) < 0) {
+				DBG((g_log,0, "send failed with %d\n",ERRNO))
+				if (plain_timeout())
+					return ccpacket_timeout;
+				return ccpacket_send;
+			}
+			continue;
+		}
 
-	for (lens = 0; lens < slen; lens += ilen) {
-		DBG((g_log,0, "Sending packet %d bytes\n",slen - lens))
 		if (p->ssl == NULL) {
 			return ccpacket_ssl; 
 		}
 #ifdef SYNC_SSL
 		amutex_lock(p->lock);
-printf("~1 send locked\n");
 #endif
 #ifdef USING_AXTLS
-		if ((ilen = ssl_write(p->ssl, sbuf + lens, slen - lens)) < 0)
+		ilen = ssl_write(p->ssl, buf + lens, len - lens);
 #else
-		if ((ilen = SSL_write(p->ssl, sbuf + lens, slen - lens)) < 0)
-#endif
-		{
-#ifdef USING_AXTLS
-			DBG((g_log,0, "send failed with '%s'\n",ssl_error_string(ilen)))
-#else
-			DBG((g_log,0, "send failed with %d\n",SSL_get_error(p->ssl, ilen)))
+		ilen = SSL_write(p->ssl, buf + lens, len - lens);
 #endif
 #ifdef SYNC_SSL
-printf("~1 send unlocked\n");
-			amutex_unlock(p->lock);
+		amutex_unlock(p->lock);
 #endif
-			free(sbuf);
-
+		if (ilen < 0) {
 #ifdef USING_AXTLS
+			DBG((g_log,0, "send failed with '%s'\n",ssl_error_string(ilen)))
 			if (ilen == SSL_TIMEDOUT)
 #else
+			DBG((g_log,0, "send failed with %d\n",SSL_get_error(p->ssl, ilen)))
 			if (SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_READ
 			 || SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_WRITE)
 #endif 
 				return ccpacket_timeout;
 			return ccpacket_send;
 		}
-#ifdef SYNC_SSL
-printf("~1 send unlocked\n");
-		amutex_unlock(p->lock);
-#endif
 	} 
-	free(sbuf);
-
 	return ccpacket_OK;
 }
 
-/* Receive a message */
+/* Send a message whose body the caller has put at buf + 4, with */
+/* the first 4 bytes free for the length header. */
 /* Return ccpacket_err on error */
-static ccpacket_err receive_ccpacket(ccpacket *p,
-	ORD8 **pbuf, ORD32 *plen		/* ccpacket received, free after use */
+static ccpacket_err send_hdr_ccpacket(ccpacket *p,
+	ORD8 *buf, ORD32 len		/* Message body to send is len bytes at buf + 4 */
 ) {
-	ORD8 *ibuf;					/* Buffer from ssl_read() */
-	int ioff, ilen;				/* Remaining data at ioff lenght ilen in ibuf */
-	ORD8 hbuf[4], *rbuf = hbuf;	/* Header buffer, returned buffer */
-	int tlen, clen, rlen;		/* Target length, copy length, return length */
-
-	if (p->ssl == NULL)
-		return ccpacket_ssl; 
+	write_ORD32_be(buf, len);
 
-#ifdef SYNC_SSL
-	amutex_lock(p->lock);
-printf("~1 receive locked\n");
+#if defined(DEBUG) && defined(DUMPSDATA)
+	printf("send_ccpacket sending packet:\n");
+	adump_bytes(g_log,"  ", buf, 0, len + 4);
 #endif
 
-	tlen = 4;
+	return write_ccpacket(p, buf, len + 4);
+}
 
-#ifndef USING_AXTLS
-	if ((ibuf = malloc(tlen)) == NULL) {
+/* Send a message */
+/* Return ccpacket_err on error */
+static ccpacket_err send_ccpacket(ccpacket *p,
+	ORD8 *buf, ORD32 len		/* Message body to send */
+) {
+	if (!p->plain && p->ssl == NULL)
+		return ccpacket_ssl; 
+
+	if (grow_buf(&p->sbuf, &p->sbsize, 4 + len))
 		return ccpacket_malloc; 
-	}
-	ibuf[0] = ibuf[1] = ibuf[2] = ibuf[2] = 0;
-#endif
 
-	/* Until we have 4 bytes for the header */
-	for (rlen = 0; rlen < tlen;) {
-		ioff = 0;
-#ifdef USING_AXTLS
-		if ((ilen = ssl_read(p->ssl, &ibuf)) < 0)
-#else
-		if ((ilen = SSL_read(p->ssl, ibuf, tlen)) < 0)
-#endif
-		{
+	memcpy(p->sbuf + 4, buf, len);
+
+	return send_hdr_ccpacket(p, p->sbuf, len);
+}
+
+/* Read until *pgot of len bytes are in buf. */
+/* *pgot is kept over a timeout, so that the next call carries on. */
+/* Return ccpacket_err on error */
+static ccpacket_err read_ccpacket(ccpacket *p, ORD8 *buf, int len, int *pgot) {
+	int ilen, clen;
+
+	while (*pgot < len) {
+
+		if (p->plain) {
+			if ((ilen = recv(p->sock, (char *)buf + *pgot, len - *pgot, 0)) < 0) {
+				DBG((g_log,0, "recv failed with %d\n",ERRNO))
+				if (plain_timeout())
+					return ccpacket_timeout;
+				return ccpacket_recv;
+			}
+			if (ilen == 0) {
+				DBG((g_log,0, "connection closed\n"))
+				return ccpacket_recv;
+			}
+			*pgot += ilen;
+			continue;
+		}
+
+		if (p->ssl == NULL)
+			return ccpacket_ssl; 
+
 #ifdef USING_AXTLS
-			DBG((g_log,0, "header recv failed with '%s'\n",ssl_error_string(ilen)))
-#else
-			DBG((g_log,0, "header recv failed with %d\n",SSL_get_error(p->ssl, ilen)))
-#endif
-#ifdef SYNC_SSL
-printf("~1 receive unlocked\n");
+		/* ssl_read() hands back its own buffer, which may hold */
+		/* more than we want now. Keep the rest for next time. */
+		if (p->ilen <= 0) {
+# ifdef SYNC_SSL
+			amutex_lock(p->lock);
+# endif
+			ilen = ssl_read(p->ssl, &p->ibuf);
+# ifdef SYNC_SSL
 			amutex_unlock(p->lock);
-#endif
-#ifdef USING_AXTLS
-			if (ilen == SSL_TIMEDOUT)
+# endif
+			if (ilen < 0) {
+				DBG((g_log,0, "recv failed with '%s'\n",ssl_error_string(ilen)))
+				if (ilen == SSL_TIMEDOUT)
+					return ccpacket_timeout;
+				return ccpacket_recv;
+			}
+			p->ilen = ilen;
+			continue;			/* ilen == 0 is a handshake or similar */
+		}
+		if ((clen = p->ilen) > (len - *pgot))
+			clen = len - *pgot;
+		memcpy(buf + *pgot, p->ibuf, clen);
+		p->ibuf += clen;
+		p->ilen -= clen;
+		*pgot += clen;
 #else
-			free(ibuf);
+# ifdef SYNC_SSL
+		amutex_lock(p->lock);
+# endif
+		ilen = SSL_read(p->ssl, buf + *pgot, len - *pgot);
+# ifdef SYNC_SSL
+		amutex_unlock(p->lock);
+# endif
+		if (ilen < 0) {
+			DBG((g_log,0, "recv failed with %d\n",SSL_get_error(p->ssl, ilen)))
 			if (SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_READ
 			 || SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_WRITE)
-#endif 
 				return ccpacket_timeout;
 			return ccpacket_recv;
 		}
-		DBG((g_log,0, "receive_ccpacket read %d bytes\n",ilen))
 		if (ilen == 0) {
-#ifdef USING_AXTLS
-			continue;
-#else
 			DBG((g_log,0, "SSL_read failed\n"))
-			free(ibuf);
 			return ccpacket_recv;
-#endif
 		}
-		if ((clen = ilen) > (tlen - rlen))		/* More than we need */
-			clen = tlen - rlen;
-		memcpy(rbuf + rlen, ibuf + ioff, clen);
-		rlen += clen;
-		ioff += clen;
-		ilen -= clen;
+		clen = ilen;
+		*pgot += clen;
+#endif
 	}
-	/* We have ilen left in ibuf at offset ioff */
-	DBG((g_log,0, "receive_ccpacket %d bytes left over\n",ilen))
+	return ccpacket_OK;
+}
+
+/* Receive a message */
+/* The returned buffer belongs to the ccpacket, and is good until */
+/* the next receive. */
+/* Return ccpacket_err on error */
+static ccpacket_err receive_ccpacket(ccpacket *p,
+	ORD8 **pbuf, ORD32 *plen		/* ccpacket received */
+) {
+	ccpacket_err rv;
+	int tlen;
 
-	tlen = read_ORD32_be(rbuf);
+	/* Until we have 4 bytes for the header */
+	if ((rv = read_ccpacket(p, p->rhdr, 4, &p->rhgot)) != ccpacket_OK) {
+		if (rv != ccpacket_timeout)
+			p->rhgot = 0;
+		return rv;
+	}
+
+	tlen = read_ORD32_be(p->rhdr);
 	DBG((g_log,0, "receive_ccpacket expecting %d more bytes\n",tlen))
 
 	if (tlen < 0 || tlen > 64 * 2014) {
-#ifdef SYNC_SSL
-printf("~1 receive unlocked\n");
-		amutex_unlock(p->lock);
-#endif
 		DBG((g_log,0, "receive_ccpacket got bad data length - returning error\n"))
+		p->rhgot = 0;
 		return ccpacket_recv;
 	}
 
-	if ((rbuf = malloc(tlen)) == NULL) {
-#ifdef SYNC_SSL
-printf("~1 receive unlocked\n");
-		amutex_unlock(p->lock);
-#endif
+	if (p->rbgot == 0 && grow_buf(&p->rbuf, &p->rbsize, tlen)) {
 		DBG((g_log,0, "receive_ccpacket malloc failed\n"))
+		p->rhgot = 0;
 		return ccpacket_malloc; 
 	}
-	rlen = 0;
-
-	/* Use any data we have left over from first read */
-	if (ilen > 0) {
-		if ((clen = ilen) > (tlen - rlen))
-			clen = tlen - rlen;
-		DBG((g_log,0, "receive_ccpacket using %d spair bytesr\n",clen))
-		memcpy(rbuf + rlen, ibuf + ioff, clen);
-		rlen += clen;
-		ioff += clen;
-		ilen -= clen;
-	}
 
-#ifndef USING_AXTLS
-	free(ibuf);
-	if ((ibuf = malloc(tlen)) == NULL) {
-		return ccpacket_malloc; 
+	/* Get the body */
+	if ((rv = read_ccpacket(p, p->rbuf, tlen, &p->rbgot)) != ccpacket_OK) {
+		if (rv != ccpacket_timeout)
+			p->rhgot = p->rbgot = 0;
+		return rv;
 	}
-#endif
+	p->rhgot = p->rbgot = 0;		/* Ready for the next one */
 
-	/* Get the remainder of the body if we need to */
-	for (; rlen < tlen;) {
-		ioff = 0;
-#ifdef USING_AXTLS
-		if ((ilen = ssl_read(p->ssl, &ibuf)) < 0)
-#else
-		if ((ilen = SSL_read(p->ssl, ibuf, tlen)) < 0)
-#endif
-		{
-#ifdef USING_AXTLS
-			DBG((g_log,0, "body recv failed with '%s'\n",ssl_error_string(ilen)))
-#else
-			DBG((g_log,0, "body recv failed with %d\n",SSL_get_error(p->ssl, ilen)))
-#endif
-#ifdef SYNC_SSL
-printf("~1 receive unlocked\n");
-			amutex_unlock(p->lock);
-#endif
-#ifdef USING_AXTLS
-			if (ilen == SSL_TIMEDOUT)
-#else
-			free(ibuf);
-			if (SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_READ
-			 || SSL_get_error(p->ssl, ilen) == SSL_ERROR_WANT_WRITE)
-#endif 
-				return ccpacket_timeout;
-			return ccpacket_recv;
-		}
-		DBG((g_log,0, "receive_ccpacket read %d bytes\n",ilen))
-		if (ilen == 0) {
-#ifdef USING_AXTLS
-			continue;
-#else
-			DBG((g_log,0, "SSL_read failed\n"))
-			free(ibuf);
-			return ccpacket_recv;
-#endif
-		}
-		if ((clen = ilen) > (tlen - rlen))
-			clen = tlen - rlen;
-		memcpy(rbuf + rlen, ibuf + ioff, clen);
-		rlen += clen;
-		ioff += clen;
-		ilen -= clen;
-	}
-#ifdef SYNC_SSL
-printf("~1 receive unlocked\n");
-	amutex_unlock(p->lock);
-#endif
-	if (ilen > 0) {		/* Hmm. We should keep this for the next read ?*/
-		DBG((g_log,0, " ################## got %d byts left over ###########\n", ilen))
-	}
-#ifndef USING_AXTLS
-	free(ibuf);
-#endif
 #if defined(DEBUG) && defined(DUMPRDATA)
 	printf("receive_ccpacket got:\n");
-	adump_bytes(g_log,"  ", rbuf, 0, rlen);
+	adump_bytes(g_log,"  ", p->rbuf, 0, tlen);
 #endif
-	*pbuf = rbuf;
-	*plen = rlen;
+	*pbuf = p->rbuf;
+	*plen = tlen;
 	
 	return ccpacket_OK;
 }
@@ -564,6 +549,12 @@ static void clear_ccpacket(ccpacket *p) {
 #endif
 			p->ctx = NULL;
 		}
+		/* Any part message is lost with the connection */
+		p->rhgot = p->rbgot = 0;
+#ifdef USING_AXTLS
+		p->ibuf = NULL;
+		p->ilen = 0;
+#endif
 		if (p->sock != INVALID_SOCKET) {
 	        closesocket(p->sock);
 			p->sock = 0;
@@ -579,6 +570,8 @@ static void del_ccpacket(ccpacket *p) {
 			free(p->dip);
 			p->dip = NULL;
 		}
+		free(p->sbuf);
+		free(p->rbuf);
 #ifdef SYNC_SSL
 		amutex_del(p->lock);
 #endif
@@ -610,8 +603,24 @@ ccpacket *new_ccpacket() {
 	p->connect   = connect_ccpacket;
 	p->reconnect = re_connect_ccpacket;
 	p->send      = send_ccpacket;
+	p->send_hdr  = send_hdr_ccpacket;
 	p->receive   = receive_ccpacket;
 
 	return p;
 }
 
+/* Create a ccpacket that sends and receives plain (not TLS) packets */
+/* on a socket that is already connected. We take ownership of sock. */
+/* Return NULL on error */
+ccpacket *new_ccpacket_sock(int sock) {
+	ccpacket *p;
+
+	if ((p = new_ccpacket()) == NULL)
+		return NULL;
+
+	p->sock = (SOCKET)sock;
+	p->plain = 1;
+
+	return p;
+}
+
@@ -59,10 +59,17 @@ typedef struct _ccpacket {
 	      ORD8 *buf, ORD32 len		/* Message body to send */
 	);
 
+	/* Send a message the caller has put at buf + 4, leaving the first */
+	/* 4 bytes for the header. Saves copying the body. */
+	/* Return ccpacket_err on error */
+	ccpacket_err (*send_hdr)(struct _ccpacket *p,
+	      ORD8 *buf, ORD32 len		/* Message body length at buf + 4 */
+	);
+
 	/* Receive a message */
 	/* Return ccpacket_err on error */
 	ccpacket_err (*receive)(struct _ccpacket *p,
-	      ORD8 **pbuf, ORD32 *plen		/* ccpacket received, free after use */
+	      ORD8 **pbuf, ORD32 *plen		/* ccpacket received, valid until next receive */
 	);
 
 #ifdef CCPACKET_IMPL
@@ -73,6 +80,20 @@ typedef struct _ccpacket {
 	SSL_CTX *ctx;
 	SSL *ssl;
 	amutex lock;		/* Lock to prevent simultanious send & receive */
+	int plain;			/* nz if sock is used without TLS */
+
+	ORD8 *sbuf;			/* Send buffer, reused */
+	ORD32 sbsize;		/* Allocated size of sbuf */
+
+	ORD8 rhdr[4];		/* Receive header */
+	int rhgot;			/* Header bytes received so far */
+	ORD8 *rbuf;			/* Receive body buffer, reused */
+	ORD32 rbsize;		/* Allocated size of rbuf */
+	int rbgot;			/* Body bytes received so far */
+#ifdef USING_AXTLS
+	ORD8 *ibuf;			/* ssl_read() data not used yet */
+	int ilen;			/* Length of it */
+#endif
 #endif
 
 } ccpacket;
@@ -81,6 +102,11 @@ typedef struct _ccpacket {
 /* Return NULL on error */
 ccpacket *new_ccpacket();
 
+/* Create a ccpacket that sends and receives plain (not TLS) packets */
+/* on a socket that is already connected. We take ownership of sock. */
+/* (For testing.) Return NULL on error */
+ccpacket *new_ccpacket_sock(int sock);
+
 #ifdef __cplusplus
 	}
 #endif
@@ -0,0 +1,217 @@
+/*
+ * Argyll Color Correction System
+ * ChromCast pattern generator receiver stand-in
+ *
+ * This material is licenced under the GNU AFFERO GENERAL PUBLIC LICENSE Version 3 :-
+ * see the License2.txt file for licencing details.
+ *
+ */
+
+/*
+ * A ccmessv that talks to an in-process imitation of the pattern
+ * generator receiver instead of a ChromeCast, so that the sender side
+ * of patch display (rendering, encoding, messaging, ACK wait) can be
+ * timed without any hardware.
+ *
+ * It answers LAUNCH with a RECEIVER_STATUS, and every pattern generator
+ * message with an ACK after STANDIN_MSG_DELAY msec, plus STANDIN_KB_DELAY
+ * msec per KByte of message to account for image transfer and decoding.
+ * Set ARGYLL_CCAST_STANDIN_NOSOLID to make it NACK solid patch messages
+ * like a receiver that only knows about images.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "copyright.h"
+#include "aconfig.h"
+#include <sys/types.h>
+#include "numlib.h"
+#include "yajl.h"
+#include "conv.h"
+#include "ccpacket.h"
+#include "ccmes.h"
+
+#define STANDIN_MSG_DELAY 20	/* Receiver message handling time */
+#define STANDIN_KB_DELAY 2		/* Receiver transfer & decode time per KByte */
+#define STANDIN_RECV_TO 100		/* receive() timeout when idle */
+
+/* A reply waiting to be received */
+typedef struct _standin_reply {
+	struct _standin_reply *next;
+	unsigned int due;			/* msec_time() at which it can be received */
+	char *namespace;			/* Channel it comes from */
+	char *data;					/* JSON */
+} standin_reply;
+
+typedef struct {
+	ccmessv mv;					/* Must be first, we're handed out as a ccmessv */
+
+	amutex lock;				/* Protects the reply queue */
+	acond cond;					/* Signalled when a reply is queued */
+	standin_reply *head, *tail;	/* Replies in due order */
+	int nosolid;				/* NACK solid patch messages */
+} ccstandin;
+
+static char *receiver_chan = "urn:x-cast:com.google.cast.receiver";
+static char *direct_chan = "urn:x-cast:net.hoech.cast.patterngenerator";
+
+/* Queue a reply. Return nz on error */
+static int standin_queue(ccstandin *p, char *namespace, char *data, int delay) {
+	standin_reply *r;
+
+	if ((r = (standin_reply *)calloc(1, sizeof(standin_reply))) == NULL)
+		return 1;
+	if ((r->data = strdup(data)) == NULL) {
+		free(r);
+		return 1;
+	}
+	r->namespace = namespace;
+	r->due = msec_time() + delay;
+
+	amutex_lock(p->lock);
+	/* Messages are handled in order, so a reply can't overtake an earlier one */
+	if (p->tail != NULL && p->tail->due > r->due)
+		r->due = p->tail->due;
+	if (p->tail == NULL)
+		p->head = r;
+	else
+		p->tail->next = r;
+	p->tail = r;
+	acond_signal(p->cond);
+	amutex_unlock(p->lock);
+
+	return 0;
+}
+
+static ccmessv_err send_standin(ccmessv *pp, ccmes *mes) {
+	ccstandin *p = (ccstandin *)pp;
+	yajl_val tnode, v;
+	char errbuf[1024], reply[256];
+	int rqid = 0;
+
+	if (mes->binary || mes->data == NULL)
+		return ccmessv_OK;
+
+	if ((tnode = yajl_tree_parse((char *)mes->data, errbuf, sizeof(errbuf))) == NULL)
+		return ccmessv_OK;		/* A real receiver would ignore it too */
+
+	if ((v = yajl_tree_get_first(tnode, "requestId", yajl_t_number)) != NULL)
+		rqid = YAJL_GET_INTEGER(v);
+
+	if (strcmp(mes->namespace, receiver_chan) == 0) {
+		if ((v = yajl_tree_get_first(tnode, "type", yajl_t_string)) != NULL
+		 && strcmp(YAJL_GET_STRING(v), "LAUNCH") == 0) {
+			sprintf(reply, "{ \"requestId\": %d, \"type\": \"RECEIVER_STATUS\", \"status\": "
+			               "{ \"applications\": [ { \"appId\": \"B5C2CBFC\","
+			               " \"sessionId\": \"standin-session\","
+			               " \"transportId\": \"standin-transport\" } ] } }", rqid);
+			standin_queue(p, receiver_chan, reply, STANDIN_MSG_DELAY);
+		}
+
+	} else if (strcmp(mes->namespace, direct_chan) == 0) {
+		size_t len = strlen((char *)mes->data);
+		int solid = 0;
+
+		if ((v = yajl_tree_get_first(tnode, "contentType", yajl_t_string)) != NULL
+		 && strcmp(YAJL_GET_STRING(v), "text/css") == 0)
+			solid = 1;
+
+		if (solid && p->nosolid)
+			sprintf(reply, "{ \"requestId\": %d, \"type\": \"NACK\", \"errors\": [ \"solid\" ] }", rqid);
+		else
+			sprintf(reply, "{ \"requestId\": %d, \"type\": \"ACK\" }", rqid);
+		standin_queue(p, direct_chan, reply,
+		              STANDIN_MSG_DELAY + (int)(STANDIN_KB_DELAY * len / 1024));
+	}
+
+	yajl_tree_free(tnode);
+	return ccmessv_OK;
+}
+
+static ccmessv_err receive_standin(ccmessv *pp, ccmes *mes) {
+	ccstandin *p = (ccstandin *)pp;
+	standin_reply *r = NULL;
+	unsigned int start = msec_time(), now;
+	yajl_val tyn, idn;
+	char errbuf[1024];
+
+	amutex_lock(p->lock);
+	for (;;) {
+		now = msec_time();
+		if (p->head != NULL && (int)(p->head->due - now) <= 0) {
+			r = p->head;
+			if ((p->head = r->next) == NULL)
+				p->tail = NULL;
+			break;
+		}
+		if ((int)(now - start) >= STANDIN_RECV_TO)
+			break;
+
+		/* Sleep until the next reply is due, or something is queued */
+		if (p->head != NULL)
+			acond_timedwait(p->cond, p->lock, (int)(p->head->due - now));
+		else
+			acond_timedwait(p->cond, p->lock, STANDIN_RECV_TO - (int)(now - start));
+	}
+	amutex_unlock(p->lock);
+
+	if (r == NULL)
+		return ccmessv_timeout;
+
+	ccmes_init(mes);
+	mes->source_id = "standin";
+	mes->destination_id = "sender-0";
+	mes->namespace = r->namespace;
+	mes->binary = 0;
+	mes->data = (ORD8 *)r->data;
+	free(r);
+
+	/* Same parsing as receive_ccmessv() */
+	if ((mes->tnode = yajl_tree_parse((char *)mes->data, errbuf, sizeof(errbuf))) != NULL
+	 && (tyn = yajl_tree_get_first(mes->tnode, "type", yajl_t_string)) != NULL) {
+		mes->mtype = YAJL_GET_STRING(tyn);
+		if ((idn = yajl_tree_get_first(mes->tnode, "requestId", yajl_t_number)) != NULL)
+			mes->rqid = YAJL_GET_INTEGER(idn);
+	}
+
+	return ccmessv_OK;
+}
+
+static void del_standin(ccmessv *pp) {
+	ccstandin *p = (ccstandin *)pp;
+	standin_reply *r, *nr;
+
+	if (p == NULL)
+		return;
+
+	for (r = p->head; r != NULL; r = nr) {
+		nr = r->next;
+		free(r->data);
+		free(r);
+	}
+	acond_del(p->cond);
+	amutex_del(p->lock);
+	amutex_del(p->mv.slock);
+	free(p);
+}
+
+/* Create the stand-in. Return NULL on error */
+ccmessv *new_ccmessv_standin(void) {
+	ccstandin *p;
+
+	if ((p = (ccstandin *)calloc(1, sizeof(ccstandin))) == NULL)
+		return NULL;
+
+	amutex_init(p->mv.slock);
+	amutex_init(p->lock);
+	acond_init(p->cond);
+
+	p->nosolid = getenv("ARGYLL_CCAST_STANDIN_NOSOLID") != NULL;
+
+	p->mv.del     = del_standin;
+	p->mv.send    = send_standin;
+	p->mv.receive = receive_standin;
+
+	return &p->mv;
+}
@@ -89,6 +89,27 @@ static void chws_del(chws *p) {
 	free(p);
 }
 
+/* Convert x,y,w,h to relative rather than pixel size, */
+/* as the direct loader wants them */
+static void chws_direct_geometry(chws *p, double *x, double *y, double *w, double *h) {
+
+	debugr2((errout,"Got x %f y %f w %f h %f\n", p->x, p->y, p->w, p->h));
+
+	// Convert from quantized to direct loader parameters
+	if (p->w < IWIDTH)
+		*x = p->x/(IWIDTH - p->w);
+	else	
+		*x = 0.0;
+	if (p->h < IHEIGHT)
+		*y = p->y/(IHEIGHT - p->h);
+	else
+		*y = 0.0;
+	*w = p->w/(0.1 * IWIDTH);
+	*h = p->h/(0.1 * IWIDTH);
+
+	debugr2((errout,"Sending direct x %f y %f w %f h %f\n", *x, *y, *w, *h));
+}
+
 /* Change the .png being served */
 /* Return nz on error */
 static int chws_update(chws *p, unsigned char *ibuf, size_t ilen, double *bg) {
@@ -105,23 +126,8 @@ static int chws_update(chws *p, unsigned char *ibuf, size_t ilen, double *bg) {
 	/* Send the PNG swatch direct */
 	if (p->direct) {
 		double x, y, w, h;
-		/* Convert x,y,w,h to relative rather than pixel size */
-
-		debugr2((errout,"Got x %f y %f w %f h %f\n", p->x, p->y, p->w, p->h));
-
-		// Convert from quantized to direct loader parameters
-		if (p->w < IWIDTH)
-			x = p->x/(IWIDTH - p->w);
-		else	
-			x = 0.0;
-		if (p->h < IHEIGHT)
-			y = p->y/(IHEIGHT - p->h);
-		else
-			y = 0.0;
-		w = p->w/(0.1 * IWIDTH);
-		h = p->h/(0.1 * IWIDTH);
 
-		debugr2((errout,"Sending direct x %f y %f w %f h %f\n", x, y, w, h));
+		chws_direct_geometry(p, &x, &y, &w, &h);
 
 		if (p->cc->load(p->cc, NULL, p->ibuf, p->ilen, bg, x, y, w, h)) {
 			debugr2((errout,"ccwin_update direct load failed\n"));
@@ -145,6 +151,25 @@ static int chws_update(chws *p, unsigned char *ibuf, size_t ilen, double *bg) {
 	return 0;
 }
 
+/* Show a solid patch, sent as parameters over the pattern generator channel */
+/* Return nz on error */
+static int chws_update_solid(chws *p, double *fg, double *bg) {
+	double x, y, w, h;
+
+	debug("\nUpdate solid\n");
+
+	if (!p->direct || p->cc->nosolid)
+		return 1;
+
+	chws_direct_geometry(p, &x, &y, &w, &h);
+
+	if (p->cc->load_solid(p->cc, fg, bg, x, y, w, h)) {
+		debugr2((errout,"ccwin_update_solid failed\n"));
+		return 1;
+	}
+	return 0;
+}
+
 /* Web server event handler - return the current .png image */
 static void *ccwin_ehandler(enum mg_event event,
                            struct mg_connection *conn) {
@@ -215,6 +240,7 @@ BOOL ws							/* Force webserver */
 	}
 
 	p->update = chws_update;
+	p->update_solid = chws_update_solid;
 	p->del = chws_del;
 
 	/* We make sure we round the test patch size and */
@@ -322,6 +348,33 @@ double r, double g, double b	/* Color values 0.0 - 1.0 */
 # pragma message("############################# ccwin.c DDITHER != 1 ##")
 #endif
 
+	/* A patch the ChromeCast reproduces exactly needs no dithering, so */
+	/* it can be sent as a plain color instead of a rendered PNG. */
+	/* Anything else, or a receiver that doesn't support it, uses a PNG. */
+	if (ws->direct && !ws->cc->nosolid) {
+		double q_rgb[3], bg[3];
+		double area;
+
+		ccastQuant(NULL, q_rgb, p->r_rgb);
+		if (fabs(q_rgb[0] - p->r_rgb[0]) < 1e-6
+		 && fabs(q_rgb[1] - p->r_rgb[1]) < 1e-6
+		 && fabs(q_rgb[2] - p->r_rgb[2]) < 1e-6) {
+
+			/* Same background as the PNG path below */
+			area = (ws->w / 1000. * ws->h / 1000.);
+			for (j = 0; j < 3; j++) {
+				bg[j] = (p->blackbg - area * p->rgb[j]) / (1 - area);
+				if (bg[j] < 0)
+					bg[j] = 0;
+			}
+
+			if (ws->update_solid(ws, p->r_rgb, bg) == 0) {
+				msec_sleep(update_delay);
+				return 0;
+			}
+		}
+	}
+
 	/* Turn the color into a png file */
 	{
 		/* We want a raster of IWIDTH x IHEIGHT pixels for web server, */
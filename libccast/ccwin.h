@@ -88,6 +88,10 @@ typedef struct _chws {
 	/* Update the png image */
 	int (*update)(struct _chws *p, unsigned char *ibuf, size_t ilen, double *bg);
 
+	/* Show a solid patch without any image, direct mode only. */
+	/* Return nz on error, the caller should then use update() */
+	int (*update_solid)(struct _chws *p, double *fg, double *bg);
+
 	/* Destroy ourselves */
 	void (*del)(struct _chws *p);
 
@@ -804,6 +804,7 @@
 #define IDR_PATTERN_SRAMP               1296
 #define IDR_PATTERN_SRAMPv              1297
 #define IDR_PATTERN_VSMPTE              1298
+#define IDC_CHECK_CALIBRATION_MULTIPATCH 1299
 #define IDR_PATTERN_ERAMP               1300
 #define IDR_PATTERN_ALIGN               1301
 #define IDR_PATTERN_SPECTRUM            1302
@@ -1153,6 +1154,8 @@
 #define ID_GRAPH_W33105                 33105
 #define ID_Menu33106                    33106
 #define IDM_LUM_GRAPH_YLog              33107
+#define IDM_COMPARE_DOCUMENTS           33108
+#define IDM_DISPLAY_LATENCY             33109
 #define IDS_LUMINANCEHISTOVIEW_NAME     41446
 #define IDS_COLORTEMPHISTOVIEW_NAME     41447
 #define IDS_RGBHISTOVIEW_NAME           41448
@@ -1695,7 +1698,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_3D_CONTROLS                     1
 #define _APS_NEXT_RESOURCE_VALUE        385
-#define _APS_NEXT_COMMAND_VALUE         33108
+#define _APS_NEXT_COMMAND_VALUE         33110
 #define _APS_NEXT_CONTROL_VALUE         1292
 #define _APS_NEXT_SYMED_VALUE           143
 #endif